@@ -0,0 +1,1818 @@
+#include "bc_encoder.h"
+#include "config.h"
+
+#include <cstring>
+
+#if defined(__x86_64__) || defined(_M_X64)
+#    define GREX_BC_X64
+#    include <emmintrin.h>
+#endif
+
+// Blocks per ParallelFor job
+#define BC_BLOCKS_PER_JOB 64
+
+// -------------------------------------------------------------------------------------------------
+// Block helpers
+// -------------------------------------------------------------------------------------------------
+namespace
+{
+
+// Pixels of a block, or of a single subset of a block. LDR formats use
+// 0..255, BC6H uses half float bit patterns. Lanes past count are zero so
+// the SIMD search can read them.
+struct BlockPixels
+{
+    alignas(16) float r[16] = {};
+    alignas(16) float g[16] = {};
+    alignas(16) float b[16] = {};
+    alignas(16) float a[16] = {};
+    uint32_t count          = 0;
+};
+
+// Same layout as BlockPixels, at most 16 colors
+struct BlockPalette
+{
+    float    r[16] = {};
+    float    g[16] = {};
+    float    b[16] = {};
+    float    a[16] = {};
+    uint32_t count = 0;
+};
+
+// How endpoints are quantized, also selects the palette interpolation
+enum EndpointQuant
+{
+    ENDPOINT_QUANT_565     = 0, // BC1 color, RGB 5:6:5
+    ENDPOINT_QUANT_7_PBIT  = 1, // BC7 mode 6, RGBA 7 bits with a P bit per endpoint
+    ENDPOINT_QUANT_6_SPBIT = 2, // BC7 mode 1, RGB 6 bits with a P bit shared by both endpoints
+    ENDPOINT_QUANT_BC6H    = 3, // BC6H modes 11 to 14, RGB with EndpointMode::precision bits
+};
+
+struct QuantizedEndpoints
+{
+    uint32_t bits[2][4]    = {}; // Quantized channel values without P bits
+    uint32_t pbits[2]      = {};
+    float    decoded[2][4] = {}; // Values the GPU decodes to, same range as BlockPixels
+};
+
+// Everything needed to fit one set of endpoints
+struct EndpointMode
+{
+    EndpointQuant quant       = ENDPOINT_QUANT_565;
+    uint32_t      numChannels = 3;
+    uint32_t      numIndices  = 4;
+    const float*  fractions   = nullptr; // Position of each index between endpoint 0 and 1
+    const int*    weights     = nullptr; // BC6H and BC7 6-bit interpolation weights, null for BC1
+    float         maxValue    = 255.0f;
+    uint32_t      precision   = 0; // BC6H endpoint bits
+    uint32_t      deltaBits   = 0; // BC6H bits of the second endpoint's delta, 0 if it isn't delta coded
+};
+
+struct SubsetFit
+{
+    QuantizedEndpoints endpoints;
+    uint8_t            indices[16] = {};
+    float              error       = FLT_MAX;
+};
+
+// BC1 index order, index 2 and 3 are the interpolated colors
+const float kBC1Fractions[4] = {0.0f, 1.0f, 1.0f / 3.0f, 2.0f / 3.0f};
+
+const int kBC7Weights3[8]  = {0, 9, 18, 27, 37, 46, 55, 64};
+const int kBC7Weights4[16] = {0, 4, 9, 13, 17, 21, 26, 30, 34, 38, 43, 47, 51, 55, 60, 64};
+
+// Weights as fractions for least squares fitting
+#define BC7_FRACTION(w) (static_cast<float>(w) / 64.0f)
+const float kBC7Fractions3[8] = {
+    BC7_FRACTION(0), BC7_FRACTION(9), BC7_FRACTION(18), BC7_FRACTION(27), BC7_FRACTION(37), BC7_FRACTION(46), BC7_FRACTION(55), BC7_FRACTION(64)};
+const float kBC7Fractions4[16] = {
+    BC7_FRACTION(0),  BC7_FRACTION(4),  BC7_FRACTION(9),  BC7_FRACTION(13), BC7_FRACTION(17), BC7_FRACTION(21), BC7_FRACTION(26), BC7_FRACTION(30),
+    BC7_FRACTION(34), BC7_FRACTION(38), BC7_FRACTION(43), BC7_FRACTION(47), BC7_FRACTION(51), BC7_FRACTION(55), BC7_FRACTION(60), BC7_FRACTION(64)};
+#undef BC7_FRACTION
+
+// BC7 two subset partitions, one entry per pixel in raster order
+const uint8_t kBC7Partitions2[64][16] = {
+    {0, 0, 1, 1, 0, 0, 1, 1, 0, 0, 1, 1, 0, 0, 1, 1},
+    {0, 0, 0, 1, 0, 0, 0, 1, 0, 0, 0, 1, 0, 0, 0, 1},
+    {0, 1, 1, 1, 0, 1, 1, 1, 0, 1, 1, 1, 0, 1, 1, 1},
+    {0, 0, 0, 1, 0, 0, 1, 1, 0, 0, 1, 1, 0, 1, 1, 1},
+    {0, 0, 0, 0, 0, 0, 0, 1, 0, 0, 0, 1, 0, 0, 1, 1},
+    {0, 0, 1, 1, 0, 1, 1, 1, 0, 1, 1, 1, 1, 1, 1, 1},
+    {0, 0, 0, 1, 0, 0, 1, 1, 0, 1, 1, 1, 1, 1, 1, 1},
+    {0, 0, 0, 0, 0, 0, 0, 1, 0, 0, 1, 1, 0, 1, 1, 1},
+    {0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 1, 0, 0, 1, 1},
+    {0, 0, 1, 1, 0, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1},
+    {0, 0, 0, 0, 0, 0, 0, 1, 0, 1, 1, 1, 1, 1, 1, 1},
+    {0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 1, 0, 1, 1, 1},
+    {0, 0, 0, 1, 0, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1},
+    {0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 1, 1, 1, 1},
+    {0, 0, 0, 0, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1},
+    {0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1},
+    {0, 0, 0, 0, 1, 0, 0, 0, 1, 1, 1, 0, 1, 1, 1, 1},
+    {0, 1, 1, 1, 0, 0, 0, 1, 0, 0, 0, 0, 0, 0, 0, 0},
+    {0, 0, 0, 0, 0, 0, 0, 0, 1, 0, 0, 0, 1, 1, 1, 0},
+    {0, 1, 1, 1, 0, 0, 1, 1, 0, 0, 0, 1, 0, 0, 0, 0},
+    {0, 0, 1, 1, 0, 0, 0, 1, 0, 0, 0, 0, 0, 0, 0, 0},
+    {0, 0, 0, 0, 1, 0, 0, 0, 1, 1, 0, 0, 1, 1, 1, 0},
+    {0, 0, 0, 0, 0, 0, 0, 0, 1, 0, 0, 0, 1, 1, 0, 0},
+    {0, 1, 1, 1, 0, 0, 1, 1, 0, 0, 1, 1, 0, 0, 0, 1},
+    {0, 0, 1, 1, 0, 0, 0, 1, 0, 0, 0, 1, 0, 0, 0, 0},
+    {0, 0, 0, 0, 1, 0, 0, 0, 1, 0, 0, 0, 1, 1, 0, 0},
+    {0, 1, 1, 0, 0, 1, 1, 0, 0, 1, 1, 0, 0, 1, 1, 0},
+    {0, 0, 1, 1, 0, 1, 1, 0, 0, 1, 1, 0, 1, 1, 0, 0},
+    {0, 0, 0, 1, 0, 1, 1, 1, 1, 1, 1, 0, 1, 0, 0, 0},
+    {0, 0, 0, 0, 1, 1, 1, 1, 1, 1, 1, 1, 0, 0, 0, 0},
+    {0, 1, 1, 1, 0, 0, 0, 1, 1, 0, 0, 0, 1, 1, 1, 0},
+    {0, 0, 1, 1, 1, 0, 0, 1, 1, 0, 0, 1, 1, 1, 0, 0},
+    {0, 1, 0, 1, 0, 1, 0, 1, 0, 1, 0, 1, 0, 1, 0, 1},
+    {0, 0, 0, 0, 1, 1, 1, 1, 0, 0, 0, 0, 1, 1, 1, 1},
+    {0, 1, 0, 1, 1, 0, 1, 0, 0, 1, 0, 1, 1, 0, 1, 0},
+    {0, 0, 1, 1, 0, 0, 1, 1, 1, 1, 0, 0, 1, 1, 0, 0},
+    {0, 0, 1, 1, 1, 1, 0, 0, 0, 0, 1, 1, 1, 1, 0, 0},
+    {0, 1, 0, 1, 0, 1, 0, 1, 1, 0, 1, 0, 1, 0, 1, 0},
+    {0, 1, 1, 0, 1, 0, 0, 1, 0, 1, 1, 0, 1, 0, 0, 1},
+    {0, 1, 0, 1, 1, 0, 1, 0, 1, 0, 1, 0, 0, 1, 0, 1},
+    {0, 1, 1, 1, 0, 0, 1, 1, 1, 1, 0, 0, 1, 1, 1, 0},
+    {0, 0, 0, 1, 0, 0, 1, 1, 1, 1, 0, 0, 1, 0, 0, 0},
+    {0, 0, 1, 1, 0, 0, 1, 0, 0, 1, 0, 0, 1, 1, 0, 0},
+    {0, 0, 1, 1, 1, 0, 1, 1, 1, 1, 0, 1, 1, 1, 0, 0},
+    {0, 1, 1, 0, 1, 0, 0, 1, 1, 0, 0, 1, 0, 1, 1, 0},
+    {0, 0, 1, 1, 1, 1, 0, 0, 1, 1, 0, 0, 0, 0, 1, 1},
+    {0, 1, 1, 0, 0, 1, 1, 0, 1, 0, 0, 1, 1, 0, 0, 1},
+    {0, 0, 0, 0, 0, 1, 1, 0, 0, 1, 1, 0, 0, 0, 0, 0},
+    {0, 1, 0, 0, 1, 1, 1, 0, 0, 1, 0, 0, 0, 0, 0, 0},
+    {0, 0, 1, 0, 0, 1, 1, 1, 0, 0, 1, 0, 0, 0, 0, 0},
+    {0, 0, 0, 0, 0, 0, 1, 0, 0, 1, 1, 1, 0, 0, 1, 0},
+    {0, 0, 0, 0, 0, 1, 0, 0, 1, 1, 1, 0, 0, 1, 0, 0},
+    {0, 1, 1, 0, 1, 1, 0, 0, 1, 0, 0, 1, 0, 0, 1, 1},
+    {0, 0, 1, 1, 0, 1, 1, 0, 1, 1, 0, 0, 1, 0, 0, 1},
+    {0, 1, 1, 0, 0, 0, 1, 1, 1, 0, 0, 1, 1, 1, 0, 0},
+    {0, 0, 1, 1, 1, 0, 0, 1, 1, 1, 0, 0, 0, 1, 1, 0},
+    {0, 1, 1, 0, 1, 1, 0, 0, 1, 1, 0, 0, 1, 0, 0, 1},
+    {0, 1, 1, 0, 0, 0, 1, 1, 0, 0, 1, 1, 1, 0, 0, 1},
+    {0, 1, 1, 1, 1, 1, 1, 0, 1, 0, 0, 0, 0, 0, 0, 1},
+    {0, 0, 0, 1, 1, 0, 0, 0, 1, 1, 1, 0, 0, 1, 1, 1},
+    {0, 0, 0, 0, 1, 1, 1, 1, 0, 0, 1, 1, 0, 0, 1, 1},
+    {0, 0, 1, 1, 0, 0, 1, 1, 1, 1, 1, 1, 0, 0, 0, 0},
+    {0, 0, 1, 0, 0, 0, 1, 0, 1, 1, 1, 0, 1, 1, 1, 0},
+    {0, 1, 0, 0, 0, 1, 0, 0, 0, 1, 1, 1, 0, 1, 1, 1},
+};
+
+// Anchor pixel of the second subset, the first subset's anchor is always pixel 0
+const uint8_t kBC7Anchors2[64] = {
+    15, 15, 15, 15, 15, 15, 15, 15,
+    15, 15, 15, 15, 15, 15, 15, 15,
+    15,  2,  8,  2,  2,  8,  8, 15,
+     2,  8,  2,  2,  8,  8,  2,  2,
+    15, 15,  6,  8,  2,  8, 15, 15,
+     2,  8,  2,  2,  2, 15, 15,  6,
+     6,  2,  6,  8, 15, 15,  2,  2,
+    15, 15, 15, 15, 15,  2,  2, 15,
+};
+
+// Mode 1 partitions fully encoded per quality, FAST only uses mode 6
+const uint32_t kBC7NumPartitionCandidates[3] = {0, 4, 16};
+
+// Least squares passes per quality
+const uint32_t kNumRefineIterations[3] = {0, 2, 4};
+
+// Packs little endian bit fields into a 128-bit block
+class BlockWriter
+{
+public:
+    void Put(uint32_t value, uint32_t numBits)
+    {
+        for (uint32_t i = 0; i < numBits; ++i, ++mBit)
+        {
+            if ((value >> i) & 1)
+            {
+                mBytes[mBit >> 3] |= static_cast<uint8_t>(1 << (mBit & 7));
+            }
+        }
+    }
+
+    void CopyTo(char* pDst) const
+    {
+        assert((mBit == 128) && "incomplete BC7 block");
+        memcpy(pDst, mBytes, 16);
+    }
+
+private:
+    uint8_t  mBytes[16] = {};
+    uint32_t mBit       = 0;
+};
+
+// Largest finite half float
+#define BC_MAX_HALF_BITS 0x7BFF
+
+// Unsigned half float bits, rounded to nearest even. Negative values and
+// NaN become 0, values past the half float range clamp to the largest
+// finite half.
+uint32_t FloatToHalfBitsUnsigned(float value)
+{
+    if (!(value > 0.0f))
+    {
+        return 0;
+    }
+    if (value >= 65504.0f)
+    {
+        return BC_MAX_HALF_BITS;
+    }
+
+    uint32_t bits = 0;
+    memcpy(&bits, &value, sizeof(bits));
+
+    const int32_t exponent = static_cast<int32_t>(bits >> 23) - 127 + 15;
+    uint32_t      mantissa = bits & 0x7FFFFF;
+    uint32_t      shift    = 13;
+    uint32_t      half     = 0;
+    if (exponent <= 0)
+    {
+        // Denormal
+        if (exponent < -10)
+        {
+            return 0;
+        }
+        mantissa |= 0x800000;
+        shift = static_cast<uint32_t>(14 - exponent);
+        half  = mantissa >> shift;
+    }
+    else
+    {
+        half = (static_cast<uint32_t>(exponent) << 10) | (mantissa >> shift);
+    }
+
+    const uint32_t remainder = mantissa & ((1u << shift) - 1);
+    const uint32_t halfway   = 1u << (shift - 1);
+    if ((remainder > halfway) || ((remainder == halfway) && (half & 1)))
+    {
+        ++half;
+    }
+    return std::min<uint32_t>(half, BC_MAX_HALF_BITS);
+}
+
+float HalfBitsToFloat(uint32_t half)
+{
+    const int exponent = static_cast<int>((half >> 10) & 0x1F);
+    const int mantissa = static_cast<int>(half & 0x3FF);
+    if (exponent == 0)
+    {
+        return ldexpf(static_cast<float>(mantissa), -24);
+    }
+    return ldexpf(static_cast<float>(mantissa | 0x400), exponent - 25);
+}
+
+// A level of the source image
+struct LevelSource
+{
+    const char* pPixels   = nullptr;
+    uint32_t    rowStride = 0;
+    uint32_t    width     = 0;
+    uint32_t    height    = 0;
+
+    template <typename PixelT>
+    const PixelT* GetRow(uint32_t y) const
+    {
+        return reinterpret_cast<const PixelT*>(pPixels + (static_cast<size_t>(y) * rowStride));
+    }
+};
+
+// Gathers a 4x4 block, edges of partial blocks are repeated
+void LoadBlock(const LevelSource& level, uint32_t blockX, uint32_t blockY, BlockPixels* pPixels)
+{
+    for (uint32_t y = 0; y < 4; ++y)
+    {
+        const PixelRGBA8u* pRow = level.GetRow<PixelRGBA8u>(std::min(4 * blockY + y, level.height - 1));
+        for (uint32_t x = 0; x < 4; ++x)
+        {
+            const uint32_t srcX = std::min(4 * blockX + x, level.width - 1);
+            const uint32_t i    = 4 * y + x;
+            pPixels->r[i]       = pRow[srcX].r;
+            pPixels->g[i]       = pRow[srcX].g;
+            pPixels->b[i]       = pRow[srcX].b;
+            pPixels->a[i]       = pRow[srcX].a;
+        }
+    }
+    pPixels->count = 16;
+}
+
+// Same as LoadBlock, RGB as half float bits for BC6H
+void LoadBlockHDR(const LevelSource& level, uint32_t blockX, uint32_t blockY, BlockPixels* pPixels)
+{
+    for (uint32_t y = 0; y < 4; ++y)
+    {
+        const PixelRGBA32f* pRow = level.GetRow<PixelRGBA32f>(std::min(4 * blockY + y, level.height - 1));
+        for (uint32_t x = 0; x < 4; ++x)
+        {
+            const uint32_t srcX = std::min(4 * blockX + x, level.width - 1);
+            const uint32_t i    = 4 * y + x;
+            pPixels->r[i]       = static_cast<float>(FloatToHalfBitsUnsigned(pRow[srcX].r));
+            pPixels->g[i]       = static_cast<float>(FloatToHalfBitsUnsigned(pRow[srcX].g));
+            pPixels->b[i]       = static_cast<float>(FloatToHalfBitsUnsigned(pRow[srcX].b));
+            pPixels->a[i]       = 0;
+        }
+    }
+    pPixels->count = 16;
+}
+
+// Nearest palette color for each pixel, returns the total squared error.
+// Alpha is only compared when numChannels is 4.
+float FindIndices(const BlockPixels& pixels, const BlockPalette& palette, uint32_t numChannels, uint8_t* pIndices)
+{
+    alignas(16) float   errors[16];
+    alignas(16) int32_t indices[16];
+
+#if defined(GREX_BC_X64)
+    const __m128 alphaMask = _mm_castsi128_ps(_mm_set1_epi32((numChannels == 4) ? -1 : 0));
+    for (uint32_t i = 0; i < pixels.count; i += 4)
+    {
+        const __m128 pr = _mm_load_ps(&pixels.r[i]);
+        const __m128 pg = _mm_load_ps(&pixels.g[i]);
+        const __m128 pb = _mm_load_ps(&pixels.b[i]);
+        const __m128 pa = _mm_load_ps(&pixels.a[i]);
+
+        __m128  bestError = _mm_set1_ps(FLT_MAX);
+        __m128i bestIndex = _mm_setzero_si128();
+        for (uint32_t k = 0; k < palette.count; ++k)
+        {
+            const __m128 dr = _mm_sub_ps(pr, _mm_set1_ps(palette.r[k]));
+            const __m128 dg = _mm_sub_ps(pg, _mm_set1_ps(palette.g[k]));
+            const __m128 db = _mm_sub_ps(pb, _mm_set1_ps(palette.b[k]));
+            const __m128 da = _mm_and_ps(_mm_sub_ps(pa, _mm_set1_ps(palette.a[k])), alphaMask);
+
+            __m128 error = _mm_add_ps(_mm_mul_ps(dr, dr), _mm_mul_ps(dg, dg));
+            error        = _mm_add_ps(error, _mm_add_ps(_mm_mul_ps(db, db), _mm_mul_ps(da, da)));
+
+            const __m128i less = _mm_castps_si128(_mm_cmplt_ps(error, bestError));
+            bestIndex          = _mm_or_si128(_mm_and_si128(less, _mm_set1_epi32(static_cast<int>(k))), _mm_andnot_si128(less, bestIndex));
+            bestError          = _mm_min_ps(error, bestError);
+        }
+        _mm_store_ps(&errors[i], bestError);
+        _mm_store_si128(reinterpret_cast<__m128i*>(&indices[i]), bestIndex);
+    }
+#else
+    for (uint32_t i = 0; i < pixels.count; ++i)
+    {
+        errors[i]  = FLT_MAX;
+        indices[i] = 0;
+        for (uint32_t k = 0; k < palette.count; ++k)
+        {
+            const float dr    = pixels.r[i] - palette.r[k];
+            const float dg    = pixels.g[i] - palette.g[k];
+            const float db    = pixels.b[i] - palette.b[k];
+            const float da    = (numChannels == 4) ? (pixels.a[i] - palette.a[k]) : 0.0f;
+            const float error = (dr * dr) + (dg * dg) + (db * db) + (da * da);
+            if (error < errors[i])
+            {
+                errors[i]  = error;
+                indices[i] = static_cast<int32_t>(k);
+            }
+        }
+    }
+#endif
+
+    float totalError = 0;
+    for (uint32_t i = 0; i < pixels.count; ++i)
+    {
+        totalError += errors[i];
+        pIndices[i] = static_cast<uint8_t>(indices[i]);
+    }
+    return totalError;
+}
+
+// Same result as FindIndices for palettes that lie on a line between their
+// first and last entry, which is true for BC6H and BC7 up to rounding. Each
+// pixel is projected onto the line and compared against the midpoints
+// between neighbouring entries instead of measuring every entry.
+float FindIndicesProjected(const BlockPixels& pixels, const BlockPalette& palette, uint32_t numChannels, uint8_t* pIndices)
+{
+    const uint32_t last = palette.count - 1;
+    const float    dr   = palette.r[last] - palette.r[0];
+    const float    dg   = palette.g[last] - palette.g[0];
+    const float    db   = palette.b[last] - palette.b[0];
+    const float    da   = (numChannels == 4) ? (palette.a[last] - palette.a[0]) : 0.0f;
+    const float    dd   = (dr * dr) + (dg * dg) + (db * db) + (da * da);
+    if (dd < 1e-6f)
+    {
+        return FindIndices(pixels, palette, numChannels, pIndices);
+    }
+
+    const float invDD = 1.0f / dd;
+    auto        Project = [&](float r, float g, float b, float a) -> float {
+        return (((r - palette.r[0]) * dr) + ((g - palette.g[0]) * dg) + ((b - palette.b[0]) * db) + ((a - palette.a[0]) * da)) * invDD;
+    };
+
+    float thresholds[15] = {};
+    float prev           = 0.0f;
+    for (uint32_t k = 0; k < last; ++k)
+    {
+        const float next = Project(palette.r[k + 1], palette.g[k + 1], palette.b[k + 1], palette.a[k + 1]);
+        thresholds[k]    = 0.5f * (prev + next);
+        prev             = next;
+    }
+
+    alignas(16) int32_t indices[16];
+
+#if defined(GREX_BC_X64)
+    const __m128 r0 = _mm_set1_ps(palette.r[0]);
+    const __m128 g0 = _mm_set1_ps(palette.g[0]);
+    const __m128 b0 = _mm_set1_ps(palette.b[0]);
+    const __m128 a0 = _mm_set1_ps(palette.a[0]);
+    for (uint32_t i = 0; i < pixels.count; i += 4)
+    {
+        __m128 t = _mm_mul_ps(_mm_sub_ps(_mm_load_ps(&pixels.r[i]), r0), _mm_set1_ps(dr));
+        t        = _mm_add_ps(t, _mm_mul_ps(_mm_sub_ps(_mm_load_ps(&pixels.g[i]), g0), _mm_set1_ps(dg)));
+        t        = _mm_add_ps(t, _mm_mul_ps(_mm_sub_ps(_mm_load_ps(&pixels.b[i]), b0), _mm_set1_ps(db)));
+        t        = _mm_add_ps(t, _mm_mul_ps(_mm_sub_ps(_mm_load_ps(&pixels.a[i]), a0), _mm_set1_ps(da)));
+        t        = _mm_mul_ps(t, _mm_set1_ps(invDD));
+
+        // Each threshold passed is -1 in the compare mask
+        __m128i index = _mm_setzero_si128();
+        for (uint32_t k = 0; k < last; ++k)
+        {
+            index = _mm_sub_epi32(index, _mm_castps_si128(_mm_cmpgt_ps(t, _mm_set1_ps(thresholds[k]))));
+        }
+        _mm_store_si128(reinterpret_cast<__m128i*>(&indices[i]), index);
+    }
+#else
+    for (uint32_t i = 0; i < pixels.count; ++i)
+    {
+        const float t = Project(pixels.r[i], pixels.g[i], pixels.b[i], pixels.a[i]);
+
+        indices[i] = 0;
+        for (uint32_t k = 0; k < last; ++k)
+        {
+            indices[i] += (t > thresholds[k]) ? 1 : 0;
+        }
+    }
+#endif
+
+    float totalError = 0;
+    for (uint32_t i = 0; i < pixels.count; ++i)
+    {
+        const uint32_t k  = static_cast<uint32_t>(indices[i]);
+        const float    er = pixels.r[i] - palette.r[k];
+        const float    eg = pixels.g[i] - palette.g[k];
+        const float    eb = pixels.b[i] - palette.b[k];
+        const float    ea = (numChannels == 4) ? (pixels.a[i] - palette.a[k]) : 0.0f;
+        totalError += (er * er) + (eg * eg) + (eb * eb) + (ea * ea);
+        pIndices[i] = static_cast<uint8_t>(k);
+    }
+    return totalError;
+}
+
+// -------------------------------------------------------------------------------------------------
+// Endpoint fitting
+// -------------------------------------------------------------------------------------------------
+
+// Mean and principal axis of the pixels
+void CalculatePrincipalAxis(const BlockPixels& pixels, uint32_t numChannels, float mean[4], float axis[4])
+{
+    const float* channels[4] = {pixels.r, pixels.g, pixels.b, pixels.a};
+
+    float lo[4] = {FLT_MAX, FLT_MAX, FLT_MAX, FLT_MAX};
+    float hi[4] = {-FLT_MAX, -FLT_MAX, -FLT_MAX, -FLT_MAX};
+    for (uint32_t c = 0; c < 4; ++c)
+    {
+        mean[c] = 0;
+        axis[c] = 0;
+    }
+    for (uint32_t c = 0; c < numChannels; ++c)
+    {
+        for (uint32_t i = 0; i < pixels.count; ++i)
+        {
+            mean[c] += channels[c][i];
+            lo[c] = std::min(lo[c], channels[c][i]);
+            hi[c] = std::max(hi[c], channels[c][i]);
+        }
+        mean[c] /= static_cast<float>(pixels.count);
+    }
+
+    float covariance[4][4] = {};
+    for (uint32_t i = 0; i < pixels.count; ++i)
+    {
+        for (uint32_t c0 = 0; c0 < numChannels; ++c0)
+        {
+            const float d0 = channels[c0][i] - mean[c0];
+            for (uint32_t c1 = c0; c1 < numChannels; ++c1)
+            {
+                covariance[c0][c1] += d0 * (channels[c1][i] - mean[c1]);
+            }
+        }
+    }
+    for (uint32_t c0 = 0; c0 < numChannels; ++c0)
+    {
+        for (uint32_t c1 = 0; c1 < c0; ++c1)
+        {
+            covariance[c0][c1] = covariance[c1][c0];
+        }
+    }
+
+    // Power iteration seeded with the bounding box diagonal
+    for (uint32_t c = 0; c < numChannels; ++c)
+    {
+        axis[c] = hi[c] - lo[c];
+    }
+    for (uint32_t iteration = 0; iteration < 6; ++iteration)
+    {
+        float next[4]   = {};
+        float maxLength = 0;
+        for (uint32_t c0 = 0; c0 < numChannels; ++c0)
+        {
+            for (uint32_t c1 = 0; c1 < numChannels; ++c1)
+            {
+                next[c0] += covariance[c0][c1] * axis[c1];
+            }
+            maxLength = std::max(maxLength, fabsf(next[c0]));
+        }
+        if (maxLength < 1e-6f)
+        {
+            break;
+        }
+        for (uint32_t c = 0; c < numChannels; ++c)
+        {
+            axis[c] = next[c] / maxLength;
+        }
+    }
+
+    float length = 0;
+    for (uint32_t c = 0; c < numChannels; ++c)
+    {
+        length += axis[c] * axis[c];
+    }
+    length = sqrtf(length);
+    for (uint32_t c = 0; c < numChannels; ++c)
+    {
+        axis[c] = (length > 1e-6f) ? (axis[c] / length) : 0.0f;
+    }
+}
+
+// Squared distance of the pixels from their principal axis, used to rank BC7 partitions
+float EstimateLineError(const BlockPixels& pixels, uint32_t numChannels)
+{
+    if (pixels.count < 2)
+    {
+        return 0;
+    }
+
+    float mean[4] = {};
+    float axis[4] = {};
+    CalculatePrincipalAxis(pixels, numChannels, mean, axis);
+
+    const float* channels[4] = {pixels.r, pixels.g, pixels.b, pixels.a};
+
+    float error = 0;
+    for (uint32_t i = 0; i < pixels.count; ++i)
+    {
+        float lengthSq = 0;
+        float t        = 0;
+        for (uint32_t c = 0; c < numChannels; ++c)
+        {
+            const float d = channels[c][i] - mean[c];
+            lengthSq += d * d;
+            t += d * axis[c];
+        }
+        error += lengthSq - (t * t);
+    }
+    return error;
+}
+
+// Endpoints at the extents of the pixels along their principal axis
+void FitEndpointsPCA(const BlockPixels& pixels, const EndpointMode& mode, float endpoints[2][4])
+{
+    const uint32_t numChannels = mode.numChannels;
+
+    float mean[4] = {};
+    float axis[4] = {};
+    CalculatePrincipalAxis(pixels, numChannels, mean, axis);
+
+    const float* channels[4] = {pixels.r, pixels.g, pixels.b, pixels.a};
+
+    float tMin = FLT_MAX;
+    float tMax = -FLT_MAX;
+    for (uint32_t i = 0; i < pixels.count; ++i)
+    {
+        float t = 0;
+        for (uint32_t c = 0; c < numChannels; ++c)
+        {
+            t += (channels[c][i] - mean[c]) * axis[c];
+        }
+        tMin = std::min(tMin, t);
+        tMax = std::max(tMax, t);
+    }
+
+    for (uint32_t c = 0; c < 4; ++c)
+    {
+        // Channels that aren't encoded still need sane values for BC1 and mode 1 alpha
+        const float base = (c < numChannels) ? mean[c] : mode.maxValue;
+        endpoints[0][c]  = std::clamp(base + axis[c] * tMin, 0.0f, mode.maxValue);
+        endpoints[1][c]  = std::clamp(base + axis[c] * tMax, 0.0f, mode.maxValue);
+    }
+}
+
+// Endpoints that minimize the squared error for fixed indices, returns
+// false if the indices don't constrain both endpoints.
+bool FitEndpointsLeastSquares(const BlockPixels& pixels, const uint8_t* pIndices, const EndpointMode& mode, float endpoints[2][4])
+{
+    const float* channels[4] = {pixels.r, pixels.g, pixels.b, pixels.a};
+
+    float aa    = 0;
+    float ab    = 0;
+    float bb    = 0;
+    float ap[4] = {};
+    float bp[4] = {};
+    for (uint32_t i = 0; i < pixels.count; ++i)
+    {
+        const float w1 = mode.fractions[pIndices[i]];
+        const float w0 = 1.0f - w1;
+        aa += w0 * w0;
+        ab += w0 * w1;
+        bb += w1 * w1;
+        for (uint32_t c = 0; c < mode.numChannels; ++c)
+        {
+            ap[c] += w0 * channels[c][i];
+            bp[c] += w1 * channels[c][i];
+        }
+    }
+
+    const float det = (aa * bb) - (ab * ab);
+    if (fabsf(det) < 1e-6f)
+    {
+        return false;
+    }
+
+    const float invDet = 1.0f / det;
+    for (uint32_t c = 0; c < mode.numChannels; ++c)
+    {
+        endpoints[0][c] = std::clamp(((bb * ap[c]) - (ab * bp[c])) * invDet, 0.0f, mode.maxValue);
+        endpoints[1][c] = std::clamp(((aa * bp[c]) - (ab * ap[c])) * invDet, 0.0f, mode.maxValue);
+    }
+    return true;
+}
+
+uint32_t QuantizeChannel(float value, uint32_t maxValue)
+{
+    return static_cast<uint32_t>(std::clamp(value * static_cast<float>(maxValue) / 255.0f + 0.5f, 0.0f, static_cast<float>(maxValue)));
+}
+
+// 7-bit BC7 value with its P bit, as the GPU expands it to 8 bits
+uint32_t ExpandBC7Mode1(uint32_t bits, uint32_t pbit)
+{
+    const uint32_t value = (bits << 1) | pbit;
+    return (value << 1) | (value >> 6);
+}
+
+// BC6H endpoint to 16 bits, unsigned formats only
+int UnquantizeBC6H(int value, uint32_t precision)
+{
+    if (precision >= 15)
+    {
+        return value;
+    }
+    if (value == 0)
+    {
+        return 0;
+    }
+    if (value == ((1 << precision) - 1))
+    {
+        return 0xFFFF;
+    }
+    return ((value << 16) + 0x8000) >> precision;
+}
+
+// Interpolated 16-bit BC6H value to half float bits
+int FinishUnquantizeBC6H(int value)
+{
+    return (value * 31) >> 6;
+}
+
+uint32_t QuantizeBC6H(float value, uint32_t precision)
+{
+    // Unquantize and finish scale by 2^(16 - precision) * 31/64, the
+    // rounding of both steps can be one off
+    const uint32_t maxBits = (1u << precision) - 1;
+    const float    scale   = static_cast<float>(1u << precision) * 64.0f / (31.0f * 65536.0f);
+    const uint32_t guess   = static_cast<uint32_t>(std::clamp(value * scale + 0.5f, 0.0f, static_cast<float>(maxBits)));
+
+    uint32_t bestBits  = guess;
+    float    bestDelta = FLT_MAX;
+    for (uint32_t candidate = (guess > 0) ? (guess - 1) : 0; candidate <= std::min(guess + 1, maxBits); ++candidate)
+    {
+        const float delta = fabsf(static_cast<float>(FinishUnquantizeBC6H(UnquantizeBC6H(static_cast<int>(candidate), precision))) - value);
+        if (delta < bestDelta)
+        {
+            bestDelta = delta;
+            bestBits  = candidate;
+        }
+    }
+    return bestBits;
+}
+
+// Delta coded modes can only store endpoints that are close together
+bool IsRepresentableBC6H(const QuantizedEndpoints& endpoints, const EndpointMode& mode)
+{
+    if (mode.deltaBits == 0)
+    {
+        return true;
+    }
+
+    const int minDelta = -(1 << (mode.deltaBits - 1));
+    const int maxDelta = (1 << (mode.deltaBits - 1)) - 1;
+    for (uint32_t c = 0; c < 3; ++c)
+    {
+        const int delta = static_cast<int>(endpoints.bits[1][c]) - static_cast<int>(endpoints.bits[0][c]);
+        if ((delta < minDelta) || (delta > maxDelta))
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+void QuantizeEndpoints(const float endpoints[2][4], const EndpointMode& mode, QuantizedEndpoints* pQuantized)
+{
+    QuantizedEndpoints& q = *pQuantized;
+
+    switch (mode.quant)
+    {
+        case ENDPOINT_QUANT_565: {
+            for (uint32_t e = 0; e < 2; ++e)
+            {
+                q.bits[e][0]    = QuantizeChannel(endpoints[e][0], 31);
+                q.bits[e][1]    = QuantizeChannel(endpoints[e][1], 63);
+                q.bits[e][2]    = QuantizeChannel(endpoints[e][2], 31);
+                q.decoded[e][0] = static_cast<float>((q.bits[e][0] << 3) | (q.bits[e][0] >> 2));
+                q.decoded[e][1] = static_cast<float>((q.bits[e][1] << 2) | (q.bits[e][1] >> 4));
+                q.decoded[e][2] = static_cast<float>((q.bits[e][2] << 3) | (q.bits[e][2] >> 2));
+                q.decoded[e][3] = 255.0f;
+            }
+        }
+        break;
+
+        // 8-bit value is (bits << 1) | pbit, pick the P bit that lands closer
+        case ENDPOINT_QUANT_7_PBIT: {
+            for (uint32_t e = 0; e < 2; ++e)
+            {
+                float    bestError   = FLT_MAX;
+                uint32_t bestBits[4] = {};
+                uint32_t bestPBit    = 0;
+                for (uint32_t pbit = 0; pbit < 2; ++pbit)
+                {
+                    uint32_t bits[4] = {};
+                    float    error   = 0;
+                    for (uint32_t c = 0; c < 4; ++c)
+                    {
+                        const float value = (endpoints[e][c] - static_cast<float>(pbit)) * 0.5f + 0.5f;
+                        bits[c]           = static_cast<uint32_t>(std::clamp(value, 0.0f, 127.0f));
+                        const float d     = static_cast<float>((bits[c] << 1) | pbit) - endpoints[e][c];
+                        error += d * d;
+                    }
+                    if (error < bestError)
+                    {
+                        bestError = error;
+                        bestPBit  = pbit;
+                        memcpy(bestBits, bits, sizeof(bits));
+                    }
+                }
+                q.pbits[e] = bestPBit;
+                for (uint32_t c = 0; c < 4; ++c)
+                {
+                    q.bits[e][c]    = bestBits[c];
+                    q.decoded[e][c] = static_cast<float>((bestBits[c] << 1) | bestPBit);
+                }
+            }
+        }
+        break;
+
+        // Both endpoints share the P bit, alpha is always 255
+        case ENDPOINT_QUANT_6_SPBIT: {
+            float bestError = FLT_MAX;
+            for (uint32_t pbit = 0; pbit < 2; ++pbit)
+            {
+                uint32_t bits[2][3] = {};
+                float    error      = 0;
+                for (uint32_t e = 0; e < 2; ++e)
+                {
+                    for (uint32_t c = 0; c < 3; ++c)
+                    {
+                        // Rounding through 7 bits can be one step off, check the neighbours
+                        const float    value     = (endpoints[e][c] * 127.0f / 255.0f - static_cast<float>(pbit)) * 0.5f + 0.5f;
+                        const uint32_t guess     = static_cast<uint32_t>(std::clamp(value, 0.0f, 63.0f));
+                        float          bestDelta = FLT_MAX;
+                        for (uint32_t candidate = (guess > 0) ? (guess - 1) : 0; candidate <= std::min(guess + 1, 63u); ++candidate)
+                        {
+                            const float d = static_cast<float>(ExpandBC7Mode1(candidate, pbit)) - endpoints[e][c];
+                            if ((d * d) < bestDelta)
+                            {
+                                bestDelta  = d * d;
+                                bits[e][c] = candidate;
+                            }
+                        }
+                        error += bestDelta;
+                    }
+                }
+                if (error < bestError)
+                {
+                    bestError  = error;
+                    q.pbits[0] = pbit;
+                    q.pbits[1] = pbit;
+                    for (uint32_t e = 0; e < 2; ++e)
+                    {
+                        for (uint32_t c = 0; c < 3; ++c)
+                        {
+                            q.bits[e][c]    = bits[e][c];
+                            q.decoded[e][c] = static_cast<float>(ExpandBC7Mode1(bits[e][c], pbit));
+                        }
+                        q.decoded[e][3] = 255.0f;
+                    }
+                }
+            }
+        }
+        break;
+
+        case ENDPOINT_QUANT_BC6H: {
+            for (uint32_t e = 0; e < 2; ++e)
+            {
+                for (uint32_t c = 0; c < 3; ++c)
+                {
+                    q.bits[e][c]    = QuantizeBC6H(endpoints[e][c], mode.precision);
+                    q.decoded[e][c] = static_cast<float>(FinishUnquantizeBC6H(UnquantizeBC6H(static_cast<int>(q.bits[e][c]), mode.precision)));
+                }
+            }
+        }
+        break;
+    }
+}
+
+void BuildPalette(const QuantizedEndpoints& endpoints, const EndpointMode& mode, BlockPalette* pPalette)
+{
+    float* channels[4] = {pPalette->r, pPalette->g, pPalette->b, pPalette->a};
+
+    pPalette->count = mode.numIndices;
+
+    // BC6H interpolates the unquantized endpoints before the final scale
+    if (mode.quant == ENDPOINT_QUANT_BC6H)
+    {
+        for (uint32_t c = 0; c < 3; ++c)
+        {
+            const int e0 = UnquantizeBC6H(static_cast<int>(endpoints.bits[0][c]), mode.precision);
+            const int e1 = UnquantizeBC6H(static_cast<int>(endpoints.bits[1][c]), mode.precision);
+            for (uint32_t i = 0; i < mode.numIndices; ++i)
+            {
+                const int w    = mode.weights[i];
+                channels[c][i] = static_cast<float>(FinishUnquantizeBC6H((((64 - w) * e0) + (w * e1) + 32) >> 6));
+            }
+        }
+        return;
+    }
+
+    for (uint32_t i = 0; i < mode.numIndices; ++i)
+    {
+        for (uint32_t c = 0; c < 4; ++c)
+        {
+            const float e0 = endpoints.decoded[0][c];
+            const float e1 = endpoints.decoded[1][c];
+            if (IsNull(mode.weights))
+            {
+                channels[c][i] = e0 + (e1 - e0) * mode.fractions[i];
+            }
+            else
+            {
+                const int w    = mode.weights[i];
+                channels[c][i] = static_cast<float>((((64 - w) * static_cast<int>(e0)) + (w * static_cast<int>(e1)) + 32) >> 6);
+            }
+        }
+    }
+}
+
+// Quantizes the endpoints and keeps the result if it beats the current fit
+bool TryEndpoints(const BlockPixels& pixels, const float endpoints[2][4], const EndpointMode& mode, SubsetFit* pFit)
+{
+    SubsetFit candidate = {};
+    QuantizeEndpoints(endpoints, mode, &candidate.endpoints);
+
+    // Skip the search if the delta doesn't fit in either endpoint order
+    if ((mode.quant == ENDPOINT_QUANT_BC6H) && (mode.deltaBits > 0))
+    {
+        const int maxDelta = 1 << (mode.deltaBits - 1);
+        for (uint32_t c = 0; c < 3; ++c)
+        {
+            const int delta = static_cast<int>(candidate.endpoints.bits[1][c]) - static_cast<int>(candidate.endpoints.bits[0][c]);
+            if (abs(delta) > maxDelta)
+            {
+                return false;
+            }
+        }
+    }
+
+    BlockPalette palette = {};
+    BuildPalette(candidate.endpoints, mode, &palette);
+
+    // BC1 palettes aren't in line order
+    if (mode.quant == ENDPOINT_QUANT_565)
+    {
+        candidate.error = FindIndices(pixels, palette, mode.numChannels, candidate.indices);
+    }
+    else
+    {
+        candidate.error = FindIndicesProjected(pixels, palette, mode.numChannels, candidate.indices);
+    }
+
+    // BC6H anchor index drops its high bit, swap here since it changes the delta
+    if (mode.quant == ENDPOINT_QUANT_BC6H)
+    {
+        if (candidate.indices[0] & 0x8)
+        {
+            std::swap(candidate.endpoints.bits[0], candidate.endpoints.bits[1]);
+            std::swap(candidate.endpoints.decoded[0], candidate.endpoints.decoded[1]);
+            for (uint32_t i = 0; i < pixels.count; ++i)
+            {
+                candidate.indices[i] = static_cast<uint8_t>(15 - candidate.indices[i]);
+            }
+        }
+        if (!IsRepresentableBC6H(candidate.endpoints, mode))
+        {
+            return false;
+        }
+    }
+
+    if (candidate.error < pFit->error)
+    {
+        *pFit = candidate;
+        return true;
+    }
+    return false;
+}
+
+// Fits one set of endpoints to the pixels
+void FitSubset(const BlockPixels& pixels, const EndpointMode& mode, BCQuality quality, SubsetFit* pFit)
+{
+    float endpoints[2][4] = {};
+    FitEndpointsPCA(pixels, mode, endpoints);
+    TryEndpoints(pixels, endpoints, mode, pFit);
+
+    for (uint32_t iteration = 0; iteration < kNumRefineIterations[quality]; ++iteration)
+    {
+        if (pFit->error == 0)
+        {
+            return;
+        }
+
+        float refined[2][4] = {};
+        memcpy(refined, pFit->endpoints.decoded, sizeof(refined));
+        if (!FitEndpointsLeastSquares(pixels, pFit->indices, mode, refined) || !TryEndpoints(pixels, refined, mode, pFit))
+        {
+            break;
+        }
+    }
+
+    // Nudge each channel of each endpoint by one quantization step
+    if (quality == BC_QUALITY_HIGH)
+    {
+        const float bc6hStep    = static_cast<float>(1u << (16 - std::min(mode.precision, 16u))) * 31.0f / 64.0f;
+        const float steps[4][4] = {
+            {255.0f / 31.0f, 255.0f / 63.0f, 255.0f / 31.0f, 0.0f},
+            {2.0f, 2.0f, 2.0f, 2.0f},
+            {4.0f, 4.0f, 4.0f, 0.0f},
+            {bc6hStep, bc6hStep, bc6hStep, 0.0f},
+        };
+
+        bool improved = true;
+        for (uint32_t pass = 0; improved && (pass < 2) && (pFit->error > 0); ++pass)
+        {
+            improved = false;
+            for (uint32_t e = 0; e < 2; ++e)
+            {
+                for (uint32_t c = 0; c < mode.numChannels; ++c)
+                {
+                    for (float sign : {-1.0f, 1.0f})
+                    {
+                        float nudged[2][4] = {};
+                        memcpy(nudged, pFit->endpoints.decoded, sizeof(nudged));
+                        nudged[e][c] = std::clamp(nudged[e][c] + sign * steps[mode.quant][c], 0.0f, mode.maxValue);
+                        improved |= TryEndpoints(pixels, nudged, mode, pFit);
+                    }
+                }
+            }
+        }
+    }
+}
+
+// -------------------------------------------------------------------------------------------------
+// Block encoders
+// -------------------------------------------------------------------------------------------------
+
+void EncodeBC1(const BlockPixels& pixels, BCQuality quality, char* pBlock)
+{
+    EndpointMode mode = {};
+    mode.quant        = ENDPOINT_QUANT_565;
+    mode.numChannels  = 3;
+    mode.numIndices   = 4;
+    mode.fractions    = kBC1Fractions;
+
+    SubsetFit fit = {};
+    FitSubset(pixels, mode, quality, &fit);
+
+    uint16_t color0 = static_cast<uint16_t>((fit.endpoints.bits[0][0] << 11) | (fit.endpoints.bits[0][1] << 5) | fit.endpoints.bits[0][2]);
+    uint16_t color1 = static_cast<uint16_t>((fit.endpoints.bits[1][0] << 11) | (fit.endpoints.bits[1][1] << 5) | fit.endpoints.bits[1][2]);
+
+    // 4 color mode needs color0 > color1
+    uint32_t indexMap[4] = {0, 1, 2, 3};
+    if (color0 < color1)
+    {
+        std::swap(color0, color1);
+        indexMap[0] = 1;
+        indexMap[1] = 0;
+        indexMap[2] = 3;
+        indexMap[3] = 2;
+    }
+    else if (color0 == color1)
+    {
+        // 3 color mode, index 0 is the only color
+        indexMap[1] = 0;
+        indexMap[2] = 0;
+        indexMap[3] = 0;
+    }
+
+    uint32_t indices = 0;
+    for (uint32_t i = 0; i < 16; ++i)
+    {
+        indices |= indexMap[fit.indices[i]] << (2 * i);
+    }
+
+    memcpy(pBlock + 0, &color0, 2);
+    memcpy(pBlock + 2, &color1, 2);
+    memcpy(pBlock + 4, &indices, 4);
+}
+
+// Single channel block, 8 interpolated values between max and min
+void EncodeBC4(const float* pValues, BCQuality quality, char* pBlock)
+{
+    float lo = 255.0f;
+    float hi = 0.0f;
+    for (uint32_t i = 0; i < 16; ++i)
+    {
+        lo = std::min(lo, pValues[i]);
+        hi = std::max(hi, pValues[i]);
+    }
+
+    // Index 0 and 1 are the endpoints, index 2..7 step from endpoint 0 to endpoint 1
+    auto Encode8 = [pValues](uint32_t e0, uint32_t e1, uint8_t* pIndices) -> float {
+        if (e0 == e1)
+        {
+            memset(pIndices, 0, 16);
+            float error = 0;
+            for (uint32_t i = 0; i < 16; ++i)
+            {
+                const float d = pValues[i] - static_cast<float>(e0);
+                error += d * d;
+            }
+            return error;
+        }
+
+        const float scale = 7.0f / static_cast<float>(static_cast<int>(e0) - static_cast<int>(e1));
+        float       error = 0;
+        for (uint32_t i = 0; i < 16; ++i)
+        {
+            const uint32_t step = static_cast<uint32_t>(std::clamp((static_cast<float>(e0) - pValues[i]) * scale + 0.5f, 0.0f, 7.0f));
+            pIndices[i]         = static_cast<uint8_t>((step == 0) ? 0 : ((step == 7) ? 1 : (step + 1)));
+
+            const float value = (static_cast<float>((7 - step) * e0 + step * e1)) / 7.0f;
+            const float d     = pValues[i] - value;
+            error += d * d;
+        }
+        return error;
+    };
+
+    uint32_t endpoint0 = static_cast<uint32_t>(hi);
+    uint32_t endpoint1 = static_cast<uint32_t>(lo);
+    uint8_t  indices[16];
+    float    error = Encode8(endpoint0, endpoint1, indices);
+
+    // Least squares on the step positions, the endpoints can move inward
+    if ((quality != BC_QUALITY_FAST) && (error > 0) && (endpoint0 != endpoint1))
+    {
+        for (uint32_t iteration = 0; iteration < kNumRefineIterations[quality]; ++iteration)
+        {
+            float aa = 0, ab = 0, bb = 0, ap = 0, bp = 0;
+            for (uint32_t i = 0; i < 16; ++i)
+            {
+                const uint32_t step = (indices[i] == 0) ? 0 : ((indices[i] == 1) ? 7 : (indices[i] - 1));
+                const float    w1   = static_cast<float>(step) / 7.0f;
+                const float    w0   = 1.0f - w1;
+                aa += w0 * w0;
+                ab += w0 * w1;
+                bb += w1 * w1;
+                ap += w0 * pValues[i];
+                bp += w1 * pValues[i];
+            }
+            const float det = (aa * bb) - (ab * ab);
+            if (fabsf(det) < 1e-6f)
+            {
+                break;
+            }
+
+            const uint32_t e0 = static_cast<uint32_t>(std::clamp(((bb * ap) - (ab * bp)) / det + 0.5f, 0.0f, 255.0f));
+            const uint32_t e1 = static_cast<uint32_t>(std::clamp(((aa * bp) - (ab * ap)) / det + 0.5f, 0.0f, 255.0f));
+            if (e0 <= e1)
+            {
+                break;
+            }
+
+            uint8_t     candidateIndices[16];
+            const float candidateError = Encode8(e0, e1, candidateIndices);
+            if (candidateError >= error)
+            {
+                break;
+            }
+            endpoint0 = e0;
+            endpoint1 = e1;
+            error     = candidateError;
+            memcpy(indices, candidateIndices, 16);
+        }
+    }
+
+    // 6 interpolated values plus exact 0 and 255, helps blocks with a few extreme values
+    if ((quality == BC_QUALITY_HIGH) && (error > 0))
+    {
+        float innerLo = 255.0f;
+        float innerHi = 0.0f;
+        for (uint32_t i = 0; i < 16; ++i)
+        {
+            if ((pValues[i] > 0.0f) && (pValues[i] < 255.0f))
+            {
+                innerLo = std::min(innerLo, pValues[i]);
+                innerHi = std::max(innerHi, pValues[i]);
+            }
+        }
+        if (innerLo > innerHi)
+        {
+            innerLo = innerHi = 0.0f;
+        }
+
+        const uint32_t e0 = static_cast<uint32_t>(innerLo);
+        const uint32_t e1 = static_cast<uint32_t>(std::ceil(innerHi));
+
+        float palette[8] = {static_cast<float>(e0), static_cast<float>(e1), 0, 0, 0, 0, 0.0f, 255.0f};
+        for (uint32_t i = 2; i < 6; ++i)
+        {
+            palette[i] = static_cast<float>((6 - i) * e0 + (i - 1) * e1) / 5.0f;
+        }
+
+        uint8_t candidateIndices[16];
+        float   candidateError = 0;
+        for (uint32_t i = 0; i < 16; ++i)
+        {
+            float best = FLT_MAX;
+            for (uint32_t k = 0; k < 8; ++k)
+            {
+                const float d = pValues[i] - palette[k];
+                if ((d * d) < best)
+                {
+                    best                = d * d;
+                    candidateIndices[i] = static_cast<uint8_t>(k);
+                }
+            }
+            candidateError += best;
+        }
+
+        // e0 <= e1 selects this mode, e0 == e1 decodes the same in both
+        if (candidateError < error)
+        {
+            endpoint0 = e0;
+            endpoint1 = e1;
+            error     = candidateError;
+            memcpy(indices, candidateIndices, 16);
+        }
+    }
+
+    uint64_t bits = 0;
+    for (uint32_t i = 0; i < 16; ++i)
+    {
+        bits |= static_cast<uint64_t>(indices[i]) << (3 * i);
+    }
+
+    pBlock[0] = static_cast<char>(endpoint0);
+    pBlock[1] = static_cast<char>(endpoint1);
+    memcpy(pBlock + 2, &bits, 6);
+}
+
+void WriteBC7Mode6(const SubsetFit& fit, char* pBlock)
+{
+    QuantizedEndpoints endpoints = fit.endpoints;
+    uint8_t            indices[16];
+    memcpy(indices, fit.indices, 16);
+
+    // Anchor index drops its high bit
+    if (indices[0] & 0x8)
+    {
+        for (uint32_t c = 0; c < 4; ++c)
+        {
+            std::swap(endpoints.bits[0][c], endpoints.bits[1][c]);
+        }
+        std::swap(endpoints.pbits[0], endpoints.pbits[1]);
+        for (uint32_t i = 0; i < 16; ++i)
+        {
+            indices[i] = static_cast<uint8_t>(15 - indices[i]);
+        }
+    }
+
+    BlockWriter writer;
+    writer.Put(1 << 6, 7);
+    for (uint32_t c = 0; c < 4; ++c)
+    {
+        writer.Put(endpoints.bits[0][c], 7);
+        writer.Put(endpoints.bits[1][c], 7);
+    }
+    writer.Put(endpoints.pbits[0], 1);
+    writer.Put(endpoints.pbits[1], 1);
+    for (uint32_t i = 0; i < 16; ++i)
+    {
+        writer.Put(indices[i], (i == 0) ? 3 : 4);
+    }
+    writer.CopyTo(pBlock);
+}
+
+void WriteBC7Mode1(uint32_t partition, const SubsetFit fits[2], char* pBlock)
+{
+    const uint32_t anchors[2] = {0, kBC7Anchors2[partition]};
+
+    // Subset indices back to raster order
+    uint8_t  indices[16] = {};
+    uint32_t counts[2]   = {};
+    for (uint32_t i = 0; i < 16; ++i)
+    {
+        const uint32_t s = kBC7Partitions2[partition][i];
+        indices[i]       = fits[s].indices[counts[s]++];
+    }
+
+    // Anchor indices drop their high bit
+    QuantizedEndpoints endpoints[2] = {fits[0].endpoints, fits[1].endpoints};
+    for (uint32_t s = 0; s < 2; ++s)
+    {
+        if ((indices[anchors[s]] & 0x4) == 0)
+        {
+            continue;
+        }
+        for (uint32_t c = 0; c < 3; ++c)
+        {
+            std::swap(endpoints[s].bits[0][c], endpoints[s].bits[1][c]);
+        }
+        for (uint32_t i = 0; i < 16; ++i)
+        {
+            if (kBC7Partitions2[partition][i] == s)
+            {
+                indices[i] = static_cast<uint8_t>(7 - indices[i]);
+            }
+        }
+    }
+
+    BlockWriter writer;
+    writer.Put(1 << 1, 2);
+    writer.Put(partition, 6);
+    for (uint32_t c = 0; c < 3; ++c)
+    {
+        for (uint32_t s = 0; s < 2; ++s)
+        {
+            writer.Put(endpoints[s].bits[0][c], 6);
+            writer.Put(endpoints[s].bits[1][c], 6);
+        }
+    }
+    writer.Put(endpoints[0].pbits[0], 1);
+    writer.Put(endpoints[1].pbits[0], 1);
+    for (uint32_t i = 0; i < 16; ++i)
+    {
+        writer.Put(indices[i], ((i == anchors[0]) || (i == anchors[1])) ? 2 : 3);
+    }
+    writer.CopyTo(pBlock);
+}
+
+void SplitPartition(const BlockPixels& pixels, uint32_t partition, BlockPixels subsets[2])
+{
+    subsets[0].count = 0;
+    subsets[1].count = 0;
+    for (uint32_t i = 0; i < 16; ++i)
+    {
+        BlockPixels& subset    = subsets[kBC7Partitions2[partition][i]];
+        subset.r[subset.count] = pixels.r[i];
+        subset.g[subset.count] = pixels.g[i];
+        subset.b[subset.count] = pixels.b[i];
+        subset.a[subset.count] = pixels.a[i];
+        ++subset.count;
+    }
+}
+
+// Mode 6 for every block, opaque blocks also try the best mode 1 partitions
+void EncodeBC7(const BlockPixels& pixels, BCQuality quality, char* pBlock)
+{
+    EndpointMode mode6 = {};
+    mode6.quant        = ENDPOINT_QUANT_7_PBIT;
+    mode6.numChannels  = 4;
+    mode6.numIndices   = 16;
+    mode6.fractions    = kBC7Fractions4;
+    mode6.weights      = kBC7Weights4;
+
+    SubsetFit fit6 = {};
+    FitSubset(pixels, mode6, quality, &fit6);
+
+    bool opaque = true;
+    for (uint32_t i = 0; i < 16; ++i)
+    {
+        opaque &= (pixels.a[i] == 255.0f);
+    }
+
+    const uint32_t numCandidates = kBC7NumPartitionCandidates[quality];
+    if (!opaque || (numCandidates == 0) || (fit6.error == 0))
+    {
+        WriteBC7Mode6(fit6, pBlock);
+        return;
+    }
+
+    // Rank partitions by how well each subset fits a line
+    std::pair<float, uint32_t> ranking[64];
+    for (uint32_t partition = 0; partition < 64; ++partition)
+    {
+        BlockPixels subsets[2];
+        SplitPartition(pixels, partition, subsets);
+        ranking[partition] = {EstimateLineError(subsets[0], 3) + EstimateLineError(subsets[1], 3), partition};
+    }
+    std::partial_sort(ranking, ranking + numCandidates, ranking + 64);
+
+    EndpointMode mode1 = {};
+    mode1.quant        = ENDPOINT_QUANT_6_SPBIT;
+    mode1.numChannels  = 3;
+    mode1.numIndices   = 8;
+    mode1.fractions    = kBC7Fractions3;
+    mode1.weights      = kBC7Weights3;
+
+    float     bestError     = fit6.error;
+    uint32_t  bestPartition = UINT32_MAX;
+    SubsetFit bestFits[2];
+    for (uint32_t candidate = 0; candidate < numCandidates; ++candidate)
+    {
+        const uint32_t partition = ranking[candidate].second;
+
+        BlockPixels subsets[2];
+        SplitPartition(pixels, partition, subsets);
+
+        SubsetFit fits[2];
+        FitSubset(subsets[0], mode1, quality, &fits[0]);
+        if (fits[0].error >= bestError)
+        {
+            continue;
+        }
+        FitSubset(subsets[1], mode1, quality, &fits[1]);
+
+        const float error = fits[0].error + fits[1].error;
+        if (error < bestError)
+        {
+            bestError     = error;
+            bestPartition = partition;
+            bestFits[0]   = fits[0];
+            bestFits[1]   = fits[1];
+        }
+    }
+
+    if (bestPartition == UINT32_MAX)
+    {
+        WriteBC7Mode6(fit6, pBlock);
+    }
+    else
+    {
+        WriteBC7Mode1(bestPartition, bestFits, pBlock);
+    }
+}
+
+// BC6H single subset modes, from most to least endpoint precision
+struct BC6HMode
+{
+    uint32_t modeBits  = 0;
+    uint32_t precision = 0;
+    uint32_t deltaBits = 0;
+};
+
+const BC6HMode kBC6HModes[4] = {
+    {0x0F, 16, 4}, // Mode 14
+    {0x0B, 12, 8}, // Mode 13
+    {0x07, 11, 9}, // Mode 12
+    {0x03, 10, 0}, // Mode 11
+};
+
+void WriteBC6H(const BC6HMode& bc6hMode, const SubsetFit& fit, char* pBlock)
+{
+    const QuantizedEndpoints& endpoints = fit.endpoints;
+
+    // The low 10 bits of endpoint 0 come first, then per channel endpoint 1
+    // or its delta followed by the high bits of endpoint 0 in reverse order.
+    BlockWriter writer;
+    writer.Put(bc6hMode.modeBits, 5);
+    for (uint32_t c = 0; c < 3; ++c)
+    {
+        writer.Put(endpoints.bits[0][c] & 0x3FF, 10);
+    }
+    for (uint32_t c = 0; c < 3; ++c)
+    {
+        if (bc6hMode.deltaBits > 0)
+        {
+            const uint32_t delta = endpoints.bits[1][c] - endpoints.bits[0][c];
+            writer.Put(delta & ((1u << bc6hMode.deltaBits) - 1), bc6hMode.deltaBits);
+        }
+        else
+        {
+            writer.Put(endpoints.bits[1][c], 10);
+        }
+        for (uint32_t bit = bc6hMode.precision; bit > 10; --bit)
+        {
+            writer.Put(endpoints.bits[0][c] >> (bit - 1), 1);
+        }
+    }
+    for (uint32_t i = 0; i < 16; ++i)
+    {
+        writer.Put(fit.indices[i], (i == 0) ? 3 : 4);
+    }
+    writer.CopyTo(pBlock);
+}
+
+// Pixels are half float bits, every single subset mode is tried and
+// delta coded modes are skipped when the endpoints are too far apart.
+void EncodeBC6H(const BlockPixels& pixels, BCQuality quality, char* pBlock)
+{
+    uint32_t  bestMode = 0;
+    SubsetFit bestFit  = {};
+    for (uint32_t modeIdx = 0; modeIdx < 4; ++modeIdx)
+    {
+        EndpointMode mode = {};
+        mode.quant        = ENDPOINT_QUANT_BC6H;
+        mode.numChannels  = 3;
+        mode.numIndices   = 16;
+        mode.fractions    = kBC7Fractions4;
+        mode.weights      = kBC7Weights4;
+        mode.maxValue     = static_cast<float>(BC_MAX_HALF_BITS);
+        mode.precision    = kBC6HModes[modeIdx].precision;
+        mode.deltaBits    = kBC6HModes[modeIdx].deltaBits;
+
+        SubsetFit fit = {};
+        FitSubset(pixels, mode, quality, &fit);
+        if (fit.error < bestFit.error)
+        {
+            bestMode = modeIdx;
+            bestFit  = fit;
+            if (fit.error == 0)
+            {
+                break;
+            }
+        }
+    }
+
+    // Mode 11 always fits, this only happens if every fit was rejected
+    assert((bestFit.error < FLT_MAX) && "no BC6H mode fit the block");
+
+    WriteBC6H(kBC6HModes[bestMode], bestFit, pBlock);
+}
+
+// Decodes blocks written by WriteBC6H, used to measure the error
+void DecodeBC6H(const char* pBlock, float texels[16][3])
+{
+    uint8_t bytes[16];
+    memcpy(bytes, pBlock, 16);
+
+    uint32_t bit = 0;
+    auto     Get = [&](uint32_t numBits) -> uint32_t {
+        uint32_t value = 0;
+        for (uint32_t i = 0; i < numBits; ++i, ++bit)
+        {
+            value |= ((bytes[bit >> 3] >> (bit & 7)) & 1u) << i;
+        }
+        return value;
+    };
+
+    const uint32_t modeBits = Get(5);
+    const BC6HMode* pMode    = nullptr;
+    for (const BC6HMode& mode : kBC6HModes)
+    {
+        pMode = (mode.modeBits == modeBits) ? &mode : pMode;
+    }
+    assert(!IsNull(pMode) && "unexpected BC6H mode");
+
+    int endpoints[2][3] = {};
+    for (uint32_t c = 0; c < 3; ++c)
+    {
+        endpoints[0][c] = static_cast<int>(Get(10));
+    }
+    for (uint32_t c = 0; c < 3; ++c)
+    {
+        endpoints[1][c] = static_cast<int>(Get((pMode->deltaBits > 0) ? pMode->deltaBits : 10));
+        for (uint32_t b = pMode->precision; b > 10; --b)
+        {
+            endpoints[0][c] |= static_cast<int>(Get(1)) << (b - 1);
+        }
+    }
+
+    const int mask = (1 << pMode->precision) - 1;
+    for (uint32_t c = 0; c < 3; ++c)
+    {
+        if (pMode->deltaBits > 0)
+        {
+            // Sign extend the delta
+            const int shift = 32 - static_cast<int>(pMode->deltaBits);
+            const int delta = static_cast<int>(static_cast<uint32_t>(endpoints[1][c]) << shift) >> shift;
+            endpoints[1][c] = (endpoints[0][c] + delta) & mask;
+        }
+        endpoints[0][c] = UnquantizeBC6H(endpoints[0][c], pMode->precision);
+        endpoints[1][c] = UnquantizeBC6H(endpoints[1][c], pMode->precision);
+    }
+
+    for (uint32_t i = 0; i < 16; ++i)
+    {
+        const int w = kBC7Weights4[Get((i == 0) ? 3 : 4)];
+        for (uint32_t c = 0; c < 3; ++c)
+        {
+            const int value = FinishUnquantizeBC6H((((64 - w) * endpoints[0][c]) + (w * endpoints[1][c]) + 32) >> 6);
+            texels[i][c]    = HalfBitsToFloat(static_cast<uint32_t>(value));
+        }
+    }
+}
+
+void EncodeBlock(const BlockPixels& pixels, GREXFormat format, BCQuality quality, char* pBlock)
+{
+    switch (format)
+    {
+        default: break;
+
+        case GREX_FORMAT_BC1_RGB: {
+            EncodeBC1(pixels, quality, pBlock);
+        }
+        break;
+
+        case GREX_FORMAT_BC3_RGBA: {
+            EncodeBC4(pixels.a, quality, pBlock);
+            EncodeBC1(pixels, quality, pBlock + 8);
+        }
+        break;
+
+        case GREX_FORMAT_BC4_R: {
+            EncodeBC4(pixels.r, quality, pBlock);
+        }
+        break;
+
+        case GREX_FORMAT_BC5_RG: {
+            EncodeBC4(pixels.r, quality, pBlock);
+            EncodeBC4(pixels.g, quality, pBlock + 8);
+        }
+        break;
+
+        case GREX_FORMAT_BC6H_UFLOAT: {
+            EncodeBC6H(pixels, quality, pBlock);
+        }
+        break;
+
+        case GREX_FORMAT_BC7_RGBA: {
+            EncodeBC7(pixels, quality, pBlock);
+        }
+        break;
+    }
+}
+
+} // namespace
+
+// -------------------------------------------------------------------------------------------------
+// BCEncode
+// -------------------------------------------------------------------------------------------------
+uint32_t BCBlockSize(GREXFormat format)
+{
+    switch (format)
+    {
+        default: break;
+        case GREX_FORMAT_BC1_RGB: return 8;
+        case GREX_FORMAT_BC3_RGBA: return 16;
+        case GREX_FORMAT_BC4_R: return 8;
+        case GREX_FORMAT_BC5_RG: return 16;
+        case GREX_FORMAT_BC6H_UFLOAT: return 16;
+        case GREX_FORMAT_BC7_RGBA: return 16;
+    }
+    return 0;
+}
+
+// Source values below this count as this for relative error
+#define BC_MIN_RELATIVE_ERROR_BASE (1.0f / 256.0f)
+
+// Encodes levels of PixelRGBA8u, or PixelRGBA32f for BC6H
+static bool EncodeLevels(const std::vector<LevelSource>& levels, bool hdr, const BCEncodeOptions& options, BCTexture* pTexture)
+{
+    if (IsNull(pTexture) || levels.empty())
+    {
+        return false;
+    }
+
+    const uint32_t blockSize = BCBlockSize(options.format);
+    if ((blockSize == 0) || (hdr != (options.format == GREX_FORMAT_BC6H_UFLOAT)))
+    {
+        GREX_LOG_ERROR("unsupported BC format for " << (hdr ? "HDR" : "LDR") << " source: " << options.format);
+        return false;
+    }
+
+    if ((options.rowStrideAlignment == 0) || (options.offsetAlignment == 0))
+    {
+        GREX_LOG_ERROR("invalid BC alignment: rowStrideAlignment=" << options.rowStrideAlignment << ", offsetAlignment=" << options.offsetAlignment);
+        return false;
+    }
+
+    const bool measureError = options.measureError && hdr;
+
+    BCTexture texture = {};
+    texture.format    = options.format;
+    texture.width     = levels[0].width;
+    texture.height    = levels[0].height;
+
+    //
+    // Lay out the levels, each job is a run of blocks within one level so
+    // the small levels at the tail don't end up as jobs of their own.
+    //
+    struct BlockRange
+    {
+        uint32_t level      = 0;
+        uint32_t firstBlock = 0;
+        uint32_t numBlocks  = 0;
+
+        // Error of the blocks in this range
+        float  maxRelativeError = 0;
+        double sumRelativeError = 0;
+    };
+
+    std::vector<BlockRange> jobs;
+    uint32_t                offset = 0;
+    for (uint32_t level = 0; level < CountU32(levels); ++level)
+    {
+        const uint32_t blocksX = (levels[level].width + 3) / 4;
+        const uint32_t blocksY = (levels[level].height + 3) / 4;
+
+        MipOffset mipOffset = {};
+        mipOffset.Offset    = Align(offset, options.offsetAlignment);
+        mipOffset.RowStride = Align(blocksX * blockSize, options.rowStrideAlignment);
+        texture.mipOffsets.push_back(mipOffset);
+
+        offset = mipOffset.Offset + (blocksY * mipOffset.RowStride);
+
+        const uint32_t numBlocks = blocksX * blocksY;
+        for (uint32_t firstBlock = 0; firstBlock < numBlocks; firstBlock += BC_BLOCKS_PER_JOB)
+        {
+            BlockRange job = {};
+            job.level      = level;
+            job.firstBlock = firstBlock;
+            job.numBlocks  = std::min<uint32_t>(BC_BLOCKS_PER_JOB, numBlocks - firstBlock);
+            jobs.push_back(job);
+        }
+    }
+    texture.data.resize(offset);
+
+    ParallelFor(CountU32(jobs), 1, [&](uint32_t begin, uint32_t end) {
+        for (uint32_t jobIdx = begin; jobIdx < end; ++jobIdx)
+        {
+            BlockRange&        job       = jobs[jobIdx];
+            const LevelSource& level     = levels[job.level];
+            const MipOffset&   mipOffset = texture.mipOffsets[job.level];
+            const uint32_t     blocksX   = (level.width + 3) / 4;
+
+            for (uint32_t blockIdx = job.firstBlock; blockIdx < (job.firstBlock + job.numBlocks); ++blockIdx)
+            {
+                const uint32_t blockX = blockIdx % blocksX;
+                const uint32_t blockY = blockIdx / blocksX;
+
+                BlockPixels pixels = {};
+                if (hdr)
+                {
+                    LoadBlockHDR(level, blockX, blockY, &pixels);
+                }
+                else
+                {
+                    LoadBlock(level, blockX, blockY, &pixels);
+                }
+
+                char* pBlock = texture.data.data() + mipOffset.Offset + (blockY * mipOffset.RowStride) + (blockX * blockSize);
+                EncodeBlock(pixels, options.format, options.quality, pBlock);
+
+                if (!measureError)
+                {
+                    continue;
+                }
+
+                float texels[16][3] = {};
+                DecodeBC6H(pBlock, texels);
+
+                // Padding texels of partial blocks don't count
+                for (uint32_t i = 0; i < 16; ++i)
+                {
+                    const uint32_t x = (4 * blockX) + (i % 4);
+                    const uint32_t y = (4 * blockY) + (i / 4);
+                    if ((x >= level.width) || (y >= level.height))
+                    {
+                        continue;
+                    }
+
+                    const PixelRGBA32f& src       = level.GetRow<PixelRGBA32f>(y)[x];
+                    const float         values[3] = {src.r, src.g, src.b};
+
+                    float maxDiff  = 0;
+                    float maxValue = BC_MIN_RELATIVE_ERROR_BASE;
+                    for (uint32_t c = 0; c < 3; ++c)
+                    {
+                        const float value = std::clamp(values[c], 0.0f, 65504.0f);
+                        maxDiff           = std::max(maxDiff, fabsf(texels[i][c] - value));
+                        maxValue          = std::max(maxValue, value);
+                    }
+
+                    const float relativeError = maxDiff / maxValue;
+                    job.maxRelativeError      = std::max(job.maxRelativeError, relativeError);
+                    job.sumRelativeError += relativeError;
+                }
+            }
+        }
+    });
+
+    if (measureError)
+    {
+        texture.levelErrors.resize(levels.size());
+
+        std::vector<double> sums(levels.size(), 0.0);
+        for (const BlockRange& job : jobs)
+        {
+            BCLevelError& levelError    = texture.levelErrors[job.level];
+            levelError.maxRelativeError = std::max(levelError.maxRelativeError, job.maxRelativeError);
+            sums[job.level] += job.sumRelativeError;
+        }
+
+        for (uint32_t level = 0; level < CountU32(levels); ++level)
+        {
+            BCLevelError&  levelError    = texture.levelErrors[level];
+            const uint64_t numTexels     = static_cast<uint64_t>(levels[level].width) * levels[level].height;
+            levelError.meanRelativeError = static_cast<float>(sums[level] / static_cast<double>(numTexels));
+
+            GREX_LOG_INFO("BC6H level " << level << " (" << levels[level].width << "x" << levels[level].height << "): "
+                                        << "max relative error=" << levelError.maxRelativeError << ", "
+                                        << "mean relative error=" << levelError.meanRelativeError);
+        }
+    }
+
+    *pTexture = std::move(texture);
+
+    return true;
+}
+
+bool BCEncode(const MipmapRGBA8u& mipmap, const BCEncodeOptions& options, BCTexture* pTexture)
+{
+    std::vector<LevelSource> levels;
+    for (uint32_t level = 0; level < mipmap.GetNumLevels(); ++level)
+    {
+        const BitmapRGBA8u& bitmap = mipmap.GetMip(level);
+        levels.push_back({reinterpret_cast<const char*>(bitmap.GetPixels()), bitmap.GetRowStride(), bitmap.GetWidth(), bitmap.GetHeight()});
+    }
+    return EncodeLevels(levels, false, options, pTexture);
+}
+
+bool BCEncode(const MipmapRGBA32f& mipmap, const BCEncodeOptions& options, BCTexture* pTexture)
+{
+    std::vector<LevelSource> levels;
+    for (uint32_t level = 0; level < mipmap.GetNumLevels(); ++level)
+    {
+        const BitmapRGBA32f& bitmap = mipmap.GetMip(level);
+        levels.push_back({reinterpret_cast<const char*>(bitmap.GetPixels()), bitmap.GetRowStride(), bitmap.GetWidth(), bitmap.GetHeight()});
+    }
+    return EncodeLevels(levels, true, options, pTexture);
+}
+
+bool BCEncodeEnvironmentMap(const IBLMaps& ibl, const BCEncodeOptions& options, BCTexture* pTexture)
+{
+    const BitmapRGBA32f& bitmap = ibl.environmentMap;
+    if (bitmap.Empty())
+    {
+        return false;
+    }
+
+    // BCTexture only holds a mip chain, not faces
+    if (ibl.layout == IBL_LAYOUT_CUBE)
+    {
+        GREX_LOG_ERROR("IBL cube maps can't be BC encoded as a mip chain");
+        return false;
+    }
+
+    // Levels are stacked top to bottom and share the row stride
+    std::vector<LevelSource> levels;
+    uint32_t                 levelY      = 0;
+    uint32_t                 levelWidth  = ibl.baseWidth;
+    uint32_t                 levelHeight = ibl.baseHeight;
+    for (uint32_t level = 0; level < ibl.numLevels; ++level)
+    {
+        if ((levelWidth == 0) || (levelHeight == 0) || ((levelY + levelHeight) > bitmap.GetHeight()))
+        {
+            GREX_LOG_ERROR("IBL environment map level " << level << " is out of bounds");
+            return false;
+        }
+
+        levels.push_back({reinterpret_cast<const char*>(bitmap.GetPixels(0, levelY)), bitmap.GetRowStride(), levelWidth, levelHeight});
+
+        levelY += levelHeight;
+        levelWidth >>= 1;
+        levelHeight >>= 1;
+    }
+    return EncodeLevels(levels, true, options, pTexture);
+}
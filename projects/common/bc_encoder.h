@@ -0,0 +1,96 @@
+#pragma once
+
+#include "bitmap.h"
+
+// -------------------------------------------------------------------------------------------------
+// BCQuality
+// -------------------------------------------------------------------------------------------------
+enum BCQuality
+{
+    BC_QUALITY_FAST   = 0, // Principal axis endpoints, BC7 uses mode 6 only
+    BC_QUALITY_NORMAL = 1, // Least squares endpoint refinement, BC7 also tries the best few mode 1 partitions
+    BC_QUALITY_HIGH   = 2, // More refinement, endpoint nudging and more BC7 partitions
+};
+
+// -------------------------------------------------------------------------------------------------
+// BCEncodeOptions
+// -------------------------------------------------------------------------------------------------
+//
+// The alignments control the layout of the encoded levels. The defaults
+// pack them tightly, which is what the Vulkan and Metal CreateTexture
+// functions expect. D3D12 needs rows aligned to
+// D3D12_TEXTURE_DATA_PITCH_ALIGNMENT and levels aligned to
+// D3D12_TEXTURE_DATA_PLACEMENT_ALIGNMENT.
+//
+struct BCEncodeOptions
+{
+    GREXFormat format             = GREX_FORMAT_BC7_RGBA; // BC1_RGB, BC3_RGBA, BC4_R, BC5_RG, BC6H_UFLOAT or BC7_RGBA
+    BCQuality  quality            = BC_QUALITY_NORMAL;
+    uint32_t   rowStrideAlignment = 1;
+    uint32_t   offsetAlignment    = 16;
+    bool       measureError       = false; // BC6H only, decodes every level and logs its error
+
+    // clang-format off
+    BCEncodeOptions& Format            (GREXFormat value) { format             = value; return *this; }
+    BCEncodeOptions& Quality           (BCQuality  value) { quality            = value; return *this; }
+    BCEncodeOptions& RowStrideAlignment(uint32_t   value) { rowStrideAlignment = value; return *this; }
+    BCEncodeOptions& OffsetAlignment   (uint32_t   value) { offsetAlignment    = value; return *this; }
+    BCEncodeOptions& MeasureError      (bool       value) { measureError       = value; return *this; }
+    // clang-format on
+};
+
+// -------------------------------------------------------------------------------------------------
+// BCLevelError
+// -------------------------------------------------------------------------------------------------
+//
+// Per texel relative error is the largest channel difference divided by
+// the largest source channel. Source values below 1/256 are treated as
+// 1/256 so near black texels don't dominate.
+//
+struct BCLevelError
+{
+    float maxRelativeError  = 0;
+    float meanRelativeError = 0;
+};
+
+// -------------------------------------------------------------------------------------------------
+// BCTexture
+// -------------------------------------------------------------------------------------------------
+//
+// Encoded mip chain, mipOffsets and data can be passed to CreateTexture
+// as is. MipOffset::RowStride is the size of a row of blocks in bytes.
+//
+struct BCTexture
+{
+    GREXFormat                format = GREX_FORMAT_UNKNOWN;
+    uint32_t                  width  = 0;
+    uint32_t                  height = 0;
+    std::vector<MipOffset>    mipOffsets;
+    std::vector<char>         data;
+    std::vector<BCLevelError> levelErrors; // Only with BCEncodeOptions::measureError
+
+    uint32_t    GetNumLevels() const { return CountU32(mipOffsets); }
+    size_t      GetSizeInBytes() const { return data.size(); }
+    const char* GetData() const { return data.data(); }
+};
+
+// Size of a 4x4 block in bytes, 0 for formats that aren't supported
+uint32_t BCBlockSize(GREXFormat format);
+
+// Encodes every level of \b mipmap, blocks of all levels are encoded in
+// parallel. Levels that aren't a multiple of 4 pixels are padded by
+// repeating their last row and column.
+//
+// BC1 only uses the opaque 4 color mode. BC4 and BC5 take their channels
+// from R and RG.
+//
+bool BCEncode(const MipmapRGBA8u& mipmap, const BCEncodeOptions& options, BCTexture* pTexture);
+
+// HDR versions, the only supported format is BC6H_UFLOAT. Negative values
+// are encoded as 0 and values past the half float range are clamped.
+//
+// The IBL version encodes IBLMaps::environmentMap, which has all its
+// levels stacked top to bottom.
+//
+bool BCEncode(const MipmapRGBA32f& mipmap, const BCEncodeOptions& options, BCTexture* pTexture);
+bool BCEncodeEnvironmentMap(const IBLMaps& ibl, const BCEncodeOptions& options, BCTexture* pTexture);
@@ -21,6 +21,22 @@
 
 #include <fstream>
 
+#if defined(__x86_64__) || defined(_M_X64)
+#    define GREX_BITMAP_X64
+#    include <immintrin.h>
+#    if defined(_MSC_VER)
+#        include <intrin.h>
+#    endif
+#endif
+
+// AVX2 code paths are compiled for AVX2 and F16C regardless of the
+// compiler flags and only called if the CPU supports both.
+#if defined(GREX_BITMAP_X64) && (defined(__GNUC__) || defined(__clang__))
+#    define GREX_TARGET_AVX2 __attribute__((target("avx2,f16c")))
+#else
+#    define GREX_TARGET_AVX2
+#endif
+
 std::string ToLowerCaseCopy(std::string s)
 {
     std::transform(
@@ -31,112 +47,1691 @@ std::string ToLowerCaseCopy(std::string s)
     return s;
 }
 
-template <typename ChannelT>
-struct ImageOps
+template <typename ChannelT>
+struct ImageOps
+{
+};
+
+stbir_edge ToStb(BitmapSampleMode mode)
+{
+    switch (mode) {
+        default: break;
+        case BITMAP_SAMPLE_MODE_CLAMP: return STBIR_EDGE_CLAMP;
+        case BITMAP_SAMPLE_MODE_WRAP: return STBIR_EDGE_WRAP;
+    }
+    return STBIR_EDGE_ZERO;
+}
+
+// =================================================================================================
+// Resampling
+// =================================================================================================
+//
+// ScaleTo is separable: every filter is the product of a horizontal and a
+// vertical 1D filter, so the taps and weights are computed once per column
+// and once per row. Each destination row blends the horizontally filtered
+// source rows it needs, which are cached so neighboring destination rows
+// don't filter the same source row again.
+//
+// Sample positions are the same as GetSample/GetBilinearSample/
+// GetGaussianSample at (col * dx + 0.5, row * dy + 0.5). Intermediate
+// values are float, 8-bit results are rounded.
+//
+enum ResampleISA
+{
+    RESAMPLE_ISA_SCALAR = 0,
+    RESAMPLE_ISA_SSE2   = 1,
+    RESAMPLE_ISA_AVX2   = 2,
+};
+
+static ResampleISA GetResampleISA()
+{
+#if defined(GREX_BITMAP_X64)
+    static const ResampleISA sISA = []() -> ResampleISA {
+#    if defined(_MSC_VER)
+        int info[4] = {};
+        __cpuid(info, 1);
+        const bool osxsave = (info[2] & (1 << 27)) != 0;
+        const bool avx     = (info[2] & (1 << 28)) != 0;
+        const bool f16c    = (info[2] & (1 << 29)) != 0;
+        if (osxsave && avx && f16c && ((_xgetbv(0) & 0x6) == 0x6))
+        {
+            __cpuidex(info, 7, 0);
+            if ((info[1] & (1 << 5)) != 0)
+            {
+                return RESAMPLE_ISA_AVX2;
+            }
+        }
+#    else
+        if (__builtin_cpu_supports("avx2") && __builtin_cpu_supports("f16c"))
+        {
+            return RESAMPLE_ISA_AVX2;
+        }
+#    endif
+        return RESAMPLE_ISA_SSE2;
+    }();
+    return sISA;
+#else
+    return RESAMPLE_ISA_SCALAR;
+#endif
+}
+
+// Taps for every destination pixel along one axis
+struct ResampleTaps
+{
+    uint32_t              numTaps = 0;
+    std::vector<uint32_t> indices; // numTaps per destination pixel, always in bounds
+    std::vector<float>    weights; // 0 for taps that fall outside a BITMAP_SAMPLE_MODE_BORDER edge
+};
+
+static ResampleTaps CalculateResampleTaps(uint32_t srcRes, uint32_t dstRes, BitmapSampleMode mode, BitmapFilterMode filterMode)
+{
+    // 1D weights of the 3x3 kernel GetGaussianSample uses in ScaleTo, the
+    // 2D kernel is their outer product.
+    float gaussian[3] = {};
+    {
+        auto kernel = GaussianKernel(3);
+        for (uint32_t i = 0; i < 3; ++i)
+        {
+            for (uint32_t j = 0; j < 3; ++j)
+            {
+                gaussian[j] += kernel[i * 3 + j];
+            }
+        }
+    }
+
+    ResampleTaps taps = {};
+    switch (filterMode)
+    {
+        default: taps.numTaps = 1; break;
+        case BITMAP_FILTER_MODE_LINEAR: taps.numTaps = 2; break;
+        case BITMAP_FILTER_MODE_GAUSSIAN: taps.numTaps = 3; break;
+    }
+    taps.indices.resize(dstRes * taps.numTaps);
+    taps.weights.resize(dstRes * taps.numTaps);
+
+    const int32_t res = static_cast<int32_t>(srcRes);
+    const float   d   = srcRes / static_cast<float>(dstRes);
+    for (uint32_t i = 0; i < dstRes; ++i)
+    {
+        const float   x  = (i * d) + 0.5f;
+        const int32_t x0 = static_cast<int32_t>(floor(x));
+
+        int32_t coords[3]  = {x0, 0, 0};
+        float   weights[3] = {1.0f, 0.0f, 0.0f};
+        if (filterMode == BITMAP_FILTER_MODE_LINEAR)
+        {
+            coords[1]  = x0 + 1;
+            weights[1] = x - x0;
+            weights[0] = 1.0f - weights[1];
+        }
+        else if (filterMode == BITMAP_FILTER_MODE_GAUSSIAN)
+        {
+            for (int32_t k = 0; k < 3; ++k)
+            {
+                coords[k]  = x0 + k - 1;
+                weights[k] = gaussian[k];
+            }
+        }
+
+        for (uint32_t k = 0; k < taps.numTaps; ++k)
+        {
+            int32_t c = coords[k];
+            float   w = weights[k];
+            if ((c < 0) || (c >= res))
+            {
+                switch (mode)
+                {
+                    default:
+                    {
+                        c = 0;
+                        w = 0.0f;
+                    } break;
+                    case BITMAP_SAMPLE_MODE_WRAP: c = ((c % res) + res) % res; break;
+                    case BITMAP_SAMPLE_MODE_CLAMP: c = std::clamp<int32_t>(c, 0, res - 1); break;
+                }
+            }
+            taps.indices[i * taps.numTaps + k] = static_cast<uint32_t>(c);
+            taps.weights[i * taps.numTaps + k] = w;
+        }
+    }
+
+    return taps;
+}
+
+// -------------------------------------------------------------------------------------------------
+// Pixel conversion
+// -------------------------------------------------------------------------------------------------
+template <typename PixelT>
+struct ResamplePixelOps
+{
+};
+
+template <>
+struct ResamplePixelOps<PixelRGBA8u>
+{
+    static void Load(const PixelRGBA8u& pixel, float* pValues)
+    {
+        pValues[0] = pixel.r;
+        pValues[1] = pixel.g;
+        pValues[2] = pixel.b;
+        pValues[3] = pixel.a;
+    }
+
+    static void Store(const float* pValues, PixelRGBA8u* pPixel)
+    {
+        // Round half to even like _mm_cvtps_epi32 in Store4
+        auto Convert = [](float value) -> uint8_t {
+            return static_cast<uint8_t>(std::nearbyint(std::clamp(value, 0.0f, 255.0f)));
+        };
+        pPixel->r = Convert(pValues[0]);
+        pPixel->g = Convert(pValues[1]);
+        pPixel->b = Convert(pValues[2]);
+        pPixel->a = Convert(pValues[3]);
+    }
+
+#if defined(GREX_BITMAP_X64)
+    static __m128 Load(const PixelRGBA8u* pPixel)
+    {
+        int32_t packed = 0;
+        memcpy(&packed, pPixel, sizeof(packed));
+        __m128i zero = _mm_setzero_si128();
+        __m128i v    = _mm_unpacklo_epi16(_mm_unpacklo_epi8(_mm_cvtsi32_si128(packed), zero), zero);
+        return _mm_cvtepi32_ps(v);
+    }
+
+    // Stores 4 pixels
+    static void Store4(__m128 v0, __m128 v1, __m128 v2, __m128 v3, PixelRGBA8u* pPixels)
+    {
+        __m128i lo = _mm_packs_epi32(_mm_cvtps_epi32(v0), _mm_cvtps_epi32(v1));
+        __m128i hi = _mm_packs_epi32(_mm_cvtps_epi32(v2), _mm_cvtps_epi32(v3));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(pPixels), _mm_packus_epi16(lo, hi));
+    }
+#endif
+};
+
+template <>
+struct ResamplePixelOps<PixelRGBA16f>
+{
+    static void Load(const PixelRGBA16f& pixel, float* pValues)
+    {
+        pValues[0] = pixel.r;
+        pValues[1] = pixel.g;
+        pValues[2] = pixel.b;
+        pValues[3] = pixel.a;
+    }
+
+    // Clamps to the largest half instead of going to infinity
+    static void Store(const float* pValues, PixelRGBA16f* pPixel)
+    {
+        const float kMax = ChannelOp<Half>::MaxValue();
+        pPixel->r        = std::clamp(pValues[0], -kMax, kMax);
+        pPixel->g        = std::clamp(pValues[1], -kMax, kMax);
+        pPixel->b        = std::clamp(pValues[2], -kMax, kMax);
+        pPixel->a        = std::clamp(pValues[3], -kMax, kMax);
+    }
+
+#if defined(GREX_BITMAP_X64)
+    // SSE2 doesn't have half conversions, the AVX2 paths use F16C instead
+    static __m128 Load(const PixelRGBA16f* pPixel)
+    {
+        return _mm_setr_ps(pPixel->r, pPixel->g, pPixel->b, pPixel->a);
+    }
+
+    static void Store4(__m128 v0, __m128 v1, __m128 v2, __m128 v3, PixelRGBA16f* pPixels)
+    {
+        float values[16] = {};
+        _mm_storeu_ps(values + 0, v0);
+        _mm_storeu_ps(values + 4, v1);
+        _mm_storeu_ps(values + 8, v2);
+        _mm_storeu_ps(values + 12, v3);
+        for (uint32_t i = 0; i < 4; ++i)
+        {
+            Store(values + 4 * i, &pPixels[i]);
+        }
+    }
+#endif
+};
+
+template <>
+struct ResamplePixelOps<PixelRGB9E5>
+{
+    static void Load(const PixelRGB9E5& pixel, float* pValues)
+    {
+        PixelRGB9E5::Decode(pixel.value, pValues);
+        pValues[3] = 1.0f;
+    }
+
+    static void Store(const float* pValues, PixelRGB9E5* pPixel)
+    {
+        pPixel->value = PixelRGB9E5::Encode(pValues[0], pValues[1], pValues[2]);
+    }
+
+#if defined(GREX_BITMAP_X64)
+    static __m128 Load(const PixelRGB9E5* pPixel)
+    {
+        float values[4] = {};
+        Load(*pPixel, values);
+        return _mm_loadu_ps(values);
+    }
+
+    static void Store4(__m128 v0, __m128 v1, __m128 v2, __m128 v3, PixelRGB9E5* pPixels)
+    {
+        float values[16] = {};
+        _mm_storeu_ps(values + 0, v0);
+        _mm_storeu_ps(values + 4, v1);
+        _mm_storeu_ps(values + 8, v2);
+        _mm_storeu_ps(values + 12, v3);
+        for (uint32_t i = 0; i < 4; ++i)
+        {
+            Store(values + 4 * i, &pPixels[i]);
+        }
+    }
+#endif
+};
+
+template <>
+struct ResamplePixelOps<PixelRGBA32f>
+{
+    static void Load(const PixelRGBA32f& pixel, float* pValues)
+    {
+        pValues[0] = pixel.r;
+        pValues[1] = pixel.g;
+        pValues[2] = pixel.b;
+        pValues[3] = pixel.a;
+    }
+
+    static void Store(const float* pValues, PixelRGBA32f* pPixel)
+    {
+        pPixel->r = pValues[0];
+        pPixel->g = pValues[1];
+        pPixel->b = pValues[2];
+        pPixel->a = pValues[3];
+    }
+
+#if defined(GREX_BITMAP_X64)
+    static __m128 Load(const PixelRGBA32f* pPixel)
+    {
+        return _mm_loadu_ps(&pPixel->r);
+    }
+
+    static void Store4(__m128 v0, __m128 v1, __m128 v2, __m128 v3, PixelRGBA32f* pPixels)
+    {
+        _mm_storeu_ps(&pPixels[0].r, v0);
+        _mm_storeu_ps(&pPixels[1].r, v1);
+        _mm_storeu_ps(&pPixels[2].r, v2);
+        _mm_storeu_ps(&pPixels[3].r, v3);
+    }
+#endif
+};
+
+// -------------------------------------------------------------------------------------------------
+// Horizontal pass: one source row to a row of destination width RGBA floats
+// -------------------------------------------------------------------------------------------------
+template <typename PixelT>
+static void ResampleRowScalar(const PixelT* pSrc, const ResampleTaps& taps, uint32_t width, float* pDst)
+{
+    const uint32_t* pIndices = taps.indices.data();
+    const float*    pWeights = taps.weights.data();
+    for (uint32_t x = 0; x < width; ++x)
+    {
+        float acc[4] = {};
+        for (uint32_t k = 0; k < taps.numTaps; ++k)
+        {
+            float values[4] = {};
+            ResamplePixelOps<PixelT>::Load(pSrc[pIndices[k]], values);
+            for (uint32_t c = 0; c < 4; ++c)
+            {
+                acc[c] += values[c] * pWeights[k];
+            }
+        }
+        memcpy(pDst + 4 * x, acc, sizeof(acc));
+        pIndices += taps.numTaps;
+        pWeights += taps.numTaps;
+    }
+}
+
+#if defined(GREX_BITMAP_X64)
+template <typename PixelT>
+static void ResampleRowSSE2(const PixelT* pSrc, const ResampleTaps& taps, uint32_t width, float* pDst)
+{
+    const uint32_t* pIndices = taps.indices.data();
+    const float*    pWeights = taps.weights.data();
+    for (uint32_t x = 0; x < width; ++x)
+    {
+        __m128 acc = _mm_setzero_ps();
+        for (uint32_t k = 0; k < taps.numTaps; ++k)
+        {
+            __m128 v = ResamplePixelOps<PixelT>::Load(pSrc + pIndices[k]);
+            acc      = _mm_add_ps(acc, _mm_mul_ps(v, _mm_set1_ps(pWeights[k])));
+        }
+        _mm_storeu_ps(pDst + 4 * x, acc);
+        pIndices += taps.numTaps;
+        pWeights += taps.numTaps;
+    }
+}
+
+// Two destination pixels per iteration
+template <typename PixelT>
+GREX_TARGET_AVX2 static void ResampleRowAVX2(const PixelT* pSrc, const ResampleTaps& taps, uint32_t width, float* pDst)
+{
+    const uint32_t  n        = taps.numTaps;
+    const uint32_t* pIndices = taps.indices.data();
+    const float*    pWeights = taps.weights.data();
+
+    uint32_t x = 0;
+    for (; (x + 2) <= width; x += 2)
+    {
+        __m256 acc = _mm256_setzero_ps();
+        for (uint32_t k = 0; k < n; ++k)
+        {
+            const PixelT* p0 = pSrc + pIndices[k];
+            const PixelT* p1 = pSrc + pIndices[n + k];
+
+            __m256 v;
+            if constexpr (std::is_same_v<PixelT, PixelRGBA8u>)
+            {
+                int32_t packed[2] = {};
+                memcpy(&packed[0], p0, sizeof(int32_t));
+                memcpy(&packed[1], p1, sizeof(int32_t));
+                v = _mm256_cvtepi32_ps(_mm256_cvtepu8_epi32(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(packed))));
+            }
+            else if constexpr (std::is_same_v<PixelT, PixelRGBA16f>)
+            {
+                int64_t packed[2] = {};
+                memcpy(&packed[0], p0, sizeof(int64_t));
+                memcpy(&packed[1], p1, sizeof(int64_t));
+                v = _mm256_cvtph_ps(_mm_loadu_si128(reinterpret_cast<const __m128i*>(packed)));
+            }
+            else if constexpr (std::is_same_v<PixelT, PixelRGBA32f>)
+            {
+                v = _mm256_insertf128_ps(_mm256_castps128_ps256(_mm_loadu_ps(&p0->r)), _mm_loadu_ps(&p1->r), 1);
+            }
+            else
+            {
+                v = _mm256_insertf128_ps(_mm256_castps128_ps256(ResamplePixelOps<PixelT>::Load(p0)), ResamplePixelOps<PixelT>::Load(p1), 1);
+            }
+
+            __m256 w = _mm256_insertf128_ps(_mm256_castps128_ps256(_mm_set1_ps(pWeights[k])), _mm_set1_ps(pWeights[n + k]), 1);
+            acc      = _mm256_add_ps(acc, _mm256_mul_ps(v, w));
+        }
+        _mm256_storeu_ps(pDst + 4 * x, acc);
+        pIndices += 2 * n;
+        pWeights += 2 * n;
+    }
+
+    for (; x < width; ++x)
+    {
+        __m128 acc = _mm_setzero_ps();
+        for (uint32_t k = 0; k < n; ++k)
+        {
+            __m128 v = ResamplePixelOps<PixelT>::Load(pSrc + pIndices[k]);
+            acc      = _mm_add_ps(acc, _mm_mul_ps(v, _mm_set1_ps(pWeights[k])));
+        }
+        _mm_storeu_ps(pDst + 4 * x, acc);
+        pIndices += n;
+        pWeights += n;
+    }
+}
+#endif
+
+// -------------------------------------------------------------------------------------------------
+// Vertical pass: weighted sum of filtered rows to a destination row
+// -------------------------------------------------------------------------------------------------
+template <typename PixelT>
+static void BlendRowsScalar(const float* const* ppRows, const float* pWeights, uint32_t numRows, uint32_t width, PixelT* pDst)
+{
+    for (uint32_t x = 0; x < width; ++x)
+    {
+        float acc[4] = {};
+        for (uint32_t k = 0; k < numRows; ++k)
+        {
+            for (uint32_t c = 0; c < 4; ++c)
+            {
+                acc[c] += ppRows[k][4 * x + c] * pWeights[k];
+            }
+        }
+        ResamplePixelOps<PixelT>::Store(acc, pDst + x);
+    }
+}
+
+#if defined(GREX_BITMAP_X64)
+template <typename PixelT>
+static void BlendRowsSSE2(const float* const* ppRows, const float* pWeights, uint32_t numRows, uint32_t width, PixelT* pDst)
+{
+    uint32_t x = 0;
+    for (; (x + 4) <= width; x += 4)
+    {
+        __m128 acc[4] = {_mm_setzero_ps(), _mm_setzero_ps(), _mm_setzero_ps(), _mm_setzero_ps()};
+        for (uint32_t k = 0; k < numRows; ++k)
+        {
+            const float* pRow = ppRows[k] + 4 * x;
+            const __m128 w    = _mm_set1_ps(pWeights[k]);
+            for (uint32_t i = 0; i < 4; ++i)
+            {
+                acc[i] = _mm_add_ps(acc[i], _mm_mul_ps(_mm_loadu_ps(pRow + 4 * i), w));
+            }
+        }
+        if constexpr (std::is_same_v<PixelT, PixelRGBA8u>)
+        {
+            const __m128 lo = _mm_setzero_ps();
+            const __m128 hi = _mm_set1_ps(255.0f);
+            for (uint32_t i = 0; i < 4; ++i)
+            {
+                acc[i] = _mm_min_ps(_mm_max_ps(acc[i], lo), hi);
+            }
+        }
+        ResamplePixelOps<PixelT>::Store4(acc[0], acc[1], acc[2], acc[3], pDst + x);
+    }
+
+    if (x < width)
+    {
+        const float* ppTailRows[3] = {};
+        for (uint32_t k = 0; k < numRows; ++k)
+        {
+            ppTailRows[k] = ppRows[k] + 4 * x;
+        }
+        BlendRowsScalar(ppTailRows, pWeights, numRows, width - x, pDst + x);
+    }
+}
+
+template <typename PixelT>
+GREX_TARGET_AVX2 static void BlendRowsAVX2(const float* const* ppRows, const float* pWeights, uint32_t numRows, uint32_t width, PixelT* pDst)
+{
+    uint32_t x = 0;
+    for (; (x + 4) <= width; x += 4)
+    {
+        __m256 acc[2] = {_mm256_setzero_ps(), _mm256_setzero_ps()};
+        for (uint32_t k = 0; k < numRows; ++k)
+        {
+            const float* pRow = ppRows[k] + 4 * x;
+            const __m256 w    = _mm256_set1_ps(pWeights[k]);
+            acc[0]            = _mm256_add_ps(acc[0], _mm256_mul_ps(_mm256_loadu_ps(pRow + 0), w));
+            acc[1]            = _mm256_add_ps(acc[1], _mm256_mul_ps(_mm256_loadu_ps(pRow + 8), w));
+        }
+        if constexpr (std::is_same_v<PixelT, PixelRGBA8u>)
+        {
+            const __m256 lo = _mm256_setzero_ps();
+            const __m256 hi = _mm256_set1_ps(255.0f);
+            acc[0]          = _mm256_min_ps(_mm256_max_ps(acc[0], lo), hi);
+            acc[1]          = _mm256_min_ps(_mm256_max_ps(acc[1], lo), hi);
+        }
+        if constexpr (std::is_same_v<PixelT, PixelRGBA16f>)
+        {
+            const __m256 lo = _mm256_set1_ps(-ChannelOp<Half>::MaxValue());
+            const __m256 hi = _mm256_set1_ps(ChannelOp<Half>::MaxValue());
+            acc[0]          = _mm256_min_ps(_mm256_max_ps(acc[0], lo), hi);
+            acc[1]          = _mm256_min_ps(_mm256_max_ps(acc[1], lo), hi);
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(pDst + x + 0), _mm256_cvtps_ph(acc[0], _MM_FROUND_TO_NEAREST_INT));
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(pDst + x + 2), _mm256_cvtps_ph(acc[1], _MM_FROUND_TO_NEAREST_INT));
+            continue;
+        }
+        ResamplePixelOps<PixelT>::Store4(
+            _mm256_castps256_ps128(acc[0]),
+            _mm256_extractf128_ps(acc[0], 1),
+            _mm256_castps256_ps128(acc[1]),
+            _mm256_extractf128_ps(acc[1], 1),
+            pDst + x);
+    }
+
+    if (x < width)
+    {
+        const float* ppTailRows[3] = {};
+        for (uint32_t k = 0; k < numRows; ++k)
+        {
+            ppTailRows[k] = ppRows[k] + 4 * x;
+        }
+        BlendRowsScalar(ppTailRows, pWeights, numRows, width - x, pDst + x);
+    }
+}
+#endif
+
+// Horizontally filtered source rows, least recently used is replaced
+template <typename PixelT>
+class ResampleRowCache
+{
+public:
+    static const uint32_t kNumSlots = 4; // > max taps
+
+    ResampleRowCache(uint32_t width)
+        : mWidth(width)
+    {
+        for (auto& slot : mSlots)
+        {
+            slot.values.resize(4 * static_cast<size_t>(width));
+        }
+    }
+
+    const float* GetRow(const BitmapT<PixelT>& src, uint32_t srcRow, uint32_t dstRow, const ResampleTaps& taps, ResampleISA isa)
+    {
+        Slot* pSlot = &mSlots[0];
+        for (auto& slot : mSlots)
+        {
+            if (slot.srcRow == srcRow)
+            {
+                slot.lastUsed = dstRow;
+                return slot.values.data();
+            }
+            if (slot.lastUsed < pSlot->lastUsed)
+            {
+                pSlot = &slot;
+            }
+        }
+
+        const PixelT* pSrc = src.GetPixels(0, srcRow);
+        switch (isa)
+        {
+            default: ResampleRowScalar(pSrc, taps, mWidth, pSlot->values.data()); break;
+#if defined(GREX_BITMAP_X64)
+            case RESAMPLE_ISA_SSE2: ResampleRowSSE2(pSrc, taps, mWidth, pSlot->values.data()); break;
+            case RESAMPLE_ISA_AVX2: ResampleRowAVX2(pSrc, taps, mWidth, pSlot->values.data()); break;
+#endif
+        }
+        pSlot->srcRow   = srcRow;
+        pSlot->lastUsed = dstRow;
+
+        return pSlot->values.data();
+    }
+
+private:
+    struct Slot
+    {
+        uint32_t           srcRow   = UINT32_MAX;
+        int64_t            lastUsed = -1;
+        std::vector<float> values;
+    };
+
+    uint32_t mWidth = 0;
+    Slot     mSlots[kNumSlots];
+};
+
+template <typename PixelT>
+void BitmapT<PixelT>::ScaleTo(
+    BitmapSampleMode modeU,
+    BitmapSampleMode modeV,
+    BitmapFilterMode filterMode,
+    BitmapT&         target) const
+{
+    if (target.Empty() || Empty())
+    {
+        return;
+    }
+
+    // GetSample returns black for any out of bounds sample if either mode
+    // is BITMAP_SAMPLE_MODE_BORDER, keep doing the same.
+    if ((modeU == BITMAP_SAMPLE_MODE_BORDER) || (modeV == BITMAP_SAMPLE_MODE_BORDER))
+    {
+        modeU = BITMAP_SAMPLE_MODE_BORDER;
+        modeV = BITMAP_SAMPLE_MODE_BORDER;
+    }
+
+    const uint32_t     dstWidth  = target.GetWidth();
+    const uint32_t     dstHeight = target.GetHeight();
+    const ResampleTaps tapsX     = CalculateResampleTaps(mWidth, dstWidth, modeU, filterMode);
+    const ResampleTaps tapsY     = CalculateResampleTaps(mHeight, dstHeight, modeV, filterMode);
+    const ResampleISA  isa       = GetResampleISA();
+
+    // Rows per job, enough to get reuse out of the row cache
+    const uint32_t kRowsPerJob = 16;
+
+    // Nearest is a plain copy
+    if (filterMode == BITMAP_FILTER_MODE_NEAREST)
+    {
+        ParallelFor(dstHeight, kRowsPerJob, [&](uint32_t begin, uint32_t end) {
+            for (uint32_t row = begin; row < end; ++row)
+            {
+                const PixelT* pSrc   = GetPixels(0, tapsY.indices[row]);
+                PixelT*       pDst   = target.GetPixels(0, row);
+                const bool    border = (tapsY.weights[row] == 0.0f);
+                for (uint32_t col = 0; col < dstWidth; ++col)
+                {
+                    pDst[col] = (border || (tapsX.weights[col] == 0.0f)) ? PixelT::Black() : pSrc[tapsX.indices[col]];
+                }
+            }
+        });
+        return;
+    }
+
+    ParallelFor(dstHeight, kRowsPerJob, [&](uint32_t begin, uint32_t end) {
+        ResampleRowCache<PixelT> cache(dstWidth);
+        for (uint32_t row = begin; row < end; ++row)
+        {
+            const uint32_t* pIndices  = &tapsY.indices[row * tapsY.numTaps];
+            const float*    pWeights  = &tapsY.weights[row * tapsY.numTaps];
+            const float*    ppRows[3] = {};
+            for (uint32_t k = 0; k < tapsY.numTaps; ++k)
+            {
+                ppRows[k] = cache.GetRow(*this, pIndices[k], row, tapsX, isa);
+            }
+
+            PixelT* pDst = target.GetPixels(0, row);
+            switch (isa)
+            {
+                default: BlendRowsScalar(ppRows, pWeights, tapsY.numTaps, dstWidth, pDst); break;
+#if defined(GREX_BITMAP_X64)
+                case RESAMPLE_ISA_SSE2: BlendRowsSSE2(ppRows, pWeights, tapsY.numTaps, dstWidth, pDst); break;
+                case RESAMPLE_ISA_AVX2: BlendRowsAVX2(ppRows, pWeights, tapsY.numTaps, dstWidth, pDst); break;
+#endif
+            }
+        }
+    });
+}
+
+template <typename PixelT>
+void BitmapT<PixelT>::CopyTo(
+    uint32_t x0,
+    uint32_t y0,
+    uint32_t width,
+    uint32_t height,
+    BitmapT& target) const
+{
+    if ((target.GetWidth() != width) && (target.GetHeight() != GetHeight())) {
+        assert(false && "source region dimension doesn't match target dimension");
+        return;
+    }
+
+    uint32_t x1 = x0 + width;
+    uint32_t y1 = y0 + height;
+    if ((x1 > mWidth) || (y1 > mHeight)) {
+        assert(false && "region is out of bounds");
+        return;
+    }
+
+    const char* pSrc   = reinterpret_cast<const char*>(this->GetPixels(x0, y0));
+    char*       pDst   = reinterpret_cast<char*>(target.GetPixels(0, 0));
+    uint32_t    nbytes = target.GetRowStride();
+    for (uint32_t y = 0; y < height; ++y) {
+        memcpy(pDst, pSrc, nbytes);
+        pSrc += this->GetRowStride();
+        pDst += target.GetRowStride();
+    }
+}
+
+// -------------------------------------------------------------------------------------------------
+// Blur
+// -------------------------------------------------------------------------------------------------
+// Above this sigma the blur switches from a sampled Gaussian kernel, whose
+// cost grows with sigma, to stacked box filters, whose cost doesn't.
+static const float kBlurBoxSigmaThreshold = 3.0f;
+
+// Number of stacked box filters, 3 is within a few percent of a Gaussian
+static const uint32_t kBlurNumBoxPasses = 3;
+
+// Columns per vertical pass job. The vertical pass filters a strip of
+// columns at once so it reads contiguous row segments instead of single
+// pixels.
+static const uint32_t kBlurStripWidth = 16;
+
+// Index of element \b i in a line of \b n elements, -1 if it's out of
+// bounds and \b mode is BITMAP_SAMPLE_MODE_BORDER.
+static int64_t CalculateSampleIndex(int64_t i, int64_t n, BitmapSampleMode mode)
+{
+    if ((i >= 0) && (i < n))
+    {
+        return i;
+    }
+
+    switch (mode)
+    {
+        default: return -1;
+        case BITMAP_SAMPLE_MODE_CLAMP: return std::clamp<int64_t>(i, 0, n - 1);
+        case BITMAP_SAMPLE_MODE_WRAP: return ((i % n) + n) % n;
+    }
+}
+
+// Normalized 1D Gaussian with a radius of 3 sigma
+static std::vector<float> CalculateBlurKernel(float sigma)
+{
+    const int32_t      radius = static_cast<int32_t>(std::ceil(3.0f * sigma));
+    std::vector<float> weights(2 * radius + 1);
+
+    float sum = 0.0f;
+    for (int32_t i = -radius; i <= radius; ++i)
+    {
+        float x             = static_cast<float>(i);
+        weights[i + radius] = std::exp(-(x * x) / (2.0f * sigma * sigma));
+        sum += weights[i + radius];
+    }
+    for (auto& weight : weights)
+    {
+        weight /= sum;
+    }
+
+    return weights;
+}
+
+// Radii of kBlurNumBoxPasses box filters that together have the variance
+// of a Gaussian with \b sigma. Mixes two odd widths to get close to the
+// ideal one, see Kovesi, "Fast Almost-Gaussian Filtering".
+static std::vector<uint32_t> CalculateBlurBoxRadii(float sigma)
+{
+    const float n      = static_cast<float>(kBlurNumBoxPasses);
+    const float wIdeal = std::sqrt((12.0f * sigma * sigma / n) + 1.0f);
+
+    int32_t wl = static_cast<int32_t>(std::floor(wIdeal));
+    if ((wl % 2) == 0)
+    {
+        --wl;
+    }
+    const int32_t wu = wl + 2;
+
+    const float   mIdeal = (12.0f * sigma * sigma - n * wl * wl - 4.0f * n * wl - 3.0f * n) / (-4.0f * wl - 4.0f);
+    const int32_t m      = static_cast<int32_t>(std::lround(mIdeal));
+
+    std::vector<uint32_t> radii(kBlurNumBoxPasses);
+    for (int32_t i = 0; i < static_cast<int32_t>(kBlurNumBoxPasses); ++i)
+    {
+        radii[i] = static_cast<uint32_t>(((i < m) ? wl : wu) / 2);
+    }
+
+    return radii;
+}
+
+//
+// The filters work on a line of \b n elements where each element is
+// \b count contiguous floats at pSrc + i * stride. A row is a line of RGBA
+// pixels and a strip of columns is a line of row segments, so the same
+// code does both passes and the inner loops are always contiguous.
+//
+// Lines are copied into a padded buffer first, with \b padding elements on
+// each side filled according to \b mode. The filters then never have to
+// check bounds, and stacked box filters see the same borders a single
+// Gaussian would instead of each pass clamping the previous pass's output.
+//
+static void PadBlurLine(
+    const float*     pSrc,
+    uint32_t         n,
+    size_t           stride,
+    uint32_t         count,
+    uint32_t         padding,
+    BitmapSampleMode mode,
+    float*           pPadded)
+{
+    const int64_t numElements = static_cast<int64_t>(n);
+    for (int64_t i = -static_cast<int64_t>(padding); i < numElements + padding; ++i)
+    {
+        const int64_t index = CalculateSampleIndex(i, numElements, mode);
+
+        float* pOut = pPadded + (i + padding) * count;
+        if (index < 0)
+        {
+            std::fill(pOut, pOut + count, 0.0f);
+        }
+        else
+        {
+            std::copy(pSrc + index * stride, pSrc + index * stride + count, pOut);
+        }
+    }
+}
+
+static void GaussianBlurLine(
+    const float*              pSrc,
+    float*                    pDst,
+    uint32_t                  n,
+    size_t                    stride,
+    uint32_t                  count,
+    const std::vector<float>& weights,
+    BitmapSampleMode          mode,
+    std::vector<float>&       scratch)
+{
+    const uint32_t radius = static_cast<uint32_t>(weights.size() / 2);
+
+    scratch.resize((n + 2 * radius) * static_cast<size_t>(count));
+    PadBlurLine(pSrc, n, stride, count, radius, mode, scratch.data());
+
+    for (uint32_t i = 0; i < n; ++i)
+    {
+        float* pOut = pDst + i * stride;
+        std::fill(pOut, pOut + count, 0.0f);
+
+        // Element i is at i + radius in the padded line
+        const float* pIn = scratch.data() + static_cast<size_t>(i) * count;
+        for (size_t k = 0; k < weights.size(); ++k, pIn += count)
+        {
+            const float weight = weights[k];
+            for (uint32_t c = 0; c < count; ++c)
+            {
+                pOut[c] += weight * pIn[c];
+            }
+        }
+    }
+}
+
+// Running sums, the cost per element doesn't depend on the radii
+static void BoxBlurLine(
+    const float*                 pSrc,
+    float*                       pDst,
+    uint32_t                     n,
+    size_t                       stride,
+    uint32_t                     count,
+    const std::vector<uint32_t>& radii,
+    BitmapSampleMode             mode,
+    std::vector<float>&          scratch)
+{
+    assert((count <= 4 * kBlurStripWidth) && "too many floats per element");
+
+    // Each pass is exact for elements at least its radius away from the
+    // ends of the padded line, so padding by the sum of the radii keeps
+    // the line itself exact.
+    uint32_t padding = 0;
+    for (uint32_t radius : radii)
+    {
+        padding += radius;
+    }
+
+    const int64_t numPadded  = static_cast<int64_t>(n) + 2 * padding;
+    const size_t  lineFloats = static_cast<size_t>(numPadded) * count;
+    scratch.resize(2 * lineFloats);
+
+    float* pA = scratch.data();
+    float* pB = scratch.data() + lineFloats;
+    PadBlurLine(pSrc, n, stride, count, padding, mode, pA);
+
+    for (uint32_t radius : radii)
+    {
+        // Doubles so the sums don't drift along long lines
+        double sums[4 * kBlurStripWidth] = {};
+
+        const int64_t r     = static_cast<int64_t>(radius);
+        const double  scale = 1.0 / static_cast<double>(2 * r + 1);
+        for (int64_t i = 0; i < std::min(r, numPadded); ++i)
+        {
+            const float* pIn = pA + i * count;
+            for (uint32_t c = 0; c < count; ++c)
+            {
+                sums[c] += pIn[c];
+            }
+        }
+
+        // Elements past the ends of the padded line are 0
+        for (int64_t i = 0; i < numPadded; ++i)
+        {
+            if ((i + r) < numPadded)
+            {
+                const float* pIn = pA + (i + r) * count;
+                for (uint32_t c = 0; c < count; ++c)
+                {
+                    sums[c] += pIn[c];
+                }
+            }
+
+            float* pOut = pB + i * count;
+            for (uint32_t c = 0; c < count; ++c)
+            {
+                pOut[c] = static_cast<float>(sums[c] * scale);
+            }
+
+            if ((i - r) >= 0)
+            {
+                const float* pIn = pA + (i - r) * count;
+                for (uint32_t c = 0; c < count; ++c)
+                {
+                    sums[c] -= pIn[c];
+                }
+            }
+        }
+
+        std::swap(pA, pB);
+    }
+
+    for (uint32_t i = 0; i < n; ++i)
+    {
+        const float* pIn = pA + (static_cast<size_t>(i) + padding) * count;
+        std::copy(pIn, pIn + count, pDst + i * stride);
+    }
+}
+
+template <typename PixelT>
+void BitmapT<PixelT>::BlurTo(
+    float            sigma,
+    BitmapSampleMode modeU,
+    BitmapSampleMode modeV,
+    BitmapT&         target) const
+{
+    if (Empty())
+    {
+        return;
+    }
+
+    if ((target.GetWidth() != mWidth) || (target.GetHeight() != mHeight))
+    {
+        assert(false && "target dimensions don't match source dimensions");
+        return;
+    }
+
+    // Filter in RGBA floats, ping ponging between values and temp
+    const size_t       rowSize = 4 * static_cast<size_t>(mWidth);
+    std::vector<float> values(rowSize * mHeight);
+    std::vector<float> temp(rowSize * mHeight);
+
+    const uint32_t kRowsPerJob = 16;
+
+    ParallelFor(mHeight, kRowsPerJob, [&](uint32_t begin, uint32_t end) {
+        for (uint32_t row = begin; row < end; ++row)
+        {
+            const PixelT* pSrc = GetPixels(0, row);
+            float*        pDst = &values[row * rowSize];
+            for (uint32_t col = 0; col < mWidth; ++col)
+            {
+                ResamplePixelOps<PixelT>::Load(pSrc[col], pDst + 4 * col);
+            }
+        }
+    });
+
+    // Horizontal then vertical, LineFn is one of the *BlurLine functions
+    // above minus its filter parameters.
+    auto Filter = [&](auto LineFn) {
+        ParallelFor(mHeight, kRowsPerJob, [&](uint32_t begin, uint32_t end) {
+            std::vector<float> scratch;
+            for (uint32_t row = begin; row < end; ++row)
+            {
+                LineFn(&values[row * rowSize], &temp[row * rowSize], mWidth, 4, 4, modeU, scratch);
+            }
+        });
+        std::swap(values, temp);
+
+        const uint32_t numStrips = (mWidth + kBlurStripWidth - 1) / kBlurStripWidth;
+        ParallelFor(numStrips, 1, [&](uint32_t begin, uint32_t end) {
+            std::vector<float> scratch;
+            for (uint32_t strip = begin; strip < end; ++strip)
+            {
+                const uint32_t col   = strip * kBlurStripWidth;
+                const uint32_t count = 4 * std::min(kBlurStripWidth, mWidth - col);
+                LineFn(&values[4 * col], &temp[4 * col], mHeight, rowSize, count, modeV, scratch);
+            }
+        });
+        std::swap(values, temp);
+    };
+
+    // A sigma of 0 or less is a copy
+    if ((sigma > 0.0f) && (sigma <= kBlurBoxSigmaThreshold))
+    {
+        const std::vector<float> weights = CalculateBlurKernel(sigma);
+        Filter([&](const float* pSrc, float* pDst, uint32_t n, size_t stride, uint32_t count, BitmapSampleMode mode, std::vector<float>& scratch) {
+            GaussianBlurLine(pSrc, pDst, n, stride, count, weights, mode, scratch);
+        });
+    }
+    else if (sigma > kBlurBoxSigmaThreshold)
+    {
+        const std::vector<uint32_t> radii = CalculateBlurBoxRadii(sigma);
+        Filter([&](const float* pSrc, float* pDst, uint32_t n, size_t stride, uint32_t count, BitmapSampleMode mode, std::vector<float>& scratch) {
+            BoxBlurLine(pSrc, pDst, n, stride, count, radii, mode, scratch);
+        });
+    }
+
+    ParallelFor(mHeight, kRowsPerJob, [&](uint32_t begin, uint32_t end) {
+        for (uint32_t row = begin; row < end; ++row)
+        {
+            const float* pSrc = &values[row * rowSize];
+            PixelT*      pDst = target.GetPixels(0, row);
+            for (uint32_t col = 0; col < mWidth; ++col)
+            {
+                ResamplePixelOps<PixelT>::Store(pSrc + 4 * col, &pDst[col]);
+            }
+        }
+    });
+}
+
+// -------------------------------------------------------------------------------------------------
+// Batch sampling
+// -------------------------------------------------------------------------------------------------
+template <typename PixelT>
+struct BilinearSampler
+{
+    template <BitmapSampleMode ModeU, BitmapSampleMode ModeV>
+    static void SampleUV(const BitmapT<PixelT>& bitmap, uint32_t count, const float* pUVs, PixelT* pSamples)
+    {
+        for (uint32_t i = 0; i < count; ++i)
+        {
+            pSamples[i] = bitmap.template GetBilinearSampleUV<ModeU, ModeV>(pUVs[2 * i + 0], pUVs[2 * i + 1]);
+        }
+    }
+};
+
+#if defined(GREX_BITMAP_X64)
+//
+// The four taps are widened to 16 bits and blended with two _mm_madd_epi16,
+// one per row. Fractions have 8 bits like GPU samplers, the weights are
+// 2.14 fixed point and always sum to exactly 1 so constant areas come back
+// unchanged.
+//
+template <>
+struct BilinearSampler<PixelRGBA8u>
 {
+    template <BitmapSampleMode ModeU, BitmapSampleMode ModeV>
+    static void SampleUV(const BitmapT<PixelRGBA8u>& bitmap, uint32_t count, const float* pUVs, PixelRGBA8u* pSamples)
+    {
+        using BitmapType = BitmapT<PixelRGBA8u>;
+
+        const int32_t width  = static_cast<int32_t>(bitmap.GetWidth());
+        const int32_t height = static_cast<int32_t>(bitmap.GetHeight());
+        const float   scaleX = static_cast<float>(width - 1);
+        const float   scaleY = static_cast<float>(height - 1);
+        const __m128i zero   = _mm_setzero_si128();
+        const __m128i round  = _mm_set1_epi32(1 << 13);
+
+        // Out of bounds BITMAP_SAMPLE_MODE_BORDER taps are black
+        const char*    pPixels   = reinterpret_cast<const char*>(bitmap.GetPixels());
+        const uint32_t rowStride = bitmap.GetRowStride();
+        auto           Fetch     = [pPixels, rowStride](int32_t x, int32_t y) -> int32_t {
+            int32_t packed = 0;
+            if ((x >= 0) && (y >= 0))
+            {
+                memcpy(&packed, pPixels + (y * rowStride) + (x * sizeof(PixelRGBA8u)), sizeof(packed));
+            }
+            return packed;
+        };
+
+        // std::floor is a library call without SSE4.1. _mm_cvttss_si32 gives
+        // INT32_MIN for NaN, the fractions are clamped so that's harmless.
+        auto Floor = [](float value) -> int32_t {
+            int32_t i = _mm_cvttss_si32(_mm_set_ss(value));
+            return (value < static_cast<float>(i)) ? (i - 1) : i;
+        };
+        auto Fraction = [](float value) -> int32_t {
+            return std::clamp(_mm_cvttss_si32(_mm_set_ss(value * 256.0f + 0.5f)), 0, 256);
+        };
+
+        for (uint32_t i = 0; i < count; ++i)
+        {
+            const float   x  = pUVs[2 * i + 0] * scaleX;
+            const float   y  = pUVs[2 * i + 1] * scaleY;
+            const int32_t x0 = Floor(x);
+            const int32_t y0 = Floor(y);
+
+            const int32_t fx = Fraction(x - static_cast<float>(x0));
+            const int32_t fy = Fraction(y - static_cast<float>(y0));
+
+            const int32_t w11 = (fx * fy) >> 2;
+            const int32_t w10 = (fx * (256 - fy)) >> 2;
+            const int32_t w01 = ((256 - fx) * fy) >> 2;
+            const int32_t w00 = (1 << 14) - w11 - w10 - w01;
+
+            const int32_t sx0 = BitmapType::CalcSampleCoordinate<ModeU>(x0, width);
+            const int32_t sx1 = BitmapType::CalcSampleCoordinate<ModeU>(x0 + 1, width);
+            const int32_t sy0 = BitmapType::CalcSampleCoordinate<ModeV>(y0, height);
+            const int32_t sy1 = BitmapType::CalcSampleCoordinate<ModeV>(y0 + 1, height);
+
+            // (r0, r1, g0, g1, b0, b1, a0, a1) for each row
+            __m128i top    = _mm_unpacklo_epi8(_mm_cvtsi32_si128(Fetch(sx0, sy0)), _mm_cvtsi32_si128(Fetch(sx1, sy0)));
+            __m128i bottom = _mm_unpacklo_epi8(_mm_cvtsi32_si128(Fetch(sx0, sy1)), _mm_cvtsi32_si128(Fetch(sx1, sy1)));
+            top            = _mm_unpacklo_epi8(top, zero);
+            bottom         = _mm_unpacklo_epi8(bottom, zero);
+
+            __m128i sum = _mm_add_epi32(
+                _mm_madd_epi16(top, _mm_set1_epi32((w10 << 16) | w00)),
+                _mm_madd_epi16(bottom, _mm_set1_epi32((w11 << 16) | w01)));
+            sum = _mm_srli_epi32(_mm_add_epi32(sum, round), 14);
+            sum = _mm_packus_epi16(_mm_packs_epi32(sum, zero), zero);
+
+            const int32_t packed = _mm_cvtsi128_si32(sum);
+            memcpy(static_cast<void*>(&pSamples[i]), &packed, sizeof(packed));
+        }
+    }
 };
+#endif
 
-stbir_edge ToStb(BitmapSampleMode mode)
+template <typename PixelT, BitmapSampleMode ModeU>
+static void BilinearSamplesUV(
+    const BitmapT<PixelT>& bitmap,
+    uint32_t               count,
+    const float*           pUVs,
+    PixelT*                pSamples,
+    BitmapSampleMode       modeV)
 {
-    switch (mode) {
-        default: break;
-        case BITMAP_SAMPLE_MODE_CLAMP: return STBIR_EDGE_CLAMP;
-        case BITMAP_SAMPLE_MODE_WRAP: return STBIR_EDGE_WRAP;
+    switch (modeV)
+    {
+        default: BilinearSampler<PixelT>::template SampleUV<ModeU, BITMAP_SAMPLE_MODE_BORDER>(bitmap, count, pUVs, pSamples); break;
+        case BITMAP_SAMPLE_MODE_CLAMP: BilinearSampler<PixelT>::template SampleUV<ModeU, BITMAP_SAMPLE_MODE_CLAMP>(bitmap, count, pUVs, pSamples); break;
+        case BITMAP_SAMPLE_MODE_WRAP: BilinearSampler<PixelT>::template SampleUV<ModeU, BITMAP_SAMPLE_MODE_WRAP>(bitmap, count, pUVs, pSamples); break;
     }
-    return STBIR_EDGE_ZERO;
 }
 
 template <typename PixelT>
-void BitmapT<PixelT>::ScaleTo(
+void BitmapT<PixelT>::GetBilinearSamplesUV(
+    uint32_t         count,
+    const float*     pUVs,
+    PixelT*          pSamples,
     BitmapSampleMode modeU,
-    BitmapSampleMode modeV,
-    BitmapFilterMode filterMode,
-    BitmapT&         target) const
+    BitmapSampleMode modeV) const
 {
-    if (target.Empty()) {
+    if (Empty())
+    {
+        std::fill(pSamples, pSamples + count, PixelT::Black());
         return;
     }
 
-    float dx             = mWidth / static_cast<float>(target.GetWidth());
-    float dy             = mHeight / static_cast<float>(target.GetHeight());
-    auto  gaussianKernel = GaussianKernel(3);
+    switch (modeU)
+    {
+        default: BilinearSamplesUV<PixelT, BITMAP_SAMPLE_MODE_BORDER>(*this, count, pUVs, pSamples, modeV); break;
+        case BITMAP_SAMPLE_MODE_CLAMP: BilinearSamplesUV<PixelT, BITMAP_SAMPLE_MODE_CLAMP>(*this, count, pUVs, pSamples, modeV); break;
+        case BITMAP_SAMPLE_MODE_WRAP: BilinearSamplesUV<PixelT, BITMAP_SAMPLE_MODE_WRAP>(*this, count, pUVs, pSamples, modeV); break;
+    }
+}
+
+// Explicit instantiation
+template class BitmapT<PixelRGBA8u>;
+template class BitmapT<PixelRGBA16f>;
+template class BitmapT<PixelRGBA32f>;
+template class BitmapT<PixelRGB9E5>;
+
+// =================================================================================================
+// MipmapT
+// =================================================================================================
+// Box filtered tiles are reduced through this many levels on their own,
+// kMipmapTileSize is 2^kMipmapTileLevels.
+static const uint32_t kMipmapTileLevels = 6;
+static const uint32_t kMipmapTileSize   = 1 << kMipmapTileLevels;
+
+// Kaiser taps span 8 source pixels, 4 on each side of the destination
+// pixel's center.
+static const uint32_t kMipmapKaiserTaps = 8;
+
+static float SRGBToLinear(float value)
+{
+    return (value <= 0.04045f) ? (value / 12.92f) : std::pow((value + 0.055f) / 1.055f, 2.4f);
+}
+
+static float LinearToSRGB(float value)
+{
+    return (value <= 0.0031308f) ? (value * 12.92f) : (1.055f * std::pow(value, 1.0f / 2.4f) - 0.055f);
+}
+
+// Converts between stored pixels and the [0, 1] RGBA floats mips are
+// filtered in, see MipmapContent. Alpha is always filtered as is.
+template <typename PixelT>
+class MipmapCodec
+{
+public:
+    static const bool     kIs8u                = std::is_same_v<PixelT, PixelRGBA8u>;
+    static const uint32_t kSRGBEncodeTableSize = 4096;
+
+    MipmapCodec(MipmapContent content)
+        : mContent(content),
+          mScale(kIs8u ? (1.0f / 255.0f) : 1.0f),
+          mInvScale(kIs8u ? 255.0f : 1.0f)
+    {
+        if (kIs8u && (mContent == MIPMAP_CONTENT_COLOR_SRGB))
+        {
+            mSRGBToLinear.resize(256);
+            for (uint32_t i = 0; i < 256; ++i)
+            {
+                mSRGBToLinear[i] = SRGBToLinear(i / 255.0f);
+            }
+
+            // Linear values halfway between codes in sRGB space, the number
+            // of thresholds at or below a value is its rounded code.
+            mSRGBThresholds.resize(255);
+            for (uint32_t i = 0; i < 255; ++i)
+            {
+                mSRGBThresholds[i] = SRGBToLinear((i + 0.5f) / 255.0f);
+            }
+
+            // Code at the start of each bin of linear values, encoding
+            // starts here and steps over the few thresholds left in the bin.
+            mSRGBEncodeTable.resize(kSRGBEncodeTableSize);
+            for (uint32_t i = 0; i < kSRGBEncodeTableSize; ++i)
+            {
+                float value         = i / static_cast<float>(kSRGBEncodeTableSize - 1);
+                auto  it            = std::upper_bound(mSRGBThresholds.begin(), mSRGBThresholds.end(), value);
+                mSRGBEncodeTable[i] = static_cast<uint8_t>(it - mSRGBThresholds.begin());
+            }
+        }
+    }
+
+    // Decodes \b count pixels to RGBA floats
+    void DecodeRow(const PixelT* pPixels, uint32_t count, float* pValues) const
+    {
+        for (uint32_t i = 0; i < count; ++i)
+        {
+            ResamplePixelOps<PixelT>::Load(pPixels[i], pValues + 4 * i);
+        }
+        if (mScale != 1.0f)
+        {
+            for (uint32_t i = 0; i < 4 * count; ++i)
+            {
+                pValues[i] *= mScale;
+            }
+        }
+
+        switch (mContent)
+        {
+            default: break;
+
+            case MIPMAP_CONTENT_COLOR_SRGB:
+            {
+                for (uint32_t i = 0; i < count; ++i)
+                {
+                    float* pValue = pValues + 4 * i;
+                    if constexpr (kIs8u)
+                    {
+                        pValue[0] = mSRGBToLinear[pPixels[i].r];
+                        pValue[1] = mSRGBToLinear[pPixels[i].g];
+                        pValue[2] = mSRGBToLinear[pPixels[i].b];
+                    }
+                    else
+                    {
+                        for (uint32_t c = 0; c < 3; ++c)
+                        {
+                            pValue[c] = SRGBToLinear(pValue[c]);
+                        }
+                    }
+                }
+            } break;
+
+            case MIPMAP_CONTENT_NORMAL:
+            {
+                for (uint32_t i = 0; i < count; ++i)
+                {
+                    float* pValue = pValues + 4 * i;
+                    for (uint32_t c = 0; c < 3; ++c)
+                    {
+                        pValue[c] = 2.0f * pValue[c] - 1.0f;
+                    }
+                }
+            } break;
+
+            // alpha = roughness^2, filter alpha^2
+            case MIPMAP_CONTENT_ROUGHNESS:
+            {
+                for (uint32_t i = 0; i < count; ++i)
+                {
+                    float* pValue = pValues + 4 * i;
+                    for (uint32_t c = 0; c < 3; ++c)
+                    {
+                        float alpha = pValue[c] * pValue[c];
+                        pValue[c]   = alpha * alpha;
+                    }
+                }
+            } break;
+        }
+    }
+
+    // Encodes \b count RGBA floats to pixels
+    void EncodeRow(const float* pValues, uint32_t count, PixelT* pPixels) const
+    {
+        auto Store = [this](float* pValue, PixelT* pPixel) {
+            for (uint32_t c = 0; c < 4; ++c)
+            {
+                pValue[c] *= mInvScale;
+            }
+            ResamplePixelOps<PixelT>::Store(pValue, pPixel);
+        };
+
+        switch (mContent)
+        {
+            default:
+            {
+                for (uint32_t i = 0; i < count; ++i)
+                {
+                    float value[4] = {pValues[4 * i + 0], pValues[4 * i + 1], pValues[4 * i + 2], pValues[4 * i + 3]};
+                    Store(value, &pPixels[i]);
+                }
+            } break;
+
+            case MIPMAP_CONTENT_COLOR_SRGB:
+            {
+                for (uint32_t i = 0; i < count; ++i)
+                {
+                    float value[4] = {pValues[4 * i + 0], pValues[4 * i + 1], pValues[4 * i + 2], pValues[4 * i + 3]};
+                    for (uint32_t c = 0; c < 3; ++c)
+                    {
+                        if constexpr (kIs8u)
+                        {
+                            float    linear = std::clamp(value[c], 0.0f, 1.0f);
+                            uint32_t code   = mSRGBEncodeTable[static_cast<uint32_t>(linear * (kSRGBEncodeTableSize - 1))];
+                            while ((code < 255) && (linear >= mSRGBThresholds[code]))
+                            {
+                                ++code;
+                            }
+                            value[c] = static_cast<float>(code) * mScale;
+                        }
+                        else
+                        {
+                            value[c] = LinearToSRGB(std::max(value[c], 0.0f));
+                        }
+                    }
+                    Store(value, &pPixels[i]);
+                }
+            } break;
+
+            // Unnormalized averages keep the spread of the normals for as
+            // long as possible, normalize on the way out.
+            case MIPMAP_CONTENT_NORMAL:
+            {
+                for (uint32_t i = 0; i < count; ++i)
+                {
+                    float value[4] = {pValues[4 * i + 0], pValues[4 * i + 1], pValues[4 * i + 2], pValues[4 * i + 3]};
+                    float length   = std::sqrt(value[0] * value[0] + value[1] * value[1] + value[2] * value[2]);
+                    if (length > 0.0f)
+                    {
+                        value[0] /= length;
+                        value[1] /= length;
+                        value[2] /= length;
+                    }
+                    else
+                    {
+                        value[0] = 0.0f;
+                        value[1] = 0.0f;
+                        value[2] = 1.0f;
+                    }
+
+                    for (uint32_t c = 0; c < 3; ++c)
+                    {
+                        value[c] = 0.5f * value[c] + 0.5f;
+                    }
+                    Store(value, &pPixels[i]);
+                }
+            } break;
+
+            case MIPMAP_CONTENT_ROUGHNESS:
+            {
+                for (uint32_t i = 0; i < count; ++i)
+                {
+                    float value[4] = {pValues[4 * i + 0], pValues[4 * i + 1], pValues[4 * i + 2], pValues[4 * i + 3]};
+                    for (uint32_t c = 0; c < 3; ++c)
+                    {
+                        value[c] = std::sqrt(std::sqrt(std::max(value[c], 0.0f)));
+                    }
+                    Store(value, &pPixels[i]);
+                }
+            } break;
+        }
+    }
 
-    char* pTargetRow = reinterpret_cast<char*>(target.GetPixels());
-    for (uint32_t row = 0; row < target.GetHeight(); ++row) {
-        PixelT* pPixel = reinterpret_cast<PixelT*>(pTargetRow);
-        for (uint32_t col = 0; col < target.GetWidth(); ++col) {
-            float x = (col * dx) + 0.5f;
-            float y = (row * dy) + 0.5f;
+private:
+    MipmapContent        mContent  = MIPMAP_CONTENT_DATA;
+    float                mScale    = 1.0f; // Stored values to [0, 1]
+    float                mInvScale = 1.0f;
+    std::vector<float>   mSRGBToLinear;
+    std::vector<float>   mSRGBThresholds;
+    std::vector<uint8_t> mSRGBEncodeTable;
+};
 
-            PixelT sample = PixelT::Black();
-            switch (filterMode) {
-                default: {
-                    sample = GetSample(
-                        static_cast<int32_t>(floor(x)),
-                        static_cast<int32_t>(floor(y)),
-                        modeU,
-                        modeV);
-                } break;
+// Tiles of mip0 on separate threads, each tile is reduced through all the
+// levels it covers before moving on so its values stay in cache.
+template <typename MipBitmapT>
+static void BuildMipsBox(
+    const MipmapCodec<typename MipBitmapT::PixelT>& codec,
+    std::vector<MipBitmapT>&                        mips)
+{
+    const uint32_t kTileSize  = kMipmapTileSize;
+    const uint32_t numLevels  = CountU32(mips);
+    const uint32_t tileLevels = std::min(numLevels - 1, kMipmapTileLevels);
+    const uint32_t tilesX     = (mips[0].GetWidth() + kTileSize - 1) / kTileSize;
+    const uint32_t tilesY     = (mips[0].GetHeight() + kTileSize - 1) / kTileSize;
+
+    // Values of the last level the tiles build, the levels below it are
+    // built from these.
+    const uint32_t     tailWidth  = mips[tileLevels].GetWidth();
+    const uint32_t     tailHeight = mips[tileLevels].GetHeight();
+    std::vector<float> tailValues(4 * static_cast<size_t>(tailWidth) * tailHeight);
+
+    auto Average = [](const float* p00, const float* p01, const float* p10, const float* p11, float* pOut) {
+        for (uint32_t c = 0; c < 4; ++c)
+        {
+            pOut[c] = 0.25f * (p00[c] + p01[c] + p10[c] + p11[c]);
+        }
+    };
+
+    ParallelFor(tilesX * tilesY, 1, [&](uint32_t begin, uint32_t end) {
+        // Tile values for the current and next level, rows are always
+        // kTileSize pixels apart.
+        std::vector<float> values(4 * kTileSize * kTileSize);
+        std::vector<float> nextValues(4 * kTileSize * kTileSize);
+
+        for (uint32_t tile = begin; tile < end; ++tile)
+        {
+            const uint32_t tileX = (tile % tilesX) * kTileSize;
+            const uint32_t tileY = (tile / tilesX) * kTileSize;
+
+            const uint32_t width  = std::min(kTileSize, mips[0].GetWidth() - tileX);
+            const uint32_t height = std::min(kTileSize, mips[0].GetHeight() - tileY);
+            for (uint32_t y = 0; y < height; ++y)
+            {
+                codec.DecodeRow(mips[0].GetPixels(tileX, tileY + y), width, &values[4 * y * kTileSize]);
+            }
 
-                case BITMAP_FILTER_MODE_LINEAR: {
-                    sample = GetBilinearSample(
-                        x,
-                        y,
-                        modeU,
-                        modeV);
-                } break;
+            for (uint32_t level = 1; level <= tileLevels; ++level)
+            {
+                MipBitmapT&    mip = mips[level];
+                const uint32_t x0  = tileX >> level;
+                const uint32_t y0  = tileY >> level;
+
+                // Partial tiles at the right and bottom edges run out of
+                // pixels before the full tiles do.
+                if ((x0 >= mip.GetWidth()) || (y0 >= mip.GetHeight()))
+                {
+                    break;
+                }
+
+                const uint32_t levelWidth  = std::min(kTileSize >> level, mip.GetWidth() - x0);
+                const uint32_t levelHeight = std::min(kTileSize >> level, mip.GetHeight() - y0);
+                for (uint32_t y = 0; y < levelHeight; ++y)
+                {
+                    float* pRow = &nextValues[4 * y * kTileSize];
+                    for (uint32_t x = 0; x < levelWidth; ++x)
+                    {
+                        const float* p00 = &values[4 * ((2 * y) * kTileSize + (2 * x))];
+                        const float* p10 = p00 + 4 * kTileSize;
+                        Average(p00, p00 + 4, p10, p10 + 4, pRow + 4 * x);
+                    }
+                    codec.EncodeRow(pRow, levelWidth, mip.GetPixels(x0, y0 + y));
+
+                    if (level == tileLevels)
+                    {
+                        std::copy(pRow, pRow + 4 * levelWidth, &tailValues[4 * (static_cast<size_t>(y0 + y) * tailWidth + x0)]);
+                    }
+                }
+
+                std::swap(values, nextValues);
+            }
+        }
+    });
 
-                case BITMAP_FILTER_MODE_GAUSSIAN: {
-                    sample = GetGaussianSample(
-                        x,
-                        y,
-                        gaussianKernel,
-                        modeU,
-                        modeV);
-                } break;
+    // The remaining levels are at most 1/kTileSize of mip0's size
+    for (uint32_t level = tileLevels + 1; level < numLevels; ++level)
+    {
+        MipBitmapT&    mip       = mips[level];
+        const uint32_t prevWidth = mips[level - 1].GetWidth();
+
+        std::vector<float> values(4 * static_cast<size_t>(mip.GetWidth()) * mip.GetHeight());
+        for (uint32_t y = 0; y < mip.GetHeight(); ++y)
+        {
+            float* pRow = &values[4 * (y * static_cast<size_t>(mip.GetWidth()))];
+            for (uint32_t x = 0; x < mip.GetWidth(); ++x)
+            {
+                const float* p00 = &tailValues[4 * ((2 * y) * static_cast<size_t>(prevWidth) + (2 * x))];
+                const float* p10 = p00 + 4 * prevWidth;
+                Average(p00, p00 + 4, p10, p10 + 4, pRow + 4 * x);
             }
+            codec.EncodeRow(pRow, mip.GetWidth(), mip.GetPixels(0, y));
+        }
 
-            *pPixel = sample;
+        tailValues = std::move(values);
+    }
+}
 
-            ++pPixel;
+// Kaiser windowed sinc for a 2x reduction, alpha = 4
+static std::vector<float> CalculateMipmapKaiserWeights()
+{
+    const float kPi    = 3.14159265359f;
+    const float kAlpha = 4.0f;
+
+    // Zeroth order modified Bessel function of the first kind
+    auto BesselI0 = [](float x) {
+        float sum  = 1.0f;
+        float term = 1.0f;
+        for (uint32_t k = 1; k < 32; ++k)
+        {
+            float t = x / (2.0f * k);
+            term *= t * t;
+            sum += term;
         }
-        pTargetRow += target.GetRowStride();
+        return sum;
+    };
+
+    std::vector<float> weights(kMipmapKaiserTaps);
+
+    float sum = 0.0f;
+    for (uint32_t i = 0; i < kMipmapKaiserTaps; ++i)
+    {
+        // Offset from the destination pixel's center in source pixels,
+        // never 0 since the center is between two source pixels.
+        const float offset = static_cast<float>(i) - 0.5f * (kMipmapKaiserTaps - 1);
+        const float t      = offset / (0.5f * kMipmapKaiserTaps);
+        const float x      = kPi * offset * 0.5f;
+        weights[i]         = (std::sin(x) / x) * (BesselI0(kAlpha * std::sqrt(1.0f - t * t)) / BesselI0(kAlpha));
+        sum += weights[i];
+    }
+    for (auto& weight : weights)
+    {
+        weight /= sum;
     }
+
+    return weights;
 }
 
-template <typename PixelT>
-void BitmapT<PixelT>::CopyTo(
-    uint32_t x0,
-    uint32_t y0,
-    uint32_t width,
-    uint32_t height,
-    BitmapT& target) const
+// Level by level, rows of each level in parallel. Each job filters the
+// source rows it needs horizontally and then combines them vertically.
+template <typename MipBitmapT>
+static void BuildMipsKaiser(
+    const MipmapCodec<typename MipBitmapT::PixelT>& codec,
+    const MipmapOptions&                            options,
+    std::vector<MipBitmapT>&                        mips)
 {
-    if ((target.GetWidth() != width) && (target.GetHeight() != GetHeight())) {
-        assert(false && "source region dimension doesn't match target dimension");
+    const std::vector<float> weights = CalculateMipmapKaiserWeights();
+
+    // First source pixel of destination pixel i is 2i - kFirstTap
+    const int64_t kFirstTap = kMipmapKaiserTaps / 2 - 1;
+
+    const uint32_t kRowsPerJob = 16;
+
+    // Previous level's values, mip0 is decoded from its pixels instead
+    std::vector<float> prevValues;
+
+    for (uint32_t level = 1; level < CountU32(mips); ++level)
+    {
+        const MipBitmapT& src       = mips[level - 1];
+        MipBitmapT&       dst       = mips[level];
+        const uint32_t    srcWidth  = src.GetWidth();
+        const uint32_t    srcHeight = src.GetHeight();
+        const uint32_t    dstWidth  = dst.GetWidth();
+        const bool        lastLevel = (level == (CountU32(mips) - 1));
+
+        std::vector<int64_t> columns(kMipmapKaiserTaps * static_cast<size_t>(dstWidth));
+        for (uint32_t x = 0; x < dstWidth; ++x)
+        {
+            for (uint32_t k = 0; k < kMipmapKaiserTaps; ++k)
+            {
+                columns[x * kMipmapKaiserTaps + k] = CalculateSampleIndex(2 * x - kFirstTap + k, srcWidth, options.modeU);
+            }
+        }
+
+        std::vector<float> values(lastLevel ? 0 : 4 * static_cast<size_t>(dstWidth) * dst.GetHeight());
+
+        ParallelFor(dst.GetHeight(), kRowsPerJob, [&](uint32_t begin, uint32_t end) {
+            const int64_t firstRow = 2 * static_cast<int64_t>(begin) - kFirstTap;
+            const int64_t numRows  = 2 * static_cast<int64_t>(end - begin) + kMipmapKaiserTaps - 2;
+            const size_t  rowSize  = 4 * static_cast<size_t>(dstWidth);
+
+            std::vector<float> srcRow(4 * static_cast<size_t>(srcWidth));
+            std::vector<float> rows(numRows * rowSize, 0.0f);
+            for (int64_t r = 0; r < numRows; ++r)
+            {
+                const int64_t srcY = CalculateSampleIndex(firstRow + r, srcHeight, options.modeV);
+                if (srcY < 0)
+                {
+                    continue;
+                }
+
+                const float* pRow = nullptr;
+                if (prevValues.empty())
+                {
+                    codec.DecodeRow(src.GetPixels(0, static_cast<uint32_t>(srcY)), srcWidth, srcRow.data());
+                    pRow = srcRow.data();
+                }
+                else
+                {
+                    pRow = &prevValues[srcY * 4 * static_cast<size_t>(srcWidth)];
+                }
+
+                float* pOut = &rows[r * rowSize];
+                for (uint32_t x = 0; x < dstWidth; ++x, pOut += 4)
+                {
+                    for (uint32_t k = 0; k < kMipmapKaiserTaps; ++k)
+                    {
+                        const int64_t col = columns[x * kMipmapKaiserTaps + k];
+                        if (col < 0)
+                        {
+                            continue;
+                        }
+                        for (uint32_t c = 0; c < 4; ++c)
+                        {
+                            pOut[c] += weights[k] * pRow[4 * col + c];
+                        }
+                    }
+                }
+            }
+
+            std::vector<float> dstRow(rowSize);
+            for (uint32_t y = begin; y < end; ++y)
+            {
+                std::fill(dstRow.begin(), dstRow.end(), 0.0f);
+                for (uint32_t k = 0; k < kMipmapKaiserTaps; ++k)
+                {
+                    const float* pIn = &rows[(2 * (y - begin) + k) * rowSize];
+                    for (size_t i = 0; i < rowSize; ++i)
+                    {
+                        dstRow[i] += weights[k] * pIn[i];
+                    }
+                }
+                codec.EncodeRow(dstRow.data(), dstWidth, dst.GetPixels(0, y));
+
+                if (!lastLevel)
+                {
+                    std::copy(dstRow.begin(), dstRow.end(), &values[y * rowSize]);
+                }
+            }
+        });
+
+        prevValues = std::move(values);
+    }
+}
+
+template <typename MipBitmapT>
+void MipmapT<MipBitmapT>::BuildMipmap(const MipBitmapT& mip0, const MipmapOptions& options)
+{
+    if (mip0.Empty())
+    {
         return;
     }
 
-    uint32_t x1 = x0 + width;
-    uint32_t y1 = y0 + height;
-    if ((x1 > mWidth) || (y1 > mHeight)) {
-        assert(false && "region is out of bounds");
+    AllocateMips(mip0.GetWidth(), mip0.GetHeight());
+
+    // Copy mip0
+    mip0.CopyTo(0, 0, mip0.GetWidth(), mip0.GetHeight(), mMips[0]);
+
+    if (GetNumLevels() < 2)
+    {
         return;
     }
 
-    const char* pSrc   = reinterpret_cast<const char*>(this->GetPixels(x0, y0));
-    char*       pDst   = reinterpret_cast<char*>(target.GetPixels(0, 0));
-    uint32_t    nbytes = target.GetRowStride();
-    for (uint32_t y = 0; y < height; ++y) {
-        memcpy(pDst, pSrc, nbytes);
-        pSrc += this->GetRowStride();
-        pDst += target.GetRowStride();
+    const MipmapCodec<PixelT> codec(options.content);
+    if (options.filter == MIPMAP_FILTER_KAISER)
+    {
+        BuildMipsKaiser(codec, options, mMips);
+    }
+    else
+    {
+        BuildMipsBox(codec, mMips);
     }
 }
 
 // Explicit instantiation
-template class BitmapT<PixelRGBA8u>;
-template class BitmapT<PixelRGBA32f>;
+template void MipmapT<BitmapRGBA8u>::BuildMipmap(const BitmapRGBA8u&, const MipmapOptions&);
+template void MipmapT<BitmapRGBA16f>::BuildMipmap(const BitmapRGBA16f&, const MipmapOptions&);
+template void MipmapT<BitmapRGBA32f>::BuildMipmap(const BitmapRGBA32f&, const MipmapOptions&);
+template void MipmapT<BitmapRGB9E5>::BuildMipmap(const BitmapRGB9E5&, const MipmapOptions&);
 
 // =================================================================================================
 // BitmapRGB8u
@@ -409,6 +2004,189 @@ bool BitmapRGBA32f::Save(const std::filesystem::path& absPath, const BitmapRGBA3
     return true;
 }
 
+// =================================================================================================
+// BitmapRGBA16f
+// =================================================================================================
+bool BitmapRGBA16f::Load(const std::filesystem::path& absPath, BitmapRGBA16f* pBitmap)
+{
+    if (pBitmap == nullptr)
+    {
+        return false;
+    }
+
+    BitmapRGBA32f bitmap;
+    if (!BitmapRGBA32f::Load(absPath, &bitmap))
+    {
+        return false;
+    }
+
+    *pBitmap = ConvertToRGBA16f(bitmap);
+
+    return true;
+}
+
+bool BitmapRGBA16f::Save(const std::filesystem::path& absPath, const BitmapRGBA16f* pBitmap)
+{
+    if ((pBitmap == nullptr) || pBitmap->Empty())
+    {
+        return false;
+    }
+
+    BitmapRGBA32f bitmap = ConvertToRGBA32f(*pBitmap);
+    return BitmapRGBA32f::Save(absPath, &bitmap);
+}
+
+// =================================================================================================
+// BitmapRGB9E5
+// =================================================================================================
+bool BitmapRGB9E5::Load(const std::filesystem::path& absPath, BitmapRGB9E5* pBitmap)
+{
+    if (pBitmap == nullptr)
+    {
+        return false;
+    }
+
+    BitmapRGBA32f bitmap;
+    if (!BitmapRGBA32f::Load(absPath, &bitmap))
+    {
+        return false;
+    }
+
+    *pBitmap = ConvertToRGB9E5(bitmap);
+
+    return true;
+}
+
+bool BitmapRGB9E5::Save(const std::filesystem::path& absPath, const BitmapRGB9E5* pBitmap)
+{
+    if ((pBitmap == nullptr) || pBitmap->Empty())
+    {
+        return false;
+    }
+
+    BitmapRGBA32f bitmap = ConvertToRGBA32f(*pBitmap);
+    return BitmapRGBA32f::Save(absPath, &bitmap);
+}
+
+// =================================================================================================
+// Conversion
+// =================================================================================================
+#if defined(GREX_BITMAP_X64)
+// 8 values at a time, returns how many were converted
+GREX_TARGET_AVX2 static size_t ConvertFloatToHalfF16C(const float* pSrc, size_t count, Half* pDst)
+{
+    size_t i = 0;
+    for (; (i + 8) <= count; i += 8)
+    {
+        __m128i h = _mm256_cvtps_ph(_mm256_loadu_ps(pSrc + i), _MM_FROUND_TO_NEAREST_INT);
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(pDst + i), h);
+    }
+    return i;
+}
+
+GREX_TARGET_AVX2 static size_t ConvertHalfToFloatF16C(const Half* pSrc, size_t count, float* pDst)
+{
+    size_t i = 0;
+    for (; (i + 8) <= count; i += 8)
+    {
+        __m128i h = _mm_loadu_si128(reinterpret_cast<const __m128i*>(pSrc + i));
+        _mm256_storeu_ps(pDst + i, _mm256_cvtph_ps(h));
+    }
+    return i;
+}
+#endif
+
+void ConvertFloatToHalf(const float* pSrc, size_t count, Half* pDst)
+{
+    size_t i = 0;
+#if defined(GREX_BITMAP_X64)
+    if (GetResampleISA() == RESAMPLE_ISA_AVX2)
+    {
+        i = ConvertFloatToHalfF16C(pSrc, count, pDst);
+    }
+#endif
+    for (; i < count; ++i)
+    {
+        pDst[i] = Half(pSrc[i]);
+    }
+}
+
+void ConvertHalfToFloat(const Half* pSrc, size_t count, float* pDst)
+{
+    size_t i = 0;
+#if defined(GREX_BITMAP_X64)
+    if (GetResampleISA() == RESAMPLE_ISA_AVX2)
+    {
+        i = ConvertHalfToFloatF16C(pSrc, count, pDst);
+    }
+#endif
+    for (; i < count; ++i)
+    {
+        pDst[i] = pSrc[i];
+    }
+}
+
+// Calls \b fn(pSrcRow, pDstRow) for every row, rows in parallel
+template <typename DstBitmapT, typename SrcBitmapT, typename RowFn>
+static DstBitmapT ConvertRows(const SrcBitmapT& bitmap, RowFn fn)
+{
+    if (bitmap.Empty())
+    {
+        return {};
+    }
+
+    DstBitmapT result = DstBitmapT(bitmap.GetWidth(), bitmap.GetHeight());
+
+    const uint32_t kRowsPerJob = 16;
+
+    ParallelFor(bitmap.GetHeight(), kRowsPerJob, [&](uint32_t begin, uint32_t end) {
+        for (uint32_t row = begin; row < end; ++row)
+        {
+            fn(bitmap.GetPixels(0, row), result.GetPixels(0, row));
+        }
+    });
+
+    return result;
+}
+
+BitmapRGBA16f ConvertToRGBA16f(const BitmapRGBA32f& bitmap)
+{
+    const size_t count = 4 * static_cast<size_t>(bitmap.GetWidth());
+    return ConvertRows<BitmapRGBA16f>(bitmap, [count](const PixelRGBA32f* pSrc, PixelRGBA16f* pDst) {
+        ConvertFloatToHalf(&pSrc->r, count, &pDst->r);
+    });
+}
+
+BitmapRGB9E5 ConvertToRGB9E5(const BitmapRGBA32f& bitmap)
+{
+    const uint32_t width = bitmap.GetWidth();
+    return ConvertRows<BitmapRGB9E5>(bitmap, [width](const PixelRGBA32f* pSrc, PixelRGB9E5* pDst) {
+        for (uint32_t x = 0; x < width; ++x)
+        {
+            pDst[x].value = PixelRGB9E5::Encode(pSrc[x].r, pSrc[x].g, pSrc[x].b);
+        }
+    });
+}
+
+BitmapRGBA32f ConvertToRGBA32f(const BitmapRGBA16f& bitmap)
+{
+    const size_t count = 4 * static_cast<size_t>(bitmap.GetWidth());
+    return ConvertRows<BitmapRGBA32f>(bitmap, [count](const PixelRGBA16f* pSrc, PixelRGBA32f* pDst) {
+        ConvertHalfToFloat(&pSrc->r, count, &pDst->r);
+    });
+}
+
+BitmapRGBA32f ConvertToRGBA32f(const BitmapRGB9E5& bitmap)
+{
+    const uint32_t width = bitmap.GetWidth();
+    return ConvertRows<BitmapRGBA32f>(bitmap, [width](const PixelRGB9E5* pSrc, PixelRGBA32f* pDst) {
+        for (uint32_t x = 0; x < width; ++x)
+        {
+            ResamplePixelOps<PixelRGB9E5>::Load(pSrc[x], &pDst[x].r);
+        }
+    });
+}
+
 // =================================================================================================
 // Load functions
 // =================================================================================================
@@ -449,7 +2227,7 @@ BitmapRGBA32f LoadImage32f(const std::filesystem::path& subPath)
     return bitmap;
 }
 
-bool LoadIBLMaps32f(const std::filesystem::path& subPath, IBLMaps* pMaps)
+static bool LoadIBLMaps32f(const std::filesystem::path& subPath, bool loadIrradianceMap, bool loadEnvironmentMap, IBLMaps* pMaps)
 {
     std::filesystem::path absPath = GetAssetPath(subPath);
     if (!std::filesystem::exists(absPath)) {
@@ -475,7 +2253,42 @@ bool LoadIBLMaps32f(const std::filesystem::path& subPath, IBLMaps* pMaps)
     is >> pMaps->baseHeight;
     is >> pMaps->numLevels;
 
+    // Optional tagged values, older files stop here
+    pMaps->hasIrradianceSH = false;
+    pMaps->layout          = IBL_LAYOUT_EQUIRECT;
+    std::string tag;
+    while (is >> tag)
+    {
+        if (tag == "sh9")
+        {
+            for (auto& coefficient : pMaps->irradianceSH)
+            {
+                is >> coefficient[0] >> coefficient[1] >> coefficient[2];
+            }
+            pMaps->hasIrradianceSH = !is.fail();
+        }
+        else if (tag == "layout")
+        {
+            std::string layout;
+            is >> layout;
+            if (layout == "cube")
+            {
+                pMaps->layout = IBL_LAYOUT_CUBE;
+            }
+            else if (layout == "octahedral")
+            {
+                pMaps->layout = IBL_LAYOUT_OCTAHEDRAL;
+            }
+            else if (layout != "equirect")
+            {
+                assert(false && "unknown IBL layout");
+                return false;
+            }
+        }
+    }
+
     // Load irradiance map
+    if (loadIrradianceMap)
     {
         std::filesystem::path absIrrMapPath = absPath.parent_path() / irrMapFilename;
 
@@ -487,11 +2300,13 @@ bool LoadIBLMaps32f(const std::filesystem::path& subPath, IBLMaps* pMaps)
     }
 
     // Environment map
+    if (loadEnvironmentMap)
     {
+        uint32_t numFaces       = (pMaps->layout == IBL_LAYOUT_CUBE) ? 6 : 1;
         uint32_t expectedHeight = 0;
         uint32_t levelHeight    = pMaps->baseHeight;
         for (uint32_t i = 0; i < pMaps->numLevels; ++i) {
-            expectedHeight += levelHeight;
+            expectedHeight += numFaces * levelHeight;
             levelHeight >>= 1;
         }
 
@@ -510,4 +2325,50 @@ bool LoadIBLMaps32f(const std::filesystem::path& subPath, IBLMaps* pMaps)
     }
 
     return true;
+}
+
+bool LoadIBLMaps32f(const std::filesystem::path& subPath, IBLMaps* pMaps)
+{
+    return LoadIBLMaps32f(subPath, true, true, pMaps);
+}
+
+bool LoadIBLIrradianceMap32f(const std::filesystem::path& subPath, IBLMaps* pMaps)
+{
+    return LoadIBLMaps32f(subPath, true, false, pMaps);
+}
+
+bool LoadIBLHeader(const std::filesystem::path& subPath, IBLMaps* pMaps)
+{
+    return LoadIBLMaps32f(subPath, false, false, pMaps);
+}
+
+std::vector<MipOffset> GetIBLCubeFaceOffsets(const IBLMaps& maps)
+{
+    std::vector<MipOffset> offsets;
+    if ((maps.layout != IBL_LAYOUT_CUBE) || maps.environmentMap.Empty())
+    {
+        return offsets;
+    }
+
+    // Levels are stacked with their 6 faces one under the other, the
+    // offsets are layer major so every face lists all its levels
+    const uint32_t rowStride = maps.environmentMap.GetRowStride();
+    offsets.resize(6 * maps.numLevels);
+
+    uint32_t faceSize = maps.baseHeight;
+    uint32_t row      = 0;
+    for (uint32_t level = 0; level < maps.numLevels; ++level)
+    {
+        for (uint32_t face = 0; face < 6; ++face)
+        {
+            MipOffset& offset = offsets[face * maps.numLevels + level];
+            offset.Offset     = row * rowStride;
+            offset.RowStride  = rowStride;
+
+            row += faceSize;
+        }
+        faceSize >>= 1;
+    }
+
+    return offsets;
 }
\ No newline at end of file
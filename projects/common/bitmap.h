@@ -2,6 +2,7 @@
 
 #include <cfloat>
 #include <cmath>
+#include <cstring>
 #include "config.h"
 
 enum BitmapSampleMode
@@ -53,6 +54,121 @@ struct ChannelOp<float>
     }
 };
 
+//
+// IEEE 754 half precision float. Converts to and from float implicitly so
+// Pixel4T<Half> works like Pixel4T<float>, arithmetic is done in float.
+// Conversions round to nearest even, values past the largest half
+// become infinity.
+//
+struct Half
+{
+    uint16_t bits = 0;
+
+    Half() {}
+
+    Half(float value)
+        : bits(Encode(value))
+    {
+    }
+
+    operator float() const
+    {
+        return Decode(bits);
+    }
+
+    Half& operator+=(Half rhs)
+    {
+        bits = Encode(Decode(bits) + Decode(rhs.bits));
+        return *this;
+    }
+
+    static uint16_t Encode(float value)
+    {
+        uint32_t f = 0;
+        memcpy(&f, &value, sizeof(f));
+
+        const uint32_t sign = f & 0x80000000;
+        f ^= sign;
+
+        uint32_t h = 0;
+        if (f >= 0x47800000)
+        {
+            // 2^16 and up is infinity, NaN stays NaN
+            h = (f > 0x7F800000) ? 0x7E00 : 0x7C00;
+        }
+        else if (f < 0x38800000)
+        {
+            // Subnormal or zero: adding 0.5 lines the 10 mantissa bits up
+            // at the bottom of the float and the FPU does the rounding
+            const uint32_t kMagic  = 126 << 23;
+            float          magic   = 0;
+            float          shifted = 0;
+            memcpy(&magic, &kMagic, sizeof(magic));
+            memcpy(&shifted, &f, sizeof(shifted));
+            shifted += magic;
+            memcpy(&h, &shifted, sizeof(h));
+            h -= kMagic;
+        }
+        else
+        {
+            // Rebias the exponent and round the mantissa to nearest even
+            const uint32_t odd = (f >> 13) & 1;
+            f -= (127 - 15) << 23;
+            f += 0xFFF + odd;
+            h = f >> 13;
+        }
+
+        return static_cast<uint16_t>(h | (sign >> 16));
+    }
+
+    static float Decode(uint16_t value)
+    {
+        const uint32_t kExponentMask = 0x7C00 << 13;
+
+        uint32_t       f        = (value & 0x7FFF) << 13;
+        const uint32_t exponent = f & kExponentMask;
+        f += (127 - 15) << 23;
+
+        if (exponent == kExponentMask)
+        {
+            // Infinity or NaN
+            f += (128 - 16) << 23;
+        }
+        else if (exponent == 0)
+        {
+            // Subnormal or zero, renormalize
+            const uint32_t kMagic = 113 << 23;
+            float          magic  = 0;
+            float          result = 0;
+            f += 1 << 23;
+            memcpy(&magic, &kMagic, sizeof(magic));
+            memcpy(&result, &f, sizeof(result));
+            result -= magic;
+            memcpy(&f, &result, sizeof(f));
+        }
+
+        f |= static_cast<uint32_t>(value & 0x8000) << 16;
+
+        float result = 0;
+        memcpy(&result, &f, sizeof(result));
+        return result;
+    }
+};
+
+template <>
+struct ChannelOp<Half>
+{
+    static float MaxValue()
+    {
+        return 65504.0f;
+    }
+
+    static Half Multiply(Half value, float s)
+    {
+        return Half(value * s);
+    }
+};
+
 template <typename T>
 struct Pixel3T
 {
@@ -251,6 +367,118 @@ struct Pixel4T
     }
 };
 
+//
+// Shared exponent RGB: three 9 bit mantissas and a 5 bit exponent in 32
+// bits, the layout of DXGI_FORMAT_R9G9B9E5_SHAREDEXP and
+// VK_FORMAT_E5B9G9R9_UFLOAT_PACK32. R is in bits 0-8, G in 9-17, B in
+// 18-26 and the exponent in 27-31. Negative values are stored as 0 and
+// there's no alpha, it reads back as 1. Arithmetic is done in
+// Pixel4T<float>.
+//
+struct PixelRGB9E5
+{
+    static const uint32_t NumChannels   = 3;
+    static const uint32_t ChannelStride = 0; // Channels share bits
+    static const uint32_t PixelStride   = sizeof(uint32_t);
+
+    static const int32_t MantissaBits = 9;
+    static const int32_t ExponentBias = 15;
+    static const int32_t MaxExponent  = 31;
+
+    uint32_t value = 0;
+
+    PixelRGB9E5() {}
+
+    PixelRGB9E5(float r, float g, float b)
+        : value(Encode(r, g, b))
+    {
+    }
+
+    PixelRGB9E5(const Pixel4T<float>& obj)
+        : value(Encode(obj.r, obj.g, obj.b))
+    {
+    }
+
+    operator Pixel4T<float>() const
+    {
+        float rgb[3] = {};
+        Decode(value, rgb);
+        return Pixel4T<float>(rgb[0], rgb[1], rgb[2], 1.0f);
+    }
+
+    static PixelRGB9E5 Black()
+    {
+        return PixelRGB9E5();
+    }
+
+    static PixelRGB9E5 Bilinear(
+        float              u0,
+        float              v0,
+        float              u1,
+        float              v1,
+        const PixelRGB9E5& Pu0v0,
+        const PixelRGB9E5& Pu1v0,
+        const PixelRGB9E5& Pu0v1,
+        const PixelRGB9E5& Pu1v1)
+    {
+        return PixelRGB9E5(Pixel4T<float>::Bilinear(u0, v0, u1, v1, Pu0v0, Pu1v0, Pu0v1, Pu1v1));
+    }
+
+    static PixelRGB9E5 ClampToMaxNoConvert(const Pixel4T<float>& src)
+    {
+        return PixelRGB9E5(src);
+    }
+
+    // Largest value the shared exponent can hold, 511/512 * 2^16
+    static float MaxValue()
+    {
+        return std::ldexp(static_cast<float>((1 << MantissaBits) - 1), MaxExponent - ExponentBias - MantissaBits);
+    }
+
+    static uint32_t Encode(float r, float g, float b)
+    {
+        // NaN goes to 0 along with negative values
+        auto Clamp = [](float x) -> float { return (x > 0.0f) ? std::min(x, MaxValue()) : 0.0f; };
+        r          = Clamp(r);
+        g          = Clamp(g);
+        b          = Clamp(b);
+
+        const float maxChannel = std::max(r, std::max(g, b));
+        if (maxChannel == 0.0f)
+        {
+            return 0;
+        }
+
+        // Smallest exponent that holds the largest channel, maxChannel is
+        // m * 2^e with m in [0.5, 1)
+        int32_t e = 0;
+        std::frexp(maxChannel, &e);
+        int32_t exponent = std::max(e, -ExponentBias) + ExponentBias;
+
+        // Rounding can carry the largest mantissa over into the next
+        // exponent
+        float scale = std::ldexp(1.0f, MantissaBits + ExponentBias - exponent);
+        if (static_cast<uint32_t>(maxChannel * scale + 0.5f) == (1u << MantissaBits))
+        {
+            ++exponent;
+            scale *= 0.5f;
+        }
+
+        const uint32_t rm = static_cast<uint32_t>(r * scale + 0.5f);
+        const uint32_t gm = static_cast<uint32_t>(g * scale + 0.5f);
+        const uint32_t bm = static_cast<uint32_t>(b * scale + 0.5f);
+        return rm | (gm << 9) | (bm << 18) | (static_cast<uint32_t>(exponent) << 27);
+    }
+
+    static void Decode(uint32_t value, float* pRGB)
+    {
+        const float scale = std::ldexp(1.0f, static_cast<int32_t>(value >> 27) - ExponentBias - MantissaBits);
+        pRGB[0]           = static_cast<float>(value & 0x1FF) * scale;
+        pRGB[1]           = static_cast<float>((value >> 9) & 0x1FF) * scale;
+        pRGB[2]           = static_cast<float>((value >> 18) & 0x1FF) * scale;
+    }
+};
+
 template <typename T>
 struct SelectPixel32f
 {
@@ -274,12 +502,24 @@ struct SelectPixel32f<Pixel4T<uint8_t>>
     using type = Pixel4T<float>;
 };
 
+template <>
+struct SelectPixel32f<Pixel4T<Half>>
+{
+    using type = Pixel4T<float>;
+};
+
 template <>
 struct SelectPixel32f<Pixel4T<float>>
 {
     using type = Pixel4T<float>;
 };
 
+template <>
+struct SelectPixel32f<PixelRGB9E5>
+{
+    using type = Pixel4T<float>;
+};
+
 template <typename PixelT>
 class BitmapT
 {
@@ -521,6 +761,85 @@ public:
         return pixel;
     }
 
+    //
+    // Compile time versions of the functions above for inner loops, the
+    // sample modes are template parameters so there's no switch per tap.
+    // Unlike GetSample, the modes apply per axis: a sample that's only out
+    // of bounds along U is addressed with ModeU even if ModeV is
+    // BITMAP_SAMPLE_MODE_BORDER.
+    //
+    // Returns -1 for out of bounds BITMAP_SAMPLE_MODE_BORDER coordinates.
+    template <BitmapSampleMode Mode>
+    static int32_t CalcSampleCoordinate(int32_t x, int32_t res)
+    {
+        if ((x >= 0) && (x < res))
+        {
+            return x;
+        }
+
+        if constexpr (Mode == BITMAP_SAMPLE_MODE_WRAP)
+        {
+            x = x % res;
+            return (x < 0) ? (x + res) : x;
+        }
+        else if constexpr (Mode == BITMAP_SAMPLE_MODE_CLAMP)
+        {
+            return (x < 0) ? 0 : (res - 1);
+        }
+        else
+        {
+            return -1;
+        }
+    }
+
+    template <BitmapSampleMode ModeU, BitmapSampleMode ModeV>
+    PixelT GetSample(int32_t x, int32_t y) const
+    {
+        x = CalcSampleCoordinate<ModeU>(x, static_cast<int32_t>(mWidth));
+        y = CalcSampleCoordinate<ModeV>(y, static_cast<int32_t>(mHeight));
+        if ((x < 0) || (y < 0))
+        {
+            return PixelT::Black();
+        }
+        return *GetPixels(x, y);
+    }
+
+    template <BitmapSampleMode ModeU, BitmapSampleMode ModeV>
+    PixelT GetBilinearSample(float x, float y) const
+    {
+        int32_t x0    = static_cast<int32_t>(floor(x));
+        int32_t y0    = static_cast<int32_t>(floor(y));
+        float   u1    = x - x0;
+        float   u0    = 1.0f - u1;
+        float   v1    = y - y0;
+        float   v0    = 1.0f - v1;
+        PixelT  Pu0v0 = GetSample<ModeU, ModeV>(x0, y0);
+        PixelT  Pu1v0 = GetSample<ModeU, ModeV>(x0 + 1, y0);
+        PixelT  Pu0v1 = GetSample<ModeU, ModeV>(x0, y0 + 1);
+        PixelT  Pu1v1 = GetSample<ModeU, ModeV>(x0 + 1, y0 + 1);
+        PixelT  pixel = PixelT::Bilinear(u0, v0, u1, v1, Pu0v0, Pu1v0, Pu0v1, Pu1v1);
+        return pixel;
+    }
+
+    template <BitmapSampleMode ModeU, BitmapSampleMode ModeV>
+    PixelT GetBilinearSampleUV(float u, float v) const
+    {
+        float x = u * static_cast<float>(mWidth - 1);
+        float y = v * static_cast<float>(mHeight - 1);
+        return GetBilinearSample<ModeU, ModeV>(x, y);
+    }
+
+    // Bilinear samples at \b count UVs, \b pUVs holds (u, v) pairs. Same
+    // as calling GetBilinearSampleUV<modeU, modeV> for each of them, the
+    // modes are resolved once per call. 8-bit RGBA bitmaps are filtered in
+    // 16-bit fixed point with SSE2 and round instead of truncating.
+    void GetBilinearSamplesUV(
+        uint32_t         count,
+        const float*     pUVs,
+        PixelT*          pSamples,
+        BitmapSampleMode modeU = BITMAP_SAMPLE_MODE_BORDER,
+        BitmapSampleMode modeV = BITMAP_SAMPLE_MODE_BORDER) const;
+
     PixelT GetGaussianSample(
         float                     x,
         float                     y,
@@ -589,6 +908,16 @@ protected:
         uint32_t height,
         BitmapT& target) const;
 
+    // Separable Gaussian blur with \b sigma in pixels, \b target must be
+    // the same size and can be this bitmap. Small sigmas use a sampled
+    // kernel, large ones use stacked box filters that cost the same for
+    // any sigma. BITMAP_SAMPLE_MODE_BORDER treats pixels outside as black.
+    void BlurTo(
+        float            sigma,
+        BitmapSampleMode modeU,
+        BitmapSampleMode modeV,
+        BitmapT&         target) const;
+
 protected:
     uint32_t            mWidth           = 0;
     uint32_t            mHeight          = 0;
@@ -600,6 +929,7 @@ protected:
 using PixelRGB8u   = Pixel3T<unsigned char>;
 using PixelRGB32f  = Pixel3T<float>;
 using PixelRGBA8u  = Pixel4T<unsigned char>;
+using PixelRGBA16f = Pixel4T<Half>;
 using PixelRGBA32f = Pixel4T<float>;
 
 //! @class BitmapRGB8u
@@ -706,6 +1036,31 @@ public:
         BitmapT<PixelRGBA8u>::CopyTo(x0, y0, width, height, target);
     }
 
+    BitmapRGBA8u Blur(
+        float            sigma,
+        BitmapSampleMode modeU = BITMAP_SAMPLE_MODE_CLAMP,
+        BitmapSampleMode modeV = BITMAP_SAMPLE_MODE_CLAMP) const
+    {
+        if (Empty())
+        {
+            return {};
+        }
+
+        BitmapRGBA8u newBitmap = BitmapRGBA8u(mWidth, mHeight);
+        BlurTo(sigma, modeU, modeV, newBitmap);
+
+        return newBitmap;
+    }
+
+    void BlurTo(
+        float            sigma,
+        BitmapSampleMode modeU,
+        BitmapSampleMode modeV,
+        BitmapRGBA8u&    target) const
+    {
+        BitmapT<PixelRGBA8u>::BlurTo(sigma, modeU, modeV, target);
+    }
+
     static bool Load(const std::filesystem::path& absPath, BitmapRGBA8u* pBitmap);
     static bool Load(const size_t srcDataSize, const void* pSrcData, BitmapRGBA8u* pBitmap);
     static bool Save(const std::filesystem::path& absPath, const BitmapRGBA8u* pBitmap);
@@ -750,6 +1105,50 @@ public:
         return newBitmap;
     }
 
+    void ScaleTo(
+        BitmapSampleMode modeU,
+        BitmapSampleMode modeV,
+        BitmapFilterMode filterMode,
+        BitmapRGBA32f&   target) const
+    {
+        BitmapT<PixelRGBA32f>::ScaleTo(modeU, modeV, filterMode, target);
+    }
+
+    void CopyTo(
+        uint32_t       x0,
+        uint32_t       y0,
+        uint32_t       width,
+        uint32_t       height,
+        BitmapRGBA32f& target) const
+    {
+        BitmapT<PixelRGBA32f>::CopyTo(x0, y0, width, height, target);
+    }
+
+    BitmapRGBA32f Blur(
+        float            sigma,
+        BitmapSampleMode modeU = BITMAP_SAMPLE_MODE_CLAMP,
+        BitmapSampleMode modeV = BITMAP_SAMPLE_MODE_CLAMP) const
+    {
+        if (Empty())
+        {
+            return {};
+        }
+
+        BitmapRGBA32f newBitmap = BitmapRGBA32f(mWidth, mHeight);
+        BlurTo(sigma, modeU, modeV, newBitmap);
+
+        return newBitmap;
+    }
+
+    void BlurTo(
+        float            sigma,
+        BitmapSampleMode modeU,
+        BitmapSampleMode modeV,
+        BitmapRGBA32f&   target) const
+    {
+        BitmapT<PixelRGBA32f>::BlurTo(sigma, modeU, modeV, target);
+    }
+
     BitmapRGBA32f CopyFrom(uint32_t x, uint32_t y, uint32_t width, uint32_t height) const
     {
         if ((width == 0) || (height == 0))
@@ -767,6 +1166,221 @@ public:
     static bool Save(const std::filesystem::path& absPath, const BitmapRGBA32f* pBitmap);
 };
 
+//! @class BitmapRGBA16f
+//!
+//! Half the size of BitmapRGBA32f
+class BitmapRGBA16f : public BitmapT<PixelRGBA16f>
+{
+public:
+    using PixelT = PixelRGBA16f;
+
+    BitmapRGBA16f()
+        : BitmapT<PixelRGBA16f>() {}
+
+    BitmapRGBA16f(uint32_t width, uint32_t height)
+        : BitmapT<PixelRGBA16f>(width, height) {}
+
+    BitmapRGBA16f(uint32_t width, uint32_t height, uint32_t rowStride, void* pExternalStorage)
+        : BitmapT<PixelRGBA16f>(width, height, rowStride, pExternalStorage) {}
+
+    ~BitmapRGBA16f() {}
+
+    BitmapRGBA16f Scale(
+        float            xScale,
+        float            yScale,
+        BitmapSampleMode modeU      = BITMAP_SAMPLE_MODE_BORDER,
+        BitmapSampleMode modeV      = BITMAP_SAMPLE_MODE_BORDER,
+        BitmapFilterMode filterMode = BITMAP_FILTER_MODE_NEAREST) const
+    {
+        uint32_t newWidth  = static_cast<uint32_t>((mWidth * std::max<float>(0, xScale)));
+        uint32_t newHeight = static_cast<uint32_t>((mHeight * std::max<float>(0, yScale)));
+        if ((newWidth == 0) || (newHeight == 0))
+        {
+            return {};
+        }
+
+        BitmapRGBA16f newBitmap = BitmapRGBA16f(newWidth, newHeight);
+        ScaleTo(modeU, modeV, filterMode, newBitmap);
+
+        return newBitmap;
+    }
+
+    void ScaleTo(
+        BitmapSampleMode modeU,
+        BitmapSampleMode modeV,
+        BitmapFilterMode filterMode,
+        BitmapRGBA16f&   target) const
+    {
+        BitmapT<PixelRGBA16f>::ScaleTo(modeU, modeV, filterMode, target);
+    }
+
+    void CopyTo(
+        uint32_t       x0,
+        uint32_t       y0,
+        uint32_t       width,
+        uint32_t       height,
+        BitmapRGBA16f& target) const
+    {
+        BitmapT<PixelRGBA16f>::CopyTo(x0, y0, width, height, target);
+    }
+
+    BitmapRGBA16f Blur(
+        float            sigma,
+        BitmapSampleMode modeU = BITMAP_SAMPLE_MODE_CLAMP,
+        BitmapSampleMode modeV = BITMAP_SAMPLE_MODE_CLAMP) const
+    {
+        if (Empty())
+        {
+            return {};
+        }
+
+        BitmapRGBA16f newBitmap = BitmapRGBA16f(mWidth, mHeight);
+        BlurTo(sigma, modeU, modeV, newBitmap);
+
+        return newBitmap;
+    }
+
+    void BlurTo(
+        float            sigma,
+        BitmapSampleMode modeU,
+        BitmapSampleMode modeV,
+        BitmapRGBA16f&   target) const
+    {
+        BitmapT<PixelRGBA16f>::BlurTo(sigma, modeU, modeV, target);
+    }
+
+    BitmapRGBA16f CopyFrom(uint32_t x, uint32_t y, uint32_t width, uint32_t height) const
+    {
+        if ((width == 0) || (height == 0))
+        {
+            return {};
+        }
+
+        BitmapRGBA16f newBitmap = BitmapRGBA16f(width, height);
+        CopyTo(x, y, width, height, newBitmap);
+
+        return newBitmap;
+    }
+
+    // Same files as BitmapRGBA32f, converted on the way in and out
+    static bool Load(const std::filesystem::path& absPath, BitmapRGBA16f* pBitmap);
+    static bool Save(const std::filesystem::path& absPath, const BitmapRGBA16f* pBitmap);
+};
+
+//! @class BitmapRGB9E5
+//!
+//! A quarter the size of BitmapRGBA32f, for HDR color without alpha
+class BitmapRGB9E5 : public BitmapT<PixelRGB9E5>
+{
+public:
+    using PixelT = PixelRGB9E5;
+
+    BitmapRGB9E5()
+        : BitmapT<PixelRGB9E5>() {}
+
+    BitmapRGB9E5(uint32_t width, uint32_t height)
+        : BitmapT<PixelRGB9E5>(width, height) {}
+
+    BitmapRGB9E5(uint32_t width, uint32_t height, uint32_t rowStride, void* pExternalStorage)
+        : BitmapT<PixelRGB9E5>(width, height, rowStride, pExternalStorage) {}
+
+    ~BitmapRGB9E5() {}
+
+    BitmapRGB9E5 Scale(
+        float            xScale,
+        float            yScale,
+        BitmapSampleMode modeU      = BITMAP_SAMPLE_MODE_BORDER,
+        BitmapSampleMode modeV      = BITMAP_SAMPLE_MODE_BORDER,
+        BitmapFilterMode filterMode = BITMAP_FILTER_MODE_NEAREST) const
+    {
+        uint32_t newWidth  = static_cast<uint32_t>((mWidth * std::max<float>(0, xScale)));
+        uint32_t newHeight = static_cast<uint32_t>((mHeight * std::max<float>(0, yScale)));
+        if ((newWidth == 0) || (newHeight == 0))
+        {
+            return {};
+        }
+
+        BitmapRGB9E5 newBitmap = BitmapRGB9E5(newWidth, newHeight);
+        ScaleTo(modeU, modeV, filterMode, newBitmap);
+
+        return newBitmap;
+    }
+
+    void ScaleTo(
+        BitmapSampleMode modeU,
+        BitmapSampleMode modeV,
+        BitmapFilterMode filterMode,
+        BitmapRGB9E5&    target) const
+    {
+        BitmapT<PixelRGB9E5>::ScaleTo(modeU, modeV, filterMode, target);
+    }
+
+    void CopyTo(
+        uint32_t      x0,
+        uint32_t      y0,
+        uint32_t      width,
+        uint32_t      height,
+        BitmapRGB9E5& target) const
+    {
+        BitmapT<PixelRGB9E5>::CopyTo(x0, y0, width, height, target);
+    }
+
+    BitmapRGB9E5 Blur(
+        float            sigma,
+        BitmapSampleMode modeU = BITMAP_SAMPLE_MODE_CLAMP,
+        BitmapSampleMode modeV = BITMAP_SAMPLE_MODE_CLAMP) const
+    {
+        if (Empty())
+        {
+            return {};
+        }
+
+        BitmapRGB9E5 newBitmap = BitmapRGB9E5(mWidth, mHeight);
+        BlurTo(sigma, modeU, modeV, newBitmap);
+
+        return newBitmap;
+    }
+
+    void BlurTo(
+        float            sigma,
+        BitmapSampleMode modeU,
+        BitmapSampleMode modeV,
+        BitmapRGB9E5&    target) const
+    {
+        BitmapT<PixelRGB9E5>::BlurTo(sigma, modeU, modeV, target);
+    }
+
+    BitmapRGB9E5 CopyFrom(uint32_t x, uint32_t y, uint32_t width, uint32_t height) const
+    {
+        if ((width == 0) || (height == 0))
+        {
+            return {};
+        }
+
+        BitmapRGB9E5 newBitmap = BitmapRGB9E5(width, height);
+        CopyTo(x, y, width, height, newBitmap);
+
+        return newBitmap;
+    }
+
+    // Same files as BitmapRGBA32f, converted on the way in and out
+    static bool Load(const std::filesystem::path& absPath, BitmapRGB9E5* pBitmap);
+    static bool Save(const std::filesystem::path& absPath, const BitmapRGB9E5* pBitmap);
+};
+
+// =================================================================================================
+// Conversion
+// =================================================================================================
+// \b count floats to halfs and back, F16C on CPUs that have it
+void ConvertFloatToHalf(const float* pSrc, size_t count, Half* pDst);
+void ConvertHalfToFloat(const Half* pSrc, size_t count, float* pDst);
+
+// Rows in parallel, the result is the same size as \b bitmap
+BitmapRGBA16f ConvertToRGBA16f(const BitmapRGBA32f& bitmap);
+BitmapRGB9E5  ConvertToRGB9E5(const BitmapRGBA32f& bitmap); // Alpha is dropped
+BitmapRGBA32f ConvertToRGBA32f(const BitmapRGBA16f& bitmap);
+BitmapRGBA32f ConvertToRGBA32f(const BitmapRGB9E5& bitmap); // Alpha is 1
+
 // =================================================================================================
 // Load functions
 // =================================================================================================
@@ -777,17 +1391,49 @@ BitmapRGBA32f LoadImage32f(const std::filesystem::path& subPath);
 // =================================================================================================
 // IBL
 // =================================================================================================
+//
+// How the environment map levels are laid out. Levels are stacked
+// vertically in all layouts, starting with the largest.
+//
+enum IBLLayout
+{
+    IBL_LAYOUT_EQUIRECT   = 0, // baseWidth x baseHeight, halved every level
+    IBL_LAYOUT_CUBE       = 1, // Faces stacked +X, -X, +Y, -Y, +Z, -Z, baseWidth is the face size
+    IBL_LAYOUT_OCTAHEDRAL = 2, // Square, Y up, -Y folded into the corners
+};
+
 struct IBLMaps
 {
-    BitmapRGBA32f irradianceMap;
+    BitmapRGBA32f irradianceMap; // Always equirect
     BitmapRGBA32f environmentMap;
     uint32_t      baseWidth;
     uint32_t      baseHeight;
     uint32_t      numLevels;
+    IBLLayout     layout = IBL_LAYOUT_EQUIRECT;
+
+    // Optional, written by ibl_prefilter_env --irr-sh. RGB coefficients of
+    // the first 9 real SH basis functions, already convolved so that
+    // evaluating them at N gives the irradiance map value at N.
+    bool  hasIrradianceSH    = false;
+    float irradianceSH[9][3] = {};
 };
 
 bool LoadIBLMaps32f(const std::filesystem::path& subPath, IBLMaps* pMaps);
 
+// Only reads the dimensions and the irradiance map, environmentMap is left
+// empty. The irradiance map is small enough to stand in for the
+// environment map while that loads.
+bool LoadIBLIrradianceMap32f(const std::filesystem::path& subPath, IBLMaps* pMaps);
+
+// Only reads the .ibl file: dimensions, layout and SH coefficients, both
+// maps are left empty
+bool LoadIBLHeader(const std::filesystem::path& subPath, IBLMaps* pMaps);
+
+// Offsets of every face of every level in environmentMap for uploading an
+// IBL_LAYOUT_CUBE map as a cube texture, layer major like the array
+// CreateTexture overloads: [face * numLevels + level].
+std::vector<MipOffset> GetIBLCubeFaceOffsets(const IBLMaps& maps);
+
 // =================================================================================================
 // Image processing
 // =================================================================================================
@@ -840,6 +1486,35 @@ inline std::vector<float> GaussianKernel(uint32_t kernelSize, float sigma = 0)
 // =================================================================================================
 #define MAX_MIP_LEVELS 16
 
+enum MipmapFilter
+{
+    MIPMAP_FILTER_BOX    = 0, // 2x2 average
+    MIPMAP_FILTER_KAISER = 1, // 8x8 Kaiser windowed sinc, sharper but slower
+};
+
+enum MipmapContent
+{
+    MIPMAP_CONTENT_DATA       = 0, // Filtered as is
+    MIPMAP_CONTENT_COLOR_SRGB = 1, // RGB is sRGB encoded and filtered in linear light
+    MIPMAP_CONTENT_NORMAL     = 2, // RGB is a [0, 1] packed normal, filtered as vectors and renormalized
+    MIPMAP_CONTENT_ROUGHNESS  = 3, // RGB is perceptual roughness, filtered as alpha^2 so highlights don't get sharper
+};
+
+struct MipmapOptions
+{
+    MipmapFilter     filter  = MIPMAP_FILTER_BOX;
+    MipmapContent    content = MIPMAP_CONTENT_DATA;
+    BitmapSampleMode modeU   = BITMAP_SAMPLE_MODE_CLAMP; // Only used by filters wider than 2x2
+    BitmapSampleMode modeV   = BITMAP_SAMPLE_MODE_CLAMP;
+
+    // clang-format off
+    MipmapOptions& Filter (MipmapFilter     value) { filter  = value; return *this; }
+    MipmapOptions& Content(MipmapContent    value) { content = value; return *this; }
+    MipmapOptions& ModeU  (BitmapSampleMode value) { modeU   = value; return *this; }
+    MipmapOptions& ModeV  (BitmapSampleMode value) { modeV   = value; return *this; }
+    // clang-format on
+};
+
 struct MipmapAreaInfo
 {
     uint32_t baseWidth;
@@ -887,6 +1562,24 @@ public:
         BuildMipmap(mip0, modeU, modeV, filterMode);
     }
 
+    MipmapT(const MipBitmapT& mip0, const MipmapOptions& options)
+    {
+        BuildMipmap(mip0, options);
+    }
+
+    // Builds the mips in a working space that depends on options.content,
+    // see MipmapContent. Each level is filtered from the previous level's
+    // unquantized values, not from its stored pixels.
+    //
+    // MIPMAP_FILTER_BOX builds tiles of mip0 on separate threads and
+    // reduces each tile through all the levels it covers in one pass, only
+    // the last few levels are built from the combined tile results.
+    // MIPMAP_FILTER_KAISER goes level by level with rows in parallel.
+    //
+    // Odd dimensions drop the last row or column, like the level sizes do.
+    //
+    void BuildMipmap(const MipBitmapT& mip0, const MipmapOptions& options);
+
     void BuildMipmap(
         const MipBitmapT& mip0,
         BitmapSampleMode  modeU      = BITMAP_SAMPLE_MODE_CLAMP,
@@ -898,40 +1591,13 @@ public:
             return;
         }
 
-        // Calculate storage size for all mip maps
-        MipmapAreaInfo areaInfo = CalculateMipmapInfo(mip0.GetWidth(), mip0.GetHeight());
-
-        // Allocate storage
-        mStorage = MipBitmapT(areaInfo.baseWidth, areaInfo.fullHeight);
-
-        // Create entries for mips
-        {
-            uint32_t width     = areaInfo.baseWidth;
-            uint32_t height    = areaInfo.baseHeight;
-            uint32_t rowStride = mStorage.GetRowStride();
-            char*    pStorage  = reinterpret_cast<char*>(mStorage.GetPixels());
-            uint32_t offset    = 0;
-            for (uint32_t level = 0; level < areaInfo.numLevels; ++level)
-            {
-                // Create current mip
-                MipBitmapT mip = MipBitmapT(width, height, rowStride, pStorage + offset);
-                mMips.push_back(mip);
-                mOffsets.push_back(offset);
-
-                // Advance storage pointer to next mip
-                offset += (height * rowStride);
-
-                // Next mip dimensions
-                width >>= 1;
-                height >>= 1;
-            }
-        }
+        AllocateMips(mip0.GetWidth(), mip0.GetHeight());
 
         // Copy mip0
         mip0.CopyTo(0, 0, mip0.GetWidth(), mip0.GetHeight(), mMips[0]);
 
         // Build mips
-        for (uint32_t level = 1; level < areaInfo.numLevels; ++level)
+        for (uint32_t level = 1; level < GetNumLevels(); ++level)
         {
             uint32_t prevLevel = level - 1;
             mMips[prevLevel].ScaleTo(
@@ -984,7 +1650,7 @@ public:
         {
             assert(false && "level exceeds available mips");
         }
-        return mMips[level].GetWidth();
+        return mMips[level].GetHeight();
     }
 
     uint32_t GetRowStride() const
@@ -1017,6 +1683,39 @@ public:
         return MipBitmapT::Save(absPath, &pMipmap->mStorage);
     }
 
+private:
+    void AllocateMips(uint32_t baseWidth, uint32_t baseHeight)
+    {
+        // Calculate storage size for all mip maps
+        MipmapAreaInfo areaInfo = CalculateMipmapInfo(baseWidth, baseHeight);
+
+        // Allocate storage
+        mStorage = MipBitmapT(areaInfo.baseWidth, areaInfo.fullHeight);
+        mMips.clear();
+        mOffsets.clear();
+
+        // Create entries for mips
+        uint32_t width     = areaInfo.baseWidth;
+        uint32_t height    = areaInfo.baseHeight;
+        uint32_t rowStride = mStorage.GetRowStride();
+        char*    pStorage  = reinterpret_cast<char*>(mStorage.GetPixels());
+        uint32_t offset    = 0;
+        for (uint32_t level = 0; level < areaInfo.numLevels; ++level)
+        {
+            // Create current mip
+            MipBitmapT mip = MipBitmapT(width, height, rowStride, pStorage + offset);
+            mMips.push_back(mip);
+            mOffsets.push_back(offset);
+
+            // Advance storage pointer to next mip
+            offset += (height * rowStride);
+
+            // Next mip dimensions
+            width >>= 1;
+            height >>= 1;
+        }
+    }
+
 private:
     MipBitmapT              mStorage;
     std::vector<MipBitmapT> mMips;
@@ -1024,4 +1723,6 @@ private:
 };
 
 using MipmapRGBA8u  = MipmapT<BitmapRGBA8u>;
+using MipmapRGBA16f = MipmapT<BitmapRGBA16f>;
 using MipmapRGBA32f = MipmapT<BitmapRGBA32f>;
+using MipmapRGB9E5  = MipmapT<BitmapRGB9E5>;
@@ -1,15 +1,18 @@
 #pragma once
 
 #include <algorithm>
+#include <atomic>
 #include <cassert>
 #include <cstdint>
 #include <filesystem>
 #include <fstream>
+#include <functional>
 #include <iostream>
 #include <memory>
 #include <map>
 #include <sstream>
 #include <string>
+#include <thread>
 #include <vector>
 
 #if defined(WIN32)
@@ -70,6 +73,8 @@ enum GREXFormat
     GREX_FORMAT_BC6H_SFLOAT        = 17,
     GREX_FORMAT_BC6H_UFLOAT        = 18,
     GREX_FORMAT_BC7_RGBA           = 19,
+    GREX_FORMAT_R16G16B16A16_FLOAT = 20,
+    GREX_FORMAT_R9G9B9E5_UFLOAT    = 21, // Shared exponent, see PixelRGB9E5
 };
 
 struct MipOffset
@@ -133,3 +138,57 @@ bool Contains(const T& elem, const std::vector<T>& container)
     bool found = (it != container.end());
     return found;
 }
+
+//
+// Splits [0, count) into fixed size chunks of \b chunkSize elements and
+// calls fn(begin, end) for each chunk on a pool of std::threads. Chunk
+// boundaries only depend on \b count and \b chunkSize so callers can
+// use (begin / chunkSize) as a stable chunk index.
+//
+// Runs on the calling thread if there's only a single chunk, or if the
+// calling thread has set gParallelForSerial because it's already one of
+// several workers (see TextureLoader).
+//
+inline thread_local bool gParallelForSerial = false;
+
+inline void ParallelFor(uint32_t count, uint32_t chunkSize, const std::function<void(uint32_t, uint32_t)>& fn)
+{
+    if (count == 0)
+    {
+        return;
+    }
+
+    chunkSize                 = std::max<uint32_t>(chunkSize, 1);
+    const uint32_t numChunks  = (count + chunkSize - 1) / chunkSize;
+    const uint32_t numThreads = std::min<uint32_t>(std::max<uint32_t>(std::thread::hardware_concurrency(), 1), numChunks);
+    if ((numThreads <= 1) || gParallelForSerial)
+    {
+        for (uint32_t begin = 0; begin < count; begin += chunkSize)
+        {
+            fn(begin, std::min<uint32_t>(begin + chunkSize, count));
+        }
+        return;
+    }
+
+    std::atomic_uint32_t nextChunk = 0;
+    auto                 worker    = [&]() {
+        uint32_t chunk = nextChunk++;
+        while (chunk < numChunks)
+        {
+            uint32_t begin = chunk * chunkSize;
+            fn(begin, std::min<uint32_t>(begin + chunkSize, count));
+            chunk = nextChunk++;
+        }
+    };
+
+    std::vector<std::thread> threads;
+    for (uint32_t i = 1; i < numThreads; ++i)
+    {
+        threads.emplace_back(worker);
+    }
+    worker();
+    for (auto& thread : threads)
+    {
+        thread.join();
+    }
+}
@@ -508,7 +508,9 @@ DXGI_FORMAT ToDxFormat(GREXFormat format)
         case GREX_FORMAT_R32_FLOAT          : return DXGI_FORMAT_R32_FLOAT;
         case GREX_FORMAT_R32G32_FLOAT       : return DXGI_FORMAT_R32G32_FLOAT;
         case GREX_FORMAT_R32G32B32A32_FLOAT : return DXGI_FORMAT_R32G32B32A32_FLOAT;
-        case GREX_FORMAT_BC1_RGB            : return DXGI_FORMAT_UNKNOWN; // Does D3D12 support BC1 RGB?
+        case GREX_FORMAT_R16G16B16A16_FLOAT : return DXGI_FORMAT_R16G16B16A16_FLOAT;
+        case GREX_FORMAT_R9G9B9E5_UFLOAT    : return DXGI_FORMAT_R9G9B9E5_SHAREDEXP;
+        case GREX_FORMAT_BC1_RGB            : return DXGI_FORMAT_BC1_UNORM; // BC1 RGB is BC1 with opaque blocks
         case GREX_FORMAT_BC3_RGBA           : return DXGI_FORMAT_BC3_UNORM; 
         case GREX_FORMAT_BC4_R              : return DXGI_FORMAT_BC4_UNORM;
         case GREX_FORMAT_BC5_RG             : return DXGI_FORMAT_BC5_UNORM;
@@ -948,8 +950,26 @@ HRESULT CreateTexture(
 
     if (!IsNull(pSrcData))
     {
+        //
+        // Compressed data is copied to the staging buffer as is. So is
+        // uncompressed data that already has aligned rows and levels, like
+        // texture files (see texture_file.h).
+        //
+        bool isLaidOut = IsCompressed(format);
+        if (!isLaidOut)
+        {
+            isLaidOut = true;
+            for (const auto& mipOffset : mipOffsets)
+            {
+                isLaidOut = isLaidOut &&
+                            (mipOffset.RowStride > 0) &&
+                            ((mipOffset.RowStride % D3D12_TEXTURE_DATA_PITCH_ALIGNMENT) == 0) &&
+                            ((mipOffset.Offset % D3D12_TEXTURE_DATA_PLACEMENT_ALIGNMENT) == 0);
+            }
+        }
+
         ComPtr<ID3D12Resource> stagingBuffer;
-        if (IsCompressed(format))
+        if (isLaidOut)
         {
             hr = CreateBuffer(pRenderer, srcSizeBytes, pSrcData, &stagingBuffer);
             if (FAILED(hr))
@@ -1018,12 +1038,22 @@ HRESULT CreateTexture(
             {
                 const auto& mipOffset    = mipOffsets[level];
                 uint32_t    mipRowStride = Align<uint32_t>(mipOffset.RowStride, D3D12_TEXTURE_DATA_PITCH_ALIGNMENT);
+                uint32_t    mipWidth     = levelWidth;
+                uint32_t    mipHeight    = levelHeight;
                 if (IsCompressed(format))
                 {
                     //
-                    // This is hack based on values returned by GetCopyableFootprints().
+                    // Compressed footprints are in whole 4x4 blocks. RowStride is
+                    // the size of a row of blocks, the source data must already
+                    // be laid out with D3D12_TEXTURE_DATA_PITCH_ALIGNMENT rows
+                    // (see BCEncodeOptions).
                     //
-                    mipRowStride = levelWidth * 4;
+                    // Without a RowStride fall back to the values returned by
+                    // GetCopyableFootprints().
+                    //
+                    mipRowStride = (mipOffset.RowStride > 0) ? mipOffset.RowStride : (levelWidth * 4);
+                    mipWidth     = Align<uint32_t>(std::max<uint32_t>(levelWidth, 1), 4);
+                    mipHeight    = Align<uint32_t>(std::max<uint32_t>(levelHeight, 1), 4);
                 }
 
                 D3D12_TEXTURE_COPY_LOCATION dst = {};
@@ -1036,8 +1066,8 @@ HRESULT CreateTexture(
                 src.Type                               = D3D12_TEXTURE_COPY_TYPE_PLACED_FOOTPRINT;
                 src.PlacedFootprint.Offset             = mipOffset.Offset;
                 src.PlacedFootprint.Footprint.Format   = format;
-                src.PlacedFootprint.Footprint.Width    = static_cast<UINT>(levelWidth);
-                src.PlacedFootprint.Footprint.Height   = static_cast<UINT>(levelHeight);
+                src.PlacedFootprint.Footprint.Width    = static_cast<UINT>(mipWidth);
+                src.PlacedFootprint.Footprint.Height   = static_cast<UINT>(mipHeight);
                 src.PlacedFootprint.Footprint.Depth    = 1;
                 src.PlacedFootprint.Footprint.RowPitch = static_cast<UINT>(mipRowStride);
 
@@ -1101,6 +1131,157 @@ HRESULT CreateTexture(
         ppResource);
 }
 
+HRESULT CreateTexture(
+    DxRenderer*                   pRenderer,
+    uint32_t                      width,
+    uint32_t                      height,
+    DXGI_FORMAT                   format,
+    uint32_t                      numArrayLayers,
+    const std::vector<MipOffset>& layerOffsets,
+    uint64_t                      srcSizeBytes,
+    const void*                   pSrcData,
+    ID3D12Resource**              ppResource)
+{
+    if ((numArrayLayers == 0) || layerOffsets.empty() || ((layerOffsets.size() % numArrayLayers) != 0))
+    {
+        return E_INVALIDARG;
+    }
+
+    uint32_t numMipLevels = static_cast<uint32_t>(layerOffsets.size()) / numArrayLayers;
+
+    HRESULT hr = CreateTexture(
+        pRenderer,
+        width,
+        height,
+        format,
+        numMipLevels,
+        numArrayLayers,
+        ppResource);
+    if (FAILED(hr))
+    {
+        return hr;
+    }
+
+    if (IsNull(pSrcData))
+    {
+        return S_OK;
+    }
+
+    //
+    // layerOffsets is in D3D12 subresource order: level + layer * numMipLevels.
+    // Rows are copied one at a time into the placed footprints so the
+    // source can use any row stride and offsets.
+    //
+    const UINT numSubresources = numMipLevels * numArrayLayers;
+
+    std::vector<D3D12_PLACED_SUBRESOURCE_FOOTPRINT> footprints(numSubresources);
+    std::vector<UINT>                               numRows(numSubresources);
+    std::vector<UINT64>                             rowSizes(numSubresources);
+    UINT64                                          totalBytes = 0;
+
+    D3D12_RESOURCE_DESC desc = (*ppResource)->GetDesc();
+    pRenderer->Device->GetCopyableFootprints(&desc, 0, numSubresources, 0, footprints.data(), numRows.data(), rowSizes.data(), &totalBytes);
+
+    ComPtr<ID3D12Resource> stagingBuffer;
+    hr = CreateBuffer(pRenderer, static_cast<size_t>(totalBytes), nullptr, &stagingBuffer);
+    if (FAILED(hr))
+    {
+        assert(false && "create staging buffer failed");
+        return hr;
+    }
+
+    char* pStagingData = nullptr;
+    hr                 = stagingBuffer->Map(0, nullptr, reinterpret_cast<void**>(&pStagingData));
+    if (FAILED(hr))
+    {
+        assert(false && "map staging buffer failed");
+        return hr;
+    }
+
+    for (UINT subresource = 0; subresource < numSubresources; ++subresource)
+    {
+        const auto& layerOffset = layerOffsets[subresource];
+        const auto& footprint   = footprints[subresource];
+        const char* pSrcRow     = static_cast<const char*>(pSrcData) + layerOffset.Offset;
+        char*       pDstRow     = pStagingData + footprint.Offset;
+        for (UINT row = 0; row < numRows[subresource]; ++row)
+        {
+            assert(((pSrcRow - static_cast<const char*>(pSrcData)) + rowSizes[subresource]) <= srcSizeBytes);
+            memcpy(pDstRow, pSrcRow, static_cast<size_t>(rowSizes[subresource]));
+            pSrcRow += layerOffset.RowStride;
+            pDstRow += footprint.Footprint.RowPitch;
+        }
+    }
+
+    stagingBuffer->Unmap(0, nullptr);
+
+    ComPtr<ID3D12CommandAllocator> cmdAllocator;
+    hr = pRenderer->Device->CreateCommandAllocator(D3D12_COMMAND_LIST_TYPE_DIRECT, IID_PPV_ARGS(&cmdAllocator));
+    if (FAILED(hr))
+    {
+        assert(false && "create staging command allocator failed");
+        return hr;
+    }
+
+    ComPtr<ID3D12GraphicsCommandList> cmdList;
+    hr = pRenderer->Device->CreateCommandList1(0, D3D12_COMMAND_LIST_TYPE_DIRECT, D3D12_COMMAND_LIST_FLAG_NONE, IID_PPV_ARGS(&cmdList));
+    if (FAILED(hr))
+    {
+        assert(false && "create staging command list failed");
+        return hr;
+    }
+
+    hr = cmdList->Reset(cmdAllocator.Get(), nullptr);
+    if (FAILED(hr))
+    {
+        assert(false && "reset command list failed");
+        return hr;
+    }
+
+    for (UINT subresource = 0; subresource < numSubresources; ++subresource)
+    {
+        D3D12_TEXTURE_COPY_LOCATION dst = {};
+        dst.pResource                   = *ppResource;
+        dst.Type                        = D3D12_TEXTURE_COPY_TYPE_SUBRESOURCE_INDEX;
+        dst.SubresourceIndex            = subresource;
+
+        D3D12_TEXTURE_COPY_LOCATION src = {};
+        src.pResource                   = stagingBuffer.Get();
+        src.Type                        = D3D12_TEXTURE_COPY_TYPE_PLACED_FOOTPRINT;
+        src.PlacedFootprint             = footprints[subresource];
+
+        cmdList->CopyTextureRegion(&dst, 0, 0, 0, &src, nullptr);
+    }
+
+    D3D12_RESOURCE_BARRIER barrier = {};
+    barrier.Type                   = D3D12_RESOURCE_BARRIER_TYPE_TRANSITION;
+    barrier.Flags                  = D3D12_RESOURCE_BARRIER_FLAG_NONE;
+    barrier.Transition.pResource   = *ppResource;
+    barrier.Transition.Subresource = D3D12_RESOURCE_BARRIER_ALL_SUBRESOURCES;
+    barrier.Transition.StateBefore = D3D12_RESOURCE_STATE_COPY_DEST;
+    barrier.Transition.StateAfter  = D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE | D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE;
+
+    cmdList->ResourceBarrier(1, &barrier);
+
+    hr = cmdList->Close();
+    if (FAILED(hr))
+    {
+        assert(false && "close command list failed");
+        return hr;
+    }
+
+    ID3D12CommandList* pList = cmdList.Get();
+    pRenderer->Queue->ExecuteCommandLists(1, &pList);
+
+    if (!WaitForGpu(pRenderer))
+    {
+        assert(false && "WaitForGpu failed");
+        return E_FAIL;
+    }
+
+    return S_OK;
+}
+
 void CreateDescriptoBufferSRV(
     DxRenderer*                 pRenderer,
     uint32_t                    firstElement,
@@ -1141,6 +1322,37 @@ void CreateDescriptorTexture2D(
     pRenderer->Device->CreateShaderResourceView(pResource, &desc, descriptor);
 }
 
+void CreateDescriptorTextureCube(
+    DxRenderer*                 pRenderer,
+    ID3D12Resource*             pResource,
+    D3D12_CPU_DESCRIPTOR_HANDLE descriptor,
+    UINT                        NumCubes,
+    UINT                        MostDetailedMip,
+    UINT                        MipLevels)
+{
+    D3D12_SHADER_RESOURCE_VIEW_DESC desc = {};
+    desc.Format                          = pResource->GetDesc().Format;
+    desc.Shader4ComponentMapping         = D3D12_DEFAULT_SHADER_4_COMPONENT_MAPPING;
+    if (NumCubes <= 1)
+    {
+        desc.ViewDimension                   = D3D12_SRV_DIMENSION_TEXTURECUBE;
+        desc.TextureCube.MostDetailedMip     = MostDetailedMip;
+        desc.TextureCube.MipLevels           = MipLevels;
+        desc.TextureCube.ResourceMinLODClamp = 0;
+    }
+    else
+    {
+        desc.ViewDimension                        = D3D12_SRV_DIMENSION_TEXTURECUBEARRAY;
+        desc.TextureCubeArray.MostDetailedMip     = MostDetailedMip;
+        desc.TextureCubeArray.MipLevels           = MipLevels;
+        desc.TextureCubeArray.First2DArrayFace    = 0;
+        desc.TextureCubeArray.NumCubes            = NumCubes;
+        desc.TextureCubeArray.ResourceMinLODClamp = 0;
+    }
+
+    pRenderer->Device->CreateShaderResourceView(pResource, &desc, descriptor);
+}
+
 D3D12_RESOURCE_BARRIER CreateTransition(
     ID3D12Resource*              pResource,
     D3D12_RESOURCE_STATES        StateBefore,
@@ -93,6 +93,21 @@ HRESULT CreateTexture(
     const void*      pSrcData,
     ID3D12Resource** ppResource);
 
+// Texture arrays, including cube maps and cube arrays: numArrayLayers is 6
+// per cube with faces in +X, -X, +Y, -Y, +Z, -Z order. layerOffsets has one
+// MipOffset per layer per level, layer major like texture files and D3D12
+// subresources: [layer * numMipLevels + level].
+HRESULT CreateTexture(
+    DxRenderer*                   pRenderer,
+    uint32_t                      width,
+    uint32_t                      height,
+    DXGI_FORMAT                   format,
+    uint32_t                      numArrayLayers,
+    const std::vector<MipOffset>& layerOffsets,
+    uint64_t                      srcSizeBytes,
+    const void*                   pSrcData,
+    ID3D12Resource**              ppResource);
+
 void CreateDescriptoBufferSRV(
     DxRenderer*                 pRenderer,
     uint32_t                    firstElement,
@@ -109,6 +124,15 @@ void CreateDescriptorTexture2D(
     UINT                        MipLevels       = 1,
     UINT                        PlaneSlice      = 0);
 
+// TEXTURECUBE for a single cube, TEXTURECUBEARRAY otherwise
+void CreateDescriptorTextureCube(
+    DxRenderer*                 pRenderer,
+    ID3D12Resource*             pResource,
+    D3D12_CPU_DESCRIPTOR_HANDLE descriptor,
+    UINT                        NumCubes        = 1,
+    UINT                        MostDetailedMip = 0,
+    UINT                        MipLevels       = UINT_MAX);
+
 D3D12_RESOURCE_BARRIER CreateTransition(
     ID3D12Resource*              pResource,
     D3D12_RESOURCE_STATES        StateBefore,
@@ -1,4 +1,5 @@
 #include "faux_render.h"
+#include "texture_file.h"
 #include "cgltf.h"
 
 #include <cstring>
@@ -910,6 +911,49 @@ static bool LoadGLTFImageBitmap(
     return true;
 }
 
+// Uses a texture file baked by texture_convert next to the image's URI,
+// returns false if there isn't one so the image gets decoded instead.
+static bool LoadGLTFImageBaked(
+    LoaderInternals*    pInternals,
+    const cgltf_image*  pGltfImage,
+    FauxRender::Image** ppTargetImage)
+{
+    if (IsNull(pInternals) || IsNull(pGltfImage) || IsNull(pGltfImage->uri) || IsNull(ppTargetImage))
+    {
+        return false;
+    }
+
+    const auto parentPath = pInternals->gltfPath.parent_path();
+    const auto bakedPath  = (parentPath / pGltfImage->uri).replace_extension(".gxt");
+    if (!std::filesystem::exists(bakedPath))
+    {
+        return false;
+    }
+
+    MappedTexture baked = {};
+    if (!LoadTexture(bakedPath, &baked))
+    {
+        return false;
+    }
+
+    // Data goes straight from the mapping to the staging copy
+    bool res = pInternals->pTargetGraph->CreateImage(
+        baked.width,
+        baked.height,
+        baked.format,
+        baked.mipOffsets,
+        baked.GetSizeInBytes(),
+        baked.GetData(),
+        ppTargetImage);
+    if (!res)
+    {
+        assert(false && "create image from texture file failed");
+        return false;
+    }
+
+    return true;
+}
+
 static bool LoadGLTFImage(
     LoaderInternals*    pInternals,
     const cgltf_data*   pGltfData,
@@ -948,10 +992,11 @@ static bool LoadGLTFImage(
         // We no longer support the KTX file format
         return false;
     }
-    // PNG, JPG, etc image data
+    // PNG, JPG, etc image data, or the texture file baked from it
     else
     {
-        bool res = LoadGLTFImageBitmap(pInternals, pGltfData, pGltfImage, &pTargetImage);
+        bool res = LoadGLTFImageBaked(pInternals, pGltfImage, &pTargetImage) ||
+                   LoadGLTFImageBitmap(pInternals, pGltfData, pGltfImage, &pTargetImage);
         if (!res)
         {
             return false;
@@ -0,0 +1,972 @@
+#include "ggx_simd.h"
+
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+
+#if defined(__x86_64__) || defined(_M_X64)
+#    define GREX_GGX_X64
+#    include <immintrin.h>
+#    if defined(_MSC_VER)
+#        include <intrin.h>
+#    endif
+#endif
+
+// AVX2 code paths are compiled for AVX2 regardless of the compiler flags
+// and only called if the CPU supports it. No FMA, see ggx_simd.h.
+#if defined(GREX_GGX_X64) && (defined(__GNUC__) || defined(__clang__))
+#    define GREX_TARGET_AVX2 __attribute__((target("avx2")))
+#else
+#    define GREX_TARGET_AVX2
+#endif
+
+// Samples per block, one AVX2 vector
+const uint32_t kBlockSize = 8;
+
+const float kPi     = 3.1415926535897932384626433832795f;
+const float kHalfPi = 1.5707963267948966192313216916398f;
+const float kTwoPi  = 6.283185307179586476925286766559f;
+
+// sin(x) and cos(x) for x in [-pi/4, pi/4], Taylor series up to x^9 and x^8
+const float kSin3 = -1.66666667e-1f;
+const float kSin5 = 8.33333333e-3f;
+const float kSin7 = -1.98412698e-4f;
+const float kSin9 = 2.75573192e-6f;
+const float kCos2 = -0.5f;
+const float kCos4 = 4.16666667e-2f;
+const float kCos6 = -1.38888889e-3f;
+const float kCos8 = 2.48015873e-5f;
+
+// acos(x) = sqrt(1 - x) * P(x) for x in [0, 1], Abramowitz and Stegun 4.4.46
+const float kAcos[8] = {1.5707963050f, -0.2145988016f, 0.0889789874f, -0.0501743046f, 0.0308918810f, -0.0170881256f, 0.0066700901f, -0.0012624911f};
+
+// atan(t) = t * P(t^2) for t in [0, 1], Abramowitz and Stegun 4.4.49
+const float kAtan[9] = {1.0f, -0.3333314528f, 0.1999355085f, -0.1420889944f, 0.1065626393f, -0.0752896400f, 0.0429096138f, -0.0161657367f, 0.0028662257f};
+
+// CartesianToSpherical treats directions this close to the Y axis as poles
+const float kPoleEpsilon = 0.00001f;
+
+// Same as _mm_min_ps and _mm_max_ps, including which operand a NaN picks
+static float Min(float a, float b)
+{
+    return (a < b) ? a : b;
+}
+
+static float Max(float a, float b)
+{
+    return (a > b) ? a : b;
+}
+
+static float Saturate(float x)
+{
+    return Max(Min(x, 1.0f), 0.0f);
+}
+
+GGXSimdISA GetGGXSimdISA()
+{
+#if defined(GREX_GGX_X64)
+    static const GGXSimdISA sISA = []() -> GGXSimdISA {
+#    if defined(_MSC_VER)
+        int info[4] = {};
+        __cpuid(info, 1);
+        const bool osxsave = (info[2] & (1 << 27)) != 0;
+        const bool avx     = (info[2] & (1 << 28)) != 0;
+        if (osxsave && avx && ((_xgetbv(0) & 0x6) == 0x6))
+        {
+            __cpuidex(info, 7, 0);
+            if ((info[1] & (1 << 5)) != 0)
+            {
+                return GGX_SIMD_ISA_AVX2;
+            }
+        }
+#    else
+        if (__builtin_cpu_supports("avx2"))
+        {
+            return GGX_SIMD_ISA_AVX2;
+        }
+#    endif
+        return GGX_SIMD_ISA_SSE2;
+    }();
+    return sISA;
+#else
+    return GGX_SIMD_ISA_SCALAR;
+#endif
+}
+
+const char* GetGGXSimdISAName(GGXSimdISA isa)
+{
+    switch (isa)
+    {
+        default: break;
+        case GGX_SIMD_ISA_SSE2: return "sse2";
+        case GGX_SIMD_ISA_AVX2: return "avx2";
+    }
+    return "scalar";
+}
+
+// The vector code can't run on CPUs that don't support it
+static GGXSimdISA ClampISA(GGXSimdISA isa)
+{
+    return std::min(isa, GetGGXSimdISA());
+}
+
+// =================================================================================================
+// Scalar
+// =================================================================================================
+void GGXSinCos2Pi(float t, float* pSin, float* pCos)
+{
+    // Quadrant and offset from it in [-pi/4, pi/4]
+    float   q  = std::nearbyint(t * 4.0f);
+    int32_t iq = static_cast<int32_t>(q);
+    float   x  = (t - q * 0.25f) * kTwoPi;
+    float   x2 = x * x;
+    float   s  = x + x * x2 * (kSin3 + x2 * (kSin5 + x2 * (kSin7 + x2 * kSin9)));
+    float   c  = 1.0f + x2 * (kCos2 + x2 * (kCos4 + x2 * (kCos6 + x2 * kCos8)));
+
+    float sinValue = (iq & 1) ? c : s;
+    float cosValue = (iq & 1) ? s : c;
+    *pSin          = (iq & 2) ? -sinValue : sinValue;
+    *pCos          = ((iq + 1) & 2) ? -cosValue : cosValue;
+}
+
+float GGXAcos(float x)
+{
+    float ax = Min(std::fabs(x), 1.0f);
+    float p  = kAcos[7];
+    for (int i = 6; i >= 0; --i)
+    {
+        p = kAcos[i] + ax * p;
+    }
+    float r = std::sqrt(1.0f - ax) * p;
+    return (x < 0) ? (kPi - r) : r;
+}
+
+float GGXAtan2(float y, float x)
+{
+    float ax = std::fabs(x);
+    float ay = std::fabs(y);
+    float t  = Min(ax, ay) / Max(Max(ax, ay), FLT_MIN);
+    float t2 = t * t;
+    float p  = kAtan[8];
+    for (int i = 7; i >= 0; --i)
+    {
+        p = kAtan[i] + t2 * p;
+    }
+    float a = t * p;
+    a       = (ay > ax) ? (kHalfPi - a) : a;
+    a       = (x < 0) ? (kPi - a) : a;
+    a       = (y < 0) ? (kTwoPi - a) : a;
+    return a;
+}
+
+GGXFrame GGXMakeFrame(const float N[3], float upThreshold)
+{
+    float up[3] = {0, 1, 0};
+    if (std::fabs(N[1]) >= upThreshold)
+    {
+        up[0] = 1;
+        up[1] = 0;
+    }
+
+    // tangentX = normalize(cross(up, N)), tangentY = cross(N, tangentX)
+    GGXFrame frame    = {};
+    float    tx[3]    = {up[1] * N[2] - up[2] * N[1], up[2] * N[0] - up[0] * N[2], up[0] * N[1] - up[1] * N[0]};
+    float    invLen   = 1.0f / std::sqrt(tx[0] * tx[0] + tx[1] * tx[1] + tx[2] * tx[2]);
+    frame.tangentX[0] = tx[0] * invLen;
+    frame.tangentX[1] = tx[1] * invLen;
+    frame.tangentX[2] = tx[2] * invLen;
+    frame.tangentY[0] = N[1] * frame.tangentX[2] - N[2] * frame.tangentX[1];
+    frame.tangentY[1] = N[2] * frame.tangentX[0] - N[0] * frame.tangentX[2];
+    frame.tangentY[2] = N[0] * frame.tangentX[1] - N[1] * frame.tangentX[0];
+    frame.N[0]        = N[0];
+    frame.N[1]        = N[1];
+    frame.N[2]        = N[2];
+    return frame;
+}
+
+void GGXSamples::Resize(uint32_t count)
+{
+    size_t n = ((count + kBlockSize - 1) / kBlockSize) * kBlockSize;
+    for (auto pArray : {&Hx, &Hy, &Hz, &Lx, &Ly, &Lz, &NoL, &NoH, &VoH})
+    {
+        pArray->resize(n);
+    }
+}
+
+// Everything the sample kernels need, V is only used if reflect is set
+struct SampleParams
+{
+    float    a2;
+    GGXFrame frame;
+    float    V[3];
+    bool     reflect;
+};
+
+//
+// Taken from https://github.com/SaschaWillems/Vulkan-glTF-PBR/blob/master/data/shaders/genbrdflut.frag
+// Based on http://holger.dammertz.org/stuff/notes_HammersleyOnHemisphere.html
+//
+static void HammersleyScalar(uint32_t first, uint32_t numSamples, float* pXi0, float* pXi1)
+{
+    for (uint32_t lane = 0; lane < kBlockSize; ++lane)
+    {
+        uint32_t i    = first + lane;
+        uint32_t bits = (i << 16u) | (i >> 16u);
+        bits          = ((bits & 0x55555555u) << 1u) | ((bits & 0xAAAAAAAAu) >> 1u);
+        bits          = ((bits & 0x33333333u) << 2u) | ((bits & 0xCCCCCCCCu) >> 2u);
+        bits          = ((bits & 0x0F0F0F0Fu) << 4u) | ((bits & 0xF0F0F0F0u) >> 4u);
+        bits          = ((bits & 0x00FF00FFu) << 8u) | ((bits & 0xFF00FF00u) >> 8u);
+        pXi0[lane]    = static_cast<float>(i) / static_cast<float>(numSamples);
+        pXi1[lane]    = static_cast<float>(bits) * 2.3283064365386963e-10f;
+    }
+}
+
+static void SampleScalar(const float* pXi0, const float* pXi1, const SampleParams& params, GGXSamples* pSamples, uint32_t offset)
+{
+    const GGXFrame& f = params.frame;
+    for (uint32_t lane = 0; lane < kBlockSize; ++lane)
+    {
+        uint32_t i = offset + lane;
+
+        float sinPhi = 0;
+        float cosPhi = 0;
+        GGXSinCos2Pi(pXi0[lane], &sinPhi, &cosPhi);
+        float cosTheta = std::sqrt((1.0f - pXi1[lane]) / (1.0f + (params.a2 - 1.0f) * pXi1[lane]));
+        float sinTheta = std::sqrt(Max(1.0f - cosTheta * cosTheta, 0.0f));
+        float hx       = sinTheta * cosPhi;
+        float hy       = sinTheta * sinPhi;
+        float hz       = cosTheta;
+
+        float Hx        = f.tangentX[0] * hx + f.tangentY[0] * hy + f.N[0] * hz;
+        float Hy        = f.tangentX[1] * hx + f.tangentY[1] * hy + f.N[1] * hz;
+        float Hz        = f.tangentX[2] * hx + f.tangentY[2] * hy + f.N[2] * hz;
+        pSamples->Hx[i] = Hx;
+        pSamples->Hy[i] = Hy;
+        pSamples->Hz[i] = Hz;
+        if (!params.reflect)
+        {
+            continue;
+        }
+
+        float VoH        = params.V[0] * Hx + params.V[1] * Hy + params.V[2] * Hz;
+        float Lx         = 2.0f * VoH * Hx - params.V[0];
+        float Ly         = 2.0f * VoH * Hy - params.V[1];
+        float Lz         = 2.0f * VoH * Hz - params.V[2];
+        pSamples->Lx[i]  = Lx;
+        pSamples->Ly[i]  = Ly;
+        pSamples->Lz[i]  = Lz;
+        pSamples->NoL[i] = Saturate(f.N[0] * Lx + f.N[1] * Ly + f.N[2] * Lz);
+        pSamples->NoH[i] = Saturate(f.N[0] * Hx + f.N[1] * Hy + f.N[2] * Hz);
+        pSamples->VoH[i] = Saturate(VoH);
+    }
+}
+
+static void EquirectUVScalar(const float* pX, const float* pY, const float* pZ, float* pUVs)
+{
+    for (uint32_t lane = 0; lane < kBlockSize; ++lane)
+    {
+        float len = std::sqrt(pX[lane] * pX[lane] + pY[lane] * pY[lane] + pZ[lane] * pZ[lane]);
+        float x   = pX[lane] / len;
+        float y   = pY[lane] / len;
+        float z   = pZ[lane] / len;
+
+        bool  pole  = (std::fabs(x) < kPoleEpsilon) && (std::fabs(z) <= kPoleEpsilon);
+        float theta = pole ? 0.0f : GGXAtan2(z, x);
+        float phi   = GGXAcos(y);
+
+        pUVs[2 * lane + 0] = Saturate(theta / kTwoPi);
+        pUVs[2 * lane + 1] = Saturate(phi / kPi);
+    }
+}
+
+// Taps of one bilinear sample, computed the same way by every ISA
+struct BilinearTaps
+{
+    int32_t x0[kBlockSize];
+    int32_t x1[kBlockSize];
+    int32_t y0[kBlockSize];
+    int32_t y1[kBlockSize];
+    float   w00[kBlockSize];
+    float   w10[kBlockSize];
+    float   w01[kBlockSize];
+    float   w11[kBlockSize];
+};
+
+static void BilinearTapsScalar(const float* pUVs, uint32_t width, uint32_t height, BilinearTaps* pTaps)
+{
+    for (uint32_t lane = 0; lane < kBlockSize; ++lane)
+    {
+        float   x  = Saturate(pUVs[2 * lane + 0]) * static_cast<float>(width - 1);
+        float   y  = Saturate(pUVs[2 * lane + 1]) * static_cast<float>(height - 1);
+        int32_t x0 = static_cast<int32_t>(x);
+        int32_t y0 = static_cast<int32_t>(y);
+        float   u1 = x - static_cast<float>(x0);
+        float   u0 = 1.0f - u1;
+        float   v1 = y - static_cast<float>(y0);
+        float   v0 = 1.0f - v1;
+
+        pTaps->x0[lane]  = x0;
+        pTaps->x1[lane]  = (x0 + 1 < static_cast<int32_t>(width)) ? (x0 + 1) : 0;
+        pTaps->y0[lane]  = y0;
+        pTaps->y1[lane]  = std::min(y0 + 1, static_cast<int32_t>(height) - 1);
+        pTaps->w00[lane] = u0 * v0;
+        pTaps->w10[lane] = u1 * v0;
+        pTaps->w01[lane] = u0 * v1;
+        pTaps->w11[lane] = u1 * v1;
+    }
+}
+
+// Same order of operations as Pixel4T::Bilinear
+static void BlendTapsScalar(const BilinearTaps& taps, const float* pPixels, uint32_t rowStride, float* pRGBA)
+{
+    const char* pBase = reinterpret_cast<const char*>(pPixels);
+    for (uint32_t lane = 0; lane < kBlockSize; ++lane)
+    {
+        const float* pRow0 = reinterpret_cast<const float*>(pBase + static_cast<size_t>(taps.y0[lane]) * rowStride);
+        const float* pRow1 = reinterpret_cast<const float*>(pBase + static_cast<size_t>(taps.y1[lane]) * rowStride);
+        const float* p00   = pRow0 + 4 * taps.x0[lane];
+        const float* p10   = pRow0 + 4 * taps.x1[lane];
+        const float* p01   = pRow1 + 4 * taps.x0[lane];
+        const float* p11   = pRow1 + 4 * taps.x1[lane];
+        for (uint32_t c = 0; c < 4; ++c)
+        {
+            pRGBA[4 * lane + c] = (p00[c] * taps.w00[lane]) + (p10[c] * taps.w10[lane]) + (p01[c] * taps.w01[lane]) + (p11[c] * taps.w11[lane]);
+        }
+    }
+}
+
+// =================================================================================================
+// SSE2, each block is processed as two halves of 4 samples
+// =================================================================================================
+#if defined(GREX_GGX_X64)
+static __m128 SelectSSE2(__m128 mask, __m128 a, __m128 b)
+{
+    return _mm_or_ps(_mm_and_ps(mask, a), _mm_andnot_ps(mask, b));
+}
+
+static __m128 AbsSSE2(__m128 x)
+{
+    return _mm_andnot_ps(_mm_set1_ps(-0.0f), x);
+}
+
+static __m128 SaturateSSE2(__m128 x)
+{
+    return _mm_max_ps(_mm_min_ps(x, _mm_set1_ps(1.0f)), _mm_setzero_ps());
+}
+
+// Unsigned to float, rounded once like a scalar conversion
+static __m128 ConvertU32SSE2(__m128i x)
+{
+    __m128 hi = _mm_mul_ps(_mm_cvtepi32_ps(_mm_srli_epi32(x, 16)), _mm_set1_ps(65536.0f));
+    __m128 lo = _mm_cvtepi32_ps(_mm_and_si128(x, _mm_set1_epi32(0xFFFF)));
+    return _mm_add_ps(hi, lo);
+}
+
+static void SinCos2PiSSE2(__m128 t, __m128* pSin, __m128* pCos)
+{
+    __m128i iq = _mm_cvtps_epi32(_mm_mul_ps(t, _mm_set1_ps(4.0f)));
+    __m128  q  = _mm_cvtepi32_ps(iq);
+    __m128  x  = _mm_mul_ps(_mm_sub_ps(t, _mm_mul_ps(q, _mm_set1_ps(0.25f))), _mm_set1_ps(kTwoPi));
+    __m128  x2 = _mm_mul_ps(x, x);
+
+    __m128 s = _mm_set1_ps(kSin9);
+    s        = _mm_add_ps(_mm_set1_ps(kSin7), _mm_mul_ps(x2, s));
+    s        = _mm_add_ps(_mm_set1_ps(kSin5), _mm_mul_ps(x2, s));
+    s        = _mm_add_ps(_mm_set1_ps(kSin3), _mm_mul_ps(x2, s));
+    s        = _mm_add_ps(x, _mm_mul_ps(_mm_mul_ps(x, x2), s));
+
+    __m128 c = _mm_set1_ps(kCos8);
+    c        = _mm_add_ps(_mm_set1_ps(kCos6), _mm_mul_ps(x2, c));
+    c        = _mm_add_ps(_mm_set1_ps(kCos4), _mm_mul_ps(x2, c));
+    c        = _mm_add_ps(_mm_set1_ps(kCos2), _mm_mul_ps(x2, c));
+    c        = _mm_add_ps(_mm_set1_ps(1.0f), _mm_mul_ps(x2, c));
+
+    __m128i one     = _mm_set1_epi32(1);
+    __m128i two     = _mm_set1_epi32(2);
+    __m128  swap    = _mm_castsi128_ps(_mm_cmpeq_epi32(_mm_and_si128(iq, one), one));
+    __m128  sinSign = _mm_castsi128_ps(_mm_slli_epi32(_mm_and_si128(iq, two), 30));
+    __m128  cosSign = _mm_castsi128_ps(_mm_slli_epi32(_mm_and_si128(_mm_add_epi32(iq, one), two), 30));
+    *pSin           = _mm_xor_ps(SelectSSE2(swap, c, s), sinSign);
+    *pCos           = _mm_xor_ps(SelectSSE2(swap, s, c), cosSign);
+}
+
+static __m128 AcosSSE2(__m128 x)
+{
+    __m128 ax = _mm_min_ps(AbsSSE2(x), _mm_set1_ps(1.0f));
+    __m128 p  = _mm_set1_ps(kAcos[7]);
+    for (int i = 6; i >= 0; --i)
+    {
+        p = _mm_add_ps(_mm_set1_ps(kAcos[i]), _mm_mul_ps(ax, p));
+    }
+    __m128 r = _mm_mul_ps(_mm_sqrt_ps(_mm_sub_ps(_mm_set1_ps(1.0f), ax)), p);
+    return SelectSSE2(_mm_cmplt_ps(x, _mm_setzero_ps()), _mm_sub_ps(_mm_set1_ps(kPi), r), r);
+}
+
+static __m128 Atan2SSE2(__m128 y, __m128 x)
+{
+    __m128 ax = AbsSSE2(x);
+    __m128 ay = AbsSSE2(y);
+    __m128 t  = _mm_div_ps(_mm_min_ps(ax, ay), _mm_max_ps(_mm_max_ps(ax, ay), _mm_set1_ps(FLT_MIN)));
+    __m128 t2 = _mm_mul_ps(t, t);
+    __m128 p  = _mm_set1_ps(kAtan[8]);
+    for (int i = 7; i >= 0; --i)
+    {
+        p = _mm_add_ps(_mm_set1_ps(kAtan[i]), _mm_mul_ps(t2, p));
+    }
+    __m128 a = _mm_mul_ps(t, p);
+    a        = SelectSSE2(_mm_cmpgt_ps(ay, ax), _mm_sub_ps(_mm_set1_ps(kHalfPi), a), a);
+    a        = SelectSSE2(_mm_cmplt_ps(x, _mm_setzero_ps()), _mm_sub_ps(_mm_set1_ps(kPi), a), a);
+    a        = SelectSSE2(_mm_cmplt_ps(y, _mm_setzero_ps()), _mm_sub_ps(_mm_set1_ps(kTwoPi), a), a);
+    return a;
+}
+
+static void HammersleySSE2(uint32_t first, uint32_t numSamples, float* pXi0, float* pXi1)
+{
+    for (uint32_t half = 0; half < kBlockSize; half += 4)
+    {
+        __m128i i    = _mm_add_epi32(_mm_set1_epi32(static_cast<int32_t>(first + half)), _mm_setr_epi32(0, 1, 2, 3));
+        __m128i bits = _mm_or_si128(_mm_slli_epi32(i, 16), _mm_srli_epi32(i, 16));
+        bits         = _mm_or_si128(_mm_slli_epi32(_mm_and_si128(bits, _mm_set1_epi32(0x55555555)), 1), _mm_srli_epi32(_mm_and_si128(bits, _mm_set1_epi32(0xAAAAAAAA)), 1));
+        bits         = _mm_or_si128(_mm_slli_epi32(_mm_and_si128(bits, _mm_set1_epi32(0x33333333)), 2), _mm_srli_epi32(_mm_and_si128(bits, _mm_set1_epi32(0xCCCCCCCC)), 2));
+        bits         = _mm_or_si128(_mm_slli_epi32(_mm_and_si128(bits, _mm_set1_epi32(0x0F0F0F0F)), 4), _mm_srli_epi32(_mm_and_si128(bits, _mm_set1_epi32(0xF0F0F0F0)), 4));
+        bits         = _mm_or_si128(_mm_slli_epi32(_mm_and_si128(bits, _mm_set1_epi32(0x00FF00FF)), 8), _mm_srli_epi32(_mm_and_si128(bits, _mm_set1_epi32(0xFF00FF00)), 8));
+        _mm_storeu_ps(pXi0 + half, _mm_div_ps(ConvertU32SSE2(i), _mm_set1_ps(static_cast<float>(numSamples))));
+        _mm_storeu_ps(pXi1 + half, _mm_mul_ps(ConvertU32SSE2(bits), _mm_set1_ps(2.3283064365386963e-10f)));
+    }
+}
+
+static void SampleSSE2(const float* pXi0, const float* pXi1, const SampleParams& params, GGXSamples* pSamples, uint32_t offset)
+{
+    const GGXFrame& f   = params.frame;
+    const __m128    one = _mm_set1_ps(1.0f);
+    for (uint32_t half = 0; half < kBlockSize; half += 4)
+    {
+        uint32_t i   = offset + half;
+        __m128   xi0 = _mm_loadu_ps(pXi0 + half);
+        __m128   xi1 = _mm_loadu_ps(pXi1 + half);
+
+        __m128 sinPhi;
+        __m128 cosPhi;
+        SinCos2PiSSE2(xi0, &sinPhi, &cosPhi);
+        __m128 cosTheta = _mm_sqrt_ps(_mm_div_ps(_mm_sub_ps(one, xi1), _mm_add_ps(one, _mm_mul_ps(_mm_set1_ps(params.a2 - 1.0f), xi1))));
+        __m128 sinTheta = _mm_sqrt_ps(_mm_max_ps(_mm_sub_ps(one, _mm_mul_ps(cosTheta, cosTheta)), _mm_setzero_ps()));
+        __m128 hx       = _mm_mul_ps(sinTheta, cosPhi);
+        __m128 hy       = _mm_mul_ps(sinTheta, sinPhi);
+        __m128 hz       = cosTheta;
+
+        __m128 H[3];
+        for (uint32_t c = 0; c < 3; ++c)
+        {
+            H[c] = _mm_add_ps(_mm_add_ps(_mm_mul_ps(_mm_set1_ps(f.tangentX[c]), hx), _mm_mul_ps(_mm_set1_ps(f.tangentY[c]), hy)), _mm_mul_ps(_mm_set1_ps(f.N[c]), hz));
+        }
+        _mm_storeu_ps(&pSamples->Hx[i], H[0]);
+        _mm_storeu_ps(&pSamples->Hy[i], H[1]);
+        _mm_storeu_ps(&pSamples->Hz[i], H[2]);
+        if (!params.reflect)
+        {
+            continue;
+        }
+
+        __m128 VoH = _mm_add_ps(_mm_add_ps(_mm_mul_ps(_mm_set1_ps(params.V[0]), H[0]), _mm_mul_ps(_mm_set1_ps(params.V[1]), H[1])), _mm_mul_ps(_mm_set1_ps(params.V[2]), H[2]));
+        __m128 L[3];
+        for (uint32_t c = 0; c < 3; ++c)
+        {
+            L[c] = _mm_sub_ps(_mm_mul_ps(_mm_mul_ps(_mm_set1_ps(2.0f), VoH), H[c]), _mm_set1_ps(params.V[c]));
+        }
+        __m128 NoL = _mm_add_ps(_mm_add_ps(_mm_mul_ps(_mm_set1_ps(f.N[0]), L[0]), _mm_mul_ps(_mm_set1_ps(f.N[1]), L[1])), _mm_mul_ps(_mm_set1_ps(f.N[2]), L[2]));
+        __m128 NoH = _mm_add_ps(_mm_add_ps(_mm_mul_ps(_mm_set1_ps(f.N[0]), H[0]), _mm_mul_ps(_mm_set1_ps(f.N[1]), H[1])), _mm_mul_ps(_mm_set1_ps(f.N[2]), H[2]));
+        _mm_storeu_ps(&pSamples->Lx[i], L[0]);
+        _mm_storeu_ps(&pSamples->Ly[i], L[1]);
+        _mm_storeu_ps(&pSamples->Lz[i], L[2]);
+        _mm_storeu_ps(&pSamples->NoL[i], SaturateSSE2(NoL));
+        _mm_storeu_ps(&pSamples->NoH[i], SaturateSSE2(NoH));
+        _mm_storeu_ps(&pSamples->VoH[i], SaturateSSE2(VoH));
+    }
+}
+
+static void EquirectUVSSE2(const float* pX, const float* pY, const float* pZ, float* pUVs)
+{
+    for (uint32_t half = 0; half < kBlockSize; half += 4)
+    {
+        __m128 x   = _mm_loadu_ps(pX + half);
+        __m128 y   = _mm_loadu_ps(pY + half);
+        __m128 z   = _mm_loadu_ps(pZ + half);
+        __m128 len = _mm_sqrt_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(x, x), _mm_mul_ps(y, y)), _mm_mul_ps(z, z)));
+        x          = _mm_div_ps(x, len);
+        y          = _mm_div_ps(y, len);
+        z          = _mm_div_ps(z, len);
+
+        __m128 epsilon = _mm_set1_ps(kPoleEpsilon);
+        __m128 pole    = _mm_and_ps(_mm_cmplt_ps(AbsSSE2(x), epsilon), _mm_cmple_ps(AbsSSE2(z), epsilon));
+        __m128 theta   = _mm_andnot_ps(pole, Atan2SSE2(z, x));
+        __m128 phi     = AcosSSE2(y);
+
+        __m128 u = SaturateSSE2(_mm_div_ps(theta, _mm_set1_ps(kTwoPi)));
+        __m128 v = SaturateSSE2(_mm_div_ps(phi, _mm_set1_ps(kPi)));
+        _mm_storeu_ps(pUVs + 2 * half + 0, _mm_unpacklo_ps(u, v));
+        _mm_storeu_ps(pUVs + 2 * half + 4, _mm_unpackhi_ps(u, v));
+    }
+}
+
+static void BilinearTapsSSE2(const float* pUVs, uint32_t width, uint32_t height, BilinearTaps* pTaps)
+{
+    const __m128i maxX = _mm_set1_epi32(static_cast<int32_t>(width) - 1);
+    const __m128i maxY = _mm_set1_epi32(static_cast<int32_t>(height) - 1);
+    const __m128i one  = _mm_set1_epi32(1);
+    for (uint32_t half = 0; half < kBlockSize; half += 4)
+    {
+        __m128 uv0 = _mm_loadu_ps(pUVs + 2 * half + 0);
+        __m128 uv1 = _mm_loadu_ps(pUVs + 2 * half + 4);
+        __m128 x   = _mm_mul_ps(SaturateSSE2(_mm_shuffle_ps(uv0, uv1, _MM_SHUFFLE(2, 0, 2, 0))), _mm_set1_ps(static_cast<float>(width - 1)));
+        __m128 y   = _mm_mul_ps(SaturateSSE2(_mm_shuffle_ps(uv0, uv1, _MM_SHUFFLE(3, 1, 3, 1))), _mm_set1_ps(static_cast<float>(height - 1)));
+
+        // Coordinates are never negative, truncating is flooring
+        __m128i x0 = _mm_cvttps_epi32(x);
+        __m128i y0 = _mm_cvttps_epi32(y);
+        __m128  u1 = _mm_sub_ps(x, _mm_cvtepi32_ps(x0));
+        __m128  u0 = _mm_sub_ps(_mm_set1_ps(1.0f), u1);
+        __m128  v1 = _mm_sub_ps(y, _mm_cvtepi32_ps(y0));
+        __m128  v0 = _mm_sub_ps(_mm_set1_ps(1.0f), v1);
+
+        // x0 + 1 wraps to 0 past the last column, y0 + 1 clamps to the last row
+        __m128i x1   = _mm_add_epi32(x0, one);
+        x1           = _mm_andnot_si128(_mm_cmpgt_epi32(x1, maxX), x1);
+        __m128i y1   = _mm_add_epi32(y0, one);
+        __m128i past = _mm_cmpgt_epi32(y1, maxY);
+        y1           = _mm_or_si128(_mm_and_si128(past, maxY), _mm_andnot_si128(past, y1));
+
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(pTaps->x0 + half), x0);
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(pTaps->x1 + half), x1);
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(pTaps->y0 + half), y0);
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(pTaps->y1 + half), y1);
+        _mm_storeu_ps(pTaps->w00 + half, _mm_mul_ps(u0, v0));
+        _mm_storeu_ps(pTaps->w10 + half, _mm_mul_ps(u1, v0));
+        _mm_storeu_ps(pTaps->w01 + half, _mm_mul_ps(u0, v1));
+        _mm_storeu_ps(pTaps->w11 + half, _mm_mul_ps(u1, v1));
+    }
+}
+
+// One sample per iteration, the 4 channels of a texel are one vector
+static void BlendTapsSSE2(const BilinearTaps& taps, const float* pPixels, uint32_t rowStride, float* pRGBA)
+{
+    const char* pBase = reinterpret_cast<const char*>(pPixels);
+    for (uint32_t lane = 0; lane < kBlockSize; ++lane)
+    {
+        const float* pRow0 = reinterpret_cast<const float*>(pBase + static_cast<size_t>(taps.y0[lane]) * rowStride);
+        const float* pRow1 = reinterpret_cast<const float*>(pBase + static_cast<size_t>(taps.y1[lane]) * rowStride);
+        __m128       color = _mm_mul_ps(_mm_loadu_ps(pRow0 + 4 * taps.x0[lane]), _mm_set1_ps(taps.w00[lane]));
+        color              = _mm_add_ps(color, _mm_mul_ps(_mm_loadu_ps(pRow0 + 4 * taps.x1[lane]), _mm_set1_ps(taps.w10[lane])));
+        color              = _mm_add_ps(color, _mm_mul_ps(_mm_loadu_ps(pRow1 + 4 * taps.x0[lane]), _mm_set1_ps(taps.w01[lane])));
+        color              = _mm_add_ps(color, _mm_mul_ps(_mm_loadu_ps(pRow1 + 4 * taps.x1[lane]), _mm_set1_ps(taps.w11[lane])));
+        _mm_storeu_ps(pRGBA + 4 * lane, color);
+    }
+}
+
+// =================================================================================================
+// AVX2
+// =================================================================================================
+GREX_TARGET_AVX2 static __m256 SelectAVX2(__m256 mask, __m256 a, __m256 b)
+{
+    return _mm256_blendv_ps(b, a, mask);
+}
+
+GREX_TARGET_AVX2 static __m256 AbsAVX2(__m256 x)
+{
+    return _mm256_andnot_ps(_mm256_set1_ps(-0.0f), x);
+}
+
+GREX_TARGET_AVX2 static __m256 SaturateAVX2(__m256 x)
+{
+    return _mm256_max_ps(_mm256_min_ps(x, _mm256_set1_ps(1.0f)), _mm256_setzero_ps());
+}
+
+GREX_TARGET_AVX2 static __m256 ConvertU32AVX2(__m256i x)
+{
+    __m256 hi = _mm256_mul_ps(_mm256_cvtepi32_ps(_mm256_srli_epi32(x, 16)), _mm256_set1_ps(65536.0f));
+    __m256 lo = _mm256_cvtepi32_ps(_mm256_and_si256(x, _mm256_set1_epi32(0xFFFF)));
+    return _mm256_add_ps(hi, lo);
+}
+
+GREX_TARGET_AVX2 static void SinCos2PiAVX2(__m256 t, __m256* pSin, __m256* pCos)
+{
+    __m256i iq = _mm256_cvtps_epi32(_mm256_mul_ps(t, _mm256_set1_ps(4.0f)));
+    __m256  q  = _mm256_cvtepi32_ps(iq);
+    __m256  x  = _mm256_mul_ps(_mm256_sub_ps(t, _mm256_mul_ps(q, _mm256_set1_ps(0.25f))), _mm256_set1_ps(kTwoPi));
+    __m256  x2 = _mm256_mul_ps(x, x);
+
+    __m256 s = _mm256_set1_ps(kSin9);
+    s        = _mm256_add_ps(_mm256_set1_ps(kSin7), _mm256_mul_ps(x2, s));
+    s        = _mm256_add_ps(_mm256_set1_ps(kSin5), _mm256_mul_ps(x2, s));
+    s        = _mm256_add_ps(_mm256_set1_ps(kSin3), _mm256_mul_ps(x2, s));
+    s        = _mm256_add_ps(x, _mm256_mul_ps(_mm256_mul_ps(x, x2), s));
+
+    __m256 c = _mm256_set1_ps(kCos8);
+    c        = _mm256_add_ps(_mm256_set1_ps(kCos6), _mm256_mul_ps(x2, c));
+    c        = _mm256_add_ps(_mm256_set1_ps(kCos4), _mm256_mul_ps(x2, c));
+    c        = _mm256_add_ps(_mm256_set1_ps(kCos2), _mm256_mul_ps(x2, c));
+    c        = _mm256_add_ps(_mm256_set1_ps(1.0f), _mm256_mul_ps(x2, c));
+
+    __m256i one     = _mm256_set1_epi32(1);
+    __m256i two     = _mm256_set1_epi32(2);
+    __m256  swap    = _mm256_castsi256_ps(_mm256_cmpeq_epi32(_mm256_and_si256(iq, one), one));
+    __m256  sinSign = _mm256_castsi256_ps(_mm256_slli_epi32(_mm256_and_si256(iq, two), 30));
+    __m256  cosSign = _mm256_castsi256_ps(_mm256_slli_epi32(_mm256_and_si256(_mm256_add_epi32(iq, one), two), 30));
+    *pSin           = _mm256_xor_ps(SelectAVX2(swap, c, s), sinSign);
+    *pCos           = _mm256_xor_ps(SelectAVX2(swap, s, c), cosSign);
+}
+
+GREX_TARGET_AVX2 static __m256 AcosAVX2(__m256 x)
+{
+    __m256 ax = _mm256_min_ps(AbsAVX2(x), _mm256_set1_ps(1.0f));
+    __m256 p  = _mm256_set1_ps(kAcos[7]);
+    for (int i = 6; i >= 0; --i)
+    {
+        p = _mm256_add_ps(_mm256_set1_ps(kAcos[i]), _mm256_mul_ps(ax, p));
+    }
+    __m256 r = _mm256_mul_ps(_mm256_sqrt_ps(_mm256_sub_ps(_mm256_set1_ps(1.0f), ax)), p);
+    return SelectAVX2(_mm256_cmp_ps(x, _mm256_setzero_ps(), _CMP_LT_OQ), _mm256_sub_ps(_mm256_set1_ps(kPi), r), r);
+}
+
+GREX_TARGET_AVX2 static __m256 Atan2AVX2(__m256 y, __m256 x)
+{
+    __m256 ax = AbsAVX2(x);
+    __m256 ay = AbsAVX2(y);
+    __m256 t  = _mm256_div_ps(_mm256_min_ps(ax, ay), _mm256_max_ps(_mm256_max_ps(ax, ay), _mm256_set1_ps(FLT_MIN)));
+    __m256 t2 = _mm256_mul_ps(t, t);
+    __m256 p  = _mm256_set1_ps(kAtan[8]);
+    for (int i = 7; i >= 0; --i)
+    {
+        p = _mm256_add_ps(_mm256_set1_ps(kAtan[i]), _mm256_mul_ps(t2, p));
+    }
+    __m256 a = _mm256_mul_ps(t, p);
+    a        = SelectAVX2(_mm256_cmp_ps(ay, ax, _CMP_GT_OQ), _mm256_sub_ps(_mm256_set1_ps(kHalfPi), a), a);
+    a        = SelectAVX2(_mm256_cmp_ps(x, _mm256_setzero_ps(), _CMP_LT_OQ), _mm256_sub_ps(_mm256_set1_ps(kPi), a), a);
+    a        = SelectAVX2(_mm256_cmp_ps(y, _mm256_setzero_ps(), _CMP_LT_OQ), _mm256_sub_ps(_mm256_set1_ps(kTwoPi), a), a);
+    return a;
+}
+
+GREX_TARGET_AVX2 static void HammersleyAVX2(uint32_t first, uint32_t numSamples, float* pXi0, float* pXi1)
+{
+    __m256i i    = _mm256_add_epi32(_mm256_set1_epi32(static_cast<int32_t>(first)), _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7));
+    __m256i bits = _mm256_or_si256(_mm256_slli_epi32(i, 16), _mm256_srli_epi32(i, 16));
+    bits         = _mm256_or_si256(_mm256_slli_epi32(_mm256_and_si256(bits, _mm256_set1_epi32(0x55555555)), 1), _mm256_srli_epi32(_mm256_and_si256(bits, _mm256_set1_epi32(0xAAAAAAAA)), 1));
+    bits         = _mm256_or_si256(_mm256_slli_epi32(_mm256_and_si256(bits, _mm256_set1_epi32(0x33333333)), 2), _mm256_srli_epi32(_mm256_and_si256(bits, _mm256_set1_epi32(0xCCCCCCCC)), 2));
+    bits         = _mm256_or_si256(_mm256_slli_epi32(_mm256_and_si256(bits, _mm256_set1_epi32(0x0F0F0F0F)), 4), _mm256_srli_epi32(_mm256_and_si256(bits, _mm256_set1_epi32(0xF0F0F0F0)), 4));
+    bits         = _mm256_or_si256(_mm256_slli_epi32(_mm256_and_si256(bits, _mm256_set1_epi32(0x00FF00FF)), 8), _mm256_srli_epi32(_mm256_and_si256(bits, _mm256_set1_epi32(0xFF00FF00)), 8));
+    _mm256_storeu_ps(pXi0, _mm256_div_ps(ConvertU32AVX2(i), _mm256_set1_ps(static_cast<float>(numSamples))));
+    _mm256_storeu_ps(pXi1, _mm256_mul_ps(ConvertU32AVX2(bits), _mm256_set1_ps(2.3283064365386963e-10f)));
+}
+
+GREX_TARGET_AVX2 static void SampleAVX2(const float* pXi0, const float* pXi1, const SampleParams& params, GGXSamples* pSamples, uint32_t i)
+{
+    const GGXFrame& f   = params.frame;
+    const __m256    one = _mm256_set1_ps(1.0f);
+    __m256          xi0 = _mm256_loadu_ps(pXi0);
+    __m256          xi1 = _mm256_loadu_ps(pXi1);
+
+    __m256 sinPhi;
+    __m256 cosPhi;
+    SinCos2PiAVX2(xi0, &sinPhi, &cosPhi);
+    __m256 cosTheta = _mm256_sqrt_ps(_mm256_div_ps(_mm256_sub_ps(one, xi1), _mm256_add_ps(one, _mm256_mul_ps(_mm256_set1_ps(params.a2 - 1.0f), xi1))));
+    __m256 sinTheta = _mm256_sqrt_ps(_mm256_max_ps(_mm256_sub_ps(one, _mm256_mul_ps(cosTheta, cosTheta)), _mm256_setzero_ps()));
+    __m256 hx       = _mm256_mul_ps(sinTheta, cosPhi);
+    __m256 hy       = _mm256_mul_ps(sinTheta, sinPhi);
+    __m256 hz       = cosTheta;
+
+    __m256 H[3];
+    for (uint32_t c = 0; c < 3; ++c)
+    {
+        H[c] = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(_mm256_set1_ps(f.tangentX[c]), hx), _mm256_mul_ps(_mm256_set1_ps(f.tangentY[c]), hy)), _mm256_mul_ps(_mm256_set1_ps(f.N[c]), hz));
+    }
+    _mm256_storeu_ps(&pSamples->Hx[i], H[0]);
+    _mm256_storeu_ps(&pSamples->Hy[i], H[1]);
+    _mm256_storeu_ps(&pSamples->Hz[i], H[2]);
+    if (!params.reflect)
+    {
+        return;
+    }
+
+    __m256 VoH = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(_mm256_set1_ps(params.V[0]), H[0]), _mm256_mul_ps(_mm256_set1_ps(params.V[1]), H[1])), _mm256_mul_ps(_mm256_set1_ps(params.V[2]), H[2]));
+    __m256 L[3];
+    for (uint32_t c = 0; c < 3; ++c)
+    {
+        L[c] = _mm256_sub_ps(_mm256_mul_ps(_mm256_mul_ps(_mm256_set1_ps(2.0f), VoH), H[c]), _mm256_set1_ps(params.V[c]));
+    }
+    __m256 NoL = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(_mm256_set1_ps(f.N[0]), L[0]), _mm256_mul_ps(_mm256_set1_ps(f.N[1]), L[1])), _mm256_mul_ps(_mm256_set1_ps(f.N[2]), L[2]));
+    __m256 NoH = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(_mm256_set1_ps(f.N[0]), H[0]), _mm256_mul_ps(_mm256_set1_ps(f.N[1]), H[1])), _mm256_mul_ps(_mm256_set1_ps(f.N[2]), H[2]));
+    _mm256_storeu_ps(&pSamples->Lx[i], L[0]);
+    _mm256_storeu_ps(&pSamples->Ly[i], L[1]);
+    _mm256_storeu_ps(&pSamples->Lz[i], L[2]);
+    _mm256_storeu_ps(&pSamples->NoL[i], SaturateAVX2(NoL));
+    _mm256_storeu_ps(&pSamples->NoH[i], SaturateAVX2(NoH));
+    _mm256_storeu_ps(&pSamples->VoH[i], SaturateAVX2(VoH));
+}
+
+GREX_TARGET_AVX2 static void EquirectUVAVX2(const float* pX, const float* pY, const float* pZ, float* pUVs)
+{
+    __m256 x   = _mm256_loadu_ps(pX);
+    __m256 y   = _mm256_loadu_ps(pY);
+    __m256 z   = _mm256_loadu_ps(pZ);
+    __m256 len = _mm256_sqrt_ps(_mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(x, x), _mm256_mul_ps(y, y)), _mm256_mul_ps(z, z)));
+    x          = _mm256_div_ps(x, len);
+    y          = _mm256_div_ps(y, len);
+    z          = _mm256_div_ps(z, len);
+
+    __m256 epsilon = _mm256_set1_ps(kPoleEpsilon);
+    __m256 pole    = _mm256_and_ps(_mm256_cmp_ps(AbsAVX2(x), epsilon, _CMP_LT_OQ), _mm256_cmp_ps(AbsAVX2(z), epsilon, _CMP_LE_OQ));
+    __m256 theta   = _mm256_andnot_ps(pole, Atan2AVX2(z, x));
+    __m256 phi     = AcosAVX2(y);
+
+    __m256 u = SaturateAVX2(_mm256_div_ps(theta, _mm256_set1_ps(kTwoPi)));
+    __m256 v = SaturateAVX2(_mm256_div_ps(phi, _mm256_set1_ps(kPi)));
+
+    // Unpacking interleaves within 128-bit lanes: (0, 1, 4, 5) and (2, 3, 6, 7)
+    __m256 lo = _mm256_unpacklo_ps(u, v);
+    __m256 hi = _mm256_unpackhi_ps(u, v);
+    _mm256_storeu_ps(pUVs + 0, _mm256_permute2f128_ps(lo, hi, 0x20));
+    _mm256_storeu_ps(pUVs + 8, _mm256_permute2f128_ps(lo, hi, 0x31));
+}
+
+GREX_TARGET_AVX2 static void BilinearTapsAVX2(const float* pUVs, uint32_t width, uint32_t height, BilinearTaps* pTaps)
+{
+    // Shuffling deinterleaves within 128-bit lanes, the permute puts the
+    // samples back in order
+    __m256 uv0 = _mm256_loadu_ps(pUVs + 0);
+    __m256 uv1 = _mm256_loadu_ps(pUVs + 8);
+    __m256 u   = _mm256_castpd_ps(_mm256_permute4x64_pd(_mm256_castps_pd(_mm256_shuffle_ps(uv0, uv1, _MM_SHUFFLE(2, 0, 2, 0))), _MM_SHUFFLE(3, 1, 2, 0)));
+    __m256 v   = _mm256_castpd_ps(_mm256_permute4x64_pd(_mm256_castps_pd(_mm256_shuffle_ps(uv0, uv1, _MM_SHUFFLE(3, 1, 3, 1))), _MM_SHUFFLE(3, 1, 2, 0)));
+    __m256 x   = _mm256_mul_ps(SaturateAVX2(u), _mm256_set1_ps(static_cast<float>(width - 1)));
+    __m256 y   = _mm256_mul_ps(SaturateAVX2(v), _mm256_set1_ps(static_cast<float>(height - 1)));
+
+    // Coordinates are never negative, truncating is flooring
+    __m256i x0 = _mm256_cvttps_epi32(x);
+    __m256i y0 = _mm256_cvttps_epi32(y);
+    __m256  u1 = _mm256_sub_ps(x, _mm256_cvtepi32_ps(x0));
+    __m256  u0 = _mm256_sub_ps(_mm256_set1_ps(1.0f), u1);
+    __m256  v1 = _mm256_sub_ps(y, _mm256_cvtepi32_ps(y0));
+    __m256  v0 = _mm256_sub_ps(_mm256_set1_ps(1.0f), v1);
+
+    // x0 + 1 wraps to 0 past the last column, y0 + 1 clamps to the last row
+    __m256i one = _mm256_set1_epi32(1);
+    __m256i x1  = _mm256_add_epi32(x0, one);
+    x1          = _mm256_andnot_si256(_mm256_cmpgt_epi32(x1, _mm256_set1_epi32(static_cast<int32_t>(width) - 1)), x1);
+    __m256i y1  = _mm256_min_epi32(_mm256_add_epi32(y0, one), _mm256_set1_epi32(static_cast<int32_t>(height) - 1));
+
+    _mm256_storeu_si256(reinterpret_cast<__m256i*>(pTaps->x0), x0);
+    _mm256_storeu_si256(reinterpret_cast<__m256i*>(pTaps->x1), x1);
+    _mm256_storeu_si256(reinterpret_cast<__m256i*>(pTaps->y0), y0);
+    _mm256_storeu_si256(reinterpret_cast<__m256i*>(pTaps->y1), y1);
+    _mm256_storeu_ps(pTaps->w00, _mm256_mul_ps(u0, v0));
+    _mm256_storeu_ps(pTaps->w10, _mm256_mul_ps(u1, v0));
+    _mm256_storeu_ps(pTaps->w01, _mm256_mul_ps(u0, v1));
+    _mm256_storeu_ps(pTaps->w11, _mm256_mul_ps(u1, v1));
+}
+#endif // defined(GREX_GGX_X64)
+
+// =================================================================================================
+// Batches
+// =================================================================================================
+//
+// Full blocks read and write the caller's arrays directly. The last block
+// of a batch that isn't a multiple of the block size goes through padded
+// copies, GGXSamples is always padded.
+//
+void GGXHammersley(
+    uint32_t   first,
+    uint32_t   count,
+    uint32_t   numSamples,
+    float*     pXi0,
+    float*     pXi1,
+    GGXSimdISA isa)
+{
+    isa = ClampISA(isa);
+    for (uint32_t i = 0; i < count; i += kBlockSize)
+    {
+        uint32_t n = std::min(count - i, kBlockSize);
+        float    xi0[kBlockSize];
+        float    xi1[kBlockSize];
+        float*   pBlockXi0 = (n == kBlockSize) ? (pXi0 + i) : xi0;
+        float*   pBlockXi1 = (n == kBlockSize) ? (pXi1 + i) : xi1;
+
+        switch (isa)
+        {
+            default: HammersleyScalar(first + i, numSamples, pBlockXi0, pBlockXi1); break;
+#if defined(GREX_GGX_X64)
+            case GGX_SIMD_ISA_SSE2: HammersleySSE2(first + i, numSamples, pBlockXi0, pBlockXi1); break;
+            case GGX_SIMD_ISA_AVX2: HammersleyAVX2(first + i, numSamples, pBlockXi0, pBlockXi1); break;
+#endif
+        }
+
+        if (n < kBlockSize)
+        {
+            std::copy(xi0, xi0 + n, pXi0 + i);
+            std::copy(xi1, xi1 + n, pXi1 + i);
+        }
+    }
+}
+
+static void SampleBatch(
+    uint32_t            count,
+    const float*        pXi0,
+    const float*        pXi1,
+    const SampleParams& params,
+    GGXSamples*         pSamples,
+    GGXSimdISA          isa)
+{
+    isa = ClampISA(isa);
+    pSamples->Resize(count);
+    for (uint32_t i = 0; i < count; i += kBlockSize)
+    {
+        uint32_t     n               = std::min(count - i, kBlockSize);
+        float        xi0[kBlockSize] = {};
+        float        xi1[kBlockSize] = {};
+        const float* pBlockXi0       = pXi0 + i;
+        const float* pBlockXi1       = pXi1 + i;
+        if (n < kBlockSize)
+        {
+            std::copy(pXi0 + i, pXi0 + i + n, xi0);
+            std::copy(pXi1 + i, pXi1 + i + n, xi1);
+            pBlockXi0 = xi0;
+            pBlockXi1 = xi1;
+        }
+
+        switch (isa)
+        {
+            default: SampleScalar(pBlockXi0, pBlockXi1, params, pSamples, i); break;
+#if defined(GREX_GGX_X64)
+            case GGX_SIMD_ISA_SSE2: SampleSSE2(pBlockXi0, pBlockXi1, params, pSamples, i); break;
+            case GGX_SIMD_ISA_AVX2: SampleAVX2(pBlockXi0, pBlockXi1, params, pSamples, i); break;
+#endif
+        }
+    }
+}
+
+void GGXImportanceSample(
+    uint32_t        count,
+    const float*    pXi0,
+    const float*    pXi1,
+    float           roughness,
+    const GGXFrame& frame,
+    GGXSamples*     pSamples,
+    GGXSimdISA      isa)
+{
+    float        a      = roughness * roughness;
+    SampleParams params = {a * a, frame, {0, 0, 0}, false};
+    SampleBatch(count, pXi0, pXi1, params, pSamples, isa);
+}
+
+void GGXSampleReflect(
+    uint32_t        count,
+    const float*    pXi0,
+    const float*    pXi1,
+    float           roughness,
+    const GGXFrame& frame,
+    const float     V[3],
+    GGXSamples*     pSamples,
+    GGXSimdISA      isa)
+{
+    float        a      = roughness * roughness;
+    SampleParams params = {a * a, frame, {V[0], V[1], V[2]}, true};
+    SampleBatch(count, pXi0, pXi1, params, pSamples, isa);
+}
+
+void GGXDirectionsToEquirectUV(
+    uint32_t     count,
+    const float* pX,
+    const float* pY,
+    const float* pZ,
+    float*       pUVs,
+    GGXSimdISA   isa)
+{
+    isa = ClampISA(isa);
+    for (uint32_t i = 0; i < count; i += kBlockSize)
+    {
+        uint32_t     n             = std::min(count - i, kBlockSize);
+        float        x[kBlockSize] = {};
+        float        y[kBlockSize] = {1, 1, 1, 1, 1, 1, 1, 1};
+        float        z[kBlockSize] = {};
+        float        uvs[2 * kBlockSize];
+        const float* pBlockX   = pX + i;
+        const float* pBlockY   = pY + i;
+        const float* pBlockZ   = pZ + i;
+        float*       pBlockUVs = pUVs + 2 * i;
+        if (n < kBlockSize)
+        {
+            std::copy(pX + i, pX + i + n, x);
+            std::copy(pY + i, pY + i + n, y);
+            std::copy(pZ + i, pZ + i + n, z);
+            pBlockX   = x;
+            pBlockY   = y;
+            pBlockZ   = z;
+            pBlockUVs = uvs;
+        }
+
+        switch (isa)
+        {
+            default: EquirectUVScalar(pBlockX, pBlockY, pBlockZ, pBlockUVs); break;
+#if defined(GREX_GGX_X64)
+            case GGX_SIMD_ISA_SSE2: EquirectUVSSE2(pBlockX, pBlockY, pBlockZ, pBlockUVs); break;
+            case GGX_SIMD_ISA_AVX2: EquirectUVAVX2(pBlockX, pBlockY, pBlockZ, pBlockUVs); break;
+#endif
+        }
+
+        if (n < kBlockSize)
+        {
+            std::copy(uvs, uvs + 2 * n, pUVs + 2 * i);
+        }
+    }
+}
+
+void GGXGatherEquirectBilinear(
+    uint32_t     count,
+    const float* pUVs,
+    const float* pPixels,
+    uint32_t     width,
+    uint32_t     height,
+    uint32_t     rowStride,
+    float*       pRGBA,
+    GGXSimdISA   isa)
+{
+    isa = ClampISA(isa);
+    for (uint32_t i = 0; i < count; i += kBlockSize)
+    {
+        uint32_t     n                   = std::min(count - i, kBlockSize);
+        float        uvs[2 * kBlockSize] = {};
+        float        colors[4 * kBlockSize];
+        const float* pBlockUVs  = pUVs + 2 * i;
+        float*       pBlockRGBA = pRGBA + 4 * i;
+        if (n < kBlockSize)
+        {
+            std::copy(pUVs + 2 * i, pUVs + 2 * (i + n), uvs);
+            pBlockUVs  = uvs;
+            pBlockRGBA = colors;
+        }
+
+        BilinearTaps taps;
+        switch (isa)
+        {
+            default:
+            {
+                BilinearTapsScalar(pBlockUVs, width, height, &taps);
+                BlendTapsScalar(taps, pPixels, rowStride, pBlockRGBA);
+            } break;
+#if defined(GREX_GGX_X64)
+            case GGX_SIMD_ISA_SSE2:
+            {
+                BilinearTapsSSE2(pBlockUVs, width, height, &taps);
+                BlendTapsSSE2(taps, pPixels, rowStride, pBlockRGBA);
+            } break;
+            case GGX_SIMD_ISA_AVX2:
+            {
+                BilinearTapsAVX2(pBlockUVs, width, height, &taps);
+                BlendTapsSSE2(taps, pPixels, rowStride, pBlockRGBA);
+            } break;
+#endif
+        }
+
+        if (n < kBlockSize)
+        {
+            std::copy(colors, colors + 4 * n, pRGBA + 4 * i);
+        }
+    }
+}
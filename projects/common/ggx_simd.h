@@ -0,0 +1,124 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+//
+// Batched GGX importance sampling for the CPU IBL tools. Does the work of
+// Hammersley, ImportanceSampleGGX and CartesianToSpherical from the tools
+// on structure of arrays, in blocks of 8 samples: one AVX2 vector, or two
+// SSE2 vectors on CPUs without AVX2. Other CPUs run the same math one
+// sample at a time.
+//
+// sin, cos, acos and atan2 are polynomial approximations. Every ISA does
+// the same operations in the same order without FMA, so SSE2 and AVX2
+// give identical results. Max absolute errors against double precision,
+// measured over every float t in [0, 1) and x in [-1, 1], and for atan2
+// over every y / x in [0, 1] plus 50M random (y, x) pairs:
+//   GGXSinCos2Pi  9.3e-8
+//   GGXAcos       4.4e-7 rad
+//   GGXAtan2      5.3e-7 rad, 8.4e-8 in u
+//
+enum GGXSimdISA
+{
+    GGX_SIMD_ISA_SCALAR = 0,
+    GGX_SIMD_ISA_SSE2   = 1,
+    GGX_SIMD_ISA_AVX2   = 2,
+};
+
+// Best ISA the CPU supports, what the functions below use by default
+GGXSimdISA GetGGXSimdISA();
+
+const char* GetGGXSimdISAName(GGXSimdISA isa);
+
+// Scalar versions of the approximations, the vector code matches them
+// lane for lane.
+void  GGXSinCos2Pi(float t, float* pSin, float* pCos); // sin(2pi * t) and cos(2pi * t)
+float GGXAcos(float x);
+float GGXAtan2(float y, float x); // [0, 2pi] like catan2 in ibl_prefilter_env
+
+// Tangent frame around N, built the same way as ImportanceSampleGGX: the
+// up vector switches from +Y to +X once |N.y| reaches upThreshold.
+struct GGXFrame
+{
+    float tangentX[3];
+    float tangentY[3];
+    float N[3];
+};
+
+GGXFrame GGXMakeFrame(const float N[3], float upThreshold);
+
+// Outputs of GGXImportanceSample and GGXSampleReflect. The arrays are
+// padded to a multiple of the block size, only the first count entries
+// are valid.
+struct GGXSamples
+{
+    std::vector<float> Hx; // Half vectors, world space
+    std::vector<float> Hy;
+    std::vector<float> Hz;
+    std::vector<float> Lx; // V reflected about H, world space
+    std::vector<float> Ly;
+    std::vector<float> Lz;
+    std::vector<float> NoL; // Saturated
+    std::vector<float> NoH;
+    std::vector<float> VoH;
+
+    void Resize(uint32_t count);
+};
+
+// Hammersley points first to first + count - 1 of a set of numSamples
+void GGXHammersley(
+    uint32_t   first,
+    uint32_t   count,
+    uint32_t   numSamples,
+    float*     pXi0,
+    float*     pXi1,
+    GGXSimdISA isa = GetGGXSimdISA());
+
+// Half vectors for count points in [0, 1)^2, only fills in H
+void GGXImportanceSample(
+    uint32_t        count,
+    const float*    pXi0,
+    const float*    pXi1,
+    float           roughness,
+    const GGXFrame& frame,
+    GGXSamples*     pSamples,
+    GGXSimdISA      isa = GetGGXSimdISA());
+
+// Same as GGXImportanceSample and reflects V about each half vector
+void GGXSampleReflect(
+    uint32_t        count,
+    const float*    pXi0,
+    const float*    pXi1,
+    float           roughness,
+    const GGXFrame& frame,
+    const float     V[3],
+    GGXSamples*     pSamples,
+    GGXSimdISA      isa = GetGGXSimdISA());
+
+// Equirect (u, v) pairs of count directions. The directions are
+// normalized first and mapped like CartesianToSpherical, divided by
+// (2pi, pi) and saturated.
+void GGXDirectionsToEquirectUV(
+    uint32_t     count,
+    const float* pX,
+    const float* pY,
+    const float* pZ,
+    float*       pUVs,
+    GGXSimdISA   isa = GetGGXSimdISA());
+
+// Bilinear samples of an RGBA 32-bit float equirect image at count (u, v)
+// pairs, 4 floats per sample in pRGBA. U wraps, V is clamped. Same result
+// as BitmapRGBA32f::GetBilinearSampleUV with BITMAP_SAMPLE_MODE_WRAP for
+// U for uvs in [0, 1], V can be either BITMAP_SAMPLE_MODE_CLAMP or
+// BITMAP_SAMPLE_MODE_BORDER since the taps past the last row have no
+// weight. rowStride is in bytes.
+void GGXGatherEquirectBilinear(
+    uint32_t     count,
+    const float* pUVs,
+    const float* pPixels,
+    uint32_t     width,
+    uint32_t     height,
+    uint32_t     rowStride,
+    float*       pRGBA,
+    GGXSimdISA   isa = GetGGXSimdISA());
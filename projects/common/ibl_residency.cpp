@@ -0,0 +1,343 @@
+#include "ibl_residency.h"
+#include "window.h"
+
+#include <algorithm>
+
+namespace
+{
+
+// Levels stacked top to bottom with the row stride of the first level,
+// the way they are in an IBL_LAYOUT_EQUIRECT file
+template <typename BitmapT>
+void SetEnvironmentLevels(const BitmapT& levels, GREXFormat format, uint32_t numLevels, IBLUpdate* pUpdate)
+{
+    const uint32_t rowStride   = levels.GetRowStride();
+    uint32_t       levelOffset = 0;
+    uint32_t       levelHeight = pUpdate->height;
+    for (uint32_t level = 0; level < numLevels; ++level)
+    {
+        MipOffset mipOffset = {};
+        mipOffset.Offset    = levelOffset;
+        mipOffset.RowStride = rowStride;
+        pUpdate->mipOffsets.push_back(mipOffset);
+
+        levelOffset += rowStride * levelHeight;
+        levelHeight >>= 1;
+    }
+
+    const char* pPixels = reinterpret_cast<const char*>(levels.GetPixels());
+    pUpdate->format     = format;
+    pUpdate->data.assign(pPixels, pPixels + levels.GetSizeInBytes());
+}
+
+} // namespace
+
+// -------------------------------------------------------------------------------------------------
+// IBLResidency
+// -------------------------------------------------------------------------------------------------
+IBLResidency::IBLResidency(
+    const std::vector<std::filesystem::path>& iblFiles,
+    const BCEncodeOptions&                    encodeOptions,
+    uint64_t                                  memoryBudget)
+    : mFiles(iblFiles),
+      mEncodeOptions(encodeOptions),
+      mMemoryBudget(memoryBudget),
+      mEntries(iblFiles.size())
+{
+    mWorker = std::thread(&IBLResidency::WorkerMain, this);
+}
+
+IBLResidency::~IBLResidency()
+{
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        mStop    = true;
+        mPending = UINT32_MAX;
+    }
+    mWakeWorker.notify_all();
+
+    mWorker.join();
+}
+
+std::string IBLResidency::GetName(uint32_t index) const
+{
+    return (index < mFiles.size()) ? std::filesystem::path(mFiles[index]).filename().replace_extension().string() : "";
+}
+
+void IBLResidency::Select(uint32_t index)
+{
+    if (index >= mEntries.size())
+    {
+        return;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+
+        mSelected                    = index;
+        mEntries[index].lastSelected = ++mSelectCounter;
+
+        const State state = mEntries[index].state;
+        const bool  done  = (state == STATE_RESIDENT) || (state == STATE_FAILED);
+        mPending          = (done || (mLoading == index)) ? UINT32_MAX : index;
+    }
+    mWakeWorker.notify_all();
+}
+
+void IBLResidency::WaitForSelected()
+{
+    std::unique_lock<std::mutex> lock(mMutex);
+    if (mSelected == UINT32_MAX)
+    {
+        return;
+    }
+
+    mSelectedDone.wait(lock, [this] {
+        const State state = mEntries[mSelected].state;
+        const bool  done  = (state == STATE_RESIDENT) || (state == STATE_FAILED);
+        return done || ((mPending != mSelected) && (mLoading != mSelected));
+    });
+}
+
+std::vector<IBLUpdate> IBLResidency::TakeUpdates()
+{
+    std::lock_guard<std::mutex> lock(mMutex);
+
+    std::vector<IBLUpdate> updates = std::move(mUpdates);
+    mUpdates.clear();
+    return updates;
+}
+
+uint64_t IBLResidency::GetResidentSize() const
+{
+    std::lock_guard<std::mutex> lock(mMutex);
+    return mResidentSize;
+}
+
+void IBLResidency::WorkerMain()
+{
+    while (true)
+    {
+        uint32_t index = UINT32_MAX;
+        State    state = STATE_NOT_LOADED;
+        {
+            std::unique_lock<std::mutex> lock(mMutex);
+            mWakeWorker.wait(lock, [this] { return mStop || (mPending != UINT32_MAX); });
+            if (mStop)
+            {
+                return;
+            }
+
+            index    = mPending;
+            state    = mEntries[index].state;
+            mPending = UINT32_MAX;
+            mLoading = index;
+        }
+
+        // Fallback first so the app can switch over right away
+        if (state == STATE_NOT_LOADED)
+        {
+            IBLMaps ibl = {};
+            bool    res = LoadIBLIrradianceMap32f(mFiles[index], &ibl);
+            if (!res)
+            {
+                GREX_LOG_ERROR("failed to load: " << mFiles[index]);
+            }
+            else if (ibl.layout != IBL_LAYOUT_EQUIRECT)
+            {
+                // The environment is uploaded and sampled as a 2D equirect texture
+                GREX_LOG_ERROR("unsupported IBL layout, only equirect maps can be made resident: " << mFiles[index]);
+                res = false;
+            }
+
+            std::lock_guard<std::mutex> lock(mMutex);
+            if (res)
+            {
+                IBLUpdate update     = {};
+                update.type          = IBL_UPDATE_FALLBACK;
+                update.index         = index;
+                update.irradianceMap = std::move(ibl.irradianceMap);
+                mUpdates.push_back(std::move(update));
+            }
+            mEntries[index].state = res ? STATE_FALLBACK : STATE_FAILED;
+            state                 = mEntries[index].state;
+        }
+
+        // Skip the environment map if the selection moved on while the
+        // fallback loaded, it's loaded again if it's selected again
+        bool loadEnvironment = false;
+        {
+            std::lock_guard<std::mutex> lock(mMutex);
+            loadEnvironment = (state == STATE_FALLBACK) && (mSelected == index) && !mStop;
+        }
+
+        if (loadEnvironment)
+        {
+            IBLUpdate update = {};
+            bool      res    = LoadEnvironment(index, &update);
+
+            std::lock_guard<std::mutex> lock(mMutex);
+            if (res)
+            {
+                mEntries[index].state        = STATE_RESIDENT;
+                mEntries[index].residentSize = update.GetSizeInBytes();
+                mResidentSize += update.GetSizeInBytes();
+                mUpdates.push_back(std::move(update));
+
+                EvictOverBudget();
+            }
+            else
+            {
+                // Keeps showing the fallback
+                mEntries[index].state = STATE_FAILED;
+            }
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(mMutex);
+            mLoading = UINT32_MAX;
+        }
+        mSelectedDone.notify_all();
+    }
+}
+
+bool IBLResidency::LoadEnvironment(uint32_t index, IBLUpdate* pUpdate) const
+{
+    const std::filesystem::path& iblFile = mFiles[index];
+
+    IBLMaps ibl = {};
+    if (!LoadIBLMaps32f(iblFile, &ibl))
+    {
+        GREX_LOG_ERROR("failed to load: " << iblFile);
+        return false;
+    }
+    if (ibl.layout != IBL_LAYOUT_EQUIRECT)
+    {
+        GREX_LOG_ERROR("unsupported IBL layout, only equirect maps can be made resident: " << iblFile);
+        return false;
+    }
+
+    pUpdate->type   = IBL_UPDATE_ENVIRONMENT;
+    pUpdate->index  = index;
+    pUpdate->width  = ibl.baseWidth;
+    pUpdate->height = ibl.baseHeight;
+
+    switch (mEncodeOptions.format)
+    {
+        default:
+        {
+            SetEnvironmentLevels(ibl.environmentMap, GREX_FORMAT_R32G32B32A32_FLOAT, ibl.numLevels, pUpdate);
+        }
+        break;
+
+        case GREX_FORMAT_R16G16B16A16_FLOAT:
+        {
+            SetEnvironmentLevels(ConvertToRGBA16f(ibl.environmentMap), GREX_FORMAT_R16G16B16A16_FLOAT, ibl.numLevels, pUpdate);
+        }
+        break;
+
+        case GREX_FORMAT_R9G9B9E5_UFLOAT:
+        {
+            SetEnvironmentLevels(ConvertToRGB9E5(ibl.environmentMap), GREX_FORMAT_R9G9B9E5_UFLOAT, ibl.numLevels, pUpdate);
+        }
+        break;
+
+        case GREX_FORMAT_BC6H_UFLOAT:
+        {
+            BCTexture encoded = {};
+            if (!BCEncodeEnvironmentMap(ibl, mEncodeOptions, &encoded))
+            {
+                GREX_LOG_ERROR("failed to compress: " << iblFile);
+                return false;
+            }
+
+            pUpdate->format     = encoded.format;
+            pUpdate->mipOffsets = std::move(encoded.mipOffsets);
+            pUpdate->data       = std::move(encoded.data);
+        }
+        break;
+    }
+
+    GREX_LOG_INFO("Loaded " << iblFile);
+
+    return true;
+}
+
+void IBLResidency::EvictOverBudget()
+{
+    while (mResidentSize > mMemoryBudget)
+    {
+        // Least recently selected, never the selected one
+        uint32_t victim = UINT32_MAX;
+        for (uint32_t i = 0; i < CountU32(mEntries); ++i)
+        {
+            if ((mEntries[i].state != STATE_RESIDENT) || (i == mSelected))
+            {
+                continue;
+            }
+            if ((victim == UINT32_MAX) || (mEntries[i].lastSelected < mEntries[victim].lastSelected))
+            {
+                victim = i;
+            }
+        }
+        if (victim == UINT32_MAX)
+        {
+            break;
+        }
+
+        mResidentSize -= mEntries[victim].residentSize;
+        mEntries[victim].state        = STATE_FALLBACK;
+        mEntries[victim].residentSize = 0;
+
+        IBLUpdate update = {};
+        update.type      = IBL_UPDATE_EVICT;
+        update.index     = victim;
+        mUpdates.push_back(std::move(update));
+
+        GREX_LOG_INFO("Evicted " << mFiles[victim]);
+    }
+}
+
+// -------------------------------------------------------------------------------------------------
+// Functions
+// -------------------------------------------------------------------------------------------------
+std::vector<std::filesystem::path> FindIBLFiles(uint32_t maxCount)
+{
+    std::vector<std::filesystem::path> iblFiles;
+    for (auto& dir : GetEveryAssetPath("IBL"))
+    {
+        for (auto& entry : std::filesystem::directory_iterator(dir))
+        {
+            if (!entry.is_regular_file() || (entry.path().extension() != ".ibl"))
+            {
+                continue;
+            }
+
+            // Cube and octahedral maps would need cube or octahedral
+            // textures, the samples only sample equirect environments
+            std::filesystem::path subPath = std::filesystem::relative(entry.path(), dir.parent_path());
+            IBLMaps               header  = {};
+            if (!LoadIBLHeader(subPath, &header))
+            {
+                GREX_LOG_WARN("skipping unreadable IBL file: " << subPath);
+                continue;
+            }
+            if (header.layout != IBL_LAYOUT_EQUIRECT)
+            {
+                GREX_LOG_WARN("skipping non-equirect IBL file: " << subPath);
+                continue;
+            }
+
+            iblFiles.push_back(subPath);
+        }
+    }
+
+    // Sort the file names since they come back out of order on macOS
+    std::sort(iblFiles.begin(), iblFiles.end());
+    if (iblFiles.size() > maxCount)
+    {
+        iblFiles.resize(maxCount);
+    }
+
+    return iblFiles;
+}
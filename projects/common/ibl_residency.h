@@ -0,0 +1,143 @@
+#pragma once
+
+#include "bc_encoder.h"
+
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+
+// -------------------------------------------------------------------------------------------------
+// IBLUpdate
+// -------------------------------------------------------------------------------------------------
+enum IBLUpdateType
+{
+    IBL_UPDATE_FALLBACK    = 0, // Irradiance map loaded, it stands in for the environment map until that loads
+    IBL_UPDATE_ENVIRONMENT = 1, // Environment map loaded
+    IBL_UPDATE_EVICT       = 2, // Environment map is over the memory budget, release it and go back to the fallback
+};
+
+//
+// The environment members have the same names as BCTexture so they can be
+// handed to CreateTexture the same way. Uncompressed levels are laid out
+// the way they are in the file: stacked top to bottom with the row stride
+// of the first level.
+//
+struct IBLUpdate
+{
+    IBLUpdateType type  = IBL_UPDATE_FALLBACK;
+    uint32_t      index = 0;
+
+    // IBL_UPDATE_FALLBACK
+    BitmapRGBA32f irradianceMap;
+
+    // IBL_UPDATE_ENVIRONMENT
+    GREXFormat             format = GREX_FORMAT_UNKNOWN;
+    uint32_t               width  = 0;
+    uint32_t               height = 0;
+    std::vector<MipOffset> mipOffsets;
+    std::vector<char>      data;
+
+    uint32_t    GetNumLevels() const { return CountU32(mipOffsets); }
+    size_t      GetSizeInBytes() const { return data.size(); }
+    const char* GetData() const { return data.data(); }
+};
+
+// -------------------------------------------------------------------------------------------------
+// IBLResidency
+// -------------------------------------------------------------------------------------------------
+//
+// Keeps only the environment maps that are in use resident instead of
+// loading every IBL at startup. Selecting a map loads it on a background
+// thread: its irradiance map first, as a low resolution fallback, then
+// the full environment map. Maps that aren't selected anymore stay
+// resident until the total size of the resident environment maps goes
+// over \b memoryBudget, then the least recently selected ones are
+// evicted. Fallbacks are never evicted, they're small.
+//
+// GPU resources are never touched here. The render thread applies the
+// updates from TakeUpdates() in order: it creates textures for FALLBACK
+// and ENVIRONMENT updates and releases the environment texture for EVICT
+// updates.
+//
+// Only IBL_LAYOUT_EQUIRECT files are supported, other layouts fail to
+// load with an error. FindIBLFiles leaves them out.
+//
+// \b encodeOptions.format is GREX_FORMAT_R32G32B32A32_FLOAT to keep the
+// levels as they are, GREX_FORMAT_R16G16B16A16_FLOAT or
+// GREX_FORMAT_R9G9B9E5_UFLOAT to convert them to a half or a quarter of
+// the size, or GREX_FORMAT_BC6H_UFLOAT.
+//
+class IBLResidency
+{
+public:
+    IBLResidency(
+        const std::vector<std::filesystem::path>& iblFiles,
+        const BCEncodeOptions&                    encodeOptions,
+        uint64_t                                  memoryBudget);
+
+    // Waits for the map that's loading, if any
+    ~IBLResidency();
+
+    IBLResidency(const IBLResidency&)            = delete;
+    IBLResidency& operator=(const IBLResidency&) = delete;
+
+    uint32_t    GetCount() const { return CountU32(mFiles); }
+    std::string GetName(uint32_t index) const;
+
+    // Selects \b index and loads whatever isn't resident yet. Loads queued
+    // for other maps that haven't started are dropped.
+    void Select(uint32_t index);
+
+    // Blocks until the selected map is resident or failed to load, for
+    // the map that's shown at startup
+    void WaitForSelected();
+
+    // Updates in the order they need to be applied
+    std::vector<IBLUpdate> TakeUpdates();
+
+    // Sum of the resident environment maps, see \b memoryBudget
+    uint64_t GetResidentSize() const;
+
+private:
+    enum State
+    {
+        STATE_NOT_LOADED = 0,
+        STATE_FALLBACK   = 1,
+        STATE_RESIDENT   = 2,
+        STATE_FAILED     = 3,
+    };
+
+    struct Entry
+    {
+        State    state        = STATE_NOT_LOADED;
+        uint64_t residentSize = 0;
+        uint64_t lastSelected = 0;
+    };
+
+    void WorkerMain();
+    bool LoadEnvironment(uint32_t index, IBLUpdate* pUpdate) const;
+    void EvictOverBudget();
+
+private:
+    std::vector<std::filesystem::path> mFiles;
+    BCEncodeOptions                    mEncodeOptions = {};
+    uint64_t                           mMemoryBudget  = 0;
+
+    mutable std::mutex      mMutex;
+    std::condition_variable mWakeWorker;
+    std::condition_variable mSelectedDone;
+    std::thread             mWorker;
+    std::vector<Entry>      mEntries;
+    std::vector<IBLUpdate>  mUpdates;
+    uint32_t                mSelected      = UINT32_MAX;
+    uint32_t                mPending       = UINT32_MAX; // Queued load, only the latest selection is kept
+    uint32_t                mLoading       = UINT32_MAX;
+    uint64_t                mResidentSize  = 0;
+    uint64_t                mSelectCounter = 0;
+    bool                    mStop          = false;
+};
+
+// Lists the .ibl files in every IBL asset directory as sorted asset sub
+// paths, at most \b maxCount of them. Only IBL_LAYOUT_EQUIRECT files are
+// listed, IBLResidency uploads environment maps as 2D equirect textures.
+std::vector<std::filesystem::path> FindIBLFiles(uint32_t maxCount);
@@ -0,0 +1,155 @@
+#pragma once
+
+#if defined(WIN32)
+#    if !defined(NOMINMAX)
+#        define NOMINMAX
+#    endif
+#    include <windows.h>
+#else
+#    include <fcntl.h>
+#    include <sys/mman.h>
+#    include <sys/stat.h>
+#    include <unistd.h>
+#endif
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+//
+// Read only memory mapping of an entire file. The mapping stays valid until
+// Close() is called or the object is destroyed.
+//
+// Empty files can't be mapped, Open() returns false for them.
+//
+class MappedFile
+{
+public:
+    MappedFile() {}
+
+    ~MappedFile()
+    {
+        Close();
+    }
+
+    MappedFile(const MappedFile&)            = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    bool Open(const std::string& path)
+    {
+        Close();
+
+#if defined(WIN32)
+        mFile = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+        if (mFile == INVALID_HANDLE_VALUE)
+        {
+            return false;
+        }
+
+        LARGE_INTEGER fileSize = {};
+        if (!GetFileSizeEx(mFile, &fileSize) || (fileSize.QuadPart == 0))
+        {
+            Close();
+            return false;
+        }
+
+        mMapping = CreateFileMappingA(mFile, nullptr, PAGE_READONLY, 0, 0, nullptr);
+        if (mMapping == nullptr)
+        {
+            Close();
+            return false;
+        }
+
+        mData = MapViewOfFile(mMapping, FILE_MAP_READ, 0, 0, 0);
+        if (mData == nullptr)
+        {
+            Close();
+            return false;
+        }
+
+        mSize = static_cast<size_t>(fileSize.QuadPart);
+#else
+        mFile = open(path.c_str(), O_RDONLY);
+        if (mFile == -1)
+        {
+            return false;
+        }
+
+        struct stat fileStat = {};
+        if ((fstat(mFile, &fileStat) != 0) || (fileStat.st_size == 0))
+        {
+            Close();
+            return false;
+        }
+
+        void* pData = mmap(nullptr, static_cast<size_t>(fileStat.st_size), PROT_READ, MAP_PRIVATE, mFile, 0);
+        if (pData == MAP_FAILED)
+        {
+            Close();
+            return false;
+        }
+
+        mData = pData;
+        mSize = static_cast<size_t>(fileStat.st_size);
+#endif
+
+        return true;
+    }
+
+    void Close()
+    {
+#if defined(WIN32)
+        if (mData != nullptr)
+        {
+            UnmapViewOfFile(mData);
+        }
+        if (mMapping != nullptr)
+        {
+            CloseHandle(mMapping);
+        }
+        if (mFile != INVALID_HANDLE_VALUE)
+        {
+            CloseHandle(mFile);
+        }
+        mMapping = nullptr;
+        mFile    = INVALID_HANDLE_VALUE;
+#else
+        if (mData != nullptr)
+        {
+            munmap(mData, mSize);
+        }
+        if (mFile != -1)
+        {
+            close(mFile);
+        }
+        mFile = -1;
+#endif
+        mData = nullptr;
+        mSize = 0;
+    }
+
+    bool IsOpen() const
+    {
+        return (mData != nullptr);
+    }
+
+    const char* GetData() const
+    {
+        return static_cast<const char*>(mData);
+    }
+
+    size_t GetSize() const
+    {
+        return mSize;
+    }
+
+private:
+#if defined(WIN32)
+    HANDLE mFile    = INVALID_HANDLE_VALUE;
+    HANDLE mMapping = nullptr;
+#else
+    int mFile = -1;
+#endif
+    void*  mData = nullptr;
+    size_t mSize = 0;
+};
@@ -0,0 +1,337 @@
+#include "meshlet.h"
+#include "config.h"
+
+#include "meshoptimizer.h"
+
+// -------------------------------------------------------------------------------------------------
+// Meshlet building
+// -------------------------------------------------------------------------------------------------
+namespace
+{
+
+// Triangles of a single group in a single LOD
+struct MeshletJob
+{
+    uint32_t              lodIndex   = 0;
+    uint32_t              groupIndex = UINT32_MAX; // UINT32_MAX for triangles that aren't in any group
+    std::vector<uint32_t> indices;
+
+    // Results, offsets are local to the job
+    std::vector<TriMesh::Meshlet> meshlets;
+    std::vector<uint32_t>         vertices;
+    std::vector<uint32_t>         triangles;
+    std::vector<glm::vec4>        boundingSpheres;
+    std::vector<glm::vec4>        normalCones;
+    std::vector<glm::vec4>        coneApexes;
+};
+
+void BuildMeshletJob(const TriMesh& mesh, const MeshletOptions& options, MeshletJob& job)
+{
+    if (job.indices.empty())
+    {
+        return;
+    }
+
+    const size_t maxMeshlets = meshopt_buildMeshletsBound(job.indices.size(), options.maxVertices, options.maxTriangles);
+
+    std::vector<meshopt_Meshlet> meshlets(maxMeshlets);
+    std::vector<uint32_t>        meshletVertices(maxMeshlets * options.maxVertices);
+    std::vector<uint8_t>         meshletTriangles(maxMeshlets * options.maxTriangles * 3);
+
+    size_t meshletCount = meshopt_buildMeshlets(
+        meshlets.data(),
+        meshletVertices.data(),
+        meshletTriangles.data(),
+        job.indices.data(),
+        job.indices.size(),
+        reinterpret_cast<const float*>(mesh.GetPositions().data()),
+        mesh.GetNumVertices(),
+        sizeof(glm::vec3),
+        options.maxVertices,
+        options.maxTriangles,
+        options.coneWeight);
+
+    job.meshlets.reserve(meshletCount);
+    job.boundingSpheres.reserve(meshletCount);
+    job.normalCones.reserve(meshletCount);
+    job.coneApexes.reserve(meshletCount);
+
+    for (size_t i = 0; i < meshletCount; ++i)
+    {
+        const meshopt_Meshlet& src = meshlets[i];
+
+        auto bounds = meshopt_computeMeshletBounds(
+            &meshletVertices[src.vertex_offset],
+            &meshletTriangles[src.triangle_offset],
+            src.triangle_count,
+            reinterpret_cast<const float*>(mesh.GetPositions().data()),
+            mesh.GetNumVertices(),
+            sizeof(glm::vec3));
+
+        TriMesh::Meshlet meshlet = {};
+        meshlet.vertexOffset     = static_cast<uint32_t>(job.vertices.size());
+        meshlet.triangleOffset   = static_cast<uint32_t>(job.triangles.size());
+        meshlet.vertexCount      = src.vertex_count;
+        meshlet.triangleCount    = src.triangle_count;
+        job.meshlets.push_back(meshlet);
+
+        job.vertices.insert(
+            job.vertices.end(),
+            meshletVertices.begin() + src.vertex_offset,
+            meshletVertices.begin() + src.vertex_offset + src.vertex_count);
+
+        // Repack triangles from 3 consecutive bytes to 4-byte uint32_t to
+        // make it easier to unpack on the GPU.
+        for (uint32_t triIdx = 0; triIdx < src.triangle_count; ++triIdx)
+        {
+            const uint8_t* pTri   = &meshletTriangles[src.triangle_offset + 3 * triIdx];
+            uint32_t       packed = ((static_cast<uint32_t>(pTri[0]) & 0xFF) << 0) |
+                              ((static_cast<uint32_t>(pTri[1]) & 0xFF) << 8) |
+                              ((static_cast<uint32_t>(pTri[2]) & 0xFF) << 16);
+            job.triangles.push_back(packed);
+        }
+
+        job.boundingSpheres.push_back(glm::vec4(bounds.center[0], bounds.center[1], bounds.center[2], bounds.radius));
+        job.normalCones.push_back(glm::vec4(bounds.cone_axis[0], bounds.cone_axis[1], bounds.cone_axis[2], bounds.cone_cutoff));
+        job.coneApexes.push_back(glm::vec4(bounds.cone_apex[0], bounds.cone_apex[1], bounds.cone_apex[2], 0.0f));
+    }
+
+    // Indices aren't needed anymore
+    job.indices = {};
+}
+
+} // namespace
+
+bool BuildMeshlets(const std::vector<TriMesh>& meshLODs, const MeshletOptions& options, MeshletBuffers* pMeshlets)
+{
+    if (IsNull(pMeshlets) || meshLODs.empty())
+    {
+        return false;
+    }
+
+    if ((options.maxVertices == 0) || (options.maxVertices > 255) || (options.maxTriangles == 0) || (options.maxTriangles > 512))
+    {
+        GREX_LOG_ERROR("invalid meshlet limits: maxVertices=" << options.maxVertices << ", maxTriangles=" << options.maxTriangles);
+        return false;
+    }
+
+    //
+    // One job per group per LOD, plus one for the triangles of each LOD
+    // that aren't in any group. Groups are contiguous triangle ranges so
+    // each job is a single range.
+    //
+    std::vector<MeshletJob> jobs;
+    for (uint32_t lodIdx = 0; lodIdx < CountU32(meshLODs); ++lodIdx)
+    {
+        const TriMesh& mesh = meshLODs[lodIdx];
+
+        auto AddJob = [&](uint32_t groupIdx, std::span<const TriMesh::Triangle> triangles) {
+            MeshletJob job = {};
+            job.lodIndex   = lodIdx;
+            job.groupIndex = groupIdx;
+
+            job.indices.reserve(3 * triangles.size());
+            for (const TriMesh::Triangle& tri : triangles)
+            {
+                job.indices.push_back(tri.vIdx0);
+                job.indices.push_back(tri.vIdx1);
+                job.indices.push_back(tri.vIdx2);
+            }
+
+            jobs.push_back(std::move(job));
+        };
+
+        for (uint32_t groupIdx = 0; groupIdx < mesh.GetNumGroups(); ++groupIdx)
+        {
+            AddJob(groupIdx, mesh.GetGroupTriangles(groupIdx));
+        }
+
+        const uint32_t numGroupedTriangles = mesh.GetNumGroupedTriangles();
+        AddJob(UINT32_MAX, std::span<const TriMesh::Triangle>(mesh.GetTriangles()).subspan(numGroupedTriangles));
+    }
+
+    ParallelFor(CountU32(jobs), 1, [&](uint32_t begin, uint32_t end) {
+        for (uint32_t jobIdx = begin; jobIdx < end; ++jobIdx)
+        {
+            BuildMeshletJob(meshLODs[jobs[jobIdx].lodIndex], options, jobs[jobIdx]);
+        }
+    });
+
+    // Combine, jobs are in LOD order with each LOD's groups in order
+    MeshletBuffers meshlets = {};
+    meshlets.lods.resize(meshLODs.size());
+
+    uint32_t baseVertex = 0;
+    for (uint32_t lodIdx = 0; lodIdx < CountU32(meshLODs); ++lodIdx)
+    {
+        meshlets.lods[lodIdx].baseVertex = baseVertex;
+        meshlets.lods[lodIdx].groups.resize(meshLODs[lodIdx].GetNumGroups());
+        baseVertex += meshLODs[lodIdx].GetNumVertices();
+    }
+
+    for (uint32_t jobIdx = 0; jobIdx < CountU32(jobs); ++jobIdx)
+    {
+        const MeshletJob& job = jobs[jobIdx];
+        MeshletLOD&       lod = meshlets.lods[job.lodIndex];
+
+        // First job of the LOD
+        if ((jobIdx == 0) || (jobs[jobIdx - 1].lodIndex != job.lodIndex))
+        {
+            lod.meshlets.firstMeshlet = CountU32(meshlets.meshlets);
+        }
+
+        MeshletRange range = {};
+        range.firstMeshlet = CountU32(meshlets.meshlets);
+        range.meshletCount = CountU32(job.meshlets);
+
+        const uint32_t vertexOffset   = CountU32(meshlets.vertices);
+        const uint32_t triangleOffset = CountU32(meshlets.triangles);
+        for (auto meshlet : job.meshlets)
+        {
+            meshlet.vertexOffset += vertexOffset;
+            meshlet.triangleOffset += triangleOffset;
+            meshlets.meshlets.push_back(meshlet);
+
+            range.vertexCount += meshlet.vertexCount;
+            range.triangleCount += meshlet.triangleCount;
+        }
+
+        for (uint32_t vIdx : job.vertices)
+        {
+            meshlets.vertices.push_back(vIdx + lod.baseVertex);
+        }
+        meshlets.triangles.insert(meshlets.triangles.end(), job.triangles.begin(), job.triangles.end());
+        meshlets.boundingSpheres.insert(meshlets.boundingSpheres.end(), job.boundingSpheres.begin(), job.boundingSpheres.end());
+        meshlets.normalCones.insert(meshlets.normalCones.end(), job.normalCones.begin(), job.normalCones.end());
+        meshlets.coneApexes.insert(meshlets.coneApexes.end(), job.coneApexes.begin(), job.coneApexes.end());
+
+        if (job.groupIndex != UINT32_MAX)
+        {
+            lod.groups[job.groupIndex] = range;
+        }
+
+        lod.meshlets.meshletCount += range.meshletCount;
+        lod.meshlets.vertexCount += range.vertexCount;
+        lod.meshlets.triangleCount += range.triangleCount;
+    }
+
+    *pMeshlets = std::move(meshlets);
+
+    return true;
+}
+
+bool BuildMeshlets(const TriMesh& mesh, const MeshletOptions& options, MeshletBuffers* pMeshlets)
+{
+    // Copies the mesh, fine for the sizes the samples use
+    return BuildMeshlets(std::vector<TriMesh>{mesh}, options, pMeshlets);
+}
+
+bool LoadOBJMeshletsCached(
+    const std::string&      path,
+    const std::string&      mtlBaseDir,
+    const TriMesh::Options& options,
+    const MeshletOptions&   meshletOptions,
+    TriMesh*                pMesh,
+    MeshletBuffers*         pMeshlets)
+{
+    if (IsNull(pMesh) || IsNull(pMeshlets))
+    {
+        return false;
+    }
+
+    TriMesh::MeshletData data = {};
+    data.maxVertices          = meshletOptions.maxVertices;
+    data.maxTriangles         = meshletOptions.maxTriangles;
+    data.coneWeight           = meshletOptions.coneWeight;
+
+    auto Build = [&meshletOptions](const TriMesh& mesh, TriMesh::MeshletData* pData) {
+        MeshletBuffers meshlets = {};
+        if (!BuildMeshlets(mesh, meshletOptions, &meshlets))
+        {
+            return;
+        }
+
+        pData->meshlets        = std::move(meshlets.meshlets);
+        pData->vertices        = std::move(meshlets.vertices);
+        pData->triangles       = std::move(meshlets.triangles);
+        pData->boundingSpheres = std::move(meshlets.boundingSpheres);
+        pData->normalCones     = std::move(meshlets.normalCones);
+        pData->coneApexes      = std::move(meshlets.coneApexes);
+        for (auto& group : meshlets.lods[0].groups)
+        {
+            pData->groupMeshletCounts.push_back(group.meshletCount);
+        }
+    };
+
+    if (!TriMesh::LoadOBJCached(path, mtlBaseDir, options, pMesh, &data, Build))
+    {
+        return false;
+    }
+
+    // Groups and meshlets have to match the mesh, a cache file with
+    // anything else is broken.
+    const uint32_t numMeshlets = CountU32(data.meshlets);
+
+    bool valid = (numMeshlets > 0) &&
+                 (data.boundingSpheres.size() == numMeshlets) &&
+                 (data.normalCones.size() == numMeshlets) &&
+                 (data.coneApexes.size() == numMeshlets) &&
+                 (data.groupMeshletCounts.size() == pMesh->GetNumGroups());
+
+    uint32_t numGroupedMeshlets = 0;
+    for (uint32_t count : data.groupMeshletCounts)
+    {
+        numGroupedMeshlets += count;
+    }
+    valid = valid && (numGroupedMeshlets <= numMeshlets);
+
+    for (uint32_t i = 0; valid && (i < numMeshlets); ++i)
+    {
+        const TriMesh::Meshlet& meshlet = data.meshlets[i];
+
+        valid = ((static_cast<size_t>(meshlet.vertexOffset) + meshlet.vertexCount) <= data.vertices.size()) &&
+                ((static_cast<size_t>(meshlet.triangleOffset) + meshlet.triangleCount) <= data.triangles.size());
+    }
+
+    if (!valid)
+    {
+        GREX_LOG_ERROR("invalid meshlets for " << path);
+        return false;
+    }
+
+    MeshletBuffers meshlets  = {};
+    meshlets.meshlets        = std::move(data.meshlets);
+    meshlets.vertices        = std::move(data.vertices);
+    meshlets.triangles       = std::move(data.triangles);
+    meshlets.boundingSpheres = std::move(data.boundingSpheres);
+    meshlets.normalCones     = std::move(data.normalCones);
+    meshlets.coneApexes      = std::move(data.coneApexes);
+
+    // Ranges aren't stored, only the number of meshlets in each group
+    auto MakeRange = [&meshlets](uint32_t firstMeshlet, uint32_t meshletCount) {
+        MeshletRange range = {};
+        range.firstMeshlet = firstMeshlet;
+        range.meshletCount = meshletCount;
+        for (uint32_t i = firstMeshlet; i < (firstMeshlet + meshletCount); ++i)
+        {
+            range.vertexCount += meshlets.meshlets[i].vertexCount;
+            range.triangleCount += meshlets.meshlets[i].triangleCount;
+        }
+        return range;
+    };
+
+    MeshletLOD lod = {};
+    lod.meshlets   = MakeRange(0, numMeshlets);
+
+    uint32_t firstMeshlet = 0;
+    for (uint32_t count : data.groupMeshletCounts)
+    {
+        lod.groups.push_back(MakeRange(firstMeshlet, count));
+        firstMeshlet += count;
+    }
+    meshlets.lods.push_back(std::move(lod));
+
+    *pMeshlets = std::move(meshlets);
+
+    return true;
+}
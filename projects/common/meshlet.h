@@ -0,0 +1,88 @@
+#pragma once
+
+#include "tri_mesh.h"
+
+// -------------------------------------------------------------------------------------------------
+// MeshletOptions
+// -------------------------------------------------------------------------------------------------
+struct MeshletOptions
+{
+    uint32_t maxVertices  = 64;   // meshopt requires <= 255
+    uint32_t maxTriangles = 124;  // meshopt requires <= 512, packed triangles require <= 256 vertices
+    float    coneWeight   = 0.0f; // Trades meshlet size for tighter normal cones, 0.25 is a good start for cone culling
+
+    // clang-format off
+    MeshletOptions& MaxVertices (uint32_t value) { maxVertices  = value; return *this; }
+    MeshletOptions& MaxTriangles(uint32_t value) { maxTriangles = value; return *this; }
+    MeshletOptions& ConeWeight  (float    value) { coneWeight   = value; return *this; }
+    // clang-format on
+};
+
+// -------------------------------------------------------------------------------------------------
+// MeshletRange
+// -------------------------------------------------------------------------------------------------
+struct MeshletRange
+{
+    uint32_t firstMeshlet  = 0;
+    uint32_t meshletCount  = 0;
+    uint32_t vertexCount   = 0; // Sum of the meshlets' vertex counts
+    uint32_t triangleCount = 0; // Sum of the meshlets' triangle counts
+};
+
+// -------------------------------------------------------------------------------------------------
+// MeshletLOD
+// -------------------------------------------------------------------------------------------------
+struct MeshletLOD
+{
+    uint32_t                  baseVertex = 0;  // Offset of this LOD's vertices in the combined vertex buffer
+    MeshletRange              meshlets   = {}; // All meshlets in this LOD
+    std::vector<MeshletRange> groups;          // Meshlets for each TriMesh group, same order as the mesh's groups
+};
+
+// -------------------------------------------------------------------------------------------------
+// MeshletBuffers
+// -------------------------------------------------------------------------------------------------
+//
+// Meshlets for one or more LODs in combined buffers that can be uploaded
+// as is:
+//   - meshlets[i].vertexOffset indexes vertices and meshlets[i].triangleOffset
+//     indexes triangles, so meshlet triangle offsets are in triangles
+//   - vertices already include the LOD's baseVertex, they index the vertex
+//     buffers of all LODs concatenated in LOD order
+//   - triangles are the 3 meshlet local vertex indices of a triangle packed
+//     into 8 bits each: bits 0-7, 8-15 and 16-23
+//   - boundingSpheres are xyz = center, w = radius
+//   - normalCones are xyz = cone axis, w = cone cutoff, see meshopt_Bounds
+//   - coneApexes are xyz = cone apex, w is unused
+//
+// Meshlets never span groups. Triangles that aren't in any group go at
+// the end of the LOD's meshlets and aren't in any of the group ranges.
+//
+struct MeshletBuffers
+{
+    std::vector<TriMesh::Meshlet> meshlets;
+    std::vector<uint32_t>         vertices;
+    std::vector<uint32_t>         triangles;
+    std::vector<glm::vec4>        boundingSpheres;
+    std::vector<glm::vec4>        normalCones;
+    std::vector<glm::vec4>        coneApexes;
+    std::vector<MeshletLOD>       lods;
+};
+
+// Builds meshlets for all of \b meshLODs into a single set of buffers,
+// every LOD and every group in each LOD is built in parallel.
+bool BuildMeshlets(const std::vector<TriMesh>& meshLODs, const MeshletOptions& options, MeshletBuffers* pMeshlets);
+
+// Single LOD version of the above
+bool BuildMeshlets(const TriMesh& mesh, const MeshletOptions& options, MeshletBuffers* pMeshlets);
+
+// Loads \b path with TriMesh::LoadOBJCached and builds single LOD meshlets
+// for it with BuildMeshlets. The meshlets are stored in the cache file
+// with the mesh, so a cache hit skips both parsing and building.
+bool LoadOBJMeshletsCached(
+    const std::string&      path,
+    const std::string&      mtlBaseDir,
+    const TriMesh::Options& options,
+    const MeshletOptions&   meshletOptions,
+    TriMesh*                pMesh,
+    MeshletBuffers*         pMeshlets);
@@ -158,6 +158,12 @@ MTL::PixelFormat ToMTLFormat(
         case GREX_FORMAT_R32G32B32A32_FLOAT:
             return MTL::PixelFormatRGBA32Float;
 
+        case GREX_FORMAT_R16G16B16A16_FLOAT:
+            return MTL::PixelFormatRGBA16Float;
+
+        case GREX_FORMAT_R9G9B9E5_UFLOAT:
+            return MTL::PixelFormatRGB9E5Float;
+
         case GREX_FORMAT_BC1_RGB:
             return MTL::PixelFormatBC1_RGBA;
 
@@ -312,7 +318,7 @@ NS::Error* CreateTexture(
         const void* mipData = reinterpret_cast<const char*>(pSrcData) + mipOffset.Offset;
 
         uint32_t mipRowStride = mipOffset.RowStride;
-        if (IsCompressed(format))
+        if (IsCompressed(format) && (mipRowStride == 0))
         {
             mipRowStride = mipWidth * 4;
             mipRowStride = (mipRowStride > 16) ? mipRowStride : 16;
@@ -352,6 +358,80 @@ NS::Error* CreateTexture(
         pResource);
 }
 
+NS::Error* CreateTexture(
+    MetalRenderer*                pRenderer,
+    uint32_t                      width,
+    uint32_t                      height,
+    MTL::PixelFormat              format,
+    uint32_t                      numArrayLayers,
+    const std::vector<MipOffset>& layerOffsets,
+    uint64_t                      srcSizeBytes,
+    const void*                   pSrcData,
+    MetalTexture*                 pResource)
+{
+    if ((numArrayLayers == 0) || layerOffsets.empty() || ((layerOffsets.size() % numArrayLayers) != 0))
+    {
+        assert(false && "layerOffsets must have the same number of levels for every layer");
+        return nullptr;
+    }
+
+    uint32_t numMipLevels = CountU32(layerOffsets) / numArrayLayers;
+    bool     isCube       = ((numArrayLayers % 6) == 0);
+
+    auto pTextureDesc = NS::TransferPtr(MTL::TextureDescriptor::alloc()->init());
+    pTextureDesc->setWidth(width);
+    pTextureDesc->setHeight(height);
+    pTextureDesc->setPixelFormat(format);
+    if (isCube)
+    {
+        // Metal counts cubes, not faces
+        pTextureDesc->setTextureType((numArrayLayers == 6) ? MTL::TextureTypeCube : MTL::TextureTypeCubeArray);
+        pTextureDesc->setArrayLength(numArrayLayers / 6);
+    }
+    else
+    {
+        pTextureDesc->setTextureType(MTL::TextureType2DArray);
+        pTextureDesc->setArrayLength(numArrayLayers);
+    }
+    pTextureDesc->setStorageMode(MTL::StorageModeShared);
+    pTextureDesc->setUsage(MTL::ResourceUsageSample | MTL::ResourceUsageRead);
+    pTextureDesc->setMipmapLevelCount(numMipLevels);
+
+    pResource->Texture = NS::TransferPtr(pRenderer->Device->newTexture(pTextureDesc.get()));
+
+    if (IsNull(pSrcData))
+    {
+        return nullptr;
+    }
+
+    uint32_t mipWidth  = width;
+    uint32_t mipHeight = height;
+    for (uint32_t level = 0; level < numMipLevels; ++level)
+    {
+        for (uint32_t layer = 0; layer < numArrayLayers; ++layer)
+        {
+            const auto& layerOffset = layerOffsets[layer * numMipLevels + level];
+            auto        region      = MTL::Region::Make2D(0, 0, mipWidth, mipHeight);
+            const void* layerData   = reinterpret_cast<const char*>(pSrcData) + layerOffset.Offset;
+
+            uint32_t rowStride = layerOffset.RowStride;
+            if (IsCompressed(format) && (rowStride == 0))
+            {
+                rowStride = mipWidth * 4;
+                rowStride = (rowStride > 16) ? rowStride : 16;
+            }
+
+            // Faces are slices of a cube texture in the same order
+            pResource->Texture->replaceRegion(region, level, layer, layerData, rowStride, 0);
+        }
+
+        mipWidth >>= 1;
+        mipHeight >>= 1;
+    }
+
+    return nullptr;
+}
+
 NS::Error* CreateRWTexture(
     MetalRenderer*   pRenderer,
     uint32_t         width,
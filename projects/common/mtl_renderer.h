@@ -99,6 +99,22 @@ NS::Error* CreateTexture(
     const void*      pSrcData,
     MetalTexture*    pResource);
 
+// Texture arrays, including cube maps and cube arrays: numArrayLayers is 6
+// per cube with faces in +X, -X, +Y, -Y, +Z, -Z order. A multiple of 6
+// layers creates a cube or cube array texture. layerOffsets has one
+// MipOffset per layer per level, layer major like texture files:
+// [layer * numMipLevels + level].
+NS::Error* CreateTexture(
+    MetalRenderer*                pRenderer,
+    uint32_t                      width,
+    uint32_t                      height,
+    MTL::PixelFormat              format,
+    uint32_t                      numArrayLayers,
+    const std::vector<MipOffset>& layerOffsets,
+    uint64_t                      srcSizeBytes,
+    const void*                   pSrcData,
+    MetalTexture*                 pResource);
+
 NS::Error* CreateRWTexture(
     MetalRenderer*   pRenderer,
     uint32_t         width,
@@ -0,0 +1,302 @@
+#include "texture_file.h"
+#include "config.h"
+
+#include <cstring>
+#include <fstream>
+
+// -------------------------------------------------------------------------------------------------
+// Layout
+// -------------------------------------------------------------------------------------------------
+namespace
+{
+
+uint32_t GetPixelSize(GREXFormat format)
+{
+    // clang-format off
+    switch (format)
+    {
+        default: break;
+        case GREX_FORMAT_R8_UNORM           : return 1;
+        case GREX_FORMAT_R8G8_UNORM         : return 2;
+        case GREX_FORMAT_R8G8B8A8_UNORM     : return 4;
+        case GREX_FORMAT_R32_FLOAT          : return 4;
+        case GREX_FORMAT_R32G32_FLOAT       : return 8;
+        case GREX_FORMAT_R32G32B32A32_FLOAT : return 16;
+        case GREX_FORMAT_R16G16B16A16_FLOAT : return 8;
+        case GREX_FORMAT_R9G9B9E5_UFLOAT    : return 4;
+    }
+    // clang-format on
+    return 0;
+}
+
+struct LevelLayout
+{
+    uint32_t rowSize = 0; // Bytes of a row of pixels or a row of 4x4 blocks
+    uint32_t numRows = 0;
+};
+
+LevelLayout GetLevelLayout(GREXFormat format, uint32_t width, uint32_t height, uint32_t level)
+{
+    const uint32_t levelWidth  = std::max<uint32_t>(width >> level, 1);
+    const uint32_t levelHeight = std::max<uint32_t>(height >> level, 1);
+
+    LevelLayout layout = {};
+    if (BCBlockSize(format) > 0)
+    {
+        layout.rowSize = ((levelWidth + 3) / 4) * BCBlockSize(format);
+        layout.numRows = (levelHeight + 3) / 4;
+    }
+    else
+    {
+        layout.rowSize = levelWidth * GetPixelSize(format);
+        layout.numRows = levelHeight;
+    }
+    return layout;
+}
+
+// Checks that every level follows the alignment rules and fits in the payload
+bool IsValidLayout(
+    GREXFormat                    format,
+    uint32_t                      width,
+    uint32_t                      height,
+    uint32_t                      numLayers,
+    const std::vector<MipOffset>& mipOffsets,
+    uint64_t                      dataSize)
+{
+    if ((numLayers == 0) || mipOffsets.empty() || ((mipOffsets.size() % numLayers) != 0))
+    {
+        return false;
+    }
+
+    const uint32_t numLevels = CountU32(mipOffsets) / numLayers;
+    for (uint32_t i = 0; i < CountU32(mipOffsets); ++i)
+    {
+        const MipOffset&  mipOffset = mipOffsets[i];
+        const LevelLayout layout    = GetLevelLayout(format, width, height, i % numLevels);
+
+        if (((mipOffset.Offset % TEXTURE_FILE_LEVEL_ALIGNMENT) != 0) || ((mipOffset.RowStride % TEXTURE_FILE_ROW_ALIGNMENT) != 0))
+        {
+            return false;
+        }
+        if (mipOffset.RowStride < layout.rowSize)
+        {
+            return false;
+        }
+
+        const uint64_t levelEnd = static_cast<uint64_t>(mipOffset.Offset) +
+                                  (static_cast<uint64_t>(mipOffset.RowStride) * (layout.numRows - 1)) +
+                                  layout.rowSize;
+        if (levelEnd > dataSize)
+        {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+// Copies every level of a mipmap to rows and levels with the file's alignments
+template <typename MipmapT>
+bool SaveMipmap(const std::filesystem::path& path, GREXFormat format, const MipmapT& mipmap)
+{
+    const uint32_t numLevels = mipmap.GetNumLevels();
+    if (numLevels == 0)
+    {
+        return false;
+    }
+
+    std::vector<MipOffset> mipOffsets;
+    uint32_t               dataSize = 0;
+    for (uint32_t level = 0; level < numLevels; ++level)
+    {
+        const LevelLayout layout = GetLevelLayout(format, mipmap.GetWidth(0), mipmap.GetHeight(0), level);
+
+        MipOffset mipOffset = {};
+        mipOffset.Offset    = Align<uint32_t>(dataSize, TEXTURE_FILE_LEVEL_ALIGNMENT);
+        mipOffset.RowStride = Align<uint32_t>(layout.rowSize, TEXTURE_FILE_ROW_ALIGNMENT);
+        mipOffsets.push_back(mipOffset);
+
+        dataSize = mipOffset.Offset + (mipOffset.RowStride * layout.numRows);
+    }
+
+    std::vector<char> data(dataSize, 0);
+    for (uint32_t level = 0; level < numLevels; ++level)
+    {
+        const auto&    mip     = mipmap.GetMip(level);
+        const uint32_t rowSize = mip.GetWidth() * mip.GetPixelStride();
+        for (uint32_t y = 0; y < mip.GetHeight(); ++y)
+        {
+            const char* pSrcRow = reinterpret_cast<const char*>(mip.GetPixels(0, y));
+            char*       pDstRow = data.data() + mipOffsets[level].Offset + (y * mipOffsets[level].RowStride);
+            memcpy(pDstRow, pSrcRow, rowSize);
+        }
+    }
+
+    return SaveTexture(path, format, mipmap.GetWidth(0), mipmap.GetHeight(0), 1, mipOffsets, data.size(), data.data());
+}
+
+} // namespace
+
+// -------------------------------------------------------------------------------------------------
+// Texture file functions
+// -------------------------------------------------------------------------------------------------
+bool IsTextureFileFormat(GREXFormat format)
+{
+    return (GetPixelSize(format) > 0) || (BCBlockSize(format) > 0);
+}
+
+bool SaveTexture(
+    const std::filesystem::path&  path,
+    GREXFormat                    format,
+    uint32_t                      width,
+    uint32_t                      height,
+    uint32_t                      numLayers,
+    const std::vector<MipOffset>& mipOffsets,
+    size_t                        dataSize,
+    const void*                   pData)
+{
+    if (!IsTextureFileFormat(format) || (width == 0) || (height == 0) || IsNull(pData))
+    {
+        GREX_LOG_ERROR("invalid texture for " << path);
+        return false;
+    }
+    if (!IsValidLayout(format, width, height, numLayers, mipOffsets, dataSize))
+    {
+        GREX_LOG_ERROR("texture data isn't laid out with the texture file alignments: " << path);
+        return false;
+    }
+
+    TextureFileHeader header = {};
+    header.format            = format;
+    header.width             = width;
+    header.height            = height;
+    header.numLevels         = CountU32(mipOffsets) / numLayers;
+    header.numLayers         = numLayers;
+    header.mipOffsetsOffset  = sizeof(TextureFileHeader);
+    header.dataOffset        = Align<uint64_t>(header.mipOffsetsOffset + (mipOffsets.size() * sizeof(MipOffset)), TEXTURE_FILE_LEVEL_ALIGNMENT);
+    header.dataSize          = dataSize;
+
+    std::vector<char> prefix(static_cast<size_t>(header.dataOffset), 0);
+    memcpy(prefix.data(), &header, sizeof(header));
+    memcpy(prefix.data() + header.mipOffsetsOffset, mipOffsets.data(), mipOffsets.size() * sizeof(MipOffset));
+
+    // Write to a temporary file first so readers never see a partial file
+    std::filesystem::path tmpPath = path;
+    tmpPath += ".tmp";
+    {
+        std::ofstream os(tmpPath, std::ios::binary);
+        if (!os.is_open())
+        {
+            GREX_LOG_ERROR("failed to open " << tmpPath);
+            return false;
+        }
+
+        os.write(prefix.data(), static_cast<std::streamsize>(prefix.size()));
+        os.write(static_cast<const char*>(pData), static_cast<std::streamsize>(dataSize));
+        if (!os.good())
+        {
+            return false;
+        }
+    }
+
+    std::error_code ec;
+    std::filesystem::rename(tmpPath, path, ec);
+    if (ec)
+    {
+        std::filesystem::remove(tmpPath, ec);
+        return false;
+    }
+
+    return true;
+}
+
+bool SaveTexture(const std::filesystem::path& path, const BCTexture& texture)
+{
+    return SaveTexture(
+        path,
+        texture.format,
+        texture.width,
+        texture.height,
+        1,
+        texture.mipOffsets,
+        texture.GetSizeInBytes(),
+        texture.GetData());
+}
+
+bool SaveTexture(const std::filesystem::path& path, const MipmapRGBA8u& mipmap)
+{
+    return SaveMipmap(path, GREX_FORMAT_R8G8B8A8_UNORM, mipmap);
+}
+
+bool SaveTexture(const std::filesystem::path& path, const MipmapRGBA16f& mipmap)
+{
+    return SaveMipmap(path, GREX_FORMAT_R16G16B16A16_FLOAT, mipmap);
+}
+
+bool SaveTexture(const std::filesystem::path& path, const MipmapRGBA32f& mipmap)
+{
+    return SaveMipmap(path, GREX_FORMAT_R32G32B32A32_FLOAT, mipmap);
+}
+
+bool SaveTexture(const std::filesystem::path& path, const MipmapRGB9E5& mipmap)
+{
+    return SaveMipmap(path, GREX_FORMAT_R9G9B9E5_UFLOAT, mipmap);
+}
+
+bool LoadTexture(const std::filesystem::path& path, MappedTexture* pTexture)
+{
+    if (IsNull(pTexture))
+    {
+        return false;
+    }
+
+    MappedFile& file = pTexture->file;
+    if (!file.Open(path.string()) || (file.GetSize() < sizeof(TextureFileHeader)))
+    {
+        return false;
+    }
+
+    TextureFileHeader header = {};
+    memcpy(&header, file.GetData(), sizeof(header));
+
+    if ((header.magic != TEXTURE_FILE_MAGIC) || (header.version != TEXTURE_FILE_VERSION))
+    {
+        GREX_LOG_ERROR("not a texture file or wrong version: " << path);
+        file.Close();
+        return false;
+    }
+
+    const GREXFormat format        = static_cast<GREXFormat>(header.format);
+    const uint64_t   numMipOffsets = static_cast<uint64_t>(header.numLevels) * header.numLayers;
+    const uint64_t   tableSize     = numMipOffsets * sizeof(MipOffset);
+    const bool       validTable    = (header.mipOffsetsOffset <= file.GetSize()) && (tableSize <= (file.GetSize() - header.mipOffsetsOffset));
+    const bool       validData     = ((header.dataOffset % TEXTURE_FILE_LEVEL_ALIGNMENT) == 0) &&
+                           (header.dataOffset <= file.GetSize()) &&
+                           (header.dataSize <= (file.GetSize() - header.dataOffset));
+    if (!IsTextureFileFormat(format) || (header.width == 0) || (header.height == 0) || (numMipOffsets == 0) || !validTable || !validData)
+    {
+        GREX_LOG_ERROR("invalid or truncated texture file " << path);
+        file.Close();
+        return false;
+    }
+
+    std::vector<MipOffset> mipOffsets(static_cast<size_t>(numMipOffsets));
+    memcpy(mipOffsets.data(), file.GetData() + header.mipOffsetsOffset, static_cast<size_t>(tableSize));
+
+    if (!IsValidLayout(format, header.width, header.height, header.numLayers, mipOffsets, header.dataSize))
+    {
+        GREX_LOG_ERROR("invalid level layout in texture file " << path);
+        file.Close();
+        return false;
+    }
+
+    pTexture->format     = format;
+    pTexture->width      = header.width;
+    pTexture->height     = header.height;
+    pTexture->numLayers  = header.numLayers;
+    pTexture->mipOffsets = std::move(mipOffsets);
+    pTexture->pData      = file.GetData() + header.dataOffset;
+    pTexture->dataSize   = static_cast<size_t>(header.dataSize);
+
+    return true;
+}
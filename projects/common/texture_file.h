@@ -0,0 +1,98 @@
+#pragma once
+
+#include "bc_encoder.h"
+#include "mapped_file.h"
+
+// -------------------------------------------------------------------------------------------------
+// Texture file
+// -------------------------------------------------------------------------------------------------
+//
+// Pre-baked texture with all its levels, see projects/misc/texture_convert.
+// A file is a TextureFileHeader followed by the MipOffset table and the
+// payload. MipOffset::Offset is relative to the start of the payload.
+//
+// Every row of the payload starts at a multiple of
+// TEXTURE_FILE_ROW_ALIGNMENT and every level at a multiple of
+// TEXTURE_FILE_LEVEL_ALIGNMENT. These are the D3D12 pitch and placement
+// alignments, Vulkan and Metal take the same layout through
+// MipOffset::RowStride. So the payload of a mapped file can be passed to
+// CreateTexture on any API without touching it.
+//
+// Layers are stored one after the other with all their levels. The
+// MipOffset table has numLayers * numLevels entries in the same order.
+//
+static const uint32_t TEXTURE_FILE_MAGIC           = 0x58545847; // 'GXTX'
+static const uint32_t TEXTURE_FILE_VERSION         = 1;
+static const uint32_t TEXTURE_FILE_ROW_ALIGNMENT   = 256; // D3D12_TEXTURE_DATA_PITCH_ALIGNMENT
+static const uint32_t TEXTURE_FILE_LEVEL_ALIGNMENT = 512; // D3D12_TEXTURE_DATA_PLACEMENT_ALIGNMENT
+
+struct TextureFileHeader
+{
+    uint32_t magic            = TEXTURE_FILE_MAGIC;
+    uint32_t version          = TEXTURE_FILE_VERSION;
+    uint32_t format           = GREX_FORMAT_UNKNOWN; // GREXFormat
+    uint32_t width            = 0;
+    uint32_t height           = 0;
+    uint32_t numLevels        = 0;
+    uint32_t numLayers        = 0;
+    uint32_t reserved         = 0;
+    uint64_t mipOffsetsOffset = 0; // From the start of the file
+    uint64_t dataOffset       = 0; // From the start of the file, multiple of TEXTURE_FILE_LEVEL_ALIGNMENT
+    uint64_t dataSize         = 0;
+};
+
+// -------------------------------------------------------------------------------------------------
+// MappedTexture
+// -------------------------------------------------------------------------------------------------
+//
+// Texture file loaded by LoadTexture. GetData() points into the mapping,
+// which stays valid for as long as the object does. Has the same members
+// as BCTexture so either one can be handed to CreateTexture the same way.
+//
+struct MappedTexture
+{
+    GREXFormat             format    = GREX_FORMAT_UNKNOWN;
+    uint32_t               width     = 0;
+    uint32_t               height    = 0;
+    uint32_t               numLayers = 0;
+    std::vector<MipOffset> mipOffsets; // All layers, numLayers * GetNumLevels() entries
+    MappedFile             file;
+    const char*            pData    = nullptr;
+    size_t                 dataSize = 0;
+
+    uint32_t    GetNumLevels() const { return (numLayers > 0) ? (CountU32(mipOffsets) / numLayers) : 0; }
+    size_t      GetSizeInBytes() const { return dataSize; }
+    const char* GetData() const { return pData; }
+};
+
+// Uncompressed formats supported by texture files, BC formats are the
+// ones BCBlockSize() supports
+bool IsTextureFileFormat(GREXFormat format);
+
+// Writes a texture file from data that's already laid out per the rules
+// above. Fails if it isn't.
+bool SaveTexture(
+    const std::filesystem::path&  path,
+    GREXFormat                    format,
+    uint32_t                      width,
+    uint32_t                      height,
+    uint32_t                      numLayers,
+    const std::vector<MipOffset>& mipOffsets,
+    size_t                        dataSize,
+    const void*                   pData);
+
+// BC version, \b texture must have been encoded with the
+// TEXTURE_FILE_ROW_ALIGNMENT and TEXTURE_FILE_LEVEL_ALIGNMENT alignments.
+bool SaveTexture(const std::filesystem::path& path, const BCTexture& texture);
+
+// Uncompressed versions, levels are repacked to the file's alignments.
+// Written as GREX_FORMAT_R8G8B8A8_UNORM, GREX_FORMAT_R16G16B16A16_FLOAT,
+// GREX_FORMAT_R32G32B32A32_FLOAT and GREX_FORMAT_R9G9B9E5_UFLOAT.
+bool SaveTexture(const std::filesystem::path& path, const MipmapRGBA8u& mipmap);
+bool SaveTexture(const std::filesystem::path& path, const MipmapRGBA16f& mipmap);
+bool SaveTexture(const std::filesystem::path& path, const MipmapRGBA32f& mipmap);
+bool SaveTexture(const std::filesystem::path& path, const MipmapRGB9E5& mipmap);
+
+// Maps \b path and validates the header and layout, nothing is decoded
+// or copied.
+bool LoadTexture(const std::filesystem::path& path, MappedTexture* pTexture);
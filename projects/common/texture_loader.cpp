@@ -0,0 +1,198 @@
+#include "texture_loader.h"
+#include "window.h"
+
+// -------------------------------------------------------------------------------------------------
+// Loading
+// -------------------------------------------------------------------------------------------------
+namespace
+{
+
+bool LoadBaked(const TextureLoadRequest& request, LoadedTexture* pResult)
+{
+    auto bakedPath = GetAssetPath(std::filesystem::path(request.path).replace_extension(".gxt"));
+    if (bakedPath.empty())
+    {
+        return false;
+    }
+
+    auto pMapped = std::make_unique<MappedTexture>();
+    if (!LoadTexture(bakedPath, pMapped.get()))
+    {
+        return false;
+    }
+
+    pResult->format     = pMapped->format;
+    pResult->width      = pMapped->width;
+    pResult->height     = pMapped->height;
+    pResult->mipOffsets = pMapped->mipOffsets;
+    pResult->pMapped    = std::move(pMapped);
+
+    return true;
+}
+
+bool LoadAndEncode(const TextureLoadRequest& request, LoadedTexture* pResult)
+{
+    auto bitmap = LoadImage8u(request.path);
+    if (bitmap.Empty())
+    {
+        GREX_LOG_ERROR("failed to load: " << request.path);
+        return false;
+    }
+
+    MipmapRGBA8u mipmap = MipmapRGBA8u(bitmap, request.mipOptions);
+
+    if (request.encodeOptions.format == GREX_FORMAT_R8G8B8A8_UNORM)
+    {
+        const char* pPixels = reinterpret_cast<const char*>(mipmap.GetPixels());
+
+        pResult->format     = GREX_FORMAT_R8G8B8A8_UNORM;
+        pResult->width      = mipmap.GetWidth(0);
+        pResult->height     = mipmap.GetHeight(0);
+        pResult->mipOffsets = mipmap.GetMipOffsets();
+        pResult->data.assign(pPixels, pPixels + mipmap.GetSizeInBytes());
+        return true;
+    }
+
+    BCTexture texture = {};
+    if (!BCEncode(mipmap, request.encodeOptions, &texture))
+    {
+        GREX_LOG_ERROR("failed to compress: " << request.path);
+        return false;
+    }
+
+    pResult->format     = texture.format;
+    pResult->width      = texture.width;
+    pResult->height     = texture.height;
+    pResult->mipOffsets = std::move(texture.mipOffsets);
+    pResult->data       = std::move(texture.data);
+
+    return true;
+}
+
+} // namespace
+
+// -------------------------------------------------------------------------------------------------
+// TextureLoader
+// -------------------------------------------------------------------------------------------------
+TextureLoader::TextureLoader(uint32_t numThreads)
+{
+    if (numThreads == 0)
+    {
+        numThreads = std::max<uint32_t>(std::thread::hardware_concurrency(), 2) - 1;
+    }
+
+    for (uint32_t i = 0; i < numThreads; ++i)
+    {
+        mWorkers.emplace_back(&TextureLoader::WorkerMain, this);
+    }
+}
+
+TextureLoader::~TextureLoader()
+{
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        mStop = true;
+        mQueue.clear();
+    }
+    mWakeWorkers.notify_all();
+
+    for (auto& worker : mWorkers)
+    {
+        worker.join();
+    }
+}
+
+void TextureLoader::Submit(const TextureLoadRequest& request)
+{
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+
+        QueuedRequest queued = {};
+        queued.request       = request;
+        queued.sequence      = mNextSequence++;
+        mQueue.push_back(queued);
+    }
+    mWakeWorkers.notify_one();
+}
+
+void TextureLoader::Prioritize(uint32_t group)
+{
+    std::lock_guard<std::mutex> lock(mMutex);
+    mGroupPriorities[group] = mNextPriority++;
+}
+
+std::vector<LoadedTexture> TextureLoader::TakeCompleted(uint32_t maxCount)
+{
+    std::lock_guard<std::mutex> lock(mMutex);
+
+    const size_t count = std::min<size_t>(mCompleted.size(), maxCount);
+
+    std::vector<LoadedTexture> completed;
+    completed.reserve(count);
+    for (size_t i = 0; i < count; ++i)
+    {
+        completed.push_back(std::move(mCompleted[i]));
+    }
+    mCompleted.erase(mCompleted.begin(), mCompleted.begin() + count);
+
+    return completed;
+}
+
+uint32_t TextureLoader::GetNumPending() const
+{
+    std::lock_guard<std::mutex> lock(mMutex);
+    return CountU32(mQueue) + mNumInProgress + CountU32(mCompleted);
+}
+
+void TextureLoader::WorkerMain()
+{
+    // Textures are spread across the workers, not the levels of a texture
+    gParallelForSerial = true;
+
+    while (true)
+    {
+        TextureLoadRequest request = {};
+        {
+            std::unique_lock<std::mutex> lock(mMutex);
+            mWakeWorkers.wait(lock, [this] { return mStop || !mQueue.empty(); });
+            if (mStop)
+            {
+                return;
+            }
+
+            // Highest group priority first, then oldest. The queue is only
+            // as long as the number of textures in a scene so a scan is fine.
+            auto GetPriority = [this](const QueuedRequest& queued) -> uint64_t {
+                auto it = mGroupPriorities.find(queued.request.group);
+                return (it != mGroupPriorities.end()) ? it->second : 0;
+            };
+
+            auto best = mQueue.begin();
+            for (auto it = mQueue.begin() + 1; it != mQueue.end(); ++it)
+            {
+                const uint64_t priority     = GetPriority(*it);
+                const uint64_t bestPriority = GetPriority(*best);
+                if ((priority > bestPriority) || ((priority == bestPriority) && (it->sequence < best->sequence)))
+                {
+                    best = it;
+                }
+            }
+
+            request = std::move(best->request);
+            mQueue.erase(best);
+            ++mNumInProgress;
+        }
+
+        LoadedTexture result = {};
+        result.path          = request.path;
+        result.group         = request.group;
+        result.slot          = request.slot;
+        result.loaded        = LoadBaked(request, &result) || LoadAndEncode(request, &result);
+
+        {
+            std::lock_guard<std::mutex> lock(mMutex);
+            mCompleted.push_back(std::move(result));
+            --mNumInProgress;
+        }
+    }
+}
@@ -0,0 +1,131 @@
+#pragma once
+
+#include "bc_encoder.h"
+#include "texture_file.h"
+
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+
+// -------------------------------------------------------------------------------------------------
+// TextureLoadRequest
+// -------------------------------------------------------------------------------------------------
+//
+// \b path is an asset sub path, same as LoadImage8u. If a texture file
+// baked by texture_convert sits next to it with a .gxt extension it's
+// mapped instead and the options are ignored.
+//
+// Requests with the same \b group are prioritized together, e.g. all the
+// textures of a material. \b slot is passed back untouched so the caller
+// knows where the texture goes.
+//
+// Set encodeOptions.format to GREX_FORMAT_R8G8B8A8_UNORM to skip BC
+// compression.
+//
+struct TextureLoadRequest
+{
+    std::filesystem::path path          = "";
+    uint32_t              group         = 0;
+    uint32_t              slot          = 0;
+    MipmapOptions         mipOptions    = {};
+    BCEncodeOptions       encodeOptions = BCEncodeOptions().Quality(BC_QUALITY_FAST);
+
+    // clang-format off
+    TextureLoadRequest& Path         (const std::filesystem::path& value) { path          = value; return *this; }
+    TextureLoadRequest& Group        (uint32_t                     value) { group         = value; return *this; }
+    TextureLoadRequest& Slot         (uint32_t                     value) { slot          = value; return *this; }
+    TextureLoadRequest& MipOptions   (const MipmapOptions&         value) { mipOptions    = value; return *this; }
+    TextureLoadRequest& EncodeOptions(const BCEncodeOptions&       value) { encodeOptions = value; return *this; }
+    // clang-format on
+};
+
+// -------------------------------------------------------------------------------------------------
+// LoadedTexture
+// -------------------------------------------------------------------------------------------------
+//
+// Finished request. Has the same members as BCTexture and MappedTexture so
+// it can be handed to CreateTexture the same way. \b loaded is false if
+// the image couldn't be loaded or encoded, the rest is empty then.
+//
+struct LoadedTexture
+{
+    std::filesystem::path  path   = "";
+    uint32_t               group  = 0;
+    uint32_t               slot   = 0;
+    bool                   loaded = false;
+    GREXFormat             format = GREX_FORMAT_UNKNOWN;
+    uint32_t               width  = 0;
+    uint32_t               height = 0;
+    std::vector<MipOffset> mipOffsets;
+
+    // Only one of these holds the levels
+    std::vector<char>              data;
+    std::unique_ptr<MappedTexture> pMapped;
+
+    uint32_t    GetNumLevels() const { return CountU32(mipOffsets); }
+    size_t      GetSizeInBytes() const { return pMapped ? pMapped->GetSizeInBytes() : data.size(); }
+    const char* GetData() const { return pMapped ? pMapped->GetData() : data.data(); }
+};
+
+// -------------------------------------------------------------------------------------------------
+// TextureLoader
+// -------------------------------------------------------------------------------------------------
+//
+// Loads, mips and compresses textures on a pool of worker threads so an
+// app can start rendering with placeholders while they come in. GPU
+// resources are never touched here: the render thread collects finished
+// textures with TakeCompleted() and uploads them itself.
+//
+// Queued requests are served group by group, the most recently
+// prioritized group first and otherwise in submission order. Each worker
+// encodes one texture at a time, ParallelFor calls it makes run serially
+// so the pool isn't oversubscribed.
+//
+class TextureLoader
+{
+public:
+    // 0 uses one thread less than there are hardware threads, at least 1
+    TextureLoader(uint32_t numThreads = 0);
+
+    // Drops requests that haven't started and waits for the rest
+    ~TextureLoader();
+
+    TextureLoader(const TextureLoader&)            = delete;
+    TextureLoader& operator=(const TextureLoader&) = delete;
+
+    void Submit(const TextureLoadRequest& request);
+
+    // Moves the queued requests of \b group ahead of everything else,
+    // requests that already started aren't affected
+    void Prioritize(uint32_t group);
+
+    // Returns up to \b maxCount finished textures in the order they
+    // finished
+    std::vector<LoadedTexture> TakeCompleted(uint32_t maxCount = UINT32_MAX);
+
+    // Requests that are queued, in progress or finished but not taken yet
+    uint32_t GetNumPending() const;
+
+private:
+    struct QueuedRequest
+    {
+        TextureLoadRequest request;
+        uint64_t           sequence = 0;
+    };
+
+    void WorkerMain();
+
+private:
+    mutable std::mutex                     mMutex;
+    std::condition_variable                mWakeWorkers;
+    std::vector<std::thread>               mWorkers;
+    std::vector<QueuedRequest>             mQueue;
+    std::vector<LoadedTexture>             mCompleted;
+    std::unordered_map<uint32_t, uint64_t> mGroupPriorities; // Higher is served first, missing is 0
+    uint64_t                               mNextSequence  = 0;
+    uint64_t                               mNextPriority  = 1;
+    uint32_t                               mNumInProgress = 0;
+    bool                                   mStop          = false;
+};
@@ -0,0 +1,119 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+//
+// Splits a width x height image into tiles and hands them out to threads
+// from an atomic counter. Tiles are numbered row by row and their layout
+// only depends on the image and tile size, so per tile state derived from
+// Tile::index (e.g. a random stream) gives the same result for any number
+// of threads in any order.
+//
+// Progress is printed by whichever thread finishes the tile that crosses
+// the next 5% step, no lock is taken.
+//
+class TileScheduler
+{
+public:
+    struct Tile
+    {
+        uint32_t index;
+        uint32_t x;
+        uint32_t y;
+        uint32_t width;
+        uint32_t height;
+    };
+
+    TileScheduler(uint32_t width, uint32_t height, uint32_t tileSize = 32)
+        : mWidth(width),
+          mHeight(height),
+          mTileSize(std::max(tileSize, 1u))
+    {
+        mNumTilesX = (mWidth + mTileSize - 1) / mTileSize;
+        mNumTilesY = (mHeight + mTileSize - 1) / mTileSize;
+    }
+
+    uint32_t GetNumTiles() const
+    {
+        return mNumTilesX * mNumTilesY;
+    }
+
+    // Returns false once all tiles have been handed out
+    bool NextTile(Tile* pTile)
+    {
+        uint32_t index = mNextTile++;
+        if (index >= GetNumTiles())
+        {
+            return false;
+        }
+
+        pTile->index  = index;
+        pTile->x      = (index % mNumTilesX) * mTileSize;
+        pTile->y      = (index / mNumTilesX) * mTileSize;
+        pTile->width  = std::min(mTileSize, mWidth - pTile->x);
+        pTile->height = std::min(mTileSize, mHeight - pTile->y);
+        return true;
+    }
+
+    // Calls fn(const Tile&) for every tile on numThreads threads and waits
+    // for them. Progress is labeled with label, nothing is printed if it's
+    // empty.
+    template <typename Fn>
+    void Run(uint32_t numThreads, const std::string& label, Fn fn)
+    {
+        auto ProcessTiles = [&]() {
+            Tile tile = {};
+            while (NextTile(&tile))
+            {
+                fn(tile);
+                ReportProgress(label, ++mNumCompleted);
+            }
+        };
+
+        std::vector<std::unique_ptr<std::thread>> threads;
+        for (uint32_t i = 0; i < std::max(numThreads, 1u); ++i)
+        {
+            threads.push_back(std::make_unique<std::thread>(ProcessTiles));
+        }
+        for (auto& thread : threads)
+        {
+            thread->join();
+        }
+    }
+
+private:
+    void ReportProgress(const std::string& label, uint32_t numCompleted) const
+    {
+        const uint32_t kNumSteps = 20;
+
+        uint32_t numTiles = GetNumTiles();
+        uint32_t prevStep = ((numCompleted - 1) * kNumSteps) / numTiles;
+        uint32_t step     = (numCompleted * kNumSteps) / numTiles;
+        if (label.empty() || (step == prevStep))
+        {
+            return;
+        }
+
+        // One write so lines from different threads don't interleave
+        std::stringstream ss;
+        ss << label << ": " << std::fixed << std::setw(6) << std::setprecision(2) << (numCompleted * 100.0f / numTiles) << "% complete\n";
+        std::cout << ss.str() << std::flush;
+    }
+
+    uint32_t              mWidth        = 0;
+    uint32_t              mHeight       = 0;
+    uint32_t              mTileSize     = 0;
+    uint32_t              mNumTilesX    = 0;
+    uint32_t              mNumTilesY    = 0;
+    std::atomic<uint32_t> mNextTile     = 0;
+    std::atomic<uint32_t> mNumCompleted = 0;
+};
@@ -3,6 +3,7 @@
 #endif
 
 #include "tri_mesh.h"
+#include "mapped_file.h"
 
 #define TINYOBJLOADER_IMPLEMENTATION
 #include "tiny_obj_loader.h"
@@ -11,6 +12,10 @@
 #include "mikktspace.h"
 #endif
 
+#if defined(TRIMESH_USE_MESHOPTIMIZER)
+#include "meshoptimizer.h"
+#endif
+
 #define GLM_ENABLE_EXPERIMENTAL
 #include <glm/gtc/constants.hpp>
 #include <glm/gtc/matrix_transform.hpp>
@@ -19,11 +24,16 @@
 #include <glm/gtx/transform.hpp>
 #include <glm/gtx/string_cast.hpp>
 
+#include <charconv>
+#include <cstring>
 #include <filesystem>
 #include <fstream>
 #include <iomanip>
 #include <map>
+#include <numeric>
+#include <random>
 #include <sstream>
+#include <string_view>
 #include <unordered_map>
 
 #include "config.h"
@@ -85,6 +95,20 @@ static inline glm::vec3 SphericalTangent(float theta, float phi)
 #if defined(TRIMESH_USE_MIKKTSPACE)
 struct CalculateTangents
 {
+    //
+    // Faces that MikkTSpace sees. For the whole mesh pTriangles is null and
+    // face i is triangle i. For a chunk pTriangles lists the chunk's
+    // triangles and only vertices that belong to the chunk get written.
+    //
+    struct Context
+    {
+        TriMesh*        pMesh         = nullptr;
+        const uint32_t* pTriangles    = nullptr;
+        uint32_t        numTriangles  = 0;
+        const uint32_t* pVertexChunks = nullptr;
+        uint32_t        chunkIndex    = 0;
+    };
+
     static int  getNumFaces(const SMikkTSpaceContext* pContext);
     static int  getNumVerticesOfFace(const SMikkTSpaceContext* pContext, const int iFace);
     static void getPosition(const SMikkTSpaceContext* pContext, float fvPosOut[], const int iFace, const int iVert);
@@ -92,7 +116,19 @@ struct CalculateTangents
     static void getTexCoord(const SMikkTSpaceContext* pContext, float fvTexcOut[], const int iFace, const int iVert);
     static void setTSpaceBasic(const SMikkTSpaceContext* pContext, const float fvTangent[], const float fSign, const int iFace, const int iVert);
 
-    static void Calculate(TriMesh* pMesh)
+    static uint32_t GetVertexIndex(const SMikkTSpaceContext* pContext, const int iFace, const int iVert)
+    {
+        const Context* pUserData = static_cast<const Context*>(pContext->m_pUserData);
+        assert((pUserData != nullptr) && (pUserData->pMesh != nullptr) && "pMesh is NULL!");
+
+        uint32_t triIdx = IsNull(pUserData->pTriangles) ? static_cast<uint32_t>(iFace) : pUserData->pTriangles[iFace];
+
+        const TriMesh::Triangle& tri            = pUserData->pMesh->GetTriangles()[triIdx];
+        const uint32_t*          pVertexIndices = reinterpret_cast<const uint32_t*>(&tri);
+        return pVertexIndices[iVert];
+    }
+
+    static void Run(Context& userData)
     {
         SMikkTSpaceInterface callbacks   = {};
         callbacks.m_getNumFaces          = CalculateTangents::getNumFaces;
@@ -104,18 +140,250 @@ struct CalculateTangents
 
         SMikkTSpaceContext context = {};
         context.m_pInterface       = &callbacks;
-        context.m_pUserData        = pMesh;
+        context.m_pUserData        = &userData;
 
         genTangSpace(&context, 180.0f);
     }
+
+    static void Calculate(TriMesh* pMesh)
+    {
+        Context userData      = {};
+        userData.pMesh        = pMesh;
+        userData.numTriangles = pMesh->GetNumTriangles();
+
+        Run(userData);
+    }
+
+    //
+    // MikkTSpace welds vertices whose position, normal and tex coord are
+    // bitwise equal (apart from -0) and a corner's tangent only depends on
+    // the faces around its welded vertex. So the mesh is cut into chunks
+    // and each chunk runs MikkTSpace on the faces around the vertices it
+    // owns, in the original face order, and only writes those vertices.
+    // Vertices on chunk borders get the same faces in the same order as
+    // the single threaded path and end up with identical tangents.
+    //
+    // Triangles are put in chunks by group first and then by the Morton
+    // code of their centroid, so large groups are cut into compact pieces
+    // with short borders.
+    //
+    static void CalculateParallel(TriMesh* pMesh, uint32_t trianglesPerChunk)
+    {
+        if (!pMesh->GetOptions().enableTangents)
+        {
+            return;
+        }
+
+        // MikkTSpace needs positions, normals and tex coords for every vertex
+        const uint32_t numVertices = pMesh->GetNumVertices();
+        if ((pMesh->GetNormals().size() != numVertices) || (pMesh->GetTexCoords().size() != numVertices))
+        {
+            GREX_LOG_WARN("tangents need normals and tex coords, skipping tangent calculation");
+            return;
+        }
+
+        const uint32_t numTriangles = pMesh->GetNumTriangles();
+        trianglesPerChunk           = std::max<uint32_t>(trianglesPerChunk, 1);
+        const uint32_t numChunks    = (numTriangles / trianglesPerChunk) + ((numTriangles % trianglesPerChunk) ? 1 : 0);
+        if (numChunks <= 1)
+        {
+            Calculate(pMesh);
+            return;
+        }
+
+        const auto& positions = pMesh->GetPositions();
+        const auto& normals   = pMesh->GetNormals();
+        const auto& texCoords = pMesh->GetTexCoords();
+        const auto& triangles = pMesh->GetTriangles();
+
+        // Welded vertex for each vertex, same equality as MikkTSpace
+        struct WeldKey
+        {
+            float values[8] = {};
+
+            bool operator==(const WeldKey& rhs) const
+            {
+                return std::equal(std::begin(values), std::end(values), std::begin(rhs.values));
+            }
+        };
+
+        struct WeldKeyHash
+        {
+            size_t operator()(const WeldKey& key) const
+            {
+                uint64_t h = 0;
+                for (float value : key.values)
+                {
+                    uint32_t bits = 0;
+                    std::memcpy(&bits, &value, sizeof(bits));
+                    h = (h * 0x9E3779B97F4A7C15ull) ^ bits;
+                }
+                return static_cast<size_t>(h ^ (h >> 32));
+            }
+        };
+
+        std::vector<uint32_t> weldedVertices(numVertices);
+        {
+            std::unordered_map<WeldKey, uint32_t, WeldKeyHash> weldMap;
+            weldMap.reserve(numVertices);
+            for (uint32_t vIdx = 0; vIdx < numVertices; ++vIdx)
+            {
+                // Adding 0 turns -0 into +0 so that they hash the same
+                WeldKey key   = {};
+                key.values[0] = positions[vIdx].x + 0.0f;
+                key.values[1] = positions[vIdx].y + 0.0f;
+                key.values[2] = positions[vIdx].z + 0.0f;
+                key.values[3] = normals[vIdx].x + 0.0f;
+                key.values[4] = normals[vIdx].y + 0.0f;
+                key.values[5] = normals[vIdx].z + 0.0f;
+                key.values[6] = texCoords[vIdx].x + 0.0f;
+                key.values[7] = texCoords[vIdx].y + 0.0f;
+
+                auto it                = weldMap.emplace(key, vIdx).first;
+                weldedVertices[vIdx] = it->second;
+            }
+        }
+
+        // Triangles sorted by group and Morton code
+        std::vector<uint32_t> triangleGroups(numTriangles, UINT32_MAX);
+        for (uint32_t groupIdx = 0; groupIdx < pMesh->GetNumGroups(); ++groupIdx)
+        {
+            const auto& group = pMesh->GetGroup(groupIdx);
+            std::fill_n(triangleGroups.begin() + group.GetFirstTriangle(), group.GetNumTriangles(), groupIdx);
+        }
+
+        TriMesh::Aabb bounds = {positions[0], positions[0]};
+        for (auto& position : positions)
+        {
+            bounds.min = glm::min(bounds.min, position);
+            bounds.max = glm::max(bounds.max, position);
+        }
+        const glm::vec3 scale = 1023.0f / glm::max(bounds.max - bounds.min, glm::vec3(1e-20f));
+
+        auto SpreadBits = [](uint32_t x) -> uint64_t {
+            uint64_t v = x & 0x3FF;
+            v          = (v | (v << 16)) & 0x030000FF;
+            v          = (v | (v << 8)) & 0x0300F00F;
+            v          = (v | (v << 4)) & 0x030C30C3;
+            v          = (v | (v << 2)) & 0x09249249;
+            return v;
+        };
+
+        std::vector<uint64_t> sortKeys(numTriangles);
+        ParallelFor(numTriangles, 16384, [&](uint32_t begin, uint32_t end) {
+            for (uint32_t triIdx = begin; triIdx < end; ++triIdx)
+            {
+                const TriMesh::Triangle& tri = triangles[triIdx];
+
+                glm::vec3  centroid = (positions[tri.vIdx0] + positions[tri.vIdx1] + positions[tri.vIdx2]) / 3.0f;
+                glm::uvec3 cell     = glm::uvec3(glm::min(glm::max((centroid - bounds.min) * scale, glm::vec3(0)), glm::vec3(1023)));
+
+                uint64_t morton  = SpreadBits(cell.x) | (SpreadBits(cell.y) << 1) | (SpreadBits(cell.z) << 2);
+                sortKeys[triIdx] = (static_cast<uint64_t>(triangleGroups[triIdx]) << 32) | morton;
+            }
+        });
+
+        std::vector<uint32_t> sortedTriangles(numTriangles);
+        std::iota(sortedTriangles.begin(), sortedTriangles.end(), 0);
+        std::stable_sort(
+            sortedTriangles.begin(),
+            sortedTriangles.end(),
+            [&sortKeys](uint32_t a, uint32_t b) { return sortKeys[a] < sortKeys[b]; });
+
+        // Each welded vertex belongs to the first chunk that uses it
+        std::vector<uint32_t> vertexChunks(numVertices, UINT32_MAX);
+        for (uint32_t i = 0; i < numTriangles; ++i)
+        {
+            const uint32_t           chunkIdx       = i / trianglesPerChunk;
+            const TriMesh::Triangle& tri            = triangles[sortedTriangles[i]];
+            const uint32_t*          pVertexIndices = reinterpret_cast<const uint32_t*>(&tri);
+            for (uint32_t j = 0; j < 3; ++j)
+            {
+                uint32_t weldedIdx = weldedVertices[pVertexIndices[j]];
+                if (vertexChunks[weldedIdx] == UINT32_MAX)
+                {
+                    vertexChunks[weldedIdx] = chunkIdx;
+                }
+            }
+        }
+        for (uint32_t vIdx = 0; vIdx < numVertices; ++vIdx)
+        {
+            vertexChunks[vIdx] = vertexChunks[weldedVertices[vIdx]];
+        }
+
+        // Triangles around each welded vertex
+        std::vector<uint32_t> vertexTriangleOffsets(numVertices + 1, 0);
+        for (auto& tri : triangles)
+        {
+            ++vertexTriangleOffsets[weldedVertices[tri.vIdx0] + 1];
+            ++vertexTriangleOffsets[weldedVertices[tri.vIdx1] + 1];
+            ++vertexTriangleOffsets[weldedVertices[tri.vIdx2] + 1];
+        }
+        for (uint32_t vIdx = 0; vIdx < numVertices; ++vIdx)
+        {
+            vertexTriangleOffsets[vIdx + 1] += vertexTriangleOffsets[vIdx];
+        }
+
+        std::vector<uint32_t> vertexTriangles(vertexTriangleOffsets.back());
+        {
+            std::vector<uint32_t> cursors(vertexTriangleOffsets.begin(), vertexTriangleOffsets.end() - 1);
+            for (uint32_t triIdx = 0; triIdx < numTriangles; ++triIdx)
+            {
+                const TriMesh::Triangle& tri = triangles[triIdx];
+                vertexTriangles[cursors[weldedVertices[tri.vIdx0]]++] = triIdx;
+                vertexTriangles[cursors[weldedVertices[tri.vIdx1]]++] = triIdx;
+                vertexTriangles[cursors[weldedVertices[tri.vIdx2]]++] = triIdx;
+            }
+        }
+
+        ParallelFor(numChunks, 1, [&](uint32_t begin, uint32_t end) {
+            for (uint32_t chunkIdx = begin; chunkIdx < end; ++chunkIdx)
+            {
+                const uint32_t firstTriangle = chunkIdx * trianglesPerChunk;
+                const uint32_t lastTriangle  = std::min(firstTriangle + trianglesPerChunk, numTriangles);
+
+                std::vector<uint32_t> chunkTriangles;
+                for (uint32_t i = firstTriangle; i < lastTriangle; ++i)
+                {
+                    const TriMesh::Triangle& tri            = triangles[sortedTriangles[i]];
+                    const uint32_t*          pVertexIndices = reinterpret_cast<const uint32_t*>(&tri);
+                    for (uint32_t j = 0; j < 3; ++j)
+                    {
+                        uint32_t weldedIdx = weldedVertices[pVertexIndices[j]];
+                        if (vertexChunks[weldedIdx] != chunkIdx)
+                        {
+                            continue;
+                        }
+                        chunkTriangles.insert(
+                            chunkTriangles.end(),
+                            vertexTriangles.begin() + vertexTriangleOffsets[weldedIdx],
+                            vertexTriangles.begin() + vertexTriangleOffsets[weldedIdx + 1]);
+                    }
+                }
+
+                // Original face order
+                std::sort(chunkTriangles.begin(), chunkTriangles.end());
+                chunkTriangles.erase(std::unique(chunkTriangles.begin(), chunkTriangles.end()), chunkTriangles.end());
+
+                Context userData       = {};
+                userData.pMesh         = pMesh;
+                userData.pTriangles    = chunkTriangles.data();
+                userData.numTriangles  = CountU32(chunkTriangles);
+                userData.pVertexChunks = vertexChunks.data();
+                userData.chunkIndex    = chunkIdx;
+
+                Run(userData);
+            }
+        });
+    }
 };
 
 int CalculateTangents::getNumFaces(const SMikkTSpaceContext* pContext)
 {
-    TriMesh* pMesh = static_cast<TriMesh*>(pContext->m_pUserData);
-    assert((pMesh != nullptr) && "pMesh is NULL!");
+    const Context* pUserData = static_cast<const Context*>(pContext->m_pUserData);
+    assert((pUserData != nullptr) && (pUserData->pMesh != nullptr) && "pMesh is NULL!");
 
-    int numFaces = static_cast<int>(pMesh->GetNumTriangles());
+    int numFaces = static_cast<int>(pUserData->numTriangles);
     return numFaces;
 }
 
@@ -126,13 +394,9 @@ int CalculateTangents::getNumVerticesOfFace(const SMikkTSpaceContext*, const int
 
 void CalculateTangents::getPosition(const SMikkTSpaceContext* pContext, float fvPosOut[], const int iFace, const int iVert)
 {
-    TriMesh* pMesh = static_cast<TriMesh*>(pContext->m_pUserData);
-    assert((pMesh != nullptr) && "pMesh is NULL!");
-
-    const TriMesh::Triangle& tri            = pMesh->GetTriangles()[iFace];
-    const uint32_t*          pVertexIndices = reinterpret_cast<const uint32_t*>(&tri);
-    uint32_t                 vIdx           = pVertexIndices[iVert];
-    const glm::vec3&         position       = pMesh->GetPositions()[vIdx];
+    const Context*   pUserData = static_cast<const Context*>(pContext->m_pUserData);
+    uint32_t         vIdx      = GetVertexIndex(pContext, iFace, iVert);
+    const glm::vec3& position  = pUserData->pMesh->GetPositions()[vIdx];
 
     fvPosOut[0] = position.x;
     fvPosOut[1] = position.y;
@@ -141,13 +405,9 @@ void CalculateTangents::getPosition(const SMikkTSpaceContext* pContext, float fv
 
 void CalculateTangents::getNormal(const SMikkTSpaceContext* pContext, float fvNormOut[], const int iFace, const int iVert)
 {
-    TriMesh* pMesh = static_cast<TriMesh*>(pContext->m_pUserData);
-    assert((pMesh != nullptr) && "pMesh is NULL!");
-
-    const TriMesh::Triangle& tri            = pMesh->GetTriangles()[iFace];
-    const uint32_t*          pVertexIndices = reinterpret_cast<const uint32_t*>(&tri);
-    uint32_t                 vIdx           = pVertexIndices[iVert];
-    const glm::vec3&         normal         = pMesh->GetNormals()[vIdx];
+    const Context*   pUserData = static_cast<const Context*>(pContext->m_pUserData);
+    uint32_t         vIdx      = GetVertexIndex(pContext, iFace, iVert);
+    const glm::vec3& normal    = pUserData->pMesh->GetNormals()[vIdx];
 
     fvNormOut[0] = normal.x;
     fvNormOut[1] = normal.y;
@@ -156,13 +416,9 @@ void CalculateTangents::getNormal(const SMikkTSpaceContext* pContext, float fvNo
 
 void CalculateTangents::getTexCoord(const SMikkTSpaceContext* pContext, float fvTexcOut[], const int iFace, const int iVert)
 {
-    TriMesh* pMesh = static_cast<TriMesh*>(pContext->m_pUserData);
-    assert((pMesh != nullptr) && "pMesh is NULL!");
-
-    const TriMesh::Triangle& tri            = pMesh->GetTriangles()[iFace];
-    const uint32_t*          pVertexIndices = reinterpret_cast<const uint32_t*>(&tri);
-    uint32_t                 vIdx           = pVertexIndices[iVert];
-    const glm::vec2&         texCoord       = pMesh->GetTexCoords()[vIdx];
+    const Context*   pUserData = static_cast<const Context*>(pContext->m_pUserData);
+    uint32_t         vIdx      = GetVertexIndex(pContext, iFace, iVert);
+    const glm::vec2& texCoord  = pUserData->pMesh->GetTexCoords()[vIdx];
 
     fvTexcOut[0] = texCoord.x;
     fvTexcOut[1] = texCoord.y;
@@ -170,18 +426,21 @@ void CalculateTangents::getTexCoord(const SMikkTSpaceContext* pContext, float fv
 
 void CalculateTangents::setTSpaceBasic(const SMikkTSpaceContext* pContext, const float fvTangent[], const float fSign, const int iFace, const int iVert)
 {
-    TriMesh* pMesh = static_cast<TriMesh*>(pContext->m_pUserData);
-    assert((pMesh != nullptr) && "pMesh is NULL!");
+    const Context* pUserData = static_cast<const Context*>(pContext->m_pUserData);
+    uint32_t       vIdx      = GetVertexIndex(pContext, iFace, iVert);
+
+    // Chunk border vertices are written by the chunk that owns them
+    if (!IsNull(pUserData->pVertexChunks) && (pUserData->pVertexChunks[vIdx] != pUserData->chunkIndex))
+    {
+        return;
+    }
 
-    const TriMesh::Triangle& tri            = pMesh->GetTriangles()[iFace];
-    const uint32_t*          pVertexIndices = reinterpret_cast<const uint32_t*>(&tri);
-    uint32_t                 vIdx           = pVertexIndices[iVert];
-    const glm::vec3&         normal         = pMesh->GetNormals()[vIdx];
+    const glm::vec3& normal = pUserData->pMesh->GetNormals()[vIdx];
 
     glm::vec3 tangent   = glm::vec3(fvTangent[0], fvTangent[1], fvTangent[2]);
     glm::vec3 bitangent = fSign * glm::cross(normal, glm::vec3(tangent));
 
-    pMesh->SetTangents(vIdx, tangent, bitangent);
+    pUserData->pMesh->SetTangents(vIdx, tangent, bitangent);
 }
 #else
 struct CalculateTangents
@@ -269,71 +528,226 @@ uint32_t TriMesh::GetGroupIndex(const std::string& groupName) const
 
 uint32_t TriMesh::AddGroup(const TriMesh::Group& newGroup)
 {
-    if (newGroup.GetName().empty())
+    if (!this->AddGroups({newGroup}))
     {
-        assert(false && "group name cannot be empty");
         return UINT32_MAX;
     }
 
-    auto it = std::find_if(
-        mGroups.begin(),
-        mGroups.end(),
-        [&newGroup](const TriMesh::Group& elem) -> bool {
-            bool match = (elem.GetName() == newGroup.GetName());
-            return match;
-        });
-    if (it != mGroups.end())
+    uint32_t newIndex = static_cast<uint32_t>(mGroups.size() - 1);
+    return newIndex;
+}
+
+bool TriMesh::AddGroups(const std::vector<TriMesh::Group>& newGroups)
+{
+    const uint32_t numTriangles        = GetNumTriangles();
+    const uint32_t numGroupedTriangles = GetNumGroupedTriangles();
+
+    for (size_t i = 0; i < newGroups.size(); ++i)
     {
-        assert(false && "group name already exists");
-        return UINT32_MAX;
+        const auto& newGroup = newGroups[i];
+        if (newGroup.GetName().empty())
+        {
+            assert(false && "group name cannot be empty");
+            return false;
+        }
+
+        bool exists = (GetGroupIndex(newGroup.GetName()) != UINT32_MAX);
+        for (size_t j = 0; j < i; ++j)
+        {
+            exists = exists || (newGroups[j].GetName() == newGroup.GetName());
+        }
+        if (exists)
+        {
+            assert(false && "group name already exists");
+            return false;
+        }
+
+        for (auto& range : newGroup.mMaterialRanges)
+        {
+            if ((static_cast<uint64_t>(range.firstTriangle) + range.numTriangles) > numTriangles)
+            {
+                assert(false && "group triangle index out of range");
+                return false;
+            }
+        }
     }
 
-    mGroups.push_back(newGroup);
-    uint32_t newIndex = static_cast<uint32_t>(mGroups.size() - 1);
+    //
+    // Triangle indices in \b newGroups refer to the triangles as they are
+    // before the call. Each group's ranges are sorted by material, stable
+    // so triangles keep their order within a material, and the groups are
+    // laid out after the existing groups.
+    //
+    std::vector<std::vector<TriMesh::MaterialRange>> srcRanges(newGroups.size());
+    bool                                             inPlace = true;
+    uint32_t                                         dstTri  = numGroupedTriangles;
+    for (size_t i = 0; i < newGroups.size(); ++i)
+    {
+        srcRanges[i] = newGroups[i].mMaterialRanges;
+        std::stable_sort(
+            srcRanges[i].begin(),
+            srcRanges[i].end(),
+            [](const TriMesh::MaterialRange& a, const TriMesh::MaterialRange& b) -> bool { return a.materialIndex < b.materialIndex; });
 
-    // Calculate the AABB
-    auto& addedGroup = mGroups.back();
-    if (addedGroup.GetNumTriangleIndices() > 0)
+        for (auto& range : srcRanges[i])
+        {
+            inPlace = inPlace && (range.firstTriangle == dstTri);
+            dstTri += range.numTriangles;
+        }
+    }
+
+    //
+    // Otherwise move the new groups' triangles to the front of the
+    // ungrouped triangles. Only the ungrouped triangles get reordered.
+    // Triangles that are already in a group, or in more than one of the
+    // new groups, are copied.
+    //
+    if (!inPlace)
     {
-        TriMesh::Aabb bounds = {};
-        // Set the min/max to the first vertex of the first tirangle
-        uint32_t    triIdx = addedGroup.GetTriangleIndices()[0];
-        const auto& tri    = mTriangles[triIdx];
-        bounds.min         = mPositions[tri.vIdx0];
-        bounds.max         = mPositions[tri.vIdx0];
-        // Iterate through triangles and min/max on each vertex index
-        for (const auto& triIdx : addedGroup.GetTriangleIndices())
+        std::vector<bool>              isMoved(numTriangles - numGroupedTriangles, false);
+        std::vector<TriMesh::Triangle> triangles(mTriangles.begin(), mTriangles.begin() + numGroupedTriangles);
+        triangles.reserve(numTriangles);
+        for (auto& ranges : srcRanges)
+        {
+            for (auto& range : ranges)
+            {
+                for (uint32_t triIdx = range.firstTriangle; triIdx < (range.firstTriangle + range.numTriangles); ++triIdx)
+                {
+                    if (triIdx >= numGroupedTriangles)
+                    {
+                        isMoved[triIdx - numGroupedTriangles] = true;
+                    }
+                    triangles.push_back(mTriangles[triIdx]);
+                }
+            }
+        }
+
+        for (uint32_t triIdx = numGroupedTriangles; triIdx < numTriangles; ++triIdx)
+        {
+            if (!isMoved[triIdx - numGroupedTriangles])
+            {
+                triangles.push_back(mTriangles[triIdx]);
+            }
+        }
+
+        if (triangles.size() > numTriangles)
         {
-            const auto& tri = mTriangles[triIdx];
-            // vIdx0
-            bounds.min = glm::min(bounds.min, mPositions[tri.vIdx0]);
-            bounds.max = glm::max(bounds.max, mPositions[tri.vIdx0]);
-            // vIdx1
-            bounds.min = glm::min(bounds.min, mPositions[tri.vIdx1]);
-            bounds.max = glm::max(bounds.max, mPositions[tri.vIdx1]);
-            // vIdx2
-            bounds.min = glm::min(bounds.min, mPositions[tri.vIdx2]);
-            bounds.max = glm::max(bounds.max, mPositions[tri.vIdx2]);
+            GREX_LOG_WARN("AddGroups: copied " << (triangles.size() - numTriangles) << " triangles that are in more than one group");
         }
 
-        addedGroup.SetBounds(bounds);
+        mTriangles = std::move(triangles);
     }
 
-    return newIndex;
+    // Material ranges and bounds
+    dstTri = numGroupedTriangles;
+    for (size_t i = 0; i < newGroups.size(); ++i)
+    {
+        TriMesh::Group group(newGroups[i].GetName());
+        group.mFirstTriangle = dstTri;
+
+        for (auto& range : srcRanges[i])
+        {
+            auto& ranges = group.mMaterialRanges;
+            if (!ranges.empty() && (ranges.back().materialIndex == range.materialIndex))
+            {
+                ranges.back().numTriangles += range.numTriangles;
+            }
+            else if (range.numTriangles > 0)
+            {
+                ranges.push_back(TriMesh::MaterialRange{range.materialIndex, dstTri, range.numTriangles});
+            }
+            dstTri += range.numTriangles;
+        }
+        group.mNumTriangles = dstTri - group.mFirstTriangle;
+
+        if (group.mNumTriangles > 0)
+        {
+            TriMesh::Aabb bounds = {};
+            // Set the min/max to the first vertex of the first tirangle
+            const auto& firstTri = mTriangles[group.mFirstTriangle];
+            bounds.min           = mPositions[firstTri.vIdx0];
+            bounds.max           = mPositions[firstTri.vIdx0];
+            // Iterate through triangles and min/max on each vertex index
+            for (uint32_t triIdx = group.mFirstTriangle; triIdx < (group.mFirstTriangle + group.mNumTriangles); ++triIdx)
+            {
+                const auto& tri = mTriangles[triIdx];
+                // vIdx0
+                bounds.min = glm::min(bounds.min, mPositions[tri.vIdx0]);
+                bounds.max = glm::max(bounds.max, mPositions[tri.vIdx0]);
+                // vIdx1
+                bounds.min = glm::min(bounds.min, mPositions[tri.vIdx1]);
+                bounds.max = glm::max(bounds.max, mPositions[tri.vIdx1]);
+                // vIdx2
+                bounds.min = glm::min(bounds.min, mPositions[tri.vIdx2]);
+                bounds.max = glm::max(bounds.max, mPositions[tri.vIdx2]);
+            }
+
+            group.SetBounds(bounds);
+        }
+
+        mGroups.push_back(std::move(group));
+    }
+
+    this->UpdateMaterialRanges();
+
+    return true;
 }
 
-std::vector<TriMesh::Triangle> TriMesh::GetGroupTriangles(uint32_t groupIndex) const
+void TriMesh::UpdateMaterialRanges()
 {
-    std::vector<TriMesh::Triangle> triangles;
-    if (groupIndex < GetNumGroups())
+    mMaterialRanges.clear();
+    for (auto& group : mGroups)
     {
-        for (auto& triangleIndex : mGroups[groupIndex].GetTriangleIndices())
+        for (auto& range : group.mMaterialRanges)
         {
-            const TriMesh::Triangle& tri = mTriangles[triangleIndex];
-            triangles.push_back(tri);
+            const size_t bucket = static_cast<size_t>(std::max(range.materialIndex, -1) + 1);
+            if (bucket >= mMaterialRanges.size())
+            {
+                mMaterialRanges.resize(bucket + 1);
+            }
+            mMaterialRanges[bucket].push_back(range);
         }
     }
-    return triangles;
+}
+
+uint32_t TriMesh::GetNumGroupedTriangles() const
+{
+    if (mGroups.empty())
+    {
+        return 0;
+    }
+
+    const auto& lastGroup = mGroups.back();
+    return lastGroup.GetFirstTriangle() + lastGroup.GetNumTriangles();
+}
+
+std::span<const TriMesh::Triangle> TriMesh::GetGroupTriangles(uint32_t groupIndex) const
+{
+    if (groupIndex >= GetNumGroups())
+    {
+        return {};
+    }
+
+    const auto& group = mGroups[groupIndex];
+    return std::span<const TriMesh::Triangle>(mTriangles.data() + group.GetFirstTriangle(), group.GetNumTriangles());
+}
+
+std::span<const TriMesh::Triangle> TriMesh::GetTriangles(const TriMesh::MaterialRange& range) const
+{
+    assert(((static_cast<size_t>(range.firstTriangle) + range.numTriangles) <= mTriangles.size()) && "material range out of bounds");
+    return std::span<const TriMesh::Triangle>(mTriangles.data() + range.firstTriangle, range.numTriangles);
+}
+
+const std::vector<TriMesh::MaterialRange>& TriMesh::GetMaterialRanges(int32_t materialIndex) const
+{
+    static const std::vector<TriMesh::MaterialRange> sEmpty;
+
+    const size_t bucket = static_cast<size_t>(std::max(materialIndex, -1) + 1);
+    if (bucket >= mMaterialRanges.size())
+    {
+        return sEmpty;
+    }
+    return mMaterialRanges[bucket];
 }
 
 uint32_t TriMesh::AddMaterial(const TriMesh::Material& material)
@@ -345,26 +759,20 @@ uint32_t TriMesh::AddMaterial(const TriMesh::Material& material)
 
 std::vector<TriMesh::Triangle> TriMesh::GetTrianglesForMaterial(const int32_t materialIndex) const
 {
+    const auto& ranges = GetMaterialRanges(materialIndex);
+
+    size_t numTriangles = 0;
+    for (auto& range : ranges)
+    {
+        numTriangles += range.numTriangles;
+    }
+
     std::vector<TriMesh::Triangle> triangles;
-    // Iterate groups...
-    const uint32_t numGroups = GetNumGroups();
-    for (uint32_t groupIndex = 0; groupIndex < numGroups; ++groupIndex)
+    triangles.reserve(numTriangles);
+    for (auto& range : ranges)
     {
-        auto& group = GetGroup(groupIndex);
-        // Iterate triangles in group....
-        const uint32_t numTriangleIndices = group.GetNumTriangleIndices();
-        for (uint32_t i = 0; i < numTriangleIndices; ++i)
-        {
-            // Look for material indices that match \b materialIndex...
-            const int32_t itMaterialIndex = group.GetMaterialIndices()[i];
-            if (materialIndex == itMaterialIndex)
-            {
-                // ...add corresponding triangle if there's a match
-                const uint32_t itTriangleIndex = group.GetTriangleIndices()[i];
-                const auto&    tri             = GetTriangle(itTriangleIndex);
-                triangles.push_back(tri);
-            }
-        }
+        auto rangeTriangles = GetTriangles(range);
+        triangles.insert(triangles.end(), rangeTriangles.begin(), rangeTriangles.end());
     }
 
     return triangles;
@@ -573,6 +981,8 @@ void TriMesh::AppendMesh(const TriMesh& srcMesh, const std::string& groupPrefix)
     const uint32_t srcNumGroups = srcMesh.GetNumGroups();
     if (srcNumGroups > 0)
     {
+        // Added together since adding a group can reorder the ungrouped triangles
+        std::vector<TriMesh::Group> newGroups;
         for (uint32_t i = 0; i < srcNumGroups; ++i)
         {
             auto&       srcGroup     = srcMesh.GetGroups()[i];
@@ -586,24 +996,24 @@ void TriMesh::AppendMesh(const TriMesh& srcMesh, const std::string& groupPrefix)
             // Create new group
             auto newGroup = Group(newGroupName);
 
-            // Add triangle and material indices
-            const uint32_t numSrcTriangleIndices = srcGroup.GetNumTriangleIndices();
-            for (uint32_t j = 0; j < numSrcTriangleIndices; ++j)
+            // Add material ranges
+            for (auto range : srcGroup.GetMaterialRanges())
             {
-                uint32_t triangleIndex = srcGroup.GetTriangleIndices()[j];
-                int32_t  materialIndex = srcGroup.GetMaterialIndices()[j];
-                triangleIndex += triangleIndexOffset;
-                if (materialIndex >= 0)
+                range.firstTriangle += triangleIndexOffset;
+                if (range.materialIndex >= 0)
                 {
-                    materialIndex += materialIndexOffset;
+                    range.materialIndex += materialIndexOffset;
                 }
-                newGroup.AddTriangleIndex(triangleIndex, materialIndex);
+                newGroup.mMaterialRanges.push_back(range);
+                newGroup.mNumTriangles += range.numTriangles;
             }
 
-            // Add group
-            uint32_t res = this->AddGroup(newGroup);
-            assert((res != UINT32_MAX) && "AddGroup failed");
+            newGroups.push_back(newGroup);
         }
+
+        // Add groups
+        bool res = this->AddGroups(newGroups);
+        assert(res && "AddGroups failed");
     }
     // ...otherwise create a group using \b groupPrefix for name
     else
@@ -628,90 +1038,664 @@ void TriMesh::AppendMesh(const TriMesh& srcMesh, const std::string& groupPrefix)
 void TriMesh::WeldVertices(
     float positionDistanceThreshold,
     float texCoordDistanceThreshold,
-    float normalAngleThreshold)
+    float normalAngleThreshold,
+    float vertexColorDistanceThreshold)
 {
-    // if (mOptions.enableVertexColors || mOptions.enableTexCoords || mOptions.enableNormals || mOptions.enableTangents)
-    if (mOptions.enableVertexColors || mOptions.enableTangents)
+    const uint32_t vertexCount = CountU32(mPositions);
+    if (vertexCount == 0)
     {
         return;
     }
 
-    const float positionDistanceThresholdSq = positionDistanceThreshold * positionDistanceThreshold;
-    const float texCoordDistanceThresholdSq = texCoordDistanceThreshold * texCoordDistanceThreshold;
-
-    std::unordered_map<uint32_t, uint32_t> weldedIndexMap;
-    std::vector<glm::vec3>                 weldedPositions;
-    std::vector<glm::vec2>                 weldedTexCoords;
-    std::vector<glm::vec3>                 weldedNormals;
-
-    const uint32_t   vertexCount       = CountU32(mPositions);
-    const glm::vec3* pPosition         = mPositions.data();
-    const glm::vec2* pTexCoord         = mTexCoords.data();
-    const glm::vec3* pNormal           = mNormals.data();
-    uint32_t         weldedVertexCount = 0;
-    for (uint32_t oldIdx = 0; oldIdx < vertexCount; ++oldIdx, ++pPosition, ++pTexCoord, ++pNormal)
-    {
-        const glm::vec3* pPosition2 = weldedPositions.data();
-        const glm::vec2* pTexCoord2 = weldedTexCoords.data();
-        const glm::vec3* pNormal2   = weldedNormals.data();
-        //
-        uint32_t newIdx = UINT32_MAX;
-        for (uint32_t i = 0; i < weldedVertexCount; ++i, ++pPosition2, ++pTexCoord2, ++pNormal2)
-        {
-            float posDistSq = glm::distance2(*pPosition, *pPosition2);
-            float tcDistSq  = glm::distance2(*pTexCoord, *pTexCoord2);
+    // Only compare attributes that exist for every vertex
+    const bool hasVertexColors = (mVertexColors.size() == vertexCount);
+    const bool hasTexCoords    = (mTexCoords.size() == vertexCount);
+    const bool hasNormals      = (mNormals.size() == vertexCount);
+    const bool hasTangents     = (mTangents.size() == vertexCount) && (mBitangents.size() == vertexCount);
 
-            auto  N     = glm::normalize(*pNormal);
-            auto  N2    = glm::normalize(*pNormal2);
-            float theta = acos(glm::dot(N, N2) / (glm::length(N) * glm::length(N2)));
+    const float positionDistanceThresholdSq    = positionDistanceThreshold * positionDistanceThreshold;
+    const float texCoordDistanceThresholdSq    = texCoordDistanceThreshold * texCoordDistanceThreshold;
+    const float vertexColorDistanceThresholdSq = vertexColorDistanceThreshold * vertexColorDistanceThreshold;
+    const float cosAngleThreshold              = cos(normalAngleThreshold);
 
-            bool withinPositionThreshold = (posDistSq <= positionDistanceThresholdSq);
-            bool withinTexCoordThreshold = (tcDistSq <= texCoordDistanceThresholdSq);
-            bool withinNormalThreshold   = (theta <= normalAngleThreshold);
-            if (withinPositionThreshold && withinTexCoordThreshold && withinNormalThreshold)
+    // Normalize direction vectors once up front instead of per comparison.
+    // Zero length vectors stay zero and only match other zero length vectors.
+    //
+    auto NormalizeAll = [](const std::vector<glm::vec3>& src) -> std::vector<glm::vec3> {
+        std::vector<glm::vec3> dst(src.size());
+        ParallelFor(CountU32(src), 65536, [&](uint32_t begin, uint32_t end) {
+            for (uint32_t i = begin; i < end; ++i)
             {
-                newIdx = i;
-                break;
+                float len = glm::length(src[i]);
+                dst[i]    = (len > 0) ? (src[i] / len) : glm::vec3(0);
             }
+        });
+        return dst;
+    };
+    const std::vector<glm::vec3> unitNormals    = hasNormals ? NormalizeAll(mNormals) : std::vector<glm::vec3>();
+    const std::vector<glm::vec3> unitTangents   = hasTangents ? NormalizeAll(mTangents) : std::vector<glm::vec3>();
+    const std::vector<glm::vec3> unitBitangents = hasTangents ? NormalizeAll(mBitangents) : std::vector<glm::vec3>();
+
+    auto WithinAngle = [cosAngleThreshold](const glm::vec3& a, const glm::vec3& b) -> bool {
+        bool aIsZero = (a == glm::vec3(0));
+        bool bIsZero = (b == glm::vec3(0));
+        if (aIsZero || bIsZero)
+        {
+            return (aIsZero && bIsZero);
         }
+        return (glm::dot(a, b) >= cosAngleThreshold);
+    };
 
-        if (newIdx == UINT32_MAX)
+    auto MatchesAttributes = [&](uint32_t i, uint32_t j) -> bool {
+        if (hasTexCoords && (glm::distance2(mTexCoords[i], mTexCoords[j]) > texCoordDistanceThresholdSq))
+        {
+            return false;
+        }
+        if (hasVertexColors && (glm::distance2(mVertexColors[i], mVertexColors[j]) > vertexColorDistanceThresholdSq))
+        {
+            return false;
+        }
+        if (hasNormals && !WithinAngle(unitNormals[i], unitNormals[j]))
+        {
+            return false;
+        }
+        if (hasTangents && (!WithinAngle(unitTangents[i], unitTangents[j]) || !WithinAngle(unitBitangents[i], unitBitangents[j])))
         {
-            weldedPositions.push_back(*pPosition);
-            weldedTexCoords.push_back(*pTexCoord);
-            weldedNormals.push_back(*pNormal);
-            ++weldedVertexCount;
-            newIdx = weldedVertexCount - 1;
+            return false;
         }
+        return true;
+    };
 
-        weldedIndexMap[oldIdx] = newIdx;
+    // -------------------------------------------------------------------------
+    // Uniform grid
+    //
+    // Cells are larger than the position threshold so any match is either in
+    // the same cell or in one of the 26 neighbors. Using 4x the threshold
+    // means a vertex only needs to visit a neighbor on a given axis if it's
+    // in the outer quarter of its cell on that side. Cell coordinates are
+    // limited to 21 bits per axis so they pack into a single 64-bit key.
+    // -------------------------------------------------------------------------
+    const float    kCellSizeScale = 4.0f;
+    const uint32_t kMaxCellCoord  = (1u << 21) - 1;
+
+    glm::vec3 boundsMin = mPositions[0];
+    glm::vec3 boundsMax = mPositions[0];
+    for (const auto& position : mPositions)
+    {
+        boundsMin = glm::min(boundsMin, position);
+        boundsMax = glm::max(boundsMax, position);
     }
+    const glm::vec3 extent   = boundsMax - boundsMin;
+    const float     maxSpan  = std::max(extent.x, std::max(extent.y, extent.z));
+    const float     cellSize = std::max(kCellSizeScale * positionDistanceThreshold, std::max(maxSpan / static_cast<float>(kMaxCellCoord), 1e-30f));
 
-    mPositions = weldedPositions;
-    mTexCoords = weldedTexCoords;
-    mNormals   = weldedNormals;
+    auto CellCoord = [&](float value, float minValue) -> uint32_t {
+        float c = floor((value - minValue) / cellSize);
+        return static_cast<uint32_t>(std::min(std::max(c, 0.0f), static_cast<float>(kMaxCellCoord)));
+    };
 
-    for (auto& tri : mTriangles)
+    auto CellKey = [](uint32_t cx, uint32_t cy, uint32_t cz) -> uint64_t {
+        return (static_cast<uint64_t>(cx) << 42) | (static_cast<uint64_t>(cy) << 21) | static_cast<uint64_t>(cz);
+    };
+
+    // Sort vertices by (cell, index) so each cell is a contiguous run of
+    // ascending vertex indices. Positions are copied into the same order
+    // so scanning a cell touches contiguous memory.
+    //
+    std::vector<std::pair<uint64_t, uint32_t>> sortedVertices(vertexCount);
+    ParallelFor(vertexCount, 65536, [&](uint32_t begin, uint32_t end) {
+        for (uint32_t i = begin; i < end; ++i)
+        {
+            const glm::vec3& P = mPositions[i];
+            sortedVertices[i]  = {CellKey(CellCoord(P.x, boundsMin.x), CellCoord(P.y, boundsMin.y), CellCoord(P.z, boundsMin.z)), i};
+        }
+    });
+    std::sort(sortedVertices.begin(), sortedVertices.end());
+
+    std::vector<glm::vec3> sortedPositions(vertexCount);
+    std::vector<uint32_t>  sortedSlots(vertexCount); // Vertex index => position in sortedVertices
+    ParallelFor(vertexCount, 65536, [&](uint32_t begin, uint32_t end) {
+        for (uint32_t k = begin; k < end; ++k)
+        {
+            sortedPositions[k]                    = mPositions[sortedVertices[k].second];
+            sortedSlots[sortedVertices[k].second] = k;
+        }
+    });
+
+    // Cell key => first entry in sortedVertices. Open addressing with linear
+    // probing, keys are at most 63 bits so UINT64_MAX marks an empty slot.
+    //
+    struct CellEntry
     {
-        tri.vIdx0 = weldedIndexMap[tri.vIdx0];
-        tri.vIdx1 = weldedIndexMap[tri.vIdx1];
-        tri.vIdx2 = weldedIndexMap[tri.vIdx2];
-    }
-}
+        uint64_t key   = UINT64_MAX;
+        uint32_t start = 0;
+    };
 
-std::vector<glm::vec3> TriMesh::GetTBNLineSegments(uint32_t* pNumVertices, float length) const
-{
-    if (pNumVertices == nullptr)
+    uint32_t numCells = 0;
+    for (uint32_t k = 0; k < vertexCount; ++k)
     {
-        return {};
+        numCells += ((k == 0) || (sortedVertices[k].first != sortedVertices[k - 1].first)) ? 1 : 0;
     }
-
-    // We need all these attributes
-    uint32_t numPs = CountU32(mPositions);
-    uint32_t numTs = CountU32(mTangents);
-    uint32_t numBs = CountU32(mBitangents);
-    uint32_t numNs = CountU32(mNormals);
-    if (!((numPs == numTs) && (numTs == numBs) && (numBs == numNs)))
+    uint64_t tableSize = 1;
+    while (tableSize < (2 * static_cast<uint64_t>(numCells)))
+    {
+        tableSize <<= 1;
+    }
+    const uint64_t         tableMask = tableSize - 1;
+    std::vector<CellEntry> cellTable(tableSize);
+
+    auto HashCellKey = [](uint64_t key) -> uint64_t {
+        key ^= key >> 33;
+        key *= 0xFF51AFD7ED558CCDull;
+        key ^= key >> 33;
+        return key;
+    };
+
+    for (uint32_t k = 0; k < vertexCount; ++k)
+    {
+        if ((k == 0) || (sortedVertices[k].first != sortedVertices[k - 1].first))
+        {
+            uint64_t slot = HashCellKey(sortedVertices[k].first) & tableMask;
+            while (cellTable[slot].key != UINT64_MAX)
+            {
+                slot = (slot + 1) & tableMask;
+            }
+            cellTable[slot] = {sortedVertices[k].first, k};
+        }
+    }
+
+    auto FindCell = [&](uint64_t key) -> uint32_t {
+        uint64_t slot = HashCellKey(key) & tableMask;
+        while (cellTable[slot].key != UINT64_MAX)
+        {
+            if (cellTable[slot].key == key)
+            {
+                return cellTable[slot].start;
+            }
+            slot = (slot + 1) & tableMask;
+        }
+        return UINT32_MAX;
+    };
+
+    // -------------------------------------------------------------------------
+    // Find candidates (parallel)
+    //
+    // For every vertex, collect all lower indexed vertices that match it.
+    // Neighbor cells are only visited if the vertex is within the position
+    // threshold of the shared cell face, so most vertices only look at
+    // their own cell. Vertices are visited in cell order for locality.
+    // -------------------------------------------------------------------------
+    struct ChunkMatches
+    {
+        std::vector<uint32_t> offsets; // Per sorted vertex in chunk, plus one
+        std::vector<uint32_t> indices; // Matching vertex indices, ascending per vertex
+    };
+
+    const uint32_t            kChunkSize = 16384;
+    std::vector<ChunkMatches> chunkMatches((vertexCount + kChunkSize - 1) / kChunkSize);
+
+    ParallelFor(vertexCount, kChunkSize, [&](uint32_t begin, uint32_t end) {
+        ChunkMatches& chunk = chunkMatches[begin / kChunkSize];
+        chunk.offsets.reserve(end - begin + 1);
+        chunk.offsets.push_back(0);
+
+        for (uint32_t slot = begin; slot < end; ++slot)
+        {
+            const uint32_t   i = sortedVertices[slot].second;
+            const glm::vec3& P = sortedPositions[slot];
+
+            int32_t cellCoords[3]  = {};
+            int32_t lowOffsets[3]  = {};
+            int32_t highOffsets[3] = {};
+            for (int axis = 0; axis < 3; ++axis)
+            {
+                uint32_t c        = CellCoord(P[axis], boundsMin[axis]);
+                float    cellMin  = boundsMin[axis] + c * cellSize;
+                float    cellMax  = cellMin + cellSize;
+                cellCoords[axis]  = static_cast<int32_t>(c);
+                lowOffsets[axis]  = ((c > 0) && ((P[axis] - cellMin) <= positionDistanceThreshold)) ? -1 : 0;
+                highOffsets[axis] = ((c < kMaxCellCoord) && ((cellMax - P[axis]) <= positionDistanceThreshold)) ? 1 : 0;
+            }
+
+            const size_t firstMatch = chunk.indices.size();
+            for (int32_t dz = lowOffsets[2]; dz <= highOffsets[2]; ++dz)
+            {
+                for (int32_t dy = lowOffsets[1]; dy <= highOffsets[1]; ++dy)
+                {
+                    for (int32_t dx = lowOffsets[0]; dx <= highOffsets[0]; ++dx)
+                    {
+                        uint64_t key   = CellKey(cellCoords[0] + dx, cellCoords[1] + dy, cellCoords[2] + dz);
+                        uint32_t start = FindCell(key);
+                        if (start == UINT32_MAX)
+                        {
+                            continue;
+                        }
+                        // Entries in a cell are sorted by vertex index, so stop at i
+                        for (uint32_t k = start; (k < vertexCount) && (sortedVertices[k].first == key); ++k)
+                        {
+                            uint32_t j = sortedVertices[k].second;
+                            if (j >= i)
+                            {
+                                break;
+                            }
+                            if ((glm::distance2(P, sortedPositions[k]) <= positionDistanceThresholdSq) && MatchesAttributes(i, j))
+                            {
+                                chunk.indices.push_back(j);
+                            }
+                        }
+                    }
+                }
+            }
+            std::sort(chunk.indices.begin() + firstMatch, chunk.indices.end());
+
+            chunk.offsets.push_back(CountU32(chunk.indices));
+        }
+    });
+
+    // -------------------------------------------------------------------------
+    // Resolve welds (serial)
+    //
+    // A vertex welds to its lowest indexed match that was kept, otherwise it's
+    // kept. This only walks the (short) candidate lists.
+    // -------------------------------------------------------------------------
+    std::vector<uint32_t> weldedIndexMap(vertexCount, UINT32_MAX);
+    std::vector<uint32_t> keptVertices;
+    std::vector<bool>     isKept(vertexCount, false);
+    for (uint32_t i = 0; i < vertexCount; ++i)
+    {
+        const uint32_t      slot  = sortedSlots[i];
+        const ChunkMatches& chunk = chunkMatches[slot / kChunkSize];
+        const uint32_t      local = slot % kChunkSize;
+
+        uint32_t newIdx = UINT32_MAX;
+        for (uint32_t k = chunk.offsets[local]; k < chunk.offsets[local + 1]; ++k)
+        {
+            uint32_t j = chunk.indices[k];
+            if (isKept[j])
+            {
+                newIdx = weldedIndexMap[j];
+                break;
+            }
+        }
+
+        if (newIdx == UINT32_MAX)
+        {
+            newIdx    = CountU32(keptVertices);
+            isKept[i] = true;
+            keptVertices.push_back(i);
+        }
+
+        weldedIndexMap[i] = newIdx;
+    }
+    chunkMatches.clear();
+
+    // Compact attributes
+    auto Compact = [&keptVertices](auto& attribute) {
+        using AttributeT = typename std::remove_reference<decltype(attribute)>::type;
+        AttributeT welded(keptVertices.size());
+        for (size_t i = 0; i < keptVertices.size(); ++i)
+        {
+            welded[i] = attribute[keptVertices[i]];
+        }
+        attribute = std::move(welded);
+    };
+
+    Compact(mPositions);
+    if (hasVertexColors)
+    {
+        Compact(mVertexColors);
+    }
+    if (hasTexCoords)
+    {
+        Compact(mTexCoords);
+    }
+    if (hasNormals)
+    {
+        Compact(mNormals);
+    }
+    if (hasTangents)
+    {
+        Compact(mTangents);
+        Compact(mBitangents);
+    }
+
+    ParallelFor(GetNumTriangles(), 65536, [&](uint32_t begin, uint32_t end) {
+        for (uint32_t i = begin; i < end; ++i)
+        {
+            auto& tri = mTriangles[i];
+            tri.vIdx0 = weldedIndexMap[tri.vIdx0];
+            tri.vIdx1 = weldedIndexMap[tri.vIdx1];
+            tri.vIdx2 = weldedIndexMap[tri.vIdx2];
+        }
+    });
+}
+
+#if defined(TRIMESH_USE_MESHOPTIMIZER)
+//
+// Triangles that share a group and material, one per material range of
+// each group in order. Triangles that aren't in any group end up in a last
+// part with groupIndex UINT32_MAX. Parts cover the mesh's triangles back
+// to back.
+//
+struct TriMeshPart
+{
+    uint32_t groupIndex    = UINT32_MAX;
+    int32_t  materialIndex = -1;
+    uint32_t firstTriangle = 0;
+    uint32_t numTriangles  = 0;
+};
+
+static std::vector<TriMeshPart> SplitTriMeshParts(const TriMesh& mesh)
+{
+    std::vector<TriMeshPart> parts;
+    for (uint32_t groupIndex = 0; groupIndex < mesh.GetNumGroups(); ++groupIndex)
+    {
+        for (auto& range : mesh.GetGroup(groupIndex).GetMaterialRanges())
+        {
+            parts.push_back(TriMeshPart{groupIndex, range.materialIndex, range.firstTriangle, range.numTriangles});
+        }
+    }
+
+    const uint32_t numGroupedTriangles = mesh.GetNumGroupedTriangles();
+    if (numGroupedTriangles < mesh.GetNumTriangles())
+    {
+        parts.push_back(TriMeshPart{UINT32_MAX, -1, numGroupedTriangles, mesh.GetNumTriangles() - numGroupedTriangles});
+    }
+
+    return parts;
+}
+
+std::vector<TriMesh::LOD> TriMesh::GenerateLODs(const std::vector<TriMesh::LODTarget>& targets) const
+{
+    const uint32_t numVertices = GetNumVertices();
+    if (targets.empty() || mTriangles.empty())
+    {
+        return {};
+    }
+
+    // Vertex indices of each group/material part
+    std::vector<TriMeshPart>           parts = SplitTriMeshParts(*this);
+    std::vector<std::vector<uint32_t>> partSrcIndices(parts.size());
+    for (size_t partIdx = 0; partIdx < parts.size(); ++partIdx)
+    {
+        const auto& part = parts[partIdx];
+        partSrcIndices[partIdx].reserve(3 * static_cast<size_t>(part.numTriangles));
+        for (uint32_t triIdx = part.firstTriangle; triIdx < (part.firstTriangle + part.numTriangles); ++triIdx)
+        {
+            const TriMesh::Triangle& tri = mTriangles[triIdx];
+            partSrcIndices[partIdx].push_back(tri.vIdx0);
+            partSrcIndices[partIdx].push_back(tri.vIdx1);
+            partSrcIndices[partIdx].push_back(tri.vIdx2);
+        }
+    }
+
+    // Lock part borders so neighboring parts still line up after simplification
+    const uint32_t simplifyOptions = (parts.size() > 1) ? meshopt_SimplifyLockBorder : 0;
+
+    // Converts meshopt's relative error to mesh units
+    const float errorScale = meshopt_simplifyScale(
+        reinterpret_cast<const float*>(mPositions.data()),
+        numVertices,
+        sizeof(glm::vec3));
+
+    std::vector<TriMesh::LOD> lods(targets.size());
+
+    ParallelFor(static_cast<uint32_t>(targets.size()), 1, [&](uint32_t begin, uint32_t end) {
+        for (uint32_t lodIdx = begin; lodIdx < end; ++lodIdx)
+        {
+            const TriMesh::LODTarget& target = targets[lodIdx];
+
+            float                              lodError = 0;
+            std::vector<std::vector<uint32_t>> partIndices(parts.size());
+            for (size_t partIdx = 0; partIdx < parts.size(); ++partIdx)
+            {
+                const auto& srcIndices = partSrcIndices[partIdx];
+                auto&       dstIndices = partIndices[partIdx];
+
+                size_t targetIndexCount = 3 * static_cast<size_t>(static_cast<float>(srcIndices.size() / 3) * std::clamp(target.ratio, 0.0f, 1.0f));
+
+                float partError = 0;
+                dstIndices.resize(srcIndices.size());
+                size_t indexCount = meshopt_simplify(
+                    dstIndices.data(),
+                    srcIndices.data(),
+                    srcIndices.size(),
+                    reinterpret_cast<const float*>(mPositions.data()),
+                    numVertices,
+                    sizeof(glm::vec3),
+                    targetIndexCount,
+                    target.maxError,
+                    simplifyOptions,
+                    &partError);
+                dstIndices.resize(indexCount);
+
+                lodError = std::max(lodError, partError);
+            }
+
+            //
+            // Only keep the vertices that are still referenced, in
+            // their original order, and copy every attribute stream.
+            //
+            std::vector<uint32_t> remap(numVertices, UINT32_MAX);
+            for (auto& indices : partIndices)
+            {
+                for (uint32_t vIdx : indices)
+                {
+                    remap[vIdx] = 0;
+                }
+            }
+
+            uint32_t numLODVertices = 0;
+            for (auto& newIndex : remap)
+            {
+                if (newIndex != UINT32_MAX)
+                {
+                    newIndex = numLODVertices++;
+                }
+            }
+
+            TriMesh mesh = TriMesh(mOptions);
+
+            auto CopyStream = [&](const auto& src, auto& dst) {
+                if (src.size() != numVertices)
+                {
+                    return;
+                }
+                dst.resize(numLODVertices);
+                for (uint32_t vIdx = 0; vIdx < numVertices; ++vIdx)
+                {
+                    if (remap[vIdx] != UINT32_MAX)
+                    {
+                        dst[remap[vIdx]] = src[vIdx];
+                    }
+                }
+            };
+            CopyStream(mPositions, mesh.mPositions);
+            CopyStream(mVertexColors, mesh.mVertexColors);
+            CopyStream(mTexCoords, mesh.mTexCoords);
+            CopyStream(mNormals, mesh.mNormals);
+            CopyStream(mTangents, mesh.mTangents);
+            CopyStream(mBitangents, mesh.mBitangents);
+
+            std::vector<TriMesh::Group> groups;
+            for (auto& group : mGroups)
+            {
+                groups.push_back(TriMesh::Group(group.GetName()));
+            }
+
+            for (size_t partIdx = 0; partIdx < parts.size(); ++partIdx)
+            {
+                const auto& indices = partIndices[partIdx];
+                for (size_t i = 0; (i + 2) < indices.size(); i += 3)
+                {
+                    uint32_t triIdx = mesh.AddTriangle(remap[indices[i + 0]], remap[indices[i + 1]], remap[indices[i + 2]]);
+                    if (parts[partIdx].groupIndex != UINT32_MAX)
+                    {
+                        groups[parts[partIdx].groupIndex].AddTriangleIndex(triIdx, parts[partIdx].materialIndex);
+                    }
+                }
+            }
+
+            mesh.CalculateBounds();
+            mesh.AddGroups(groups);
+            mesh.mMaterials = mMaterials;
+
+            lods[lodIdx].mesh  = std::move(mesh);
+            lods[lodIdx].error = lodError * errorScale;
+        }
+    });
+
+    for (size_t lodIdx = 0; lodIdx < lods.size(); ++lodIdx)
+    {
+        GREX_LOG_INFO("LOD " << (lodIdx + 1) << ": " << lods[lodIdx].mesh.GetNumTriangles() << " triangles, error " << lods[lodIdx].error);
+    }
+
+    return lods;
+}
+
+void TriMesh::Optimize(float overdrawThreshold)
+{
+    if (mTriangles.empty())
+    {
+        return;
+    }
+
+    // Bytes per vertex across all attribute streams, for the vertex fetch statistics
+    auto GetVertexSize = [this]() -> size_t {
+        const size_t numVertices = mPositions.size();
+        size_t       vertexSize  = sizeof(glm::vec3);
+        vertexSize += (mVertexColors.size() == numVertices) ? sizeof(glm::vec3) : 0;
+        vertexSize += (mTexCoords.size() == numVertices) ? sizeof(glm::vec2) : 0;
+        vertexSize += (mNormals.size() == numVertices) ? sizeof(glm::vec3) : 0;
+        vertexSize += (mTangents.size() == numVertices) ? sizeof(glm::vec3) : 0;
+        vertexSize += (mBitangents.size() == numVertices) ? sizeof(glm::vec3) : 0;
+        return vertexSize;
+    };
+
+    // Cache size of 16 with no warp or primitive group limits, same as meshopt's defaults
+    auto LogStatistics = [this, &GetVertexSize](const char* label) {
+        const auto indices = GetIndices();
+
+        auto vcs = meshopt_analyzeVertexCache(indices.data(), indices.size(), GetNumVertices(), 16, 0, 0);
+        auto os  = meshopt_analyzeOverdraw(indices.data(), indices.size(), reinterpret_cast<const float*>(mPositions.data()), GetNumVertices(), sizeof(glm::vec3));
+        auto vfs = meshopt_analyzeVertexFetch(indices.data(), indices.size(), GetNumVertices(), GetVertexSize());
+
+        GREX_LOG_INFO(label << " ACMR: " << vcs.acmr << ", ATVR: " << vcs.atvr << ", overdraw: " << os.overdraw << ", overfetch: " << vfs.overfetch);
+    };
+
+    LogStatistics("Optimize before:");
+
+    //
+    // Vertex cache and overdraw optimization per part, parts are
+    // independent so they can be optimized in parallel.
+    //
+    std::vector<TriMeshPart>           parts = SplitTriMeshParts(*this);
+    std::vector<std::vector<uint32_t>> partIndices(parts.size());
+
+    ParallelFor(static_cast<uint32_t>(parts.size()), 1, [&](uint32_t begin, uint32_t end) {
+        for (uint32_t partIdx = begin; partIdx < end; ++partIdx)
+        {
+            const auto&           part = parts[partIdx];
+            std::vector<uint32_t> indices;
+            indices.reserve(3 * static_cast<size_t>(part.numTriangles));
+            for (uint32_t triIdx = part.firstTriangle; triIdx < (part.firstTriangle + part.numTriangles); ++triIdx)
+            {
+                const TriMesh::Triangle& tri = mTriangles[triIdx];
+                indices.push_back(tri.vIdx0);
+                indices.push_back(tri.vIdx1);
+                indices.push_back(tri.vIdx2);
+            }
+
+            auto& optimized = partIndices[partIdx];
+            optimized.resize(indices.size());
+            meshopt_optimizeVertexCache(optimized.data(), indices.data(), indices.size(), GetNumVertices());
+            meshopt_optimizeOverdraw(
+                indices.data(),
+                optimized.data(),
+                optimized.size(),
+                reinterpret_cast<const float*>(mPositions.data()),
+                GetNumVertices(),
+                sizeof(glm::vec3),
+                overdrawThreshold);
+            optimized = std::move(indices);
+        }
+    });
+
+    //
+    // Parts are written back one after another. Every part keeps its
+    // triangle count, so each part ends up back in its own range and the
+    // group and material ranges stay valid.
+    //
+    std::vector<uint32_t> indices;
+    indices.reserve(GetNumIndices());
+    for (auto& optimized : partIndices)
+    {
+        indices.insert(indices.end(), optimized.begin(), optimized.end());
+    }
+    assert((indices.size() == GetNumIndices()) && "optimized triangle count doesn't match");
+
+    //
+    // Vertex fetch remap, applied to every attribute stream. Vertices that
+    // aren't referenced by any triangle get dropped.
+    //
+    const uint32_t        numVertices = GetNumVertices();
+    std::vector<uint32_t> remap(numVertices);
+    const uint32_t        numRemapped = static_cast<uint32_t>(meshopt_optimizeVertexFetchRemap(remap.data(), indices.data(), indices.size(), numVertices));
+
+    meshopt_remapIndexBuffer(indices.data(), indices.data(), indices.size(), remap.data());
+
+    auto RemapStream = [&](auto& stream) {
+        if (stream.size() != numVertices)
+        {
+            return;
+        }
+        using ValueT = typename std::remove_reference_t<decltype(stream)>::value_type;
+
+        std::vector<ValueT> remapped(numRemapped);
+        meshopt_remapVertexBuffer(remapped.data(), stream.data(), numVertices, sizeof(ValueT), remap.data());
+        stream = std::move(remapped);
+    };
+    RemapStream(mPositions);
+    RemapStream(mVertexColors);
+    RemapStream(mTexCoords);
+    RemapStream(mNormals);
+    RemapStream(mTangents);
+    RemapStream(mBitangents);
+
+    SetTriangles(indices);
+    CalculateBounds();
+
+    LogStatistics("Optimize after: ");
+}
+#endif // defined(TRIMESH_USE_MESHOPTIMIZER)
+
+#if defined(TRIMESH_USE_MIKKTSPACE)
+void TriMesh::GenerateTangents(uint32_t trianglesPerChunk)
+{
+    CalculateTangents::CalculateParallel(this, trianglesPerChunk);
+}
+#endif // defined(TRIMESH_USE_MIKKTSPACE)
+
+float TriMesh::CalculateLODDistance(float error, float fovY, float viewportHeight, float pixelThreshold)
+{
+    // Projected size in pixels: error * viewportHeight / (2 * distance * tan(fovY / 2))
+    float distance = (error * viewportHeight) / (2.0f * tan(fovY / 2.0f) * std::max(pixelThreshold, 1e-6f));
+    return distance;
+}
+
+std::vector<glm::vec3> TriMesh::GetTBNLineSegments(uint32_t* pNumVertices, float length) const
+{
+    if (pNumVertices == nullptr)
+    {
+        return {};
+    }
+
+    // We need all these attributes
+    uint32_t numPs = CountU32(mPositions);
+    uint32_t numTs = CountU32(mTangents);
+    uint32_t numBs = CountU32(mBitangents);
+    uint32_t numNs = CountU32(mNormals);
+    if (!((numPs == numTs) && (numTs == numBs) && (numBs == numNs)))
     {
         return {};
     }
@@ -1515,6 +2499,56 @@ TriMesh TriMesh::CornellBox(const TriMesh::Options& options)
     return mesh;
 }
 
+//
+// Copies the OBJ materials referenced by \b activeMaterialIds to \b pMesh,
+// in the order they appear in \b activeMaterialIds.
+//
+static void AddOBJMaterials(const std::vector<tinyobj::material_t>& materials, const std::vector<int>& activeMaterialIds, TriMesh* pMesh)
+{
+    const uint32_t numActiveMaterials = static_cast<uint32_t>(activeMaterialIds.size());
+    for (uint32_t i = 0; i < numActiveMaterials; ++i)
+    {
+        const size_t materialId = activeMaterialIds[i];
+        auto&        material   = materials[materialId];
+
+        TriMesh::Material newMaterial = {};
+        newMaterial.name              = material.name;
+        newMaterial.id                = static_cast<uint32_t>(materialId);
+        newMaterial.F0                = glm::vec3(0.04f);
+        newMaterial.baseColor         = glm::vec3(material.diffuse[0], material.diffuse[1], material.diffuse[2]);
+        newMaterial.roughness         = material.roughness;
+        newMaterial.metalness         = material.metallic;
+        newMaterial.albedoTexture     = material.diffuse_texname;
+        newMaterial.normalTexture     = material.normal_texname;
+        newMaterial.roughnessTexture  = material.roughness_texname;
+        newMaterial.metalnessTexture  = material.metallic_texname;
+        newMaterial.aoTexture         = material.ambient_texname;
+
+        pMesh->AddMaterial(newMaterial);
+    }
+}
+
+//
+// Returns the index of \b shapeMaterialId in \b activeMaterialIds, adding
+// it if it's not there yet. Returns -1 if the face doesn't have a material.
+//
+static int32_t GetActiveMaterialIndex(int shapeMaterialId, std::vector<int>& activeMaterialIds)
+{
+    if (shapeMaterialId == -1)
+    {
+        return -1;
+    }
+
+    auto it = std::find(activeMaterialIds.begin(), activeMaterialIds.end(), shapeMaterialId);
+    if (it == activeMaterialIds.end())
+    {
+        activeMaterialIds.push_back(shapeMaterialId);
+        return static_cast<int32_t>(activeMaterialIds.size() - 1);
+    }
+
+    return static_cast<int32_t>(std::distance(activeMaterialIds.begin(), it));
+}
+
 bool TriMesh::LoadOBJ(const std::string& path, const std::string& mtlBaseDir, const TriMesh::Options& options, TriMesh* pMesh)
 {
     if (pMesh == nullptr)
@@ -1694,22 +2728,7 @@ bool TriMesh::LoadOBJ(const std::string& path, const std::string& mtlBaseDir, co
             uint32_t vIdx2       = numVertices - 1;
 
             uint32_t triangleIndex = pMesh->AddTriangle(vIdx0, vIdx1, vIdx2);
-            int32_t  materialIndex = -1;
-
-            const int shapeMaterialId = shapeMesh.material_ids[triIdx];
-            if (shapeMaterialId != -1)
-            {
-                auto it = std::find(activeMaterialIds.begin(), activeMaterialIds.end(), shapeMaterialId);
-                if (it == activeMaterialIds.end())
-                {
-                    activeMaterialIds.push_back(shapeMaterialId);
-                    materialIndex = static_cast<int32_t>(activeMaterialIds.size() - 1);
-                }
-                else
-                {
-                    materialIndex = static_cast<int32_t>(std::distance(activeMaterialIds.begin(), it));
-                }
-            }
+            int32_t  materialIndex = GetActiveMaterialIndex(shapeMesh.material_ids[triIdx], activeMaterialIds);
 
             newGroup.AddTriangleIndex(triangleIndex, materialIndex);
         }
@@ -1719,35 +2738,207 @@ bool TriMesh::LoadOBJ(const std::string& path, const std::string& mtlBaseDir, co
     }
 
 #if defined(TRIMESH_USE_MIKKTSPACE)
-    CalculateTangents::Calculate(pMesh);
+    CalculateTangents::CalculateParallel(pMesh, DEFAULT_TANGENT_CHUNK_SIZE);
 #endif
 
     // Materials
     //
     // Only copy the materials in \b activeMaterialIds.
     //
-    const uint32_t numActiveMaterials = static_cast<uint32_t>(activeMaterialIds.size());
-    for (uint32_t i = 0; i < numActiveMaterials; ++i)
+    AddOBJMaterials(materials, activeMaterialIds, pMesh);
+
+    return true;
+}
+
+//
+// Unique vertex key for indexed OBJ loading - the face color only
+// takes part if vertex colors are enabled, otherwise it's always 0.
+//
+struct OBJVertexKey
+{
+    int      vertexIndex   = -1;
+    int      normalIndex   = -1;
+    int      texCoordIndex = -1;
+    uint32_t colorIndex    = 0;
+
+    bool operator==(const OBJVertexKey& rhs) const
     {
-        const size_t materialId = activeMaterialIds[i];
-        auto&        material   = materials[materialId];
+        return (vertexIndex == rhs.vertexIndex) &&
+               (normalIndex == rhs.normalIndex) &&
+               (texCoordIndex == rhs.texCoordIndex) &&
+               (colorIndex == rhs.colorIndex);
+    }
+};
 
-        TriMesh::Material newMaterial = {};
-        newMaterial.name              = material.name;
-        newMaterial.id                = static_cast<uint32_t>(materialId);
-        newMaterial.F0                = glm::vec3(0.04f);
-        newMaterial.baseColor         = glm::vec3(material.diffuse[0], material.diffuse[1], material.diffuse[2]);
-        newMaterial.roughness         = material.roughness;
-        newMaterial.metalness         = material.metallic;
-        newMaterial.albedoTexture     = material.diffuse_texname;
-        newMaterial.normalTexture     = material.normal_texname;
-        newMaterial.roughnessTexture  = material.roughness_texname;
-        newMaterial.metalnessTexture  = material.metallic_texname;
-        newMaterial.aoTexture         = material.ambient_texname;
+struct OBJVertexKeyHash
+{
+    size_t operator()(const OBJVertexKey& key) const
+    {
+        uint64_t h = static_cast<uint32_t>(key.vertexIndex);
+        h          = (h * 0x9E3779B97F4A7C15ull) ^ static_cast<uint32_t>(key.normalIndex);
+        h          = (h * 0x9E3779B97F4A7C15ull) ^ static_cast<uint32_t>(key.texCoordIndex);
+        h          = (h * 0x9E3779B97F4A7C15ull) ^ key.colorIndex;
+        return static_cast<size_t>(h ^ (h >> 32));
+    }
+};
 
-        pMesh->AddMaterial(newMaterial);
+bool TriMesh::LoadOBJIndexed(const std::string& path, const std::string& mtlBaseDir, const TriMesh::Options& options, TriMesh* pMesh)
+{
+    if (pMesh == nullptr)
+    {
+        return false;
+    }
+
+    const std::vector<glm::vec3> colors = {
+        {1.0f, 0.0f, 0.0f},
+        {0.0f, 1.0f, 0.0f},
+        {0.0f, 0.0f, 1.0f},
+        {1.0f, 1.0f, 0.0f},
+        {1.0f, 0.0f, 1.0f},
+        {0.0f, 1.0f, 1.0f},
+        {1.0f, 1.0f, 1.0f},
+    };
+
+    tinyobj::attrib_t                attrib;
+    std::vector<tinyobj::shape_t>    shapes;
+    std::vector<tinyobj::material_t> materials;
+
+    std::string warn;
+    std::string err;
+    bool        loaded = tinyobj::LoadObj(&attrib, &shapes, &materials, &warn, &err, path.c_str(), mtlBaseDir.c_str(), true);
+
+    if (!loaded || !err.empty())
+    {
+        return false;
+    }
+
+    size_t numShapes = shapes.size();
+    if (numShapes == 0)
+    {
+        return false;
+    }
+
+    // Create mesh
+    *pMesh = TriMesh(options);
+
+    std::vector<int> activeMaterialIds;
+
+    // Transform options
+    glm::mat4 transformMat = glm::mat4(1);
+    glm::mat4 rotationMat  = glm::mat4(1);
+    if (options.applyTransform)
+    {
+        glm::mat4 T  = glm::translate(options.transformTranslate);
+        glm::mat4 Rx = glm::rotate(options.transformRotate.x, glm::vec3(1, 0, 0));
+        glm::mat4 Ry = glm::rotate(options.transformRotate.y, glm::vec3(0, 1, 0));
+        glm::mat4 Rz = glm::rotate(options.transformRotate.z, glm::vec3(0, 0, 1));
+        glm::mat4 S  = glm::scale(options.transformScale);
+        rotationMat  = Rx * Ry * Rz;
+        transformMat = T * rotationMat * S;
+    }
+
+    std::unordered_map<OBJVertexKey, uint32_t, OBJVertexKeyHash> uniqueVertices;
+    uniqueVertices.reserve(attrib.vertices.size() / 3);
+
+    // Returns the mesh vertex index for an OBJ index triple, adding a new vertex on first use
+    auto GetOrAddVertex = [&](const tinyobj::index_t& dataIdx, uint32_t colorIndex) -> uint32_t {
+        OBJVertexKey key  = {};
+        key.vertexIndex   = dataIdx.vertex_index;
+        key.normalIndex   = options.enableNormals ? dataIdx.normal_index : -1;
+        key.texCoordIndex = options.enableTexCoords ? dataIdx.texcoord_index : -1;
+        key.colorIndex    = options.enableVertexColors ? colorIndex : 0;
+
+        auto it = uniqueVertices.find(key);
+        if (it != uniqueVertices.end())
+        {
+            return it->second;
+        }
+
+        TriMesh::Vertex vtx = {};
+        vtx.vertexColor     = colors[key.colorIndex];
+
+        // Position
+        {
+            int i0       = 3 * key.vertexIndex + 0;
+            int i1       = 3 * key.vertexIndex + 1;
+            int i2       = 3 * key.vertexIndex + 2;
+            vtx.position = glm::vec3(attrib.vertices[i0], attrib.vertices[i1], attrib.vertices[i2]);
+        }
+
+        // TexCoord
+        if (key.texCoordIndex != -1)
+        {
+            int i0       = 2 * key.texCoordIndex + 0;
+            int i1       = 2 * key.texCoordIndex + 1;
+            vtx.texCoord = glm::vec2(attrib.texcoords[i0], attrib.texcoords[i1]);
+            vtx.texCoord *= options.texCoordScale;
+
+            if (options.invertTexCoordsV)
+            {
+                vtx.texCoord.y = 1.0f - vtx.texCoord.y;
+            }
+        }
+
+        // Normal
+        if (key.normalIndex != -1)
+        {
+            int i0     = 3 * key.normalIndex + 0;
+            int i1     = 3 * key.normalIndex + 1;
+            int i2     = 3 * key.normalIndex + 2;
+            vtx.normal = glm::vec3(attrib.normals[i0], attrib.normals[i1], attrib.normals[i2]);
+        }
+
+        if (options.applyTransform)
+        {
+            vtx.position = transformMat * glm::vec4(vtx.position, 1);
+            vtx.normal   = rotationMat * glm::vec4(vtx.normal, 0);
+        }
+
+        pMesh->AddVertex(vtx);
+
+        uint32_t vIdx       = pMesh->GetNumVertices() - 1;
+        uniqueVertices[key] = vIdx;
+        return vIdx;
+    };
+
+    // Build geometry
+    for (size_t shapeIdx = 0; shapeIdx < numShapes; ++shapeIdx)
+    {
+        const tinyobj::shape_t& shape     = shapes[shapeIdx];
+        const tinyobj::mesh_t&  shapeMesh = shape.mesh;
+
+        TriMesh::Group newGroup(shape.name);
+
+        size_t numTriangles = shapeMesh.indices.size() / 3;
+        for (size_t triIdx = 0; triIdx < numTriangles; ++triIdx)
+        {
+            // Pick a face color
+            uint32_t colorIndex = static_cast<uint32_t>(triIdx % colors.size());
+
+            uint32_t vIdx0 = GetOrAddVertex(shapeMesh.indices[triIdx * 3 + 0], colorIndex);
+            uint32_t vIdx1 = GetOrAddVertex(shapeMesh.indices[triIdx * 3 + 1], colorIndex);
+            uint32_t vIdx2 = GetOrAddVertex(shapeMesh.indices[triIdx * 3 + 2], colorIndex);
+
+            uint32_t triangleIndex = pMesh->AddTriangle(vIdx0, vIdx1, vIdx2);
+            int32_t  materialIndex = GetActiveMaterialIndex(shapeMesh.material_ids[triIdx], activeMaterialIds);
+
+            newGroup.AddTriangleIndex(triangleIndex, materialIndex);
+        }
+
+        uint32_t res = pMesh->AddGroup(newGroup);
+        assert((res != UINT32_MAX) && "AddGroup (LoadOBJIndexed) failed");
     }
 
+#if defined(TRIMESH_USE_MIKKTSPACE)
+    CalculateTangents::CalculateParallel(pMesh, DEFAULT_TANGENT_CHUNK_SIZE);
+#endif
+
+    // Materials
+    //
+    // Only copy the materials in \b activeMaterialIds.
+    //
+    AddOBJMaterials(materials, activeMaterialIds, pMesh);
+
     return true;
 }
 
@@ -1839,107 +3030,1417 @@ bool TriMesh::LoadOBJ2(const std::string& path, TriMesh* pMesh)
     return true;
 }
 
-bool TriMesh::WriteOBJ(const std::string path, const TriMesh& mesh)
+// -------------------------------------------------------------------------------------------------
+// Parallel OBJ parser
+// -------------------------------------------------------------------------------------------------
+namespace
 {
-    std::ofstream os = std::ofstream(path.c_str());
-    if (!os.is_open())
+
+// Smallest chunk of the file handed to a single thread
+const size_t kOBJMinChunkSize = 1024 * 1024;
+
+struct OBJCorner
+{
+    int32_t vertexIndex   = -1;
+    int32_t texCoordIndex = -1;
+    int32_t normalIndex   = -1;
+};
+
+// Group (g/o) or material (usemtl) change that applies from
+// \b triangleIndex (chunk local) onwards.
+struct OBJStateChange
+{
+    uint32_t    triangleIndex = 0;
+    bool        isMaterial    = false;
+    std::string name          = "";
+};
+
+struct OBJChunk
+{
+    const char* pBegin        = nullptr;
+    const char* pEnd          = nullptr;
+    uint32_t    numPositions  = 0;
+    uint32_t    numTexCoords  = 0;
+    uint32_t    numNormals    = 0;
+    uint32_t    firstPosition = 0;
+    uint32_t    firstTexCoord = 0;
+    uint32_t    firstNormal   = 0;
+
+    std::vector<OBJCorner>      corners; // 3 per triangle, polygons are fan triangulated
+    std::vector<OBJStateChange> stateChanges;
+    std::vector<std::string>    mtlLibs;
+    bool                        texCoordsAligned = true;
+    bool                        normalsAligned   = true;
+    bool                        failed           = false;
+};
+
+inline bool IsOBJSpace(char c)
+{
+    return (c == ' ') || (c == '\t') || (c == '\r');
+}
+
+inline const char* SkipOBJSpaces(const char* p, const char* pEnd)
+{
+    while ((p < pEnd) && IsOBJSpace(*p))
     {
-        return false;
+        ++p;
     }
+    return p;
+}
 
-    bool writeTexCoords = mesh.GetOptions().enableTexCoords;
-    bool writeNormals   = mesh.GetOptions().enableNormals;
+inline const char* FindOBJLineEnd(const char* p, const char* pEnd)
+{
+    const char* pNewLine = static_cast<const char*>(memchr(p, '\n', static_cast<size_t>(pEnd - p)));
+    return (pNewLine != nullptr) ? pNewLine : pEnd;
+}
 
-    os << std::setprecision(6);
-    os << std::fixed;
+// Returns nullptr if there's no number at \b p
+const char* ParseOBJFloat(const char* p, const char* pEnd, float* pValue)
+{
+    p = SkipOBJSpaces(p, pEnd);
+    if ((p < pEnd) && (*p == '+'))
+    {
+        ++p;
+    }
 
-    os << "# vertices\n";
+#if defined(__cpp_lib_to_chars)
+    auto res = std::from_chars(p, pEnd, *pValue);
+    return (res.ec == std::errc()) ? res.ptr : nullptr;
+#else
+    // The mapped file isn't null terminated so strtof needs a copy
+    char   buffer[64] = {};
+    size_t length     = 0;
+    while ((p + length < pEnd) && (length < (sizeof(buffer) - 1)) && !IsOBJSpace(p[length]) && (p[length] != '\n'))
     {
-        auto& positions = mesh.GetPositions();
-        for (auto& v : positions)
-        {
-            os << "v " << v.x << " " << v.y << " " << v.z << "\n";
-        }
+        buffer[length] = p[length];
+        ++length;
     }
+    char* pNext = nullptr;
+    *pValue     = strtof(buffer, &pNext);
+    return (pNext != buffer) ? (p + (pNext - buffer)) : nullptr;
+#endif
+}
 
-    if (writeTexCoords)
+const char* ParseOBJInt(const char* p, const char* pEnd, int32_t* pValue)
+{
+    auto res = std::from_chars(p, pEnd, *pValue);
+    return (res.ec == std::errc()) ? res.ptr : nullptr;
+}
+
+// Converts 1 based or negative (relative) OBJ indices to 0 based absolute indices,
+// \b count is the number of elements defined before the current line.
+inline int32_t ResolveOBJIndex(int32_t index, uint32_t count)
+{
+    if (index > 0)
     {
-        os << "# texture coordinates\n";
-        {
-            auto& texCoords = mesh.GetTexCoords();
-            for (auto& vt : texCoords)
-            {
-                os << "vt " << vt.x << " " << vt.y << "\n";
-            }
-        }
+        return (static_cast<uint32_t>(index) <= count) ? (index - 1) : -2;
     }
+    if (index < 0)
+    {
+        return ((static_cast<int64_t>(count) + index) >= 0) ? static_cast<int32_t>(count + index) : -2;
+    }
+    return -2;
+}
 
-    if (writeNormals)
+std::string ParseOBJName(const char* p, const char* pLineEnd)
+{
+    p = SkipOBJSpaces(p, pLineEnd);
+
+    const char* pNameEnd = pLineEnd;
+    while ((pNameEnd > p) && IsOBJSpace(*(pNameEnd - 1)))
     {
-        os << "# normals\n";
+        --pNameEnd;
+    }
+    return std::string(p, pNameEnd);
+}
+
+// Counts the v/vt/vn records so that the parse pass can write
+// attributes directly to their final location.
+void CountOBJRecords(OBJChunk& chunk)
+{
+    const char* p = chunk.pBegin;
+    while (p < chunk.pEnd)
+    {
+        const char* pLineEnd = FindOBJLineEnd(p, chunk.pEnd);
+
+        p = SkipOBJSpaces(p, pLineEnd);
+        if (((pLineEnd - p) > 2) && (p[0] == 'v'))
         {
-            auto& normals = mesh.GetNormals();
-            for (auto& vn : normals)
+            if (IsOBJSpace(p[1]))
             {
-                os << "vn " << vn.x << " " << vn.y << " " << vn.z << "\n";
+                ++chunk.numPositions;
+            }
+            else if ((p[1] == 't') && IsOBJSpace(p[2]))
+            {
+                ++chunk.numTexCoords;
+            }
+            else if ((p[1] == 'n') && IsOBJSpace(p[2]))
+            {
+                ++chunk.numNormals;
             }
         }
+
+        p = pLineEnd + 1;
     }
+}
 
-    os << "# triangle faces\n";
-    os << "g"
-       << " " << std::filesystem::path(path).filename().replace_extension("") << "\n";
+void ParseOBJChunk(
+    OBJChunk&               chunk,
+    std::vector<glm::vec3>& positions,
+    std::vector<glm::vec2>& texCoords,
+    std::vector<glm::vec3>& normals)
+{
+    uint32_t numPositions = chunk.firstPosition;
+    uint32_t numTexCoords = chunk.firstTexCoord;
+    uint32_t numNormals   = chunk.firstNormal;
+
+    std::vector<OBJCorner> polygon;
+
+    const char* p = chunk.pBegin;
+    while (p < chunk.pEnd)
     {
-        auto& triangles = mesh.GetTriangles();
-        for (auto& tri : triangles)
+        const char* pLineEnd = FindOBJLineEnd(p, chunk.pEnd);
+        const char* pNext    = pLineEnd + 1;
+
+        p = SkipOBJSpaces(p, pLineEnd);
+        if ((p == pLineEnd) || (*p == '#'))
         {
-            // OBJ indices are 1 based
-            uint32_t vIdx0 = tri.vIdx0 + 1;
-            uint32_t vIdx1 = tri.vIdx1 + 1;
-            uint32_t vIdx2 = tri.vIdx2 + 1;
+            p = pNext;
+            continue;
+        }
 
-            os << "f";
-            os << " ";
+        const char* pToken    = p;
+        const char* pTokenEnd = p;
+        while ((pTokenEnd < pLineEnd) && !IsOBJSpace(*pTokenEnd))
+        {
+            ++pTokenEnd;
+        }
+        const std::string_view token(pToken, static_cast<size_t>(pTokenEnd - pToken));
 
-            os << vIdx0;
-            os << "/";
-            if (writeTexCoords)
-            {
-                os << vIdx0;
-            }
-            os << "/";
-            if (writeNormals)
+        p = pTokenEnd;
+        if (token == "v")
+        {
+            glm::vec3 value = glm::vec3(0);
+            for (int i = 0; (i < 3) && (p != nullptr); ++i)
             {
-                os << vIdx0;
+                p = ParseOBJFloat(p, pLineEnd, &value[i]);
             }
-            os << " ";
-
-            os << vIdx1;
-            os << "/";
-            if (writeTexCoords)
+            if (p == nullptr)
             {
-                os << vIdx1;
+                chunk.failed = true;
+                return;
             }
-            os << "/";
-            if (writeNormals)
+            positions[numPositions++] = value;
+        }
+        else if (token == "vt")
+        {
+            // The second (and third) tex coord components are optional
+            glm::vec2 value = glm::vec2(0);
+            p               = ParseOBJFloat(p, pLineEnd, &value.x);
+            if (p == nullptr)
             {
-                os << vIdx1;
+                chunk.failed = true;
+                return;
             }
-            os << " ";
-
-            os << vIdx2;
-            os << "/";
-            if (writeTexCoords)
+            ParseOBJFloat(p, pLineEnd, &value.y);
+            texCoords[numTexCoords++] = value;
+        }
+        else if (token == "vn")
+        {
+            glm::vec3 value = glm::vec3(0);
+            for (int i = 0; (i < 3) && (p != nullptr); ++i)
             {
-                os << vIdx2;
+                p = ParseOBJFloat(p, pLineEnd, &value[i]);
             }
-            os << "/";
-            if (writeNormals)
+            if (p == nullptr)
             {
-                os << vIdx2;
+                chunk.failed = true;
+                return;
             }
-            os << "\n";
+            normals[numNormals++] = value;
         }
+        else if (token == "f")
+        {
+            // Corners are v, v/vt, v//vn or v/vt/vn
+            polygon.clear();
+            while (true)
+            {
+                p = SkipOBJSpaces(p, pLineEnd);
+                if (p >= pLineEnd)
+                {
+                    break;
+                }
+
+                OBJCorner corner = {};
+                int32_t   index  = 0;
+
+                p = ParseOBJInt(p, pLineEnd, &index);
+                if (p == nullptr)
+                {
+                    chunk.failed = true;
+                    return;
+                }
+                corner.vertexIndex = ResolveOBJIndex(index, numPositions);
+
+                // Tex coord and normal indices can be empty, i.e. "v//" or "v//vn"
+                for (int32_t* pIndex : {&corner.texCoordIndex, &corner.normalIndex})
+                {
+                    if ((p >= pLineEnd) || (*p != '/'))
+                    {
+                        break;
+                    }
+                    ++p;
+                    if ((p < pLineEnd) && !IsOBJSpace(*p) && (*p != '/'))
+                    {
+                        p = ParseOBJInt(p, pLineEnd, &index);
+                        if (p == nullptr)
+                        {
+                            chunk.failed = true;
+                            return;
+                        }
+                        const uint32_t count = (pIndex == &corner.texCoordIndex) ? numTexCoords : numNormals;
+                        *pIndex              = ResolveOBJIndex(index, count);
+                    }
+                }
+
+                if ((corner.vertexIndex == -2) || (corner.texCoordIndex == -2) || (corner.normalIndex == -2))
+                {
+                    chunk.failed = true;
+                    return;
+                }
+
+                polygon.push_back(corner);
+            }
+
+            if (polygon.size() < 3)
+            {
+                chunk.failed = true;
+                return;
+            }
+
+            for (auto& corner : polygon)
+            {
+                chunk.texCoordsAligned = chunk.texCoordsAligned && ((corner.texCoordIndex == -1) || (corner.texCoordIndex == corner.vertexIndex));
+                chunk.normalsAligned   = chunk.normalsAligned && ((corner.normalIndex == -1) || (corner.normalIndex == corner.vertexIndex));
+            }
+
+            for (size_t i = 2; i < polygon.size(); ++i)
+            {
+                chunk.corners.push_back(polygon[0]);
+                chunk.corners.push_back(polygon[i - 1]);
+                chunk.corners.push_back(polygon[i]);
+            }
+        }
+        else if ((token == "g") || (token == "o"))
+        {
+            OBJStateChange change = {};
+            change.triangleIndex  = static_cast<uint32_t>(chunk.corners.size() / 3);
+            change.isMaterial     = false;
+            change.name           = ParseOBJName(p, pLineEnd);
+            chunk.stateChanges.push_back(change);
+        }
+        else if (token == "usemtl")
+        {
+            OBJStateChange change = {};
+            change.triangleIndex  = static_cast<uint32_t>(chunk.corners.size() / 3);
+            change.isMaterial     = true;
+            change.name           = ParseOBJName(p, pLineEnd);
+            chunk.stateChanges.push_back(change);
+        }
+        else if (token == "mtllib")
+        {
+            chunk.mtlLibs.push_back(ParseOBJName(p, pLineEnd));
+        }
+
+        p = pNext;
+    }
+}
+
+} // namespace
+
+bool TriMesh::LoadOBJParallel(const std::string& path, const std::string& mtlBaseDir, const TriMesh::Options& options, TriMesh* pMesh)
+{
+    if (pMesh == nullptr)
+    {
+        return false;
+    }
+
+    MappedFile file;
+    if (!file.Open(path))
+    {
+        return false;
+    }
+
+    const char*  pFileData = file.GetData();
+    const size_t fileSize  = file.GetSize();
+
+    // Split the file into line aligned chunks
+    std::vector<OBJChunk> chunks;
+    {
+        const size_t numThreads = std::max<size_t>(std::thread::hardware_concurrency(), 1);
+        const size_t numChunks  = std::clamp<size_t>(fileSize / kOBJMinChunkSize, 1, 8 * numThreads);
+        const size_t chunkSize  = fileSize / numChunks;
+
+        const char* pFileEnd = pFileData + fileSize;
+        const char* pBegin   = pFileData;
+        for (size_t i = 0; (i < numChunks) && (pBegin < pFileEnd); ++i)
+        {
+            const char* pEnd = pFileEnd;
+            if (i < (numChunks - 1))
+            {
+                pEnd = std::max(pBegin, pFileData + (i + 1) * chunkSize);
+                pEnd = std::min(FindOBJLineEnd(pEnd, pFileEnd) + 1, pFileEnd);
+            }
+
+            OBJChunk chunk = {};
+            chunk.pBegin   = pBegin;
+            chunk.pEnd     = pEnd;
+            chunks.push_back(std::move(chunk));
+
+            pBegin = pEnd;
+        }
+    }
+    const uint32_t numChunks = static_cast<uint32_t>(chunks.size());
+
+    // Count records and calculate where each chunk's attributes start
+    ParallelFor(numChunks, 1, [&chunks](uint32_t begin, uint32_t end) {
+        for (uint32_t i = begin; i < end; ++i)
+        {
+            CountOBJRecords(chunks[i]);
+        }
+    });
+
+    uint32_t positionCount = 0;
+    uint32_t texCoordCount = 0;
+    uint32_t normalCount   = 0;
+    for (auto& chunk : chunks)
+    {
+        chunk.firstPosition = positionCount;
+        chunk.firstTexCoord = texCoordCount;
+        chunk.firstNormal   = normalCount;
+        positionCount += chunk.numPositions;
+        texCoordCount += chunk.numTexCoords;
+        normalCount += chunk.numNormals;
+    }
+
+    if (positionCount == 0)
+    {
+        return false;
+    }
+
+    // Parse
+    std::vector<glm::vec3> positions(positionCount);
+    std::vector<glm::vec2> texCoords(texCoordCount);
+    std::vector<glm::vec3> normals(normalCount);
+
+    ParallelFor(numChunks, 1, [&](uint32_t begin, uint32_t end) {
+        for (uint32_t i = begin; i < end; ++i)
+        {
+            ParseOBJChunk(chunks[i], positions, texCoords, normals);
+        }
+    });
+
+    bool texCoordsAligned = true;
+    bool normalsAligned   = true;
+    for (auto& chunk : chunks)
+    {
+        if (chunk.failed)
+        {
+            GREX_LOG_ERROR("Failed to parse " << path);
+            return false;
+        }
+        texCoordsAligned = texCoordsAligned && chunk.texCoordsAligned;
+        normalsAligned   = normalsAligned && chunk.normalsAligned;
+    }
+
+    // Materials
+    std::vector<tinyobj::material_t> materials;
+    std::map<std::string, int>       materialMap;
+    for (auto& chunk : chunks)
+    {
+        for (auto& mtlLib : chunk.mtlLibs)
+        {
+            auto          mtlPath = mtlBaseDir.empty() ? std::filesystem::path(mtlLib) : (std::filesystem::path(mtlBaseDir) / mtlLib);
+            std::ifstream mtlStream(mtlPath);
+            if (!mtlStream.is_open())
+            {
+                GREX_LOG_WARN("Failed to open material library " << mtlPath);
+                continue;
+            }
+
+            std::string warn;
+            std::string err;
+            tinyobj::LoadMtl(&materialMap, &materials, &mtlStream, &warn, &err);
+        }
+    }
+
+    // Create mesh
+    *pMesh = TriMesh(options);
+
+    // Transform options
+    glm::mat4 transformMat = glm::mat4(1);
+    glm::mat4 rotationMat  = glm::mat4(1);
+    if (options.applyTransform)
+    {
+        glm::mat4 T  = glm::translate(options.transformTranslate);
+        glm::mat4 Rx = glm::rotate(options.transformRotate.x, glm::vec3(1, 0, 0));
+        glm::mat4 Ry = glm::rotate(options.transformRotate.y, glm::vec3(0, 1, 0));
+        glm::mat4 Rz = glm::rotate(options.transformRotate.z, glm::vec3(0, 0, 1));
+        glm::mat4 S  = glm::scale(options.transformScale);
+        rotationMat  = Rx * Ry * Rz;
+        transformMat = T * rotationMat * S;
+    }
+
+    auto TransformTexCoord = [&options](glm::vec2 texCoord) -> glm::vec2 {
+        texCoord *= options.texCoordScale;
+        if (options.invertTexCoordsV)
+        {
+            texCoord.y = 1.0f - texCoord.y;
+        }
+        return texCoord;
+    };
+
+    const std::vector<glm::vec3> colors = {
+        {1.0f, 0.0f, 0.0f},
+        {0.0f, 1.0f, 0.0f},
+        {0.0f, 0.0f, 1.0f},
+        {1.0f, 1.0f, 0.0f},
+        {1.0f, 0.0f, 1.0f},
+        {0.0f, 1.0f, 1.0f},
+        {1.0f, 1.0f, 1.0f},
+    };
+
+    //
+    // If the enabled attributes use the same indices as the positions the
+    // OBJ vertices can be copied directly. Face colors need unique vertices
+    // per face so they always go through the indexed path.
+    //
+    const bool useOBJVertices = !options.enableVertexColors &&
+                                (!options.enableTexCoords || texCoordsAligned) &&
+                                (!options.enableNormals || normalsAligned);
+
+    // Stitch chunks
+    std::vector<OBJCorner>   corners;
+    std::vector<std::string> groupNames;
+    std::vector<uint32_t>    triangleGroups;
+    std::vector<int32_t>     triangleMaterials;
+    std::vector<int>         activeMaterialIds;
+    {
+        size_t numCorners = 0;
+        for (auto& chunk : chunks)
+        {
+            numCorners += chunk.corners.size();
+        }
+        corners.reserve(numCorners);
+        triangleGroups.reserve(numCorners / 3);
+        triangleMaterials.reserve(numCorners / 3);
+
+        // Group and material state carries over chunk boundaries
+        uint32_t groupIndex    = UINT32_MAX;
+        int32_t  materialIndex = -1;
+
+        auto SetGroup = [&](std::string name) {
+            if (name.empty())
+            {
+                name = "default";
+            }
+            auto it = std::find(groupNames.begin(), groupNames.end(), name);
+            if (it == groupNames.end())
+            {
+                groupNames.push_back(name);
+                it = groupNames.end() - 1;
+            }
+            groupIndex = static_cast<uint32_t>(std::distance(groupNames.begin(), it));
+        };
+
+        for (auto& chunk : chunks)
+        {
+            const uint32_t numChunkTriangles = static_cast<uint32_t>(chunk.corners.size() / 3);
+
+            size_t changeIdx = 0;
+            for (uint32_t triIdx = 0; triIdx < numChunkTriangles; ++triIdx)
+            {
+                while ((changeIdx < chunk.stateChanges.size()) && (chunk.stateChanges[changeIdx].triangleIndex == triIdx))
+                {
+                    auto& change = chunk.stateChanges[changeIdx];
+                    if (change.isMaterial)
+                    {
+                        auto it       = materialMap.find(change.name);
+                        materialIndex = (it != materialMap.end()) ? GetActiveMaterialIndex(it->second, activeMaterialIds) : -1;
+                    }
+                    else
+                    {
+                        SetGroup(change.name);
+                    }
+                    ++changeIdx;
+                }
+
+                if (groupIndex == UINT32_MAX)
+                {
+                    SetGroup("");
+                }
+
+                triangleGroups.push_back(groupIndex);
+                triangleMaterials.push_back(materialIndex);
+            }
+
+            // Changes after the last face still apply to the next chunk
+            for (; changeIdx < chunk.stateChanges.size(); ++changeIdx)
+            {
+                auto& change = chunk.stateChanges[changeIdx];
+                if (change.isMaterial)
+                {
+                    auto it       = materialMap.find(change.name);
+                    materialIndex = (it != materialMap.end()) ? GetActiveMaterialIndex(it->second, activeMaterialIds) : -1;
+                }
+                else
+                {
+                    SetGroup(change.name);
+                }
+            }
+
+            corners.insert(corners.end(), chunk.corners.begin(), chunk.corners.end());
+            chunk.corners = {};
+        }
+    }
+    const uint32_t numTriangles = static_cast<uint32_t>(corners.size() / 3);
+
+    if (useOBJVertices)
+    {
+        if (options.applyTransform)
+        {
+            for (auto& position : positions)
+            {
+                position = transformMat * glm::vec4(position, 1);
+            }
+        }
+        pMesh->SetPositions(positionCount, positions.data());
+
+        if (options.enableTexCoords)
+        {
+            std::vector<glm::vec2> vertexTexCoords(positionCount, glm::vec2(0));
+            for (auto& corner : corners)
+            {
+                if (corner.texCoordIndex != -1)
+                {
+                    vertexTexCoords[corner.vertexIndex] = TransformTexCoord(texCoords[corner.texCoordIndex]);
+                }
+            }
+            pMesh->SetTexCoords(positionCount, vertexTexCoords.data());
+        }
+
+        if (options.enableNormals)
+        {
+            std::vector<glm::vec3> vertexNormals(positionCount, glm::vec3(0));
+            for (auto& corner : corners)
+            {
+                if (corner.normalIndex != -1)
+                {
+                    vertexNormals[corner.vertexIndex] = rotationMat * glm::vec4(normals[corner.normalIndex], 0);
+                }
+            }
+            pMesh->SetNormals(positionCount, vertexNormals.data());
+        }
+
+        // Same zero filled streams AddVertex gives the indexed path, tangent
+        // generation writes into them per vertex
+        if (options.enableTangents)
+        {
+            pMesh->mTangents.assign(positionCount, glm::vec3(0));
+            pMesh->mBitangents.assign(positionCount, glm::vec3(0));
+        }
+
+        for (uint32_t triIdx = 0; triIdx < numTriangles; ++triIdx)
+        {
+            pMesh->AddTriangle(
+                static_cast<uint32_t>(corners[3 * triIdx + 0].vertexIndex),
+                static_cast<uint32_t>(corners[3 * triIdx + 1].vertexIndex),
+                static_cast<uint32_t>(corners[3 * triIdx + 2].vertexIndex));
+        }
+    }
+    else
+    {
+        std::unordered_map<OBJVertexKey, uint32_t, OBJVertexKeyHash> uniqueVertices;
+        uniqueVertices.reserve(positionCount);
+
+        std::vector<uint32_t> groupTriangleCounts(groupNames.size(), 0);
+        for (uint32_t triIdx = 0; triIdx < numTriangles; ++triIdx)
+        {
+            // Pick a face color, counting triangles per group like LoadOBJ
+            uint32_t colorIndex = static_cast<uint32_t>(groupTriangleCounts[triangleGroups[triIdx]]++ % colors.size());
+
+            uint32_t vIdx[3] = {};
+            for (uint32_t i = 0; i < 3; ++i)
+            {
+                const OBJCorner& corner = corners[3 * triIdx + i];
+
+                OBJVertexKey key  = {};
+                key.vertexIndex   = corner.vertexIndex;
+                key.normalIndex   = options.enableNormals ? corner.normalIndex : -1;
+                key.texCoordIndex = options.enableTexCoords ? corner.texCoordIndex : -1;
+                key.colorIndex    = options.enableVertexColors ? colorIndex : 0;
+
+                auto it = uniqueVertices.find(key);
+                if (it != uniqueVertices.end())
+                {
+                    vIdx[i] = it->second;
+                    continue;
+                }
+
+                TriMesh::Vertex vtx = {};
+                vtx.position        = positions[key.vertexIndex];
+                vtx.vertexColor     = colors[key.colorIndex];
+                if (key.texCoordIndex != -1)
+                {
+                    vtx.texCoord = TransformTexCoord(texCoords[key.texCoordIndex]);
+                }
+                if (key.normalIndex != -1)
+                {
+                    vtx.normal = normals[key.normalIndex];
+                }
+
+                if (options.applyTransform)
+                {
+                    vtx.position = transformMat * glm::vec4(vtx.position, 1);
+                    vtx.normal   = rotationMat * glm::vec4(vtx.normal, 0);
+                }
+
+                pMesh->AddVertex(vtx);
+
+                vIdx[i]             = pMesh->GetNumVertices() - 1;
+                uniqueVertices[key] = vIdx[i];
+            }
+
+            pMesh->AddTriangle(vIdx[0], vIdx[1], vIdx[2]);
+        }
+    }
+
+    // Groups
+    {
+        std::vector<TriMesh::Group> groups;
+        for (auto& name : groupNames)
+        {
+            groups.push_back(TriMesh::Group(name));
+        }
+        for (uint32_t triIdx = 0; triIdx < numTriangles; ++triIdx)
+        {
+            groups[triangleGroups[triIdx]].AddTriangleIndex(triIdx, triangleMaterials[triIdx]);
+        }
+
+        bool res = pMesh->AddGroups(groups);
+        assert(res && "AddGroups (LoadOBJParallel) failed");
+    }
+
+#if defined(TRIMESH_USE_MIKKTSPACE)
+    CalculateTangents::CalculateParallel(pMesh, DEFAULT_TANGENT_CHUNK_SIZE);
+#endif
+
+    // Materials
+    //
+    // Only copy the materials in \b activeMaterialIds.
+    //
+    AddOBJMaterials(materials, activeMaterialIds, pMesh);
+
+    pMesh->CalculateBounds();
+
+    GREX_LOG_INFO("Loaded " << path);
+    GREX_LOG_INFO("  num vertices: " << pMesh->GetNumVertices());
+    GREX_LOG_INFO("  num indices : " << pMesh->GetNumIndices());
+
+    return true;
+}
+
+bool TriMesh::WriteOBJ(const std::string path, const TriMesh& mesh)
+{
+    std::ofstream os = std::ofstream(path.c_str());
+    if (!os.is_open())
+    {
+        return false;
+    }
+
+    bool writeTexCoords = mesh.GetOptions().enableTexCoords;
+    bool writeNormals   = mesh.GetOptions().enableNormals;
+
+    os << std::setprecision(6);
+    os << std::fixed;
+
+    os << "# vertices\n";
+    {
+        auto& positions = mesh.GetPositions();
+        for (auto& v : positions)
+        {
+            os << "v " << v.x << " " << v.y << " " << v.z << "\n";
+        }
+    }
+
+    if (writeTexCoords)
+    {
+        os << "# texture coordinates\n";
+        {
+            auto& texCoords = mesh.GetTexCoords();
+            for (auto& vt : texCoords)
+            {
+                os << "vt " << vt.x << " " << vt.y << "\n";
+            }
+        }
+    }
+
+    if (writeNormals)
+    {
+        os << "# normals\n";
+        {
+            auto& normals = mesh.GetNormals();
+            for (auto& vn : normals)
+            {
+                os << "vn " << vn.x << " " << vn.y << " " << vn.z << "\n";
+            }
+        }
+    }
+
+    os << "# triangle faces\n";
+    os << "g"
+       << " " << std::filesystem::path(path).filename().replace_extension("") << "\n";
+    {
+        auto& triangles = mesh.GetTriangles();
+        for (auto& tri : triangles)
+        {
+            // OBJ indices are 1 based
+            uint32_t vIdx0 = tri.vIdx0 + 1;
+            uint32_t vIdx1 = tri.vIdx1 + 1;
+            uint32_t vIdx2 = tri.vIdx2 + 1;
+
+            os << "f";
+            os << " ";
+
+            os << vIdx0;
+            os << "/";
+            if (writeTexCoords)
+            {
+                os << vIdx0;
+            }
+            os << "/";
+            if (writeNormals)
+            {
+                os << vIdx0;
+            }
+            os << " ";
+
+            os << vIdx1;
+            os << "/";
+            if (writeTexCoords)
+            {
+                os << vIdx1;
+            }
+            os << "/";
+            if (writeNormals)
+            {
+                os << vIdx1;
+            }
+            os << " ";
+
+            os << vIdx2;
+            os << "/";
+            if (writeTexCoords)
+            {
+                os << vIdx2;
+            }
+            os << "/";
+            if (writeNormals)
+            {
+                os << vIdx2;
+            }
+            os << "\n";
+        }
+    }
+
+    return true;
+}
+
+// -------------------------------------------------------------------------------------------------
+// Binary format
+// -------------------------------------------------------------------------------------------------
+static_assert(sizeof(TriMesh::Meshlet) == 16, "TriMesh::Meshlet must match meshopt_Meshlet");
+static_assert(sizeof(TriMesh::Triangle) == 12, "TriMesh::Triangle must be tightly packed");
+static_assert(sizeof(TriMesh::BinaryHeader) % 8 == 0, "TriMesh::BinaryHeader must not have tail padding");
+
+namespace
+{
+
+inline uint64_t HashMix64(uint64_t h)
+{
+    h ^= h >> 33;
+    h *= 0xFF51AFD7ED558CCDull;
+    h ^= h >> 33;
+    h *= 0xC4CEB9FE1A85EC53ull;
+    h ^= h >> 33;
+    return h;
+}
+
+// Not cryptographic, only used to detect stale cache files
+uint64_t HashBytes(const void* pData, size_t size, uint64_t seed)
+{
+    const uint8_t* pBytes = static_cast<const uint8_t*>(pData);
+
+    uint64_t h        = HashMix64(seed ^ (size * 0x9E3779B97F4A7C15ull));
+    size_t   numWords = size / 8;
+    for (size_t i = 0; i < numWords; ++i)
+    {
+        uint64_t word = 0;
+        memcpy(&word, pBytes + 8 * i, 8);
+        h = (h ^ HashMix64(word)) * 0x9E3779B97F4A7C15ull;
+    }
+
+    uint64_t tail = 0;
+    memcpy(&tail, pBytes + 8 * numWords, size - 8 * numWords);
+    h = (h ^ HashMix64(tail)) * 0x9E3779B97F4A7C15ull;
+
+    return HashMix64(h);
+}
+
+// Folds the contents of the material libraries an OBJ file references
+// into \b hash so that editing a .mtl file invalidates the cache. A
+// library that can't be read only contributes its path.
+uint64_t HashOBJMaterialLibraries(const char* pData, size_t size, const std::string& mtlBaseDir, uint64_t hash)
+{
+    const std::string_view kToken = "mtllib";
+    const std::string_view contents(pData, size);
+    const char*            pEnd = pData + size;
+
+    for (size_t pos = contents.find(kToken); pos != std::string_view::npos; pos = contents.find(kToken, pos + kToken.size()))
+    {
+        // Only at the start of a line, leading spaces are fine
+        size_t lineStart = pos;
+        while ((lineStart > 0) && IsOBJSpace(contents[lineStart - 1]))
+        {
+            --lineStart;
+        }
+        const char* pToken = pData + pos + kToken.size();
+        if (((lineStart > 0) && (contents[lineStart - 1] != '\n')) || (pToken >= pEnd) || !IsOBJSpace(*pToken))
+        {
+            continue;
+        }
+
+        std::string mtlLib        = ParseOBJName(pToken, FindOBJLineEnd(pToken, pEnd));
+        auto        mtlPath       = mtlBaseDir.empty() ? std::filesystem::path(mtlLib) : (std::filesystem::path(mtlBaseDir) / mtlLib);
+        std::string mtlPathString = mtlPath.string();
+        hash                      = HashBytes(mtlPathString.data(), mtlPathString.size(), hash);
+
+        MappedFile mtlFile;
+        if (mtlFile.Open(mtlPathString))
+        {
+            hash = HashBytes(mtlFile.GetData(), mtlFile.GetSize(), hash);
+        }
+    }
+
+    return hash;
+}
+
+uint32_t GetBinaryOptionFlags(const TriMesh::Options& options)
+{
+    uint32_t flags = 0;
+    flags |= options.enableVertexColors ? (1 << 0) : 0;
+    flags |= options.enableTexCoords ? (1 << 1) : 0;
+    flags |= options.enableNormals ? (1 << 2) : 0;
+    flags |= options.enableTangents ? (1 << 3) : 0;
+    flags |= options.faceInside ? (1 << 4) : 0;
+    flags |= options.invertTexCoordsV ? (1 << 5) : 0;
+    flags |= options.applyTransform ? (1 << 6) : 0;
+    return flags;
+}
+
+class BinaryWriter
+{
+public:
+    BinaryWriter()
+    {
+        mData.resize(sizeof(TriMesh::BinaryHeader));
+    }
+
+    template <typename T>
+    TriMesh::BinarySectionRange Write(const std::vector<T>& values)
+    {
+        return Write(values.data(), values.size() * sizeof(T));
+    }
+
+    TriMesh::BinarySectionRange Write(const void* pData, size_t size)
+    {
+        TriMesh::BinarySectionRange range = {};
+        if (size == 0)
+        {
+            return range;
+        }
+
+        range.offset = Align<uint64_t>(mData.size(), TriMesh::BINARY_SECTION_ALIGNMENT);
+        range.size   = size;
+
+        mData.resize(range.offset + range.size, 0);
+        memcpy(mData.data() + range.offset, pData, size);
+
+        return range;
+    }
+
+    std::vector<uint8_t>& GetData() { return mData; }
+
+private:
+    std::vector<uint8_t> mData;
+};
+
+class StringTable
+{
+public:
+    TriMesh::BinaryString Add(const std::string& s)
+    {
+        TriMesh::BinaryString res = {};
+        res.offset                = static_cast<uint32_t>(mChars.size());
+        res.length                = static_cast<uint32_t>(s.size());
+        mChars.insert(mChars.end(), s.begin(), s.end());
+        return res;
+    }
+
+    const std::vector<char>& GetChars() const { return mChars; }
+
+private:
+    std::vector<char> mChars;
+};
+
+} // namespace
+
+bool TriMesh::SaveBinary(const std::string& path, const TriMesh& mesh, uint64_t sourceHash, const TriMesh::MeshletData* pMeshlets)
+{
+    const TriMesh::Options& options = mesh.GetOptions();
+
+    TriMesh::BinaryHeader header = {};
+    header.sourceHash            = sourceHash;
+    header.optionFlags           = GetBinaryOptionFlags(options);
+    header.center                = options.center;
+    header.texCoordScale         = options.texCoordScale;
+    header.transformTranslate    = options.transformTranslate;
+    header.transformRotate       = options.transformRotate;
+    header.transformScale        = options.transformScale;
+    header.boundsMin             = mesh.mBounds.min;
+    header.boundsMax             = mesh.mBounds.max;
+
+    StringTable                          strings;
+    std::vector<TriMesh::BinaryGroup>    groups;
+    std::vector<TriMesh::MaterialRange>  groupMaterialRanges;
+    std::vector<TriMesh::BinaryMaterial> materials;
+
+    for (auto& group : mesh.mGroups)
+    {
+        TriMesh::BinaryGroup binaryGroup = {};
+        binaryGroup.name                 = strings.Add(group.mName);
+        binaryGroup.firstTriangle        = group.mFirstTriangle;
+        binaryGroup.numTriangles         = group.mNumTriangles;
+        binaryGroup.firstMaterialRange   = static_cast<uint32_t>(groupMaterialRanges.size());
+        binaryGroup.numMaterialRanges    = static_cast<uint32_t>(group.mMaterialRanges.size());
+        binaryGroup.boundsMin            = group.mBounds.min;
+        binaryGroup.boundsMax            = group.mBounds.max;
+        groups.push_back(binaryGroup);
+
+        groupMaterialRanges.insert(groupMaterialRanges.end(), group.mMaterialRanges.begin(), group.mMaterialRanges.end());
+    }
+
+    for (auto& material : mesh.mMaterials)
+    {
+        TriMesh::BinaryMaterial binaryMaterial = {};
+        binaryMaterial.name                    = strings.Add(material.name);
+        binaryMaterial.id                      = material.id;
+        binaryMaterial.baseColor               = material.baseColor;
+        binaryMaterial.F0                      = material.F0;
+        binaryMaterial.roughness               = material.roughness;
+        binaryMaterial.metalness               = material.metalness;
+        binaryMaterial.albedoTexture           = strings.Add(material.albedoTexture);
+        binaryMaterial.normalTexture           = strings.Add(material.normalTexture);
+        binaryMaterial.roughnessTexture        = strings.Add(material.roughnessTexture);
+        binaryMaterial.metalnessTexture        = strings.Add(material.metalnessTexture);
+        binaryMaterial.aoTexture               = strings.Add(material.aoTexture);
+        materials.push_back(binaryMaterial);
+    }
+
+    BinaryWriter writer;
+    header.sections[BINARY_SECTION_POSITIONS]              = writer.Write(mesh.mPositions);
+    header.sections[BINARY_SECTION_VERTEX_COLORS]          = writer.Write(mesh.mVertexColors);
+    header.sections[BINARY_SECTION_TEX_COORDS]             = writer.Write(mesh.mTexCoords);
+    header.sections[BINARY_SECTION_NORMALS]                = writer.Write(mesh.mNormals);
+    header.sections[BINARY_SECTION_TANGENTS]               = writer.Write(mesh.mTangents);
+    header.sections[BINARY_SECTION_BITANGENTS]             = writer.Write(mesh.mBitangents);
+    header.sections[BINARY_SECTION_TRIANGLES]              = writer.Write(mesh.mTriangles);
+    header.sections[BINARY_SECTION_GROUPS]                 = writer.Write(groups);
+    header.sections[BINARY_SECTION_GROUP_MATERIAL_RANGES]  = writer.Write(groupMaterialRanges);
+    header.sections[BINARY_SECTION_MATERIALS]              = writer.Write(materials);
+    header.sections[BINARY_SECTION_STRINGS]                = writer.Write(strings.GetChars());
+
+    if (!IsNull(pMeshlets) && !pMeshlets->meshlets.empty())
+    {
+        header.meshletMaxVertices                            = pMeshlets->maxVertices;
+        header.meshletMaxTriangles                           = pMeshlets->maxTriangles;
+        header.meshletConeWeight                             = pMeshlets->coneWeight;
+        header.sections[BINARY_SECTION_MESHLETS]             = writer.Write(pMeshlets->meshlets);
+        header.sections[BINARY_SECTION_MESHLET_VERTICES]     = writer.Write(pMeshlets->vertices);
+        header.sections[BINARY_SECTION_MESHLET_TRIANGLES]    = writer.Write(pMeshlets->triangles);
+        header.sections[BINARY_SECTION_MESHLET_SPHERES]      = writer.Write(pMeshlets->boundingSpheres);
+        header.sections[BINARY_SECTION_MESHLET_CONES]        = writer.Write(pMeshlets->normalCones);
+        header.sections[BINARY_SECTION_MESHLET_CONE_APEXES]  = writer.Write(pMeshlets->coneApexes);
+        header.sections[BINARY_SECTION_MESHLET_GROUP_COUNTS] = writer.Write(pMeshlets->groupMeshletCounts);
+    }
+
+    auto& data = writer.GetData();
+    memcpy(data.data(), &header, sizeof(header));
+
+    // Write to a temporary file first so readers never see a partial file.
+    // The name is unique so processes writing the same file don't collide,
+    // the last rename wins.
+    std::stringstream tmpName;
+    tmpName << path << "." << std::hex << std::random_device()() << ".tmp";
+    std::filesystem::path tmpPath = tmpName.str();
+    {
+        std::ofstream os(tmpPath, std::ios::binary);
+        if (!os.is_open())
+        {
+            return false;
+        }
+
+        os.write(reinterpret_cast<const char*>(data.data()), static_cast<std::streamsize>(data.size()));
+        if (!os.good())
+        {
+            os.close();
+            std::error_code ec;
+            std::filesystem::remove(tmpPath, ec);
+            return false;
+        }
+    }
+
+    std::error_code ec;
+    std::filesystem::rename(tmpPath, path, ec);
+    if (ec)
+    {
+        std::filesystem::remove(tmpPath, ec);
+        return false;
+    }
+
+    return true;
+}
+
+bool TriMesh::LoadBinary(const std::string& path, TriMesh* pMesh, uint64_t sourceHash, TriMesh::MeshletData* pMeshlets)
+{
+    if (pMesh == nullptr)
+    {
+        return false;
+    }
+
+    MappedFile file;
+    if (!file.Open(path) || (file.GetSize() < sizeof(TriMesh::BinaryHeader)))
+    {
+        return false;
+    }
+
+    const char* pFileData = file.GetData();
+
+    TriMesh::BinaryHeader header = {};
+    memcpy(&header, pFileData, sizeof(header));
+
+    if ((header.magic != BINARY_MAGIC) || (header.version != BINARY_VERSION))
+    {
+        return false;
+    }
+    if ((sourceHash != 0) && (header.sourceHash != sourceHash))
+    {
+        return false;
+    }
+
+    for (auto& section : header.sections)
+    {
+        if ((section.offset > file.GetSize()) || (section.size > (file.GetSize() - section.offset)))
+        {
+            GREX_LOG_ERROR("Truncated binary mesh " << path);
+            return false;
+        }
+    }
+
+    auto ReadSection = [&](BinarySection section, auto& values) -> bool {
+        using ValueT = typename std::remove_reference_t<decltype(values)>::value_type;
+
+        const TriMesh::BinarySectionRange& range = header.sections[section];
+        if ((range.size % sizeof(ValueT)) != 0)
+        {
+            return false;
+        }
+
+        values.resize(static_cast<size_t>(range.size / sizeof(ValueT)));
+        if (range.size > 0)
+        {
+            memcpy(values.data(), pFileData + range.offset, static_cast<size_t>(range.size));
+        }
+        return true;
+    };
+
+    const char* pStrings    = pFileData + header.sections[BINARY_SECTION_STRINGS].offset;
+    const auto  stringsSize = header.sections[BINARY_SECTION_STRINGS].size;
+    auto        ReadString  = [&](const TriMesh::BinaryString& s) -> std::string {
+        if ((static_cast<uint64_t>(s.offset) + s.length) > stringsSize)
+        {
+            return "";
+        }
+        return std::string(pStrings + s.offset, s.length);
+    };
+
+    TriMesh::Options options   = {};
+    options.enableVertexColors = (header.optionFlags & (1 << 0)) != 0;
+    options.enableTexCoords    = (header.optionFlags & (1 << 1)) != 0;
+    options.enableNormals      = (header.optionFlags & (1 << 2)) != 0;
+    options.enableTangents     = (header.optionFlags & (1 << 3)) != 0;
+    options.faceInside         = (header.optionFlags & (1 << 4)) != 0;
+    options.invertTexCoordsV   = (header.optionFlags & (1 << 5)) != 0;
+    options.applyTransform     = (header.optionFlags & (1 << 6)) != 0;
+    options.center             = header.center;
+    options.texCoordScale      = header.texCoordScale;
+    options.transformTranslate = header.transformTranslate;
+    options.transformRotate    = header.transformRotate;
+    options.transformScale     = header.transformScale;
+
+    TriMesh mesh = TriMesh(options);
+
+    std::vector<TriMesh::BinaryGroup>    groups;
+    std::vector<TriMesh::MaterialRange>  groupMaterialRanges;
+    std::vector<TriMesh::BinaryMaterial> materials;
+
+    bool res = ReadSection(BINARY_SECTION_POSITIONS, mesh.mPositions) &&
+               ReadSection(BINARY_SECTION_VERTEX_COLORS, mesh.mVertexColors) &&
+               ReadSection(BINARY_SECTION_TEX_COORDS, mesh.mTexCoords) &&
+               ReadSection(BINARY_SECTION_NORMALS, mesh.mNormals) &&
+               ReadSection(BINARY_SECTION_TANGENTS, mesh.mTangents) &&
+               ReadSection(BINARY_SECTION_BITANGENTS, mesh.mBitangents) &&
+               ReadSection(BINARY_SECTION_TRIANGLES, mesh.mTriangles) &&
+               ReadSection(BINARY_SECTION_GROUPS, groups) &&
+               ReadSection(BINARY_SECTION_GROUP_MATERIAL_RANGES, groupMaterialRanges) &&
+               ReadSection(BINARY_SECTION_MATERIALS, materials);
+    if (!res)
+    {
+        GREX_LOG_ERROR("Invalid binary mesh " << path);
+        return false;
+    }
+
+    // Attribute streams are either absent or one entry per position, and
+    // every triangle has to index into them.
+    const size_t numPositions = mesh.mPositions.size();
+    auto         StreamValid  = [numPositions](const auto& values) -> bool {
+        return values.empty() || (values.size() == numPositions);
+    };
+    res = StreamValid(mesh.mVertexColors) &&
+          StreamValid(mesh.mTexCoords) &&
+          StreamValid(mesh.mNormals) &&
+          StreamValid(mesh.mTangents) &&
+          StreamValid(mesh.mBitangents);
+    for (size_t i = 0; res && (i < mesh.mTriangles.size()); ++i)
+    {
+        const auto& tri = mesh.mTriangles[i];
+        res             = (tri.vIdx0 < numPositions) && (tri.vIdx1 < numPositions) && (tri.vIdx2 < numPositions);
+    }
+    if (!res)
+    {
+        GREX_LOG_ERROR("Invalid binary mesh " << path);
+        return false;
+    }
+
+    // Groups have to be back to back from the first triangle and their
+    // material ranges have to cover them exactly.
+    uint32_t numGroupedTriangles = 0;
+    for (auto& binaryGroup : groups)
+    {
+        bool valid = (binaryGroup.firstTriangle == numGroupedTriangles) &&
+                     ((static_cast<size_t>(binaryGroup.firstTriangle) + binaryGroup.numTriangles) <= mesh.mTriangles.size()) &&
+                     ((static_cast<size_t>(binaryGroup.firstMaterialRange) + binaryGroup.numMaterialRanges) <= groupMaterialRanges.size());
+
+        uint32_t rangeTriangle = binaryGroup.firstTriangle;
+        for (uint32_t i = 0; valid && (i < binaryGroup.numMaterialRanges); ++i)
+        {
+            const auto& range = groupMaterialRanges[binaryGroup.firstMaterialRange + i];
+            valid             = (range.firstTriangle == rangeTriangle);
+            rangeTriangle += range.numTriangles;
+        }
+        valid = valid && (rangeTriangle == (binaryGroup.firstTriangle + binaryGroup.numTriangles));
+
+        if (!valid)
+        {
+            GREX_LOG_ERROR("Invalid binary mesh " << path);
+            return false;
+        }
+
+        auto rangesBegin = groupMaterialRanges.begin() + binaryGroup.firstMaterialRange;
+
+        TriMesh::Group group(ReadString(binaryGroup.name));
+        group.mFirstTriangle = binaryGroup.firstTriangle;
+        group.mNumTriangles  = binaryGroup.numTriangles;
+        group.mMaterialRanges.assign(rangesBegin, rangesBegin + binaryGroup.numMaterialRanges);
+        group.mBounds.min = binaryGroup.boundsMin;
+        group.mBounds.max = binaryGroup.boundsMax;
+        mesh.mGroups.push_back(std::move(group));
+
+        numGroupedTriangles += binaryGroup.numTriangles;
+    }
+    mesh.UpdateMaterialRanges();
+
+    for (auto& binaryMaterial : materials)
+    {
+        TriMesh::Material material = {};
+        material.name              = ReadString(binaryMaterial.name);
+        material.id                = binaryMaterial.id;
+        material.baseColor         = binaryMaterial.baseColor;
+        material.F0                = binaryMaterial.F0;
+        material.roughness         = binaryMaterial.roughness;
+        material.metalness         = binaryMaterial.metalness;
+        material.albedoTexture     = ReadString(binaryMaterial.albedoTexture);
+        material.normalTexture     = ReadString(binaryMaterial.normalTexture);
+        material.roughnessTexture  = ReadString(binaryMaterial.roughnessTexture);
+        material.metalnessTexture  = ReadString(binaryMaterial.metalnessTexture);
+        material.aoTexture         = ReadString(binaryMaterial.aoTexture);
+        mesh.mMaterials.push_back(material);
+    }
+
+    mesh.mBounds.min = header.boundsMin;
+    mesh.mBounds.max = header.boundsMax;
+
+    if (!IsNull(pMeshlets))
+    {
+        TriMesh::MeshletData meshlets = {};
+        meshlets.maxVertices          = header.meshletMaxVertices;
+        meshlets.maxTriangles         = header.meshletMaxTriangles;
+        meshlets.coneWeight           = header.meshletConeWeight;
+
+        res = ReadSection(BINARY_SECTION_MESHLETS, meshlets.meshlets) &&
+              ReadSection(BINARY_SECTION_MESHLET_VERTICES, meshlets.vertices) &&
+              ReadSection(BINARY_SECTION_MESHLET_TRIANGLES, meshlets.triangles) &&
+              ReadSection(BINARY_SECTION_MESHLET_SPHERES, meshlets.boundingSpheres) &&
+              ReadSection(BINARY_SECTION_MESHLET_CONES, meshlets.normalCones) &&
+              ReadSection(BINARY_SECTION_MESHLET_CONE_APEXES, meshlets.coneApexes) &&
+              ReadSection(BINARY_SECTION_MESHLET_GROUP_COUNTS, meshlets.groupMeshletCounts);
+        if (!res)
+        {
+            GREX_LOG_ERROR("Invalid binary mesh " << path);
+            return false;
+        }
+
+        *pMeshlets = std::move(meshlets);
+    }
+
+    *pMesh = std::move(mesh);
+
+    return true;
+}
+
+uint64_t TriMesh::CalculateSourceHash(const std::string& path, const TriMesh::Options& options)
+{
+    MappedFile file;
+    if (!file.Open(path))
+    {
+        return 0;
+    }
+
+    uint64_t hash = HashBytes(file.GetData(), file.GetSize(), BINARY_VERSION);
+
+    const float optionValues[] = {
+        options.center.x,
+        options.center.y,
+        options.center.z,
+        options.texCoordScale.x,
+        options.texCoordScale.y,
+        options.transformTranslate.x,
+        options.transformTranslate.y,
+        options.transformTranslate.z,
+        options.transformRotate.x,
+        options.transformRotate.y,
+        options.transformRotate.z,
+        options.transformScale.x,
+        options.transformScale.y,
+        options.transformScale.z,
+    };
+    hash = HashBytes(optionValues, sizeof(optionValues), hash ^ GetBinaryOptionFlags(options));
+
+    // 0 means no hash
+    return (hash != 0) ? hash : 1;
+}
+
+bool TriMesh::LoadOBJCached(
+    const std::string&                                                     path,
+    const std::string&                                                     mtlBaseDir,
+    const TriMesh::Options&                                                options,
+    TriMesh*                                                               pMesh,
+    TriMesh::MeshletData*                                                  pMeshlets,
+    const std::function<void(const TriMesh& mesh, TriMesh::MeshletData*)>& buildMeshlets)
+{
+    if (pMesh == nullptr)
+    {
+        return false;
+    }
+
+    uint64_t sourceHash = CalculateSourceHash(path, options);
+    if (sourceHash == 0)
+    {
+        return false;
+    }
+
+    // Things that don't change the file contents but change the result
+    sourceHash = HashBytes(mtlBaseDir.data(), mtlBaseDir.size(), sourceHash);
+    {
+        MappedFile file;
+        if (file.Open(path))
+        {
+            sourceHash = HashOBJMaterialLibraries(file.GetData(), file.GetSize(), mtlBaseDir, sourceHash);
+        }
+    }
+    if (!IsNull(pMeshlets))
+    {
+        uint32_t meshletParams[3] = {pMeshlets->maxVertices, pMeshlets->maxTriangles, 0};
+        memcpy(&meshletParams[2], &pMeshlets->coneWeight, sizeof(float));
+        sourceHash = HashBytes(meshletParams, sizeof(meshletParams), sourceHash);
+    }
+    sourceHash = (sourceHash != 0) ? sourceHash : 1;
+
+    // One cache file per source path, a stale file gets overwritten
+    std::error_code       ec;
+    std::filesystem::path absPath   = std::filesystem::absolute(path, ec);
+    std::string           absString = absPath.string();
+    std::filesystem::path cacheDir  = std::filesystem::temp_directory_path(ec) / "grex_mesh_cache";
+
+    std::stringstream cacheName;
+    cacheName << absPath.stem().string() << "_" << std::hex << std::setw(16) << std::setfill('0') << HashBytes(absString.data(), absString.size(), 0) << ".trimesh";
+    std::filesystem::path cachePath = cacheDir / cacheName.str();
+
+    const uint32_t maxVertices  = IsNull(pMeshlets) ? 0 : pMeshlets->maxVertices;
+    const uint32_t maxTriangles = IsNull(pMeshlets) ? 0 : pMeshlets->maxTriangles;
+    const float    coneWeight   = IsNull(pMeshlets) ? 0 : pMeshlets->coneWeight;
+
+    if (LoadBinary(cachePath.string(), pMesh, sourceHash, pMeshlets))
+    {
+        bool needsMeshlets = !IsNull(pMeshlets) && pMeshlets->meshlets.empty() && buildMeshlets;
+        if (!needsMeshlets)
+        {
+            GREX_LOG_INFO("Loaded " << path << " from cache " << cachePath);
+            return true;
+        }
+    }
+
+    if (!LoadOBJParallel(path, mtlBaseDir, options, pMesh))
+    {
+        return false;
+    }
+
+    if (!IsNull(pMeshlets))
+    {
+        *pMeshlets              = {};
+        pMeshlets->maxVertices  = maxVertices;
+        pMeshlets->maxTriangles = maxTriangles;
+        pMeshlets->coneWeight   = coneWeight;
+        if (buildMeshlets)
+        {
+            buildMeshlets(*pMesh, pMeshlets);
+        }
+    }
+
+    std::filesystem::create_directories(cacheDir, ec);
+    if (!SaveBinary(cachePath.string(), *pMesh, sourceHash, pMeshlets))
+    {
+        GREX_LOG_WARN("Failed to write mesh cache " << cachePath);
     }
 
     return true;
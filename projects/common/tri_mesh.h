@@ -2,13 +2,17 @@
 
 #include <glm/glm.hpp>
 #include <algorithm>
+#include <functional>
 #include <string>
 #include <memory>
+#include <span>
 #include <vector>
 
-#define DEFAULT_POSITION_DISTANCE_TRESHOLD  1e-6
-#define DEFAULT_TEX_COORD_DISTANCE_TRESHOLD 1e-6
-#define DEFAULT_NORMAL_ANGLE_THRESHOLD      0.5 * 3.14159265359 / 180
+#define DEFAULT_POSITION_DISTANCE_TRESHOLD     1e-6
+#define DEFAULT_TEX_COORD_DISTANCE_TRESHOLD    1e-6
+#define DEFAULT_NORMAL_ANGLE_THRESHOLD         0.5 * 3.14159265359 / 180
+#define DEFAULT_VERTEX_COLOR_DISTANCE_TRESHOLD 1e-6
+#define DEFAULT_TANGENT_CHUNK_SIZE             65536
 
 // F0 values
 const glm::vec3 F0_Generic         = glm::vec3(0.04f);
@@ -149,9 +153,28 @@ public:
         float Depth() const { return fabs(this->max.z - this->min.z); }
     };
 
+    // -------------------------------------------------------------------------
+    // MaterialRange
+    // -------------------------------------------------------------------------
+    struct MaterialRange
+    {
+        int32_t  materialIndex = -1;
+        uint32_t firstTriangle = 0; // Index into the mesh's triangles
+        uint32_t numTriangles  = 0;
+    };
+
     // -------------------------------------------------------------------------
     // Group
     // -------------------------------------------------------------------------
+    // Once a group is added to a mesh it's a contiguous range of the mesh's
+    // triangles. The mesh's groups are stored back to back at the start of
+    // its triangles, in group order, and each group's triangles are sorted
+    // by material so every material in a group is a single MaterialRange.
+    //
+    // Before it's added, AddTriangleIndex and the range constructor collect
+    // triangle indices as runs of consecutive triangles with the same
+    // material. AddGroup/AddGroups moves the triangles into place.
+    //
     class Group
     {
     public:
@@ -162,9 +185,10 @@ public:
         Group(const std::string& name, uint32_t firstIndex, uint32_t indexCount, int32_t materialIndex = -1)
             : mName(name)
         {
-            for (uint32_t i = 0; i < indexCount; ++i)
+            if (indexCount > 0)
             {
-                this->AddTriangleIndex(firstIndex + i, materialIndex);
+                mMaterialRanges.push_back(TriMesh::MaterialRange{materialIndex, firstIndex, indexCount});
+                mNumTriangles = indexCount;
             }
         }
 
@@ -175,30 +199,44 @@ public:
             return mName;
         }
 
-        uint32_t GetNumTriangleIndices() const
+        uint32_t GetFirstTriangle() const
         {
-            return static_cast<uint32_t>(mTriangleIndices.size());
+            return mFirstTriangle;
         }
 
-        const std::vector<uint32_t>& GetTriangleIndices() const
+        uint32_t GetNumTriangles() const
         {
-            return mTriangleIndices;
+            return mNumTriangles;
         }
 
-        const std::vector<int32_t>& GetMaterialIndices() const
+        // One range per material, in ascending material index order
+        const std::vector<TriMesh::MaterialRange>& GetMaterialRanges() const
         {
-            return mMaterialIndices;
+            return mMaterialRanges;
         }
 
         void AddTriangleIndex(uint32_t triangleIndex, int32_t materialIndex = -1)
         {
-            mTriangleIndices.push_back(triangleIndex);
-            mMaterialIndices.push_back(materialIndex);
+            if (!mMaterialRanges.empty())
+            {
+                auto& last = mMaterialRanges.back();
+                if ((last.materialIndex == materialIndex) && ((last.firstTriangle + last.numTriangles) == triangleIndex))
+                {
+                    ++last.numTriangles;
+                    ++mNumTriangles;
+                    return;
+                }
+            }
+            mMaterialRanges.push_back(TriMesh::MaterialRange{materialIndex, triangleIndex, 1});
+            ++mNumTriangles;
         }
 
         void SetMaterialIndices(int32_t materialIndex)
         {
-            std::fill(mMaterialIndices.begin(), mMaterialIndices.end(), materialIndex);
+            for (auto& range : mMaterialRanges)
+            {
+                range.materialIndex = materialIndex;
+            }
         }
 
         const TriMesh::Aabb GetBounds() const
@@ -214,12 +252,151 @@ public:
         }
 
     private:
-        std::string           mName            = "";
-        std::vector<uint32_t> mTriangleIndices = {};
-        std::vector<int32_t>  mMaterialIndices = {};
-        TriMesh::Aabb         mBounds          = {};
+        std::string                         mName           = "";
+        uint32_t                            mFirstTriangle  = 0;
+        uint32_t                            mNumTriangles   = 0;
+        std::vector<TriMesh::MaterialRange> mMaterialRanges = {};
+        TriMesh::Aabb                       mBounds         = {};
+    };
+
+    // -------------------------------------------------------------------------
+    // Meshlets
+    // -------------------------------------------------------------------------
+    // Precomputed meshlets that can be stored alongside the mesh in binary
+    // files. Meshlet matches the layout of meshopt_Meshlet.
+    //
+    struct Meshlet
+    {
+        uint32_t vertexOffset   = 0;
+        uint32_t triangleOffset = 0;
+        uint32_t vertexCount    = 0;
+        uint32_t triangleCount  = 0;
+    };
+
+    // Single LOD meshlets in the layout of MeshletBuffers (meshlet.h):
+    // triangleOffset is in triangles and triangles are 3 meshlet local
+    // vertex indices packed into 8 bits each. Each group's meshlets are
+    // contiguous and in group order, meshlets for triangles that aren't
+    // in any group come last.
+    //
+    struct MeshletData
+    {
+        uint32_t               maxVertices  = 0; // Build parameters, part of the cache key
+        uint32_t               maxTriangles = 0; // Build parameters, part of the cache key
+        float                  coneWeight   = 0; // Build parameters, part of the cache key
+        std::vector<Meshlet>   meshlets;
+        std::vector<uint32_t>  vertices;
+        std::vector<uint32_t>  triangles;
+        std::vector<glm::vec4> boundingSpheres;
+        std::vector<glm::vec4> normalCones;
+        std::vector<glm::vec4> coneApexes;
+        std::vector<uint32_t>  groupMeshletCounts; // Number of meshlets in each group
     };
 
+    // -------------------------------------------------------------------------
+    // Binary format
+    // -------------------------------------------------------------------------
+    // Written by SaveBinary. Every section starts at a multiple of
+    // BINARY_SECTION_ALIGNMENT from the start of the file so a memory
+    // mapped file can be used in place. Sections that aren't present
+    // have a size of 0.
+    //
+    enum BinarySection
+    {
+        BINARY_SECTION_POSITIONS              = 0,  // glm::vec3
+        BINARY_SECTION_VERTEX_COLORS          = 1,  // glm::vec3
+        BINARY_SECTION_TEX_COORDS             = 2,  // glm::vec2
+        BINARY_SECTION_NORMALS                = 3,  // glm::vec3
+        BINARY_SECTION_TANGENTS               = 4,  // glm::vec3
+        BINARY_SECTION_BITANGENTS             = 5,  // glm::vec3
+        BINARY_SECTION_TRIANGLES              = 6,  // TriMesh::Triangle
+        BINARY_SECTION_GROUPS                 = 7,  // TriMesh::BinaryGroup
+        BINARY_SECTION_GROUP_MATERIAL_RANGES  = 8,  // TriMesh::MaterialRange
+        BINARY_SECTION_MATERIALS              = 9,  // TriMesh::BinaryMaterial
+        BINARY_SECTION_STRINGS                = 10, // char, referenced by offset and length
+        BINARY_SECTION_MESHLETS               = 11, // TriMesh::Meshlet
+        BINARY_SECTION_MESHLET_VERTICES       = 12, // uint32_t
+        BINARY_SECTION_MESHLET_TRIANGLES      = 13, // uint32_t, 3 packed 8-bit indices
+        BINARY_SECTION_MESHLET_SPHERES        = 14, // glm::vec4
+        BINARY_SECTION_MESHLET_CONES          = 15, // glm::vec4
+        BINARY_SECTION_MESHLET_CONE_APEXES    = 16, // glm::vec4
+        BINARY_SECTION_MESHLET_GROUP_COUNTS   = 17, // uint32_t
+        BINARY_SECTION_COUNT                  = 18,
+    };
+
+    static const uint32_t BINARY_MAGIC             = 0x4D545847; // 'GXTM'
+    static const uint32_t BINARY_VERSION           = 3;
+    static const uint32_t BINARY_SECTION_ALIGNMENT = 64;
+
+    struct BinaryString
+    {
+        uint32_t offset = 0; // Offset into BINARY_SECTION_STRINGS
+        uint32_t length = 0;
+    };
+
+    struct BinaryGroup
+    {
+        BinaryString name               = {};
+        uint32_t     firstTriangle      = 0; // Into BINARY_SECTION_TRIANGLES
+        uint32_t     numTriangles       = 0;
+        uint32_t     firstMaterialRange = 0; // Into BINARY_SECTION_GROUP_MATERIAL_RANGES
+        uint32_t     numMaterialRanges  = 0;
+        glm::vec3    boundsMin          = glm::vec3(0);
+        glm::vec3    boundsMax          = glm::vec3(0);
+    };
+
+    struct BinaryMaterial
+    {
+        BinaryString name             = {};
+        uint32_t     id               = 0;
+        glm::vec3    baseColor        = glm::vec3(1);
+        glm::vec3    F0               = glm::vec3(0.04f);
+        float        roughness        = 0;
+        float        metalness        = 0;
+        BinaryString albedoTexture    = {};
+        BinaryString normalTexture    = {};
+        BinaryString roughnessTexture = {};
+        BinaryString metalnessTexture = {};
+        BinaryString aoTexture        = {};
+    };
+
+    struct BinarySectionRange
+    {
+        uint64_t offset = 0;
+        uint64_t size   = 0; // In bytes
+    };
+
+    struct BinaryHeader
+    {
+        uint32_t           magic                          = BINARY_MAGIC;
+        uint32_t           version                        = BINARY_VERSION;
+        uint64_t           sourceHash                     = 0;
+        uint32_t           optionFlags                    = 0; // Bit per bool in TriMesh::Options, in declaration order
+        glm::vec3          center                         = glm::vec3(0);
+        glm::vec2          texCoordScale                  = glm::vec2(1);
+        glm::vec3          transformTranslate             = glm::vec3(0);
+        glm::vec3          transformRotate                = glm::vec3(0);
+        glm::vec3          transformScale                 = glm::vec3(1);
+        glm::vec3          boundsMin                      = glm::vec3(0);
+        glm::vec3          boundsMax                      = glm::vec3(0);
+        uint32_t           meshletMaxVertices             = 0;
+        uint32_t           meshletMaxTriangles            = 0;
+        float              meshletConeWeight              = 0;
+        BinarySectionRange sections[BINARY_SECTION_COUNT] = {};
+    };
+
+    // -------------------------------------------------------------------------
+    // LOD
+    // -------------------------------------------------------------------------
+    struct LODTarget
+    {
+        float ratio    = 0.5f; // Target triangle count as a fraction of the source triangle count
+        float maxError = 1.0f; // Error budget relative to the mesh extents, 1.0 means no limit
+    };
+
+    // Defined after TriMesh since it holds a TriMesh
+    struct LOD;
+
     // -------------------------------------------------------------------------
     // TriMesh
     // -------------------------------------------------------------------------
@@ -238,6 +415,8 @@ public:
     uint32_t                              AddTriangle(const Triangle& tri);
     uint32_t                              AddTriangle(uint32_t vIdx0, uint32_t vIdx1, uint32_t vIdx2);
     void                                  AddTriangles(size_t count, const uint32_t* pIndices);
+    // Group ranges are kept as is, so the new triangles must keep every
+    // group's and material's triangles inside their ranges.
     void                                  SetTriangles(size_t count, const uint32_t* pIndices);
     void                                  SetTriangles(const std::vector<uint32_t>& indices);
 
@@ -245,14 +424,21 @@ public:
     const TriMesh::Material&              GetMaterial(uint32_t materialIndex) const { return mMaterials[materialIndex]; }
     const std::vector<TriMesh::Material>& GetMaterials() const { return mMaterials; }
     uint32_t                              AddMaterial(const TriMesh::Material& material);
-    std::vector<TriMesh::Triangle>        GetTrianglesForMaterial(const int32_t materialIndex) const;
+    std::vector<TriMesh::Triangle>        GetTrianglesForMaterial(const int32_t materialIndex) const; // Copies, use GetMaterialRanges to avoid it
+
+    // Ranges of every group that uses \b materialIndex, in group order.
+    // Triangles that aren't in any group aren't in any of the ranges.
+    const std::vector<TriMesh::MaterialRange>& GetMaterialRanges(int32_t materialIndex) const;
+    std::span<const TriMesh::Triangle>         GetTriangles(const TriMesh::MaterialRange& range) const;
 
     uint32_t                           GetNumGroups() const { return static_cast<uint32_t>(mGroups.size()); }
     const TriMesh::Group&              GetGroup(uint32_t groupIndex) const { return mGroups[groupIndex]; }
     const std::vector<TriMesh::Group>& GetGroups() const { return mGroups; }
     uint32_t                           GetGroupIndex(const std::string& groupName) const;
     uint32_t                           AddGroup(const TriMesh::Group& newGroup); // Returns UINT32_MAX on error
-    std::vector<TriMesh::Triangle>     GetGroupTriangles(uint32_t groupIndex) const;
+    bool                               AddGroups(const std::vector<TriMesh::Group>& newGroups);
+    std::span<const TriMesh::Triangle> GetGroupTriangles(uint32_t groupIndex) const;
+    uint32_t                           GetNumGroupedTriangles() const; // Grouped triangles are [0, GetNumGroupedTriangles())
 
     const std::vector<glm::vec3>& GetPositions() const { return mPositions; }
     void                          SetPositions(size_t count, const glm::vec3* pPositions);
@@ -286,7 +472,15 @@ public:
 
     void AppendMesh(const TriMesh& srcMesh, const std::string& groupPrefix = "");
 
-    // Only works if there's only positions, will return if any other attribute is present.
+    // Welds vertices whose attributes are all within the thresholds. Each vertex
+    // is welded to the lowest indexed earlier vertex that it matches and that
+    // hasn't itself been welded away - same result as comparing every vertex
+    // against every previously welded vertex, but candidates are looked up in
+    // a uniform grid so only vertices in neighboring cells get compared.
+    //
+    // Vertex colors, tex coords, normals, tangents and bitangents are only
+    // compared if they're present for every vertex. Tangents and bitangents
+    // use \b normalAngleThreshold.
     //
     // Optional - triangles can be spatially sorted with meshopt after welding:
     //
@@ -303,9 +497,60 @@ public:
     //         sizeof(glm::vec3));
     //
     void WeldVertices(
-        float positionDistanceThreshold = DEFAULT_POSITION_DISTANCE_TRESHOLD,
-        float texCoordDistanceThreshold = DEFAULT_TEX_COORD_DISTANCE_TRESHOLD,
-        float normalAngleThreshold      = DEFAULT_NORMAL_ANGLE_THRESHOLD);
+        float positionDistanceThreshold    = DEFAULT_POSITION_DISTANCE_TRESHOLD,
+        float texCoordDistanceThreshold    = DEFAULT_TEX_COORD_DISTANCE_TRESHOLD,
+        float normalAngleThreshold         = DEFAULT_NORMAL_ANGLE_THRESHOLD,
+        float vertexColorDistanceThreshold = DEFAULT_VERTEX_COLOR_DISTANCE_TRESHOLD);
+
+    // Builds an LOD chain with meshopt_simplify, one level per target. Every
+    // level is simplified from this mesh (not from the previous level) and
+    // the levels are built in parallel. Simplification stops at whichever of
+    // the ratio or the error budget is reached first. The mesh should be
+    // welded first, vertices are never moved so all attributes are kept.
+    //
+    // Triangles are simplified per group and material with their borders
+    // locked, so group and material assignments survive without cracks.
+    //
+    // Requires TRIMESH_USE_MESHOPTIMIZER.
+    //
+    std::vector<TriMesh::LOD> GenerateLODs(const std::vector<TriMesh::LODTarget>& targets) const;
+
+    // Reorders the mesh for the GPU's post transform pipeline:
+    //   - vertex cache optimization (meshopt_optimizeVertexCache)
+    //   - overdraw optimization (meshopt_optimizeOverdraw), triangles may be
+    //     reordered as long as the cache hit ratio doesn't get worse than
+    //     \b overdrawThreshold times the vertex cache optimized result
+    //   - vertex fetch remapping, applied to every attribute stream
+    //
+    // Triangles are optimized per group/material part and each part ends up
+    // contiguous, group triangle and material indices are updated to match.
+    // Unreferenced vertices are removed. ACMR/ATVR, overdraw and overfetch
+    // are logged before and after.
+    //
+    // Requires TRIMESH_USE_MESHOPTIMIZER.
+    //
+    void Optimize(float overdrawThreshold = 1.05f);
+
+    // Calculates tangents and bitangents with MikkTSpace. Tangents must be
+    // enabled and every vertex needs a normal and a tex coord. The loaders
+    // call this with the default chunk size.
+    //
+    // Triangles are split into chunks of \b trianglesPerChunk and the chunks
+    // run in parallel, the result is identical to running MikkTSpace over
+    // the whole mesh - including vertices shared between chunks. A chunk
+    // size of UINT32_MAX runs MikkTSpace over the whole mesh on the calling
+    // thread.
+    //
+    // Requires TRIMESH_USE_MIKKTSPACE.
+    //
+    void GenerateTangents(uint32_t trianglesPerChunk = DEFAULT_TANGENT_CHUNK_SIZE);
+
+    // Distance at which an \b error (in mesh units) covers \b pixelThreshold
+    // pixels for a perspective projection with vertical field of view
+    // \b fovY (radians) and a viewport \b viewportHeight pixels high. LOD
+    // levels can be picked by comparing this against the view distance.
+    //
+    static float CalculateLODDistance(float error, float fovY, float viewportHeight, float pixelThreshold = 1.0f);
 
     std::vector<glm::vec3> GetTBNLineSegments(uint32_t* pNumVertices, float length = 0.1f) const;
 
@@ -342,24 +587,80 @@ public:
     static TriMesh CornellBox(const TriMesh::Options& options = {});
 
     static bool LoadOBJ(const std::string& path, const std::string& mtlBaseDir, const TriMesh::Options& options, TriMesh* pMesh);
+
+    // Same as LoadOBJ but vertices are shared: each unique combination of OBJ
+    // (position, normal, tex coord) indices becomes a single vertex. If vertex
+    // colors are enabled the face color is part of the key as well.
+    static bool LoadOBJIndexed(const std::string& path, const std::string& mtlBaseDir, const TriMesh::Options& options, TriMesh* pMesh);
     static bool LoadOBJ2(const std::string& path, TriMesh* pMesh);
+
+    // Native OBJ reader that memory maps the file and parses line aligned chunks
+    // of v/vt/vn/f records on multiple threads. Supports g/o groups, usemtl and
+    // mtllib (materials are read with tinyobj).
+    //
+    // If the face indices for every enabled attribute match the position indices
+    // (i.e. files written by WriteOBJ) the OBJ vertices are used as is, like
+    // LoadOBJ2. Otherwise vertices are shared like LoadOBJIndexed.
+    //
+    static bool LoadOBJParallel(const std::string& path, const std::string& mtlBaseDir, const TriMesh::Options& options, TriMesh* pMesh);
     static bool WriteOBJ(const std::string path, const TriMesh& mesh);
 
+    // Writes \b mesh and optionally \b pMeshlets to a binary file, see
+    // TriMesh::BinaryHeader. \b sourceHash identifies what the mesh was
+    // built from.
+    //
+    static bool SaveBinary(const std::string& path, const TriMesh& mesh, uint64_t sourceHash = 0, const TriMesh::MeshletData* pMeshlets = nullptr);
+
+    // Loads a file written by SaveBinary. Fails if the version doesn't match
+    // or if \b sourceHash is non-zero and doesn't match the stored hash.
+    // Meshlets are copied to \b pMeshlets if it's not null and the file has
+    // them, otherwise pMeshlets->meshlets is left empty.
+    //
+    static bool LoadBinary(const std::string& path, TriMesh* pMesh, uint64_t sourceHash = 0, TriMesh::MeshletData* pMeshlets = nullptr);
+
+    // Hash of the contents of \b path combined with \b options, returns 0 if
+    // the file can't be read.
+    static uint64_t CalculateSourceHash(const std::string& path, const TriMesh::Options& options);
+
+    // Loads \b path through a binary cache file in the temp directory. The
+    // cache is keyed on the contents of \b path and the material libraries
+    // it references, \b mtlBaseDir, \b options and the meshlet build
+    // parameters in \b pMeshlets. On a miss the OBJ is loaded with
+    // LoadOBJParallel, \b buildMeshlets is called to fill \b pMeshlets (if
+    // both are provided) and the cache file is written. See
+    // LoadOBJMeshletsCached in meshlet.h for meshlets from BuildMeshlets.
+    //
+    static bool LoadOBJCached(
+        const std::string&                                                     path,
+        const std::string&                                                     mtlBaseDir,
+        const TriMesh::Options&                                                options,
+        TriMesh*                                                               pMesh,
+        TriMesh::MeshletData*                                                  pMeshlets     = nullptr,
+        const std::function<void(const TriMesh& mesh, TriMesh::MeshletData*)>& buildMeshlets = nullptr);
+
 private:
-    TriMesh::Options               mOptions = {};
-    std::vector<TriMesh::Triangle> mTriangles;
-    std::vector<TriMesh::Material> mMaterials;
-    std::vector<TriMesh::Group>    mGroups;
-    std::vector<glm::vec3>         mPositions;
-    std::vector<glm::vec3>         mVertexColors;
-    std::vector<glm::vec2>         mTexCoords;
-    std::vector<glm::vec3>         mNormals;
-    std::vector<glm::vec3>         mTangents;
-    std::vector<glm::vec3>         mBitangents;
-    TriMesh::Aabb                  mBounds = {};
+    TriMesh::Options                                 mOptions = {};
+    std::vector<TriMesh::Triangle>                   mTriangles;
+    std::vector<TriMesh::Material>                   mMaterials;
+    std::vector<TriMesh::Group>                      mGroups;
+    std::vector<std::vector<TriMesh::MaterialRange>> mMaterialRanges; // Indexed by materialIndex + 1, see GetMaterialRanges
+    std::vector<glm::vec3>                           mPositions;
+    std::vector<glm::vec3>                           mVertexColors;
+    std::vector<glm::vec2>                           mTexCoords;
+    std::vector<glm::vec3>                           mNormals;
+    std::vector<glm::vec3>                           mTangents;
+    std::vector<glm::vec3>                           mBitangents;
+    TriMesh::Aabb                                    mBounds = {};
 
 private:
     friend struct CalculateTangents;
     void SetTangents(uint32_t vIdx, const glm::vec3& tangent, const glm::vec3& bitangent);
+    void UpdateMaterialRanges();
     void CalculateBounds();
 };
+
+struct TriMesh::LOD
+{
+    TriMesh mesh;
+    float   error = 0; // Geometric deviation from the source mesh, in mesh units
+};
@@ -0,0 +1,626 @@
+#include "tri_mesh_bvh.h"
+#include "config.h"
+
+// Traversal uses a fixed size stack, leaves are forced at this depth
+#define TRIMESH_BVH_MAX_DEPTH 64
+
+static_assert(sizeof(TriMeshBVH::Node) == 32, "TriMeshBVH::Node must be 32 bytes");
+
+// -------------------------------------------------------------------------------------------------
+// Build helpers
+// -------------------------------------------------------------------------------------------------
+namespace
+{
+
+struct BuildAabb
+{
+    glm::vec3 min = glm::vec3(FLT_MAX);
+    glm::vec3 max = glm::vec3(-FLT_MAX);
+
+    void Grow(const glm::vec3& point)
+    {
+        min = glm::min(min, point);
+        max = glm::max(max, point);
+    }
+
+    void Grow(const BuildAabb& other)
+    {
+        min = glm::min(min, other.min);
+        max = glm::max(max, other.max);
+    }
+
+    float HalfArea() const
+    {
+        if ((max.x < min.x) || (max.y < min.y) || (max.z < min.z))
+        {
+            return 0.0f;
+        }
+        glm::vec3 extent = max - min;
+        return (extent.x * extent.y) + (extent.y * extent.z) + (extent.z * extent.x);
+    }
+};
+
+struct BuildBin
+{
+    BuildAabb bounds = {};
+    uint32_t  count  = 0;
+};
+
+//
+// Tree node before flattening. Top level nodes that point at a subtree
+// built by a worker have subtreeIndex set, the subtree's root is its first
+// node.
+//
+struct BuildNode
+{
+    BuildAabb bounds       = {};
+    uint32_t  left         = UINT32_MAX;
+    uint32_t  right        = UINT32_MAX;
+    uint32_t  begin        = 0;
+    uint32_t  count        = 0;
+    uint32_t  subtreeIndex = UINT32_MAX;
+};
+
+struct BuildContext
+{
+    const TriMeshBVH::BuildOptions& options;
+    const std::vector<BuildAabb>&   triBounds;
+    const std::vector<glm::vec3>&   centroids;
+    std::vector<uint32_t>&          triIndices;
+};
+
+// Ranges bigger than this are binned in parallel
+const uint32_t kParallelBinningSize = 65536;
+
+void CalculateRangeBounds(const BuildContext& ctx, uint32_t begin, uint32_t end, BuildAabb* pBounds, BuildAabb* pCentroidBounds)
+{
+    const uint32_t count = end - begin;
+    if (count < kParallelBinningSize)
+    {
+        for (uint32_t i = begin; i < end; ++i)
+        {
+            pBounds->Grow(ctx.triBounds[ctx.triIndices[i]]);
+            pCentroidBounds->Grow(ctx.centroids[ctx.triIndices[i]]);
+        }
+        return;
+    }
+
+    const uint32_t         numChunks = (count + kParallelBinningSize - 1) / kParallelBinningSize;
+    std::vector<BuildAabb> chunkBounds(numChunks);
+    std::vector<BuildAabb> chunkCentroidBounds(numChunks);
+    ParallelFor(numChunks, 1, [&](uint32_t chunkBegin, uint32_t chunkEnd) {
+        for (uint32_t chunkIdx = chunkBegin; chunkIdx < chunkEnd; ++chunkIdx)
+        {
+            const uint32_t first = begin + chunkIdx * kParallelBinningSize;
+            const uint32_t last  = std::min(first + kParallelBinningSize, end);
+            for (uint32_t i = first; i < last; ++i)
+            {
+                chunkBounds[chunkIdx].Grow(ctx.triBounds[ctx.triIndices[i]]);
+                chunkCentroidBounds[chunkIdx].Grow(ctx.centroids[ctx.triIndices[i]]);
+            }
+        }
+    });
+
+    for (uint32_t chunkIdx = 0; chunkIdx < numChunks; ++chunkIdx)
+    {
+        pBounds->Grow(chunkBounds[chunkIdx]);
+        pCentroidBounds->Grow(chunkCentroidBounds[chunkIdx]);
+    }
+}
+
+//
+// Finds the cheapest binned SAH split of [begin, end) and partitions the
+// triangle indices around it. Returns false if the range should be a leaf.
+//
+bool SplitRange(const BuildContext& ctx, uint32_t begin, uint32_t end, const BuildAabb& bounds, const BuildAabb& centroidBounds, uint32_t depth, uint32_t* pMid)
+{
+    const uint32_t count = end - begin;
+    if ((count <= 1) || (depth >= (TRIMESH_BVH_MAX_DEPTH - 1)))
+    {
+        return false;
+    }
+
+    const uint32_t  numBins = std::max<uint32_t>(ctx.options.numBins, 2);
+    const glm::vec3 extent  = centroidBounds.max - centroidBounds.min;
+
+    // All centroids are in the same spot, SAH can't separate them
+    if ((extent.x <= 0.0f) && (extent.y <= 0.0f) && (extent.z <= 0.0f))
+    {
+        if (count <= ctx.options.maxLeafSize)
+        {
+            return false;
+        }
+        *pMid = begin + count / 2;
+        return true;
+    }
+
+    // Bin index of a centroid along an axis
+    auto GetBinIndex = [&](const glm::vec3& centroid, uint32_t axis) -> uint32_t {
+        float    scale = static_cast<float>(numBins) / extent[axis];
+        uint32_t bin   = static_cast<uint32_t>((centroid[axis] - centroidBounds.min[axis]) * scale);
+        return std::min(bin, numBins - 1);
+    };
+
+    // Bins for all 3 axes: [axis * numBins + bin]
+    std::vector<BuildBin> bins(3 * numBins);
+    auto                  BinRange = [&](uint32_t first, uint32_t last, std::vector<BuildBin>& outBins) {
+        for (uint32_t i = first; i < last; ++i)
+        {
+            const uint32_t triIdx = ctx.triIndices[i];
+            for (uint32_t axis = 0; axis < 3; ++axis)
+            {
+                if (extent[axis] <= 0.0f)
+                {
+                    continue;
+                }
+                BuildBin& bin = outBins[axis * numBins + GetBinIndex(ctx.centroids[triIdx], axis)];
+                bin.bounds.Grow(ctx.triBounds[triIdx]);
+                bin.count += 1;
+            }
+        }
+    };
+
+    if (count < kParallelBinningSize)
+    {
+        BinRange(begin, end, bins);
+    }
+    else
+    {
+        const uint32_t                     numChunks = (count + kParallelBinningSize - 1) / kParallelBinningSize;
+        std::vector<std::vector<BuildBin>> chunkBins(numChunks, std::vector<BuildBin>(3 * numBins));
+        ParallelFor(numChunks, 1, [&](uint32_t chunkBegin, uint32_t chunkEnd) {
+            for (uint32_t chunkIdx = chunkBegin; chunkIdx < chunkEnd; ++chunkIdx)
+            {
+                const uint32_t first = begin + chunkIdx * kParallelBinningSize;
+                BinRange(first, std::min(first + kParallelBinningSize, end), chunkBins[chunkIdx]);
+            }
+        });
+
+        for (auto& localBins : chunkBins)
+        {
+            for (size_t i = 0; i < bins.size(); ++i)
+            {
+                bins[i].bounds.Grow(localBins[i].bounds);
+                bins[i].count += localBins[i].count;
+            }
+        }
+    }
+
+    // Sweep from both sides, split s puts bins [0, s) on the left
+    float    bestCost  = FLT_MAX;
+    uint32_t bestAxis  = UINT32_MAX;
+    uint32_t bestSplit = 0;
+
+    std::vector<float> rightCosts(numBins);
+    for (uint32_t axis = 0; axis < 3; ++axis)
+    {
+        if (extent[axis] <= 0.0f)
+        {
+            continue;
+        }
+
+        const BuildBin* pAxisBins = &bins[axis * numBins];
+
+        BuildAabb rightBounds = {};
+        uint32_t  rightCount  = 0;
+        for (uint32_t split = numBins - 1; split > 0; --split)
+        {
+            rightBounds.Grow(pAxisBins[split].bounds);
+            rightCount += pAxisBins[split].count;
+            rightCosts[split] = rightBounds.HalfArea() * static_cast<float>(rightCount);
+        }
+
+        BuildAabb leftBounds = {};
+        uint32_t  leftCount  = 0;
+        for (uint32_t split = 1; split < numBins; ++split)
+        {
+            leftBounds.Grow(pAxisBins[split - 1].bounds);
+            leftCount += pAxisBins[split - 1].count;
+            if ((leftCount == 0) || (leftCount == count))
+            {
+                continue;
+            }
+
+            float cost = leftBounds.HalfArea() * static_cast<float>(leftCount) + rightCosts[split];
+            if (cost < bestCost)
+            {
+                bestCost  = cost;
+                bestAxis  = axis;
+                bestSplit = split;
+            }
+        }
+    }
+
+    const float parentArea = bounds.HalfArea();
+    const float leafCost   = static_cast<float>(count);
+    const float splitCost  = (parentArea > 0.0f) ? (ctx.options.traversalCost + bestCost / parentArea) : FLT_MAX;
+    if ((count <= ctx.options.maxLeafSize) && (splitCost >= leafCost))
+    {
+        return false;
+    }
+
+    uint32_t mid = begin + count / 2;
+    if (bestAxis != UINT32_MAX)
+    {
+        auto it = std::partition(
+            ctx.triIndices.begin() + begin,
+            ctx.triIndices.begin() + end,
+            [&](uint32_t triIdx) { return GetBinIndex(ctx.centroids[triIdx], bestAxis) < bestSplit; });
+
+        mid = static_cast<uint32_t>(it - ctx.triIndices.begin());
+    }
+
+    // Bins didn't separate anything, fall back to a median split on the
+    // widest axis
+    if ((mid == begin) || (mid == end))
+    {
+        uint32_t axis = (extent.x > extent.y) ? ((extent.x > extent.z) ? 0 : 2) : ((extent.y > extent.z) ? 1 : 2);
+
+        mid = begin + count / 2;
+        std::nth_element(
+            ctx.triIndices.begin() + begin,
+            ctx.triIndices.begin() + mid,
+            ctx.triIndices.begin() + end,
+            [&](uint32_t a, uint32_t b) { return ctx.centroids[a][axis] < ctx.centroids[b][axis]; });
+    }
+
+    *pMid = mid;
+    return true;
+}
+
+uint32_t BuildSubtree(const BuildContext& ctx, uint32_t begin, uint32_t end, uint32_t depth, std::vector<BuildNode>& nodes)
+{
+    const uint32_t nodeIdx = CountU32(nodes);
+    nodes.push_back(BuildNode{});
+
+    BuildAabb bounds         = {};
+    BuildAabb centroidBounds = {};
+    CalculateRangeBounds(ctx, begin, end, &bounds, &centroidBounds);
+    nodes[nodeIdx].bounds = bounds;
+
+    uint32_t mid = 0;
+    if (!SplitRange(ctx, begin, end, bounds, centroidBounds, depth, &mid))
+    {
+        nodes[nodeIdx].begin = begin;
+        nodes[nodeIdx].count = end - begin;
+        return nodeIdx;
+    }
+
+    // nodes may reallocate, don't hold references across the recursion
+    uint32_t left        = BuildSubtree(ctx, begin, mid, depth + 1, nodes);
+    uint32_t right       = BuildSubtree(ctx, mid, end, depth + 1, nodes);
+    nodes[nodeIdx].left  = left;
+    nodes[nodeIdx].right = right;
+
+    return nodeIdx;
+}
+
+struct SubtreeTask
+{
+    uint32_t               begin = 0;
+    uint32_t               end   = 0;
+    uint32_t               depth = 0;
+    std::vector<BuildNode> nodes;
+};
+
+//
+// Splits serially (with parallel binning) until ranges are small enough to
+// hand off, ranges at or below subtreeSize become subtree tasks.
+//
+uint32_t BuildTopLevel(const BuildContext& ctx, uint32_t begin, uint32_t end, uint32_t depth, uint32_t subtreeSize, std::vector<BuildNode>& nodes, std::vector<SubtreeTask>& tasks)
+{
+    const uint32_t nodeIdx = CountU32(nodes);
+    nodes.push_back(BuildNode{});
+
+    if ((end - begin) <= subtreeSize)
+    {
+        SubtreeTask task = {};
+        task.begin       = begin;
+        task.end         = end;
+        task.depth       = depth;
+
+        nodes[nodeIdx].subtreeIndex = CountU32(tasks);
+        tasks.push_back(std::move(task));
+        return nodeIdx;
+    }
+
+    BuildAabb bounds         = {};
+    BuildAabb centroidBounds = {};
+    CalculateRangeBounds(ctx, begin, end, &bounds, &centroidBounds);
+    nodes[nodeIdx].bounds = bounds;
+
+    uint32_t mid = 0;
+    if (!SplitRange(ctx, begin, end, bounds, centroidBounds, depth, &mid))
+    {
+        nodes[nodeIdx].begin = begin;
+        nodes[nodeIdx].count = end - begin;
+        return nodeIdx;
+    }
+
+    uint32_t left        = BuildTopLevel(ctx, begin, mid, depth + 1, subtreeSize, nodes, tasks);
+    uint32_t right       = BuildTopLevel(ctx, mid, end, depth + 1, subtreeSize, nodes, tasks);
+    nodes[nodeIdx].left  = left;
+    nodes[nodeIdx].right = right;
+
+    return nodeIdx;
+}
+
+// Writes nodes depth first, returns the index of the flattened node
+uint32_t Flatten(const std::vector<BuildNode>& nodes, uint32_t nodeIdx, const std::vector<SubtreeTask>& tasks, uint32_t depth, std::vector<TriMeshBVH::Node>& outNodes, uint32_t* pMaxDepth)
+{
+    const BuildNode& node = nodes[nodeIdx];
+    if (node.subtreeIndex != UINT32_MAX)
+    {
+        return Flatten(tasks[node.subtreeIndex].nodes, 0, tasks, depth, outNodes, pMaxDepth);
+    }
+
+    *pMaxDepth = std::max(*pMaxDepth, depth);
+
+    const uint32_t outIdx = CountU32(outNodes);
+
+    TriMeshBVH::Node outNode = {};
+    outNode.boundsMin        = node.bounds.min;
+    outNode.boundsMax        = node.bounds.max;
+    outNodes.push_back(outNode);
+
+    if (node.count > 0)
+    {
+        outNodes[outIdx].offset = node.begin;
+        outNodes[outIdx].count  = node.count;
+        return outIdx;
+    }
+
+    Flatten(nodes, node.left, tasks, depth + 1, outNodes, pMaxDepth);
+    uint32_t right          = Flatten(nodes, node.right, tasks, depth + 1, outNodes, pMaxDepth);
+    outNodes[outIdx].offset = right;
+
+    return outIdx;
+}
+
+bool IntersectAabb(const TriMeshBVH::Node& node, const glm::vec3& origin, const glm::vec3& invDir, float tMin, float tMax, float* pNear)
+{
+    glm::vec3 t0    = (node.boundsMin - origin) * invDir;
+    glm::vec3 t1    = (node.boundsMax - origin) * invDir;
+    glm::vec3 tNear = glm::min(t0, t1);
+    glm::vec3 tFar  = glm::max(t0, t1);
+
+    float enter = std::max(std::max(tNear.x, tNear.y), std::max(tNear.z, tMin));
+    float exit  = std::min(std::min(tFar.x, tFar.y), std::min(tFar.z, tMax));
+
+    *pNear = enter;
+    return (enter <= exit);
+}
+
+} // namespace
+
+// -------------------------------------------------------------------------------------------------
+// TriMeshBVH
+// -------------------------------------------------------------------------------------------------
+bool TriMeshBVH::Build(const TriMesh& mesh, const TriMeshBVH::BuildOptions& options, TriMeshBVH* pBVH)
+{
+    if (IsNull(pBVH))
+    {
+        return false;
+    }
+
+    const uint32_t numTriangles = mesh.GetNumTriangles();
+    if (numTriangles == 0)
+    {
+        GREX_LOG_ERROR("can't build BVH for a mesh without triangles");
+        return false;
+    }
+
+    const auto& positions = mesh.GetPositions();
+    const auto& triangles = mesh.GetTriangles();
+
+    std::vector<BuildAabb> triBounds(numTriangles);
+    std::vector<glm::vec3> centroids(numTriangles);
+    std::vector<uint32_t>  triIndices(numTriangles);
+    ParallelFor(numTriangles, 16384, [&](uint32_t begin, uint32_t end) {
+        for (uint32_t triIdx = begin; triIdx < end; ++triIdx)
+        {
+            const TriMesh::Triangle& tri = triangles[triIdx];
+
+            BuildAabb bounds = {};
+            bounds.Grow(positions[tri.vIdx0]);
+            bounds.Grow(positions[tri.vIdx1]);
+            bounds.Grow(positions[tri.vIdx2]);
+
+            triBounds[triIdx]  = bounds;
+            centroids[triIdx]  = (bounds.min + bounds.max) * 0.5f;
+            triIndices[triIdx] = triIdx;
+        }
+    });
+
+    BuildContext ctx = {options, triBounds, centroids, triIndices};
+
+    // Enough subtrees to keep every thread busy even if the splits are
+    // uneven, but not so many that the serial top level dominates.
+    const uint32_t numThreads  = std::max<uint32_t>(std::thread::hardware_concurrency(), 1);
+    const uint32_t subtreeSize = std::max<uint32_t>(numTriangles / (8 * numThreads), 4096);
+
+    std::vector<BuildNode>   topNodes;
+    std::vector<SubtreeTask> tasks;
+    BuildTopLevel(ctx, 0, numTriangles, 0, subtreeSize, topNodes, tasks);
+
+    ParallelFor(CountU32(tasks), 1, [&](uint32_t begin, uint32_t end) {
+        for (uint32_t taskIdx = begin; taskIdx < end; ++taskIdx)
+        {
+            SubtreeTask& task = tasks[taskIdx];
+            BuildSubtree(ctx, task.begin, task.end, task.depth, task.nodes);
+        }
+    });
+
+    TriMeshBVH bvh = {};
+    bvh.mNodes.reserve(2 * numTriangles / std::max<uint32_t>(options.maxLeafSize / 2, 1));
+    Flatten(topNodes, 0, tasks, 0, bvh.mNodes, &bvh.mMaxDepth);
+
+    bvh.mTriIndices = std::move(triIndices);
+    bvh.mTriangles.resize(numTriangles);
+    ParallelFor(numTriangles, 16384, [&](uint32_t begin, uint32_t end) {
+        for (uint32_t i = begin; i < end; ++i)
+        {
+            const TriMesh::Triangle& tri = triangles[bvh.mTriIndices[i]];
+
+            bvh.mTriangles[i].v0 = positions[tri.vIdx0];
+            bvh.mTriangles[i].e1 = positions[tri.vIdx1] - positions[tri.vIdx0];
+            bvh.mTriangles[i].e2 = positions[tri.vIdx2] - positions[tri.vIdx0];
+        }
+    });
+
+    *pBVH = std::move(bvh);
+
+    return true;
+}
+
+template <bool AnyHit>
+bool TriMeshBVH::Traverse(const TriMeshBVH::Ray& ray, TriMeshBVH::Hit* pHit) const
+{
+    if (mNodes.empty())
+    {
+        return false;
+    }
+
+    const glm::vec3 invDir = 1.0f / ray.direction;
+
+    float tMax  = ray.tMax;
+    float tNear = 0;
+    if (!IntersectAabb(mNodes[0], ray.origin, invDir, ray.tMin, tMax, &tNear))
+    {
+        return false;
+    }
+
+    struct StackEntry
+    {
+        uint32_t nodeIdx;
+        float    tNear;
+    };
+
+    StackEntry stack[TRIMESH_BVH_MAX_DEPTH];
+    uint32_t   stackSize = 0;
+    uint32_t   nodeIdx   = 0;
+    bool       hit       = false;
+
+    while (true)
+    {
+        const Node& node = mNodes[nodeIdx];
+        if (node.IsLeaf())
+        {
+            // Moller-Trumbore, two sided
+            for (uint32_t i = node.offset; i < (node.offset + node.count); ++i)
+            {
+                const Triangle& tri = mTriangles[i];
+
+                glm::vec3 p   = glm::cross(ray.direction, tri.e2);
+                float     det = glm::dot(tri.e1, p);
+                if (std::fabs(det) < 1e-20f)
+                {
+                    continue;
+                }
+                float invDet = 1.0f / det;
+
+                glm::vec3 s = ray.origin - tri.v0;
+                float     u = glm::dot(s, p) * invDet;
+                if ((u < 0.0f) || (u > 1.0f))
+                {
+                    continue;
+                }
+
+                glm::vec3 q = glm::cross(s, tri.e1);
+                float     v = glm::dot(ray.direction, q) * invDet;
+                if ((v < 0.0f) || ((u + v) > 1.0f))
+                {
+                    continue;
+                }
+
+                float t = glm::dot(tri.e2, q) * invDet;
+                if ((t < ray.tMin) || (t >= tMax))
+                {
+                    continue;
+                }
+
+                if constexpr (AnyHit)
+                {
+                    return true;
+                }
+
+                tMax = t;
+                hit  = true;
+
+                pHit->t        = t;
+                pHit->u        = u;
+                pHit->v        = v;
+                pHit->triIndex = mTriIndices[i];
+            }
+        }
+        else
+        {
+            uint32_t left  = nodeIdx + 1;
+            uint32_t right = node.offset;
+
+            float tLeft    = 0;
+            float tRight   = 0;
+            bool  hitLeft  = IntersectAabb(mNodes[left], ray.origin, invDir, ray.tMin, tMax, &tLeft);
+            bool  hitRight = IntersectAabb(mNodes[right], ray.origin, invDir, ray.tMin, tMax, &tRight);
+
+            if (hitLeft && hitRight)
+            {
+                // Visit the nearer child first
+                bool     leftFirst = (tLeft <= tRight);
+                uint32_t nearIdx   = leftFirst ? left : right;
+                uint32_t farIdx    = leftFirst ? right : left;
+
+                assert((stackSize < TRIMESH_BVH_MAX_DEPTH) && "BVH traversal stack overflow");
+                stack[stackSize++] = {farIdx, leftFirst ? tRight : tLeft};
+                nodeIdx            = nearIdx;
+                continue;
+            }
+            if (hitLeft || hitRight)
+            {
+                nodeIdx = hitLeft ? left : right;
+                continue;
+            }
+        }
+
+        // Pop, skipping nodes that are behind the closest hit
+        bool found = false;
+        while (stackSize > 0)
+        {
+            const StackEntry& entry = stack[--stackSize];
+            if (entry.tNear <= tMax)
+            {
+                nodeIdx = entry.nodeIdx;
+                found   = true;
+                break;
+            }
+        }
+        if (!found)
+        {
+            break;
+        }
+    }
+
+    return hit;
+}
+
+bool TriMeshBVH::Intersect(const TriMeshBVH::Ray& ray, TriMeshBVH::Hit* pHit) const
+{
+    if (IsNull(pHit))
+    {
+        return false;
+    }
+
+    Hit hit = {};
+    if (!Traverse<false>(ray, &hit))
+    {
+        return false;
+    }
+
+    *pHit = hit;
+    return true;
+}
+
+bool TriMeshBVH::IntersectAny(const TriMeshBVH::Ray& ray) const
+{
+    return Traverse<true>(ray, nullptr);
+}
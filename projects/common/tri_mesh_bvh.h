@@ -0,0 +1,95 @@
+#pragma once
+
+#include "tri_mesh.h"
+
+#include <cfloat>
+
+//
+// Bounding volume hierarchy over a TriMesh's triangles for CPU ray queries:
+// picking, AO baking and checking raytracing results without RT hardware.
+//
+// Built top down with binned SAH. The top of the tree is split serially
+// with parallel binning and the subtrees below it are built in parallel.
+// Nodes are flattened in depth first order: an interior node's left child
+// is the next node and the right child is at Node::offset.
+//
+class TriMeshBVH
+{
+public:
+    struct Node
+    {
+        glm::vec3 boundsMin = glm::vec3(0);
+        uint32_t  offset    = 0; // Right child for interior nodes, first triangle for leaves
+        glm::vec3 boundsMax = glm::vec3(0);
+        uint32_t  count     = 0; // Number of triangles, 0 for interior nodes
+
+        bool IsLeaf() const { return (count > 0); }
+    };
+
+    struct BuildOptions
+    {
+        uint32_t maxLeafSize   = 8;
+        uint32_t numBins       = 16;
+        float    traversalCost = 1.0f; // SAH cost of visiting a node, relative to intersecting a triangle
+
+        // clang-format off
+        BuildOptions& MaxLeafSize  (uint32_t value) { maxLeafSize   = value; return *this; }
+        BuildOptions& NumBins      (uint32_t value) { numBins       = value; return *this; }
+        BuildOptions& TraversalCost(float    value) { traversalCost = value; return *this; }
+        // clang-format on
+    };
+
+    struct Ray
+    {
+        glm::vec3 origin    = glm::vec3(0);
+        glm::vec3 direction = glm::vec3(0, 0, 1); // Doesn't need to be normalized, t is in units of direction
+        float     tMin      = 0.0f;
+        float     tMax      = FLT_MAX;
+    };
+
+    struct Hit
+    {
+        float    t        = FLT_MAX;
+        float    u        = 0.0f; // Barycentrics of vIdx1 and vIdx2
+        float    v        = 0.0f;
+        uint32_t triIndex = UINT32_MAX;
+    };
+
+    TriMeshBVH() {}
+
+    ~TriMeshBVH() {}
+
+    static bool Build(const TriMesh& mesh, const TriMeshBVH::BuildOptions& options, TriMeshBVH* pBVH);
+
+    // Closest hit, returns false if nothing was hit
+    bool Intersect(const TriMeshBVH::Ray& ray, TriMeshBVH::Hit* pHit) const;
+
+    // Any hit in [tMin, tMax], for shadow and occlusion rays
+    bool IntersectAny(const TriMeshBVH::Ray& ray) const;
+
+    uint32_t                 GetNumNodes() const { return static_cast<uint32_t>(mNodes.size()); }
+    const std::vector<Node>& GetNodes() const { return mNodes; }
+    uint32_t                 GetNumTriangles() const { return static_cast<uint32_t>(mTriIndices.size()); }
+    uint32_t                 GetMaxDepth() const { return mMaxDepth; }
+
+    // Triangle indices in leaf order, Node::offset indexes this
+    const std::vector<uint32_t>& GetTriangleIndices() const { return mTriIndices; }
+
+private:
+    // Triangles in leaf order, stored as a vertex and two edges for the
+    // ray/triangle test.
+    struct Triangle
+    {
+        glm::vec3 v0;
+        glm::vec3 e1;
+        glm::vec3 e2;
+    };
+
+    template <bool AnyHit>
+    bool Traverse(const TriMeshBVH::Ray& ray, TriMeshBVH::Hit* pHit) const;
+
+    std::vector<Node>     mNodes;
+    std::vector<uint32_t> mTriIndices;
+    std::vector<Triangle> mTriangles;
+    uint32_t              mMaxDepth = 0;
+};
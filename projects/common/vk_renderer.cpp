@@ -647,6 +647,8 @@ VkFormat ToVkFormat(GREXFormat format)
         case GREX_FORMAT_R32_FLOAT          : return VK_FORMAT_R32_SFLOAT;
         case GREX_FORMAT_R32G32_FLOAT       : return VK_FORMAT_R32G32_SFLOAT;
         case GREX_FORMAT_R32G32B32A32_FLOAT : return VK_FORMAT_R32G32B32A32_SFLOAT;
+        case GREX_FORMAT_R16G16B16A16_FLOAT : return VK_FORMAT_R16G16B16A16_SFLOAT;
+        case GREX_FORMAT_R9G9B9E5_UFLOAT    : return VK_FORMAT_E5B9G9R9_UFLOAT_PACK32;
         case GREX_FORMAT_BC1_RGB            : return VK_FORMAT_BC1_RGB_UNORM_BLOCK;
         case GREX_FORMAT_BC3_RGBA           : return VK_FORMAT_BC3_UNORM_BLOCK;
         case GREX_FORMAT_BC4_R              : return VK_FORMAT_BC4_UNORM_BLOCK;
@@ -1441,18 +1443,19 @@ VkResult CreateBuffer(
 }
 
 VkResult CreateImage(
-    VulkanRenderer*   pRenderer,
-    VkImageType       imageType,
-    VkImageUsageFlags imageUsage,
-    uint32_t          width,
-    uint32_t          height,
-    uint32_t          depth,
-    VkFormat          format,
-    uint32_t          numMipLevels,
-    uint32_t          numArrayLayers,
-    VkImageLayout     initialLayout,
-    VmaMemoryUsage    memoryUsage,
-    VulkanImage*      pImage)
+    VulkanRenderer*    pRenderer,
+    VkImageType        imageType,
+    VkImageUsageFlags  imageUsage,
+    uint32_t           width,
+    uint32_t           height,
+    uint32_t           depth,
+    VkFormat           format,
+    uint32_t           numMipLevels,
+    uint32_t           numArrayLayers,
+    VkImageLayout      initialLayout,
+    VmaMemoryUsage     memoryUsage,
+    VulkanImage*       pImage,
+    VkImageCreateFlags createFlags)
 {
     if (IsNull(pImage))
     {
@@ -1460,6 +1463,7 @@ VkResult CreateImage(
     }
 
     VkImageCreateInfo vkci = {VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO};
+    vkci.flags             = createFlags;
     vkci.imageType         = imageType;
     vkci.format            = format;
     vkci.extent.width      = width;
@@ -1620,9 +1624,11 @@ VkResult CreateTexture(
                 if (IsCompressed(format))
                 {
                     //
-                    // If it's compressed, just set the variables to zero and let the API figure it out based on the imageExtents
+                    // If it's compressed, RowStride is the size of a row of 4x4 blocks and
+                    // BytesPerPixel() is the size of a block. Without a RowStride set the
+                    // variables to zero and let the API figure it out based on the imageExtents.
                     //
-                    mipRowStrideInPixels = 0;
+                    mipRowStrideInPixels = 4 * (mipOffset.RowStride / formatSizeInBytes);
                     mipLevelHeight       = 0;
                 }
 
@@ -1716,6 +1722,193 @@ VkResult CreateTexture(
         pImage);
 }
 
+VkResult CreateTexture(
+    VulkanRenderer*               pRenderer,
+    uint32_t                      width,
+    uint32_t                      height,
+    VkFormat                      format,
+    uint32_t                      numArrayLayers,
+    const std::vector<MipOffset>& layerOffsets,
+    uint64_t                      srcSizeBytes,
+    const void*                   pSrcData,
+    VulkanImage*                  pImage)
+{
+    if (IsNull(pRenderer))
+    {
+        return VK_ERROR_UNKNOWN;
+    }
+    if (IsNull(pImage))
+    {
+        return VK_ERROR_UNKNOWN;
+    }
+    if (format == VK_FORMAT_UNDEFINED)
+    {
+        return VK_ERROR_UNKNOWN;
+    }
+    if ((numArrayLayers == 0) || layerOffsets.empty() || ((layerOffsets.size() % numArrayLayers) != 0))
+    {
+        return VK_ERROR_UNKNOWN;
+    }
+
+    uint32_t mipLevels = CountU32(layerOffsets) / numArrayLayers;
+
+    VkImageCreateFlags createFlags = ((numArrayLayers % 6) == 0) ? VK_IMAGE_CREATE_CUBE_COMPATIBLE_BIT : 0;
+
+    VkResult vkres = CreateImage(
+        pRenderer,
+        VK_IMAGE_TYPE_2D,
+        VK_IMAGE_USAGE_SAMPLED_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT,
+        width,
+        height,
+        1,
+        format,
+        mipLevels,
+        numArrayLayers,
+        VK_IMAGE_LAYOUT_UNDEFINED,
+        VMA_MEMORY_USAGE_GPU_ONLY,
+        pImage,
+        createFlags);
+    if (vkres != VK_SUCCESS)
+    {
+        assert(false && "create image failed");
+        return vkres;
+    }
+
+    vkres = TransitionImageLayout(
+        pRenderer,
+        pImage->Image,
+        GREX_ALL_SUBRESOURCES,
+        VK_IMAGE_ASPECT_COLOR_BIT,
+        RESOURCE_STATE_UNKNOWN,
+        RESOURCE_STATE_TRANSFER_DST);
+    if (vkres != VK_SUCCESS)
+    {
+        assert(false && "transition image layout failed");
+        return vkres;
+    }
+
+    if ((srcSizeBytes > 0) && !IsNull(pSrcData))
+    {
+        // The offsets point into the source as is, one copy region per layer per level
+        VulkanBuffer stagingBuffer = {};
+        vkres                      = CreateBuffer(
+            pRenderer,
+            srcSizeBytes,
+            pSrcData,
+            VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+            DEFAULT_MIN_ALIGNMENT_SIZE,
+            &stagingBuffer);
+        if (vkres != VK_SUCCESS)
+        {
+            assert(false && "create staging buffer failed");
+            return vkres;
+        }
+
+        CommandObjects cmdBuf = {};
+        vkres                 = CreateCommandBuffer(pRenderer, VK_COMMAND_POOL_CREATE_TRANSIENT_BIT, &cmdBuf);
+        if (vkres != VK_SUCCESS)
+        {
+            assert(false && "CreateCommandBuffer failed");
+            return vkres;
+        }
+
+        VkCommandBufferBeginInfo vkbi = {VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO};
+        vkbi.flags                    = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+
+        vkres = vkBeginCommandBuffer(cmdBuf.CommandBuffer, &vkbi);
+        if (vkres != VK_SUCCESS)
+        {
+            assert(false && "vkBeginCommandBuffer failed");
+            return vkres;
+        }
+
+        std::vector<VkBufferImageCopy> regions;
+        {
+            uint32_t levelWidth        = width;
+            uint32_t levelHeight       = height;
+            uint32_t formatSizeInBytes = BytesPerPixel(format);
+            for (uint32_t level = 0; level < mipLevels; ++level)
+            {
+                for (uint32_t layer = 0; layer < numArrayLayers; ++layer)
+                {
+                    const auto& layerOffset         = layerOffsets[layer * mipLevels + level];
+                    uint32_t    rowStrideInPixels   = layerOffset.RowStride / formatSizeInBytes;
+                    uint32_t    layerHeightInPixels = levelHeight;
+                    if (IsCompressed(format))
+                    {
+                        // Same as the mip chain version above
+                        rowStrideInPixels   = 4 * (layerOffset.RowStride / formatSizeInBytes);
+                        layerHeightInPixels = 0;
+                    }
+
+                    VkBufferImageCopy region               = {};
+                    region.bufferOffset                    = layerOffset.Offset;
+                    region.bufferRowLength                 = rowStrideInPixels;
+                    region.bufferImageHeight               = layerHeightInPixels;
+                    region.imageSubresource.aspectMask     = VK_IMAGE_ASPECT_COLOR_BIT;
+                    region.imageSubresource.mipLevel       = level;
+                    region.imageSubresource.baseArrayLayer = layer;
+                    region.imageSubresource.layerCount     = 1;
+                    region.imageExtent.width               = std::max<uint32_t>(levelWidth, 1);
+                    region.imageExtent.height              = std::max<uint32_t>(levelHeight, 1);
+                    region.imageExtent.depth               = 1;
+                    regions.push_back(region);
+                }
+
+                levelWidth >>= 1;
+                levelHeight >>= 1;
+            }
+        }
+
+        vkCmdCopyBufferToImage(
+            cmdBuf.CommandBuffer,
+            stagingBuffer.Buffer,
+            pImage->Image,
+            VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+            CountU32(regions),
+            DataPtr(regions));
+
+        vkres = vkEndCommandBuffer(cmdBuf.CommandBuffer);
+        if (vkres != VK_SUCCESS)
+        {
+            assert(false && "vkEndCommandBuffer failed");
+            return vkres;
+        }
+
+        vkres = ExecuteCommandBuffer(pRenderer, &cmdBuf);
+        if (vkres != VK_SUCCESS)
+        {
+            assert(false && "ExecuteCommandBuffer failed");
+            return vkres;
+        }
+
+        vkres = vkQueueWaitIdle(pRenderer->Queue);
+        if (vkres != VK_SUCCESS)
+        {
+            assert(false && "vkQueueWaitIdle failed");
+            return vkres;
+        }
+
+        DestroyCommandBuffer(pRenderer, &cmdBuf);
+        DestroyBuffer(pRenderer, &stagingBuffer);
+    }
+
+    vkres = TransitionImageLayout(
+        pRenderer,
+        pImage->Image,
+        GREX_ALL_SUBRESOURCES,
+        VK_IMAGE_ASPECT_COLOR_BIT,
+        RESOURCE_STATE_TRANSFER_DST,
+        RESOURCE_STATE_COMPUTE_SHADER_RESOURCE);
+    if (vkres != VK_SUCCESS)
+    {
+        assert(false && "transition image layout failed");
+        return vkres;
+    }
+
+    return VK_SUCCESS;
+}
+
 VkResult CreateImageView(
     VulkanRenderer*    pRenderer,
     const VulkanImage* pImage,
@@ -1934,6 +2127,12 @@ void DestroyBuffer(VulkanRenderer* pRenderer, VulkanBuffer* pBuffer)
     *pBuffer = {};
 }
 
+void DestroyImage(VulkanRenderer* pRenderer, VulkanImage* pImage)
+{
+    vmaDestroyImage(pRenderer->Allocator, pImage->Image, pImage->Allocation);
+    *pImage = {};
+}
+
 VkDeviceAddress GetDeviceAddress(VulkanRenderer* pRenderer, const VulkanBuffer* pBuffer)
 {
     assert((pBuffer != nullptr) && "pBuffer is NULL");
@@ -298,18 +298,19 @@ VkResult CreateUAVBuffer(
 */
 
 VkResult CreateImage(
-    VulkanRenderer*   pRenderer,
-    VkImageType       imageType,
-    VkImageUsageFlags imageUsage,
-    uint32_t          width,
-    uint32_t          height,
-    uint32_t          depth,
-    VkFormat          format,
-    uint32_t          numMipLevels,
-    uint32_t          numArrayLayers,
-    VkImageLayout     initialLayout,
-    VmaMemoryUsage    memoryUsage,
-    VulkanImage*      pImage);
+    VulkanRenderer*    pRenderer,
+    VkImageType        imageType,
+    VkImageUsageFlags  imageUsage,
+    uint32_t           width,
+    uint32_t           height,
+    uint32_t           depth,
+    VkFormat           format,
+    uint32_t           numMipLevels,
+    uint32_t           numArrayLayers,
+    VkImageLayout      initialLayout,
+    VmaMemoryUsage     memoryUsage,
+    VulkanImage*       pImage,
+    VkImageCreateFlags createFlags = 0);
 
 VkResult CreateTexture(
     VulkanRenderer*               pRenderer,
@@ -330,6 +331,22 @@ VkResult CreateTexture(
     const void*     pSrcData,
     VulkanImage*    pImage);
 
+// Texture arrays, including cube maps and cube arrays: numArrayLayers is 6
+// per cube with faces in +X, -X, +Y, -Y, +Z, -Z order. A multiple of 6
+// layers creates a cube compatible image. layerOffsets has one MipOffset
+// per layer per level, layer major like texture files:
+// [layer * numMipLevels + level].
+VkResult CreateTexture(
+    VulkanRenderer*               pRenderer,
+    uint32_t                      width,
+    uint32_t                      height,
+    VkFormat                      format,
+    uint32_t                      numArrayLayers,
+    const std::vector<MipOffset>& layerOffsets,
+    uint64_t                      srcSizeBytes,
+    const void*                   pSrcData,
+    VulkanImage*                  pImage);
+
 VkResult CreateImageView(
     VulkanRenderer*    pRenderer,
     const VulkanImage* pImage,
@@ -356,6 +373,7 @@ VkResult CreateRenderPass(
     VulkanRenderPass*                        pRenderPass);
 
 void DestroyBuffer(VulkanRenderer* pRenderer, VulkanBuffer* pBuffer);
+void DestroyImage(VulkanRenderer* pRenderer, VulkanImage* pImage);
 
 VkDeviceAddress GetDeviceAddress(VulkanRenderer* pRenderer, const VulkanBuffer* pBuffer);
 VkDeviceAddress GetDeviceAddress(VulkanRenderer* pRenderer, VkAccelerationStructureKHR accelStruct);
@@ -27,8 +27,9 @@ using namespace glm;
 struct DrawParameters
 {
     uint32_t               materialIndex = 0;
+    uint32_t               firstIndex    = 0;
     uint32_t               numIndices    = 0;
-    ComPtr<ID3D12Resource> indexBuffer   = nullptr;
+    ComPtr<ID3D12Resource> indexBuffer   = nullptr; // Shared by all draws
 };
 
 struct Material
@@ -306,7 +307,7 @@ int main(int argc, char** argv)
                 // DrawParams (b1)
                 commandList->SetGraphicsRoot32BitConstants(1, 1, &draw.materialIndex, 0);
 
-                commandList->DrawIndexedInstanced(draw.numIndices, 1, 0, 0, 0);
+                commandList->DrawIndexedInstanced(draw.numIndices, 1, draw.firstIndex, 0, 0);
             }
         }
         D3D12_RESOURCE_BARRIER postRenderBarrier = CreateTransition(swapchainBuffer.Get(), D3D12_RESOURCE_STATE_RENDER_TARGET, D3D12_RESOURCE_STATE_PRESENT);
@@ -382,6 +383,14 @@ void CreateGeometryBuffers(
 
     *pLightPosition = mesh.GetGroup(lightGroupIndex).GetBounds().Center();
 
+    // One index buffer for the whole mesh, each draw is a material range in it
+    ComPtr<ID3D12Resource> indexBuffer;
+    CHECK_CALL(CreateBuffer(
+        pRenderer,
+        SizeInBytes(mesh.GetTriangles()),
+        DataPtr(mesh.GetTriangles()),
+        &indexBuffer));
+
     std::vector<Material> materials;
     for (uint32_t materialIndex = 0; materialIndex < mesh.GetNumMaterials(); ++materialIndex)
     {
@@ -392,19 +401,16 @@ void CreateGeometryBuffers(
         material.recieveLight = (matDesc.name != "white light") ? true : false;
         materials.push_back(material);
 
-        auto triangles = mesh.GetTrianglesForMaterial(materialIndex);
-
-        DrawParameters params = {};
-        params.numIndices     = static_cast<uint32_t>(3 * triangles.size());
-        params.materialIndex  = materialIndex;
-
-        CHECK_CALL(CreateBuffer(
-            pRenderer,
-            SizeInBytes(triangles),
-            DataPtr(triangles),
-            &params.indexBuffer));
+        for (auto& range : mesh.GetMaterialRanges(materialIndex))
+        {
+            DrawParameters params = {};
+            params.materialIndex  = materialIndex;
+            params.firstIndex     = 3 * range.firstTriangle;
+            params.numIndices     = 3 * range.numTriangles;
+            params.indexBuffer    = indexBuffer;
 
-        outDrawParams.push_back(params);
+            outDrawParams.push_back(params);
+        }
     }
 
     CHECK_CALL(CreateBuffer(
@@ -28,8 +28,9 @@ using namespace glm;
 struct DrawParameters
 {
     uint32_t    materialIndex = 0;
+    uint32_t    firstIndex    = 0;
     uint32_t    numIndices    = 0;
-    MetalBuffer indexBuffer;
+    MetalBuffer indexBuffer; // Shared by all draws
 };
 
 struct Material
@@ -286,7 +287,7 @@ int main(int argc, char** argv)
                 draw.numIndices,
                 MTL::IndexTypeUInt32,
                 draw.indexBuffer.Buffer.get(),
-                0);
+                draw.firstIndex * sizeof(uint32_t));
         }
 
         pRenderEncoder->endEncoding();
@@ -317,6 +318,14 @@ void CreateGeometryBuffers(
 
     *pLightPosition = mesh.GetGroup(lightGroupIndex).GetBounds().Center();
 
+    // One index buffer for the whole mesh, each draw is a material range in it
+    MetalBuffer indexBuffer;
+    CHECK_CALL(CreateBuffer(
+        pRenderer,
+        SizeInBytes(mesh.GetTriangles()),
+        DataPtr(mesh.GetTriangles()),
+        &indexBuffer));
+
     std::vector<Material> materials;
     for (uint32_t materialIndex = 0; materialIndex < mesh.GetNumMaterials(); ++materialIndex)
     {
@@ -327,19 +336,16 @@ void CreateGeometryBuffers(
         material.recieveLight = (matDesc.name != "white light") ? true : false;
         materials.push_back(material);
 
-        auto triangles = mesh.GetTrianglesForMaterial(materialIndex);
-
-        DrawParameters params = {};
-        params.numIndices     = static_cast<uint32_t>(3 * triangles.size());
-        params.materialIndex  = materialIndex;
-
-        CHECK_CALL(CreateBuffer(
-            pRenderer,
-            SizeInBytes(triangles),
-            DataPtr(triangles),
-            &params.indexBuffer));
+        for (auto& range : mesh.GetMaterialRanges(materialIndex))
+        {
+            DrawParameters params = {};
+            params.materialIndex  = materialIndex;
+            params.firstIndex     = 3 * range.firstTriangle;
+            params.numIndices     = 3 * range.numTriangles;
+            params.indexBuffer    = indexBuffer;
 
-        outDrawParams.push_back(params);
+            outDrawParams.push_back(params);
+        }
     }
 
     CHECK_CALL(CreateBuffer(
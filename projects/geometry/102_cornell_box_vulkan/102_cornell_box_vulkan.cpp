@@ -28,8 +28,9 @@ using namespace glm;
 struct DrawInfo
 {
     uint32_t     materialIndex = 0;
+    uint32_t     firstIndex    = 0;
     uint32_t     numIndices    = 0;
-    VulkanBuffer indexBuffer;
+    VulkanBuffer indexBuffer; // Shared by all draws
 };
 
 struct Material
@@ -450,7 +451,7 @@ int main(int argc, char** argv)
                     sizeof(DrawParameters),
                     &draw.materialIndex);
 
-                vkCmdDrawIndexed(cmdBuf.CommandBuffer, draw.numIndices, 1, 0, 0, 0);
+                vkCmdDrawIndexed(cmdBuf.CommandBuffer, draw.numIndices, 1, draw.firstIndex, 0, 0);
             }
 
             vkCmdEndRendering(cmdBuf.CommandBuffer);
@@ -586,6 +587,17 @@ void CreateGeometryBuffers(
 
     *pLightPosition = mesh.GetGroup(lightGroupIndex).GetBounds().Center();
 
+    // One index buffer for the whole mesh, each draw is a material range in it
+    VulkanBuffer indexBuffer = {};
+    CHECK_CALL(CreateBuffer(
+        pRenderer,
+        SizeInBytes(mesh.GetTriangles()),
+        DataPtr(mesh.GetTriangles()),
+        VK_BUFFER_USAGE_INDEX_BUFFER_BIT,
+        VMA_MEMORY_USAGE_GPU_ONLY,
+        0,
+        &indexBuffer));
+
     std::vector<Material> materials;
     for (uint32_t materialIndex = 0; materialIndex < mesh.GetNumMaterials(); ++materialIndex)
     {
@@ -596,22 +608,16 @@ void CreateGeometryBuffers(
         material.recieveLight = (matDesc.name != "white light") ? true : false;
         materials.push_back(material);
 
-        auto triangles = mesh.GetTrianglesForMaterial(materialIndex);
-
-        DrawInfo params      = {};
-        params.numIndices    = static_cast<uint32_t>(3 * triangles.size());
-        params.materialIndex = materialIndex;
-
-        CHECK_CALL(CreateBuffer(
-            pRenderer,
-            SizeInBytes(triangles),
-            DataPtr(triangles),
-            VK_BUFFER_USAGE_INDEX_BUFFER_BIT,
-            VMA_MEMORY_USAGE_GPU_ONLY,
-            0,
-            &params.indexBuffer));
+        for (auto& range : mesh.GetMaterialRanges(materialIndex))
+        {
+            DrawInfo params      = {};
+            params.materialIndex = materialIndex;
+            params.firstIndex    = 3 * range.firstTriangle;
+            params.numIndices    = 3 * range.numTriangles;
+            params.indexBuffer   = indexBuffer;
 
-        outDrawParams.push_back(params);
+            outDrawParams.push_back(params);
+        }
     }
 
     CHECK_CALL(CreateBuffer(
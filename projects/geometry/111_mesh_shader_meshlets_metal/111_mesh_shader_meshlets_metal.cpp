@@ -10,7 +10,7 @@
 #include <glm/gtx/transform.hpp>
 using namespace glm;
 
-#include "meshoptimizer.h"
+#include "meshlet.h"
 
 #define CHECK_CALL(FN)                                                               \
     {                                                                                \
@@ -94,10 +94,8 @@ int main(int argc, char** argv)
     // *************************************************************************
     // Make them meshlets!
     // *************************************************************************
-    std::vector<glm::vec3>       positions;
-    std::vector<meshopt_Meshlet> meshlets;
-    std::vector<uint32_t>        meshletVertices;
-    std::vector<uint8_t>         meshletTriangles;
+    std::vector<glm::vec3> positions;
+    MeshletBuffers         meshlets = {};
     {
         //
         // Use a cube to debug when needed
@@ -105,70 +103,14 @@ int main(int argc, char** argv)
         // TriMesh mesh = TriMesh::Cube(glm::vec3(0.25f), false, options);
 
         TriMesh mesh = {};
-        bool    res  = TriMesh::LoadOBJ2(GetAssetPath("models/horse_statue_01_1k.obj").string(), &mesh);
+        bool    res  = LoadOBJMeshletsCached(GetAssetPath("models/horse_statue_01_1k.obj").string(), "", TriMesh::Options(), MeshletOptions().MaxVertices(64).MaxTriangles(124), &mesh, &meshlets);
         if (!res)
         {
             assert(false && "failed to load model");
+            return EXIT_FAILURE;
         }
 
         positions = mesh.GetPositions();
-
-        const size_t kMaxVertices  = 64;
-        const size_t kMaxTriangles = 124;
-        const float  kConeWeight   = 0.0f;
-
-        const size_t maxMeshlets = meshopt_buildMeshletsBound(mesh.GetNumIndices(), kMaxVertices, kMaxTriangles);
-
-        meshlets.resize(maxMeshlets);
-        meshletVertices.resize(maxMeshlets * kMaxVertices);
-        meshletTriangles.resize(maxMeshlets * kMaxTriangles * 3);
-
-        size_t meshletCount = meshopt_buildMeshlets(
-            meshlets.data(),
-            meshletVertices.data(),
-            meshletTriangles.data(),
-            reinterpret_cast<const uint32_t*>(mesh.GetTriangles().data()),
-            mesh.GetNumIndices(),
-            reinterpret_cast<const float*>(mesh.GetPositions().data()),
-            mesh.GetNumVertices(),
-            sizeof(glm::vec3),
-            kMaxVertices,
-            kMaxTriangles,
-            kConeWeight);
-
-        auto& last = meshlets[meshletCount - 1];
-        meshletVertices.resize(last.vertex_offset + last.vertex_count);
-        meshletTriangles.resize(last.triangle_offset + ((last.triangle_count * 3 + 3) & ~3));
-        meshlets.resize(meshletCount);
-    }
-
-    // Repack triangles from 3 consecutive byes to 4-byte uint32_t to
-    // make it easier to unpack on the GPU.
-    //
-    std::vector<uint32_t> meshletTrianglesU32;
-    for (auto& m : meshlets)
-    {
-        // Save triangle offset for current meshlet
-        uint32_t triangleOffset = static_cast<uint32_t>(meshletTrianglesU32.size());
-
-        // Repack to uint32_t
-        for (uint32_t i = 0; i < m.triangle_count; ++i)
-        {
-            uint32_t i0 = 3 * i + 0 + m.triangle_offset;
-            uint32_t i1 = 3 * i + 1 + m.triangle_offset;
-            uint32_t i2 = 3 * i + 2 + m.triangle_offset;
-
-            uint8_t  vIdx0  = meshletTriangles[i0];
-            uint8_t  vIdx1  = meshletTriangles[i1];
-            uint8_t  vIdx2  = meshletTriangles[i2];
-            uint32_t packed = ((static_cast<uint32_t>(vIdx0) & 0xFF) << 0) |
-                              ((static_cast<uint32_t>(vIdx1) & 0xFF) << 8) |
-                              ((static_cast<uint32_t>(vIdx2) & 0xFF) << 16);
-            meshletTrianglesU32.push_back(packed);
-        }
-
-        // Update triangle offset for current meshlet
-        m.triangle_offset = triangleOffset;
     }
 
     MetalBuffer positionBuffer;
@@ -177,9 +119,9 @@ int main(int argc, char** argv)
     MetalBuffer meshletTrianglesBuffer;
     {
         CHECK_CALL(CreateBuffer(renderer.get(), SizeInBytes(positions), DataPtr(positions), &positionBuffer));
-        CHECK_CALL(CreateBuffer(renderer.get(), SizeInBytes(meshlets), DataPtr(meshlets), &meshletBuffer));
-        CHECK_CALL(CreateBuffer(renderer.get(), SizeInBytes(meshletVertices), DataPtr(meshletVertices), &meshletVerticesBuffer));
-        CHECK_CALL(CreateBuffer(renderer.get(), SizeInBytes(meshletTrianglesU32), DataPtr(meshletTrianglesU32), &meshletTrianglesBuffer));
+        CHECK_CALL(CreateBuffer(renderer.get(), SizeInBytes(meshlets.meshlets), DataPtr(meshlets.meshlets), &meshletBuffer));
+        CHECK_CALL(CreateBuffer(renderer.get(), SizeInBytes(meshlets.vertices), DataPtr(meshlets.vertices), &meshletVerticesBuffer));
+        CHECK_CALL(CreateBuffer(renderer.get(), SizeInBytes(meshlets.triangles), DataPtr(meshlets.triangles), &meshletTrianglesBuffer));
     }
 
     // *************************************************************************
@@ -305,7 +247,7 @@ int main(int argc, char** argv)
         pRenderEncoder->setMeshBuffer(meshletTrianglesBuffer.Buffer.get(), 0, 4);
 
         // No object function, so all zeros for threadsPerObjectThreadgroup
-        pRenderEncoder->drawMeshThreadgroups(MTL::Size(static_cast<uint32_t>(meshlets.size()), 1, 1), MTL::Size(0, 0, 0), MTL::Size(128, 1, 1));
+        pRenderEncoder->drawMeshThreadgroups(MTL::Size(static_cast<uint32_t>(meshlets.meshlets.size()), 1, 1), MTL::Size(0, 0, 0), MTL::Size(128, 1, 1));
 
         pRenderEncoder->endEncoding();
 
@@ -10,7 +10,7 @@
 #include <glm/gtx/transform.hpp>
 using namespace glm;
 
-#include "meshoptimizer.h"
+#include "meshlet.h"
 
 #include <cinttypes>
 
@@ -209,101 +209,20 @@ int main(int argc, char** argv)
     // *************************************************************************
     // Make them meshlets!
     // *************************************************************************
-    TriMesh::Aabb                meshBounds = {};
-    std::vector<float3>          positions;
-    std::vector<meshopt_Meshlet> meshlets;
-    std::vector<uint32_t>        meshletVertices;
-    std::vector<uint8_t>         meshletTriangles;
+    TriMesh::Aabb       meshBounds = {};
+    std::vector<float3> positions;
+    MeshletBuffers      meshlets   = {};
     {
         TriMesh mesh = {};
-        bool    res  = TriMesh::LoadOBJ2(GetAssetPath("models/horse_statue_01_1k.obj").string(), &mesh);
+        bool    res  = LoadOBJMeshletsCached(GetAssetPath("models/horse_statue_01_1k.obj").string(), "", TriMesh::Options(), MeshletOptions().MaxVertices(64).MaxTriangles(124), &mesh, &meshlets);
         if (!res)
         {
             assert(false && "failed to load model");
+            return EXIT_FAILURE;
         }
 
         meshBounds = mesh.GetBounds();
         positions  = mesh.GetPositions();
-
-        const size_t kMaxVertices  = 64;
-        const size_t kMaxTriangles = 124;
-        const float  kConeWeight   = 0.0f;
-
-        const size_t maxMeshlets = meshopt_buildMeshletsBound(mesh.GetNumIndices(), kMaxVertices, kMaxTriangles);
-
-        meshlets.resize(maxMeshlets);
-        meshletVertices.resize(maxMeshlets * kMaxVertices);
-        meshletTriangles.resize(maxMeshlets * kMaxTriangles * 3);
-
-        size_t meshletCount = meshopt_buildMeshlets(
-            meshlets.data(),
-            meshletVertices.data(),
-            meshletTriangles.data(),
-            reinterpret_cast<const uint32_t*>(mesh.GetTriangles().data()),
-            mesh.GetNumIndices(),
-            reinterpret_cast<const float*>(mesh.GetPositions().data()),
-            mesh.GetNumVertices(),
-            sizeof(float3),
-            kMaxVertices,
-            kMaxTriangles,
-            kConeWeight);
-
-        auto& last = meshlets[meshletCount - 1];
-        meshletVertices.resize(last.vertex_offset + last.vertex_count);
-        meshletTriangles.resize(last.triangle_offset + ((last.triangle_count * 3 + 3) & ~3));
-        meshlets.resize(meshletCount);
-    }
-
-    // Meshlet bounds (we're using bounding spheres)
-    std::vector<float4> meshletBounds;
-    for (auto& meshlet : meshlets)
-    {
-        auto bounds = meshopt_computeMeshletBounds(
-            &meshletVertices[meshlet.vertex_offset],
-            &meshletTriangles[meshlet.triangle_offset],
-            meshlet.triangle_count,
-            reinterpret_cast<const float*>(positions.data()),
-            positions.size(),
-            sizeof(float3));
-        meshletBounds.push_back(float4(bounds.center[0], bounds.center[1], bounds.center[2], bounds.radius));
-    }
-
-    // Get some counts to use later
-    uint64_t meshletVertexCount   = 0;
-    uint64_t meshletTriangleCount = 0;
-    for (auto& m : meshlets)
-    {
-        meshletVertexCount += m.vertex_count;
-        meshletTriangleCount += m.triangle_count;
-    }
-
-    // Repack triangles from 3 consecutive byes to 4-byte uint32_t to
-    // make it easier to unpack on the GPU.
-    //
-    std::vector<uint32_t> meshletTrianglesU32;
-    for (auto& m : meshlets)
-    {
-        // Save triangle offset for current meshlet
-        uint32_t triangleOffset = static_cast<uint32_t>(meshletTrianglesU32.size());
-
-        // Repack to uint32_t
-        for (uint32_t i = 0; i < m.triangle_count; ++i)
-        {
-            uint32_t i0 = 3 * i + 0 + m.triangle_offset;
-            uint32_t i1 = 3 * i + 1 + m.triangle_offset;
-            uint32_t i2 = 3 * i + 2 + m.triangle_offset;
-
-            uint8_t  vIdx0  = meshletTriangles[i0];
-            uint8_t  vIdx1  = meshletTriangles[i1];
-            uint8_t  vIdx2  = meshletTriangles[i2];
-            uint32_t packed = ((static_cast<uint32_t>(vIdx0) & 0xFF) << 0) |
-                              ((static_cast<uint32_t>(vIdx1) & 0xFF) << 8) |
-                              ((static_cast<uint32_t>(vIdx2) & 0xFF) << 16);
-            meshletTrianglesU32.push_back(packed);
-        }
-
-        // Update triangle offset for current meshlet
-        m.triangle_offset = triangleOffset;
     }
 
     ComPtr<ID3D12Resource> positionBuffer;
@@ -313,10 +232,10 @@ int main(int argc, char** argv)
     ComPtr<ID3D12Resource> meshletBoundsBuffer;
     {
         CHECK_CALL(CreateBuffer(renderer.get(), SizeInBytes(positions), DataPtr(positions), D3D12_HEAP_TYPE_UPLOAD, &positionBuffer));
-        CHECK_CALL(CreateBuffer(renderer.get(), SizeInBytes(meshlets), DataPtr(meshlets), D3D12_HEAP_TYPE_UPLOAD, &meshletBuffer));
-        CHECK_CALL(CreateBuffer(renderer.get(), SizeInBytes(meshletVertices), DataPtr(meshletVertices), D3D12_HEAP_TYPE_UPLOAD, &meshletVerticesBuffer));
-        CHECK_CALL(CreateBuffer(renderer.get(), SizeInBytes(meshletTrianglesU32), DataPtr(meshletTrianglesU32), D3D12_HEAP_TYPE_UPLOAD, &meshletTrianglesBuffer));
-        CHECK_CALL(CreateBuffer(renderer.get(), SizeInBytes(meshletBounds), DataPtr(meshletBounds), D3D12_HEAP_TYPE_UPLOAD, &meshletBoundsBuffer));
+        CHECK_CALL(CreateBuffer(renderer.get(), SizeInBytes(meshlets.meshlets), DataPtr(meshlets.meshlets), D3D12_HEAP_TYPE_UPLOAD, &meshletBuffer));
+        CHECK_CALL(CreateBuffer(renderer.get(), SizeInBytes(meshlets.vertices), DataPtr(meshlets.vertices), D3D12_HEAP_TYPE_UPLOAD, &meshletVerticesBuffer));
+        CHECK_CALL(CreateBuffer(renderer.get(), SizeInBytes(meshlets.triangles), DataPtr(meshlets.triangles), D3D12_HEAP_TYPE_UPLOAD, &meshletTrianglesBuffer));
+        CHECK_CALL(CreateBuffer(renderer.get(), SizeInBytes(meshlets.boundingSpheres), DataPtr(meshlets.boundingSpheres), D3D12_HEAP_TYPE_UPLOAD, &meshletBoundsBuffer));
     }
 
     // *************************************************************************
@@ -464,17 +383,17 @@ int main(int argc, char** argv)
 
             ImGui::Separator();
 
-            auto meshletCount               = meshlets.size();
+            auto meshletCount               = meshlets.meshlets.size();
             auto instanceCount              = instances.size();
             auto totalMeshletCount          = meshletCount * instanceCount;
-            auto totalMeshletVertexCount    = meshletVertexCount * instanceCount;
-            auto totalMeshletPrimitiveCount = meshletTriangleCount * instanceCount;
+            auto totalMeshletVertexCount    = meshlets.lods[0].meshlets.vertexCount * instanceCount;
+            auto totalMeshletPrimitiveCount = meshlets.lods[0].meshlets.triangleCount * instanceCount;
 
             ImGui::Columns(2);
             // clang-format off
             ImGui::Text("Meshlet Count");                     ImGui::NextColumn(); ImGui::Text("%d", meshletCount); ImGui::NextColumn();
-            ImGui::Text("Meshlet Vertex Count");              ImGui::NextColumn(); ImGui::Text("%d", meshletVertexCount); ImGui::NextColumn();
-            ImGui::Text("Meshlet Primitive Count");           ImGui::NextColumn(); ImGui::Text("%d", meshletTriangleCount); ImGui::NextColumn();
+            ImGui::Text("Meshlet Vertex Count");              ImGui::NextColumn(); ImGui::Text("%d", meshlets.lods[0].meshlets.vertexCount); ImGui::NextColumn();
+            ImGui::Text("Meshlet Primitive Count");           ImGui::NextColumn(); ImGui::Text("%d", meshlets.lods[0].meshlets.triangleCount); ImGui::NextColumn();
             ImGui::Text("Instance Count");                    ImGui::NextColumn(); ImGui::Text("%d", instanceCount); ImGui::NextColumn();                
             ImGui::Text("Instanced Meshlet Count");           ImGui::NextColumn(); ImGui::Text("%d", totalMeshletCount); ImGui::NextColumn();                
             ImGui::Text("Instanced Meshlet Vertex Count");    ImGui::NextColumn(); ImGui::Text("%d", totalMeshletVertexCount); ImGui::NextColumn();                
@@ -567,7 +486,7 @@ int main(int argc, char** argv)
             scene.Frustum.Cone.Direction               = frCone.Dir;
             scene.Frustum.Cone.Angle                   = frCone.Angle;
             scene.InstanceCount                        = static_cast<uint32_t>(instances.size());
-            scene.MeshletCount                         = static_cast<uint32_t>(meshlets.size());
+            scene.MeshletCount                         = static_cast<uint32_t>(meshlets.meshlets.size());
             scene.VisibilityFunc                       = gVisibilityFunc;
 
             void* pDst = nullptr;
@@ -631,7 +550,7 @@ int main(int argc, char** argv)
                 commandList->BeginQuery(queryHeap.Get(), D3D12_QUERY_TYPE_PIPELINE_STATISTICS1, 0);
 
                 // Amplification shader uses 32 for thread group size
-                UINT meshletCount      = static_cast<UINT>(meshlets.size());
+                UINT meshletCount      = static_cast<UINT>(meshlets.meshlets.size());
                 UINT instanceCount     = static_cast<UINT>(instances.size());
                 UINT threadGroupCountX = ((meshletCount * instanceCount) / 32) + 1;
                 commandList->DispatchMesh(threadGroupCountX, 1, 1);
@@ -10,7 +10,7 @@
 #include <glm/gtx/transform.hpp>
 using namespace glm;
 
-#include "meshoptimizer.h"
+#include "meshlet.h"
 
 #define CHECK_CALL(FN)                                                               \
     {                                                                                \
@@ -130,7 +130,7 @@ int main(int argc, char** argv)
         // LOD 0
         {
             TriMesh mesh = {};
-            bool    res  = TriMesh::LoadOBJ2(GetAssetPath("models/horse_statue_01_1k.obj").string(), &mesh);
+            bool    res  = TriMesh::LoadOBJCached(GetAssetPath("models/horse_statue_01_1k.obj").string(), "", TriMesh::Options(), &mesh);
             if (!res)
             {
                 assert(false && "failed to load model LOD 0");
@@ -139,188 +139,43 @@ int main(int argc, char** argv)
             meshLODs.push_back(mesh);
         }
 
-        // LOD 1
-        {
-            TriMesh mesh = {};
-            bool    res  = TriMesh::LoadOBJ2(GetAssetPath("models/horse_statue_01_1k_LOD_1.obj").string(), &mesh);
-            if (!res)
-            {
-                assert(false && "failed to load model LOD 1");
-                return EXIT_FAILURE;
-            }
-            meshLODs.push_back(mesh);
-        }
-
-        // LOD 2
-        {
-            TriMesh mesh = {};
-            bool    res  = TriMesh::LoadOBJ2(GetAssetPath("models/horse_statue_01_1k_LOD_2.obj").string(), &mesh);
-            if (!res)
-            {
-                assert(false && "failed to load model LOD 2");
-                return EXIT_FAILURE;
-            }
-            meshLODs.push_back(mesh);
-        }
-
-        // LOD 3
-        {
-            TriMesh mesh = {};
-            bool    res  = TriMesh::LoadOBJ2(GetAssetPath("models/horse_statue_01_1k_LOD_3.obj").string(), &mesh);
-            if (!res)
-            {
-                assert(false && "failed to load model LOD 3");
-                return EXIT_FAILURE;
-            }
-            meshLODs.push_back(mesh);
-        }
-
-        // LOD 4
+        // LOD 1 - 4
+        //
+        // Generated from LOD 0 instead of loading hand authored files, ratios
+        // roughly match the triangle counts of horse_statue_01_1k_LOD_[1-4].obj.
+        //
         {
-            TriMesh mesh = {};
-            bool    res  = TriMesh::LoadOBJ2(GetAssetPath("models/horse_statue_01_1k_LOD_4.obj").string(), &mesh);
-            if (!res)
+            std::vector<TriMesh::LODTarget> targets = {
+                {0.5f, 1.0f},
+                {0.19f, 1.0f},
+                {0.05f, 1.0f},
+                {0.005f, 1.0f},
+            };
+
+            auto lods = meshLODs[0].GenerateLODs(targets);
+            for (auto& lod : lods)
             {
-                assert(false && "failed to load model LOD 4");
-                return EXIT_FAILURE;
+                meshLODs.push_back(lod.mesh);
             }
-            meshLODs.push_back(mesh);
         }
     }
 
     // *************************************************************************
     // Make them meshlets!
     // *************************************************************************
-    TriMesh::Aabb                meshBounds = meshLODs[0].GetBounds();
-    std::vector<float3>          combinedMeshPositions;
-    std::vector<meshopt_Meshlet> combinedMeshlets;
-    std::vector<uint32_t>        combinedMeshletVertices;
-    std::vector<uint8_t>         combinedMeshletTriangles;
-    std::vector<uint32_t>        meshlet_LOD_Offsets;
-    std::vector<uint32_t>        meshlet_LOD_Counts;
-    uint32_t                     LOD_0_vertexCount   = 0;
-    uint32_t                     LOD_0_triangleCount = 0;
-
-    for (size_t lodIdx = 0; lodIdx < meshLODs.size(); ++lodIdx)
-    {
-        const auto& mesh = meshLODs[lodIdx];
-
-        const size_t kMaxVertices  = 64;
-        const size_t kMaxTriangles = 124;
-        const float  kConeWeight   = 0.0f;
-
-        std::vector<meshopt_Meshlet> meshlets;
-        std::vector<uint32_t>        meshletVertices;
-        std::vector<uint8_t>         meshletTriangles;
-
-        const size_t maxMeshlets = meshopt_buildMeshletsBound(mesh.GetNumIndices(), kMaxVertices, kMaxTriangles);
-
-        meshlets.resize(maxMeshlets);
-        meshletVertices.resize(maxMeshlets * kMaxVertices);
-        meshletTriangles.resize(maxMeshlets * kMaxTriangles * 3);
-
-        size_t meshletCount = meshopt_buildMeshlets(
-            meshlets.data(),
-            meshletVertices.data(),
-            meshletTriangles.data(),
-            reinterpret_cast<const uint32_t*>(mesh.GetTriangles().data()),
-            mesh.GetNumIndices(),
-            reinterpret_cast<const float*>(mesh.GetPositions().data()),
-            mesh.GetNumVertices(),
-            sizeof(float3),
-            kMaxVertices,
-            kMaxTriangles,
-            kConeWeight);
-
-        auto& last = meshlets[meshletCount - 1];
-        meshletVertices.resize(last.vertex_offset + last.vertex_count);
-        meshletTriangles.resize(last.triangle_offset + ((last.triangle_count * 3 + 3) & ~3));
-        meshlets.resize(meshletCount);
-
-        // Meshlet LOD offset and count
-        meshlet_LOD_Offsets.push_back(static_cast<uint32_t>(combinedMeshlets.size()));
-        meshlet_LOD_Counts.push_back(static_cast<uint32_t>(meshlets.size()));
-
-        // Current offsets
-        const uint32_t vertexOffset          = static_cast<uint32_t>(combinedMeshPositions.size());
-        const uint32_t meshletVertexOffset   = static_cast<uint32_t>(combinedMeshletVertices.size());
-        const uint32_t meshletTriangleOffset = static_cast<uint32_t>(combinedMeshletTriangles.size());
-
-        // Copy to combined
-        std::copy(mesh.GetPositions().begin(), mesh.GetPositions().end(), std::back_inserter(combinedMeshPositions));
-
-        for (auto meshlet : meshlets)
-        {
-            meshlet.vertex_offset += meshletVertexOffset;
-            meshlet.triangle_offset += meshletTriangleOffset;
-            combinedMeshlets.push_back(meshlet);
-
-            if (lodIdx == 0)
-            {
-                LOD_0_vertexCount += meshlet.vertex_count;
-                LOD_0_triangleCount += meshlet.triangle_count;
-            }
-        }
-
-        for (auto vertex : meshletVertices)
-        {
-            vertex += vertexOffset;
-            combinedMeshletVertices.push_back(vertex);
-        }
-
-        std::copy(meshletTriangles.begin(), meshletTriangles.end(), std::back_inserter(combinedMeshletTriangles));
-    }
-
-    // Meshlet bounds (we're using bounding spheres)
-    std::vector<float4> meshletBounds;
-    for (auto& meshlet : combinedMeshlets)
-    {
-        auto bounds = meshopt_computeMeshletBounds(
-            &combinedMeshletVertices[meshlet.vertex_offset],
-            &combinedMeshletTriangles[meshlet.triangle_offset],
-            meshlet.triangle_count,
-            reinterpret_cast<const float*>(combinedMeshPositions.data()),
-            combinedMeshPositions.size(),
-            sizeof(float3));
-        meshletBounds.push_back(float4(bounds.center[0], bounds.center[1], bounds.center[2], bounds.radius));
-    }
-
-    // Get some counts to use later
-    uint64_t combinedMeshletVertexCount   = 0;
-    uint64_t combinedMeshletTriangleCount = 0;
-    for (auto& m : combinedMeshlets)
+    TriMesh::Aabb  meshBounds = meshLODs[0].GetBounds();
+    MeshletBuffers meshlets   = {};
+    if (!BuildMeshlets(meshLODs, MeshletOptions().MaxVertices(64).MaxTriangles(124), &meshlets))
     {
-        combinedMeshletVertexCount += m.vertex_count;
-        combinedMeshletTriangleCount += m.triangle_count;
+        assert(false && "BuildMeshlets failed");
+        return EXIT_FAILURE;
     }
 
-    // Repack triangles from 3 consecutive byes to 4-byte uint32_t to
-    // make it easier to unpack on the GPU.
-    //
-    std::vector<uint32_t> meshletTrianglesU32;
-    for (auto& m : combinedMeshlets)
+    // Meshlet vertices index all LODs' positions in LOD order
+    std::vector<float3> combinedMeshPositions;
+    for (auto& mesh : meshLODs)
     {
-        // Save triangle offset for current meshlet
-        uint32_t triangleOffset = static_cast<uint32_t>(meshletTrianglesU32.size());
-
-        // Repack to uint32_t
-        for (uint32_t i = 0; i < m.triangle_count; ++i)
-        {
-            uint32_t i0 = 3 * i + 0 + m.triangle_offset;
-            uint32_t i1 = 3 * i + 1 + m.triangle_offset;
-            uint32_t i2 = 3 * i + 2 + m.triangle_offset;
-
-            uint8_t  vIdx0  = combinedMeshletTriangles[i0];
-            uint8_t  vIdx1  = combinedMeshletTriangles[i1];
-            uint8_t  vIdx2  = combinedMeshletTriangles[i2];
-            uint32_t packed = ((static_cast<uint32_t>(vIdx0) & 0xFF) << 0) |
-                              ((static_cast<uint32_t>(vIdx1) & 0xFF) << 8) |
-                              ((static_cast<uint32_t>(vIdx2) & 0xFF) << 16);
-            meshletTrianglesU32.push_back(packed);
-        }
-
-        // Update triangle offset for current meshlet
-        m.triangle_offset = triangleOffset;
+        std::copy(mesh.GetPositions().begin(), mesh.GetPositions().end(), std::back_inserter(combinedMeshPositions));
     }
 
     MetalBuffer positionBuffer;
@@ -330,10 +185,10 @@ int main(int argc, char** argv)
     MetalBuffer meshletBoundsBuffer;
     {
         CHECK_CALL(CreateBuffer(renderer.get(), SizeInBytes(combinedMeshPositions), DataPtr(combinedMeshPositions), &positionBuffer));
-        CHECK_CALL(CreateBuffer(renderer.get(), SizeInBytes(combinedMeshlets), DataPtr(combinedMeshlets), &meshletBuffer));
-        CHECK_CALL(CreateBuffer(renderer.get(), SizeInBytes(combinedMeshletVertices), DataPtr(combinedMeshletVertices), &meshletVerticesBuffer));
-        CHECK_CALL(CreateBuffer(renderer.get(), SizeInBytes(meshletTrianglesU32), DataPtr(meshletTrianglesU32), &meshletTrianglesBuffer));
-        CHECK_CALL(CreateBuffer(renderer.get(), SizeInBytes(meshletBounds), DataPtr(meshletBounds), &meshletBoundsBuffer));
+        CHECK_CALL(CreateBuffer(renderer.get(), SizeInBytes(meshlets.meshlets), DataPtr(meshlets.meshlets), &meshletBuffer));
+        CHECK_CALL(CreateBuffer(renderer.get(), SizeInBytes(meshlets.vertices), DataPtr(meshlets.vertices), &meshletVerticesBuffer));
+        CHECK_CALL(CreateBuffer(renderer.get(), SizeInBytes(meshlets.triangles), DataPtr(meshlets.triangles), &meshletTrianglesBuffer));
+        CHECK_CALL(CreateBuffer(renderer.get(), SizeInBytes(meshlets.boundingSpheres), DataPtr(meshlets.boundingSpheres), &meshletBoundsBuffer));
     }
 
     // *************************************************************************
@@ -455,15 +310,15 @@ int main(int argc, char** argv)
         if (ImGui::Begin("Params"))
         {
             auto instanceCount              = instances.size();
-            auto totalMeshletCount          = meshlet_LOD_Counts[0] * instanceCount;
-            auto totalMeshletVertexCount    = LOD_0_vertexCount * instanceCount;
-            auto totalMeshletPrimitiveCount = LOD_0_triangleCount * instanceCount;
+            auto totalMeshletCount          = meshlets.lods[0].meshlets.meshletCount * instanceCount;
+            auto totalMeshletVertexCount    = meshlets.lods[0].meshlets.vertexCount * instanceCount;
+            auto totalMeshletPrimitiveCount = meshlets.lods[0].meshlets.triangleCount * instanceCount;
 
             ImGui::Columns(2);
             // clang-format off
-            ImGui::Text("LOD 0 Meshlet Count");               ImGui::NextColumn(); ImGui::Text("%d", meshlet_LOD_Counts[0]); ImGui::NextColumn();
-            ImGui::Text("LOD 0 Meshlet Vertex Count");        ImGui::NextColumn(); ImGui::Text("%d", LOD_0_vertexCount); ImGui::NextColumn();
-            ImGui::Text("LOD 0 Meshlet Primitive Count");     ImGui::NextColumn(); ImGui::Text("%d", LOD_0_triangleCount); ImGui::NextColumn();
+            ImGui::Text("LOD 0 Meshlet Count");               ImGui::NextColumn(); ImGui::Text("%d", meshlets.lods[0].meshlets.meshletCount); ImGui::NextColumn();
+            ImGui::Text("LOD 0 Meshlet Vertex Count");        ImGui::NextColumn(); ImGui::Text("%d", meshlets.lods[0].meshlets.vertexCount); ImGui::NextColumn();
+            ImGui::Text("LOD 0 Meshlet Primitive Count");     ImGui::NextColumn(); ImGui::Text("%d", meshlets.lods[0].meshlets.triangleCount); ImGui::NextColumn();
             ImGui::Text("Instance Count");                    ImGui::NextColumn(); ImGui::Text("%d", instanceCount); ImGui::NextColumn();                
             ImGui::Text("Instanced Meshlet Count");           ImGui::NextColumn(); ImGui::Text("%d", totalMeshletCount); ImGui::NextColumn();                
             ImGui::Text("Instanced Meshlet Vertex Count");    ImGui::NextColumn(); ImGui::Text("%d", totalMeshletVertexCount); ImGui::NextColumn();                
@@ -533,17 +388,17 @@ int main(int argc, char** argv)
 
             scene.CameraVP               = camera.GetViewProjectionMatrix();
             scene.InstanceCount          = static_cast<uint32_t>(instances.size());
-            scene.MeshletCount           = meshlet_LOD_Counts[0];
-            scene.Meshlet_LOD_Offsets[0] = meshlet_LOD_Offsets[0];
-            scene.Meshlet_LOD_Offsets[1] = meshlet_LOD_Offsets[1];
-            scene.Meshlet_LOD_Offsets[2] = meshlet_LOD_Offsets[2];
-            scene.Meshlet_LOD_Offsets[3] = meshlet_LOD_Offsets[3];
-            scene.Meshlet_LOD_Offsets[4] = meshlet_LOD_Offsets[4];
-            scene.Meshlet_LOD_Counts[0]  = meshlet_LOD_Counts[0];
-            scene.Meshlet_LOD_Counts[1]  = meshlet_LOD_Counts[1];
-            scene.Meshlet_LOD_Counts[2]  = meshlet_LOD_Counts[2];
-            scene.Meshlet_LOD_Counts[3]  = meshlet_LOD_Counts[3];
-            scene.Meshlet_LOD_Counts[4]  = meshlet_LOD_Counts[4];
+            scene.MeshletCount           = meshlets.lods[0].meshlets.meshletCount;
+            scene.Meshlet_LOD_Offsets[0] = meshlets.lods[0].meshlets.firstMeshlet;
+            scene.Meshlet_LOD_Offsets[1] = meshlets.lods[1].meshlets.firstMeshlet;
+            scene.Meshlet_LOD_Offsets[2] = meshlets.lods[2].meshlets.firstMeshlet;
+            scene.Meshlet_LOD_Offsets[3] = meshlets.lods[3].meshlets.firstMeshlet;
+            scene.Meshlet_LOD_Offsets[4] = meshlets.lods[4].meshlets.firstMeshlet;
+            scene.Meshlet_LOD_Counts[0]  = meshlets.lods[0].meshlets.meshletCount;
+            scene.Meshlet_LOD_Counts[1]  = meshlets.lods[1].meshlets.meshletCount;
+            scene.Meshlet_LOD_Counts[2]  = meshlets.lods[2].meshlets.meshletCount;
+            scene.Meshlet_LOD_Counts[3]  = meshlets.lods[3].meshlets.meshletCount;
+            scene.Meshlet_LOD_Counts[4]  = meshlets.lods[4].meshlets.meshletCount;
         }
 
         // ---------------------------------------------------------------------
@@ -595,7 +450,7 @@ int main(int argc, char** argv)
         pRenderEncoder->setMeshBuffer(instancesBuffer.Buffer.get(), 0, 5);
 
         // Object function uses 32 for thread group size
-        uint32_t meshletCount      = static_cast<uint32_t>(meshlet_LOD_Counts[0]);
+        uint32_t meshletCount      = static_cast<uint32_t>(meshlets.lods[0].meshlets.meshletCount);
         uint32_t instanceCount     = static_cast<uint32_t>(instances.size());
         uint32_t threadGroupCountX = ((meshletCount * instanceCount) / 32) + 1;
         pRenderEncoder->drawMeshThreadgroups(MTL::Size(threadGroupCountX, 1, 1), MTL::Size(32, 1, 1), MTL::Size(128, 1, 1));
@@ -2,7 +2,6 @@
 #include <filesystem>
 #include <iostream>
 #include <memory>
-#include <mutex>
 #include <thread>
 #include <vector>
 
@@ -14,6 +13,9 @@ using namespace glm;
 #define STB_IMAGE_WRITE_IMPLEMENTATION
 #include "stb_image_write.h"
 
+#include "ggx_simd.h"
+#include "tile_scheduler.h"
+
 #define PI 3.1415926535897932384626433832795f
 
 using float2 = glm::vec2;
@@ -24,39 +26,18 @@ float saturate(float x)
     return glm::clamp(x, 0.0f, 1.0f);
 }
 
-float3 ImportanceSampleGGX(float2 Xi, float Roughness, float3 N)
-{
-    float a        = Roughness * Roughness;
-    float Phi      = 2 * PI * Xi.x;
-    float CosTheta = sqrt((1 - Xi.y) / (1 + (a * a - 1) * Xi.y));
-    float SinTheta = sqrt(1 - CosTheta * CosTheta);
-
-    float3 H        = float3(0);
-    H.x             = SinTheta * cos(Phi);
-    H.y             = SinTheta * sin(Phi);
-    H.z             = CosTheta;
-    float3 UpVector = abs(N.y) < 0.999f ? float3(0, 1, 0) : float3(1, 0, 0);
-    float3 TangentX = normalize(cross(UpVector, N));
-    float3 TangentY = cross(N, TangentX);
-
-    // Tangent to world space
-    return TangentX * H.x + TangentY * H.y + N * H.z;
-}
-
 //
-// Taken from https://github.com/SaschaWillems/Vulkan-glTF-PBR/blob/master/data/shaders/genbrdflut.frag
-// Based on http://holger.dammertz.org/stuff/notes_HammersleyOnHemisphere.html
+// Hammersley points are the same for every texel, ProcessLUT generates
+// them once. The GGX samples are generated in batches, see ggx_simd.h.
 //
-float2 Hammersley(uint i, uint N)
+struct HammersleySet
 {
-    uint bits = (i << 16u) | (i >> 16u);
-    bits      = ((bits & 0x55555555u) << 1u) | ((bits & 0xAAAAAAAAu) >> 1u);
-    bits      = ((bits & 0x33333333u) << 2u) | ((bits & 0xCCCCCCCCu) >> 2u);
-    bits      = ((bits & 0x0F0F0F0Fu) << 4u) | ((bits & 0xF0F0F0F0u) >> 4u);
-    bits      = ((bits & 0x00FF00FFu) << 8u) | ((bits & 0xFF00FF00u) >> 8u);
-    float rdi = float(bits) * 2.3283064365386963e-10f;
-    return float2(float(i) / float(N), rdi);
-}
+    std::vector<float> xi0;
+    std::vector<float> xi1;
+};
+
+// Number of samples per texel
+const uint32_t kNumSamples = 1024;
 
 /*
 //
@@ -130,7 +111,7 @@ float Geometry_Smiths(float NoV, float NoL, float roughness)
     return G1 * G2;
 }
 
-float2 IntegrateBRDF(float Roughness, float NoV)
+float2 IntegrateBRDF(float Roughness, float NoV, const HammersleySet& hammersley, GGXSamples* pSamples)
 {
     /*
         float3 V = float3(0);
@@ -150,15 +131,13 @@ float2 IntegrateBRDF(float Roughness, float NoV)
 
     float3 N = float3(0, 1, 0);
 
-    const uint NumSamples = 1024;
+    const uint NumSamples = kNumSamples;
+    GGXSampleReflect(NumSamples, hammersley.xi0.data(), hammersley.xi1.data(), Roughness, GGXMakeFrame(&N.x, 0.999f), &V.x, pSamples);
     for (uint i = 0; i < NumSamples; i++)
     {
-        float2 Xi  = Hammersley(i, NumSamples);
-        float3 H   = ImportanceSampleGGX(Xi, Roughness, N);
-        float3 L   = 2 * dot(V, H) * H - V;
-        float  NoL = saturate(L.y);
-        float  NoH = saturate(H.y);
-        float  VoH = saturate(dot(V, H));
+        float NoL = pSamples->NoL[i];
+        float NoH = pSamples->NoH[i];
+        float VoH = pSamples->VoH[i];
         if (NoL > 0)
         {
             float G     = Geometry_Smiths(NoV, NoL, Roughness);
@@ -173,7 +152,7 @@ float2 IntegrateBRDF(float Roughness, float NoV)
     return res;
 }
 
-float2 IntegrateBRDF_Multiscatter(float Roughness, float NoV)
+float2 IntegrateBRDF_Multiscatter(float Roughness, float NoV, const HammersleySet& hammersley, GGXSamples* pSamples)
 {
     float3 V = float3(0);
     V.x      = sqrt(1.0f - NoV * NoV); // sin
@@ -184,15 +163,13 @@ float2 IntegrateBRDF_Multiscatter(float Roughness, float NoV)
 
     float3 N = float3(0, 0, 1);
 
-    const uint NumSamples = 1024;
+    const uint NumSamples = kNumSamples;
+    GGXSampleReflect(NumSamples, hammersley.xi0.data(), hammersley.xi1.data(), Roughness, GGXMakeFrame(&N.x, 0.999f), &V.x, pSamples);
     for (uint i = 0; i < NumSamples; i++)
     {
-        float2 Xi  = Hammersley(i, NumSamples);
-        float3 H   = ImportanceSampleGGX(Xi, Roughness, N);
-        float3 L   = 2 * dot(V, H) * H - V;
-        float  NoL = saturate(L.z);
-        float  NoH = saturate(H.z);
-        float  VoH = saturate(dot(V, H));
+        float NoL = pSamples->NoL[i];
+        float NoH = pSamples->NoH[i];
+        float VoH = pSamples->VoH[i];
         if (NoL > 0)
         {
             float G     = Geometry_Smiths(NoV, NoL, Roughness);
@@ -291,75 +268,50 @@ float2 IntegrateBRDF_Narkowicz(int x, float ndotv, int LUT_WIDTH)
 // Main
 // =============================================================================
 
-int                 gNumThreads = 16;
-int                 gResX       = 0;
-int                 gResY       = 0;
-std::vector<int>    gScanlines;
-std::mutex          gScanlineMutex;
-std::vector<float3> gPixels;
-bool                gMultiscatter = false;
-
-int GetNextScanline()
+void ProcessLUT(uint32_t resX, uint32_t resY, bool multiscatter, uint32_t numThreads, std::vector<float3>* pPixels)
 {
-    std::lock_guard<std::mutex> lock(gScanlineMutex);
+    HammersleySet hammersley = {std::vector<float>(kNumSamples), std::vector<float>(kNumSamples)};
+    GGXHammersley(0, kNumSamples, kNumSamples, hammersley.xi0.data(), hammersley.xi1.data());
 
-    int scanline = -1;
-    if (!gScanlines.empty())
-    {
-        scanline = gScanlines.back();
-        gScanlines.pop_back();
+    TileScheduler scheduler = TileScheduler(resX, resY);
+    scheduler.Run(numThreads, "Processing", [&](const TileScheduler::Tile& tile) {
+        GGXSamples samples;
 
-        // Print every 32 scanlines
-        size_t n = gResY - gScanlines.size();
-        if (((n % 32) == 0) || (n == 0) || (n == gResY))
+        for (uint32_t y = tile.y; y < (tile.y + tile.height); ++y)
         {
-            float percent = n / static_cast<float>(gResY) * 100.0f;
-            std::cout << "Procssing:  " << std::fixed << std::setw(4) << std::setprecision(2) << percent << "% complete" << std::endl;
-        }
-    }
-
-    return scanline;
-}
-
-void ProcessScaline()
-{
-    int y = GetNextScanline();
-    while (y != -1)
-    {
-        float3* pPixels = &gPixels[y * gResX];
+            float3* pPixel = &(*pPixels)[y * resX + tile.x];
 
-        for (int x = 0; x < gResX; ++x)
-        {
-            float  roughness = (static_cast<float>(x) + 0.5f) / static_cast<float>(gResX);
-            float  NoV       = (static_cast<float>(y) + 0.5f) / static_cast<float>(gResY);
-            float2 brdf      = float2(0, 0);
-            if (gMultiscatter)
-            {
-                brdf = IntegrateBRDF_Multiscatter(roughness, NoV);
-            }
-            else
+            for (uint32_t x = tile.x; x < (tile.x + tile.width); ++x)
             {
-                brdf = IntegrateBRDF(roughness, NoV);
+                float  roughness = (static_cast<float>(x) + 0.5f) / static_cast<float>(resX);
+                float  NoV       = (static_cast<float>(y) + 0.5f) / static_cast<float>(resY);
+                float2 brdf      = float2(0, 0);
+                if (multiscatter)
+                {
+                    brdf = IntegrateBRDF_Multiscatter(roughness, NoV, hammersley, &samples);
+                }
+                else
+                {
+                    brdf = IntegrateBRDF(roughness, NoV, hammersley, &samples);
+                }
+                *pPixel = float3(brdf, 0);
+                ++pPixel;
             }
-            *pPixels = float3(brdf, 0);
-            ++pPixels;
-        }
 
-        //
-        // Alternative version using Krzysztof Narkowicz's implementation
-        //
-        // int         LUT_WIDTH  = gResX;
-        // int         LUT_HEIGHT = gResY;
-        // const float ndotv      = (y + 0.5f) / static_cast<float>(LUT_HEIGHT);
-        // for (int x = 0; x < gResX; ++x) {
-        //    float2 brdf = IntegrateBRDF_Narkowicz(x, ndotv, LUT_WIDTH);
-        //    *pPixels    = float3(brdf, 0);
-        //    ++pPixels;
-        // }
-        //
-
-        y = GetNextScanline();
-    }
+            //
+            // Alternative version using Krzysztof Narkowicz's implementation
+            //
+            // int         LUT_WIDTH  = resX;
+            // int         LUT_HEIGHT = resY;
+            // const float ndotv      = (y + 0.5f) / static_cast<float>(LUT_HEIGHT);
+            // for (uint32_t x = tile.x; x < (tile.x + tile.width); ++x) {
+            //    float2 brdf = IntegrateBRDF_Narkowicz(x, ndotv, LUT_WIDTH);
+            //    *pPixel     = float3(brdf, 0);
+            //    ++pPixel;
+            // }
+            //
+        }
+    });
 }
 
 int main(int argc, char** argv)
@@ -384,9 +336,10 @@ int main(int argc, char** argv)
         return EXIT_FAILURE;
     }
 
-    std::filesystem::path outputFile = argv[1];
-    uint32_t              width      = 1024;
-    uint32_t              height     = 1024;
+    std::filesystem::path outputFile   = argv[1];
+    uint32_t              width        = 1024;
+    uint32_t              height       = 1024;
+    bool                  multiscatter = false;
 
     std::string badOption = "";
     for (int i = 2; i < argc; ++i)
@@ -414,7 +367,7 @@ int main(int argc, char** argv)
         }
         else if (arg == "-ms")
         {
-            gMultiscatter = true;
+            multiscatter = true;
         }
         else
         {
@@ -442,38 +395,21 @@ int main(int argc, char** argv)
         return EXIT_FAILURE;
     }
 
-    gResX = width;
-    gResY = height;
+    uint32_t numThreads = std::max(std::thread::hardware_concurrency(), 1u);
 
-    gPixels.resize(gResX * gResY);
-
-    for (int i = 0; i < gResY; ++i)
-    {
-        gScanlines.push_back(gResY - i - 1);
-    }
-
-    std::vector<std::unique_ptr<std::thread>> threads;
-    for (int i = 0; i < gNumThreads; ++i)
-    {
-        auto thread = std::make_unique<std::thread>(&ProcessScaline);
-        threads.push_back(std::move(thread));
-    }
-
-    for (auto& thread : threads)
-    {
-        thread->join();
-    }
+    std::vector<float3> pixels(width * height);
+    ProcessLUT(width, height, multiscatter, numThreads, &pixels);
 
-    if (!gPixels.empty())
+    if (!pixels.empty())
     {
-        int res = stbi_write_hdr(outputFile.string().c_str(), gResX, gResY, 3, reinterpret_cast<const float*>(gPixels.data()));
+        int res = stbi_write_hdr(outputFile.string().c_str(), width, height, 3, reinterpret_cast<const float*>(pixels.data()));
         if (res == 0)
         {
             std::cout << "ERROR: failed to write " << outputFile << std::endl;
             return EXIT_FAILURE;
         }
 
-        std::cout << "Successfully wrote " << gResX << "x" << gResY << (gMultiscatter ? " multiscatter" : "") << " BRDF LUT to " << outputFile << std::endl;
+        std::cout << "Successfully wrote " << width << "x" << height << (multiscatter ? " multiscatter" : "") << " BRDF LUT to " << outputFile << std::endl;
     }
 
     return EXIT_SUCCESS;
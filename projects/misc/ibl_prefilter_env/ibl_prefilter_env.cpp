@@ -1,10 +1,10 @@
 
+#include <chrono>
 #include <filesystem>
 #include <fstream>
 #include <iomanip>
 #include <iostream>
 #include <memory>
-#include <mutex>
 #include <thread>
 #include <vector>
 
@@ -15,7 +15,9 @@ using namespace glm;
 
 #include "bitmap.h"
 
+#include "ggx_simd.h"
 #include "pcg32.h"
+#include "tile_scheduler.h"
 
 #define PI 3.1415926535897932384626433832795f
 
@@ -23,10 +25,7 @@ using float2 = glm::vec2;
 using float3 = glm::vec3;
 using float4 = glm::vec4;
 
-BitmapRGBA32f               gEnvironmentMap;
-std::vector<float>          gGaussianKernel;
-std::vector<pcg32>          gRandoms;
-static std::atomic_uint32_t sThreadCounter;
+std::vector<float> gGaussianKernel;
 
 // circular atan2 - converts (x,y) on a unit circle to [0, 2pi]
 //
@@ -145,7 +144,8 @@ float2 Hammersley(uint i, uint N)
     return float2(float(i) / float(N), rdi);
 }
 
-float3 PrefilterEnvMap(float Roughness, float3 R, pcg32* pRandom)
+// Per sample version of PrefilterEnvMap, --simd-bench compares against it
+float3 PrefilterEnvMapScalar(const BitmapRGBA32f& envMap, float Roughness, float3 R, pcg32* pRandom)
 {
     float3 N                = R;
     float3 V                = R;
@@ -153,6 +153,11 @@ float3 PrefilterEnvMap(float Roughness, float3 R, pcg32* pRandom)
     float  TotalWeight      = 0;
 
     const uint NumSamples = 2048;
+
+    // Gather the UVs first and sample them in one batch
+    float2       uvs[NumSamples];
+    PixelRGBA32f pixels[NumSamples];
+    uint         numUVs = 0;
     for (uint i = 0; i < NumSamples; i++)
     {
         float  u  = pRandom->nextFloat();
@@ -175,14 +180,20 @@ float3 PrefilterEnvMap(float Roughness, float3 R, pcg32* pRandom)
             // Altenative Gaussian sampler:
             // auto pixel = gEnvMap.GetGaussianSampleUV(uv.x, uv.y, gGaussianKernel, BITMAP_SAMPLE_MODE_WRAP, BITMAP_SAMPLE_MODE_BORDER);
             //
-            auto pixel = gEnvironmentMap.GetBilinearSampleUV(uv.x, uv.y, BITMAP_SAMPLE_MODE_WRAP, BITMAP_SAMPLE_MODE_BORDER);
-            PrefilteredColor.r += pixel.r;
-            PrefilteredColor.g += pixel.g;
-            PrefilteredColor.b += pixel.b;
+            uvs[numUVs] = uv;
+            ++numUVs;
 
             TotalWeight += NoL;
         }
     }
+
+    envMap.GetBilinearSamplesUV(numUVs, &uvs[0].x, pixels, BITMAP_SAMPLE_MODE_WRAP, BITMAP_SAMPLE_MODE_BORDER);
+    for (uint i = 0; i < numUVs; i++)
+    {
+        PrefilteredColor.r += pixels[i].r;
+        PrefilteredColor.g += pixels[i].g;
+        PrefilteredColor.b += pixels[i].b;
+    }
     return PrefilteredColor / TotalWeight;
 
     /*
@@ -204,7 +215,7 @@ float3 PrefilterEnvMap(float Roughness, float3 R, pcg32* pRandom)
                 // Altenative Gaussian sampler:
                 // auto pixel = gEnvMap.GetGaussianSampleUV(uv.x, uv.y, gGaussianKernel, BITMAP_SAMPLE_MODE_WRAP, BITMAP_SAMPLE_MODE_BORDER);
                 //
-                auto pixel = gEnvironmentMap.GetBilinearSampleUV(uv.x, uv.y, BITMAP_SAMPLE_MODE_WRAP, BITMAP_SAMPLE_MODE_BORDER);
+                auto pixel = envMap.GetBilinearSampleUV(uv.x, uv.y, BITMAP_SAMPLE_MODE_WRAP, BITMAP_SAMPLE_MODE_BORDER);
                 PrefilteredColor.r += pixel.r;
                 PrefilteredColor.g += pixel.g;
                 PrefilteredColor.b += pixel.b;
@@ -216,139 +227,582 @@ float3 PrefilterEnvMap(float Roughness, float3 R, pcg32* pRandom)
     */
 }
 
+// Per thread buffers for the batched GGX kernels in ggx_simd.h
+struct SampleBuffers
+{
+    std::vector<float> xi0;
+    std::vector<float> xi1;
+    GGXSamples         samples;
+    std::vector<float> uvs;
+    std::vector<float> colors;
+};
+
+// Same as PrefilterEnvMapScalar with the samples generated, mapped and
+// gathered in batches. Consumes the same random numbers in the same order.
+float3 PrefilterEnvMap(
+    const BitmapRGBA32f& envMap,
+    float                Roughness,
+    float3               R,
+    pcg32*               pRandom,
+    SampleBuffers*       pBuffers,
+    GGXSimdISA           isa = GetGGXSimdISA())
+{
+    const uint NumSamples = 2048;
+
+    pBuffers->xi0.resize(NumSamples);
+    pBuffers->xi1.resize(NumSamples);
+    pBuffers->uvs.resize(2 * NumSamples);
+    pBuffers->colors.resize(4 * NumSamples);
+    for (uint i = 0; i < NumSamples; i++)
+    {
+        pBuffers->xi0[i] = pRandom->nextFloat();
+        pBuffers->xi1[i] = pRandom->nextFloat();
+    }
+
+    // N = V = R
+    GGXSamples& samples = pBuffers->samples;
+    GGXSampleReflect(NumSamples, pBuffers->xi0.data(), pBuffers->xi1.data(), Roughness, GGXMakeFrame(&R.x, 0.99999f), &R.x, &samples, isa);
+
+    // Only the samples above the horizon are gathered
+    float TotalWeight = 0;
+    uint  numUVs      = 0;
+    for (uint i = 0; i < NumSamples; i++)
+    {
+        if (samples.NoL[i] > 0)
+        {
+            samples.Lx[numUVs] = samples.Lx[i];
+            samples.Ly[numUVs] = samples.Ly[i];
+            samples.Lz[numUVs] = samples.Lz[i];
+            ++numUVs;
+
+            TotalWeight += samples.NoL[i];
+        }
+    }
+
+    const float* pPixels = reinterpret_cast<const float*>(envMap.GetPixels());
+    GGXDirectionsToEquirectUV(numUVs, samples.Lx.data(), samples.Ly.data(), samples.Lz.data(), pBuffers->uvs.data(), isa);
+    GGXGatherEquirectBilinear(numUVs, pBuffers->uvs.data(), pPixels, envMap.GetWidth(), envMap.GetHeight(), envMap.GetRowStride(), pBuffers->colors.data(), isa);
+
+    float3 PrefilteredColor = float3(0);
+    for (uint i = 0; i < numUVs; i++)
+    {
+        PrefilteredColor.r += pBuffers->colors[4 * i + 0];
+        PrefilteredColor.g += pBuffers->colors[4 * i + 1];
+        PrefilteredColor.b += pBuffers->colors[4 * i + 2];
+    }
+    return PrefilteredColor / TotalWeight;
+}
+
+// =============================================================================
+// Filtered importance sampling
+//
+// Based on "GPU-Based Importance Sampling" (Colbert and Krivanek, GPU Gems 3)
+// and "Real Shading in Unreal Engine 4" (Karis). With N = V = R the samples
+// only depend on the roughness, so they're computed once per level in
+// tangent space and shared by all pixels. Each sample reads the source mip
+// whose texels cover roughly the sample's solid angle, that's what lets a
+// few dozen samples match thousands of point samples.
+// =============================================================================
+
+struct FISSample
+{
+    float3 L;       // Tangent space, Z is N
+    float  NoL;     // Weight
+    float  lodBias; // 0.5 * log2(sample solid angle / mip0 texel solid angle at the equator) + 1
+};
+
+std::vector<FISSample> BuildFISTable(float Roughness, uint32_t NumSamples, uint32_t srcWidth, uint32_t srcHeight)
+{
+    // Avoid a singular D at roughness 0, everything lands on mip 0 anyway
+    float a  = std::max(Roughness * Roughness, 0.001f);
+    float a2 = a * a;
+
+    // Equirect texel solid angle at the equator, scaled by sin(phi) per sample
+    float texelSolidAngle = (2.0f * PI / srcWidth) * (PI / srcHeight);
+
+    std::vector<FISSample> table;
+    for (uint32_t i = 0; i < NumSamples; ++i)
+    {
+        float2 Xi = Hammersley(i, NumSamples);
+        float3 H  = ImportanceSampleGGX(Xi, Roughness, float3(0, 0, 1));
+        float3 L  = 2 * H.z * H - float3(0, 0, 1);
+        if (L.z <= 0)
+        {
+            continue;
+        }
+
+        // pdf(L) = D * NoH / (4 * VoH), NoH == VoH since N == V
+        float NoH        = saturate(H.z);
+        float d          = (NoH * NoH) * (a2 - 1) + 1;
+        float D          = a2 / (PI * d * d);
+        float pdf        = D / 4.0f;
+        float solidAngle = 1.0f / (NumSamples * pdf + 0.0001f);
+        float lodBias    = 0.5f * log2(solidAngle / texelSolidAngle) + 1.0f;
+
+        table.push_back({L, L.z, lodBias});
+    }
+    return table;
+}
+
+// Bilinear in the two nearest mips
+float3 SampleSourceMips(const MipmapT<BitmapRGBA32f>& mips, float u, float v, float lod)
+{
+    lod             = glm::clamp(lod, 0.0f, static_cast<float>(mips.GetNumLevels() - 1));
+    uint32_t level0 = static_cast<uint32_t>(lod);
+    uint32_t level1 = std::min(level0 + 1, mips.GetNumLevels() - 1);
+    float    t      = lod - level0;
+    auto     pixel0 = mips.GetMip(level0).GetBilinearSampleUV<BITMAP_SAMPLE_MODE_WRAP, BITMAP_SAMPLE_MODE_CLAMP>(u, v);
+    auto     pixel1 = mips.GetMip(level1).GetBilinearSampleUV<BITMAP_SAMPLE_MODE_WRAP, BITMAP_SAMPLE_MODE_CLAMP>(u, v);
+    return glm::mix(float3(pixel0.r, pixel0.g, pixel0.b), float3(pixel1.r, pixel1.g, pixel1.b), t);
+}
+
+float3 PrefilterEnvMapFIS(const std::vector<FISSample>& table, const MipmapT<BitmapRGBA32f>& mips, float3 R, SampleBuffers* pBuffers)
+{
+    float3 N        = R;
+    float3 UpVector = abs(N.y) < 0.99999f ? float3(0, 1, 0) : float3(1, 0, 0);
+    float3 TangentX = normalize(cross(UpVector, N));
+    float3 TangentY = cross(N, TangentX);
+
+    // Rotate the table into the frame of R and map it in one batch
+    const uint32_t numSamples = static_cast<uint32_t>(table.size());
+    GGXSamples&    samples    = pBuffers->samples;
+    samples.Resize(numSamples);
+    pBuffers->uvs.resize(2 * numSamples);
+    for (uint32_t i = 0; i < numSamples; ++i)
+    {
+        float3 L      = TangentX * table[i].L.x + TangentY * table[i].L.y + N * table[i].L.z;
+        samples.Lx[i] = L.x;
+        samples.Ly[i] = L.y;
+        samples.Lz[i] = L.z;
+    }
+    GGXDirectionsToEquirectUV(numSamples, samples.Lx.data(), samples.Ly.data(), samples.Lz.data(), pBuffers->uvs.data());
+
+    float3 PrefilteredColor = float3(0);
+    float  TotalWeight      = 0;
+    for (uint32_t i = 0; i < numSamples; ++i)
+    {
+        float2 uv = float2(pBuffers->uvs[2 * i + 0], pBuffers->uvs[2 * i + 1]);
+
+        // Texels shrink by sin(phi) towards the poles
+        float sinPhi = std::max(sin(uv.y * PI), 0.0001f);
+        float lod    = table[i].lodBias - 0.5f * log2(sinPhi);
+
+        PrefilteredColor += SampleSourceMips(mips, uv.x, uv.y, lod) * table[i].NoL;
+        TotalWeight += table[i].NoL;
+    }
+    return PrefilteredColor / TotalWeight;
+}
+
+// =============================================================================
+// Spherical harmonics irradiance
+//
+// Projects the source onto the first 9 real SH basis functions and
+// convolves them with the clamped cosine, see "An Efficient Representation
+// for Irradiance Environment Maps" (Ramamoorthi and Hanrahan). Y is up, same
+// as SphericalToCartesian. The coefficients are scaled by 1/pi so that they
+// evaluate to the same cosine weighted average radiance the Monte Carlo
+// irradiance map holds.
+// =============================================================================
+
+void EvaluateSH9Basis(float3 dir, float basis[9])
+{
+    basis[0] = 0.282095f;
+    basis[1] = 0.488603f * dir.y;
+    basis[2] = 0.488603f * dir.z;
+    basis[3] = 0.488603f * dir.x;
+    basis[4] = 1.092548f * dir.x * dir.y;
+    basis[5] = 1.092548f * dir.y * dir.z;
+    basis[6] = 0.315392f * (3.0f * dir.z * dir.z - 1.0f);
+    basis[7] = 1.092548f * dir.x * dir.z;
+    basis[8] = 0.546274f * (dir.x * dir.x - dir.y * dir.y);
+}
+
+// Each row is reduced on its own and the rows are summed in order, so the
+// result doesn't depend on the thread count.
+std::vector<float3> ProjectIrradianceSH9(const BitmapRGBA32f& source, uint32_t numThreads)
+{
+    const uint32_t width  = source.GetWidth();
+    const uint32_t height = source.GetHeight();
+    const float    dTheta = 2.0f * PI / width;
+    const float    dPhi   = PI / height;
+
+    std::vector<glm::dvec3> rowSums(height * 9, glm::dvec3(0));
+    std::atomic_uint32_t    nextRow = 0;
+
+    auto ProjectRows = [&]() {
+        for (uint32_t y = nextRow++; y < height; y = nextRow++)
+        {
+            float      phi        = (y + 0.5f) * dPhi;
+            float      solidAngle = dTheta * dPhi * sin(phi);
+            glm::dvec3 sums[9]    = {};
+
+            const PixelRGBA32f* pPixels = source.GetPixels(0, y);
+            for (uint32_t x = 0; x < width; ++x)
+            {
+                float3 dir = SphericalToCartesian((x + 0.5f) * dTheta, phi);
+                float  basis[9];
+                EvaluateSH9Basis(dir, basis);
+
+                float3 radiance = float3(pPixels[x].r, pPixels[x].g, pPixels[x].b) * solidAngle;
+                for (uint32_t i = 0; i < 9; ++i)
+                {
+                    sums[i] += glm::dvec3(radiance * basis[i]);
+                }
+            }
+
+            std::copy(sums, sums + 9, rowSums.begin() + (y * 9));
+        }
+    };
+
+    std::vector<std::unique_ptr<std::thread>> threads;
+    for (uint32_t i = 0; i < numThreads; ++i)
+    {
+        threads.push_back(std::make_unique<std::thread>(ProjectRows));
+    }
+    for (auto& thread : threads)
+    {
+        thread->join();
+    }
+
+    // Band l is scaled by A_l / pi: 1, 2/3 and 1/4
+    const double kBandScales[9] = {1.0, 2.0 / 3.0, 2.0 / 3.0, 2.0 / 3.0, 0.25, 0.25, 0.25, 0.25, 0.25};
+
+    std::vector<float3> coefficients(9);
+    for (uint32_t i = 0; i < 9; ++i)
+    {
+        glm::dvec3 sum = glm::dvec3(0);
+        for (uint32_t y = 0; y < height; ++y)
+        {
+            sum += rowSums[y * 9 + i];
+        }
+        coefficients[i] = float3(sum * kBandScales[i]);
+    }
+    return coefficients;
+}
+
+void EvaluateIrradianceSH9(const std::vector<float3>& coefficients, BitmapRGBA32f* pTarget)
+{
+    const uint32_t width  = pTarget->GetWidth();
+    const uint32_t height = pTarget->GetHeight();
+    for (uint32_t y = 0; y < height; ++y)
+    {
+        float4* pPixels = reinterpret_cast<float4*>(pTarget->GetPixels(0, y));
+        for (uint32_t x = 0; x < width; ++x)
+        {
+            float  theta = ((x + 0.5f) / static_cast<float>(width)) * 2 * PI;
+            float  phi   = ((y + 0.5f) / static_cast<float>(height)) * PI;
+            float3 N     = glm::normalize(SphericalToCartesian(theta, phi));
+            float  basis[9];
+            EvaluateSH9Basis(N, basis);
+
+            float3 irradiance = float3(0);
+            for (uint32_t i = 0; i < 9; ++i)
+            {
+                irradiance += coefficients[i] * basis[i];
+            }
+            // Ringing can go slightly negative on very bright sources
+            *pPixels = float4(glm::max(irradiance, float3(0)), 1);
+            ++pPixels;
+        }
+    }
+}
+
 // =============================================================================
 // Main
 // =============================================================================
 
-int              gNumThreads = 16;
-int              gResX       = 0;
-int              gResY       = 0;
-float            gDu         = 0;
-float            gDv         = 0;
-float            gRoughness  = 0;
-std::vector<int> gScanlines;
-std::mutex       gScanlineMutex;
-BitmapRGBA32f*   gIrradianceSource = nullptr;
-BitmapRGBA32f*   gTarget           = nullptr;
-uint32_t         gTargetYOffset    = 0;
-uint32_t         gNumLevels        = 0;
-uint32_t         gCurrentLevel     = 0;
-
-int GetNextScanline()
+// Direction of texel (x, y) in a level of resX x resY, for IBL_LAYOUT_CUBE
+// resY is 6 faces of resX x resX stacked +X, -X, +Y, -Y, +Z, -Z.
+float3 TexelDirection(IBLLayout layout, uint32_t x, uint32_t y, uint32_t resX, uint32_t resY)
 {
-    std::lock_guard<std::mutex> lock(gScanlineMutex);
+    if (layout == IBL_LAYOUT_CUBE)
+    {
+        uint32_t face = y / resX;
+        float    u    = 2.0f * ((x + 0.5f) / resX) - 1.0f;
+        float    v    = 2.0f * (((y % resX) + 0.5f) / resX) - 1.0f;
 
-    int scanline = -1;
-    if (!gScanlines.empty())
+        // Same orientation as D3D12 and Vulkan cube sampling, v points down
+        float3 dir = float3(0);
+        switch (face)
+        {
+            default: dir = float3(1, -v, -u); break;
+            case 1: dir = float3(-1, -v, u); break;
+            case 2: dir = float3(u, 1, v); break;
+            case 3: dir = float3(u, -1, -v); break;
+            case 4: dir = float3(u, -v, 1); break;
+            case 5: dir = float3(-u, -v, -1); break;
+        }
+        return glm::normalize(dir);
+    }
+    else if (layout == IBL_LAYOUT_OCTAHEDRAL)
     {
-        scanline = gScanlines.back();
-        gScanlines.pop_back();
+        float u = 2.0f * ((x + 0.5f) / resX) - 1.0f;
+        float v = 2.0f * ((y + 0.5f) / resY) - 1.0f;
+
+        // Upper hemisphere in the center diamond, lower one folded into the corners
+        float3 dir = float3(u, 1.0f - abs(u) - abs(v), v);
+        if (dir.y < 0)
+        {
+            dir.x = (1.0f - abs(v)) * ((u >= 0) ? 1.0f : -1.0f);
+            dir.z = (1.0f - abs(u)) * ((v >= 0) ? 1.0f : -1.0f);
+        }
+        return glm::normalize(dir);
+    }
+
+    float theta = (x / static_cast<float>(resX - 1)) * 2 * PI;
+    float phi   = (y / static_cast<float>(resY - 1)) * PI * 0.99999f;
+    return glm::normalize(SphericalToCartesian(theta, phi));
+}
+
+// Seed of the random streams, each tile uses the stream of its index so
+// the output doesn't depend on the thread count or timing.
+const uint64_t kRandomSeed = 0xDEADBEEF;
+
+// Writes a level of resX x resY to rows [yOffset, yOffset + resY) of
+// pTarget, see TexelDirection for the layouts.
+void ProcessEnvironmentMapLevel(
+    const BitmapRGBA32f& envMap,
+    float                roughness,
+    IBLLayout            layout,
+    uint32_t             resX,
+    uint32_t             resY,
+    uint32_t             yOffset,
+    const std::string&   label,
+    uint32_t             numThreads,
+    BitmapRGBA32f*       pTarget)
+{
+    TileScheduler scheduler = TileScheduler(resX, resY);
+    scheduler.Run(numThreads, label, [&](const TileScheduler::Tile& tile) {
+        pcg32 random;
+        random.seed(kRandomSeed, tile.index);
+
+        SampleBuffers buffers;
+
+        for (uint32_t y = tile.y; y < (tile.y + tile.height); ++y)
+        {
+            float4* pPixels = reinterpret_cast<float4*>(pTarget->GetPixels(tile.x, y + yOffset));
+
+            for (uint32_t x = tile.x; x < (tile.x + tile.width); ++x)
+            {
+                float3 R      = TexelDirection(layout, x, y, resX, resY);
+                float3 sample = PrefilterEnvMap(envMap, roughness, R, &random, &buffers);
+                *pPixels      = float4(sample, 1);
+                ++pPixels;
+            }
+        }
+    });
+}
+
+void ProcessEnvironmentMapLevelFIS(
+    const std::vector<FISSample>& table,
+    const MipmapT<BitmapRGBA32f>& mips,
+    IBLLayout                     layout,
+    uint32_t                      resX,
+    uint32_t                      resY,
+    uint32_t                      yOffset,
+    const std::string&            label,
+    uint32_t                      numThreads,
+    BitmapRGBA32f*                pTarget)
+{
+    TileScheduler scheduler = TileScheduler(resX, resY);
+    scheduler.Run(numThreads, label, [&](const TileScheduler::Tile& tile) {
+        SampleBuffers buffers;
+
+        for (uint32_t y = tile.y; y < (tile.y + tile.height); ++y)
+        {
+            float4* pPixels = reinterpret_cast<float4*>(pTarget->GetPixels(tile.x, y + yOffset));
 
-        // Print every 32 scanlines
-        size_t n = gResY - gScanlines.size();
-        if (((n % 32) == 0) || (n == 0) || (n == gResY))
+            for (uint32_t x = tile.x; x < (tile.x + tile.width); ++x)
+            {
+                float3 R      = TexelDirection(layout, x, y, resX, resY);
+                float3 sample = PrefilterEnvMapFIS(table, mips, R, &buffers);
+                *pPixels      = float4(sample, 1);
+                ++pPixels;
+            }
+        }
+    });
+}
+
+// Compares a level against PrefilterEnvMap on a grid of at most 64x32
+// pixels of the full resolution source.
+void ReportFISError(
+    const BitmapRGBA32f& source,
+    float                roughness,
+    IBLLayout            layout,
+    uint32_t             resX,
+    uint32_t             resY,
+    uint32_t             yOffset,
+    const BitmapRGBA32f& target)
+{
+    pcg32 random;
+    random.seed(kRandomSeed);
+
+    SampleBuffers buffers;
+
+    uint32_t strideX    = std::max(resX / 64, 1u);
+    uint32_t strideY    = std::max(resY / 32, 1u);
+    double   sumSqError = 0;
+    double   sumSqRef   = 0;
+    double   maxError   = 0;
+    int      count      = 0;
+    for (uint32_t y = 0; y < resY; y += strideY)
+    {
+        for (uint32_t x = 0; x < resX; x += strideX)
         {
-            float percent = n / static_cast<float>(gResY) * 100.0f;
-            std::cout << "Procssing level " << gCurrentLevel << "/" << (gNumLevels - 1) << ": " << std::fixed << std::setw(4) << std::setprecision(2) << percent << "% complete" << std::endl;
+            float3 R         = TexelDirection(layout, x, y, resX, resY);
+            float3 reference = PrefilterEnvMap(source, roughness, R, &random, &buffers);
+            auto   pixel     = target.GetPixels(x, y + yOffset);
+            float3 error     = float3(pixel->r, pixel->g, pixel->b) - reference;
+
+            sumSqError += glm::dot(error, error) / 3.0;
+            sumSqRef += glm::dot(reference, reference) / 3.0;
+            maxError = std::max(maxError, static_cast<double>(glm::length(error)));
+            ++count;
         }
     }
 
-    return scanline;
+    double rmse    = sqrt(sumSqError / count);
+    double relRmse = rmse / std::max(sqrt(sumSqRef / count), 1e-6);
+    std::cout << "  FIS vs reference (" << count << " pixels): RMSE=" << std::setprecision(6) << rmse << ", relative RMSE=" << relRmse << ", max error=" << maxError << std::endl;
 }
 
-void ProcessScanlineEnvironmentMap()
+// Times PrefilterEnvMap with every ISA the CPU supports against
+// PrefilterEnvMapScalar on one thread. All of them use the same random
+// numbers, the errors come from the approximations in ggx_simd.h.
+void RunSimdBenchmark(const BitmapRGBA32f& envMap)
 {
-    uint32_t threadIndex = sThreadCounter++;
-    pcg32*   pRandom     = &gRandoms[threadIndex];
+    const uint32_t kResX       = 64;
+    const uint32_t kResY       = 32;
+    const uint32_t kNumSamples = 2048; // Same as PrefilterEnvMap
+    const float    kRoughness  = 0.5f;
+
+    auto Run = [&](bool scalar, GGXSimdISA isa, std::vector<float3>* pResults) -> double {
+        pcg32 random;
+        random.seed(kRandomSeed);
+
+        SampleBuffers buffers;
+        pResults->resize(kResX * kResY);
+
+        auto start = std::chrono::high_resolution_clock::now();
+        for (uint32_t y = 0; y < kResY; ++y)
+        {
+            for (uint32_t x = 0; x < kResX; ++x)
+            {
+                float3 R                   = TexelDirection(IBL_LAYOUT_EQUIRECT, x, y, kResX, kResY);
+                (*pResults)[y * kResX + x] = scalar ? PrefilterEnvMapScalar(envMap, kRoughness, R, &random) : PrefilterEnvMap(envMap, kRoughness, R, &random, &buffers, isa);
+            }
+        }
+        auto end = std::chrono::high_resolution_clock::now();
+
+        double seconds = std::chrono::duration<double>(end - start).count();
+        return (kResX * kResY * kNumSamples) / seconds / 1000000.0;
+    };
 
-    int y = GetNextScanline();
-    while (y != -1)
+    std::cout << "SIMD benchmark: " << (kResX * kResY) << " pixels x " << kNumSamples << " samples, roughness " << kRoughness << ", 1 thread" << std::endl;
+
+    std::vector<float3> reference;
+    double              referenceRate = Run(true, GGX_SIMD_ISA_SCALAR, &reference);
+    std::cout << "  " << std::setw(8) << std::left << "glm" << std::right << std::fixed << std::setprecision(2) << referenceRate << " Msamples/s" << std::endl;
+
+    for (int isa = GGX_SIMD_ISA_SCALAR; isa <= GetGGXSimdISA(); ++isa)
     {
-        float4* pPixels = reinterpret_cast<float4*>(gTarget->GetPixels(0, y + gTargetYOffset));
+        std::vector<float3> results;
+        double              rate = Run(false, static_cast<GGXSimdISA>(isa), &results);
 
-        for (int x = 0; x < gResX; ++x)
+        double maxError = 0;
+        for (size_t i = 0; i < results.size(); ++i)
         {
-            float  theta  = (x * gDu) * 2 * PI;
-            float  phi    = (y * gDv) * PI * 0.99999f;
-            float3 R      = glm::normalize(SphericalToCartesian(theta, phi));
-            float3 sample = PrefilterEnvMap(gRoughness, R, pRandom);
-            *pPixels      = float4(sample, 1);
-            ++pPixels;
+            float3 error = results[i] - reference[i];
+            maxError     = std::max(maxError, static_cast<double>(glm::length(error) / std::max(glm::length(reference[i]), 1e-6f)));
         }
 
-        y = GetNextScanline();
+        std::cout << "  " << std::setw(8) << std::left << GetGGXSimdISAName(static_cast<GGXSimdISA>(isa)) << std::right << std::fixed << std::setprecision(2) << rate << " Msamples/s, "
+                  << (rate / referenceRate) << "x, max relative error " << std::scientific << maxError << std::endl;
     }
 }
 
-void ProcessScanlineIrradiance()
+void ProcessIrradiance(const BitmapRGBA32f& irradianceSource, uint32_t numThreads, BitmapRGBA32f* pTarget)
 {
     const uint32_t kNumSamples = 4069;
     const float    kRoughness  = 1.0f;
 
-    uint32_t threadIndex = sThreadCounter++;
-    pcg32*   pRandom     = &gRandoms[threadIndex];
+    const uint32_t resX = pTarget->GetWidth();
+    const uint32_t resY = pTarget->GetHeight();
 
-    int y = GetNextScanline();
-    while (y != -1)
-    {
-        float4* pPixels = reinterpret_cast<float4*>(gTarget->GetPixels(0, y + gTargetYOffset));
+    TileScheduler scheduler = TileScheduler(resX, resY);
+    scheduler.Run(numThreads, "Processing irradiance", [&](const TileScheduler::Tile& tile) {
+        pcg32 random;
+        random.seed(kRandomSeed, tile.index);
 
-        for (int x = 0; x < gResX; ++x)
+        SampleBuffers buffers;
+        buffers.xi0.resize(kNumSamples);
+        buffers.xi1.resize(kNumSamples);
+        buffers.uvs.resize(2 * kNumSamples);
+        buffers.colors.resize(4 * kNumSamples);
+
+        for (uint32_t y = tile.y; y < (tile.y + tile.height); ++y)
         {
-            // Get normal direction at (x, y)
-            float  u     = saturate((x + 0.5f) / static_cast<float>(gResX));
-            float  v     = saturate((y + 0.5f) / static_cast<float>(gResY));
-            float  theta = u * 2 * PI;
-            float  phi   = v * PI;
-            float3 N     = glm::normalize(SphericalToCartesian(theta, phi));
+            float4* pPixels = reinterpret_cast<float4*>(pTarget->GetPixels(tile.x, y));
 
-            float4 pixel        = float4(0);
-            float  totalSamples = 0;
-            for (uint32_t i = 0; i < kNumSamples; ++i)
+            for (uint32_t x = tile.x; x < (tile.x + tile.width); ++x)
             {
+                // Get normal direction at (x, y)
+                float  u     = saturate((x + 0.5f) / static_cast<float>(resX));
+                float  v     = saturate((y + 0.5f) / static_cast<float>(resY));
+                float  theta = u * 2 * PI;
+                float  phi   = v * PI;
+                float3 N     = glm::normalize(SphericalToCartesian(theta, phi));
+
                 // NOTE: Hammersley is not used here because it can causes artifacting
                 //       on the poles. The artifact looks like a pinch at the poles.
                 //
                 // Random point on sphere
-                float  u   = pRandom->nextFloat();
-                float  v   = pRandom->nextFloat();
-                float3 L   = ImportanceSampleGGX(float2(u, v), kRoughness, N);
-                float  NoL = saturate(dot(N, L));
-
-                // Get the spherical coordinate of of the sample vector
-                float2 uv = CartesianToSpherical(L);
-                u         = saturate(uv.x / (2.0f * PI));
-                v         = saturate(uv.y / PI);
-
-                // Use Gaussian sampling since bilinear produces too much noise
-                auto value = gIrradianceSource->GetGaussianSampleUV(u, v, gGaussianKernel, BITMAP_SAMPLE_MODE_WRAP, BITMAP_SAMPLE_MODE_CLAMP);
-                //
-                // This may be incorrect logic...but scale the contribution
-                // based on Lambert. This produces a much nicer result than
-                // without it.
-                //
-                // value *= NoL;
+                for (uint32_t i = 0; i < kNumSamples; ++i)
+                {
+                    buffers.xi0[i] = random.nextFloat();
+                    buffers.xi1[i] = random.nextFloat();
+                }
 
-                // Accumulate!
-                pixel.r += value.r;
-                pixel.g += value.g;
-                pixel.b += value.b;
-                pixel.a += value.a;
+                // The sample vectors are the half vectors, get their spherical coordinates
+                GGXSamples& samples = buffers.samples;
+                GGXImportanceSample(kNumSamples, buffers.xi0.data(), buffers.xi1.data(), kRoughness, GGXMakeFrame(&N.x, 0.99999f), &samples);
+                GGXDirectionsToEquirectUV(kNumSamples, samples.Hx.data(), samples.Hy.data(), samples.Hz.data(), buffers.uvs.data());
 
-                totalSamples += 1; // NoL;
-            }
-            // Compute average
-            pixel = pixel / static_cast<float>(totalSamples);
+                // The source is pre-blurred, bilinear on its own produces too much noise
+                const float* pSourcePixels = reinterpret_cast<const float*>(irradianceSource.GetPixels());
+                GGXGatherEquirectBilinear(kNumSamples, buffers.uvs.data(), pSourcePixels, irradianceSource.GetWidth(), irradianceSource.GetHeight(), irradianceSource.GetRowStride(), buffers.colors.data());
 
-            pPixels->r = pixel.r;
-            pPixels->g = pixel.g;
-            pPixels->b = pixel.b;
-            pPixels->a = pixel.a;
-            ++pPixels;
+                float4 pixel        = float4(0);
+                float  totalSamples = 0;
+                for (uint32_t i = 0; i < kNumSamples; ++i)
+                {
+                    const float* value = &buffers.colors[4 * i];
+                    //
+                    // This may be incorrect logic...but scale the contribution
+                    // based on Lambert. This produces a much nicer result than
+                    // without it.
+                    //
+                    // value *= NoL;
+
+                    // Accumulate!
+                    pixel.r += value[0];
+                    pixel.g += value[1];
+                    pixel.b += value[2];
+                    pixel.a += value[3];
+
+                    totalSamples += 1; // NoL;
+                }
+                // Compute average
+                pixel = pixel / static_cast<float>(totalSamples);
+
+                pPixels->r = pixel.r;
+                pPixels->g = pixel.g;
+                pPixels->b = pixel.b;
+                pPixels->a = pixel.a;
+                ++pPixels;
+            }
         }
-
-        y = GetNextScanline();
-    }
+    });
 }
 
 int main(int argc, char** argv)
@@ -356,11 +810,17 @@ int main(int argc, char** argv)
     if (argc < 3)
     {
         std::cout << "error: ibl_prefilter_env requires two arguments:" << std::endl;
-        std::cout << "   ibl_prefilter_env <input file> <output dir>" << std::endl;
+        std::cout << "   ibl_prefilter_env <input file> <output dir> [--irr-only] [--irr-sh] [--layout equirect|cube|octahedral] [--fis] [--fis-samples <count>] [--fis-report] [--simd-bench]" << std::endl;
         return EXIT_FAILURE;
     }
 
-    bool irrOnly = false;
+    bool     irrOnly       = false;
+    bool     irrSH         = false;
+    auto     layout        = IBL_LAYOUT_EQUIRECT;
+    bool     useFIS        = false;
+    uint32_t numFISSamples = 96;
+    bool     fisReport     = false;
+    bool     simdBench     = false;
     for (int i = 3; i < argc; ++i)
     {
         std::string arg = argv[i];
@@ -368,10 +828,49 @@ int main(int argc, char** argv)
         {
             irrOnly = true;
         }
+        else if (arg == "--irr-sh")
+        {
+            irrSH = true;
+        }
+        else if ((arg == "--layout") && ((i + 1) < argc))
+        {
+            std::string value = argv[++i];
+            if (value == "cube")
+            {
+                layout = IBL_LAYOUT_CUBE;
+            }
+            else if (value == "octahedral")
+            {
+                layout = IBL_LAYOUT_OCTAHEDRAL;
+            }
+            else if (value != "equirect")
+            {
+                std::cout << "error: unknown layout " << value << std::endl;
+                return EXIT_FAILURE;
+            }
+        }
+        else if (arg == "--fis")
+        {
+            useFIS = true;
+        }
+        else if ((arg == "--fis-samples") && ((i + 1) < argc))
+        {
+            useFIS        = true;
+            numFISSamples = static_cast<uint32_t>(std::max(std::atoi(argv[++i]), 1));
+        }
+        else if (arg == "--fis-report")
+        {
+            useFIS    = true;
+            fisReport = true;
+        }
+        else if (arg == "--simd-bench")
+        {
+            simdBench = true;
+        }
     }
 
-    gNumThreads = std::thread::hardware_concurrency();
-    std::cout << "Using " << gNumThreads << " threads" << std::endl;
+    uint32_t numThreads = std::max(std::thread::hardware_concurrency(), 1u);
+    std::cout << "Using " << numThreads << " threads" << std::endl;
 
     std::filesystem::path inputFilePath = std::filesystem::absolute(argv[1]);
     std::filesystem::path outputDir     = std::filesystem::absolute(argv[2]);
@@ -389,83 +888,60 @@ int main(int argc, char** argv)
         return EXIT_FAILURE;
     }
 
-    // Copy source image to start environment map
-    gEnvironmentMap = sourceImage;
+    if (simdBench)
+    {
+        RunSimdBenchmark(sourceImage);
+        return EXIT_SUCCESS;
+    }
+
+    // Only filled in by --irr-sh
+    std::vector<float3> irradianceSH;
 
     // =========================================================================
     // Irradiance map
     // =========================================================================
     {
-        // Kernel for irridiance map sampling
-        uint32_t radius     = 3; // 128;
-        uint32_t kernelSize = 2 * radius + 1;
-        gGaussianKernel     = GaussianKernel(kernelSize);
-
-        gRandoms.resize(gNumThreads);
-        for (int i = 0; i < gNumThreads; ++i)
-        {
-            gRandoms[i].seed(0xDEADBEEF + i);
-        }
-
         uint32_t      width  = 360;
         uint32_t      height = static_cast<uint32_t>(width / (sourceImage.GetWidth() / static_cast<float>(sourceImage.GetHeight())));
         BitmapRGBA32f target = BitmapRGBA32f(width, height);
 
-        float         scale  = width / static_cast<float>(sourceImage.GetWidth());
-        BitmapRGBA32f scaled = sourceImage.Scale(scale, scale, BITMAP_SAMPLE_MODE_WRAP, BITMAP_SAMPLE_MODE_CLAMP);
-
-        gResX             = width;
-        gResY             = height;
-        gIrradianceSource = &scaled;
-        gTarget           = &target;
-        gCurrentLevel     = 1;
-        gNumLevels        = 2; // Use 2 so that 1/1 gets printed
-
-        // Queue scanlines
-        for (int i = 0; i < gResY; ++i)
+        if (irrSH)
         {
-            gScanlines.push_back(gResY - i - 1);
-        }
+            irradianceSH = ProjectIrradianceSH9(sourceImage, numThreads);
+            EvaluateIrradianceSH9(irradianceSH, &target);
 
-        // Launch threads to process scanlines
-        std::vector<std::unique_ptr<std::thread>> threads;
-        for (int i = 0; i < gNumThreads; ++i)
-        {
-            auto thread = std::make_unique<std::thread>(&ProcessScanlineIrradiance);
-            threads.push_back(std::move(thread));
+            if (!BitmapRGBA32f::Save(irradianceMapFilePath, &target))
+            {
+                std::cout << "error: failed to write " << irradianceMapFilePath << std::endl;
+            }
+
+            std::cout << "Successfully wrote " << irradianceMapFilePath << std::endl;
         }
-        // Wait to threads complete
-        for (auto& thread : threads)
+        else
         {
-            thread->join();
-        }
+            float         scale  = width / static_cast<float>(sourceImage.GetWidth());
+            BitmapRGBA32f scaled = sourceImage.Scale(scale, scale, BITMAP_SAMPLE_MODE_WRAP, BITMAP_SAMPLE_MODE_CLAMP);
 
-        if (!target.Empty())
-        {
-            BitmapRGBA32f blurred = BitmapRGBA32f(target.GetWidth(), target.GetHeight());
+            // Blur the source once instead of Gaussian sampling it for every
+            // sample. Same sigma as the 7x7 GaussianKernel that was used per
+            // sample: 1.4 with taps 7/6 pixels apart.
+            scaled.BlurTo(1.2f, BITMAP_SAMPLE_MODE_WRAP, BITMAP_SAMPLE_MODE_CLAMP, scaled);
 
-            // Kernel for image convolution sampling to smooth out the noise
-            radius          = 7;
-            kernelSize      = 2 * radius + 1;
-            gGaussianKernel = GaussianKernel(kernelSize);
+            ProcessIrradiance(scaled, numThreads, &target);
 
-            for (uint32_t i = 0; i < blurred.GetHeight(); ++i)
+            if (!target.Empty())
             {
-                for (uint32_t j = 0; j < blurred.GetWidth(); ++j)
+                // Smooth out the noise, same sigma as the 15x15 GaussianKernel
+                // this used to be convolved with: 2.6 with taps 15/14 pixels apart.
+                BitmapRGBA32f blurred = target.Blur(2.43f, BITMAP_SAMPLE_MODE_WRAP, BITMAP_SAMPLE_MODE_CLAMP);
+
+                if (!BitmapRGBA32f::Save(irradianceMapFilePath, &blurred))
                 {
-                    float x     = (j + 0.5f);
-                    float y     = (i + 0.5f);
-                    auto  pixel = target.GetGaussianSample(x, y, gGaussianKernel, BITMAP_SAMPLE_MODE_WRAP, BITMAP_SAMPLE_MODE_CLAMP);
-                    blurred.SetPixel(j, i, pixel);
+                    std::cout << "error: failed to write " << irradianceMapFilePath << std::endl;
                 }
-            }
 
-            if (!BitmapRGBA32f::Save(irradianceMapFilePath, &blurred))
-            {
-                std::cout << "error: failed to write " << irradianceMapFilePath << std::endl;
+                std::cout << "Successfully wrote " << irradianceMapFilePath << std::endl;
             }
-
-            std::cout << "Successfully wrote " << irradianceMapFilePath << std::endl;
         }
 
         if (irrOnly)
@@ -483,14 +959,35 @@ int main(int argc, char** argv)
     uint32_t kernelSize = 2 * radius + 1;
     gGaussianKernel     = GaussianKernel(kernelSize);
 
-    gNumLevels = 0;
+    //
+    // Cube faces and octahedral maps are sized to roughly match the
+    // equirect texel density at the equator: a cube face is 1/4 of the
+    // source width and an octahedral map 1/2. That's 3/4 and 1/2 of the
+    // equirect texel count.
+    //
+    uint32_t baseWidth  = sourceImage.GetWidth();
+    uint32_t baseHeight = sourceImage.GetHeight();
+    uint32_t numFaces   = 1;
+    if (layout == IBL_LAYOUT_CUBE)
+    {
+        baseWidth  = std::max(sourceImage.GetWidth() / 4, 4u);
+        baseHeight = baseWidth;
+        numFaces   = 6;
+    }
+    else if (layout == IBL_LAYOUT_OCTAHEDRAL)
+    {
+        baseWidth  = std::max(sourceImage.GetWidth() / 2, 4u);
+        baseHeight = baseWidth;
+    }
+
+    uint32_t numLevels = 0;
     {
         // Calculate the number of mip levels and output height
-        gNumLevels       = 1;
-        int outputHeight = gEnvironmentMap.GetHeight();
+        numLevels        = 1;
+        int outputHeight = numFaces * baseHeight;
         {
-            int width  = gEnvironmentMap.GetWidth();
-            int height = gEnvironmentMap.GetHeight();
+            int width  = baseWidth;
+            int height = baseHeight;
             while (1)
             {
                 width >>= 1;
@@ -505,83 +1002,91 @@ int main(int argc, char** argv)
                 //
                 // We don't need more than 7 levels
                 //
-                if (gNumLevels >= 7)
+                if (numLevels >= 7)
                 {
                     break;
                 }
-                ++gNumLevels;
+                ++numLevels;
                 // Accumulate output height
-                outputHeight += height;
+                outputHeight += numFaces * height;
             }
         }
-        if (gNumLevels == 0)
+        if (numLevels == 0)
         {
             std::cout << "error: invalid number of mip levels" << std::endl;
             return EXIT_FAILURE;
         }
 
-        BitmapRGBA32f target = BitmapRGBA32f(gEnvironmentMap.GetWidth(), outputHeight);
-        gTarget              = &target;
+        BitmapRGBA32f target = BitmapRGBA32f(baseWidth, outputHeight);
 
-        gResX = static_cast<int>(gEnvironmentMap.GetWidth());
-        gResY = static_cast<int>(gEnvironmentMap.GetHeight());
+        // For cube maps resY covers all 6 faces of the level
+        uint32_t resX    = baseWidth;
+        uint32_t resY    = numFaces * baseHeight;
+        uint32_t yOffset = 0;
 
-        // float deltaRoughness = 1.0f / static_cast<float>(2.0f * gNumLevels);
-        float deltaRoughness = 1.0f / static_cast<float>(1.44f * gNumLevels);
+        // Each brute force equirect level samples the previous one, starting
+        // with the source. The other layouts always sample the source.
+        BitmapRGBA32f envMap = sourceImage;
 
-        for (uint32_t level = 0; level < gNumLevels; ++level)
+        // Filtered importance sampling reads a mip chain of the source
+        // instead of the previous level
+        MipmapT<BitmapRGBA32f> sourceMips;
+        if (useFIS)
         {
-            gCurrentLevel = level;
+            sourceMips.BuildMipmap(sourceImage, MipmapOptions().ModeU(BITMAP_SAMPLE_MODE_WRAP));
+            std::cout << "Using filtered importance sampling with " << numFISSamples << " samples, " << sourceMips.GetNumLevels() << " source mips" << std::endl;
+        }
 
-            gDu = 1.0f / static_cast<float>(gResX - 1);
-            gDv = 1.0f / static_cast<float>(gResY - 1);
+        // float deltaRoughness = 1.0f / static_cast<float>(2.0f * numLevels);
+        float deltaRoughness = 1.0f / static_cast<float>(1.44f * numLevels);
 
+        for (uint32_t level = 0; level < numLevels; ++level)
+        {
             // Calculate roughness
-            gRoughness = level * deltaRoughness;
-            std::cout << "level=" << level << ", roughness=" << std::setw(2) << std::setprecision(6) << std::fixed << gRoughness << std::endl;
+            float roughness = level * deltaRoughness;
+            std::cout << "level=" << level << ", roughness=" << std::setw(2) << std::setprecision(6) << std::fixed << roughness << std::endl;
 
-            // Queue scanlines
-            for (int i = 0; i < gResY; ++i)
-            {
-                gScanlines.push_back(i);
-            }
-
-            // Reset thread counter
-            sThreadCounter = 0;
+            std::stringstream label;
+            label << "Processing level " << level << "/" << (numLevels - 1);
 
-            // Launch threads to process scanlines
-            std::vector<std::unique_ptr<std::thread>> threads;
-            for (int i = 0; i < gNumThreads; ++i)
+            if (useFIS)
             {
-                auto thread = std::make_unique<std::thread>(&ProcessScanlineEnvironmentMap);
-                threads.push_back(std::move(thread));
+                std::vector<FISSample> fisTable = BuildFISTable(roughness, numFISSamples, sourceImage.GetWidth(), sourceImage.GetHeight());
+                ProcessEnvironmentMapLevelFIS(fisTable, sourceMips, layout, resX, resY, yOffset, label.str(), numThreads, &target);
+
+                if (fisReport)
+                {
+                    ReportFISError(sourceImage, roughness, layout, resX, resY, yOffset, target);
+                }
             }
-            // Wait to complete
-            for (auto& thread : threads)
+            else
             {
-                thread->join();
-            }
+                ProcessEnvironmentMapLevel(envMap, roughness, layout, resX, resY, yOffset, label.str(), numThreads, &target);
 
-            gEnvironmentMap = gTarget->CopyFrom(0, gTargetYOffset, gResX, gResY);
+                if (layout == IBL_LAYOUT_EQUIRECT)
+                {
+                    envMap = target.CopyFrom(0, yOffset, resX, resY);
+                }
+            }
 
             //// Kernel for image convolution sampling to smooth out the noise
             // radius          = 7;
             // kernelSize      = 2 * radius + 1;
             // gGaussianKernel = GaussianKernel(kernelSize);
             //
-            // for (int row = 0; row < gResY; ++row) {
-            //     for (int col = 0; col < gResX; ++col) {
+            // for (int row = 0; row < resY; ++row) {
+            //     for (int col = 0; col < resX; ++col) {
             //         float x     = (col + 0.5f);
             //         float y     = (row + 0.5f);
-            //         auto  pixel = gEnvironmentMap.GetGaussianSample(x, y, gGaussianKernel, BITMAP_SAMPLE_MODE_WRAP, BITMAP_SAMPLE_MODE_CLAMP);
-            //         gTarget->SetPixel(col, row + gTargetYOffset, pixel);
+            //         auto  pixel = envMap.GetGaussianSample(x, y, gGaussianKernel, BITMAP_SAMPLE_MODE_WRAP, BITMAP_SAMPLE_MODE_CLAMP);
+            //         target.SetPixel(col, row + yOffset, pixel);
             //     }
             // }
 
-            gTargetYOffset += gResY;
+            yOffset += resY;
 
-            gResX >>= 1;
-            gResY >>= 1;
+            resX >>= 1;
+            resY = numFaces * (baseHeight >> (level + 1));
         }
 
         if (!target.Empty())
@@ -600,7 +1105,24 @@ int main(int argc, char** argv)
     // =========================================================================
     {
         std::ofstream os = std::ofstream(iblFilePath.string().c_str());
-        os << irradianceMapFilePath.filename() << " " << environmentMapFilePath.filename() << " " << sourceImage.GetWidth() << " " << sourceImage.GetHeight() << " " << gNumLevels << std::endl;
+        os << irradianceMapFilePath.filename() << " " << environmentMapFilePath.filename() << " " << baseWidth << " " << baseHeight << " " << numLevels;
+        if (layout == IBL_LAYOUT_CUBE)
+        {
+            os << " layout cube";
+        }
+        else if (layout == IBL_LAYOUT_OCTAHEDRAL)
+        {
+            os << " layout octahedral";
+        }
+        if (!irradianceSH.empty())
+        {
+            os << " sh9" << std::setprecision(9);
+            for (auto& coefficient : irradianceSH)
+            {
+                os << " " << coefficient.r << " " << coefficient.g << " " << coefficient.b;
+            }
+        }
+        os << std::endl;
         std::cout << "Successfully wrote " << iblFilePath << std::endl;
     }
 
@@ -0,0 +1,313 @@
+#include <chrono>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <string>
+
+#include "tri_mesh.h"
+#include "tri_mesh_bvh.h"
+#include "config.h"
+
+#include "pcg32.h"
+
+// Runs fn iterations times and returns the fastest time in milliseconds
+static double TimeBest(uint32_t iterations, const std::function<void()>& fn)
+{
+    double best = 0;
+    for (uint32_t i = 0; i < iterations; ++i)
+    {
+        auto start = std::chrono::high_resolution_clock::now();
+        fn();
+        auto end = std::chrono::high_resolution_clock::now();
+
+        double elapsed = std::chrono::duration<double, std::milli>(end - start).count();
+        best           = (i == 0) ? elapsed : std::min(best, elapsed);
+    }
+    return best;
+}
+
+// -------------------------------------------------------------------------------------------------
+// Tangents
+// -------------------------------------------------------------------------------------------------
+static bool BenchTangents(const std::filesystem::path& inputPath, uint32_t iterations)
+{
+    TriMesh::Options options = TriMesh::Options().EnableTexCoords().EnableNormals().EnableTangents();
+
+    TriMesh mesh = {};
+    if (!TriMesh::LoadOBJParallel(inputPath.string(), "", options, &mesh))
+    {
+        std::cout << "error: failed to load input\n   input=" << inputPath << std::endl;
+        return false;
+    }
+
+    std::cout << "num vertices : " << mesh.GetNumVertices() << std::endl;
+    std::cout << "num triangles: " << mesh.GetNumTriangles() << std::endl;
+    std::cout << std::endl;
+
+    // Single threaded reference
+    TriMesh reference = mesh;
+    double  baseline  = TimeBest(iterations, [&reference]() { reference.GenerateTangents(UINT32_MAX); });
+    std::cout << std::left << std::setw(24) << "single threaded" << std::fixed << std::setprecision(2) << baseline << " ms" << std::endl;
+
+    const size_t numBytes = reference.GetTangents().size() * sizeof(glm::vec3);
+
+    bool allMatch = true;
+    for (uint32_t trianglesPerChunk : {262144u, 65536u, 16384u, 4096u})
+    {
+        TriMesh chunked = mesh;
+        double  time    = TimeBest(iterations, [&chunked, trianglesPerChunk]() { chunked.GenerateTangents(trianglesPerChunk); });
+
+        bool match = (std::memcmp(chunked.GetTangents().data(), reference.GetTangents().data(), numBytes) == 0) &&
+                     (std::memcmp(chunked.GetBitangents().data(), reference.GetBitangents().data(), numBytes) == 0);
+        allMatch   = allMatch && match;
+
+        std::cout << std::left << std::setw(24) << ("chunks of " + std::to_string(trianglesPerChunk))
+                  << std::fixed << std::setprecision(2) << time << " ms"
+                  << "  (" << std::setprecision(2) << (baseline / time) << "x)"
+                  << (match ? "" : "  MISMATCH") << std::endl;
+    }
+
+    return allMatch;
+}
+
+// -------------------------------------------------------------------------------------------------
+// BVH
+// -------------------------------------------------------------------------------------------------
+static bool BenchBVH(const std::filesystem::path& inputPath, uint32_t iterations)
+{
+    TriMesh mesh = {};
+    if (!TriMesh::LoadOBJParallel(inputPath.string(), "", TriMesh::Options(), &mesh))
+    {
+        std::cout << "error: failed to load input\n   input=" << inputPath << std::endl;
+        return false;
+    }
+
+    std::cout << "num vertices : " << mesh.GetNumVertices() << std::endl;
+    std::cout << "num triangles: " << mesh.GetNumTriangles() << std::endl;
+    std::cout << std::endl;
+
+    TriMeshBVH bvh       = {};
+    bool       buildOk   = true;
+    double     buildTime = TimeBest(iterations, [&]() { buildOk = TriMeshBVH::Build(mesh, TriMeshBVH::BuildOptions(), &bvh); });
+    if (!buildOk)
+    {
+        std::cout << "error: BVH build failed" << std::endl;
+        return false;
+    }
+
+    std::cout << std::left << std::setw(24) << "build" << std::fixed << std::setprecision(2) << buildTime << " ms" << std::endl;
+    std::cout << std::left << std::setw(24) << "nodes" << bvh.GetNumNodes() << std::endl;
+    std::cout << std::left << std::setw(24) << "max depth" << bvh.GetMaxDepth() << std::endl;
+
+    // Rays from a sphere around the mesh aimed at random points inside its bounds
+    const TriMesh::Aabb bounds = mesh.GetBounds();
+    const glm::vec3     center = bounds.Center();
+    const float         radius = glm::length(bounds.max - bounds.min);
+
+    const uint32_t               kNumRays = 1 << 20;
+    std::vector<TriMeshBVH::Ray> rays(kNumRays);
+    {
+        pcg32 rng(0xB5297A4D);
+        for (auto& ray : rays)
+        {
+            glm::vec3 dir    = glm::normalize(glm::vec3(rng.nextFloat(), rng.nextFloat(), rng.nextFloat()) - 0.5f + 1e-6f);
+            glm::vec3 target = bounds.min + (bounds.max - bounds.min) * glm::vec3(rng.nextFloat(), rng.nextFloat(), rng.nextFloat());
+            ray.origin       = center + dir * radius;
+            ray.direction    = target - ray.origin;
+        }
+    }
+
+    std::vector<TriMeshBVH::Hit> hits(kNumRays);
+    std::atomic_uint32_t         numHits = 0;
+    double                       closest = TimeBest(iterations, [&]() {
+        numHits = 0;
+        ParallelFor(kNumRays, 4096, [&](uint32_t begin, uint32_t end) {
+            uint32_t localHits = 0;
+            for (uint32_t i = begin; i < end; ++i)
+            {
+                localHits += bvh.Intersect(rays[i], &hits[i]) ? 1 : 0;
+            }
+            numHits += localHits;
+        });
+    });
+
+    std::atomic_uint32_t numAnyHits = 0;
+    double               any        = TimeBest(iterations, [&]() {
+        numAnyHits = 0;
+        ParallelFor(kNumRays, 4096, [&](uint32_t begin, uint32_t end) {
+            uint32_t localHits = 0;
+            for (uint32_t i = begin; i < end; ++i)
+            {
+                localHits += bvh.IntersectAny(rays[i]) ? 1 : 0;
+            }
+            numAnyHits += localHits;
+        });
+    });
+
+    std::cout << std::left << std::setw(24) << "closest hit" << std::fixed << std::setprecision(2) << closest << " ms"
+              << "  (" << (kNumRays / (closest * 1000.0)) << " Mrays/s, " << numHits << " hits)" << std::endl;
+    std::cout << std::left << std::setw(24) << "any hit" << std::fixed << std::setprecision(2) << any << " ms"
+              << "  (" << (kNumRays / (any * 1000.0)) << " Mrays/s, " << numAnyHits << " hits)" << std::endl;
+
+    // Check a subset of rays against brute force
+    const uint32_t kNumCheckRays = 256;
+    const auto&    positions     = mesh.GetPositions();
+    uint32_t       mismatches    = 0;
+    for (uint32_t i = 0; i < kNumCheckRays; ++i)
+    {
+        const TriMeshBVH::Ray& ray = rays[i * (kNumRays / kNumCheckRays)];
+
+        float bestT = FLT_MAX;
+        for (auto& tri : mesh.GetTriangles())
+        {
+            glm::vec3 v0 = positions[tri.vIdx0];
+            glm::vec3 e1 = positions[tri.vIdx1] - v0;
+            glm::vec3 e2 = positions[tri.vIdx2] - v0;
+
+            glm::vec3 p   = glm::cross(ray.direction, e2);
+            float     det = glm::dot(e1, p);
+            if (std::fabs(det) < 1e-20f)
+            {
+                continue;
+            }
+            glm::vec3 s = ray.origin - v0;
+            glm::vec3 q = glm::cross(s, e1);
+            float     u = glm::dot(s, p) / det;
+            float     v = glm::dot(ray.direction, q) / det;
+            float     t = glm::dot(e2, q) / det;
+            if ((u >= 0.0f) && (v >= 0.0f) && ((u + v) <= 1.0f) && (t >= ray.tMin) && (t < bestT))
+            {
+                bestT = t;
+            }
+        }
+
+        TriMeshBVH::Hit hit    = {};
+        bool            bvhHit = bvh.Intersect(ray, &hit);
+        if ((bvhHit != (bestT < FLT_MAX)) || (bvhHit && (std::fabs(hit.t - bestT) > 1e-4f * std::max(bestT, 1.0f))))
+        {
+            ++mismatches;
+        }
+    }
+    std::cout << std::left << std::setw(24) << "brute force check" << (kNumCheckRays - mismatches) << "/" << kNumCheckRays << " match" << std::endl;
+
+    return (mismatches == 0);
+}
+
+// -------------------------------------------------------------------------------------------------
+// Check
+// -------------------------------------------------------------------------------------------------
+static bool CheckIndexAlignedTangents()
+{
+    // Every face uses the same index for v/vt/vn, which takes the loader's
+    // direct copy path instead of the indexed one
+    const char* kOBJ =
+        "v -1 -1 0\n"
+        "v  1 -1 0\n"
+        "v  1  1 0\n"
+        "v -1  1 0\n"
+        "vt 0 0\n"
+        "vt 1 0\n"
+        "vt 1 1\n"
+        "vt 0 1\n"
+        "vn 0 0 1\n"
+        "vn 0 0 1\n"
+        "vn 0 0 1\n"
+        "vn 0 0 1\n"
+        "f 1/1/1 2/2/2 3/3/3\n"
+        "f 1/1/1 3/3/3 4/4/4\n";
+
+    auto objPath = std::filesystem::temp_directory_path() / "mesh_bench_check_aligned.obj";
+    {
+        std::ofstream os(objPath);
+        os << kOBJ;
+    }
+
+    TriMesh::Options options = TriMesh::Options().EnableTexCoords().EnableNormals().EnableTangents();
+
+    TriMesh mesh   = {};
+    bool    loaded = TriMesh::LoadOBJParallel(objPath.string(), "", options, &mesh);
+    std::filesystem::remove(objPath);
+    if (!loaded)
+    {
+        std::cout << "error: failed to load index aligned OBJ" << std::endl;
+        return false;
+    }
+
+    const size_t numVertices = mesh.GetNumVertices();
+    bool         sizesMatch  = (numVertices == 4) &&
+                               (mesh.GetTangents().size() == numVertices) &&
+                               (mesh.GetBitangents().size() == numVertices);
+
+    std::cout << std::left << std::setw(24) << "index aligned tangents"
+              << mesh.GetTangents().size() << "/" << mesh.GetBitangents().size() << " for " << numVertices << " vertices"
+              << (sizesMatch ? "" : "  MISMATCH") << std::endl;
+    if (!sizesMatch)
+    {
+        return false;
+    }
+
+    // Regenerating writes through SetTangents, which asserts on short streams
+    mesh.GenerateTangents(UINT32_MAX);
+
+    bool nonZero = true;
+    for (uint32_t i = 0; i < numVertices; ++i)
+    {
+        nonZero = nonZero && (glm::length(mesh.GetTangents()[i]) > 0.0f) && (glm::length(mesh.GetBitangents()[i]) > 0.0f);
+    }
+    std::cout << std::left << std::setw(24) << "generated tangents" << (nonZero ? "ok" : "ZERO") << std::endl;
+
+    return nonZero;
+}
+
+int main(int argc, char** argv)
+{
+    if ((argc == 2) && (std::string(argv[1]) == "check"))
+    {
+        return CheckIndexAlignedTangents() ? EXIT_SUCCESS : EXIT_FAILURE;
+    }
+
+    if (argc < 3)
+    {
+        std::cout << "error: missing params\n"
+                  << std::endl;
+        std::cout << "usage:\n  mesh_bench tangents|bvh input.obj [--iterations N]\n  mesh_bench check" << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    const std::string mode      = argv[1];
+    auto              inputPath = std::filesystem::path(argv[2]);
+    if (!std::filesystem::exists(inputPath))
+    {
+        std::cout << "error: input path does not exist\n   input=" << inputPath << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    uint32_t iterations = 5;
+    for (int i = 3; i < argc; ++i)
+    {
+        if ((std::string(argv[i]) == "--iterations") && ((i + 1) < argc))
+        {
+            iterations = std::max(std::stoi(argv[++i]), 1);
+        }
+    }
+
+    bool res = false;
+    if (mode == "tangents")
+    {
+        res = BenchTangents(inputPath, iterations);
+    }
+    else if (mode == "bvh")
+    {
+        res = BenchBVH(inputPath, iterations);
+    }
+    else
+    {
+        std::cout << "error: unknown mode: " << mode << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    return res ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -14,7 +14,7 @@ int main(int argc, char** argv)
     {
         std::cout << "error: missing params\n"
                   << std::endl;
-        std::cout << "usage:\n  mesh_clean input.obj output.obj" << std::endl;
+        std::cout << "usage:\n  mesh_clean input.obj output.obj [--parallel] [--optimize]" << std::endl;
         return EXIT_FAILURE;
     }
 
@@ -32,12 +32,23 @@ int main(int argc, char** argv)
         return EXIT_FAILURE;
     }
 
+    // --parallel: use the multithreaded OBJ parser
+    // --optimize: run TriMesh::Optimize after spatial sorting
+    bool parallelLoad = false;
+    bool optimize     = false;
+    for (int i = 3; i < argc; ++i)
+    {
+        parallelLoad = parallelLoad || (std::string(argv[i]) == "--parallel");
+        optimize     = optimize || (std::string(argv[i]) == "--optimize");
+    }
+
     TriMesh::Options options = {};
     options.enableTexCoords  = true;
     options.enableNormals    = true;
 
     TriMesh inputMesh = {};
-    bool    res       = TriMesh::LoadOBJ(inputPath.string(), "", options, &inputMesh);
+    bool    res       = parallelLoad ? TriMesh::LoadOBJParallel(inputPath.string(), "", options, &inputMesh)
+                                     : TriMesh::LoadOBJIndexed(inputPath.string(), "", options, &inputMesh);
     if (!res)
     {
         std::cout << "error: failed to load input\n   input=" << inputPath << std::endl;
@@ -62,19 +73,43 @@ int main(int argc, char** argv)
     {
         const auto indices = inputMesh.GetIndices();
 
+        // Sort within each group's material ranges and the ungrouped
+        // triangles so the ranges stay valid.
+        std::vector<std::pair<uint32_t, uint32_t>> ranges;
+        for (auto& group : inputMesh.GetGroups())
+        {
+            for (auto& range : group.GetMaterialRanges())
+            {
+                ranges.push_back(std::make_pair(range.firstTriangle, range.numTriangles));
+            }
+        }
+        ranges.push_back(std::make_pair(inputMesh.GetNumGroupedTriangles(), inputMesh.GetNumTriangles() - inputMesh.GetNumGroupedTriangles()));
+
         std::vector<uint32_t> sortedIndices(inputMesh.GetNumIndices());
-        meshopt_spatialSortTriangles(
-            sortedIndices.data(),
-            indices.data(),
-            static_cast<uint32_t>(indices.size()),
-            reinterpret_cast<const float*>(inputMesh.GetPositions().data()),
-            inputMesh.GetNumVertices(),
-            sizeof(glm::vec3));
+        for (auto& range : ranges)
+        {
+            meshopt_spatialSortTriangles(
+                sortedIndices.data() + 3 * range.first,
+                indices.data() + 3 * range.first,
+                3 * range.second,
+                reinterpret_cast<const float*>(inputMesh.GetPositions().data()),
+                inputMesh.GetNumVertices(),
+                sizeof(glm::vec3));
+        }
 
         inputMesh.SetTriangles(sortedIndices);
     }
     std::cout << "spatial sorting complete" << std::endl;
 
+    if (optimize)
+    {
+        std::cout << std::endl;
+        std::cout << "optimizing..." << std::endl;
+        inputMesh.Optimize();
+        std::cout << "num vertices: " << inputMesh.GetNumVertices() << std::endl;
+        std::cout << "num indices : " << inputMesh.GetNumIndices() << std::endl;
+    }
+
     TriMesh::WriteOBJ(outputPath.string(), inputMesh);
     std::cout << std::endl;
     std::cout << "wrote " << outputPath << std::endl;
@@ -0,0 +1,236 @@
+//
+// texture_convert
+// - Bakes an image into a texture file (see texture_file.h) with all of its mips,
+//   either uncompressed or BC compressed, so samples can map it instead of decoding
+//
+
+#include <filesystem>
+#include <iostream>
+#include <map>
+#include <string>
+
+#include "bitmap.h"
+#include "bc_encoder.h"
+#include "texture_file.h"
+
+int main(int argc, char** argv)
+{
+    const std::map<std::string, GREXFormat> kFormats = {
+        {"rgba8",   GREX_FORMAT_R8G8B8A8_UNORM    },
+        {"rgba16f", GREX_FORMAT_R16G16B16A16_FLOAT},
+        {"rgba32f", GREX_FORMAT_R32G32B32A32_FLOAT},
+        {"rgb9e5",  GREX_FORMAT_R9G9B9E5_UFLOAT   },
+        {"bc1",     GREX_FORMAT_BC1_RGB           },
+        {"bc3",     GREX_FORMAT_BC3_RGBA          },
+        {"bc4",     GREX_FORMAT_BC4_R             },
+        {"bc5",     GREX_FORMAT_BC5_RG            },
+        {"bc6h",    GREX_FORMAT_BC6H_UFLOAT       },
+        {"bc7",     GREX_FORMAT_BC7_RGBA          },
+    };
+
+    const std::map<std::string, BCQuality> kQualities = {
+        {"fast",   BC_QUALITY_FAST  },
+        {"normal", BC_QUALITY_NORMAL},
+        {"high",   BC_QUALITY_HIGH  },
+    };
+
+    const std::map<std::string, MipmapContent> kContents = {
+        {"data",      MIPMAP_CONTENT_DATA      },
+        {"srgb",      MIPMAP_CONTENT_COLOR_SRGB},
+        {"normal",    MIPMAP_CONTENT_NORMAL    },
+        {"roughness", MIPMAP_CONTENT_ROUGHNESS },
+    };
+
+    const std::map<std::string, MipmapFilter> kFilters = {
+        {"box",    MIPMAP_FILTER_BOX   },
+        {"kaiser", MIPMAP_FILTER_KAISER},
+    };
+
+    if (argc < 3)
+    {
+        std::cout << "error: missing arguments" << std::endl;
+        std::cout << "   "
+                  << "texture_convert <input file> <output file> [optional:flags/options]" << std::endl;
+        std::cout << "\nEx:\n";
+        std::cout << "   "
+                  << "texture_convert basecolor.png basecolor.gxt -f bc7 -c srgb --wrap" << std::endl;
+        std::cout << "\n\n";
+        std::cout << "Flags and options:\n";
+        std::cout << "   -f <format>    rgba8, rgba16f, rgba32f, rgb9e5, bc1, bc3, bc4, bc5, bc6h or bc7 (default: bc7)\n";
+        std::cout << "   -q <quality>   BC quality: fast, normal or high (default: normal)\n";
+        std::cout << "   -c <content>   Mip content: data, srgb, normal or roughness (default: data)\n";
+        std::cout << "   -m <filter>    Mip filter: box or kaiser (default: box)\n";
+        std::cout << "   --wrap         Wrap instead of clamp at the edges when building mips\n";
+        std::cout << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    std::filesystem::path inputFile  = argv[1];
+    std::filesystem::path outputFile = argv[2];
+
+    GREXFormat    format     = GREX_FORMAT_BC7_RGBA;
+    BCQuality     quality    = BC_QUALITY_NORMAL;
+    MipmapOptions mipOptions = {};
+    std::string   badOption  = "";
+    for (int i = 3; i < argc; ++i)
+    {
+        std::string arg = argv[i];
+        if (arg == "--wrap")
+        {
+            mipOptions.ModeU(BITMAP_SAMPLE_MODE_WRAP).ModeV(BITMAP_SAMPLE_MODE_WRAP);
+            continue;
+        }
+        if ((arg != "-f") && (arg != "-q") && (arg != "-c") && (arg != "-m"))
+        {
+            std::cout << "error: unrecognized arg " << arg << std::endl;
+            return EXIT_FAILURE;
+        }
+
+        ++i;
+        if (i >= argc)
+        {
+            badOption = arg;
+            break;
+        }
+
+        std::string value = argv[i];
+        bool        found = false;
+        if (arg == "-f")
+        {
+            auto it = kFormats.find(value);
+            found   = (it != kFormats.end());
+            format  = found ? it->second : format;
+        }
+        else if (arg == "-q")
+        {
+            auto it = kQualities.find(value);
+            found   = (it != kQualities.end());
+            quality = found ? it->second : quality;
+        }
+        else if (arg == "-c")
+        {
+            auto it = kContents.find(value);
+            found   = (it != kContents.end());
+            if (found)
+            {
+                mipOptions.Content(it->second);
+            }
+        }
+        else if (arg == "-m")
+        {
+            auto it = kFilters.find(value);
+            found   = (it != kFilters.end());
+            if (found)
+            {
+                mipOptions.Filter(it->second);
+            }
+        }
+
+        if (!found)
+        {
+            std::cout << "error: unrecognized value " << value << " for option " << arg << std::endl;
+            return EXIT_FAILURE;
+        }
+    }
+    if (!badOption.empty())
+    {
+        std::cout << "error: missing arg for option " << badOption << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    if (!std::filesystem::exists(inputFile))
+    {
+        std::cout << "error: input file does not exist " << inputFile << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    auto absInputFile  = std::filesystem::absolute(inputFile);
+    auto absOutputFile = std::filesystem::absolute(outputFile);
+    if (absInputFile == absOutputFile)
+    {
+        std::cout << "error: input file and output file must be different " << inputFile << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    // Texture files are laid out for direct copies on every API
+    BCEncodeOptions encodeOptions = BCEncodeOptions()
+                                        .Format(format)
+                                        .Quality(quality)
+                                        .RowStrideAlignment(TEXTURE_FILE_ROW_ALIGNMENT)
+                                        .OffsetAlignment(TEXTURE_FILE_LEVEL_ALIGNMENT);
+
+    // BC6H and the float formats keep the full range of HDR and EXR files
+    const bool isFloat = (format == GREX_FORMAT_BC6H_UFLOAT) ||
+                         (format == GREX_FORMAT_R16G16B16A16_FLOAT) ||
+                         (format == GREX_FORMAT_R32G32B32A32_FLOAT) ||
+                         (format == GREX_FORMAT_R9G9B9E5_UFLOAT);
+
+    bool     res    = false;
+    uint32_t width  = 0;
+    uint32_t height = 0;
+    if (isFloat)
+    {
+        BitmapRGBA32f inputBitmap;
+        if (!BitmapRGBA32f::Load(inputFile, &inputBitmap))
+        {
+            std::cout << "error: failed to load input file " << inputFile << std::endl;
+            return EXIT_FAILURE;
+        }
+        std::cout << "Successfully loaded " << inputBitmap.GetWidth() << "x" << inputBitmap.GetHeight() << " " << inputFile << std::endl;
+
+        width  = inputBitmap.GetWidth();
+        height = inputBitmap.GetHeight();
+
+        if (format == GREX_FORMAT_R16G16B16A16_FLOAT)
+        {
+            res = SaveTexture(outputFile, MipmapRGBA16f(ConvertToRGBA16f(inputBitmap), mipOptions));
+        }
+        else if (format == GREX_FORMAT_R9G9B9E5_UFLOAT)
+        {
+            res = SaveTexture(outputFile, MipmapRGB9E5(ConvertToRGB9E5(inputBitmap), mipOptions));
+        }
+        else if (format == GREX_FORMAT_R32G32B32A32_FLOAT)
+        {
+            res = SaveTexture(outputFile, MipmapRGBA32f(inputBitmap, mipOptions));
+        }
+        else
+        {
+            BCTexture texture = {};
+            res               = BCEncode(MipmapRGBA32f(inputBitmap, mipOptions), encodeOptions, &texture) && SaveTexture(outputFile, texture);
+        }
+    }
+    else
+    {
+        BitmapRGBA8u inputBitmap;
+        if (!BitmapRGBA8u::Load(inputFile, &inputBitmap))
+        {
+            std::cout << "error: failed to load input file " << inputFile << std::endl;
+            return EXIT_FAILURE;
+        }
+        std::cout << "Successfully loaded " << inputBitmap.GetWidth() << "x" << inputBitmap.GetHeight() << " " << inputFile << std::endl;
+
+        width  = inputBitmap.GetWidth();
+        height = inputBitmap.GetHeight();
+
+        MipmapRGBA8u mipmap = MipmapRGBA8u(inputBitmap, mipOptions);
+        if (format == GREX_FORMAT_R8G8B8A8_UNORM)
+        {
+            res = SaveTexture(outputFile, mipmap);
+        }
+        else
+        {
+            BCTexture texture = {};
+            res               = BCEncode(mipmap, encodeOptions, &texture) && SaveTexture(outputFile, texture);
+        }
+    }
+
+    if (!res)
+    {
+        std::cout << "error: failed to write output file " << outputFile << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    std::cout << "Successfully wrote output file " << width << "x" << height << " " << outputFile << std::endl;
+
+    return EXIT_SUCCESS;
+}
@@ -47,8 +47,9 @@ struct DrawParameters
     mat4     modelMatrix;
     uint32_t materialIndex = 0;
 
+    uint32_t               firstIndex  = 0;
     uint32_t               numIndices  = 0;
-    ComPtr<ID3D12Resource> indexBuffer = nullptr;
+    ComPtr<ID3D12Resource> indexBuffer = nullptr; // Shared by all draws
 };
 
 struct MaterialParameters
@@ -614,7 +615,7 @@ int main(int argc, char** argv)
                     commandList->SetGraphicsRoot32BitConstants(1, 16, &modelMat, 0);
                     commandList->SetGraphicsRoot32BitConstants(1, 1, &draw.materialIndex, 16);
 
-                    commandList->DrawIndexedInstanced(draw.numIndices, 1, 0, 0, 0);
+                    commandList->DrawIndexedInstanced(draw.numIndices, 1, draw.firstIndex, 0, 0);
                 }
             }
 
@@ -1038,22 +1039,27 @@ void CreateCameraVertexBuffers(
     std::vector<DrawParameters>& outDrawParams,
     VertexBuffers&               outVertexBuffers)
 {
+    // One index buffer for the whole mesh, each draw is a material range in it
+    ComPtr<ID3D12Resource> indexBuffer;
+    CHECK_CALL(CreateBuffer(
+        pRenderer,
+        SizeInBytes(pMesh->GetTriangles()),
+        DataPtr(pMesh->GetTriangles()),
+        &indexBuffer));
+
     // Group draws based on material indices
     for (uint32_t materialIndex = 0; materialIndex < pMesh->GetNumMaterials(); ++materialIndex)
     {
-        auto triangles = pMesh->GetTrianglesForMaterial(materialIndex);
-
-        DrawParameters params = {};
-        params.numIndices     = static_cast<uint32_t>(3 * triangles.size());
-        params.materialIndex  = materialIndex;
-
-        CHECK_CALL(CreateBuffer(
-            pRenderer,
-            SizeInBytes(triangles),
-            DataPtr(triangles),
-            &params.indexBuffer));
+        for (auto& range : pMesh->GetMaterialRanges(materialIndex))
+        {
+            DrawParameters params = {};
+            params.materialIndex  = materialIndex;
+            params.firstIndex     = 3 * range.firstTriangle;
+            params.numIndices     = 3 * range.numTriangles;
+            params.indexBuffer    = indexBuffer;
 
-        outDrawParams.push_back(params);
+            outDrawParams.push_back(params);
+        }
     }
 
     CHECK_CALL(CreateBuffer(
@@ -53,8 +53,9 @@ struct DrawInfo
     mat4     modelMatrix;
     uint32_t materialIndex = 0;
 
+    uint32_t    firstIndex = 0;
     uint32_t    numIndices = 0;
-    MetalBuffer indexBuffer;
+    MetalBuffer indexBuffer; // Shared by all draws
 };
 
 struct DrawParameters
@@ -586,7 +587,7 @@ int main(int argc, char** argv)
                     draw.numIndices,
                     MTL::IndexTypeUInt32,
                     draw.indexBuffer.Buffer.get(),
-                    0);
+                    draw.firstIndex * sizeof(uint32_t));
             }
         }
 
@@ -822,22 +823,27 @@ void CreateCameraVertexBuffers(
     std::vector<DrawInfo>& outDrawParams,
     VertexBuffers&         outVertexBuffers)
 {
+    // One index buffer for the whole mesh, each draw is a material range in it
+    MetalBuffer indexBuffer;
+    CHECK_CALL(CreateBuffer(
+        pRenderer,
+        SizeInBytes(pMesh->GetTriangles()),
+        DataPtr(pMesh->GetTriangles()),
+        &indexBuffer));
+
     // Group draws based on material indices
     for (uint32_t materialIndex = 0; materialIndex < pMesh->GetNumMaterials(); ++materialIndex)
     {
-        auto triangles = pMesh->GetTrianglesForMaterial(materialIndex);
-
-        DrawInfo params      = {};
-        params.numIndices    = static_cast<uint32_t>(3 * triangles.size());
-        params.materialIndex = materialIndex;
-
-        CHECK_CALL(CreateBuffer(
-            pRenderer,
-            SizeInBytes(triangles),
-            DataPtr(triangles),
-            &params.indexBuffer));
+        for (auto& range : pMesh->GetMaterialRanges(materialIndex))
+        {
+            DrawInfo params      = {};
+            params.materialIndex = materialIndex;
+            params.firstIndex    = 3 * range.firstTriangle;
+            params.numIndices    = 3 * range.numTriangles;
+            params.indexBuffer   = indexBuffer;
 
-        outDrawParams.push_back(params);
+            outDrawParams.push_back(params);
+        }
     }
 
     CHECK_CALL(CreateBuffer(
@@ -53,8 +53,9 @@ struct DrawInfo
     mat4     modelMatrix;
     uint32_t materialIndex = 0;
 
+    uint32_t     firstIndex  = 0;
     uint32_t     numIndices  = 0;
-    VulkanBuffer indexBuffer = {};
+    VulkanBuffer indexBuffer = {}; // Shared by all draws
 };
 
 struct DrawParameters
@@ -725,7 +726,7 @@ int main(int argc, char** argv)
                         sizeof(DrawParameters),
                         &drawParams);
 
-                    vkCmdDrawIndexed(cmdBuf.CommandBuffer, draw.numIndices, 1, 0, 0, 0);
+                    vkCmdDrawIndexed(cmdBuf.CommandBuffer, draw.numIndices, 1, draw.firstIndex, 0, 0);
                 }
             }
 
@@ -1518,25 +1519,30 @@ void CreateCameraVertexBuffers(
     std::vector<DrawInfo>& outDrawParams,
     VertexBuffers&         outVertexBuffers)
 {
+    // One index buffer for the whole mesh, each draw is a material range in it
+    VulkanBuffer indexBuffer = {};
+    CHECK_CALL(CreateBuffer(
+        pRenderer,
+        SizeInBytes(pMesh->GetTriangles()),
+        DataPtr(pMesh->GetTriangles()),
+        VK_BUFFER_USAGE_INDEX_BUFFER_BIT,
+        VMA_MEMORY_USAGE_GPU_ONLY,
+        0,
+        &indexBuffer));
+
     // Group draws based on material indices
     for (uint32_t materialIndex = 0; materialIndex < pMesh->GetNumMaterials(); ++materialIndex)
     {
-        auto triangles = pMesh->GetTrianglesForMaterial(materialIndex);
-
-        DrawInfo params      = {};
-        params.numIndices    = static_cast<uint32_t>(3 * triangles.size());
-        params.materialIndex = materialIndex;
+        for (auto& range : pMesh->GetMaterialRanges(materialIndex))
+        {
+            DrawInfo params      = {};
+            params.materialIndex = materialIndex;
+            params.firstIndex    = 3 * range.firstTriangle;
+            params.numIndices    = 3 * range.numTriangles;
+            params.indexBuffer   = indexBuffer;
 
-        CHECK_CALL(CreateBuffer(
-            pRenderer,
-            SizeInBytes(triangles),
-            DataPtr(triangles),
-            VK_BUFFER_USAGE_INDEX_BUFFER_BIT,
-            VMA_MEMORY_USAGE_GPU_ONLY,
-            0,
-            &params.indexBuffer));
-
-        outDrawParams.push_back(params);
+            outDrawParams.push_back(params);
+        }
     }
 
     CHECK_CALL(CreateBuffer(
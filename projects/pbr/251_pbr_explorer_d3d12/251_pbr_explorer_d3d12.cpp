@@ -2,6 +2,7 @@
 
 #include "dx_renderer.h"
 #include "bitmap.h"
+#include "ibl_residency.h"
 #include "tri_mesh.h"
 
 #include <glm/glm.hpp>
@@ -202,7 +203,9 @@ static std::vector<std::string> gMaterialNames = {
 
 static uint32_t                 gNumLights           = 0;
 static const uint32_t           gMaxIBLs             = 32;
+static const uint64_t           gIBLMemoryBudget     = 1024 * 1024 * 1024; // RGBA16F environment maps, about 8 at 4k
 static uint32_t                 gIBLIndex            = 0;
+static uint32_t                 gCurrentIBLIndex     = 0;
 static std::vector<std::string> gIBLNames            = {};
 static float                    gIBLDiffuseStrength  = 1.0f;
 static float                    gIBLSpecularStrength = 1.0f;
@@ -216,15 +219,23 @@ void CreateEnvironmentVertexBuffers(
 void CreateMaterialModels(
     DxRenderer*                   pRenderer,
     std::vector<GeometryBuffers>& outGeomtryBuffers);
-void CreateIBLTextures(
+void CreateBRDFLUT(DxRenderer* pRenderer, ID3D12Resource** ppBRDFLUT);
+void ApplyIBLUpdate(
     DxRenderer*                          pRenderer,
-    ID3D12Resource**                     ppBRDFLUT,
-    std::vector<ComPtr<ID3D12Resource>>& outIrradianceTextures,
-    std::vector<ComPtr<ID3D12Resource>>& outEnvironmentTextures,
-    std::vector<uint32_t>&               outEnvNumLevels);
+    const IBLUpdate&                     update,
+    std::vector<ComPtr<ID3D12Resource>>& irradianceTextures,
+    std::vector<ComPtr<ID3D12Resource>>& envTextures,
+    std::vector<uint32_t>&               envNumLevels);
 void CreateDescriptorHeap(
     DxRenderer*            pRenderer,
     ID3D12DescriptorHeap** ppHeap);
+void WriteIBLDescriptors(
+    DxRenderer*           pRenderer,
+    ID3D12DescriptorHeap* pDescriptorHeap,
+    uint32_t              iblIndex,
+    ID3D12Resource*       pIrradianceTexture,
+    ID3D12Resource*       pEnvTexture,
+    uint32_t              envNumLevels);
 
 void MouseMove(int x, int y, int buttons)
 {
@@ -405,11 +416,29 @@ int main(int argc, char** argv)
     // *************************************************************************
     // Environment texture
     // *************************************************************************
-    ComPtr<ID3D12Resource>              brdfLUT;
-    std::vector<ComPtr<ID3D12Resource>> irrTextures;
-    std::vector<ComPtr<ID3D12Resource>> envTextures;
-    std::vector<uint32_t>               envNumLevels;
-    CreateIBLTextures(renderer.get(), &brdfLUT, irrTextures, envTextures, envNumLevels);
+    ComPtr<ID3D12Resource> brdfLUT;
+    CreateBRDFLUT(renderer.get(), &brdfLUT);
+
+    // Only the selected IBL is loaded, others are loaded when they're
+    // selected and evicted when they go over the budget
+    IBLResidency iblResidency(
+        FindIBLFiles(gMaxIBLs),
+        BCEncodeOptions().Format(GREX_FORMAT_R16G16B16A16_FLOAT),
+        gIBLMemoryBudget);
+    for (uint32_t i = 0; i < iblResidency.GetCount(); ++i)
+    {
+        gIBLNames.push_back(iblResidency.GetName(i));
+    }
+
+    std::vector<ComPtr<ID3D12Resource>> irrTextures(iblResidency.GetCount());
+    std::vector<ComPtr<ID3D12Resource>> envTextures(iblResidency.GetCount());
+    std::vector<uint32_t>               envNumLevels(iblResidency.GetCount());
+    iblResidency.Select(gIBLIndex);
+    iblResidency.WaitForSelected();
+    for (auto& update : iblResidency.TakeUpdates())
+    {
+        ApplyIBLUpdate(renderer.get(), update, irrTextures, envTextures, envNumLevels);
+    }
 
     // *************************************************************************
     // Descriptor heaps
@@ -423,20 +452,10 @@ int main(int argc, char** argv)
         // LUT
         CreateDescriptorTexture2D(renderer.get(), brdfLUT.Get(), heapStart);
 
-        // Irradiance
-        D3D12_CPU_DESCRIPTOR_HANDLE descriptor = {heapStart.ptr + incSize};
-        for (size_t i = 0; i < irrTextures.size(); ++i)
-        {
-            CreateDescriptorTexture2D(renderer.get(), irrTextures[i].Get(), descriptor);
-            descriptor.ptr += incSize;
-        }
-
-        // Environment
-        descriptor = {heapStart.ptr + (1 + gMaxIBLs) * incSize};
-        for (size_t i = 0; i < irrTextures.size(); ++i)
+        // Irradiance and environment
+        for (uint32_t i = 0; i < CountU32(irrTextures); ++i)
         {
-            CreateDescriptorTexture2D(renderer.get(), envTextures[i].Get(), descriptor, 0, envNumLevels[i]);
-            descriptor.ptr += incSize;
+            WriteIBLDescriptors(renderer.get(), descriptorHeap.Get(), i, irrTextures[i].Get(), envTextures[i].Get(), envNumLevels[i]);
         }
     }
 
@@ -519,6 +538,7 @@ int main(int argc, char** argv)
                     {
                         currentIBLName = gIBLNames[i].c_str();
                         gIBLIndex      = static_cast<uint32_t>(i);
+                        iblResidency.Select(gIBLIndex);
                     }
                     if (isSelected)
                     {
@@ -723,6 +743,30 @@ int main(int argc, char** argv)
 
         // ---------------------------------------------------------------------
 
+        // Apply IBL loads and evictions, the GPU is waited on at the end
+        // of every frame so evicted textures and their descriptors aren't
+        // in use
+        for (auto& update : iblResidency.TakeUpdates())
+        {
+            ApplyIBLUpdate(renderer.get(), update, irrTextures, envTextures, envNumLevels);
+
+            WriteIBLDescriptors(
+                renderer.get(),
+                descriptorHeap.Get(),
+                update.index,
+                irrTextures[update.index].Get(),
+                envTextures[update.index].Get(),
+                envNumLevels[update.index]);
+        }
+
+        // Switch over once the selected IBL has at least its fallback
+        if (irrTextures[gIBLIndex])
+        {
+            gCurrentIBLIndex = gIBLIndex;
+        }
+
+        // ---------------------------------------------------------------------
+
         UINT bufferIndex = renderer->Swapchain->GetCurrentBackBufferIndex();
 
         ComPtr<ID3D12Resource> swapchainBuffer;
@@ -785,8 +829,8 @@ int main(int argc, char** argv)
             pSceneParams->lights[3].position   = vec3(15, 0, 0);
             pSceneParams->lights[3].color      = vec3(0.92f, 0.5f, 0.7f);
             pSceneParams->lights[3].intensity  = 0.5f;
-            pSceneParams->iblNumEnvLevels      = envNumLevels[gIBLIndex];
-            pSceneParams->iblIndex             = gIBLIndex;
+            pSceneParams->iblNumEnvLevels      = envNumLevels[gCurrentIBLIndex];
+            pSceneParams->iblIndex             = gCurrentIBLIndex;
             pSceneParams->iblDiffuseStrength   = gIBLDiffuseStrength;
             pSceneParams->iblSpecularStrength  = gIBLSpecularStrength;
 
@@ -800,7 +844,7 @@ int main(int argc, char** argv)
                 // SceneParmas (b0)
                 mat4 mvp = projMat * viewMat * moveUp;
                 commandList->SetGraphicsRoot32BitConstants(0, 16, &mvp, 0);
-                commandList->SetGraphicsRoot32BitConstants(0, 1, &gIBLIndex, 16);
+                commandList->SetGraphicsRoot32BitConstants(0, 1, &gCurrentIBLIndex, 16);
                 // Textures (32)
                 D3D12_GPU_DESCRIPTOR_HANDLE tableStart = descriptorHeap->GetGPUDescriptorHandleForHeapStart();
                 tableStart.ptr += (1 + gMaxIBLs) * renderer->Device->GetDescriptorHandleIncrementSize(D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV);
@@ -1333,116 +1377,74 @@ void CreateMaterialModels(
     }
 }
 
-void CreateIBLTextures(
-    DxRenderer*                          pRenderer,
-    ID3D12Resource**                     ppBRDFLUT,
-    std::vector<ComPtr<ID3D12Resource>>& outIrradianceTextures,
-    std::vector<ComPtr<ID3D12Resource>>& outEnvironmentTextures,
-    std::vector<uint32_t>&               outEnvNumLevels)
+void CreateBRDFLUT(DxRenderer* pRenderer, ID3D12Resource** ppBRDFLUT)
 {
-    // BRDF LUT
+    auto bitmap = LoadImage32f(GetAssetPath("IBL/brdf_lut.hdr"));
+    if (bitmap.Empty())
     {
-        auto bitmap = LoadImage32f(GetAssetPath("IBL/brdf_lut.hdr"));
-        if (bitmap.Empty())
-        {
-            assert(false && "Load image failed");
-            return;
-        }
-
-        ComPtr<ID3D12Resource> texture;
-        CHECK_CALL(CreateTexture(
-            pRenderer,
-            bitmap.GetWidth(),
-            bitmap.GetHeight(),
-            DXGI_FORMAT_R32G32B32A32_FLOAT,
-            bitmap.GetSizeInBytes(),
-            bitmap.GetPixels(),
-            ppBRDFLUT));
+        assert(false && "Load image failed");
+        return;
     }
 
-    auto                               iblDir = GetAssetPath("IBL");
-    std::vector<std::filesystem::path> iblFiles;
-    for (auto& entry : std::filesystem::directory_iterator(iblDir))
-    {
-        if (!entry.is_regular_file())
-        {
-            continue;
-        }
-        auto path = entry.path();
-        auto ext  = path.extension();
-        if (ext == ".ibl")
-        {
-            path = std::filesystem::relative(path, iblDir.parent_path());
-            iblFiles.push_back(path);
-        }
-    }
+    CHECK_CALL(CreateTexture(
+        pRenderer,
+        bitmap.GetWidth(),
+        bitmap.GetHeight(),
+        DXGI_FORMAT_R32G32B32A32_FLOAT,
+        bitmap.GetSizeInBytes(),
+        bitmap.GetPixels(),
+        ppBRDFLUT));
+}
 
-    size_t maxEntries = std::min<size_t>(gMaxIBLs, iblFiles.size());
-    for (size_t i = 0; i < maxEntries; ++i)
+void ApplyIBLUpdate(
+    DxRenderer*                          pRenderer,
+    const IBLUpdate&                     update,
+    std::vector<ComPtr<ID3D12Resource>>& irradianceTextures,
+    std::vector<ComPtr<ID3D12Resource>>& envTextures,
+    std::vector<uint32_t>&               envNumLevels)
+{
+    // The irradiance map stands in for the environment map until it's
+    // resident, envNumLevels is for whichever one is bound
+    switch (update.type)
     {
-        auto& iblFile = iblFiles[i];
-
-        IBLMaps ibl = {};
-        if (!LoadIBLMaps32f(iblFile, &ibl))
-        {
-            GREX_LOG_ERROR("failed to load: " << iblFile);
-            return;
-        }
-
-        outEnvNumLevels.push_back(ibl.numLevels);
-
-        // Irradiance
+        case IBL_UPDATE_FALLBACK:
         {
-            ComPtr<ID3D12Resource> texture;
             CHECK_CALL(CreateTexture(
                 pRenderer,
-                ibl.irradianceMap.GetWidth(),
-                ibl.irradianceMap.GetHeight(),
+                update.irradianceMap.GetWidth(),
+                update.irradianceMap.GetHeight(),
                 DXGI_FORMAT_R32G32B32A32_FLOAT,
-                ibl.irradianceMap.GetSizeInBytes(),
-                ibl.irradianceMap.GetPixels(),
-                &texture));
-            outIrradianceTextures.push_back(texture);
+                update.irradianceMap.GetSizeInBytes(),
+                update.irradianceMap.GetPixels(),
+                &irradianceTextures[update.index]));
+
+            envNumLevels[update.index] = 1;
         }
+        break;
 
-        // Environment
+        case IBL_UPDATE_ENVIRONMENT:
         {
-            const uint32_t pixelStride = ibl.environmentMap.GetPixelStride();
-            const uint32_t rowStride   = ibl.environmentMap.GetRowStride();
-
-            std::vector<MipOffset> mipOffsets;
-            uint32_t               levelOffset = 0;
-            uint32_t               levelWidth  = ibl.baseWidth;
-            uint32_t               levelHeight = ibl.baseHeight;
-            for (uint32_t i = 0; i < ibl.numLevels; ++i)
-            {
-                MipOffset mipOffset = {};
-                mipOffset.Offset    = levelOffset;
-                mipOffset.RowStride = rowStride;
-
-                mipOffsets.push_back(mipOffset);
-
-                levelOffset += (rowStride * levelHeight);
-                levelWidth >>= 1;
-                levelHeight >>= 1;
-            }
-
-            ComPtr<ID3D12Resource> texture;
             CHECK_CALL(CreateTexture(
                 pRenderer,
-                ibl.baseWidth,
-                ibl.baseHeight,
-                DXGI_FORMAT_R32G32B32A32_FLOAT,
-                mipOffsets,
-                ibl.environmentMap.GetSizeInBytes(),
-                ibl.environmentMap.GetPixels(),
-                &texture));
-            outEnvironmentTextures.push_back(texture);
+                update.width,
+                update.height,
+                ToDxFormat(update.format),
+                update.mipOffsets,
+                update.GetSizeInBytes(),
+                update.GetData(),
+                &envTextures[update.index]));
+
+            envNumLevels[update.index] = update.GetNumLevels();
         }
+        break;
 
-        gIBLNames.push_back(iblFile.filename().replace_extension().string());
+        case IBL_UPDATE_EVICT:
+        {
+            envTextures[update.index].Reset();
 
-        GREX_LOG_INFO("Loaded " << iblFile);
+            envNumLevels[update.index] = 1;
+        }
+        break;
     }
 }
 
@@ -1458,4 +1460,30 @@ void CreateDescriptorHeap(
     CHECK_CALL(pRenderer->Device->CreateDescriptorHeap(
         &desc,
         IID_PPV_ARGS(ppHeap)));
-}
\ No newline at end of file
+}
+
+void WriteIBLDescriptors(
+    DxRenderer*           pRenderer,
+    ID3D12DescriptorHeap* pDescriptorHeap,
+    uint32_t              iblIndex,
+    ID3D12Resource*       pIrradianceTexture,
+    ID3D12Resource*       pEnvTexture,
+    uint32_t              envNumLevels)
+{
+    // IBLs that were never selected have neither texture
+    if (IsNull(pIrradianceTexture))
+    {
+        return;
+    }
+
+    D3D12_CPU_DESCRIPTOR_HANDLE heapStart = pDescriptorHeap->GetCPUDescriptorHandleForHeapStart();
+    auto                        incSize   = pRenderer->Device->GetDescriptorHandleIncrementSize(D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV);
+
+    // Irradiance
+    D3D12_CPU_DESCRIPTOR_HANDLE descriptor = {heapStart.ptr + (1 + iblIndex) * incSize};
+    CreateDescriptorTexture2D(pRenderer, pIrradianceTexture, descriptor);
+
+    // Environment, the irradiance map until it's resident
+    descriptor = {heapStart.ptr + (1 + gMaxIBLs + iblIndex) * incSize};
+    CreateDescriptorTexture2D(pRenderer, IsNull(pEnvTexture) ? pIrradianceTexture : pEnvTexture, descriptor, 0, envNumLevels);
+}
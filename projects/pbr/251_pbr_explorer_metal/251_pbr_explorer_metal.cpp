@@ -2,6 +2,7 @@
 
 #include "mtl_renderer.h"
 #include "bitmap.h"
+#include "ibl_residency.h"
 #include "tri_mesh.h"
 
 #include <glm/glm.hpp>
@@ -213,7 +214,9 @@ static std::vector<std::string> gMaterialNames = {
 
 static uint32_t                 gNumLights           = 0;
 static const uint32_t           gMaxIBLs             = 32;
+static const uint64_t           gIBLMemoryBudget     = 1024 * 1024 * 1024; // RGBA16F environment maps, about 8 at 4k
 static uint32_t                 gIBLIndex            = 0;
+static uint32_t                 gCurrentIBLIndex     = 0;
 static std::vector<std::string> gIBLNames            = {};
 static float                    gIBLDiffuseStrength  = 1.0f;
 static float                    gIBLSpecularStrength = 1.0f;
@@ -225,12 +228,13 @@ void CreateEnvironmentVertexBuffers(
 void CreateMaterialModels(
     MetalRenderer*                pRenderer,
     std::vector<GeometryBuffers>& outGeomtryBuffers);
-void CreateIBLTextures(
+void CreateBRDFLUT(MetalRenderer* pRenderer, MetalTexture* pBRDFLUT);
+void ApplyIBLUpdate(
     MetalRenderer*             pRenderer,
-    MetalTexture*              pBRDFLUT,
-    std::vector<MetalTexture>& outIrradianceTextures,
-    std::vector<MetalTexture>& outEnvironmentTextures,
-    std::vector<uint32_t>&     outEnvNumLevels);
+    const IBLUpdate&           update,
+    std::vector<MetalTexture>& irradianceTextures,
+    std::vector<MetalTexture>& envTextures,
+    std::vector<uint32_t>&     envNumLevels);
 
 void MouseMove(int x, int y, int buttons)
 {
@@ -394,29 +398,35 @@ int main(int argc, char** argv)
     // *************************************************************************
     // Environment texture
     // *************************************************************************
-    MetalTexture              brdfLUT;
-    std::vector<MetalTexture> irrTextures;
-    std::vector<MetalTexture> envTextures;
-    std::vector<uint32_t>     envNumLevels;
-    CreateIBLTextures(renderer.get(), &brdfLUT, irrTextures, envTextures, envNumLevels);
+    MetalTexture brdfLUT;
+    CreateBRDFLUT(renderer.get(), &brdfLUT);
+
+    // Only the selected IBL is loaded, others are loaded when they're
+    // selected and evicted when they go over the budget
+    IBLResidency iblResidency(
+        FindIBLFiles(gMaxIBLs),
+        BCEncodeOptions().Format(GREX_FORMAT_R16G16B16A16_FLOAT),
+        gIBLMemoryBudget);
+    for (uint32_t i = 0; i < iblResidency.GetCount(); ++i)
+    {
+        gIBLNames.push_back(iblResidency.GetName(i));
+    }
+
+    std::vector<MetalTexture> irrTextures(iblResidency.GetCount());
+    std::vector<MetalTexture> envTextures(iblResidency.GetCount());
+    std::vector<uint32_t>     envNumLevels(iblResidency.GetCount());
+    iblResidency.Select(gIBLIndex);
+    iblResidency.WaitForSelected();
 
     // *************************************************************************
     // Texture Arrays
+    //
+    // Bound as ranges of gMaxIBLs, entries are filled in as IBLs load. The
+    // environment entry is the irradiance map until the environment map is
+    // resident.
     // *************************************************************************
-
-    // Irradiance
-    std::vector<MTL::Texture*> irrMetalTextures;
-    for (size_t i = 0; i < irrTextures.size(); ++i)
-    {
-        irrMetalTextures.push_back(irrTextures[i].Texture.get());
-    }
-
-    // Environment
-    std::vector<MTL::Texture*> envMetalTextures;
-    for (size_t i = 0; i < envTextures.size(); ++i)
-    {
-        envMetalTextures.push_back(envTextures[i].Texture.get());
-    }
+    std::vector<MTL::Texture*> irrMetalTextures(gMaxIBLs);
+    std::vector<MTL::Texture*> envMetalTextures(gMaxIBLs);
 
     // *************************************************************************
     // Window
@@ -474,6 +484,7 @@ int main(int argc, char** argv)
                     {
                         currentIBLName = gIBLNames[i].c_str();
                         gIBLIndex      = static_cast<uint32_t>(i);
+                        iblResidency.Select(gIBLIndex);
                     }
                     if (isSelected)
                     {
@@ -678,6 +689,28 @@ int main(int argc, char** argv)
 
         // ---------------------------------------------------------------------
 
+        // Apply IBL loads and evictions, command buffers retain the textures
+        // they use so evicted textures stay alive until in flight frames are
+        // done with them
+        for (auto& update : iblResidency.TakeUpdates())
+        {
+            ApplyIBLUpdate(renderer.get(), update, irrTextures, envTextures, envNumLevels);
+
+            MetalTexture& irrTexture = irrTextures[update.index];
+            MetalTexture& envTexture = envTextures[update.index];
+
+            irrMetalTextures[update.index] = irrTexture.Texture.get();
+            envMetalTextures[update.index] = envTexture.Texture ? envTexture.Texture.get() : irrTexture.Texture.get();
+        }
+
+        // Switch over once the selected IBL has at least its fallback
+        if (irrTextures[gIBLIndex].Texture)
+        {
+            gCurrentIBLIndex = gIBLIndex;
+        }
+
+        // ---------------------------------------------------------------------
+
         CA::MetalDrawable* pDrawable = renderer->pSwapchain->nextDrawable();
         assert(pDrawable != nullptr);
 
@@ -733,8 +766,8 @@ int main(int argc, char** argv)
         sceneParams.lights[3].position      = vec3(15, 0, 0);
         sceneParams.lights[3].color         = vec3(0.92f, 0.5f, 0.7f);
         sceneParams.lights[3].intensity     = 0.5f;
-        sceneParams.iblEnvironmentNumLevels = envNumLevels[gIBLIndex];
-        sceneParams.iblIndex                = gIBLIndex;
+        sceneParams.iblEnvironmentNumLevels = envNumLevels[gCurrentIBLIndex];
+        sceneParams.iblIndex                = gCurrentIBLIndex;
         sceneParams.iblDiffuseStrength      = gIBLDiffuseStrength;
         sceneParams.iblSpecularStrength     = gIBLSpecularStrength;
 
@@ -754,7 +787,7 @@ int main(int argc, char** argv)
             } sceneParams;
 
             sceneParams.MVP      = projMat * viewMat * moveUp;
-            sceneParams.iblIndex = gIBLIndex;
+            sceneParams.iblIndex = gCurrentIBLIndex;
 
             pRenderEncoder->setVertexBytes(&sceneParams, sizeof(sceneParams), 2);
             pRenderEncoder->setFragmentBytes(&sceneParams, sizeof(sceneParams), 2);
@@ -1229,117 +1262,73 @@ void CreateMaterialModels(
     }
 }
 
-void CreateIBLTextures(
-    MetalRenderer*             pRenderer,
-    MetalTexture*              pBRDFLUT,
-    std::vector<MetalTexture>& outIrradianceTextures,
-    std::vector<MetalTexture>& outEnvironmentTextures,
-    std::vector<uint32_t>&     outEnvNumLevels)
+void CreateBRDFLUT(MetalRenderer* pRenderer, MetalTexture* pBRDFLUT)
 {
-    // BRDF LUT
+    auto bitmap = LoadImage32f(GetAssetPath("IBL/brdf_lut.hdr"));
+    if (bitmap.Empty())
     {
-        auto bitmap = LoadImage32f(GetAssetPath("IBL/brdf_lut.hdr"));
-        if (bitmap.Empty())
-        {
-            assert(false && "Load image failed");
-            return;
-        }
-
-        CHECK_CALL(CreateTexture(
-            pRenderer,
-            bitmap.GetWidth(),
-            bitmap.GetHeight(),
-            MTL::PixelFormatRGBA32Float,
-            bitmap.GetSizeInBytes(),
-            bitmap.GetPixels(),
-            pBRDFLUT));
+        assert(false && "Load image failed");
+        return;
     }
 
-    auto                               iblDir = GetAssetPath("IBL");
-    std::vector<std::filesystem::path> iblFiles;
-    for (auto& entry : std::filesystem::directory_iterator(iblDir))
-    {
-        if (!entry.is_regular_file())
-        {
-            continue;
-        }
-        auto path = entry.path();
-        auto ext  = path.extension();
-        if (ext == ".ibl")
-        {
-            path = std::filesystem::relative(path, iblDir.parent_path());
-            iblFiles.push_back(path);
-        }
-    }
-
-    // Sort the paths so we match functionality on Windows
-    std::sort(iblFiles.begin(), iblFiles.end());
+    CHECK_CALL(CreateTexture(
+        pRenderer,
+        bitmap.GetWidth(),
+        bitmap.GetHeight(),
+        MTL::PixelFormatRGBA32Float,
+        bitmap.GetSizeInBytes(),
+        bitmap.GetPixels(),
+        pBRDFLUT));
+}
 
-    size_t maxEntries = std::min<size_t>(gMaxIBLs, iblFiles.size());
-    for (size_t i = 0; i < maxEntries; ++i)
+void ApplyIBLUpdate(
+    MetalRenderer*             pRenderer,
+    const IBLUpdate&           update,
+    std::vector<MetalTexture>& irradianceTextures,
+    std::vector<MetalTexture>& envTextures,
+    std::vector<uint32_t>&     envNumLevels)
+{
+    // The irradiance map stands in for the environment map until it's
+    // resident, envNumLevels is for whichever one is bound
+    switch (update.type)
     {
-        auto& iblFile = iblFiles[i];
-
-        IBLMaps ibl = {};
-        if (!LoadIBLMaps32f(iblFile, &ibl))
+        case IBL_UPDATE_FALLBACK:
         {
-            GREX_LOG_ERROR("failed to load: " << iblFile);
-            return;
-        }
-
-        outEnvNumLevels.push_back(ibl.numLevels);
-
-        // Irradiance
-        {
-            MetalTexture texture = {};
             CHECK_CALL(CreateTexture(
                 pRenderer,
-                ibl.irradianceMap.GetWidth(),
-                ibl.irradianceMap.GetHeight(),
+                update.irradianceMap.GetWidth(),
+                update.irradianceMap.GetHeight(),
                 MTL::PixelFormatRGBA32Float,
-                ibl.irradianceMap.GetSizeInBytes(),
-                ibl.irradianceMap.GetPixels(),
-                &texture));
-            outIrradianceTextures.push_back(texture);
+                update.irradianceMap.GetSizeInBytes(),
+                update.irradianceMap.GetPixels(),
+                &irradianceTextures[update.index]));
+
+            envNumLevels[update.index] = 1;
         }
+        break;
 
-        // Environment
+        case IBL_UPDATE_ENVIRONMENT:
         {
-            const uint32_t pixelStride = ibl.environmentMap.GetPixelStride();
-            const uint32_t rowStride   = ibl.environmentMap.GetRowStride();
-
-            std::vector<MipOffset> mipOffsets;
-            uint32_t               levelOffset = 0;
-            uint32_t               levelWidth  = ibl.baseWidth;
-            uint32_t               levelHeight = ibl.baseHeight;
-            for (uint32_t i = 0; i < ibl.numLevels; ++i)
-            {
-                MipOffset mipOffset = {};
-                mipOffset.Offset    = levelOffset;
-                mipOffset.RowStride = rowStride;
-
-                mipOffsets.push_back(mipOffset);
-
-                levelOffset += (rowStride * levelHeight);
-                levelWidth >>= 1;
-                levelHeight >>= 1;
-            }
-
-            MetalTexture texture = {};
             CHECK_CALL(CreateTexture(
                 pRenderer,
-                ibl.baseWidth,
-                ibl.baseHeight,
-                MTL::PixelFormatRGBA32Float,
-                mipOffsets,
-                ibl.environmentMap.GetSizeInBytes(),
-                ibl.environmentMap.GetPixels(),
-                &texture));
-            outEnvironmentTextures.push_back(texture);
+                update.width,
+                update.height,
+                ToMTLFormat(update.format),
+                update.mipOffsets,
+                update.GetSizeInBytes(),
+                update.GetData(),
+                &envTextures[update.index]));
+
+            envNumLevels[update.index] = update.GetNumLevels();
         }
+        break;
 
-        gIBLNames.push_back(iblFile.filename().replace_extension().string());
+        case IBL_UPDATE_EVICT:
+        {
+            envTextures[update.index].Texture.reset();
 
-        GREX_LOG_INFO("Loaded " << iblFile);
+            envNumLevels[update.index] = 1;
+        }
+        break;
     }
 }
@@ -2,6 +2,7 @@
 
 #include "vk_renderer.h"
 #include "bitmap.h"
+#include "ibl_residency.h"
 #include "tri_mesh.h"
 
 #include <glm/glm.hpp>
@@ -215,7 +216,9 @@ static std::vector<std::string> gMaterialNames = {
 
 static uint32_t                 gNumLights           = 0;
 static const uint32_t           gMaxIBLs             = 32;
+static const uint64_t           gIBLMemoryBudget     = 1024 * 1024 * 1024; // RGBA16F environment maps, about 8 at 4k
 static uint32_t                 gIBLIndex            = 0;
+static uint32_t                 gCurrentIBLIndex     = 0;
 static std::vector<std::string> gIBLNames            = {};
 static float                    gIBLDiffuseStrength  = 1.0f;
 static float                    gIBLSpecularStrength = 1.0f;
@@ -229,24 +232,35 @@ void CreateEnvironmentVertexBuffers(
 void CreateMaterialModels(
     VulkanRenderer*               pRenderer,
     std::vector<GeometryBuffers>& outGeomtryBuffers);
-void CreateIBLTextures(
+void CreateBRDFLUT(VulkanRenderer* pRenderer, VulkanImage* pBRDFLUT);
+void ApplyIBLUpdate(
     VulkanRenderer*           pRenderer,
-    VulkanImage*              pBRDFLUT,
-    std::vector<VulkanImage>& outIrradianceTextures,
-    std::vector<VulkanImage>& outEnvironmentTextures,
-    std::vector<uint32_t>&    outEnvNumLevels);
+    const IBLUpdate&          update,
+    std::vector<VulkanImage>& irradianceTextures,
+    std::vector<VulkanImage>& envTextures,
+    std::vector<VkImageView>& irradianceViews,
+    std::vector<VkImageView>& envViews,
+    std::vector<uint32_t>&    envNumLevels);
 void CreatePBRDescriptors(
-    VulkanRenderer*           pRenderer,
-    VulkanDescriptorSet*      pDescriptors,
-    const VulkanBuffer*       pSceneParamsBuffer,
-    const VulkanBuffer*       pMaterialParamsBuffer,
-    const VulkanImage*        pBRDFLUT,
-    std::vector<VulkanImage>& pIrradianceTexture,
-    std::vector<VulkanImage>& pEnvTexture);
+    VulkanRenderer*                 pRenderer,
+    VulkanDescriptorSet*            pDescriptors,
+    const VulkanBuffer*             pSceneParamsBuffer,
+    const VulkanBuffer*             pMaterialParamsBuffer,
+    const VulkanImage*              pBRDFLUT,
+    const std::vector<VkImageView>& irradianceViews,
+    const std::vector<VkImageView>& envViews);
 void CreateEnvDescriptors(
-    VulkanRenderer*           pRenderer,
-    VulkanDescriptorSet*      pDescriptors,
-    std::vector<VulkanImage>& envTextures);
+    VulkanRenderer*                 pRenderer,
+    VulkanDescriptorSet*            pDescriptors,
+    const std::vector<VkImageView>& irradianceViews,
+    const std::vector<VkImageView>& envViews);
+void UpdateIBLDescriptors(
+    VulkanRenderer*      pRenderer,
+    VulkanDescriptorSet* pPBRDescriptors,
+    VulkanDescriptorSet* pEnvDescriptors,
+    uint32_t             iblIndex,
+    VkImageView          irradianceView,
+    VkImageView          envView);
 
 void MouseMove(int x, int y, int buttons)
 {
@@ -477,11 +491,31 @@ int main(int argc, char** argv)
     // *************************************************************************
     // Environment texture
     // *************************************************************************
-    VulkanImage              brdfLUT;
-    std::vector<VulkanImage> irrTextures;
-    std::vector<VulkanImage> envTextures;
-    std::vector<uint32_t>    envNumLevels;
-    CreateIBLTextures(renderer.get(), &brdfLUT, irrTextures, envTextures, envNumLevels);
+    VulkanImage brdfLUT;
+    CreateBRDFLUT(renderer.get(), &brdfLUT);
+
+    // Only the selected IBL is loaded, others are loaded when they're
+    // selected and evicted when they go over the budget
+    IBLResidency iblResidency(
+        FindIBLFiles(gMaxIBLs),
+        BCEncodeOptions().Format(GREX_FORMAT_R16G16B16A16_FLOAT),
+        gIBLMemoryBudget);
+    for (uint32_t i = 0; i < iblResidency.GetCount(); ++i)
+    {
+        gIBLNames.push_back(iblResidency.GetName(i));
+    }
+
+    std::vector<VulkanImage> irrTextures(iblResidency.GetCount());
+    std::vector<VulkanImage> envTextures(iblResidency.GetCount());
+    std::vector<VkImageView> irrViews(iblResidency.GetCount(), VK_NULL_HANDLE);
+    std::vector<VkImageView> envViews(iblResidency.GetCount(), VK_NULL_HANDLE);
+    std::vector<uint32_t>    envNumLevels(iblResidency.GetCount());
+    iblResidency.Select(gIBLIndex);
+    iblResidency.WaitForSelected();
+    for (auto& update : iblResidency.TakeUpdates())
+    {
+        ApplyIBLUpdate(renderer.get(), update, irrTextures, envTextures, irrViews, envViews, envNumLevels);
+    }
 
     // *************************************************************************
     // Descriptor sets
@@ -494,14 +528,15 @@ int main(int argc, char** argv)
         &pbrSceneParamsBuffer,
         &pbrMaterialParamsBuffer,
         &brdfLUT,
-        irrTextures,
-        envTextures);
+        irrViews,
+        envViews);
 
     VulkanDescriptorSet envDescriptors;
     CreateEnvDescriptors(
         renderer.get(),
         &envDescriptors,
-        envTextures);
+        irrViews,
+        envViews);
 
     // *************************************************************************
     // Window
@@ -648,6 +683,7 @@ int main(int argc, char** argv)
                     {
                         currentIBLName = gIBLNames[i].c_str();
                         gIBLIndex      = static_cast<uint32_t>(i);
+                        iblResidency.Select(gIBLIndex);
                     }
                     if (isSelected)
                     {
@@ -852,6 +888,29 @@ int main(int argc, char** argv)
 
         // ---------------------------------------------------------------------
 
+        // Apply IBL loads and evictions, the GPU is waited on at the end
+        // of every frame so evicted textures aren't in use
+        for (auto& update : iblResidency.TakeUpdates())
+        {
+            ApplyIBLUpdate(renderer.get(), update, irrTextures, envTextures, irrViews, envViews, envNumLevels);
+
+            UpdateIBLDescriptors(
+                renderer.get(),
+                &pbrDescriptors,
+                &envDescriptors,
+                update.index,
+                irrViews[update.index],
+                envViews[update.index]);
+        }
+
+        // Switch over once the selected IBL has at least its fallback
+        if (irrTextures[gIBLIndex].Image != VK_NULL_HANDLE)
+        {
+            gCurrentIBLIndex = gIBLIndex;
+        }
+
+        // ---------------------------------------------------------------------
+
         UINT bufferIndex = 0;
         if (AcquireNextImage(renderer.get(), &bufferIndex))
         {
@@ -932,8 +991,8 @@ int main(int argc, char** argv)
             pPBRSceneParams->lights[3].position   = vec3(15, 0, 0);
             pPBRSceneParams->lights[3].color      = vec3(0.92f, 0.5f, 0.7f);
             pPBRSceneParams->lights[3].intensity  = 0.5f;
-            pPBRSceneParams->iblNumEnvLevels      = envNumLevels[gIBLIndex];
-            pPBRSceneParams->iblIndex             = gIBLIndex;
+            pPBRSceneParams->iblNumEnvLevels      = envNumLevels[gCurrentIBLIndex];
+            pPBRSceneParams->iblIndex             = gCurrentIBLIndex;
             pPBRSceneParams->iblDiffuseStrength   = gIBLDiffuseStrength;
             pPBRSceneParams->iblSpecularStrength  = gIBLSpecularStrength;
 
@@ -958,7 +1017,7 @@ int main(int argc, char** argv)
                 mat4 mvp = projMat * viewMat * moveUp;
 
                 EnvSceneParameters envSceneParams = {};
-                envSceneParams.IBLIndex           = gIBLIndex;
+                envSceneParams.IBLIndex           = gCurrentIBLIndex;
                 envSceneParams.MVP                = mvp;
 
                 vkCmdPushConstants(cmdBuf.CommandBuffer, envPipelineLayout.PipelineLayout, VK_SHADER_STAGE_ALL_GRAPHICS, 0, sizeof(EnvSceneParameters), &envSceneParams);
@@ -1553,126 +1612,108 @@ void CreateMaterialModels(
     }
 }
 
-void CreateIBLTextures(
-    VulkanRenderer*           pRenderer,
-    VulkanImage*              pBRDFLUT,
-    std::vector<VulkanImage>& outIrradianceTextures,
-    std::vector<VulkanImage>& outEnvironmentTextures,
-    std::vector<uint32_t>&    outEnvNumLevels)
+void CreateBRDFLUT(VulkanRenderer* pRenderer, VulkanImage* pBRDFLUT)
 {
-    // BRDF LUT
+    auto bitmap = LoadImage32f(GetAssetPath("IBL/brdf_lut.hdr"));
+    if (bitmap.Empty())
     {
-        auto bitmap = LoadImage32f(GetAssetPath("IBL/brdf_lut.hdr"));
-        if (bitmap.Empty())
-        {
-            assert(false && "Load image failed");
-            return;
-        }
-
-        CHECK_CALL(CreateTexture(
-            pRenderer,
-            bitmap.GetWidth(),
-            bitmap.GetHeight(),
-            VK_FORMAT_R32G32B32A32_SFLOAT,
-            bitmap.GetSizeInBytes(),
-            bitmap.GetPixels(),
-            pBRDFLUT));
+        assert(false && "Load image failed");
+        return;
     }
 
-    auto                               iblDir = GetAssetPath("IBL");
-    std::vector<std::filesystem::path> iblFiles;
-    for (auto& entry : std::filesystem::directory_iterator(iblDir))
+    CHECK_CALL(CreateTexture(
+        pRenderer,
+        bitmap.GetWidth(),
+        bitmap.GetHeight(),
+        VK_FORMAT_R32G32B32A32_SFLOAT,
+        bitmap.GetSizeInBytes(),
+        bitmap.GetPixels(),
+        pBRDFLUT));
+}
+
+void ApplyIBLUpdate(
+    VulkanRenderer*           pRenderer,
+    const IBLUpdate&          update,
+    std::vector<VulkanImage>& irradianceTextures,
+    std::vector<VulkanImage>& envTextures,
+    std::vector<VkImageView>& irradianceViews,
+    std::vector<VkImageView>& envViews,
+    std::vector<uint32_t>&    envNumLevels)
+{
+    // The irradiance map stands in for the environment map until it's
+    // resident, envNumLevels is for whichever one is bound. Each texture
+    // has one view that lives as long as it does, the descriptors are
+    // rewritten with them by UpdateIBLDescriptors().
+    switch (update.type)
     {
-        if (!entry.is_regular_file())
+        case IBL_UPDATE_FALLBACK:
         {
-            continue;
-        }
-        auto path = entry.path();
-        auto ext  = path.extension();
-        if (ext == ".ibl")
-        {
-            path = std::filesystem::relative(path, iblDir.parent_path());
-            iblFiles.push_back(path);
-        }
-    }
+            CHECK_CALL(CreateTexture(
+                pRenderer,
+                update.irradianceMap.GetWidth(),
+                update.irradianceMap.GetHeight(),
+                VK_FORMAT_R32G32B32A32_SFLOAT,
+                update.irradianceMap.GetSizeInBytes(),
+                update.irradianceMap.GetPixels(),
+                &irradianceTextures[update.index]));
 
-    size_t maxEntries = std::min<size_t>(gMaxIBLs, iblFiles.size());
-    for (size_t i = 0; i < maxEntries; ++i)
-    {
-        auto& iblFile = iblFiles[i];
+            CHECK_CALL(CreateImageView(
+                pRenderer,
+                &irradianceTextures[update.index],
+                VK_IMAGE_VIEW_TYPE_2D,
+                VK_FORMAT_R32G32B32A32_SFLOAT,
+                GREX_ALL_SUBRESOURCES,
+                &irradianceViews[update.index]));
 
-        IBLMaps ibl = {};
-        if (!LoadIBLMaps32f(iblFile, &ibl))
-        {
-            GREX_LOG_ERROR("failed to load: " << iblFile);
-            return;
+            envNumLevels[update.index] = 1;
         }
+        break;
 
-        outEnvNumLevels.push_back(ibl.numLevels);
-
-        // Irradiance
+        case IBL_UPDATE_ENVIRONMENT:
         {
-            VulkanImage texture;
             CHECK_CALL(CreateTexture(
                 pRenderer,
-                ibl.irradianceMap.GetWidth(),
-                ibl.irradianceMap.GetHeight(),
-                VK_FORMAT_R32G32B32A32_SFLOAT,
-                ibl.irradianceMap.GetSizeInBytes(),
-                ibl.irradianceMap.GetPixels(),
-                &texture));
-            outIrradianceTextures.push_back(texture);
+                update.width,
+                update.height,
+                ToVkFormat(update.format),
+                update.mipOffsets,
+                update.GetSizeInBytes(),
+                update.GetData(),
+                &envTextures[update.index]));
+
+            CHECK_CALL(CreateImageView(
+                pRenderer,
+                &envTextures[update.index],
+                VK_IMAGE_VIEW_TYPE_2D,
+                ToVkFormat(update.format),
+                GREX_ALL_SUBRESOURCES,
+                &envViews[update.index]));
+
+            envNumLevels[update.index] = update.GetNumLevels();
         }
+        break;
 
-        // Environment
+        case IBL_UPDATE_EVICT:
         {
-            const uint32_t pixelStride = ibl.environmentMap.GetPixelStride();
-            const uint32_t rowStride   = ibl.environmentMap.GetRowStride();
-
-            std::vector<MipOffset> mipOffsets;
-            uint32_t               levelOffset = 0;
-            uint32_t               levelWidth  = ibl.baseWidth;
-            uint32_t               levelHeight = ibl.baseHeight;
-            for (uint32_t i = 0; i < ibl.numLevels; ++i)
-            {
-                MipOffset mipOffset = {};
-                mipOffset.Offset    = levelOffset;
-                mipOffset.RowStride = rowStride;
+            vkDestroyImageView(pRenderer->Device, envViews[update.index], nullptr);
+            envViews[update.index] = VK_NULL_HANDLE;
 
-                mipOffsets.push_back(mipOffset);
-
-                levelOffset += (rowStride * levelHeight);
-                levelWidth >>= 1;
-                levelHeight >>= 1;
-            }
+            DestroyImage(pRenderer, &envTextures[update.index]);
 
-            VulkanImage texture;
-            CHECK_CALL(CreateTexture(
-                pRenderer,
-                ibl.baseWidth,
-                ibl.baseHeight,
-                VK_FORMAT_R32G32B32A32_SFLOAT,
-                mipOffsets,
-                ibl.environmentMap.GetSizeInBytes(),
-                ibl.environmentMap.GetPixels(),
-                &texture));
-            outEnvironmentTextures.push_back(texture);
+            envNumLevels[update.index] = 1;
         }
-
-        gIBLNames.push_back(iblFile.filename().replace_extension().string());
-
-        GREX_LOG_INFO("Loaded " << iblFile);
+        break;
     }
 }
 
 void CreatePBRDescriptors(
-    VulkanRenderer*           pRenderer,
-    VulkanDescriptorSet*      pDescriptors,
-    const VulkanBuffer*       pSceneParamsBuffer,
-    const VulkanBuffer*       pMaterialsBuffer,
-    const VulkanImage*        pBRDFLUT,
-    std::vector<VulkanImage>& irradianceTextures,
-    std::vector<VulkanImage>& envTextures)
+    VulkanRenderer*                 pRenderer,
+    VulkanDescriptorSet*            pDescriptors,
+    const VulkanBuffer*             pSceneParamsBuffer,
+    const VulkanBuffer*             pMaterialsBuffer,
+    const VulkanImage*              pBRDFLUT,
+    const std::vector<VkImageView>& irradianceViews,
+    const std::vector<VkImageView>& envViews)
 {
     // ConstantBuffer<SceneParameters>    SceneParams           : register(b0);
     VulkanBufferDescriptor sceneParamsDescriptor;
@@ -1793,19 +1834,17 @@ void CreatePBRDescriptors(
     }
 
     // Texture2D                            IrradianceMap[32]  : register(t16);
+    //
+    // IBLs that aren't loaded yet are written by UpdateIBLDescriptors()
+    //
     VulkanImageDescriptor irradianceMapDescriptor(32);
     {
-        uint32_t arrayElement = 0;
-        for (auto& irradianceTexture : irradianceTextures)
+        for (uint32_t arrayElement = 0; arrayElement < CountU32(irradianceViews); ++arrayElement)
         {
-            VkImageView imageView = VK_NULL_HANDLE;
-            CHECK_CALL(CreateImageView(
-                pRenderer,
-                &irradianceTexture,
-                VK_IMAGE_VIEW_TYPE_2D,
-                VK_FORMAT_R32G32B32A32_SFLOAT,
-                GREX_ALL_SUBRESOURCES,
-                &imageView));
+            if (irradianceViews[arrayElement] == VK_NULL_HANDLE)
+            {
+                continue;
+            }
 
             CreateDescriptor(
                 pRenderer,
@@ -1813,27 +1852,26 @@ void CreatePBRDescriptors(
                 16,           // binding
                 arrayElement, // arrayElement
                 VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE,
-                imageView,
+                irradianceViews[arrayElement],
                 VK_IMAGE_LAYOUT_GENERAL);
-
-            arrayElement++;
         }
     }
 
     // Texture2D                            EnvironmentMap[32] : register(t48);
     VulkanImageDescriptor environmentMapDescriptor(32);
     {
-        uint32_t arrayElement = 0;
-        for (auto& envTexture : envTextures)
+        for (uint32_t arrayElement = 0; arrayElement < CountU32(envViews); ++arrayElement)
         {
-            VkImageView imageView = VK_NULL_HANDLE;
-            CHECK_CALL(CreateImageView(
-                pRenderer,
-                &envTexture,
-                VK_IMAGE_VIEW_TYPE_2D,
-                VK_FORMAT_R32G32B32A32_SFLOAT,
-                GREX_ALL_SUBRESOURCES,
-                &imageView));
+            // Irradiance map until the environment map is resident
+            VkImageView imageView = envViews[arrayElement];
+            if (imageView == VK_NULL_HANDLE)
+            {
+                imageView = irradianceViews[arrayElement];
+            }
+            if (imageView == VK_NULL_HANDLE)
+            {
+                continue;
+            }
 
             CreateDescriptor(
                 pRenderer,
@@ -1843,8 +1881,6 @@ void CreatePBRDescriptors(
                 VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE,
                 imageView,
                 VK_IMAGE_LAYOUT_GENERAL);
-
-            arrayElement++;
         }
     }
 
@@ -1872,9 +1908,10 @@ void CreatePBRDescriptors(
 }
 
 void CreateEnvDescriptors(
-    VulkanRenderer*           pRenderer,
-    VulkanDescriptorSet*      pDescriptors,
-    std::vector<VulkanImage>& envTextures)
+    VulkanRenderer*                 pRenderer,
+    VulkanDescriptorSet*            pDescriptors,
+    const std::vector<VkImageView>& irradianceViews,
+    const std::vector<VkImageView>& envViews)
 {
     // set via push constants
     // ConstantBuffer<SceneParameters> SceneParams       : register(b0);
@@ -1918,17 +1955,18 @@ void CreateEnvDescriptors(
     // Texture2D                       IBLEnvironmentMap : register(t2);
     VulkanImageDescriptor iblEnvironmentMapDescriptor(gMaxIBLs);
     {
-        uint32_t arrayElement = 0;
-        for (auto& envTexture : envTextures)
+        for (uint32_t arrayElement = 0; arrayElement < CountU32(envViews); ++arrayElement)
         {
-            VkImageView imageView = VK_NULL_HANDLE;
-            CHECK_CALL(CreateImageView(
-                pRenderer,
-                &envTexture,
-                VK_IMAGE_VIEW_TYPE_2D,
-                VK_FORMAT_R32G32B32A32_SFLOAT,
-                GREX_ALL_SUBRESOURCES,
-                &imageView));
+            // Irradiance map until the environment map is resident
+            VkImageView imageView = envViews[arrayElement];
+            if (imageView == VK_NULL_HANDLE)
+            {
+                imageView = irradianceViews[arrayElement];
+            }
+            if (imageView == VK_NULL_HANDLE)
+            {
+                continue;
+            }
 
             CreateDescriptor(
                 pRenderer,
@@ -1938,8 +1976,6 @@ void CreateEnvDescriptors(
                 VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE,
                 imageView,
                 VK_IMAGE_LAYOUT_GENERAL);
-
-            arrayElement++;
         }
     }
 
@@ -1957,3 +1993,57 @@ void CreateEnvDescriptors(
 
     CreateAndUpdateDescriptorSet(pRenderer, setLayoutBinding, writeDescriptorSets, pDescriptors);
 }
+
+void UpdateIBLDescriptors(
+    VulkanRenderer*      pRenderer,
+    VulkanDescriptorSet* pPBRDescriptors,
+    VulkanDescriptorSet* pEnvDescriptors,
+    uint32_t             iblIndex,
+    VkImageView          irradianceView,
+    VkImageView          envView)
+{
+    // Irradiance map until the environment map is resident
+    if (envView == VK_NULL_HANDLE)
+    {
+        envView = irradianceView;
+    }
+
+    VkDescriptorImageInfo irradianceInfo = {};
+    irradianceInfo.imageView             = irradianceView;
+    irradianceInfo.imageLayout           = VK_IMAGE_LAYOUT_GENERAL;
+
+    VkDescriptorImageInfo envInfo = {};
+    envInfo.imageView             = envView;
+    envInfo.imageLayout           = VK_IMAGE_LAYOUT_GENERAL;
+
+    VkWriteDescriptorSet writes[3] = {};
+
+    // PBR: Texture2D                       IrradianceMap[32]  : register(t16);
+    writes[0]                 = {VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET};
+    writes[0].dstSet          = pPBRDescriptors->DescriptorSet;
+    writes[0].dstBinding      = 16;
+    writes[0].dstArrayElement = iblIndex;
+    writes[0].descriptorCount = 1;
+    writes[0].descriptorType  = VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE;
+    writes[0].pImageInfo      = &irradianceInfo;
+
+    // PBR: Texture2D                       EnvironmentMap[32] : register(t48);
+    writes[1]                 = {VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET};
+    writes[1].dstSet          = pPBRDescriptors->DescriptorSet;
+    writes[1].dstBinding      = 48;
+    writes[1].dstArrayElement = iblIndex;
+    writes[1].descriptorCount = 1;
+    writes[1].descriptorType  = VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE;
+    writes[1].pImageInfo      = &envInfo;
+
+    // Env: Texture2D                       IBLEnvironmentMap  : register(t2);
+    writes[2]                 = {VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET};
+    writes[2].dstSet          = pEnvDescriptors->DescriptorSet;
+    writes[2].dstBinding      = 32;
+    writes[2].dstArrayElement = iblIndex;
+    writes[2].descriptorCount = 1;
+    writes[2].descriptorType  = VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE;
+    writes[2].pImageInfo      = &envInfo;
+
+    vkUpdateDescriptorSets(pRenderer->Device, 3, writes, 0, nullptr);
+}
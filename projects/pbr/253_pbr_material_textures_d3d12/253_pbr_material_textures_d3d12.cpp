@@ -2,6 +2,8 @@
 
 #include "dx_renderer.h"
 #include "bitmap.h"
+#include "ibl_residency.h"
+#include "texture_loader.h"
 #include "tri_mesh.h"
 
 #include <glm/glm.hpp>
@@ -71,6 +73,15 @@ struct MaterialTextures
     ComPtr<ID3D12Resource> metallicTexture;
 };
 
+// Same order as MaterialTextures and the shader's texture array
+enum MaterialTextureSlot
+{
+    MATERIAL_TEXTURE_SLOT_BASE_COLOR = 0,
+    MATERIAL_TEXTURE_SLOT_NORMAL     = 1,
+    MATERIAL_TEXTURE_SLOT_ROUGHNESS  = 2,
+    MATERIAL_TEXTURE_SLOT_METALLIC   = 3,
+};
+
 struct GeometryBuffers
 {
     uint32_t               numIndices;
@@ -107,12 +118,14 @@ static float gTargetAngle = 0.0f;
 static float gAngle       = 0.0f;
 
 static std::vector<std::string> gMaterialNames = {};
+static uint32_t                 gMaterialIndex = 0;
 
 static uint32_t                 gNumLights  = 4;
-static const uint32_t           gMaxIBLs    = 32;
-static uint32_t                 gIBLIndex   = 0;
-static std::vector<std::string> gIBLNames   = {};
-static uint32_t                 gModelIndex = 0;
+static const uint32_t           gMaxIBLs         = 32;
+static const uint64_t           gIBLMemoryBudget = 1024 * 1024 * 1024; // RGBA16F environment maps, about 8 at 4k
+static uint32_t                 gIBLIndex        = 0;
+static std::vector<std::string> gIBLNames        = {};
+static uint32_t                 gModelIndex      = 0;
 
 void CreatePBRRootSig(DxRenderer* pRenderer, ID3D12RootSignature** ppRootSig);
 void CreateEnvironmentRootSig(DxRenderer* pRenderer, ID3D12RootSignature** ppRootSig);
@@ -122,21 +135,32 @@ void CreateEnvironmentVertexBuffers(
 void CreateMaterialModels(
     DxRenderer*                   pRenderer,
     std::vector<GeometryBuffers>& outGeomtryBuffers);
-void CreateIBLTextures(
+void CreateBRDFLUTs(
+    DxRenderer*      pRenderer,
+    ID3D12Resource** ppBRDFLUT,
+    ID3D12Resource** ppMultiscatterBRDFLUT);
+void ApplyIBLUpdate(
     DxRenderer*                          pRenderer,
-    ID3D12Resource**                     ppBRDFLUT,
-    ID3D12Resource**                     ppMultiscatterBRDFLUT,
-    std::vector<ComPtr<ID3D12Resource>>& outIrradianceTextures,
-    std::vector<ComPtr<ID3D12Resource>>& outEnvironmentTextures,
-    std::vector<uint32_t>&               outEnvNumLevels);
+    const IBLUpdate&                     update,
+    std::vector<ComPtr<ID3D12Resource>>& irrTextures,
+    std::vector<ComPtr<ID3D12Resource>>& envTextures,
+    std::vector<uint32_t>&               envNumLevels);
 void CreateMaterials(
     DxRenderer*                      pRenderer,
+    TextureLoader*                   pTextureLoader,
     MaterialTextures&                outDefaultMaterialTextures,
     std::vector<MaterialTextures>&   outMaterialTexturesSets,
     std::vector<MaterialParameters>& outMaterialParametersSets);
 void CreateDescriptorHeap(
     DxRenderer*            pRenderer,
     ID3D12DescriptorHeap** ppHeap);
+void WriteIBLDescriptors(
+    DxRenderer*           pRenderer,
+    ID3D12DescriptorHeap* pDescriptorHeap,
+    uint32_t              iblIndex,
+    ID3D12Resource*       pIrrTexture,
+    ID3D12Resource*       pEnvTexture,
+    uint32_t              envNumLevels);
 
 void MouseMove(int x, int y, int buttons)
 {
@@ -307,27 +331,48 @@ int main(int argc, char** argv)
     // *************************************************************************
     // Environment texture
     // *************************************************************************
-    ComPtr<ID3D12Resource>              brdfLUT;
-    ComPtr<ID3D12Resource>              multiscatterBRDFLUT;
-    std::vector<ComPtr<ID3D12Resource>> irrTextures;
-    std::vector<ComPtr<ID3D12Resource>> envTextures;
-    std::vector<uint32_t>               envNumLevels;
-    CreateIBLTextures(
+    ComPtr<ID3D12Resource> brdfLUT;
+    ComPtr<ID3D12Resource> multiscatterBRDFLUT;
+    CreateBRDFLUTs(
         renderer.get(),
         &brdfLUT,
-        &multiscatterBRDFLUT,
-        irrTextures,
-        envTextures,
-        envNumLevels);
+        &multiscatterBRDFLUT);
+
+    // Only the selected IBL is loaded, others are loaded when they're
+    // selected and evicted when they go over the budget
+    IBLResidency iblResidency(
+        FindIBLFiles(gMaxIBLs),
+        BCEncodeOptions().Format(GREX_FORMAT_R16G16B16A16_FLOAT),
+        gIBLMemoryBudget);
+    for (uint32_t i = 0; i < iblResidency.GetCount(); ++i)
+    {
+        gIBLNames.push_back(iblResidency.GetName(i));
+    }
+
+    std::vector<ComPtr<ID3D12Resource>> irrTextures(iblResidency.GetCount());
+    std::vector<ComPtr<ID3D12Resource>> envTextures(iblResidency.GetCount());
+    std::vector<uint32_t>               envNumLevels(iblResidency.GetCount());
+    iblResidency.Select(gIBLIndex);
+    iblResidency.WaitForSelected();
+    for (auto& update : iblResidency.TakeUpdates())
+    {
+        ApplyIBLUpdate(renderer.get(), update, irrTextures, envTextures, envNumLevels);
+    }
 
     // *************************************************************************
     // Material texture
+    //
+    // Materials start out with the default textures, the real ones are
+    // loaded in the background and swapped in by the main loop as they
+    // finish.
     // *************************************************************************
+    TextureLoader                   textureLoader;
     MaterialTextures                defaultMaterialTextures;
     std::vector<MaterialTextures>   materialTexturesSets;
     std::vector<MaterialParameters> materialParametersSets;
     CreateMaterials(
         renderer.get(),
+        &textureLoader,
         defaultMaterialTextures,
         materialTexturesSets,
         materialParametersSets);
@@ -359,20 +404,10 @@ int main(int argc, char** argv)
         descriptor = {heapStart.ptr + IBL_INTEGRATION_MS_LUT_DESCRIPTOR_OFFSET * incSize};
         CreateDescriptorTexture2D(renderer.get(), multiscatterBRDFLUT.Get(), descriptor);
 
-        // IBLIrradianceMaps (t16)
-        descriptor = {heapStart.ptr + IBL_IRRADIANCE_MAPS_DESCRIPTOR_OFFSET * incSize};
-        for (size_t i = 0; i < irrTextures.size(); ++i)
-        {
-            CreateDescriptorTexture2D(renderer.get(), irrTextures[i].Get(), descriptor);
-            descriptor.ptr += incSize;
-        }
-
-        // IBLEnvironmentMaps (t48)
-        descriptor = {heapStart.ptr + IBL_ENVIRONMENT_MAPS_DESCRIPTOR_OFFSET * incSize};
-        for (size_t i = 0; i < irrTextures.size(); ++i)
+        // IBLIrradianceMaps (t16) and IBLEnvironmentMaps (t48)
+        for (uint32_t i = 0; i < CountU32(irrTextures); ++i)
         {
-            CreateDescriptorTexture2D(renderer.get(), envTextures[i].Get(), descriptor, 0, envNumLevels[i]);
-            descriptor.ptr += incSize;
+            WriteIBLDescriptors(renderer.get(), descriptorHeap.Get(), i, irrTextures[i].Get(), envTextures[i].Get(), envNumLevels[i]);
         }
 
         // Material textures
@@ -483,6 +518,43 @@ int main(int argc, char** argv)
     // *************************************************************************
     while (window->PollEvents())
     {
+        // Swap in material textures that finished loading. The GPU is
+        // waited on at the end of every frame so the descriptors aren't
+        // in use.
+        for (auto& loaded : textureLoader.TakeCompleted())
+        {
+            if (!loaded.loaded)
+            {
+                assert(false && "Failed to load texture!");
+                continue;
+            }
+
+            MaterialTextures&       materialTextures   = materialTexturesSets[loaded.group];
+            ComPtr<ID3D12Resource>* textureResources[] = {
+                &materialTextures.baseColorTexture,
+                &materialTextures.normalTexture,
+                &materialTextures.roughnessTexture,
+                &materialTextures.metallicTexture};
+
+            ComPtr<ID3D12Resource>* pTargetTexture = textureResources[loaded.slot];
+            CHECK_CALL(CreateTexture(
+                renderer.get(),
+                loaded.width,
+                loaded.height,
+                ToDxFormat(loaded.format),
+                loaded.mipOffsets,
+                loaded.GetSizeInBytes(),
+                loaded.GetData(),
+                &(*pTargetTexture)));
+
+            const UINT                  descriptorIndex = MATERIAL_TEXTURES_DESCRIPTOR_OFFSET + loaded.group * MATERIAL_TEXTURE_STRIDE + loaded.slot;
+            D3D12_CPU_DESCRIPTOR_HANDLE descriptor      = descriptorHeap->GetCPUDescriptorHandleForHeapStart();
+            descriptor.ptr += descriptorIndex * renderer->Device->GetDescriptorHandleIncrementSize(D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV);
+            CreateDescriptorTexture2D(renderer.get(), pTargetTexture->Get(), descriptor, 0, loaded.GetNumLevels());
+
+            GREX_LOG_INFO("Created texture from " << loaded.path);
+        }
+
         window->ImGuiNewFrameD3D12();
 
         if (ImGui::Begin("Scene"))
@@ -516,8 +588,9 @@ int main(int argc, char** argv)
                     bool isSelected = (currentIBLName == gIBLNames[i]);
                     if (ImGui::Selectable(gIBLNames[i].c_str(), isSelected))
                     {
-                        currentIBLName         = gIBLNames[i].c_str();
-                        pSceneParams->iblIndex = static_cast<uint32_t>(i);
+                        currentIBLName = gIBLNames[i].c_str();
+                        gIBLIndex      = static_cast<uint32_t>(i);
+                        iblResidency.Select(gIBLIndex);
                     }
                     if (isSelected)
                     {
@@ -555,6 +628,34 @@ int main(int argc, char** argv)
 
         if (ImGui::Begin("Material Parameters"))
         {
+            // Textures of the selected material are loaded first
+            const char* currentMaterialName = gMaterialNames[gMaterialIndex].c_str();
+            if (ImGui::BeginCombo("Selected", currentMaterialName))
+            {
+                for (uint32_t matIdx = 0; matIdx < gMaterialNames.size(); ++matIdx)
+                {
+                    bool isSelected = (matIdx == gMaterialIndex);
+                    if (ImGui::Selectable(gMaterialNames[matIdx].c_str(), isSelected))
+                    {
+                        gMaterialIndex = matIdx;
+                        textureLoader.Prioritize(gMaterialIndex);
+                    }
+                    if (isSelected)
+                    {
+                        ImGui::SetItemDefaultFocus();
+                    }
+                }
+                ImGui::EndCombo();
+            }
+
+            const uint32_t numPendingTextures = textureLoader.GetNumPending();
+            if (numPendingTextures > 0)
+            {
+                ImGui::Text("Loading %u textures", numPendingTextures);
+            }
+
+            ImGui::Separator();
+
             for (uint32_t matIdx = 0; matIdx < gMaterialNames.size(); ++matIdx)
             {
                 if (ImGui::TreeNodeEx(gMaterialNames[matIdx].c_str(), ImGuiTreeNodeFlags_DefaultOpen))
@@ -571,6 +672,30 @@ int main(int argc, char** argv)
 
         // ---------------------------------------------------------------------
 
+        // Apply IBL loads and evictions, the GPU is waited on at the end
+        // of every frame so evicted textures and their descriptors aren't
+        // in use
+        for (auto& update : iblResidency.TakeUpdates())
+        {
+            ApplyIBLUpdate(renderer.get(), update, irrTextures, envTextures, envNumLevels);
+
+            WriteIBLDescriptors(
+                renderer.get(),
+                descriptorHeap.Get(),
+                update.index,
+                irrTextures[update.index].Get(),
+                envTextures[update.index].Get(),
+                envNumLevels[update.index]);
+        }
+
+        // Switch over once the selected IBL has at least its fallback
+        if (irrTextures[gIBLIndex])
+        {
+            pSceneParams->iblIndex = gIBLIndex;
+        }
+
+        // ---------------------------------------------------------------------
+
         UINT bufferIndex = renderer->Swapchain->GetCurrentBackBufferIndex();
 
         ComPtr<ID3D12Resource> swapchainBuffer;
@@ -618,7 +743,7 @@ int main(int argc, char** argv)
             //
             pSceneParams->viewProjectionMatrix = projMat * viewMat;
             pSceneParams->eyePosition          = eyePosition;
-            pSceneParams->iblNumEnvLevels      = envNumLevels[gIBLIndex];
+            pSceneParams->iblNumEnvLevels      = envNumLevels[pSceneParams->iblIndex];
 
             // Draw environment
             {
@@ -1440,13 +1565,10 @@ void CreateMaterialModels(
     }
 }
 
-void CreateIBLTextures(
-    DxRenderer*                          pRenderer,
-    ID3D12Resource**                     ppBRDFLUT,
-    ID3D12Resource**                     ppMultiscatterBRDFLUT,
-    std::vector<ComPtr<ID3D12Resource>>& outIrradianceTextures,
-    std::vector<ComPtr<ID3D12Resource>>& outEnvironmentTextures,
-    std::vector<uint32_t>&               outEnvNumLevels)
+void CreateBRDFLUTs(
+    DxRenderer*      pRenderer,
+    ID3D12Resource** ppBRDFLUT,
+    ID3D12Resource** ppMultiscatterBRDFLUT)
 {
     // BRDF LUT
     {
@@ -1487,96 +1609,63 @@ void CreateIBLTextures(
             bitmap.GetPixels(),
             ppMultiscatterBRDFLUT));
     }
+}
 
-    auto                               iblDir = GetAssetPath("IBL");
-    std::vector<std::filesystem::path> iblFiles;
-    for (auto& entry : std::filesystem::directory_iterator(iblDir))
-    {
-        if (!entry.is_regular_file())
-        {
-            continue;
-        }
-        auto path = entry.path();
-        auto ext  = path.extension();
-        if (ext == ".ibl")
-        {
-            path = std::filesystem::relative(path, iblDir.parent_path());
-            iblFiles.push_back(path);
-        }
-    }
-
-    size_t maxEntries = std::min<size_t>(gMaxIBLs, iblFiles.size());
-    for (size_t i = 0; i < maxEntries; ++i)
+void ApplyIBLUpdate(
+    DxRenderer*                          pRenderer,
+    const IBLUpdate&                     update,
+    std::vector<ComPtr<ID3D12Resource>>& irrTextures,
+    std::vector<ComPtr<ID3D12Resource>>& envTextures,
+    std::vector<uint32_t>&               envNumLevels)
+{
+    // The irradiance map stands in for the environment map until it's
+    // resident, envNumLevels is for whichever one is bound
+    switch (update.type)
     {
-        std::filesystem::path iblFile = iblFiles[i];
-
-        IBLMaps ibl = {};
-        if (!LoadIBLMaps32f(iblFile, &ibl))
+        case IBL_UPDATE_FALLBACK:
         {
-            GREX_LOG_ERROR("failed to load: " << iblFile);
-            assert(false && "IBL maps load failed failed");
-            return;
-        }
-
-        outEnvNumLevels.push_back(ibl.numLevels);
-
-        // Irradiance
-        {
-            ComPtr<ID3D12Resource> texture;
             CHECK_CALL(CreateTexture(
                 pRenderer,
-                ibl.irradianceMap.GetWidth(),
-                ibl.irradianceMap.GetHeight(),
+                update.irradianceMap.GetWidth(),
+                update.irradianceMap.GetHeight(),
                 DXGI_FORMAT_R32G32B32A32_FLOAT,
-                ibl.irradianceMap.GetSizeInBytes(),
-                ibl.irradianceMap.GetPixels(),
-                &texture));
-            outIrradianceTextures.push_back(texture);
+                update.irradianceMap.GetSizeInBytes(),
+                update.irradianceMap.GetPixels(),
+                &irrTextures[update.index]));
+
+            envNumLevels[update.index] = 1;
         }
+        break;
 
-        // Environment
+        case IBL_UPDATE_ENVIRONMENT:
         {
-            const uint32_t pixelStride = ibl.environmentMap.GetPixelStride();
-            const uint32_t rowStride   = ibl.environmentMap.GetRowStride();
-
-            std::vector<MipOffset> mipOffsets;
-            uint32_t               levelOffset = 0;
-            uint32_t               levelWidth  = ibl.baseWidth;
-            uint32_t               levelHeight = ibl.baseHeight;
-            for (uint32_t i = 0; i < ibl.numLevels; ++i)
-            {
-                MipOffset mipOffset = {};
-                mipOffset.Offset    = levelOffset;
-                mipOffset.RowStride = rowStride;
-
-                mipOffsets.push_back(mipOffset);
-
-                levelOffset += (rowStride * levelHeight);
-                levelWidth >>= 1;
-                levelHeight >>= 1;
-            }
-
-            ComPtr<ID3D12Resource> texture;
             CHECK_CALL(CreateTexture(
                 pRenderer,
-                ibl.baseWidth,
-                ibl.baseHeight,
-                DXGI_FORMAT_R32G32B32A32_FLOAT,
-                mipOffsets,
-                ibl.environmentMap.GetSizeInBytes(),
-                ibl.environmentMap.GetPixels(),
-                &texture));
-            outEnvironmentTextures.push_back(texture);
+                update.width,
+                update.height,
+                ToDxFormat(update.format),
+                update.mipOffsets,
+                update.GetSizeInBytes(),
+                update.GetData(),
+                &envTextures[update.index]));
+
+            envNumLevels[update.index] = update.GetNumLevels();
         }
+        break;
 
-        gIBLNames.push_back(iblFile.filename().replace_extension().string());
+        case IBL_UPDATE_EVICT:
+        {
+            envTextures[update.index].Reset();
 
-        GREX_LOG_INFO("Loaded " << iblFile);
+            envNumLevels[update.index] = 1;
+        }
+        break;
     }
 }
 
 void CreateMaterials(
     DxRenderer*                      pRenderer,
+    TextureLoader*                   pTextureLoader,
     MaterialTextures&                outDefaultMaterialTextures,
     std::vector<MaterialTextures>&   outMaterialTexturesSets,
     std::vector<MaterialParameters>& outMaterialParametersSets)
@@ -1632,30 +1721,37 @@ void CreateMaterials(
 
         while (!is.eof())
         {
-            ComPtr<ID3D12Resource>* pTargetTexture = nullptr;
-            std::filesystem::path   textureFile    = "";
+            MaterialTextureSlot   slot        = MATERIAL_TEXTURE_SLOT_BASE_COLOR;
+            std::filesystem::path textureFile = "";
+            MipmapContent         mipContent  = MIPMAP_CONTENT_DATA;
+            GREXFormat            bcFormat    = GREX_FORMAT_BC4_R;
 
             std::string key;
             is >> key;
             if (key == "basecolor")
             {
                 is >> textureFile;
-                pTargetTexture = &materialTextures.baseColorTexture;
+                slot           = MATERIAL_TEXTURE_SLOT_BASE_COLOR;
+                mipContent     = MIPMAP_CONTENT_COLOR_SRGB;
+                bcFormat       = GREX_FORMAT_BC7_RGBA;
             }
             else if (key == "normal")
             {
                 is >> textureFile;
-                pTargetTexture = &materialTextures.normalTexture;
+                slot           = MATERIAL_TEXTURE_SLOT_NORMAL;
+                mipContent     = MIPMAP_CONTENT_NORMAL;
+                bcFormat       = GREX_FORMAT_BC7_RGBA;
             }
             else if (key == "roughness")
             {
                 is >> textureFile;
-                pTargetTexture = &materialTextures.roughnessTexture;
+                slot           = MATERIAL_TEXTURE_SLOT_ROUGHNESS;
+                mipContent     = MIPMAP_CONTENT_ROUGHNESS;
             }
             else if (key == "metallic")
             {
                 is >> textureFile;
-                pTargetTexture = &materialTextures.metallicTexture;
+                slot           = MATERIAL_TEXTURE_SLOT_METALLIC;
             }
             else if (key == "specular")
             {
@@ -1670,41 +1766,19 @@ void CreateMaterials(
             auto cwd    = materialFile.parent_path().filename();
             textureFile = "textures" / cwd / textureFile;
 
-            auto bitmap = LoadImage8u(textureFile);
-            if (!bitmap.Empty())
-            {
-                MipmapRGBA8u mipmap = MipmapRGBA8u(
-                    bitmap,
-                    BITMAP_SAMPLE_MODE_WRAP,
-                    BITMAP_SAMPLE_MODE_WRAP,
-                    BITMAP_FILTER_MODE_NEAREST);
-
-                std::vector<MipOffset> mipOffsets;
-                for (auto& srcOffset : mipmap.GetOffsets())
-                {
-                    MipOffset dstOffset = {};
-                    dstOffset.Offset    = srcOffset;
-                    dstOffset.RowStride = mipmap.GetRowStride();
-                    mipOffsets.push_back(dstOffset);
-                }
-
-                CHECK_CALL(CreateTexture(
-                    pRenderer,
-                    mipmap.GetWidth(0),
-                    mipmap.GetHeight(0),
-                    DXGI_FORMAT_R8G8B8A8_UNORM,
-                    mipOffsets,
-                    mipmap.GetSizeInBytes(),
-                    mipmap.GetPixels(),
-                    &(*pTargetTexture)));
-
-                GREX_LOG_INFO("Created texture from " << textureFile);
-            }
-            else
-            {
-                GREX_LOG_ERROR("Failed to load: " << textureFile);
-                assert(false && "Failed to load texture!");
-            }
+            // Color and normals to BC7, single channel maps to BC4. Levels are laid
+            // out the way CopyTextureRegion expects them.
+            pTextureLoader->Submit(
+                TextureLoadRequest()
+                    .Path(textureFile)
+                    .Group(static_cast<uint32_t>(i))
+                    .Slot(slot)
+                    .MipOptions(MipmapOptions().Content(mipContent).ModeU(BITMAP_SAMPLE_MODE_WRAP).ModeV(BITMAP_SAMPLE_MODE_WRAP))
+                    .EncodeOptions(BCEncodeOptions()
+                                       .Format(bcFormat)
+                                       .Quality(BC_QUALITY_FAST)
+                                       .RowStrideAlignment(D3D12_TEXTURE_DATA_PITCH_ALIGNMENT)
+                                       .OffsetAlignment(D3D12_TEXTURE_DATA_PLACEMENT_ALIGNMENT)));
         }
 
         outMaterialTexturesSets.push_back(materialTextures);
@@ -1728,3 +1802,29 @@ void CreateDescriptorHeap(
         &desc,
         IID_PPV_ARGS(ppHeap)));
 }
+
+void WriteIBLDescriptors(
+    DxRenderer*           pRenderer,
+    ID3D12DescriptorHeap* pDescriptorHeap,
+    uint32_t              iblIndex,
+    ID3D12Resource*       pIrrTexture,
+    ID3D12Resource*       pEnvTexture,
+    uint32_t              envNumLevels)
+{
+    // IBLs that were never selected have neither texture
+    if (IsNull(pIrrTexture))
+    {
+        return;
+    }
+
+    D3D12_CPU_DESCRIPTOR_HANDLE heapStart = pDescriptorHeap->GetCPUDescriptorHandleForHeapStart();
+    auto                        incSize   = pRenderer->Device->GetDescriptorHandleIncrementSize(D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV);
+
+    // IBLIrradianceMaps (t16)
+    D3D12_CPU_DESCRIPTOR_HANDLE descriptor = {heapStart.ptr + (IBL_IRRADIANCE_MAPS_DESCRIPTOR_OFFSET + iblIndex) * incSize};
+    CreateDescriptorTexture2D(pRenderer, pIrrTexture, descriptor);
+
+    // IBLEnvironmentMaps (t48), the irradiance map until it's resident
+    descriptor = {heapStart.ptr + (IBL_ENVIRONMENT_MAPS_DESCRIPTOR_OFFSET + iblIndex) * incSize};
+    CreateDescriptorTexture2D(pRenderer, IsNull(pEnvTexture) ? pIrrTexture : pEnvTexture, descriptor, 0, envNumLevels);
+}
@@ -2,6 +2,8 @@
 
 #include "mtl_renderer.h"
 #include "bitmap.h"
+#include "ibl_residency.h"
+#include "texture_loader.h"
 #include "tri_mesh.h"
 
 #include <glm/glm.hpp>
@@ -88,6 +90,15 @@ struct MaterialTextures
     MetalTexture metallicTexture;
 };
 
+// Same order as MaterialTextures and the shader's texture array
+enum MaterialTextureSlot
+{
+    MATERIAL_TEXTURE_SLOT_BASE_COLOR = 0,
+    MATERIAL_TEXTURE_SLOT_NORMAL     = 1,
+    MATERIAL_TEXTURE_SLOT_ROUGHNESS  = 2,
+    MATERIAL_TEXTURE_SLOT_METALLIC   = 3,
+};
+
 struct GeometryBuffers
 {
     uint32_t    numIndices;
@@ -121,12 +132,14 @@ static float gTargetAngle = 0.0f;
 static float gAngle       = 0.0f;
 
 static std::vector<std::string> gMaterialNames = {};
+static uint32_t                 gMaterialIndex = 0;
 
-static uint32_t                 gNumLights  = 4;
-static const uint32_t           gMaxIBLs    = MAX_IBLS;
-static uint32_t                 gIBLIndex   = 0;
-static std::vector<std::string> gIBLNames   = {};
-static uint32_t                 gModelIndex = 0;
+static uint32_t                 gNumLights       = 4;
+static const uint32_t           gMaxIBLs         = MAX_IBLS;
+static const uint64_t           gIBLMemoryBudget = 1024 * 1024 * 1024; // RGBA16F environment maps, about 8 at 4k
+static uint32_t                 gIBLIndex        = 0;
+static std::vector<std::string> gIBLNames        = {};
+static uint32_t                 gModelIndex      = 0;
 
 void CreateEnvironmentVertexBuffers(
     MetalRenderer*   pRenderer,
@@ -134,15 +147,19 @@ void CreateEnvironmentVertexBuffers(
 void CreateMaterialModels(
     MetalRenderer*                pRenderer,
     std::vector<GeometryBuffers>& outGeomtryBuffers);
-void CreateIBLTextures(
+void CreateBRDFLUTs(
+    MetalRenderer* pRenderer,
+    MetalTexture*  pBRDFLUT,
+    MetalTexture*  pMultiscatterBRDFLUT);
+void ApplyIBLUpdate(
     MetalRenderer*             pRenderer,
-    MetalTexture*              pBRDFLUT,
-    MetalTexture*              pMultiscatterBRDFLUT,
-    std::vector<MetalTexture>& outIrradianceTextures,
-    std::vector<MetalTexture>& outEnvironmentTextures,
-    std::vector<uint32_t>&     outEnvNumLevels);
+    const IBLUpdate&           update,
+    std::vector<MetalTexture>& irrTextures,
+    std::vector<MetalTexture>& envTextures,
+    std::vector<uint32_t>&     envNumLevels);
 void CreateMaterials(
     MetalRenderer*                   pRenderer,
+    TextureLoader*                   pTextureLoader,
     MaterialTextures&                outDefaultMaterialTextures,
     std::vector<MaterialTextures>&   outMaterialTexturesSets,
     std::vector<MaterialParameters>& outMaterialParametersSets);
@@ -309,21 +326,45 @@ int main(int argc, char** argv)
     // *************************************************************************
     // Environment texture
     // *************************************************************************
-    MetalTexture              brdfLUT;
-    MetalTexture              multiscatterBRDFLUT;
-    std::vector<MetalTexture> irrTextures;
-    std::vector<MetalTexture> envTextures;
-    std::vector<uint32_t>     envNumLevels;
-    CreateIBLTextures(renderer.get(), &brdfLUT, &multiscatterBRDFLUT, irrTextures, envTextures, envNumLevels);
+    MetalTexture brdfLUT;
+    MetalTexture multiscatterBRDFLUT;
+    CreateBRDFLUTs(renderer.get(), &brdfLUT, &multiscatterBRDFLUT);
+
+    // Only the selected IBL is loaded, others are loaded when they're
+    // selected and evicted when they go over the budget
+    IBLResidency iblResidency(
+        FindIBLFiles(gMaxIBLs),
+        BCEncodeOptions().Format(GREX_FORMAT_R16G16B16A16_FLOAT),
+        gIBLMemoryBudget);
+    for (uint32_t i = 0; i < iblResidency.GetCount(); ++i)
+    {
+        gIBLNames.push_back(iblResidency.GetName(i));
+    }
+
+    std::vector<MetalTexture> irrTextures(iblResidency.GetCount());
+    std::vector<MetalTexture> envTextures(iblResidency.GetCount());
+    std::vector<uint32_t>     envNumLevels(iblResidency.GetCount());
+    iblResidency.Select(gIBLIndex);
+    iblResidency.WaitForSelected();
+    for (auto& update : iblResidency.TakeUpdates())
+    {
+        ApplyIBLUpdate(renderer.get(), update, irrTextures, envTextures, envNumLevels);
+    }
 
     // *************************************************************************
     // Material texture
+    //
+    // Materials start out with the default textures, the real ones are
+    // loaded in the background and swapped in by the main loop as they
+    // finish.
     // *************************************************************************
+    TextureLoader                   textureLoader;
     MaterialTextures                defaultMaterialTextures;
     std::vector<MaterialTextures>   materialTexturesSets;
     std::vector<MaterialParameters> materialParametersSets;
     CreateMaterials(
         renderer.get(),
+        &textureLoader,
         defaultMaterialTextures,
         materialTexturesSets,
         materialParametersSets);
@@ -341,11 +382,15 @@ int main(int argc, char** argv)
     // *************************************************************************
     // Texture Arrays
     // *************************************************************************
-    MTL::Buffer*               pbrIBLTexturesArgBuffer = nullptr;
-    std::vector<MTL::Texture*> iblEnvTextures;
+    // IBLs - the encoder is kept to swap in textures as they're loaded and
+    // evicted. The environment entries are the irradiance maps until the
+    // environment maps are resident.
+    MTL::Buffer*               pbrIBLTexturesArgBuffer  = nullptr;
+    MTL::ArgumentEncoder*      pbrIBLTexturesArgEncoder = nullptr;
+    std::vector<MTL::Texture*> iblEnvTextures(gMaxIBLs);
 
     {
-        MTL::ArgumentEncoder* pbrIBLTexturesArgEncoder = pbrFsShader.Function->newArgumentEncoder(5);
+        pbrIBLTexturesArgEncoder = pbrFsShader.Function->newArgumentEncoder(5);
 
         pbrIBLTexturesArgBuffer = renderer->Device->newBuffer(pbrIBLTexturesArgEncoder->encodedLength(), MTL::ResourceStorageModeManaged);
 
@@ -363,20 +408,19 @@ int main(int argc, char** argv)
         // Environment
         for (size_t i = 0; i < envTextures.size(); ++i)
         {
-            iblEnvTextures.push_back(envTextures[i].Texture.get());
-            pbrIBLTexturesArgEncoder->setTexture(envTextures[i].Texture.get(), 2 + MAX_IBLS + i);
+            iblEnvTextures[i] = envTextures[i].Texture ? envTextures[i].Texture.get() : irrTextures[i].Texture.get();
+            pbrIBLTexturesArgEncoder->setTexture(iblEnvTextures[i], 2 + MAX_IBLS + i);
         }
 
         pbrIBLTexturesArgBuffer->didModifyRange(NS::Range::Make(0, pbrIBLTexturesArgBuffer->length()));
-
-        pbrIBLTexturesArgEncoder->release();
     }
 
-    // Materials
-    MTL::Buffer* pbrEnvMaterialTexturesArgBuffer = nullptr;
+    // Materials - the encoder is kept to swap in textures as they finish loading
+    MTL::Buffer*          pbrEnvMaterialTexturesArgBuffer  = nullptr;
+    MTL::ArgumentEncoder* pbrEnvMaterialTexturesArgEncoder = nullptr;
 
     {
-        MTL::ArgumentEncoder* pbrEnvMaterialTexturesArgEncoder = pbrFsShader.Function->newArgumentEncoder(6);
+        pbrEnvMaterialTexturesArgEncoder = pbrFsShader.Function->newArgumentEncoder(6);
 
         pbrEnvMaterialTexturesArgBuffer = renderer->Device->newBuffer(pbrEnvMaterialTexturesArgEncoder->encodedLength(), MTL::ResourceStorageModeManaged);
 
@@ -393,8 +437,6 @@ int main(int argc, char** argv)
         }
 
         pbrEnvMaterialTexturesArgBuffer->didModifyRange(NS::Range::Make(0, pbrEnvMaterialTexturesArgBuffer->length()));
-
-        pbrEnvMaterialTexturesArgEncoder->release();
     }
 
     // *************************************************************************
@@ -463,11 +505,89 @@ int main(int argc, char** argv)
     // *************************************************************************
     // Main loop
     // *************************************************************************
-    MTL::ClearColor clearColor(0.23f, 0.23f, 0.31f, 0);
-    uint32_t        frameIndex = 0;
+    MTL::ClearColor                   clearColor(0.23f, 0.23f, 0.31f, 0);
+    uint32_t                          frameIndex = 0;
+    NS::SharedPtr<MTL::CommandBuffer> lastCommandBuffer;
 
     while (window->PollEvents())
     {
+        // Swap in material textures that finished loading
+        std::vector<LoadedTexture> loadedTextures = textureLoader.TakeCompleted();
+        if (!loadedTextures.empty())
+        {
+            // Frames aren't waited on, wait for the last one before the
+            // argument buffer and the textures it points to change
+            if (lastCommandBuffer)
+            {
+                lastCommandBuffer->waitUntilCompleted();
+            }
+
+            for (auto& loaded : loadedTextures)
+            {
+                if (!loaded.loaded)
+                {
+                    assert(false && "Failed to load texture!");
+                    continue;
+                }
+
+                MaterialTextures& materialTextures = materialTexturesSets[loaded.group];
+                MetalTexture*     textures[]       = {
+                    &materialTextures.baseColorTexture,
+                    &materialTextures.normalTexture,
+                    &materialTextures.roughnessTexture,
+                    &materialTextures.metallicTexture};
+
+                MetalTexture* pTargetTexture = textures[loaded.slot];
+                CHECK_CALL(CreateTexture(
+                    renderer.get(),
+                    loaded.width,
+                    loaded.height,
+                    ToMTLFormat(loaded.format),
+                    loaded.mipOffsets,
+                    loaded.GetSizeInBytes(),
+                    loaded.GetData(),
+                    pTargetTexture));
+
+                pbrEnvMaterialTexturesArgEncoder->setTexture(pTargetTexture->Texture.get(), loaded.group * MATERIAL_TEXTURE_STRIDE + loaded.slot);
+
+                GREX_LOG_INFO("Created texture from " << loaded.path);
+            }
+
+            pbrEnvMaterialTexturesArgBuffer->didModifyRange(NS::Range::Make(0, pbrEnvMaterialTexturesArgBuffer->length()));
+        }
+
+        // Apply IBL loads and evictions
+        std::vector<IBLUpdate> iblUpdates = iblResidency.TakeUpdates();
+        if (!iblUpdates.empty())
+        {
+            // Same as above, evicted textures can't be released while the
+            // last frame uses them
+            if (lastCommandBuffer)
+            {
+                lastCommandBuffer->waitUntilCompleted();
+            }
+
+            for (auto& update : iblUpdates)
+            {
+                ApplyIBLUpdate(renderer.get(), update, irrTextures, envTextures, envNumLevels);
+
+                MetalTexture& irrTexture = irrTextures[update.index];
+                MetalTexture& envTexture = envTextures[update.index];
+
+                iblEnvTextures[update.index] = envTexture.Texture ? envTexture.Texture.get() : irrTexture.Texture.get();
+                pbrIBLTexturesArgEncoder->setTexture(irrTexture.Texture.get(), 2 + update.index);
+                pbrIBLTexturesArgEncoder->setTexture(iblEnvTextures[update.index], 2 + MAX_IBLS + update.index);
+            }
+
+            pbrIBLTexturesArgBuffer->didModifyRange(NS::Range::Make(0, pbrIBLTexturesArgBuffer->length()));
+        }
+
+        // Switch over once the selected IBL has at least its fallback
+        if (irrTextures[gIBLIndex].Texture)
+        {
+            sceneParams.iblIndex = gIBLIndex;
+        }
+
         window->ImGuiNewFrameMetal(pRenderPassDescriptor);
 
         if (ImGui::Begin("Scene"))
@@ -501,8 +621,9 @@ int main(int argc, char** argv)
                     bool isSelected = (currentIBLName == gIBLNames[i]);
                     if (ImGui::Selectable(gIBLNames[i].c_str(), isSelected))
                     {
-                        currentIBLName       = gIBLNames[i].c_str();
-                        sceneParams.iblIndex = static_cast<uint32_t>(i);
+                        currentIBLName = gIBLNames[i].c_str();
+                        gIBLIndex      = static_cast<uint32_t>(i);
+                        iblResidency.Select(gIBLIndex);
                     }
                     if (isSelected)
                     {
@@ -540,6 +661,34 @@ int main(int argc, char** argv)
 
         if (ImGui::Begin("Material Parameters"))
         {
+            // Textures of the selected material are loaded first
+            const char* currentMaterialName = gMaterialNames[gMaterialIndex].c_str();
+            if (ImGui::BeginCombo("Selected", currentMaterialName))
+            {
+                for (uint32_t matIdx = 0; matIdx < gMaterialNames.size(); ++matIdx)
+                {
+                    bool isSelected = (matIdx == gMaterialIndex);
+                    if (ImGui::Selectable(gMaterialNames[matIdx].c_str(), isSelected))
+                    {
+                        gMaterialIndex = matIdx;
+                        textureLoader.Prioritize(gMaterialIndex);
+                    }
+                    if (isSelected)
+                    {
+                        ImGui::SetItemDefaultFocus();
+                    }
+                }
+                ImGui::EndCombo();
+            }
+
+            const uint32_t numPendingTextures = textureLoader.GetNumPending();
+            if (numPendingTextures > 0)
+            {
+                ImGui::Text("Loading %u textures", numPendingTextures);
+            }
+
+            ImGui::Separator();
+
             for (uint32_t matIdx = 0; matIdx < gMaterialNames.size(); ++matIdx)
             {
                 if (ImGui::TreeNodeEx(gMaterialNames[matIdx].c_str(), ImGuiTreeNodeFlags_DefaultOpen))
@@ -597,7 +746,7 @@ int main(int argc, char** argv)
         // Set scene params values that required calculation
         sceneParams.viewProjectionMatrix = projMat * viewMat;
         sceneParams.eyePosition          = eyePosition;
-        sceneParams.iblNumEnvLevels      = envNumLevels[gIBLIndex];
+        sceneParams.iblNumEnvLevels      = envNumLevels[sceneParams.iblIndex];
 
         // Draw environment
         {
@@ -669,13 +818,19 @@ int main(int argc, char** argv)
                 // Irradiance
                 for (size_t i = 0; i < irrTextures.size(); ++i)
                 {
-                    pRenderEncoder->useResource(irrTextures[i].Texture.get(), MTL::ResourceUsageRead);
+                    if (irrTextures[i].Texture)
+                    {
+                        pRenderEncoder->useResource(irrTextures[i].Texture.get(), MTL::ResourceUsageRead);
+                    }
                 }
 
                 // Environment
                 for (size_t i = 0; i < envTextures.size(); ++i)
                 {
-                    pRenderEncoder->useResource(envTextures[i].Texture.get(), MTL::ResourceUsageRead);
+                    if (envTextures[i].Texture)
+                    {
+                        pRenderEncoder->useResource(envTextures[i].Texture.get(), MTL::ResourceUsageRead);
+                    }
                 }
 
                 for (size_t i = 0; i < materialTexturesSets.size(); ++i)
@@ -1185,6 +1340,8 @@ int main(int argc, char** argv)
 
         pCommandBuffer->presentDrawable(pDrawable);
         pCommandBuffer->commit();
+
+        lastCommandBuffer = NS::RetainPtr(pCommandBuffer);
     }
 
     return 0;
@@ -1450,13 +1607,10 @@ void CreateMaterialModels(
     }
 }
 
-void CreateIBLTextures(
-    MetalRenderer*             pRenderer,
-    MetalTexture*              pBRDFLUT,
-    MetalTexture*              pMultiscatterBRDFLUT,
-    std::vector<MetalTexture>& outIrradianceTextures,
-    std::vector<MetalTexture>& outEnvironmentTextures,
-    std::vector<uint32_t>&     outEnvNumLevels)
+void CreateBRDFLUTs(
+    MetalRenderer* pRenderer,
+    MetalTexture*  pBRDFLUT,
+    MetalTexture*  pMultiscatterBRDFLUT)
 {
     // BRDF LUT
     {
@@ -1495,99 +1649,63 @@ void CreateIBLTextures(
             bitmap.GetPixels(),
             pMultiscatterBRDFLUT));
     }
+}
 
-    auto                               iblDir = GetAssetPath("IBL");
-    std::vector<std::filesystem::path> iblFiles;
-    for (auto& entry : std::filesystem::directory_iterator(iblDir))
-    {
-        if (!entry.is_regular_file())
-        {
-            continue;
-        }
-        auto path = entry.path();
-        auto ext  = path.extension();
-        if (ext == ".ibl")
-        {
-            path = std::filesystem::relative(path, iblDir.parent_path());
-            iblFiles.push_back(path);
-        }
-    }
-
-    // Sort the paths so we match functionality on Windows
-    std::sort(iblFiles.begin(), iblFiles.end());
-
-    size_t maxEntries = std::min<size_t>(gMaxIBLs, iblFiles.size());
-    for (size_t i = 0; i < maxEntries; ++i)
+void ApplyIBLUpdate(
+    MetalRenderer*             pRenderer,
+    const IBLUpdate&           update,
+    std::vector<MetalTexture>& irrTextures,
+    std::vector<MetalTexture>& envTextures,
+    std::vector<uint32_t>&     envNumLevels)
+{
+    // The irradiance map stands in for the environment map until it's
+    // resident, envNumLevels is for whichever one is bound
+    switch (update.type)
     {
-        std::filesystem::path iblFile = iblFiles[i];
-
-        IBLMaps ibl = {};
-        if (!LoadIBLMaps32f(iblFile, &ibl))
+        case IBL_UPDATE_FALLBACK:
         {
-            GREX_LOG_ERROR("failed to load: " << iblFile);
-            assert(false && "IBL maps load failed failed");
-            return;
-        }
-
-        outEnvNumLevels.push_back(ibl.numLevels);
-
-        // Irradiance
-        {
-            MetalTexture texture = {};
             CHECK_CALL(CreateTexture(
                 pRenderer,
-                ibl.irradianceMap.GetWidth(),
-                ibl.irradianceMap.GetHeight(),
+                update.irradianceMap.GetWidth(),
+                update.irradianceMap.GetHeight(),
                 MTL::PixelFormatRGBA32Float,
-                ibl.irradianceMap.GetSizeInBytes(),
-                ibl.irradianceMap.GetPixels(),
-                &texture));
-            outIrradianceTextures.push_back(texture);
+                update.irradianceMap.GetSizeInBytes(),
+                update.irradianceMap.GetPixels(),
+                &irrTextures[update.index]));
+
+            envNumLevels[update.index] = 1;
         }
+        break;
 
-        // Environment
+        case IBL_UPDATE_ENVIRONMENT:
         {
-            const uint32_t pixelStride = ibl.environmentMap.GetPixelStride();
-            const uint32_t rowStride   = ibl.environmentMap.GetRowStride();
-
-            std::vector<MipOffset> mipOffsets;
-            uint32_t               levelOffset = 0;
-            uint32_t               levelWidth  = ibl.baseWidth;
-            uint32_t               levelHeight = ibl.baseHeight;
-            for (uint32_t i = 0; i < ibl.numLevels; ++i)
-            {
-                MipOffset mipOffset = {};
-                mipOffset.Offset    = levelOffset;
-                mipOffset.RowStride = rowStride;
-
-                mipOffsets.push_back(mipOffset);
-
-                levelOffset += (rowStride * levelHeight);
-                levelWidth >>= 1;
-                levelHeight >>= 1;
-            }
-
-            MetalTexture texture = {};
             CHECK_CALL(CreateTexture(
                 pRenderer,
-                ibl.baseWidth,
-                ibl.baseHeight,
-                MTL::PixelFormatRGBA32Float,
-                mipOffsets,
-                ibl.environmentMap.GetSizeInBytes(),
-                ibl.environmentMap.GetPixels(),
-                &texture));
-            outEnvironmentTextures.push_back(texture);
+                update.width,
+                update.height,
+                ToMTLFormat(update.format),
+                update.mipOffsets,
+                update.GetSizeInBytes(),
+                update.GetData(),
+                &envTextures[update.index]));
+
+            envNumLevels[update.index] = update.GetNumLevels();
         }
+        break;
 
-        gIBLNames.push_back(iblFile.filename().replace_extension().string());
+        case IBL_UPDATE_EVICT:
+        {
+            envTextures[update.index].Texture.reset();
 
-        GREX_LOG_INFO("Loaded " << iblFile);
+            envNumLevels[update.index] = 1;
+        }
+        break;
     }
 }
 
 void CreateMaterials(
     MetalRenderer*                   pRenderer,
+    TextureLoader*                   pTextureLoader,
     MaterialTextures&                outDefaultMaterialTextures,
     std::vector<MaterialTextures>&   outMaterialTexturesSets,
     std::vector<MaterialParameters>& outMaterialParametersSets)
@@ -1644,30 +1762,37 @@ void CreateMaterials(
 
         while (!is.eof())
         {
-            MetalTexture*         pTargetTexture = nullptr;
-            std::filesystem::path textureFile    = "";
+            MaterialTextureSlot   slot        = MATERIAL_TEXTURE_SLOT_BASE_COLOR;
+            std::filesystem::path textureFile = "";
+            MipmapContent         mipContent  = MIPMAP_CONTENT_DATA;
+            GREXFormat            bcFormat    = GREX_FORMAT_BC4_R;
 
             std::string key;
             is >> key;
             if (key == "basecolor")
             {
                 is >> textureFile;
-                pTargetTexture = &materialTextures.baseColorTexture;
+                slot           = MATERIAL_TEXTURE_SLOT_BASE_COLOR;
+                mipContent     = MIPMAP_CONTENT_COLOR_SRGB;
+                bcFormat       = GREX_FORMAT_BC7_RGBA;
             }
             else if (key == "normal")
             {
                 is >> textureFile;
-                pTargetTexture = &materialTextures.normalTexture;
+                slot           = MATERIAL_TEXTURE_SLOT_NORMAL;
+                mipContent     = MIPMAP_CONTENT_NORMAL;
+                bcFormat       = GREX_FORMAT_BC7_RGBA;
             }
             else if (key == "roughness")
             {
                 is >> textureFile;
-                pTargetTexture = &materialTextures.roughnessTexture;
+                slot           = MATERIAL_TEXTURE_SLOT_ROUGHNESS;
+                mipContent     = MIPMAP_CONTENT_ROUGHNESS;
             }
             else if (key == "metallic")
             {
                 is >> textureFile;
-                pTargetTexture = &materialTextures.metallicTexture;
+                slot           = MATERIAL_TEXTURE_SLOT_METALLIC;
             }
             else if (key == "specular")
             {
@@ -1682,41 +1807,14 @@ void CreateMaterials(
             auto cwd    = materialFile.parent_path().filename();
             textureFile = "textures" / cwd / textureFile;
 
-            auto bitmap = LoadImage8u(textureFile);
-            if (!bitmap.Empty())
-            {
-                MipmapRGBA8u mipmap = MipmapRGBA8u(
-                    bitmap,
-                    BITMAP_SAMPLE_MODE_WRAP,
-                    BITMAP_SAMPLE_MODE_WRAP,
-                    BITMAP_FILTER_MODE_NEAREST);
-
-                std::vector<MipOffset> mipOffsets;
-                for (auto& srcOffset : mipmap.GetOffsets())
-                {
-                    MipOffset dstOffset = {};
-                    dstOffset.Offset    = srcOffset;
-                    dstOffset.RowStride = mipmap.GetRowStride();
-                    mipOffsets.push_back(dstOffset);
-                }
-
-                CHECK_CALL(CreateTexture(
-                    pRenderer,
-                    mipmap.GetWidth(0),
-                    mipmap.GetHeight(0),
-                    MTL::PixelFormatRGBA8Unorm,
-                    mipOffsets,
-                    mipmap.GetSizeInBytes(),
-                    mipmap.GetPixels(),
-                    &(*pTargetTexture)));
-
-                GREX_LOG_INFO("Created texture from " << textureFile);
-            }
-            else
-            {
-                GREX_LOG_ERROR("Failed to load: " << textureFile);
-                assert(false && "Failed to load texture!");
-            }
+            // Color and normals to BC7, single channel maps to BC4
+            pTextureLoader->Submit(
+                TextureLoadRequest()
+                    .Path(textureFile)
+                    .Group(static_cast<uint32_t>(i))
+                    .Slot(slot)
+                    .MipOptions(MipmapOptions().Content(mipContent).ModeU(BITMAP_SAMPLE_MODE_WRAP).ModeV(BITMAP_SAMPLE_MODE_WRAP))
+                    .EncodeOptions(BCEncodeOptions().Format(bcFormat).Quality(BC_QUALITY_FAST)));
         }
 
         outMaterialTexturesSets.push_back(materialTextures);
@@ -2,6 +2,8 @@
 
 #include "vk_renderer.h"
 #include "bitmap.h"
+#include "ibl_residency.h"
+#include "texture_loader.h"
 #include "tri_mesh.h"
 
 #include <glm/glm.hpp>
@@ -85,6 +87,15 @@ struct MaterialTextures
     VulkanImage metallicTexture;
 };
 
+// Same order as MaterialTextures and the shader's texture array
+enum MaterialTextureSlot
+{
+    MATERIAL_TEXTURE_SLOT_BASE_COLOR = 0,
+    MATERIAL_TEXTURE_SLOT_NORMAL     = 1,
+    MATERIAL_TEXTURE_SLOT_ROUGHNESS  = 2,
+    MATERIAL_TEXTURE_SLOT_METALLIC   = 3,
+};
+
 struct GeometryBuffers
 {
     uint32_t     numIndices;
@@ -118,12 +129,14 @@ static float gTargetAngle = 0.0f;
 static float gAngle       = 0.0f;
 
 static std::vector<std::string> gMaterialNames = {};
+static uint32_t                 gMaterialIndex = 0;
 
 static uint32_t                 gNumLights  = 4;
-static const uint32_t           gMaxIBLs    = 32;
-static uint32_t                 gIBLIndex   = 0;
-static std::vector<std::string> gIBLNames   = {};
-static uint32_t                 gModelIndex = 0;
+static const uint32_t           gMaxIBLs         = 32;
+static const uint64_t           gIBLMemoryBudget = 1024 * 1024 * 1024; // RGBA16F environment maps, about 8 at 4k
+static uint32_t                 gIBLIndex        = 0;
+static std::vector<std::string> gIBLNames        = {};
+static uint32_t                 gModelIndex      = 0;
 
 void CreatePBRPipeline(VulkanRenderer* pRenderer, VulkanPipelineLayout* pLayout);
 void CreateEnvironmentPipeline(VulkanRenderer* pRenderer, VulkanPipelineLayout* pLayout);
@@ -133,32 +146,54 @@ void CreateEnvironmentVertexBuffers(
 void CreateMaterialModels(
     VulkanRenderer*               pRenderer,
     std::vector<GeometryBuffers>& outGeomtryBuffers);
-void CreateIBLTextures(
+void CreateBRDFLUTs(
+    VulkanRenderer* pRenderer,
+    VulkanImage*    pBRDFLUT,
+    VulkanImage*    pMultiscatterBRDFLUT);
+void ApplyIBLUpdate(
     VulkanRenderer*           pRenderer,
-    VulkanImage*              ppBRDFLUT,
-    VulkanImage*              ppMultiscatterBRDFLUT,
-    std::vector<VulkanImage>& outIrradianceTextures,
-    std::vector<VulkanImage>& outEnvironmentTextures,
-    std::vector<uint32_t>&    outEnvNumLevels);
+    const IBLUpdate&          update,
+    std::vector<VulkanImage>& irrTextures,
+    std::vector<VulkanImage>& envTextures,
+    std::vector<VkImageView>& irrViews,
+    std::vector<VkImageView>& envViews,
+    std::vector<uint32_t>&    envNumLevels);
 void CreateMaterials(
     VulkanRenderer*                  pRenderer,
+    TextureLoader*                   pTextureLoader,
     MaterialTextures&                outDefaultMaterialTextures,
     std::vector<MaterialTextures>&   outMaterialTexturesSets,
     std::vector<MaterialParameters>& outMaterialParametersSets);
 void CreatePBRDescriptors(
-    VulkanRenderer*                pRenderer,
-    VulkanDescriptorSet*           pDescriptors,
-    VulkanBuffer*                  pSceneParamsBuffer,
-    VulkanBuffer*                  pMaterialBuffer,
-    std::vector<MaterialTextures>& materialTextureSets,
-    const VulkanImage*             pBRDFLUT,
-    const VulkanImage*             pMultiscatterBRDFLUT,
-    std::vector<VulkanImage>&      irrTextures,
-    std::vector<VulkanImage>&      envTextures);
+    VulkanRenderer*                 pRenderer,
+    VulkanDescriptorSet*            pDescriptors,
+    VulkanBuffer*                   pSceneParamsBuffer,
+    VulkanBuffer*                   pMaterialBuffer,
+    std::vector<MaterialTextures>&  materialTextureSets,
+    const VulkanImage*              pBRDFLUT,
+    const VulkanImage*              pMultiscatterBRDFLUT,
+    const std::vector<VkImageView>& irrViews,
+    const std::vector<VkImageView>& envViews,
+    std::vector<VkImageView>&       outMaterialTextureViews);
+void UpdateMaterialTextureDescriptor(
+    VulkanRenderer*      pRenderer,
+    VulkanDescriptorSet* pDescriptors,
+    uint32_t             arrayElement,
+    VulkanImage*         pImage,
+    VkFormat             format,
+    VkImageView*         pImageView);
+void UpdateIBLDescriptors(
+    VulkanRenderer*      pRenderer,
+    VulkanDescriptorSet* pPBRDescriptors,
+    VulkanDescriptorSet* pEnvDescriptors,
+    uint32_t             iblIndex,
+    VkImageView          irrView,
+    VkImageView          envView);
 void CreateEnvDescriptors(
-    VulkanRenderer*          pRenderer,
-    VulkanDescriptorSet*     pDescriptors,
-    std::vector<VulkanImage> envTextures);
+    VulkanRenderer*                 pRenderer,
+    VulkanDescriptorSet*            pDescriptors,
+    const std::vector<VkImageView>& irrViews,
+    const std::vector<VkImageView>& envViews);
 
 void MouseMove(int x, int y, int buttons)
 {
@@ -373,27 +408,50 @@ int main(int argc, char** argv)
     // *************************************************************************
     // Environment texture
     // *************************************************************************
-    VulkanImage              brdfLUT;
-    VulkanImage              multiscatterBRDFLUT;
-    std::vector<VulkanImage> irrTextures;
-    std::vector<VulkanImage> envTextures;
-    std::vector<uint32_t>    envNumLevels;
-    CreateIBLTextures(
+    VulkanImage brdfLUT;
+    VulkanImage multiscatterBRDFLUT;
+    CreateBRDFLUTs(
         renderer.get(),
         &brdfLUT,
-        &multiscatterBRDFLUT,
-        irrTextures,
-        envTextures,
-        envNumLevels);
+        &multiscatterBRDFLUT);
+
+    // Only the selected IBL is loaded, others are loaded when they're
+    // selected and evicted when they go over the budget
+    IBLResidency iblResidency(
+        FindIBLFiles(gMaxIBLs),
+        BCEncodeOptions().Format(GREX_FORMAT_R16G16B16A16_FLOAT),
+        gIBLMemoryBudget);
+    for (uint32_t i = 0; i < iblResidency.GetCount(); ++i)
+    {
+        gIBLNames.push_back(iblResidency.GetName(i));
+    }
+
+    std::vector<VulkanImage> irrTextures(iblResidency.GetCount());
+    std::vector<VulkanImage> envTextures(iblResidency.GetCount());
+    std::vector<VkImageView> irrViews(iblResidency.GetCount(), VK_NULL_HANDLE);
+    std::vector<VkImageView> envViews(iblResidency.GetCount(), VK_NULL_HANDLE);
+    std::vector<uint32_t>    envNumLevels(iblResidency.GetCount());
+    iblResidency.Select(gIBLIndex);
+    iblResidency.WaitForSelected();
+    for (auto& update : iblResidency.TakeUpdates())
+    {
+        ApplyIBLUpdate(renderer.get(), update, irrTextures, envTextures, irrViews, envViews, envNumLevels);
+    }
 
     // *************************************************************************
     // Material texture
+    //
+    // Materials start out with the default textures, the real ones are
+    // loaded in the background and swapped in by the main loop as they
+    // finish.
     // *************************************************************************
+    TextureLoader                   textureLoader;
     MaterialTextures                defaultMaterialTextures;
     std::vector<MaterialTextures>   materialTexturesSets;
     std::vector<MaterialParameters> materialParametersSets;
     CreateMaterials(
         renderer.get(),
+        &textureLoader,
         defaultMaterialTextures,
         materialTexturesSets,
         materialParametersSets);
@@ -414,7 +472,8 @@ int main(int argc, char** argv)
     // *************************************************************************
     // Descriptor sets
     // *************************************************************************
-    VulkanDescriptorSet pbrDescriptors;
+    VulkanDescriptorSet      pbrDescriptors;
+    std::vector<VkImageView> materialTextureViews; // One per MaterialTextures slot
     CreatePBRDescriptors(
         renderer.get(),
         &pbrDescriptors,
@@ -423,14 +482,16 @@ int main(int argc, char** argv)
         materialTexturesSets,
         &brdfLUT,
         &multiscatterBRDFLUT,
-        irrTextures,
-        envTextures);
+        irrViews,
+        envViews,
+        materialTextureViews);
 
     VulkanDescriptorSet envDescriptors;
     CreateEnvDescriptors(
         renderer.get(),
         &envDescriptors,
-        envTextures);
+        irrViews,
+        envViews);
 
     // *************************************************************************
     // Window
@@ -587,6 +648,47 @@ int main(int argc, char** argv)
 
     while (window->PollEvents())
     {
+        // Swap in material textures that finished loading. The GPU is
+        // waited on at the end of every frame so neither the descriptor
+        // set nor the views it replaces are in use.
+        for (auto& loaded : textureLoader.TakeCompleted())
+        {
+            if (!loaded.loaded)
+            {
+                assert(false && "Failed to load texture!");
+                continue;
+            }
+
+            MaterialTextures& materialTextures = materialTexturesSets[loaded.group];
+            VulkanImage*      textureImages[]  = {
+                &materialTextures.baseColorTexture,
+                &materialTextures.normalTexture,
+                &materialTextures.roughnessTexture,
+                &materialTextures.metallicTexture};
+
+            VulkanImage* pTargetTexture = textureImages[loaded.slot];
+            CHECK_CALL(CreateTexture(
+                renderer.get(),
+                loaded.width,
+                loaded.height,
+                ToVkFormat(loaded.format),
+                loaded.mipOffsets,
+                loaded.GetSizeInBytes(),
+                loaded.GetData(),
+                pTargetTexture));
+
+            const uint32_t arrayElement = loaded.group * MATERIAL_TEXTURE_STRIDE + loaded.slot;
+            UpdateMaterialTextureDescriptor(
+                renderer.get(),
+                &pbrDescriptors,
+                arrayElement,
+                pTargetTexture,
+                ToVkFormat(loaded.format),
+                &materialTextureViews[arrayElement]);
+
+            GREX_LOG_INFO("Created texture from " << loaded.path);
+        }
+
         window->ImGuiNewFrameVulkan();
 
         if (ImGui::Begin("Scene"))
@@ -620,8 +722,9 @@ int main(int argc, char** argv)
                     bool isSelected = (currentIBLName == gIBLNames[i]);
                     if (ImGui::Selectable(gIBLNames[i].c_str(), isSelected))
                     {
-                        currentIBLName            = gIBLNames[i].c_str();
-                        pPBRSceneParams->iblIndex = static_cast<uint32_t>(i);
+                        currentIBLName = gIBLNames[i].c_str();
+                        gIBLIndex      = static_cast<uint32_t>(i);
+                        iblResidency.Select(gIBLIndex);
                     }
                     if (isSelected)
                     {
@@ -659,6 +762,34 @@ int main(int argc, char** argv)
 
         if (ImGui::Begin("Material Parameters"))
         {
+            // Textures of the selected material are loaded first
+            const char* currentMaterialName = gMaterialNames[gMaterialIndex].c_str();
+            if (ImGui::BeginCombo("Selected", currentMaterialName))
+            {
+                for (uint32_t matIdx = 0; matIdx < gMaterialNames.size(); ++matIdx)
+                {
+                    bool isSelected = (matIdx == gMaterialIndex);
+                    if (ImGui::Selectable(gMaterialNames[matIdx].c_str(), isSelected))
+                    {
+                        gMaterialIndex = matIdx;
+                        textureLoader.Prioritize(gMaterialIndex);
+                    }
+                    if (isSelected)
+                    {
+                        ImGui::SetItemDefaultFocus();
+                    }
+                }
+                ImGui::EndCombo();
+            }
+
+            const uint32_t numPendingTextures = textureLoader.GetNumPending();
+            if (numPendingTextures > 0)
+            {
+                ImGui::Text("Loading %u textures", numPendingTextures);
+            }
+
+            ImGui::Separator();
+
             for (uint32_t matIdx = 0; matIdx < gMaterialNames.size(); ++matIdx)
             {
                 if (ImGui::TreeNodeEx(gMaterialNames[matIdx].c_str(), ImGuiTreeNodeFlags_DefaultOpen))
@@ -675,6 +806,29 @@ int main(int argc, char** argv)
 
         // ---------------------------------------------------------------------
 
+        // Apply IBL loads and evictions, the GPU is waited on at the end
+        // of every frame so evicted textures aren't in use
+        for (auto& update : iblResidency.TakeUpdates())
+        {
+            ApplyIBLUpdate(renderer.get(), update, irrTextures, envTextures, irrViews, envViews, envNumLevels);
+
+            UpdateIBLDescriptors(
+                renderer.get(),
+                &pbrDescriptors,
+                &envDescriptors,
+                update.index,
+                irrViews[update.index],
+                envViews[update.index]);
+        }
+
+        // Switch over once the selected IBL has at least its fallback
+        if (irrTextures[gIBLIndex].Image != VK_NULL_HANDLE)
+        {
+            pPBRSceneParams->iblIndex = gIBLIndex;
+        }
+
+        // ---------------------------------------------------------------------
+
         UINT bufferIndex = 0;
         if (AcquireNextImage(renderer.get(), &bufferIndex))
         {
@@ -739,7 +893,7 @@ int main(int argc, char** argv)
             // Set scene params values that required calculation
             pPBRSceneParams->viewProjectionMatrix = projMat * viewMat;
             pPBRSceneParams->eyePosition          = eyePosition;
-            pPBRSceneParams->iblNumEnvLevels      = envNumLevels[gIBLIndex];
+            pPBRSceneParams->iblNumEnvLevels      = envNumLevels[pPBRSceneParams->iblIndex];
 
             // Draw environment
             {
@@ -1622,13 +1776,10 @@ void CreateMaterialModels(
     }
 }
 
-void CreateIBLTextures(
-    VulkanRenderer*           pRenderer,
-    VulkanImage*              pBRDFLUT,
-    VulkanImage*              pMultiscatterBRDFLUT,
-    std::vector<VulkanImage>& outIrradianceTextures,
-    std::vector<VulkanImage>& outEnvironmentTextures,
-    std::vector<uint32_t>&    outEnvNumLevels)
+void CreateBRDFLUTs(
+    VulkanRenderer* pRenderer,
+    VulkanImage*    pBRDFLUT,
+    VulkanImage*    pMultiscatterBRDFLUT)
 {
     // BRDF LUT
     {
@@ -1667,96 +1818,86 @@ void CreateIBLTextures(
             bitmap.GetPixels(),
             pMultiscatterBRDFLUT));
     }
+}
 
-    auto                               iblDir = GetAssetPath("IBL");
-    std::vector<std::filesystem::path> iblFiles;
-    for (auto& entry : std::filesystem::directory_iterator(iblDir))
+void ApplyIBLUpdate(
+    VulkanRenderer*           pRenderer,
+    const IBLUpdate&          update,
+    std::vector<VulkanImage>& irrTextures,
+    std::vector<VulkanImage>& envTextures,
+    std::vector<VkImageView>& irrViews,
+    std::vector<VkImageView>& envViews,
+    std::vector<uint32_t>&    envNumLevels)
+{
+    // The irradiance map stands in for the environment map until it's
+    // resident, envNumLevels is for whichever one is bound. Each texture
+    // has one view that lives as long as it does, the descriptors are
+    // rewritten with them by UpdateIBLDescriptors().
+    switch (update.type)
     {
-        if (!entry.is_regular_file())
+        case IBL_UPDATE_FALLBACK:
         {
-            continue;
-        }
-        auto path = entry.path();
-        auto ext  = path.extension();
-        if (ext == ".ibl")
-        {
-            path = std::filesystem::relative(path, iblDir.parent_path());
-            iblFiles.push_back(path);
-        }
-    }
+            CHECK_CALL(CreateTexture(
+                pRenderer,
+                update.irradianceMap.GetWidth(),
+                update.irradianceMap.GetHeight(),
+                VK_FORMAT_R32G32B32A32_SFLOAT,
+                update.irradianceMap.GetSizeInBytes(),
+                update.irradianceMap.GetPixels(),
+                &irrTextures[update.index]));
 
-    size_t maxEntries = std::min<size_t>(gMaxIBLs, iblFiles.size());
-    for (size_t i = 0; i < maxEntries; ++i)
-    {
-        std::filesystem::path iblFile = iblFiles[i];
+            CHECK_CALL(CreateImageView(
+                pRenderer,
+                &irrTextures[update.index],
+                VK_IMAGE_VIEW_TYPE_2D,
+                VK_FORMAT_R32G32B32A32_SFLOAT,
+                GREX_ALL_SUBRESOURCES,
+                &irrViews[update.index]));
 
-        IBLMaps ibl = {};
-        if (!LoadIBLMaps32f(iblFile, &ibl))
-        {
-            GREX_LOG_ERROR("failed to load: " << iblFile);
-            assert(false && "IBL maps load failed failed");
-            return;
+            envNumLevels[update.index] = 1;
         }
+        break;
 
-        outEnvNumLevels.push_back(ibl.numLevels);
-
-        // Irradiance
+        case IBL_UPDATE_ENVIRONMENT:
         {
-            VulkanImage texture = {};
             CHECK_CALL(CreateTexture(
                 pRenderer,
-                ibl.irradianceMap.GetWidth(),
-                ibl.irradianceMap.GetHeight(),
-                VK_FORMAT_R32G32B32A32_SFLOAT,
-                ibl.irradianceMap.GetSizeInBytes(),
-                ibl.irradianceMap.GetPixels(),
-                &texture));
-            outIrradianceTextures.push_back(texture);
+                update.width,
+                update.height,
+                ToVkFormat(update.format),
+                update.mipOffsets,
+                update.GetSizeInBytes(),
+                update.GetData(),
+                &envTextures[update.index]));
+
+            CHECK_CALL(CreateImageView(
+                pRenderer,
+                &envTextures[update.index],
+                VK_IMAGE_VIEW_TYPE_2D,
+                ToVkFormat(update.format),
+                GREX_ALL_SUBRESOURCES,
+                &envViews[update.index]));
+
+            envNumLevels[update.index] = update.GetNumLevels();
         }
+        break;
 
-        // Environment
+        case IBL_UPDATE_EVICT:
         {
-            const uint32_t pixelStride = ibl.environmentMap.GetPixelStride();
-            const uint32_t rowStride   = ibl.environmentMap.GetRowStride();
-
-            std::vector<MipOffset> mipOffsets;
-            uint32_t               levelOffset = 0;
-            uint32_t               levelWidth  = ibl.baseWidth;
-            uint32_t               levelHeight = ibl.baseHeight;
-            for (uint32_t i = 0; i < ibl.numLevels; ++i)
-            {
-                MipOffset mipOffset = {};
-                mipOffset.Offset    = levelOffset;
-                mipOffset.RowStride = rowStride;
+            vkDestroyImageView(pRenderer->Device, envViews[update.index], nullptr);
+            envViews[update.index] = VK_NULL_HANDLE;
 
-                mipOffsets.push_back(mipOffset);
+            DestroyImage(pRenderer, &envTextures[update.index]);
 
-                levelOffset += (rowStride * levelHeight);
-                levelWidth >>= 1;
-                levelHeight >>= 1;
-            }
-
-            VulkanImage texture = {};
-            CHECK_CALL(CreateTexture(
-                pRenderer,
-                ibl.baseWidth,
-                ibl.baseHeight,
-                VK_FORMAT_R32G32B32A32_SFLOAT,
-                mipOffsets,
-                ibl.environmentMap.GetSizeInBytes(),
-                ibl.environmentMap.GetPixels(),
-                &texture));
-            outEnvironmentTextures.push_back(texture);
+            envNumLevels[update.index] = 1;
         }
-
-        gIBLNames.push_back(iblFile.filename().replace_extension().string());
-
-        GREX_LOG_INFO("Loaded " << iblFile);
+        break;
     }
 }
 
 void CreateMaterials(
     VulkanRenderer*                  pRenderer,
+    TextureLoader*                   pTextureLoader,
     MaterialTextures&                outDefaultMaterialTextures,
     std::vector<MaterialTextures>&   outMaterialTexturesSets,
     std::vector<MaterialParameters>& outMaterialParametersSets)
@@ -1812,30 +1953,37 @@ void CreateMaterials(
 
         while (!is.eof())
         {
-            VulkanImage*          pTargetTexture = {};
-            std::filesystem::path textureFile    = "";
+            MaterialTextureSlot   slot        = MATERIAL_TEXTURE_SLOT_BASE_COLOR;
+            std::filesystem::path textureFile = "";
+            MipmapContent         mipContent  = MIPMAP_CONTENT_DATA;
+            GREXFormat            bcFormat    = GREX_FORMAT_BC4_R;
 
             std::string key;
             is >> key;
             if (key == "basecolor")
             {
                 is >> textureFile;
-                pTargetTexture = &materialTextures.baseColorTexture;
+                slot           = MATERIAL_TEXTURE_SLOT_BASE_COLOR;
+                mipContent     = MIPMAP_CONTENT_COLOR_SRGB;
+                bcFormat       = GREX_FORMAT_BC7_RGBA;
             }
             else if (key == "normal")
             {
                 is >> textureFile;
-                pTargetTexture = &materialTextures.normalTexture;
+                slot           = MATERIAL_TEXTURE_SLOT_NORMAL;
+                mipContent     = MIPMAP_CONTENT_NORMAL;
+                bcFormat       = GREX_FORMAT_BC7_RGBA;
             }
             else if (key == "roughness")
             {
                 is >> textureFile;
-                pTargetTexture = &materialTextures.roughnessTexture;
+                slot           = MATERIAL_TEXTURE_SLOT_ROUGHNESS;
+                mipContent     = MIPMAP_CONTENT_ROUGHNESS;
             }
             else if (key == "metallic")
             {
                 is >> textureFile;
-                pTargetTexture = &materialTextures.metallicTexture;
+                slot           = MATERIAL_TEXTURE_SLOT_METALLIC;
             }
             else if (key == "specular")
             {
@@ -1850,41 +1998,14 @@ void CreateMaterials(
             auto cwd    = materialFile.parent_path().filename();
             textureFile = "textures" / cwd / textureFile;
 
-            auto bitmap = LoadImage8u(textureFile);
-            if (!bitmap.Empty())
-            {
-                MipmapRGBA8u mipmap = MipmapRGBA8u(
-                    bitmap,
-                    BITMAP_SAMPLE_MODE_WRAP,
-                    BITMAP_SAMPLE_MODE_WRAP,
-                    BITMAP_FILTER_MODE_NEAREST);
-
-                std::vector<MipOffset> mipOffsets;
-                for (auto& srcOffset : mipmap.GetOffsets())
-                {
-                    MipOffset dstOffset = {};
-                    dstOffset.Offset    = srcOffset;
-                    dstOffset.RowStride = mipmap.GetRowStride();
-                    mipOffsets.push_back(dstOffset);
-                }
-
-                CHECK_CALL(CreateTexture(
-                    pRenderer,
-                    mipmap.GetWidth(0),
-                    mipmap.GetHeight(0),
-                    VK_FORMAT_R8G8B8A8_UNORM,
-                    mipOffsets,
-                    mipmap.GetSizeInBytes(),
-                    mipmap.GetPixels(),
-                    &(*pTargetTexture)));
-
-                GREX_LOG_INFO("Created texture from " << textureFile);
-            }
-            else
-            {
-                GREX_LOG_ERROR("Failed to load: " << textureFile);
-                assert(false && "Failed to load texture!");
-            }
+            // Color and normals to BC7, single channel maps to BC4
+            pTextureLoader->Submit(
+                TextureLoadRequest()
+                    .Path(textureFile)
+                    .Group(static_cast<uint32_t>(i))
+                    .Slot(slot)
+                    .MipOptions(MipmapOptions().Content(mipContent).ModeU(BITMAP_SAMPLE_MODE_WRAP).ModeV(BITMAP_SAMPLE_MODE_WRAP))
+                    .EncodeOptions(BCEncodeOptions().Format(bcFormat).Quality(BC_QUALITY_FAST)));
         }
 
         outMaterialTexturesSets.push_back(materialTextures);
@@ -1896,15 +2017,16 @@ void CreateMaterials(
 }
 
 void CreatePBRDescriptors(
-    VulkanRenderer*                pRenderer,
-    VulkanDescriptorSet*           pDescriptors,
-    VulkanBuffer*                  pSceneParamsBuffer,
-    VulkanBuffer*                  pMaterialBuffer,
-    std::vector<MaterialTextures>& materialTextureSets,
-    const VulkanImage*             pBRDFLUT,
-    const VulkanImage*             pMultiscatterBRDFLUT,
-    std::vector<VulkanImage>&      irrTextures,
-    std::vector<VulkanImage>&      envTextures)
+    VulkanRenderer*                 pRenderer,
+    VulkanDescriptorSet*            pDescriptors,
+    VulkanBuffer*                   pSceneParamsBuffer,
+    VulkanBuffer*                   pMaterialBuffer,
+    std::vector<MaterialTextures>&  materialTextureSets,
+    const VulkanImage*              pBRDFLUT,
+    const VulkanImage*              pMultiscatterBRDFLUT,
+    const std::vector<VkImageView>& irrViews,
+    const std::vector<VkImageView>& envViews,
+    std::vector<VkImageView>&       outMaterialTextureViews)
 {
     // ConstantBuffer<SceneParameters>      SceneParams                                : register(b0);
     VulkanBufferDescriptor sceneParamsDescriptor;
@@ -1976,17 +2098,13 @@ void CreatePBRDescriptors(
     // Texture2D                            IBLIrradianceMaps[32]                      : register(t16);
     VulkanImageDescriptor iblIrradianceMapsDescriptor(32);
     {
-        uint32_t arrayIndex = 0;
-        for (auto& image : irrTextures)
+        for (uint32_t arrayIndex = 0; arrayIndex < CountU32(irrViews); ++arrayIndex)
         {
-            VkImageView imageView = VK_NULL_HANDLE;
-            CHECK_CALL(CreateImageView(
-                pRenderer,
-                &image,
-                VK_IMAGE_VIEW_TYPE_2D,
-                VK_FORMAT_R32G32B32A32_SFLOAT,
-                GREX_ALL_SUBRESOURCES,
-                &imageView));
+            // IBLs that aren't loaded yet are written by UpdateIBLDescriptors()
+            if (irrViews[arrayIndex] == VK_NULL_HANDLE)
+            {
+                continue;
+            }
 
             CreateDescriptor(
                 pRenderer,
@@ -1994,27 +2112,26 @@ void CreatePBRDescriptors(
                 16,         // binding
                 arrayIndex, // arrayElement
                 VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE,
-                imageView,
+                irrViews[arrayIndex],
                 VK_IMAGE_LAYOUT_GENERAL);
-
-            arrayIndex++;
         }
     }
 
     // Texture2D                            IBLEnvironmentMaps[32]                     : register(t48);
     VulkanImageDescriptor iblEnvironmentMapsDescriptor(32);
     {
-        uint32_t arrayIndex = 0;
-        for (auto& image : envTextures)
+        for (uint32_t arrayIndex = 0; arrayIndex < CountU32(envViews); ++arrayIndex)
         {
-            VkImageView imageView = VK_NULL_HANDLE;
-            CHECK_CALL(CreateImageView(
-                pRenderer,
-                &image,
-                VK_IMAGE_VIEW_TYPE_2D,
-                VK_FORMAT_R32G32B32A32_SFLOAT,
-                GREX_ALL_SUBRESOURCES,
-                &imageView));
+            // Irradiance map until the environment map is resident
+            VkImageView imageView = envViews[arrayIndex];
+            if (imageView == VK_NULL_HANDLE)
+            {
+                imageView = irrViews[arrayIndex];
+            }
+            if (imageView == VK_NULL_HANDLE)
+            {
+                continue;
+            }
 
             CreateDescriptor(
                 pRenderer,
@@ -2024,8 +2141,6 @@ void CreatePBRDescriptors(
                 VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE,
                 imageView,
                 VK_IMAGE_LAYOUT_GENERAL);
-
-            arrayIndex++;
         }
     }
 
@@ -2103,6 +2218,7 @@ void CreatePBRDescriptors(
 
     // Texture2D                            MaterialTextures[TOTAL_MATERIAL_TEXTURES]  : register(t100);
     VulkanImageDescriptor materialTexturesDescriptor(TOTAL_MATERIAL_TEXTURES);
+    outMaterialTextureViews.assign(TOTAL_MATERIAL_TEXTURES, VK_NULL_HANDLE);
     {
         uint32_t arrayIndex = 0;
         for (auto& materialTextures : materialTextureSets)
@@ -2123,6 +2239,7 @@ void CreatePBRDescriptors(
                     VK_FORMAT_R8G8B8A8_UNORM,
                     GREX_ALL_SUBRESOURCES,
                     &imageView));
+                outMaterialTextureViews[arrayIndex] = imageView;
 
                 CreateDescriptor(
                     pRenderer,
@@ -2243,10 +2360,105 @@ void CreatePBRDescriptors(
     CreateAndUpdateDescriptorSet(pRenderer, setLayoutBinding, writeDescriptorSets, pDescriptors);
 }
 
+void UpdateMaterialTextureDescriptor(
+    VulkanRenderer*      pRenderer,
+    VulkanDescriptorSet* pDescriptors,
+    uint32_t             arrayElement,
+    VulkanImage*         pImage,
+    VkFormat             format,
+    VkImageView*         pImageView)
+{
+    // Replaces the slot's view, the caller makes sure the frames that used
+    // it have retired
+    if (*pImageView != VK_NULL_HANDLE)
+    {
+        vkDestroyImageView(pRenderer->Device, *pImageView, nullptr);
+        *pImageView = VK_NULL_HANDLE;
+    }
+
+    CHECK_CALL(CreateImageView(
+        pRenderer,
+        pImage,
+        VK_IMAGE_VIEW_TYPE_2D,
+        format,
+        GREX_ALL_SUBRESOURCES,
+        pImageView));
+
+    VkDescriptorImageInfo imageInfo = {};
+    imageInfo.imageView             = *pImageView;
+    imageInfo.imageLayout           = VK_IMAGE_LAYOUT_GENERAL;
+
+    // Texture2D                            MaterialTextures[TOTAL_MATERIAL_TEXTURES]  : register(t100);
+    VkWriteDescriptorSet write = {VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET};
+    write.dstSet               = pDescriptors->DescriptorSet;
+    write.dstBinding           = 100;
+    write.dstArrayElement      = arrayElement;
+    write.descriptorCount      = 1;
+    write.descriptorType       = VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE;
+    write.pImageInfo           = &imageInfo;
+
+    vkUpdateDescriptorSets(pRenderer->Device, 1, &write, 0, nullptr);
+}
+
+void UpdateIBLDescriptors(
+    VulkanRenderer*      pRenderer,
+    VulkanDescriptorSet* pPBRDescriptors,
+    VulkanDescriptorSet* pEnvDescriptors,
+    uint32_t             iblIndex,
+    VkImageView          irrView,
+    VkImageView          envView)
+{
+    // Irradiance map until the environment map is resident
+    if (envView == VK_NULL_HANDLE)
+    {
+        envView = irrView;
+    }
+
+    VkDescriptorImageInfo irrInfo = {};
+    irrInfo.imageView             = irrView;
+    irrInfo.imageLayout           = VK_IMAGE_LAYOUT_GENERAL;
+
+    VkDescriptorImageInfo envInfo = {};
+    envInfo.imageView             = envView;
+    envInfo.imageLayout           = VK_IMAGE_LAYOUT_GENERAL;
+
+    VkWriteDescriptorSet writes[3] = {};
+
+    // PBR: Texture2D                       IBLIrradianceMaps[32]  : register(t16);
+    writes[0]                 = {VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET};
+    writes[0].dstSet          = pPBRDescriptors->DescriptorSet;
+    writes[0].dstBinding      = 16;
+    writes[0].dstArrayElement = iblIndex;
+    writes[0].descriptorCount = 1;
+    writes[0].descriptorType  = VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE;
+    writes[0].pImageInfo      = &irrInfo;
+
+    // PBR: Texture2D                       IBLEnvironmentMaps[32] : register(t48);
+    writes[1]                 = {VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET};
+    writes[1].dstSet          = pPBRDescriptors->DescriptorSet;
+    writes[1].dstBinding      = 48;
+    writes[1].dstArrayElement = iblIndex;
+    writes[1].descriptorCount = 1;
+    writes[1].descriptorType  = VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE;
+    writes[1].pImageInfo      = &envInfo;
+
+    // Env: Texture2D                       Textures[16]           : register(t32);
+    writes[2]                 = {VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET};
+    writes[2].dstSet          = pEnvDescriptors->DescriptorSet;
+    writes[2].dstBinding      = 32;
+    writes[2].dstArrayElement = iblIndex;
+    writes[2].descriptorCount = 1;
+    writes[2].descriptorType  = VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE;
+    writes[2].pImageInfo      = &envInfo;
+
+    vkUpdateDescriptorSets(pRenderer->Device, 3, writes, 0, nullptr);
+}
+
 void CreateEnvDescriptors(
-    VulkanRenderer*          pRenderer,
-    VulkanDescriptorSet*     pDescriptors,
-    std::vector<VulkanImage> envTextures)
+    VulkanRenderer*                 pRenderer,
+    VulkanDescriptorSet*            pDescriptors,
+    const std::vector<VkImageView>& irrViews,
+    const std::vector<VkImageView>& envViews)
 {
     // DEFINE_AS_PUSH_CONSTANT
     // ConstantBuffer<SceneParameters> SceneParmas  : register(b0);
@@ -2290,17 +2502,18 @@ void CreateEnvDescriptors(
     // Texture2D                       Textures[16] : register(t32);
     VulkanImageDescriptor texturesDescriptor(gMaxIBLs);
     {
-        uint32_t arrayIndex = 0;
-        for (auto& image : envTextures)
+        for (uint32_t arrayIndex = 0; arrayIndex < CountU32(envViews); ++arrayIndex)
         {
-            VkImageView imageView = VK_NULL_HANDLE;
-            CHECK_CALL(CreateImageView(
-                pRenderer,
-                &image,
-                VK_IMAGE_VIEW_TYPE_2D,
-                VK_FORMAT_R32G32B32A32_SFLOAT,
-                GREX_ALL_SUBRESOURCES,
-                &imageView));
+            // Irradiance map until the environment map is resident
+            VkImageView imageView = envViews[arrayIndex];
+            if (imageView == VK_NULL_HANDLE)
+            {
+                imageView = irrViews[arrayIndex];
+            }
+            if (imageView == VK_NULL_HANDLE)
+            {
+                continue;
+            }
 
             CreateDescriptor(
                 pRenderer,
@@ -2310,8 +2523,6 @@ void CreateEnvDescriptors(
                 VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE,
                 imageView,
                 VK_IMAGE_LAYOUT_GENERAL);
-
-            arrayIndex++;
         }
     }
 
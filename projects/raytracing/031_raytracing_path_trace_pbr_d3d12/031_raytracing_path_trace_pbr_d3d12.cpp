@@ -1,6 +1,7 @@
 #include "window.h"
 
 #include "dx_renderer.h"
+#include "ibl_residency.h"
 #include "tri_mesh.h"
 
 #include <glm/glm.hpp>
@@ -32,6 +33,7 @@ const uint32_t kGeoBuffersOffset      = 20;
 const uint32_t kIBLTextureOffset      = 100;
 const uint32_t kMaxIBLs               = 100;
 const uint32_t kMaxGeometries         = 75;
+const uint64_t kIBLMemoryBudget       = 64 * 1024 * 1024; // BC6H environment maps, about 5 at 4k
 
 // =============================================================================
 // Shader code
@@ -103,11 +105,12 @@ struct Geometry
     ComPtr<ID3D12Resource> normalBuffer;
 };
 
+// irrTexture is loaded first and stands in for envTexture until it's resident
 struct IBLTextures
 {
     ComPtr<ID3D12Resource> irrTexture;
     ComPtr<ID3D12Resource> envTexture;
-    uint32_t               envNumLevels;
+    uint32_t               envNumLevels = 0;
 };
 
 struct MaterialParameters
@@ -163,9 +166,10 @@ void CreateTLAS(
     std::vector<MaterialParameters>& outMaterialParams);
 void CreateOutputTexture(DxRenderer* pRenderer, ID3D12Resource** ppBuffer);
 void CreateAccumTexture(DxRenderer* pRenderer, ID3D12Resource** ppBuffer);
-void CreateIBLTextures(
-    DxRenderer*               pRenderer,
-    std::vector<IBLTextures>& outIBLTextures);
+void ApplyIBLUpdate(
+    DxRenderer*      pRenderer,
+    const IBLUpdate& update,
+    IBLTextures*     pIBLTexture);
 void CreateDescriptorHeap(DxRenderer* pRenderer, ID3D12DescriptorHeap** ppHeap);
 void WriteDescriptors(
     DxRenderer*                     pRenderer,
@@ -179,6 +183,11 @@ void WriteDescriptors(
     const Geometry&                 teapotGeometry,
     const Geometry&                 boxGeometry,
     const std::vector<IBLTextures>& iblTextures);
+void WriteIBLDescriptor(
+    DxRenderer*           pRenderer,
+    ID3D12DescriptorHeap* pDescriptorHeap,
+    uint32_t              iblIndex,
+    const IBLTextures&    iblTexture);
 
 void MouseMove(int x, int y, int buttons)
 {
@@ -432,11 +441,32 @@ int main(int argc, char** argv)
 
     // *************************************************************************
     // IBL textures
+    //
+    // Only the selected IBL is loaded, others are loaded when they're
+    // selected and evicted when they go over the budget. BC6H is 16x
+    // smaller than the RGBA32F levels, log its error per level.
     // *************************************************************************
-    std::vector<IBLTextures> iblTextures = {};
-    CreateIBLTextures(
-        renderer.get(),
-        iblTextures);
+    IBLResidency iblResidency(
+        FindIBLFiles(kMaxIBLs),
+        BCEncodeOptions()
+            .Format(GREX_FORMAT_BC6H_UFLOAT)
+            .Quality(BC_QUALITY_FAST)
+            .RowStrideAlignment(D3D12_TEXTURE_DATA_PITCH_ALIGNMENT)
+            .OffsetAlignment(D3D12_TEXTURE_DATA_PLACEMENT_ALIGNMENT)
+            .MeasureError(true),
+        kIBLMemoryBudget);
+    for (uint32_t i = 0; i < iblResidency.GetCount(); ++i)
+    {
+        gIBLNames.push_back(iblResidency.GetName(i));
+    }
+
+    std::vector<IBLTextures> iblTextures(iblResidency.GetCount());
+    iblResidency.Select(gIBLIndex);
+    iblResidency.WaitForSelected();
+    for (auto& update : iblResidency.TakeUpdates())
+    {
+        ApplyIBLUpdate(renderer.get(), update, &iblTextures[update.index]);
+    }
 
     // *************************************************************************
     // Descriptor heaps
@@ -542,6 +572,7 @@ int main(int argc, char** argv)
                     {
                         currentIBLName = gIBLNames[i].c_str();
                         gIBLIndex      = static_cast<uint32_t>(i);
+                        iblResidency.Select(gIBLIndex);
                     }
                     if (isSelected)
                     {
@@ -582,7 +613,22 @@ int main(int argc, char** argv)
             gResetRayGenSamples = true;
         }
 
-        if (gCurrentIBLIndex != gIBLIndex)
+        // Apply IBL loads and evictions, the GPU is waited on at the end
+        // of every frame so evicted textures and their descriptors aren't
+        // in use
+        for (auto& update : iblResidency.TakeUpdates())
+        {
+            ApplyIBLUpdate(renderer.get(), update, &iblTextures[update.index]);
+            WriteIBLDescriptor(renderer.get(), descriptorHeap.Get(), update.index, iblTextures[update.index]);
+
+            if (update.index == gCurrentIBLIndex)
+            {
+                gResetRayGenSamples = true;
+            }
+        }
+
+        // Switch over once the selected IBL has at least its fallback
+        if ((gCurrentIBLIndex != gIBLIndex) && iblTextures[gIBLIndex].irrTexture)
         {
             gCurrentIBLIndex    = gIBLIndex;
             gResetRayGenSamples = true;
@@ -1960,88 +2006,48 @@ void CreateAccumTexture(DxRenderer* pRenderer, ID3D12Resource** ppBuffer)
         IID_PPV_ARGS(ppBuffer)));              // riidResource, ppvResource
 }
 
-void CreateIBLTextures(
-    DxRenderer*               pRenderer,
-    std::vector<IBLTextures>& outIBLTextures)
+void ApplyIBLUpdate(
+    DxRenderer*      pRenderer,
+    const IBLUpdate& update,
+    IBLTextures*     pIBLTexture)
 {
-    std::vector<std::filesystem::path> iblFiles;
+    switch (update.type)
     {
-        auto iblDirs = GetEveryAssetPath("IBL");
-        for (auto& dir : iblDirs)
+        case IBL_UPDATE_FALLBACK:
         {
-            for (auto& entry : std::filesystem::directory_iterator(dir))
-            {
-                if (!entry.is_regular_file())
-                {
-                    continue;
-                }
-                auto path = entry.path();
-                auto ext  = path.extension();
-                if (ext == ".ibl")
-                {
-                    path = std::filesystem::relative(path, dir.parent_path());
-                    iblFiles.push_back(path);
-                }
-            }
-        }
-    }
-
-    size_t maxEntries = std::min<size_t>(kMaxIBLs, iblFiles.size());
-    for (size_t i = 0; i < maxEntries; ++i)
-    {
-        std::filesystem::path iblFile = iblFiles[i];
-
-        IBLMaps ibl = {};
-        if (!LoadIBLMaps32f(iblFile, &ibl))
-        {
-            GREX_LOG_ERROR("failed to load: " << iblFile);
-            return;
+            CHECK_CALL(CreateTexture(
+                pRenderer,
+                update.irradianceMap.GetWidth(),
+                update.irradianceMap.GetHeight(),
+                DXGI_FORMAT_R32G32B32A32_FLOAT,
+                update.irradianceMap.GetSizeInBytes(),
+                update.irradianceMap.GetPixels(),
+                &pIBLTexture->irrTexture));
         }
+        break;
 
-        IBLTextures iblTexture = {};
-
-        iblTexture.envNumLevels = ibl.numLevels;
-
-        // Environment
+        case IBL_UPDATE_ENVIRONMENT:
         {
-            const uint32_t pixelStride = ibl.environmentMap.GetPixelStride();
-            const uint32_t rowStride   = ibl.environmentMap.GetRowStride();
-
-            std::vector<MipOffset> mipOffsets;
-            uint32_t               levelOffset = 0;
-            uint32_t               levelWidth  = ibl.baseWidth;
-            uint32_t               levelHeight = ibl.baseHeight;
-            for (uint32_t i = 0; i < ibl.numLevels; ++i)
-            {
-                MipOffset mipOffset = {};
-                mipOffset.Offset    = levelOffset;
-                mipOffset.RowStride = rowStride;
-
-                mipOffsets.push_back(mipOffset);
-
-                levelOffset += (rowStride * levelHeight);
-                levelWidth >>= 1;
-                levelHeight >>= 1;
-            }
-
-            ComPtr<ID3D12Resource> texture;
             CHECK_CALL(CreateTexture(
                 pRenderer,
-                ibl.baseWidth,
-                ibl.baseHeight,
-                DXGI_FORMAT_R32G32B32A32_FLOAT,
-                mipOffsets,
-                ibl.environmentMap.GetSizeInBytes(),
-                ibl.environmentMap.GetPixels(),
-                &texture));
-            iblTexture.envTexture = texture;
-
-            outIBLTextures.push_back(iblTexture);
+                update.width,
+                update.height,
+                ToDxFormat(update.format),
+                update.mipOffsets,
+                update.GetSizeInBytes(),
+                update.GetData(),
+                &pIBLTexture->envTexture));
+
+            pIBLTexture->envNumLevels = update.GetNumLevels();
         }
+        break;
 
-        gIBLNames.push_back(iblFile.filename().replace_extension().string());
-
-        GREX_LOG_INFO("Loaded " << iblFile);
+        case IBL_UPDATE_EVICT:
+        {
+            pIBLTexture->envTexture.Reset();
+            pIBLTexture->envNumLevels = 0;
+        }
+        break;
     }
 }
 
@@ -2228,9 +2234,29 @@ void WriteDescriptors(
     // IBL Textures
     for (uint32_t i = 0; i < iblTextures.size(); ++i)
     {
-        auto& iblTexture = iblTextures[i];
+        WriteIBLDescriptor(pRenderer, pDescriptorHeap, i, iblTextures[i]);
+    }
+}
 
-        D3D12_CPU_DESCRIPTOR_HANDLE descriptor = {kBaseDescriptor.ptr + ((kIBLTextureOffset + i) * kIncrementSize)};
+void WriteIBLDescriptor(
+    DxRenderer*           pRenderer,
+    ID3D12DescriptorHeap* pDescriptorHeap,
+    uint32_t              iblIndex,
+    const IBLTextures&    iblTexture)
+{
+    const D3D12_CPU_DESCRIPTOR_HANDLE kBaseDescriptor = pDescriptorHeap->GetCPUDescriptorHandleForHeapStart();
+    const UINT                        kIncrementSize  = pRenderer->Device->GetDescriptorHandleIncrementSize(D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV);
+
+    D3D12_CPU_DESCRIPTOR_HANDLE descriptor = {kBaseDescriptor.ptr + ((kIBLTextureOffset + iblIndex) * kIncrementSize)};
+
+    // Irradiance map until the environment map is resident, IBLs that
+    // were never selected have neither
+    if (iblTexture.envTexture)
+    {
         CreateDescriptorTexture2D(pRenderer, iblTexture.envTexture.Get(), descriptor, 0, iblTexture.envNumLevels);
     }
+    else if (iblTexture.irrTexture)
+    {
+        CreateDescriptorTexture2D(pRenderer, iblTexture.irrTexture.Get(), descriptor, 0, 1);
+    }
 }
\ No newline at end of file
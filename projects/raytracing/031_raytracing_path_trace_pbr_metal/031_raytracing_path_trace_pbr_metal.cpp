@@ -1,6 +1,7 @@
 #include "window.h"
 
 #include "mtl_renderer.h"
+#include "ibl_residency.h"
 #include "tri_mesh.h"
 
 #include <glm/glm.hpp>
@@ -28,7 +29,8 @@ using namespace glm;
 // =============================================================================
 // Macros, enums, and constants
 // =============================================================================
-const uint32_t kMaxIBLs = 100;
+const uint32_t kMaxIBLs         = 100;
+const uint64_t kIBLMemoryBudget = 64 * 1024 * 1024; // BC6H environment maps, about 5 at 4k
 
 const uint32_t kGeometryArgBufferParamIndex    = 6;
 const uint32_t kIBLTexturesArgBufferParamIndex = 7;
@@ -82,11 +84,14 @@ struct Geometry
     MetalBuffer normalBuffer;
 };
 
+// irrTexture is loaded first and stands in for envTexture until it's resident
 struct IBLTextures
 {
     MetalTexture irrTexture;
     MetalTexture envTexture;
-    uint32_t     envNumLevels;
+    uint32_t     envNumLevels = 0;
+
+    MTL::Texture* GetTexture() const { return envTexture.Texture ? envTexture.Texture.get() : irrTexture.Texture.get(); }
 };
 
 struct MaterialParameters
@@ -136,9 +141,10 @@ void CreateTLAS(
     MetalBuffer*                     pInstanceBuffer,
     std::vector<MaterialParameters>& outMaterialParams);
 
-void CreateIBLTextures(
-    MetalRenderer*            pRenderer,
-    std::vector<IBLTextures>& outIBLTextures);
+void ApplyIBLUpdate(
+    MetalRenderer*   pRenderer,
+    const IBLUpdate& update,
+    IBLTextures*     pIBLTexture);
 
 // =============================================================================
 // Input functions
@@ -397,27 +403,45 @@ int main(int argc, char** argv)
 
     // *************************************************************************
     // IBL txtures
+    //
+    // Only the selected IBL is loaded, others are loaded when they're
+    // selected and evicted when they go over the budget. BC6H is 16x
+    // smaller than the RGBA32F levels, log its error per level.
     // *************************************************************************
-    std::vector<IBLTextures> iblTextures = {};
-    CreateIBLTextures(
-        renderer.get(),
-        iblTextures);
+    IBLResidency iblResidency(
+        FindIBLFiles(kMaxIBLs),
+        BCEncodeOptions().Format(GREX_FORMAT_BC6H_UFLOAT).Quality(BC_QUALITY_FAST).MeasureError(true),
+        kIBLMemoryBudget);
+    for (uint32_t i = 0; i < iblResidency.GetCount(); ++i)
+    {
+        gIBLNames.push_back(iblResidency.GetName(i));
+    }
+
+    std::vector<IBLTextures> iblTextures(iblResidency.GetCount());
+    iblResidency.Select(gIBLIndex);
+    iblResidency.WaitForSelected();
+    for (auto& update : iblResidency.TakeUpdates())
+    {
+        ApplyIBLUpdate(renderer.get(), update, &iblTextures[update.index]);
+    }
 
     // *************************************************************************
     // IBL textures argument buffer
     // *************************************************************************
-    NS::SharedPtr<MTL::Buffer> iblTexturesArgBuffer;
+    // Kept around to update the entries as IBLs are loaded and evicted
+    NS::SharedPtr<MTL::Buffer>          iblTexturesArgBuffer;
+    NS::SharedPtr<MTL::ArgumentEncoder> iblTexturesArgEncoder;
     {
-        auto argEncoder = NS::TransferPtr(rayTraceShader.Function->newArgumentEncoder(kIBLTexturesArgBufferParamIndex));
+        iblTexturesArgEncoder = NS::TransferPtr(rayTraceShader.Function->newArgumentEncoder(kIBLTexturesArgBufferParamIndex));
 
-        iblTexturesArgBuffer = NS::TransferPtr(renderer->Device->newBuffer(argEncoder->encodedLength(), MTL::ResourceStorageModeManaged));
+        iblTexturesArgBuffer = NS::TransferPtr(renderer->Device->newBuffer(iblTexturesArgEncoder->encodedLength(), MTL::ResourceStorageModeManaged));
         iblTexturesArgBuffer->setLabel(NS::String::string("IBL Textures Arg Buffer", NS::UTF8StringEncoding));
 
-        argEncoder->setArgumentBuffer(iblTexturesArgBuffer.get(), 0);
+        iblTexturesArgEncoder->setArgumentBuffer(iblTexturesArgBuffer.get(), 0);
 
         for (size_t i = 0; i < iblTextures.size(); ++i)
         {
-            argEncoder->setTexture(iblTextures[i].envTexture.Texture.get(), i);
+            iblTexturesArgEncoder->setTexture(iblTextures[i].GetTexture(), i);
         }
 
         iblTexturesArgBuffer->didModifyRange(NS::Range::Make(0, iblTexturesArgBuffer->length()));
@@ -494,6 +518,7 @@ int main(int argc, char** argv)
                     {
                         currentIBLName = gIBLNames[i].c_str();
                         gIBLIndex      = static_cast<uint32_t>(i);
+                        iblResidency.Select(gIBLIndex);
                     }
                     if (isSelected)
                     {
@@ -531,7 +556,29 @@ int main(int argc, char** argv)
             gResetRayGenSamples = true;
         }
 
-        if (gCurrentIBLIndex != gIBLIndex)
+        // Apply IBL loads and evictions, the command buffer is waited on at
+        // the end of every frame so evicted textures aren't in use
+        {
+            auto updates = iblResidency.TakeUpdates();
+            for (auto& update : updates)
+            {
+                ApplyIBLUpdate(renderer.get(), update, &iblTextures[update.index]);
+                iblTexturesArgEncoder->setTexture(iblTextures[update.index].GetTexture(), update.index);
+
+                if (update.index == gCurrentIBLIndex)
+                {
+                    gResetRayGenSamples = true;
+                }
+            }
+
+            if (!updates.empty())
+            {
+                iblTexturesArgBuffer->didModifyRange(NS::Range::Make(0, iblTexturesArgBuffer->length()));
+            }
+        }
+
+        // Switch over once the selected IBL has at least its fallback
+        if ((gCurrentIBLIndex != gIBLIndex) && iblTextures[gIBLIndex].irrTexture.Texture)
         {
             gCurrentIBLIndex    = gIBLIndex;
             gResetRayGenSamples = true;
@@ -625,7 +672,10 @@ int main(int argc, char** argv)
 
             for (size_t i = 0; i < iblTextures.size(); ++i)
             {
-                pComputeEncoder->useResource(iblTextures[i].envTexture.Texture.get(), MTL::ResourceUsageRead);
+                if (iblTextures[i].GetTexture() != nullptr)
+                {
+                    pComputeEncoder->useResource(iblTextures[i].GetTexture(), MTL::ResourceUsageRead);
+                }
             }
 
             pComputeEncoder->useResource(accumTexture.Texture.get(), MTL::ResourceUsageRead);
@@ -1501,90 +1551,47 @@ void CreateTLAS(
     pTLAS->AS = compactedAccelStruct;
 }
 
-void CreateIBLTextures(
-    MetalRenderer*            pRenderer,
-    std::vector<IBLTextures>& outIBLTextures)
+void ApplyIBLUpdate(
+    MetalRenderer*   pRenderer,
+    const IBLUpdate& update,
+    IBLTextures*     pIBLTexture)
 {
-    std::vector<std::filesystem::path> iblFiles;
+    switch (update.type)
     {
-        auto iblDirs = GetEveryAssetPath("IBL");
-        for (auto& dir : iblDirs)
+        case IBL_UPDATE_FALLBACK:
         {
-            for (auto& entry : std::filesystem::directory_iterator(dir))
-            {
-                if (!entry.is_regular_file())
-                {
-                    continue;
-                }
-                auto path = entry.path();
-                auto ext  = path.extension();
-                if (ext == ".ibl")
-                {
-                    path = std::filesystem::relative(path, dir.parent_path());
-                    iblFiles.push_back(path);
-                }
-            }
-        }
-    }
-
-    // Sort the file names since the come back out of order on macOS
-    std::sort(iblFiles.begin(), iblFiles.end());
-
-    size_t maxEntries = std::min<size_t>(kMaxIBLs, iblFiles.size());
-    for (size_t i = 0; i < maxEntries; ++i)
-    {
-        std::filesystem::path iblFile = iblFiles[i];
-
-        IBLMaps ibl = {};
-        if (!LoadIBLMaps32f(iblFile, &ibl))
-        {
-            GREX_LOG_ERROR("failed to load: " << iblFile);
-            return;
+            CHECK_CALL(CreateTexture(
+                pRenderer,
+                update.irradianceMap.GetWidth(),
+                update.irradianceMap.GetHeight(),
+                MTL::PixelFormatRGBA32Float,
+                update.irradianceMap.GetSizeInBytes(),
+                update.irradianceMap.GetPixels(),
+                &pIBLTexture->irrTexture));
         }
+        break;
 
-        IBLTextures iblTexture = {};
-
-        iblTexture.envNumLevels = ibl.numLevels;
-
-        // Environment
+        case IBL_UPDATE_ENVIRONMENT:
         {
-            const uint32_t pixelStride = ibl.environmentMap.GetPixelStride();
-            const uint32_t rowStride   = ibl.environmentMap.GetRowStride();
-
-            std::vector<MipOffset> mipOffsets;
-            uint32_t               levelOffset = 0;
-            uint32_t               levelWidth  = ibl.baseWidth;
-            uint32_t               levelHeight = ibl.baseHeight;
-            for (uint32_t i = 0; i < ibl.numLevels; ++i)
-            {
-                MipOffset mipOffset = {};
-                mipOffset.Offset    = levelOffset;
-                mipOffset.RowStride = rowStride;
-
-                mipOffsets.push_back(mipOffset);
-
-                levelOffset += (rowStride * levelHeight);
-                levelWidth >>= 1;
-                levelHeight >>= 1;
-            }
-
-            MetalTexture texture;
             CHECK_CALL(CreateTexture(
                 pRenderer,
-                ibl.baseWidth,
-                ibl.baseHeight,
-                MTL::PixelFormatRGBA32Float,
-                mipOffsets,
-                ibl.environmentMap.GetSizeInBytes(),
-                ibl.environmentMap.GetPixels(),
-                &texture));
-            iblTexture.envTexture = texture;
-
-            outIBLTextures.push_back(iblTexture);
+                update.width,
+                update.height,
+                ToMTLFormat(update.format),
+                update.mipOffsets,
+                update.GetSizeInBytes(),
+                update.GetData(),
+                &pIBLTexture->envTexture));
+
+            pIBLTexture->envNumLevels = update.GetNumLevels();
         }
+        break;
 
-        gIBLNames.push_back(iblFile.filename().replace_extension().string());
-
-        GREX_LOG_INFO("Loaded " << iblFile);
+        case IBL_UPDATE_EVICT:
+        {
+            pIBLTexture->envTexture.Texture.reset();
+            pIBLTexture->envNumLevels = 0;
+        }
+        break;
     }
 }
@@ -1,6 +1,7 @@
 #include "window.h"
 
 #include "vk_renderer.h"
+#include "ibl_residency.h"
 #include "tri_mesh.h"
 
 #include <glm/glm.hpp>
@@ -28,8 +29,9 @@ using namespace glm;
 // =============================================================================
 // Macros, enums, and constants
 // =============================================================================
-const uint32_t kMaxIBLs       = 100;
-const uint32_t kMaxGeometries = 25;
+const uint32_t kMaxIBLs         = 100;
+const uint32_t kMaxGeometries   = 25;
+const uint64_t kIBLMemoryBudget = 64 * 1024 * 1024; // BC6H environment maps, about 5 at 4k
 
 // =============================================================================
 // Shader code
@@ -103,11 +105,13 @@ struct Geometry
     VulkanBuffer normalBuffer;
 };
 
+// irrTexture is loaded first and stands in for envTexture until it's resident
 struct IBLTextures
 {
-    VulkanImage irrTexture;
-    VulkanImage envTexture;
-    uint32_t    envNumLevels;
+    VulkanImage irrTexture   = {};
+    VulkanImage envTexture   = {};
+    VkFormat    envFormat    = VK_FORMAT_UNDEFINED;
+    uint32_t    envNumLevels = 0;
 };
 
 struct MaterialParameters
@@ -164,9 +168,10 @@ void CreateTLAS(
     VulkanAccelStruct*               pTLAS,
     std::vector<MaterialParameters>& outMaterialParams);
 void CreateAccumTexture(VulkanRenderer* pRenderer, VulkanImage* pBuffer);
-void CreateIBLTextures(
-    VulkanRenderer*           pRenderer,
-    std::vector<IBLTextures>& outIBLTextures);
+void ApplyIBLUpdate(
+    VulkanRenderer*  pRenderer,
+    const IBLUpdate& update,
+    IBLTextures*     pIBLTexture);
 void CreateRayTracingDescriptors(
     VulkanRenderer*                 pRenderer,
     VulkanDescriptorSet*            pDescriptors,
@@ -490,11 +495,23 @@ int main(int argc, char** argv)
 
     // *************************************************************************
     // IBL textures
+    //
+    // Only the selected IBL is loaded, others are loaded when they're
+    // selected and evicted when they go over the budget. BC6H is 16x
+    // smaller than the RGBA32F levels, log its error per level.
     // *************************************************************************
-    std::vector<IBLTextures> iblTextures = {};
-    CreateIBLTextures(
-        renderer.get(),
-        iblTextures);
+    IBLResidency iblResidency(
+        FindIBLFiles(kMaxIBLs),
+        BCEncodeOptions().Format(GREX_FORMAT_BC6H_UFLOAT).Quality(BC_QUALITY_FAST).MeasureError(true),
+        kIBLMemoryBudget);
+    for (uint32_t i = 0; i < iblResidency.GetCount(); ++i)
+    {
+        gIBLNames.push_back(iblResidency.GetName(i));
+    }
+
+    std::vector<IBLTextures> iblTextures(iblResidency.GetCount());
+    iblResidency.Select(gIBLIndex);
+    iblResidency.WaitForSelected();
 
     // *************************************************************************
     // IBL Sampler
@@ -642,6 +659,7 @@ int main(int argc, char** argv)
                     {
                         currentIBLName = gIBLNames[i].c_str();
                         gIBLIndex      = static_cast<uint32_t>(i);
+                        iblResidency.Select(gIBLIndex);
                     }
                     if (isSelected)
                     {
@@ -679,7 +697,20 @@ int main(int argc, char** argv)
             gResetRayGenSamples = true;
         }
 
-        if (gCurrentIBLIndex != gIBLIndex)
+        // Apply IBL loads and evictions, the GPU is waited on at the end
+        // of every frame so evicted textures aren't in use
+        for (auto& update : iblResidency.TakeUpdates())
+        {
+            ApplyIBLUpdate(renderer.get(), update, &iblTextures[update.index]);
+
+            if (update.index == gCurrentIBLIndex)
+            {
+                gResetRayGenSamples = true;
+            }
+        }
+
+        // Switch over once the selected IBL has at least its fallback
+        if ((gCurrentIBLIndex != gIBLIndex) && (iblTextures[gIBLIndex].irrTexture.Image != VK_NULL_HANDLE))
         {
             gCurrentIBLIndex    = gIBLIndex;
             gResetRayGenSamples = true;
@@ -2173,88 +2204,51 @@ void CreateAccumTexture(VulkanRenderer* pRenderer, VulkanImage* pBuffer)
         RESOURCE_STATE_COMMON));
 }
 
-void CreateIBLTextures(
-    VulkanRenderer*           pRenderer,
-    std::vector<IBLTextures>& outIBLTextures)
+void ApplyIBLUpdate(
+    VulkanRenderer*  pRenderer,
+    const IBLUpdate& update,
+    IBLTextures*     pIBLTexture)
 {
-    std::vector<std::filesystem::path> iblFiles;
-    {
-        auto iblDirs = GetEveryAssetPath("IBL");
-        for (auto& dir : iblDirs)
-        {
-            for (auto& entry : std::filesystem::directory_iterator(dir))
-            {
-                if (!entry.is_regular_file())
-                {
-                    continue;
-                }
-                auto path = entry.path();
-                auto ext  = path.extension();
-                if (ext == ".ibl")
-                {
-                    path = std::filesystem::relative(path, dir.parent_path());
-                    iblFiles.push_back(path);
-                }
-            }
-        }
-    }
-
-    size_t maxEntries = std::min<size_t>(kMaxIBLs, iblFiles.size());
-    for (size_t i = 0; i < maxEntries; ++i)
+    switch (update.type)
     {
-        std::filesystem::path iblFile = iblFiles[i];
-
-        IBLMaps ibl = {};
-        if (!LoadIBLMaps32f(iblFile, &ibl))
+        case IBL_UPDATE_FALLBACK:
         {
-            GREX_LOG_ERROR("failed to load: " << iblFile);
-            return;
+            CHECK_CALL(CreateTexture(
+                pRenderer,
+                update.irradianceMap.GetWidth(),
+                update.irradianceMap.GetHeight(),
+                VK_FORMAT_R32G32B32A32_SFLOAT,
+                update.irradianceMap.GetSizeInBytes(),
+                update.irradianceMap.GetPixels(),
+                &pIBLTexture->irrTexture));
         }
+        break;
 
-        IBLTextures iblTexture = {};
-
-        iblTexture.envNumLevels = ibl.numLevels;
-
-        // Environment
+        case IBL_UPDATE_ENVIRONMENT:
         {
-            const uint32_t pixelStride = ibl.environmentMap.GetPixelStride();
-            const uint32_t rowStride   = ibl.environmentMap.GetRowStride();
-
-            std::vector<MipOffset> mipOffsets;
-            uint32_t               levelOffset = 0;
-            uint32_t               levelWidth  = ibl.baseWidth;
-            uint32_t               levelHeight = ibl.baseHeight;
-            for (uint32_t i = 0; i < ibl.numLevels; ++i)
-            {
-                MipOffset mipOffset = {};
-                mipOffset.Offset    = levelOffset;
-                mipOffset.RowStride = rowStride;
-
-                mipOffsets.push_back(mipOffset);
-
-                levelOffset += (rowStride * levelHeight);
-                levelWidth >>= 1;
-                levelHeight >>= 1;
-            }
-
-            VulkanImage texture;
             CHECK_CALL(CreateTexture(
                 pRenderer,
-                ibl.baseWidth,
-                ibl.baseHeight,
-                VK_FORMAT_R32G32B32A32_SFLOAT,
-                mipOffsets,
-                ibl.environmentMap.GetSizeInBytes(),
-                ibl.environmentMap.GetPixels(),
-                &texture));
-            iblTexture.envTexture = texture;
-
-            outIBLTextures.push_back(iblTexture);
+                update.width,
+                update.height,
+                ToVkFormat(update.format),
+                update.mipOffsets,
+                update.GetSizeInBytes(),
+                update.GetData(),
+                &pIBLTexture->envTexture));
+
+            pIBLTexture->envFormat    = ToVkFormat(update.format);
+            pIBLTexture->envNumLevels = update.GetNumLevels();
         }
+        break;
 
-        gIBLNames.push_back(iblFile.filename().replace_extension().string());
+        case IBL_UPDATE_EVICT:
+        {
+            DestroyImage(pRenderer, &pIBLTexture->envTexture);
 
-        GREX_LOG_INFO("Loaded " << iblFile);
+            pIBLTexture->envFormat    = VK_FORMAT_UNDEFINED;
+            pIBLTexture->envNumLevels = 0;
+        }
+        break;
     }
 }
 
@@ -2457,14 +2451,22 @@ void CreateRayTracingDescriptors(
         {
             auto& iblTexture = iblTextures[i];
 
+            // Irradiance map until the environment map is resident, IBLs that
+            // were never selected have neither
+            const bool isResident = (iblTexture.envTexture.Image != VK_NULL_HANDLE);
+            if (!isResident && (iblTexture.irrTexture.Image == VK_NULL_HANDLE))
+            {
+                continue;
+            }
+
             VkImageView imageView = VK_NULL_HANDLE;
             CHECK_CALL(CreateImageView(
                 pRenderer,
-                &iblTexture.envTexture,
+                isResident ? &iblTexture.envTexture : &iblTexture.irrTexture,
                 VK_IMAGE_VIEW_TYPE_2D,
-                VK_FORMAT_R32G32B32A32_SFLOAT,
+                isResident ? iblTexture.envFormat : VK_FORMAT_R32G32B32A32_SFLOAT,
                 0,
-                iblTexture.envNumLevels,
+                isResident ? iblTexture.envNumLevels : 1,
                 0,
                 1,
                 &imageView));